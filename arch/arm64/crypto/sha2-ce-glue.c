@@ -15,6 +15,7 @@
 #include <linux/cpufeature.h>
 #include <linux/crypto.h>
 #include <linux/module.h>
+#include <linux/sizes.h>
 
 MODULE_DESCRIPTION("SHA-224/SHA-256 secure hash using ARMv8 Crypto Extensions");
 MODULE_AUTHOR("Ard Biesheuvel <ard.biesheuvel@linaro.org>");
@@ -32,6 +33,9 @@ extern const u32 sha256_ce_offsetof_finalize;
 
 asmlinkage int sha2_ce_transform(struct sha256_ce_state *sst, u8 const *src,
 				 int blocks);
+asmlinkage void sha256_ce_transform2x(u32 *state_a, u32 *state_b,
+				      u8 const *src_a, u8 const *src_b,
+				      int blocks);
 
 static void __sha2_ce_transform(struct sha256_state *sst, u8 const *src,
 				int blocks)
@@ -102,6 +106,78 @@ static int sha256_ce_finup(struct shash_desc *desc, const u8 *data,
 	return sha256_base_finish(desc, out);
 }
 
+/* bounds the time spent with preemption disabled in sha256_ce_finup_mb() */
+#define SHA256_CE_MB_CHUNK_BLOCKS	(SZ_4K / SHA256_BLOCK_SIZE)
+
+/*
+ * Two messages of the same length, e.g. dm-verity or fs-verity blocks, are
+ * hashed in one pass that interleaves them, keeping the crypto units busy
+ * while each stream waits for its previous round.
+ */
+static int sha256_ce_finup_mb(struct shash_desc *desc,
+			      const u8 * const data[], unsigned int len,
+			      u8 * const outs[], unsigned int num_msgs)
+{
+	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
+	unsigned int words = crypto_shash_digestsize(desc->tfm) / 4;
+	u64 bits = (sctx->sst.count + len) << 3;
+	u8 pad[2][2 * SHA256_BLOCK_SIZE];
+	unsigned int blocks, i, j, rem;
+	const u8 *src[2];
+	u32 state[2][8];
+	int tail;
+
+	/* buffered partial data would need to be prepended to both */
+	if (num_msgs != 2 || sctx->sst.count % SHA256_BLOCK_SIZE ||
+	    !crypto_simd_usable()) {
+		for (i = 0; i < num_msgs; i++) {
+			SHASH_DESC_ON_STACK(desc2, desc->tfm);
+
+			memcpy(desc2, desc, sizeof(*desc) + sizeof(*sctx));
+			sha256_ce_finup(desc2, data[i], len, outs[i]);
+			shash_desc_zero(desc2);
+		}
+		return 0;
+	}
+
+	memcpy(state[0], sctx->sst.state, sizeof(state[0]));
+	memcpy(state[1], sctx->sst.state, sizeof(state[1]));
+	src[0] = data[0];
+	src[1] = data[1];
+
+	for (blocks = len / SHA256_BLOCK_SIZE; blocks; blocks -= i) {
+		i = min_t(unsigned int, blocks, SHA256_CE_MB_CHUNK_BLOCKS);
+		kernel_neon_begin();
+		sha256_ce_transform2x(state[0], state[1], src[0], src[1], i);
+		kernel_neon_end();
+		src[0] += i * SHA256_BLOCK_SIZE;
+		src[1] += i * SHA256_BLOCK_SIZE;
+	}
+
+	/* the 0x80 terminator and the bit count take one or two more blocks */
+	rem = len % SHA256_BLOCK_SIZE;
+	tail = rem < SHA256_BLOCK_SIZE - sizeof(__be64) ? 1 : 2;
+	memset(pad, 0, sizeof(pad));
+	for (i = 0; i < 2; i++) {
+		memcpy(pad[i], src[i], rem);
+		pad[i][rem] = 0x80;
+		put_unaligned_be64(bits, &pad[i][tail * SHA256_BLOCK_SIZE -
+						 sizeof(__be64)]);
+	}
+
+	kernel_neon_begin();
+	sha256_ce_transform2x(state[0], state[1], pad[0], pad[1], tail);
+	kernel_neon_end();
+
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < words; j++)
+			put_unaligned_be32(state[i][j], outs[i] + j * 4);
+
+	memzero_explicit(pad, sizeof(pad));
+	memzero_explicit(state, sizeof(state));
+	return 0;
+}
+
 static int sha256_ce_final(struct shash_desc *desc, u8 *out)
 {
 	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
@@ -138,6 +214,8 @@ static struct shash_alg algs[] = { {
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
+	.mb_max_msgs		= 2,
 	.export			= sha256_ce_export,
 	.import			= sha256_ce_import,
 	.descsize		= sizeof(struct sha256_ce_state),
@@ -155,6 +233,8 @@ static struct shash_alg algs[] = { {
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
+	.mb_max_msgs		= 2,
 	.export			= sha256_ce_export,
 	.import			= sha256_ce_import,
 	.descsize		= sizeof(struct sha256_ce_state),
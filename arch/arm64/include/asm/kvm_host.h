@@ -557,6 +557,11 @@ struct kvm_vcpu_arch {
 		gpa_t base;
 	} steal;
 
+	struct {
+		gpa_t base;
+		bool preempted;
+	} pv_sched;
+
 	/* Per-vcpu CCSIDR override or NULL */
 	u32 *ccsidr;
 };
@@ -981,6 +986,8 @@ static inline bool kvm_arch_pmi_in_guest(struct kvm_vcpu *vcpu)
 long kvm_hypercall_pv_features(struct kvm_vcpu *vcpu);
 gpa_t kvm_init_stolen_time(struct kvm_vcpu *vcpu);
 void kvm_update_stolen_time(struct kvm_vcpu *vcpu);
+long kvm_hypercall_pv_sched(struct kvm_vcpu *vcpu);
+void kvm_update_pv_preempted(struct kvm_vcpu *vcpu, bool preempted);
 
 bool kvm_arm_pvtime_supported(void);
 int kvm_arm_pvtime_set_attr(struct kvm_vcpu *vcpu,
@@ -999,6 +1006,7 @@ void kvm_arm_vmid_clear_active(void);
 static inline void kvm_arm_pvtime_vcpu_init(struct kvm_vcpu_arch *vcpu_arch)
 {
 	vcpu_arch->steal.base = INVALID_GPA;
+	vcpu_arch->pv_sched.base = INVALID_GPA;
 }
 
 static inline bool kvm_arm_is_pvtime_enabled(struct kvm_vcpu_arch *vcpu_arch)
@@ -612,6 +612,25 @@ int kvm_pgtable_stage2_relax_perms(struct kvm_pgtable *pgt, u64 addr,
  */
 int kvm_pgtable_stage2_flush(struct kvm_pgtable *pgt, u64 addr, u64 size);
 
+/**
+ * kvm_pgtable_stage2_split() - Split block mappings of a guest stage-2
+ *				address range down to page mappings.
+ * @pgt:	Page-table structure initialised by kvm_pgtable_stage2_init*().
+ * @addr:	Intermediate physical address from which to split.
+ * @size:	Size of the range.
+ * @mc:		Cache of pre-allocated memory for the new tables.
+ *
+ * The offset of @addr within a page is ignored and @size is rounded-up to
+ * the next page boundary. The new entries keep the attributes of the block
+ * they replace. Each block is replaced with break-before-make, so the
+ * caller must hold the mmu_lock for write.
+ *
+ * Return: 0 on success, -ENOMEM if @mc ran out of pages before the whole
+ * range was split, negative error code on other failures.
+ */
+int kvm_pgtable_stage2_split(struct kvm_pgtable *pgt, u64 addr, u64 size,
+			     struct kvm_mmu_memory_cache *mc);
+
 /**
  * kvm_pgtable_walk() - Walk a page-table.
  * @pgt:	Page-table structure initialised by kvm_pgtable_*_init().
@@ -19,10 +19,14 @@ static inline u64 paravirt_steal_clock(int cpu)
 }
 
 int __init pv_time_init(void);
+int __init pv_sched_init(void);
+
+bool paravirt_vcpu_is_preempted(int cpu);
 
 #else
 
 #define pv_time_init() do {} while (0)
+#define pv_sched_init() do {} while (0)
 
 #endif // CONFIG_PARAVIRT
 
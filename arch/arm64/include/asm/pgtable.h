@@ -93,7 +93,12 @@ static inline pteval_t __phys_to_pte_val(phys_addr_t phys)
 	__pte(__phys_to_pte_val((phys_addr_t)(pfn) << PAGE_SHIFT) | pgprot_val(prot))
 
 #define pte_none(pte)		(!pte_val(pte))
-#define pte_clear(mm,addr,ptep)	set_pte(ptep, __pte(0))
+#define __pte_clear(mm,addr,ptep)	set_pte(ptep, __pte(0))
+#define pte_clear(mm,addr,ptep)					\
+	do {							\
+		contpte_try_unfold(mm, addr, ptep);		\
+		__pte_clear(mm, addr, ptep);			\
+	} while (0)
 #define pte_page(pte)		(pfn_to_page(pte_pfn(pte)))
 
 /*
@@ -324,6 +329,39 @@ static inline void __check_safe_pte_update(struct mm_struct *mm, pte_t *ptep,
 		     __func__, pte_val(old_pte), pte_val(pte));
 }
 
+/*
+ * User PTEs that map a naturally aligned, CONT_PTES sized run of a single
+ * large folio with identical attributes are transparently folded into a
+ * contiguous block. Only runs that are already young, and either dirty or
+ * read-only, are folded, so the hardware never needs to update the
+ * access/dirty state of a folded entry and a plain read of any PTE in the
+ * block stays accurate. Anything that modifies one entry of a block
+ * unfolds it first.
+ */
+void __contpte_try_fold(struct mm_struct *mm, unsigned long addr,
+			pte_t *ptep, pte_t pte);
+void __contpte_try_unfold(struct mm_struct *mm, unsigned long addr,
+			  pte_t *ptep, pte_t pte);
+
+static inline void contpte_try_fold(struct mm_struct *mm, unsigned long addr,
+				    pte_t *ptep, pte_t pte)
+{
+	/* Only attempt it when the last entry of a block is written */
+	if (mm != &init_mm && pte_valid(pte) && !pte_cont(pte) &&
+	    ((pte_pfn(pte) + 1) & (CONT_PTES - 1)) == 0 &&
+	    ((addr + PAGE_SIZE) & ~CONT_PTE_MASK) == 0)
+		__contpte_try_fold(mm, addr, ptep, pte);
+}
+
+static inline void contpte_try_unfold(struct mm_struct *mm, unsigned long addr,
+				      pte_t *ptep)
+{
+	pte_t pte = READ_ONCE(*ptep);
+
+	if (unlikely(pte_valid(pte) && pte_cont(pte) && mm != &init_mm))
+		__contpte_try_unfold(mm, addr, ptep, pte);
+}
+
 static inline void __set_pte_at(struct mm_struct *mm, unsigned long addr,
 				pte_t *ptep, pte_t pte)
 {
@@ -358,8 +396,10 @@ static inline void __set_pte_at(struct mm_struct *mm, unsigned long addr,
 static inline void set_pte_at(struct mm_struct *mm, unsigned long addr,
 			      pte_t *ptep, pte_t pte)
 {
+	contpte_try_unfold(mm, addr, ptep);
 	page_table_check_pte_set(mm, addr, ptep, pte);
-	return __set_pte_at(mm, addr, ptep, pte);
+	__set_pte_at(mm, addr, ptep, pte);
+	contpte_try_fold(mm, addr, ptep, pte);
 }
 
 /*
@@ -834,9 +874,17 @@ static inline pmd_t pmd_modify(pmd_t pmd, pgprot_t newprot)
 }
 
 #define __HAVE_ARCH_PTEP_SET_ACCESS_FLAGS
-extern int ptep_set_access_flags(struct vm_area_struct *vma,
-				 unsigned long address, pte_t *ptep,
-				 pte_t entry, int dirty);
+extern int __ptep_set_access_flags(struct vm_area_struct *vma,
+				   unsigned long address, pte_t *ptep,
+				   pte_t entry, int dirty);
+
+static inline int ptep_set_access_flags(struct vm_area_struct *vma,
+					unsigned long address, pte_t *ptep,
+					pte_t entry, int dirty)
+{
+	contpte_try_unfold(vma->vm_mm, address, ptep);
+	return __ptep_set_access_flags(vma, address, ptep, entry, dirty);
+}
 
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 #define __HAVE_ARCH_PMDP_SET_ACCESS_FLAGS
@@ -844,7 +892,8 @@ static inline int pmdp_set_access_flags(struct vm_area_struct *vma,
 					unsigned long address, pmd_t *pmdp,
 					pmd_t entry, int dirty)
 {
-	return ptep_set_access_flags(vma, address, (pte_t *)pmdp, pmd_pte(entry), dirty);
+	return __ptep_set_access_flags(vma, address, (pte_t *)pmdp,
+				       pmd_pte(entry), dirty);
 }
 
 static inline int pud_devmap(pud_t pud)
@@ -898,6 +947,7 @@ static inline int ptep_test_and_clear_young(struct vm_area_struct *vma,
 					    unsigned long address,
 					    pte_t *ptep)
 {
+	contpte_try_unfold(vma->vm_mm, address, ptep);
 	return __ptep_test_and_clear_young(ptep);
 }
 
@@ -928,13 +978,12 @@ static inline int pmdp_test_and_clear_young(struct vm_area_struct *vma,
 					    unsigned long address,
 					    pmd_t *pmdp)
 {
-	return ptep_test_and_clear_young(vma, address, (pte_t *)pmdp);
+	return __ptep_test_and_clear_young((pte_t *)pmdp);
 }
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 
-#define __HAVE_ARCH_PTEP_GET_AND_CLEAR
-static inline pte_t ptep_get_and_clear(struct mm_struct *mm,
-				       unsigned long address, pte_t *ptep)
+static inline pte_t __ptep_get_and_clear(struct mm_struct *mm,
+					 unsigned long address, pte_t *ptep)
 {
 	pte_t pte = __pte(xchg_relaxed(&pte_val(*ptep), 0));
 
@@ -943,6 +992,14 @@ static inline pte_t ptep_get_and_clear(struct mm_struct *mm,
 	return pte;
 }
 
+#define __HAVE_ARCH_PTEP_GET_AND_CLEAR
+static inline pte_t ptep_get_and_clear(struct mm_struct *mm,
+				       unsigned long address, pte_t *ptep)
+{
+	contpte_try_unfold(mm, address, ptep);
+	return __ptep_get_and_clear(mm, address, ptep);
+}
+
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 #define __HAVE_ARCH_PMDP_HUGE_GET_AND_CLEAR
 static inline pmd_t pmdp_huge_get_and_clear(struct mm_struct *mm,
@@ -960,8 +1017,7 @@ static inline pmd_t pmdp_huge_get_and_clear(struct mm_struct *mm,
  * ptep_set_wrprotect - mark read-only while trasferring potential hardware
  * dirty status (PTE_DBM && !PTE_RDONLY) to the software PTE_DIRTY bit.
  */
-#define __HAVE_ARCH_PTEP_SET_WRPROTECT
-static inline void ptep_set_wrprotect(struct mm_struct *mm, unsigned long address, pte_t *ptep)
+static inline void __ptep_set_wrprotect(pte_t *ptep)
 {
 	pte_t old_pte, pte;
 
@@ -974,12 +1030,19 @@ static inline void ptep_set_wrprotect(struct mm_struct *mm, unsigned long addres
 	} while (pte_val(pte) != pte_val(old_pte));
 }
 
+#define __HAVE_ARCH_PTEP_SET_WRPROTECT
+static inline void ptep_set_wrprotect(struct mm_struct *mm, unsigned long address, pte_t *ptep)
+{
+	contpte_try_unfold(mm, address, ptep);
+	__ptep_set_wrprotect(ptep);
+}
+
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 #define __HAVE_ARCH_PMDP_SET_WRPROTECT
 static inline void pmdp_set_wrprotect(struct mm_struct *mm,
 				      unsigned long address, pmd_t *pmdp)
 {
-	ptep_set_wrprotect(mm, address, (pte_t *)pmdp);
+	__ptep_set_wrprotect((pte_t *)pmdp);
 }
 
 #define pmdp_establish pmdp_establish
@@ -1106,6 +1169,21 @@ extern pte_t ptep_modify_prot_start(struct vm_area_struct *vma,
 extern void ptep_modify_prot_commit(struct vm_area_struct *vma,
 				    unsigned long addr, pte_t *ptep,
 				    pte_t old_pte, pte_t new_pte);
+
+#ifdef CONFIG_HUGETLB_PAGE_OPTIMIZE_VMEMMAP
+#define vmemmap_update_pmd vmemmap_update_pmd
+void vmemmap_update_pmd(unsigned long addr, pmd_t *pmdp, pte_t *ptep);
+
+#define vmemmap_update_pte vmemmap_update_pte
+void vmemmap_update_pte(unsigned long addr, pte_t *ptep, pte_t pte);
+
+bool vmemmap_fault_fixup(unsigned long addr);
+#else
+static inline bool vmemmap_fault_fixup(unsigned long addr)
+{
+	return false;
+}
+#endif
 #endif /* !__ASSEMBLY__ */
 
 #endif /* __ASM_PGTABLE_H */
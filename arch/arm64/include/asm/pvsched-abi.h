@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifndef __ASM_PVSCHED_ABI_H
+#define __ASM_PVSCHED_ABI_H
+
+/*
+ * Registered by each vCPU with ARM_SMCCC_VENDOR_HYP_KVM_PV_SCHED_FUNC_ID.
+ * The host sets @preempted while the vCPU is runnable but not running on
+ * a physical CPU.
+ */
+struct pvsched_vcpu_state {
+	__le32 preempted;
+	/* Structure must be 64 byte aligned, pad to that size */
+	u8 padding[60];
+} __packed;
+
+#endif
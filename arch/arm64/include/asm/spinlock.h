@@ -5,6 +5,7 @@
 #ifndef __ASM_SPINLOCK_H
 #define __ASM_SPINLOCK_H
 
+#include <asm/paravirt.h>
 #include <asm/qspinlock.h>
 #include <asm/qrwlock.h>
 
@@ -12,8 +13,9 @@
 #define smp_mb__after_spinlock()	smp_mb()
 
 /*
- * Changing this will break osq_lock() thanks to the call inside
- * smp_cond_load_relaxed().
+ * osq_lock() calls this inside smp_cond_load_relaxed(), whose WFE is not
+ * woken when the flag changes. A guest only sees a change of the PV flag
+ * there on the next event, which the arch timer event stream bounds.
  *
  * See:
  * https://lore.kernel.org/lkml/20200110100612.GC2827@hirez.programming.kicks-ass.net
@@ -21,7 +23,11 @@
 #define vcpu_is_preempted vcpu_is_preempted
 static inline bool vcpu_is_preempted(int cpu)
 {
+#ifdef CONFIG_PARAVIRT
+	return paravirt_vcpu_is_preempted(cpu);
+#else
 	return false;
+#endif
 }
 
 #endif /* __ASM_SPINLOCK_H */
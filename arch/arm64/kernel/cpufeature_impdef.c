@@ -3,8 +3,11 @@
  * Contains implementation-defined CPU feature definitions.
  */
 
+#include <asm/alternative.h>
 #include <asm/cpufeature.h>
 #include <asm/apple_cpufeature.h>
+#include <asm/cputype.h>
+#include <asm/insn.h>
 
 void __init init_cpu_hwcaps_indirect_list_from_array(const struct arm64_cpu_capabilities *caps);
 bool feature_matches(u64 reg, const struct arm64_cpu_capabilities *entry);
@@ -56,6 +59,29 @@ static const struct arm64_cpu_capabilities arm64_impdef_features[] = {
 	{},
 };
 
+/*
+ * Apple cores keep far more loads in flight than the Cortex cores the copy
+ * routines were tuned for, and their large copies go faster when lines are
+ * requested well ahead of the loop.  The copy loops carry a nop that is
+ * patched into "prfm pldl1strm, [x1, #APPLE_COPY_PREFETCH]" on those cores.
+ */
+#define APPLE_COPY_PREFETCH	512
+
+noinstr void alt_cb_apple_copy_prefetch(struct alt_instr *alt,
+					__le32 *origptr, __le32 *updptr,
+					int nr_inst)
+{
+	u32 insn = aarch64_insn_gen_nop();
+
+	/* PRFM (immediate): imm12 is scaled by 8, Rt holds the prfop */
+	if (read_cpuid_implementor() == ARM_CPU_IMP_APPLE)
+		insn = 0xf9800000 | ((APPLE_COPY_PREFETCH / 8) << 10) |
+		       (AARCH64_INSN_REG_1 << 5) | 0x1;	/* PLDL1STRM */
+
+	for (int i = 0; i < nr_inst; i++)
+		updptr[i] = cpu_to_le32(insn);
+}
+
 void __init init_cpu_hwcaps_indirect_list_impdef(void)
 {
 	init_cpu_hwcaps_indirect_list_from_array(arm64_impdef_features);
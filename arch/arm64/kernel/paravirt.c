@@ -13,15 +13,19 @@
 #include <linux/export.h>
 #include <linux/io.h>
 #include <linux/jump_label.h>
+#include <linux/percpu.h>
 #include <linux/printk.h>
 #include <linux/psci.h>
 #include <linux/reboot.h>
 #include <linux/slab.h>
+#include <linux/smp.h>
 #include <linux/types.h>
 #include <linux/static_call.h>
 
+#include <asm/hypervisor.h>
 #include <asm/paravirt.h>
 #include <asm/pvclock-abi.h>
+#include <asm/pvsched-abi.h>
 #include <asm/smp_plat.h>
 
 struct static_key paravirt_steal_enabled;
@@ -40,6 +44,9 @@ struct pv_time_stolen_time_region {
 
 static DEFINE_PER_CPU(struct pv_time_stolen_time_region, stolen_time_region);
 
+static DEFINE_PER_CPU_ALIGNED(struct pvsched_vcpu_state, pvsched_state);
+static bool pv_preempted __read_mostly;
+
 static bool steal_acc = true;
 static int __init parse_no_stealacc(char *arg)
 {
@@ -75,6 +82,16 @@ static u64 para_steal_clock(int cpu)
 	return ret;
 }
 
+/* tell the lock spinning code whether the vCPU behind @cpu is scheduled out */
+bool paravirt_vcpu_is_preempted(int cpu)
+{
+	if (!pv_preempted)
+		return false;
+
+	return !!le32_to_cpu(READ_ONCE(per_cpu(pvsched_state, cpu).preempted));
+}
+EXPORT_SYMBOL_GPL(paravirt_vcpu_is_preempted);
+
 static int stolen_time_cpu_down_prepare(unsigned int cpu)
 {
 	struct pvclock_vcpu_stolen_time *kaddr = NULL;
@@ -174,3 +191,69 @@ int __init pv_time_init(void)
 
 	return 0;
 }
+
+static void pv_sched_release(void *unused)
+{
+	struct arm_smccc_res res;
+
+	arm_smccc_1_1_invoke(ARM_SMCCC_VENDOR_HYP_KVM_PV_SCHED_FUNC_ID,
+			     KVM_PV_SCHED_IPA_RELEASE, &res);
+	this_cpu_write(pvsched_state.preempted, 0);
+}
+
+static int pv_sched_cpu_online(unsigned int cpu)
+{
+	struct arm_smccc_res res;
+
+	arm_smccc_1_1_invoke(ARM_SMCCC_VENDOR_HYP_KVM_PV_SCHED_FUNC_ID,
+			     KVM_PV_SCHED_IPA_INIT,
+			     per_cpu_ptr_to_phys(this_cpu_ptr(&pvsched_state)),
+			     &res);
+
+	if (res.a0 != SMCCC_RET_SUCCESS) {
+		pr_warn("Failed to register vCPU preempted state\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int pv_sched_cpu_down_prepare(unsigned int cpu)
+{
+	pv_sched_release(NULL);
+	return 0;
+}
+
+/* the host must not write into the next kernel's memory after a kexec */
+static int pv_sched_reboot_notify(struct notifier_block *nb,
+				  unsigned long code, void *unused)
+{
+	on_each_cpu(pv_sched_release, NULL, 1);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block pv_sched_reboot_nb = {
+	.notifier_call = pv_sched_reboot_notify,
+};
+
+int __init pv_sched_init(void)
+{
+	int ret;
+
+	if (!kvm_arm_hyp_service_available(ARM_SMCCC_KVM_FUNC_PV_SCHED))
+		return 0;
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN,
+				"hypervisor/arm/pvsched:online",
+				pv_sched_cpu_online,
+				pv_sched_cpu_down_prepare);
+	if (ret < 0)
+		return ret;
+
+	register_reboot_notifier(&pv_sched_reboot_nb);
+	pv_preempted = true;
+
+	pr_info("using vCPU preempted PV\n");
+
+	return 0;
+}
@@ -527,15 +527,53 @@ void update_sctlr_el1(u64 sctlr)
  * IMPDEF control register ACTLR_EL1 handling. Some CPUs use this to
  * expose features that can be controlled by userspace.
  */
+static DEFINE_PER_CPU(u64, actlr_el1);
+
+static int actlr_cpu_online(unsigned int cpu)
+{
+	__this_cpu_write(actlr_el1, read_sysreg(actlr_el1));
+	return 0;
+}
+
+static int __init actlr_cpuhp_init(void)
+{
+	int ret;
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "arm64/actlr:online",
+				actlr_cpu_online, NULL);
+	return ret < 0 ? ret : 0;
+}
+early_initcall(actlr_cpuhp_init);
+
+static void actlr_write(u64 actlr)
+{
+	if (__this_cpu_read(actlr_el1) == actlr)
+		return;
+
+	write_sysreg(actlr, actlr_el1);
+	__this_cpu_write(actlr_el1, actlr);
+}
+
 static void actlr_thread_switch(struct task_struct *next)
 {
 	if (!system_has_actlr_state())
 		return;
 
-	current->thread.actlr = read_sysreg(actlr_el1);
-	write_sysreg(next->thread.actlr, actlr_el1);
+	/*
+	 * Compare against the per-CPU copy of the register rather than the
+	 * outgoing task, so a value changed behind our back (CPU reset on
+	 * hotplug, firmware) is not mistaken for the right one. Most switches
+	 * are between tasks using the same memory model, so this skips the
+	 * IMPDEF register write.
+	 */
+	actlr_write(next->thread.actlr);
 }
 #else
+static inline void actlr_write(u64 actlr)
+{
+	write_sysreg(actlr, actlr_el1);
+}
+
 static inline void actlr_thread_switch(struct task_struct *next)
 {
 }
@@ -569,7 +607,9 @@ int arch_prctl_mem_model_set(struct task_struct *t, unsigned long val)
 		default:
 			return -EINVAL;
 		}
-		write_sysreg(t->thread.actlr, actlr_el1);
+		preempt_disable();
+		actlr_write(t->thread.actlr);
+		preempt_enable();
 		return 0;
 	}
 
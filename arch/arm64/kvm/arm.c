@@ -443,6 +443,7 @@ void kvm_arch_vcpu_load(struct kvm_vcpu *vcpu, int cpu)
 	kvm_vcpu_pmu_restore_guest(vcpu);
 	if (kvm_arm_is_pvtime_enabled(&vcpu->arch))
 		kvm_make_request(KVM_REQ_RECORD_STEAL, vcpu);
+	kvm_update_pv_preempted(vcpu, false);
 
 	if (single_task_running())
 		vcpu_clear_wfx_traps(vcpu);
@@ -468,6 +469,10 @@ void kvm_arch_vcpu_put(struct kvm_vcpu *vcpu)
 	kvm_vcpu_pmu_restore_host(vcpu);
 	kvm_arm_vmid_clear_active();
 
+	/* only tell the guest when the vCPU was scheduled out while runnable */
+	if (READ_ONCE(vcpu->preempted))
+		kvm_update_pv_preempted(vcpu, true);
+
 	vcpu_clear_on_unsupported_cpu(vcpu);
 	vcpu->cpu = -1;
 }
@@ -1279,6 +1279,72 @@ int kvm_pgtable_stage2_flush(struct kvm_pgtable *pgt, u64 addr, u64 size)
 	return kvm_pgtable_walk(pgt, addr, size, &walker);
 }
 
+struct stage2_split_data {
+	struct kvm_s2_mmu		*mmu;
+	struct kvm_mmu_memory_cache	*memcache;
+};
+
+/*
+ * Replace a block mapping with a table of the next level mapping the same
+ * output range with the same attributes. The walker then descends into the
+ * new table and splits its entries in turn, until only pages are left.
+ */
+static int stage2_split_walker(const struct kvm_pgtable_visit_ctx *ctx,
+			       enum kvm_pgtable_walk_flags visit)
+{
+	struct stage2_split_data *data = ctx->arg;
+	struct kvm_pgtable_mm_ops *mm_ops = ctx->mm_ops;
+	u64 phys, granule;
+	kvm_pte_t *childp;
+	int i, nr;
+
+	if (!kvm_pte_valid(ctx->old) ||
+	    ctx->level == KVM_PGTABLE_MAX_LEVELS - 1)
+		return 0;
+
+	if (!data->memcache->nobjs)
+		return -ENOMEM;
+
+	childp = mm_ops->zalloc_page(data->memcache);
+	if (!childp)
+		return -ENOMEM;
+
+	if (!stage2_try_break_pte(ctx, data->mmu)) {
+		mm_ops->put_page(childp);
+		return -EAGAIN;
+	}
+
+	phys = kvm_pte_to_phys(ctx->old);
+	granule = kvm_granule_size(ctx->level + 1);
+	nr = kvm_granule_size(ctx->level) / granule;
+	for (i = 0; i < nr; i++) {
+		childp[i] = kvm_init_valid_leaf_pte(phys + i * granule,
+						    ctx->old, ctx->level + 1);
+		mm_ops->get_page(childp);
+	}
+
+	stage2_make_pte(ctx, kvm_init_table_pte(childp, mm_ops));
+	return 0;
+}
+
+int kvm_pgtable_stage2_split(struct kvm_pgtable *pgt, u64 addr, u64 size,
+			     struct kvm_mmu_memory_cache *mc)
+{
+	struct stage2_split_data split_data = {
+		.mmu		= pgt->mmu,
+		.memcache	= mc,
+	};
+	struct kvm_pgtable_walker walker = {
+		.cb	= stage2_split_walker,
+		.flags	= KVM_PGTABLE_WALK_LEAF,
+		.arg	= &split_data,
+	};
+	int ret;
+
+	ret = kvm_pgtable_walk(pgt, addr, size, &walker);
+	dsb(ishst);
+	return ret;
+}
 
 int __kvm_pgtable_stage2_init(struct kvm_pgtable *pgt, struct kvm_s2_mmu *mmu,
 			      struct kvm_pgtable_mm_ops *mm_ops,
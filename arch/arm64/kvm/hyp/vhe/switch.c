@@ -7,6 +7,7 @@
 #include <hyp/switch.h>
 
 #include <linux/arm-smccc.h>
+#include <linux/context_tracking.h>
 #include <linux/kvm_host.h>
 #include <linux/types.h>
 #include <linux/jump_label.h>
@@ -116,10 +117,52 @@ void deactivate_traps_vhe_put(struct kvm_vcpu *vcpu)
 	local_irq_restore(flags);
 }
 
+/*
+ * Without GICv4.1 every guest IPI traps on ICC_SGI1R_EL1. With VHE the vgic
+ * can be driven right here, so an SGI that only targets other vCPUs is
+ * queued and kicked without the exit to the run loop and the vgic and timer
+ * sync and flush that comes with it. An SGI to the calling vCPU still takes
+ * the full exit, as it has to be flushed into the list registers.
+ *
+ * This relies on RCU watching this CPU, which is not the case while a
+ * nohz_full CPU is in guest context.
+ */
+static bool kvm_hyp_handle_sgi_vhe(struct kvm_vcpu *vcpu)
+{
+	u64 esr = kvm_vcpu_get_esr(vcpu);
+	struct kvm *kvm = vcpu->kvm;
+	u64 val;
+
+	if (esr_sys64_to_sysreg(esr) != SYS_ICC_SGI1R_EL1 ||
+	    (esr & ESR_ELx_SYS64_ISS_DIR_MASK) != ESR_ELx_SYS64_ISS_DIR_WRITE)
+		return false;
+
+	if (vcpu_has_nv(vcpu) || context_tracking_enabled_this_cpu())
+		return false;
+
+	if (kvm->arch.vgic.vgic_model != KVM_DEV_TYPE_ARM_VGIC_V3 ||
+	    !vgic_initialized(kvm) || kvm->arch.vgic.nassgireq)
+		return false;
+
+	val = vcpu_get_reg(vcpu, kvm_vcpu_sys_get_rt(vcpu));
+	if (vgic_v3_sgi_targets_self(vcpu, val))
+		return false;
+
+	vgic_v3_dispatch_sgi(vcpu, val, true);
+	__kvm_skip_instr(vcpu);
+	return true;
+}
+
+static bool kvm_hyp_handle_sysreg_vhe(struct kvm_vcpu *vcpu, u64 *exit_code)
+{
+	return kvm_hyp_handle_sgi_vhe(vcpu) ||
+	       kvm_hyp_handle_sysreg(vcpu, exit_code);
+}
+
 static const exit_handler_fn hyp_exit_handlers[] = {
 	[0 ... ESR_ELx_EC_MAX]		= NULL,
 	[ESR_ELx_EC_CP15_32]		= kvm_hyp_handle_cp15_32,
-	[ESR_ELx_EC_SYS64]		= kvm_hyp_handle_sysreg,
+	[ESR_ELx_EC_SYS64]		= kvm_hyp_handle_sysreg_vhe,
 	[ESR_ELx_EC_SVE]		= kvm_hyp_handle_fpsimd,
 	[ESR_ELx_EC_FP_ASIMD]		= kvm_hyp_handle_fpsimd,
 	[ESR_ELx_EC_IABT_LOW]		= kvm_hyp_handle_iabt_low,
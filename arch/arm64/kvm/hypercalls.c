@@ -116,6 +116,9 @@ static bool kvm_smccc_test_fw_bmap(struct kvm_vcpu *vcpu, u32 func_id)
 	case ARM_SMCCC_VENDOR_HYP_KVM_PTP_FUNC_ID:
 		return test_bit(KVM_REG_ARM_VENDOR_HYP_BIT_PTP,
 				&smccc_feat->vendor_hyp_bmap);
+	case ARM_SMCCC_VENDOR_HYP_KVM_PV_SCHED_FUNC_ID:
+		return test_bit(KVM_REG_ARM_VENDOR_HYP_BIT_PV_SCHED,
+				&smccc_feat->vendor_hyp_bmap);
 	default:
 		return false;
 	}
@@ -349,11 +352,21 @@ int kvm_smccc_call_handler(struct kvm_vcpu *vcpu)
 		val[3] = ARM_SMCCC_VENDOR_HYP_UID_KVM_REG_3;
 		break;
 	case ARM_SMCCC_VENDOR_HYP_KVM_FEATURES_FUNC_ID:
-		val[0] = smccc_feat->vendor_hyp_bmap;
+		/* the bitmap bits match the function ids only up to PTP */
+		val[0] = smccc_feat->vendor_hyp_bmap &
+			 (BIT(KVM_REG_ARM_VENDOR_HYP_BIT_FUNC_FEAT) |
+			  BIT(KVM_REG_ARM_VENDOR_HYP_BIT_PTP));
+		if (test_bit(KVM_REG_ARM_VENDOR_HYP_BIT_PV_SCHED,
+			     &smccc_feat->vendor_hyp_bmap))
+			val[ARM_SMCCC_KVM_FUNC_PV_SCHED / 32] |=
+				BIT(ARM_SMCCC_KVM_FUNC_PV_SCHED % 32);
 		break;
 	case ARM_SMCCC_VENDOR_HYP_KVM_PTP_FUNC_ID:
 		kvm_ptp_get_time(vcpu, val);
 		break;
+	case ARM_SMCCC_VENDOR_HYP_KVM_PV_SCHED_FUNC_ID:
+		val[0] = kvm_hypercall_pv_sched(vcpu);
+		break;
 	case ARM_SMCCC_TRNG_VERSION:
 	case ARM_SMCCC_TRNG_FEATURES:
 	case ARM_SMCCC_TRNG_GET_UUID:
@@ -957,6 +957,43 @@ static void stage2_wp_range(struct kvm_s2_mmu *mmu, phys_addr_t addr, phys_addr_
 	stage2_apply_range_resched(mmu, addr, end, kvm_pgtable_stage2_wrprotect);
 }
 
+/*
+ * Split the block mappings of @start..@end into pages, one chunk at a time
+ * with the mmu_lock held for write, so that later dirty-logging write
+ * faults only have to relax the permissions of a page instead of
+ * splitting a block. The lock is dropped between chunks to refill the
+ * cache and to let vCPUs make progress. Failing to split is not fatal,
+ * the remaining blocks are split lazily on fault.
+ */
+static void kvm_mmu_split_range(struct kvm *kvm, phys_addr_t start,
+				phys_addr_t end)
+{
+	struct kvm_mmu_memory_cache cache = { .gfp_zero = __GFP_ZERO };
+	int min = kvm_mmu_cache_min_pages(kvm);
+	u64 chunk = kvm_granule_size(KVM_PGTABLE_MAX_LEVELS - 2);
+	phys_addr_t addr, next;
+	int ret = 0;
+
+	for (addr = start; addr < end && !ret; addr = next) {
+		next = min_t(phys_addr_t, ALIGN_DOWN(addr + chunk, chunk), end);
+
+		if (cache.nobjs < min) {
+			ret = kvm_mmu_topup_memory_cache(&cache, min);
+			if (ret)
+				break;
+		}
+
+		write_lock(&kvm->mmu_lock);
+		if (kvm->arch.mmu.pgt)
+			ret = kvm_pgtable_stage2_split(kvm->arch.mmu.pgt, addr,
+						       next - addr, &cache);
+		write_unlock(&kvm->mmu_lock);
+		cond_resched();
+	}
+
+	kvm_mmu_free_memory_cache(&cache);
+}
+
 /**
  * kvm_mmu_wp_memory_region() - write protect stage 2 entries for memory slot
  * @kvm:	The KVM pointer
@@ -982,6 +1019,10 @@ static void kvm_mmu_wp_memory_region(struct kvm *kvm, int slot)
 	start = memslot->base_gfn << PAGE_SHIFT;
 	end = (memslot->base_gfn + memslot->npages) << PAGE_SHIFT;
 
+	/* pKVM owns the guest stage-2 and splits on its own */
+	if (!is_protected_kvm_enabled())
+		kvm_mmu_split_range(kvm, start, end);
+
 	write_lock(&kvm->mmu_lock);
 	stage2_wp_range(&kvm->arch.mmu, start, end);
 	write_unlock(&kvm->mmu_lock);
@@ -1212,6 +1253,106 @@ static bool kvm_vma_mte_allowed(struct vm_area_struct *vma)
 	return vma->vm_flags & VM_MTE_ALLOWED;
 }
 
+/*
+ * On a translation fault that ends up as a single page mapping, the
+ * neighbouring pages in an aligned window of this size are mapped as well
+ * if they are already present and writable in the host page tables. A
+ * guest using a smaller granule than the host touches several guest pages
+ * per host page, and the following ones are very likely to be touched
+ * next, so this saves a stage-2 fault for each.
+ */
+#define KVM_S2_FAULT_AROUND_PAGES	(SZ_64K >> PAGE_SHIFT)
+
+static bool stage2_fault_around_allowed(struct kvm *kvm,
+					unsigned long fault_status,
+					bool logging_active, bool device)
+{
+	if (KVM_S2_FAULT_AROUND_PAGES <= 1)
+		return false;
+	if (fault_status != ESR_ELx_FSC_FAULT || logging_active || device)
+		return false;
+	/* neighbours would need their tags sanitised and be logged dirty */
+	return !kvm_has_mte(kvm) && !kvm->dirty_ring_size;
+}
+
+/*
+ * Look up the pages around @gfn without sleeping. Slots that cannot be
+ * mapped are left as KVM_PFN_NOSLOT. Must be called before the
+ * mmu_invalidate_retry() check that also covers the faulting page.
+ */
+static void stage2_fault_around_get(struct kvm_memory_slot *memslot,
+				    gfn_t gfn, kvm_pfn_t *pfns)
+{
+	gfn_t start = ALIGN_DOWN(gfn, KVM_S2_FAULT_AROUND_PAGES);
+	int i;
+
+	for (i = 0; i < KVM_S2_FAULT_AROUND_PAGES; i++) {
+		gfn_t g = start + i;
+		bool writable = false;
+		kvm_pfn_t pfn;
+
+		pfns[i] = KVM_PFN_NOSLOT;
+		if (g == gfn || g < memslot->base_gfn ||
+		    g >= memslot->base_gfn + memslot->npages)
+			continue;
+
+		pfn = __gfn_to_pfn_memslot(memslot, g, true, false, NULL,
+					   false, &writable, NULL);
+		if (is_error_noslot_pfn(pfn))
+			continue;
+		if (!writable || kvm_is_device_pfn(pfn)) {
+			kvm_release_pfn_clean(pfn);
+			continue;
+		}
+		pfns[i] = pfn;
+	}
+}
+
+/* Called with the mmu_lock held for read after the faulting page was mapped */
+static void stage2_fault_around_map(struct kvm *kvm, struct kvm_pgtable *pgt,
+				    struct kvm_memory_slot *memslot, gfn_t gfn,
+				    kvm_pfn_t *pfns)
+{
+	enum kvm_pgtable_prot prot = KVM_PGTABLE_PROT_R | KVM_PGTABLE_PROT_W;
+	gfn_t start = ALIGN_DOWN(gfn, KVM_S2_FAULT_AROUND_PAGES);
+	int i;
+
+	if (cpus_have_const_cap(ARM64_HAS_CACHE_DIC))
+		prot |= KVM_PGTABLE_PROT_X;
+
+	for (i = 0; i < KVM_S2_FAULT_AROUND_PAGES; i++) {
+		if (pfns[i] == KVM_PFN_NOSLOT)
+			continue;
+
+		/*
+		 * The window lies within the last level table of the faulting
+		 * page, so no table page is allocated. An existing mapping
+		 * makes this fail with -EAGAIN, which is fine.
+		 */
+		if (kvm_pgtable_stage2_map(pgt, (start + i) << PAGE_SHIFT,
+					   PAGE_SIZE, __pfn_to_phys(pfns[i]),
+					   prot, NULL,
+					   KVM_PGTABLE_WALK_HANDLE_FAULT |
+					   KVM_PGTABLE_WALK_SHARED))
+			continue;
+
+		kvm_set_pfn_dirty(pfns[i]);
+		mark_page_dirty_in_slot(kvm, memslot, start + i);
+	}
+}
+
+static void stage2_fault_around_put(kvm_pfn_t *pfns)
+{
+	int i;
+
+	for (i = 0; i < KVM_S2_FAULT_AROUND_PAGES; i++) {
+		if (pfns[i] == KVM_PFN_NOSLOT)
+			continue;
+		kvm_set_pfn_accessed(pfns[i]);
+		kvm_release_pfn_clean(pfns[i]);
+	}
+}
+
 static int user_mem_abort(struct kvm_vcpu *vcpu, phys_addr_t fault_ipa,
 			  struct kvm_memory_slot *memslot, unsigned long hva,
 			  unsigned long fault_status)
@@ -1232,6 +1373,8 @@ static int user_mem_abort(struct kvm_vcpu *vcpu, phys_addr_t fault_ipa,
 	long vma_pagesize, fault_granule;
 	enum kvm_pgtable_prot prot = KVM_PGTABLE_PROT_R;
 	struct kvm_pgtable *pgt;
+	kvm_pfn_t around[KVM_S2_FAULT_AROUND_PAGES];
+	bool fault_around;
 
 	fault_granule = 1UL << ARM64_HW_PGTABLE_LEVEL_SHIFT(fault_level);
 	write_fault = kvm_is_write_fault(vcpu);
@@ -1357,6 +1500,11 @@ static int user_mem_abort(struct kvm_vcpu *vcpu, phys_addr_t fault_ipa,
 	if (exec_fault && device)
 		return -ENOEXEC;
 
+	fault_around = stage2_fault_around_allowed(kvm, fault_status,
+						   logging_active, device);
+	if (fault_around)
+		stage2_fault_around_get(memslot, gfn, around);
+
 	read_lock(&kvm->mmu_lock);
 	pgt = vcpu->arch.hw_mmu->pgt;
 	if (mmu_invalidate_retry(kvm, mmu_seq))
@@ -1422,8 +1570,13 @@ static int user_mem_abort(struct kvm_vcpu *vcpu, phys_addr_t fault_ipa,
 		mark_page_dirty_in_slot(kvm, memslot, gfn);
 	}
 
+	if (fault_around && !ret && vma_pagesize == PAGE_SIZE)
+		stage2_fault_around_map(kvm, pgt, memslot, gfn, around);
+
 out_unlock:
 	read_unlock(&kvm->mmu_lock);
+	if (fault_around)
+		stage2_fault_around_put(around);
 	kvm_set_pfn_accessed(pfn);
 	kvm_release_pfn_clean(pfn);
 	return ret != -EAGAIN ? ret : 0;
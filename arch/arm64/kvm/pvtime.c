@@ -7,6 +7,7 @@
 
 #include <asm/kvm_mmu.h>
 #include <asm/pvclock-abi.h>
+#include <asm/pvsched-abi.h>
 
 #include <kvm/arm_hypercalls.h>
 
@@ -32,6 +33,70 @@ void kvm_update_stolen_time(struct kvm_vcpu *vcpu)
 	srcu_read_unlock(&kvm->srcu, idx);
 }
 
+/*
+ * Called from the preempt notifiers, so the shared structure is written
+ * without sleeping. If the page is not present the update is skipped,
+ * the flag is only a hint for the guest's spinning decisions.
+ */
+void kvm_update_pv_preempted(struct kvm_vcpu *vcpu, bool preempted)
+{
+	struct kvm *kvm = vcpu->kvm;
+	u64 base = vcpu->arch.pv_sched.base;
+	u64 offset = offsetof(struct pvsched_vcpu_state, preempted);
+	__le32 __user *uaddr;
+	unsigned long hva;
+	int idx, ret;
+
+	if (base == INVALID_GPA || vcpu->arch.pv_sched.preempted == preempted)
+		return;
+
+	idx = srcu_read_lock(&kvm->srcu);
+	hva = gfn_to_hva(kvm, gpa_to_gfn(base));
+	if (!kvm_is_error_hva(hva)) {
+		uaddr = (__le32 __user *)(hva + offset_in_page(base) + offset);
+
+		pagefault_disable();
+		ret = __put_user(cpu_to_le32(preempted), uaddr);
+		pagefault_enable();
+
+		if (!ret) {
+			vcpu->arch.pv_sched.preempted = preempted;
+			mark_page_dirty(kvm, gpa_to_gfn(base));
+		}
+	}
+	srcu_read_unlock(&kvm->srcu, idx);
+}
+
+long kvm_hypercall_pv_sched(struct kvm_vcpu *vcpu)
+{
+	struct pvsched_vcpu_state init_values = {};
+	struct kvm *kvm = vcpu->kvm;
+	u64 ipa = smccc_get_arg2(vcpu);
+	int idx, ret;
+
+	switch (smccc_get_arg1(vcpu)) {
+	case KVM_PV_SCHED_IPA_INIT:
+		if (!IS_ALIGNED(ipa, 64))
+			return SMCCC_RET_INVALID_PARAMETER;
+
+		idx = srcu_read_lock(&kvm->srcu);
+		ret = kvm_write_guest(kvm, ipa, &init_values,
+				      sizeof(init_values));
+		srcu_read_unlock(&kvm->srcu, idx);
+		if (ret)
+			return SMCCC_RET_INVALID_PARAMETER;
+
+		vcpu->arch.pv_sched.preempted = false;
+		vcpu->arch.pv_sched.base = ipa;
+		return SMCCC_RET_SUCCESS;
+	case KVM_PV_SCHED_IPA_RELEASE:
+		vcpu->arch.pv_sched.base = INVALID_GPA;
+		return SMCCC_RET_SUCCESS;
+	}
+
+	return SMCCC_RET_INVALID_PARAMETER;
+}
+
 long kvm_hypercall_pv_features(struct kvm_vcpu *vcpu)
 {
 	u32 feature = smccc_get_arg1(vcpu);
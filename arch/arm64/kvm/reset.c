@@ -335,6 +335,9 @@ int kvm_reset_vcpu(struct kvm_vcpu *vcpu)
 	/* Reset system registers */
 	kvm_reset_sys_regs(vcpu);
 
+	/* A fresh guest has to register its PV scheduling state again */
+	vcpu->arch.pv_sched.base = INVALID_GPA;
+
 	/*
 	 * Additional reset state handling that PSCI may have imposed on us.
 	 * Must be done after all the sys_reg reset.
@@ -1052,6 +1052,32 @@ static int match_mpidr(u64 sgi_aff, u16 sgi_cpu_mask, struct kvm_vcpu *vcpu)
 	((((reg) & ICC_SGI1R_AFFINITY_## level ##_MASK) \
 	>> ICC_SGI1R_AFFINITY_## level ##_SHIFT) << MPIDR_LEVEL_SHIFT(level))
 
+/**
+ * vgic_v3_sgi_targets_self - check if an SGI request signals the caller
+ * @vcpu: The VCPU requesting a SGI
+ * @reg: The value written into ICC_SGI1R by that VCPU
+ *
+ * A request that does not signal @vcpu only changes the state of other
+ * VCPUs, so it can be dispatched without leaving the run loop of @vcpu.
+ */
+bool vgic_v3_sgi_targets_self(struct kvm_vcpu *vcpu, u64 reg)
+{
+	u16 target_cpus;
+	u64 mpidr;
+
+	/* the broadcast routing mode excludes the calling VCPU */
+	if (reg & BIT_ULL(ICC_SGI1R_IRQ_ROUTING_MODE_BIT))
+		return false;
+
+	target_cpus = (reg & ICC_SGI1R_TARGET_LIST_MASK) >>
+		      ICC_SGI1R_TARGET_LIST_SHIFT;
+	mpidr = SGI_AFFINITY_LEVEL(reg, 3);
+	mpidr |= SGI_AFFINITY_LEVEL(reg, 2);
+	mpidr |= SGI_AFFINITY_LEVEL(reg, 1);
+
+	return match_mpidr(mpidr, target_cpus, vcpu) != -1;
+}
+
 /**
  * vgic_v3_dispatch_sgi - handle SGI requests from VCPUs
  * @vcpu: The VCPU requesting a SGI
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Transparent contiguous-PTE folding for user mappings of large folios.
+ *
+ * Copyright The Asahi Linux Contributors
+ */
+
+#include <linux/export.h>
+#include <linux/mm.h>
+#include <linux/pgtable.h>
+
+#include <asm/tlbflush.h>
+
+/*
+ * Rewrite a whole block with break-before-make, accumulating the access and
+ * dirty state of every entry into the new ones. @ptep and @addr point at the
+ * first entry of the block and @pte carries the contiguous state wanted.
+ */
+static void contpte_convert(struct mm_struct *mm, unsigned long addr,
+			    pte_t *ptep, pte_t pte)
+{
+	struct vm_area_struct vma = TLB_FLUSH_VMA(mm, 0);
+	unsigned long pfn = ALIGN_DOWN(pte_pfn(pte), CONT_PTES);
+	pgprot_t prot;
+	int i;
+
+	for (i = 0; i < CONT_PTES; i++) {
+		pte_t old = __pte(xchg_relaxed(&pte_val(ptep[i]), 0));
+
+		if (pte_dirty(old))
+			pte = pte_mkdirty(pte);
+		if (pte_young(old))
+			pte = pte_mkyoung(pte);
+	}
+
+	__flush_tlb_range(&vma, addr, addr + CONT_PTE_SIZE, PAGE_SIZE, true, 3);
+
+	prot = pte_pgprot(pte);
+	for (i = 0; i < CONT_PTES; i++)
+		set_pte(ptep + i, pfn_pte(pfn + i, prot));
+}
+
+void __contpte_try_fold(struct mm_struct *mm, unsigned long addr,
+			pte_t *ptep, pte_t pte)
+{
+	unsigned long pfn = pte_pfn(pte);
+	unsigned long start_pfn = pfn - (CONT_PTES - 1);
+	pte_t *start_ptep = ptep - (CONT_PTES - 1);
+	struct folio *folio;
+	pgprot_t prot;
+	int i;
+
+	/* A folded entry must never need a hardware access/dirty update */
+	if (pte_special(pte) || pte_devmap(pte) || !pte_young(pte) ||
+	    (pte_write(pte) && !pte_dirty(pte)))
+		return;
+
+	if (!pfn_valid(start_pfn))
+		return;
+
+	folio = page_folio(pfn_to_page(pfn));
+	if (folio_test_hugetlb(folio) || folio_nr_pages(folio) < CONT_PTES ||
+	    start_pfn < folio_pfn(folio))
+		return;
+
+	prot = pte_pgprot(pte);
+	for (i = 0; i < CONT_PTES - 1; i++) {
+		if (pte_val(READ_ONCE(start_ptep[i])) !=
+		    pte_val(pfn_pte(start_pfn + i, prot)))
+			return;
+	}
+
+	contpte_convert(mm, addr & CONT_PTE_MASK, start_ptep, pte_mkcont(pte));
+}
+EXPORT_SYMBOL_GPL(__contpte_try_fold);
+
+void __contpte_try_unfold(struct mm_struct *mm, unsigned long addr,
+			  pte_t *ptep, pte_t pte)
+{
+	unsigned long start_addr = addr & CONT_PTE_MASK;
+
+	ptep -= (addr - start_addr) >> PAGE_SHIFT;
+	contpte_convert(mm, start_addr, ptep, pte_mknoncont(pte));
+}
+EXPORT_SYMBOL_GPL(__contpte_try_unfold);
@@ -1140,6 +1140,89 @@ int __meminit vmemmap_check_pmd(pmd_t *pmdp, int node,
 	return 1;
 }
 
+#ifdef CONFIG_HUGETLB_PAGE_OPTIMIZE_VMEMMAP
+/*
+ * HVO changes the output address of live vmemmap entries, which requires
+ * break-before-make. Other CPUs may still look at the struct pages behind an
+ * entry while it is invalid (pfn walkers, speculative page references), so
+ * the update is done under vmemmap_bbm_lock and vmemmap_fault_fixup() makes
+ * a translation fault on the vmemmap wait for it instead of oopsing.
+ */
+static DEFINE_RAW_SPINLOCK(vmemmap_bbm_lock);
+
+void vmemmap_update_pmd(unsigned long addr, pmd_t *pmdp, pte_t *ptep)
+{
+	unsigned long flags;
+
+	addr &= PMD_MASK;
+
+	raw_spin_lock_irqsave(&vmemmap_bbm_lock, flags);
+	pmd_clear(pmdp);
+	flush_tlb_kernel_range(addr, addr + PMD_SIZE);
+	pmd_populate_kernel(&init_mm, pmdp, ptep);
+	raw_spin_unlock_irqrestore(&vmemmap_bbm_lock, flags);
+}
+
+void vmemmap_update_pte(unsigned long addr, pte_t *ptep, pte_t pte)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&vmemmap_bbm_lock, flags);
+	pte_clear(&init_mm, addr, ptep);
+	flush_tlb_kernel_range(addr, addr + PAGE_SIZE);
+	set_pte_at(&init_mm, addr, ptep, pte);
+	raw_spin_unlock_irqrestore(&vmemmap_bbm_lock, flags);
+}
+
+/*
+ * Called for kernel translation faults. Returns true if @addr is in the
+ * vmemmap and is mapped again once any break-before-make in progress has
+ * completed, in which case the faulting access can simply be retried.
+ */
+bool vmemmap_fault_fixup(unsigned long addr)
+{
+	unsigned long flags;
+	bool valid = false;
+	p4d_t *p4dp;
+	pud_t *pudp, pud;
+	pmd_t *pmdp, pmd;
+	pte_t *ptep;
+
+	if (addr < VMEMMAP_START || addr >= VMEMMAP_END)
+		return false;
+
+	raw_spin_lock_irqsave(&vmemmap_bbm_lock, flags);
+
+	p4dp = p4d_offset(pgd_offset_k(addr), addr);
+	if (p4d_none(READ_ONCE(*p4dp)))
+		goto out;
+
+	pudp = pud_offset(p4dp, addr);
+	pud = READ_ONCE(*pudp);
+	if (pud_none(pud))
+		goto out;
+	if (pud_sect(pud)) {
+		valid = true;
+		goto out;
+	}
+
+	pmdp = pmd_offset(pudp, addr);
+	pmd = READ_ONCE(*pmdp);
+	if (pmd_none(pmd))
+		goto out;
+	if (pmd_sect(pmd)) {
+		valid = true;
+		goto out;
+	}
+
+	ptep = pte_offset_kernel(pmdp, addr);
+	valid = pte_valid(READ_ONCE(*ptep));
+out:
+	raw_spin_unlock_irqrestore(&vmemmap_bbm_lock, flags);
+	return valid;
+}
+#endif
+
 int __meminit vmemmap_populate(unsigned long start, unsigned long end, int node,
 		struct vmem_altmap *altmap)
 {
@@ -13,8 +13,33 @@
 #include "blk-mq-sched.h"
 #include "blk-rq-qos.h"
 
+static void print_poll_bucket(struct seq_file *m,
+			      struct blk_mq_poll_hybrid *ph, int bucket)
+{
+	seq_printf(m, "target=%llu, mean=%llu, min=%llu",
+		   READ_ONCE(ph->target_ns[bucket]),
+		   READ_ONCE(ph->mean_ns[bucket]),
+		   READ_ONCE(ph->min_ns[bucket]));
+}
+
 static int queue_poll_stat_show(void *data, struct seq_file *m)
 {
+	struct request_queue *q = data;
+	struct blk_mq_poll_hybrid *ph = q->poll_hybrid;
+	int bucket;
+
+	if (!ph)
+		return 0;
+
+	for (bucket = 0; bucket < BLK_MQ_POLL_STATS_BKTS / 2; bucket++) {
+		seq_printf(m, "read  (%d Bytes): ", 1 << (9 + bucket));
+		print_poll_bucket(m, ph, 2 * bucket);
+		seq_puts(m, "\n");
+
+		seq_printf(m, "write (%d Bytes): ", 1 << (9 + bucket));
+		print_poll_bucket(m, ph, 2 * bucket + 1);
+		seq_puts(m, "\n");
+	}
 	return 0;
 }
 
@@ -96,6 +121,7 @@ static const char *const blk_queue_flag_name[] = {
 	QUEUE_FLAG_NAME(FUA),
 	QUEUE_FLAG_NAME(DAX),
 	QUEUE_FLAG_NAME(STATS),
+	QUEUE_FLAG_NAME(POLL_STATS),
 	QUEUE_FLAG_NAME(REGISTERED),
 	QUEUE_FLAG_NAME(QUIESCED),
 	QUEUE_FLAG_NAME(PCI_P2PDMA),
@@ -253,6 +279,7 @@ static const char *const rqf_name[] = {
 	RQF_NAME(PM),
 	RQF_NAME(HASHED),
 	RQF_NAME(STATS),
+	RQF_NAME(MQ_POLL_SLEPT),
 	RQF_NAME(SPECIAL_PAYLOAD),
 	RQF_NAME(ZONE_WRITE_LOCKED),
 	RQF_NAME(TIMED_OUT),
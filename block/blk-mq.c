@@ -47,16 +47,31 @@ static DEFINE_PER_CPU(struct llist_head, blk_cpu_done);
 static void blk_mq_insert_request(struct request *rq, blk_insert_t flags);
 static void blk_mq_try_issue_list_directly(struct blk_mq_hw_ctx *hctx,
 		struct list_head *list);
+static void blk_mq_poll_hybrid_free(struct request_queue *q);
+
+/*
+ * The poll cookie carries the hardware queue number in the upper half and
+ * the driver tag in the lower one, so that hybrid polling can find the
+ * request it is waiting for.
+ */
+#define BLK_QC_T_SHIFT		16
+#define BLK_QC_T_TAG_MASK	((1U << BLK_QC_T_SHIFT) - 1)
 
 static inline struct blk_mq_hw_ctx *blk_qc_to_hctx(struct request_queue *q,
 		blk_qc_t qc)
 {
-	return xa_load(&q->hctx_table, qc);
+	return xa_load(&q->hctx_table, qc >> BLK_QC_T_SHIFT);
+}
+
+static inline unsigned int blk_qc_to_tag(blk_qc_t qc)
+{
+	return qc & BLK_QC_T_TAG_MASK;
 }
 
 static inline blk_qc_t blk_rq_to_qc(struct request *rq)
 {
-	return rq->mq_hctx->queue_num;
+	return (rq->mq_hctx->queue_num << BLK_QC_T_SHIFT) |
+		(rq->tag & BLK_QC_T_TAG_MASK);
 }
 
 /*
@@ -4037,6 +4052,8 @@ void blk_mq_release(struct request_queue *q)
 
 	xa_destroy(&q->hctx_table);
 
+	blk_mq_poll_hybrid_free(q);
+
 	/*
 	 * release .mq_kobj and sw queue's kobject now because
 	 * both share lifetime with request queue.
@@ -4246,6 +4263,7 @@ int blk_mq_init_allocated_queue(struct blk_mq_tag_set *set,
 
 	q->queue_flags |= QUEUE_FLAG_MQ_DEFAULT;
 	blk_mq_update_poll_flag(q);
+	q->poll_nsec = BLK_MQ_POLL_CLASSIC;
 
 	INIT_DELAYED_WORK(&q->requeue_work, blk_mq_requeue_work);
 	INIT_LIST_HEAD(&q->requeue_list);
@@ -4760,24 +4778,272 @@ void blk_mq_update_nr_hw_queues(struct blk_mq_tag_set *set, int nr_hw_queues)
 }
 EXPORT_SYMBOL_GPL(blk_mq_update_nr_hw_queues);
 
-int blk_mq_poll(struct request_queue *q, blk_qc_t cookie, struct io_comp_batch *iob,
-		unsigned int flags)
+/*
+ * Hybrid polling: instead of spinning from the moment a request was issued,
+ * sleep on an hrtimer until shortly before it is expected to complete and only
+ * spin from then on. q->poll_nsec selects the mode through the io_poll_delay
+ * queue attribute: BLK_MQ_POLL_CLASSIC always spins, a positive value sleeps
+ * for that many nanoseconds and 0 learns the sleep time per request size and
+ * direction.
+ *
+ * The adaptive mode starts out sleeping for half the mean completion latency
+ * of a bucket. A sleep that ends with the completion already posted shortens
+ * the sleep of that bucket by an eighth, one that has to spin lengthens it by
+ * half of the time spun. The resulting sleep never exceeds the fastest
+ * completion seen in the last stats window, so a burst of slow completions
+ * can't push it past the latency the device actually delivers.
+ */
+#define BLK_MQ_POLL_STATS_MSECS		100
+/* Don't bother arming a timer for less than this */
+#define BLK_MQ_POLL_MIN_SLEEP_NS	(2 * NSEC_PER_USEC)
+
+static int blk_mq_poll_stats_bkt(const struct request *rq)
+{
+	int ddir, sectors, bucket;
+
+	ddir = rq_data_dir(rq);
+	sectors = blk_rq_stats_sectors(rq);
+
+	bucket = ddir + 2 * ilog2(sectors);
+
+	if (bucket < 0)
+		return -1;
+	else if (bucket >= BLK_MQ_POLL_STATS_BKTS)
+		return ddir + BLK_MQ_POLL_STATS_BKTS - 2;
+
+	return bucket;
+}
+
+static void blk_mq_poll_stats_fn(struct blk_stat_callback *cb)
+{
+	struct blk_mq_poll_hybrid *ph = cb->data;
+	int bucket;
+
+	for (bucket = 0; bucket < BLK_MQ_POLL_STATS_BKTS; bucket++) {
+		struct blk_rq_stat *stat = &cb->stat[bucket];
+		u64 target;
+
+		if (!stat->nr_samples)
+			continue;
+
+		WRITE_ONCE(ph->mean_ns[bucket], stat->mean);
+		WRITE_ONCE(ph->min_ns[bucket], stat->min);
+
+		target = READ_ONCE(ph->target_ns[bucket]);
+		if (!target)
+			target = stat->mean / 2;
+		WRITE_ONCE(ph->target_ns[bucket], min(target, stat->min));
+	}
+}
+
+/*
+ * Switch @q to the polling mode @nsec. Called with q->sysfs_lock held.
+ */
+int blk_mq_poll_hybrid_set(struct request_queue *q, int nsec)
+{
+	struct blk_mq_poll_hybrid *ph = q->poll_hybrid;
+
+	if (nsec == BLK_MQ_POLL_CLASSIC) {
+		WRITE_ONCE(q->poll_nsec, nsec);
+		blk_mq_poll_hybrid_stop(q);
+		return 0;
+	}
+
+	if (!ph) {
+		ph = kzalloc_node(sizeof(*ph), GFP_KERNEL, q->node);
+		if (!ph)
+			return -ENOMEM;
+		ph->cb = blk_stat_alloc_callback(blk_mq_poll_stats_fn,
+						 blk_mq_poll_stats_bkt,
+						 BLK_MQ_POLL_STATS_BKTS, ph);
+		if (!ph->cb) {
+			kfree(ph);
+			return -ENOMEM;
+		}
+		q->poll_hybrid = ph;
+	}
+
+	if (!blk_queue_flag_test_and_set(QUEUE_FLAG_POLL_STATS, q))
+		blk_stat_add_callback(q, ph->cb);
+	WRITE_ONCE(q->poll_nsec, nsec);
+	return 0;
+}
+
+/*
+ * Stop collecting completion stats for hybrid polling. The hybrid state itself
+ * stays around, pollers may still be looking at it, and is only freed along
+ * with the queue.
+ */
+void blk_mq_poll_hybrid_stop(struct request_queue *q)
+{
+	if (test_and_clear_bit(QUEUE_FLAG_POLL_STATS, &q->queue_flags))
+		blk_stat_remove_callback(q, q->poll_hybrid->cb);
+}
+
+static void blk_mq_poll_hybrid_free(struct request_queue *q)
+{
+	struct blk_mq_poll_hybrid *ph = q->poll_hybrid;
+
+	if (!ph)
+		return;
+
+	/* a poller may have re-armed the window after the callback was removed */
+	del_timer_sync(&ph->cb->timer);
+	blk_stat_free_callback(ph->cb);
+	kfree(ph);
+	q->poll_hybrid = NULL;
+}
+
+/*
+ * Sleep until shortly before @rq is expected to complete. Returns the time the
+ * sleep ended, or 0 if we didn't sleep and should just spin.
+ */
+static u64 blk_mq_poll_hybrid_sleep(struct request_queue *q,
+				    struct request *rq, int *bucket)
+{
+	struct blk_mq_poll_hybrid *ph = q->poll_hybrid;
+	int nsec = READ_ONCE(q->poll_nsec);
+	struct hrtimer_sleeper hs;
+	u64 now, expires;
+
+	if (nsec == BLK_MQ_POLL_CLASSIC || !ph)
+		return 0;
+	if (blk_mq_rq_state(rq) != MQ_RQ_IN_FLIGHT ||
+	    (rq->rq_flags & RQF_MQ_POLL_SLEPT))
+		return 0;
+
+	/* only sleep once per request, and spin from there on */
+	rq->rq_flags |= RQF_MQ_POLL_SLEPT;
+
+	if (test_bit(QUEUE_FLAG_POLL_STATS, &q->queue_flags) &&
+	    !blk_stat_is_active(ph->cb))
+		blk_stat_activate_msecs(ph->cb, BLK_MQ_POLL_STATS_MSECS);
+
+	*bucket = -1;
+	if (rq->rq_flags & RQF_STATS)
+		*bucket = blk_mq_poll_stats_bkt(rq);
+
+	now = ktime_get_ns();
+	if (nsec > 0) {
+		expires = now + nsec;
+	} else {
+		u64 target;
+
+		if (*bucket < 0)
+			return 0;
+		target = READ_ONCE(ph->target_ns[*bucket]);
+		if (!target)
+			return 0;
+		expires = rq->io_start_time_ns + target;
+		if (expires < now + BLK_MQ_POLL_MIN_SLEEP_NS)
+			return 0;
+	}
+
+	hrtimer_init_sleeper_on_stack(&hs, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	hrtimer_set_expires(&hs.timer, ns_to_ktime(expires));
+
+	/*
+	 * Any wakeup ends the sleep early, the caller may be waiting on
+	 * something else as well and needs to see it.
+	 */
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	hrtimer_sleeper_start_expires(&hs, HRTIMER_MODE_ABS);
+	if (hs.task)
+		io_schedule();
+	hrtimer_cancel(&hs.timer);
+	destroy_hrtimer_on_stack(&hs.timer);
+	__set_current_state(TASK_RUNNING);
+
+	expires = ktime_get_ns();
+	atomic64_inc(&ph->sleeps);
+	atomic64_add(expires - now, &ph->sleep_ns);
+	return expires;
+}
+
+/*
+ * Account the first completion found after a hybrid sleep and feed it back
+ * into the sleep time of the bucket. @late is set if the very first poll after
+ * the sleep found it, i.e. we slept for too long.
+ */
+static void blk_mq_poll_hybrid_done(struct request_queue *q, int bucket,
+				    u64 issued, u64 woken, bool late)
+{
+	struct blk_mq_poll_hybrid *ph = q->poll_hybrid;
+	u64 spin = ktime_get_ns() - woken;
+	u64 target, fastest;
+
+	atomic64_add(spin, &ph->spin_ns);
+	if (bucket < 0)
+		return;
+
+	target = READ_ONCE(ph->target_ns[bucket]);
+	fastest = READ_ONCE(ph->min_ns[bucket]);
+
+	if (late) {
+		/*
+		 * The completion was posted at some point during the sleep.
+		 * Nothing has completed faster than the fastest completion of
+		 * the last window, so count the sleep past that as added
+		 * latency.
+		 */
+		u64 due = issued + fastest;
+
+		atomic64_inc(&ph->late);
+		if (fastest && woken > due)
+			atomic64_add(woken - due, &ph->late_ns);
+		target -= target >> 3;
+	} else {
+		target += spin >> 1;
+		if (fastest)
+			target = min(target, fastest);
+	}
+
+	if (READ_ONCE(q->poll_nsec) == 0)
+		WRITE_ONCE(ph->target_ns[bucket], target);
+}
+
+static int blk_hctx_poll(struct request_queue *q, struct blk_mq_hw_ctx *hctx,
+			 struct request *rq, struct io_comp_batch *iob,
+			 unsigned int flags)
 {
-	struct blk_mq_hw_ctx *hctx = blk_qc_to_hctx(q, cookie);
 	long state = get_current_state();
+	u64 issued = 0, woken = 0;
+	bool first = true;
+	int bucket = -1;
 	int ret;
 
+	/*
+	 * Hybrid polling only replaces spinning, a single pass doesn't sleep.
+	 * @rq may be completed and reused by the first poll, don't look at it
+	 * after that.
+	 */
+	if (rq && !(flags & BLK_POLL_ONESHOT)) {
+		issued = rq->io_start_time_ns;
+		woken = blk_mq_poll_hybrid_sleep(q, rq, &bucket);
+	}
+
 	do {
 		ret = q->mq_ops->poll(hctx, iob);
 		if (ret > 0) {
+			if (woken)
+				blk_mq_poll_hybrid_done(q, bucket, issued,
+							woken, first);
 			__set_current_state(TASK_RUNNING);
 			return ret;
 		}
+		first = false;
 
-		if (signal_pending_state(state, current))
-			__set_current_state(TASK_RUNNING);
-		if (task_is_running(current))
-			return 1;
+		/*
+		 * After a hybrid sleep we are running either way, spin until
+		 * the completion shows up and let the caller recheck its
+		 * condition then.
+		 */
+		if (!woken) {
+			if (signal_pending_state(state, current))
+				__set_current_state(TASK_RUNNING);
+			if (task_is_running(current))
+				return 1;
+		}
 
 		if (ret < 0 || (flags & BLK_POLL_ONESHOT))
 			break;
@@ -4785,8 +5051,42 @@ int blk_mq_poll(struct request_queue *q, blk_qc_t cookie, struct io_comp_batch *
 	} while (!need_resched());
 
 	__set_current_state(TASK_RUNNING);
-	return 0;
+	return woken ? 1 : 0;
+}
+
+int blk_mq_poll(struct request_queue *q, blk_qc_t cookie, struct io_comp_batch *iob,
+		unsigned int flags)
+{
+	struct blk_mq_hw_ctx *hctx = blk_qc_to_hctx(q, cookie);
+	struct request *rq = NULL;
+
+	if (READ_ONCE(q->poll_nsec) != BLK_MQ_POLL_CLASSIC)
+		rq = blk_mq_tag_to_rq(hctx->tags, blk_qc_to_tag(cookie));
+
+	return blk_hctx_poll(q, hctx, rq, iob, flags);
+}
+
+/*
+ * Poll the hardware queue a request was issued on, for passthrough requests
+ * that don't necessarily have a bio to poll through.
+ */
+int blk_rq_poll(struct request *rq, struct io_comp_batch *iob,
+		unsigned int poll_flags)
+{
+	struct request_queue *q = rq->q;
+	int ret;
+
+	if (!blk_rq_is_poll(rq))
+		return 0;
+	if (!percpu_ref_tryget(&q->q_usage_counter))
+		return 0;
+
+	ret = blk_hctx_poll(q, rq->mq_hctx, rq, iob, poll_flags);
+	blk_queue_exit(q);
+
+	return ret;
 }
+EXPORT_SYMBOL_GPL(blk_rq_poll);
 
 unsigned int blk_mq_rq_cpu(struct request *rq)
 {
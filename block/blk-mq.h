@@ -39,6 +39,35 @@ enum {
 typedef unsigned int __bitwise blk_insert_t;
 #define BLK_MQ_INSERT_AT_HEAD		((__force blk_insert_t)0x01)
 
+#define BLK_MQ_POLL_CLASSIC		-1
+#define BLK_MQ_POLL_STATS_BKTS		16
+
+/**
+ * struct blk_mq_poll_hybrid - State for hybrid polling on a request queue
+ *
+ * Allocated the first time a hybrid mode is selected through the
+ * io_poll_delay queue attribute. The counters are exported through the
+ * io_poll_stats attribute.
+ */
+struct blk_mq_poll_hybrid {
+	struct blk_stat_callback	*cb;
+
+	/* Time from issue to sleep for, learned per bucket */
+	u64				target_ns[BLK_MQ_POLL_STATS_BKTS];
+	/* Mean and fastest completion of the last stats window, per bucket */
+	u64				mean_ns[BLK_MQ_POLL_STATS_BKTS];
+	u64				min_ns[BLK_MQ_POLL_STATS_BKTS];
+
+	/* Time slept instead of spinning */
+	atomic64_t			sleeps;
+	atomic64_t			sleep_ns;
+	/* Time spent spinning after a sleep, until a completion was found */
+	atomic64_t			spin_ns;
+	/* Sleeps that ended after the completion was already posted */
+	atomic64_t			late;
+	atomic64_t			late_ns;
+};
+
 void blk_mq_submit_bio(struct bio *bio);
 int blk_mq_poll(struct request_queue *q, blk_qc_t cookie, struct io_comp_batch *iob,
 		unsigned int flags);
@@ -131,6 +160,9 @@ void blk_mq_cancel_work_sync(struct request_queue *q);
 
 void blk_mq_release(struct request_queue *q);
 
+int blk_mq_poll_hybrid_set(struct request_queue *q, int nsec);
+void blk_mq_poll_hybrid_stop(struct request_queue *q);
+
 static inline struct blk_mq_ctx *__blk_mq_get_ctx(struct request_queue *q,
 					   unsigned int cpu)
 {
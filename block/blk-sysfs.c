@@ -407,13 +407,58 @@ queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
 
 static ssize_t queue_poll_delay_show(struct request_queue *q, char *page)
 {
-	return sprintf(page, "%d\n", -1);
+	int val;
+
+	if (q->poll_nsec == BLK_MQ_POLL_CLASSIC)
+		val = BLK_MQ_POLL_CLASSIC;
+	else
+		val = q->poll_nsec / 1000;
+
+	return sprintf(page, "%d\n", val);
 }
 
 static ssize_t queue_poll_delay_store(struct request_queue *q, const char *page,
 				size_t count)
 {
-	return count;
+	int err, val;
+
+	if (!q->mq_ops || !q->mq_ops->poll)
+		return -EINVAL;
+
+	err = kstrtoint(page, 10, &val);
+	if (err < 0)
+		return err;
+
+	if (val == BLK_MQ_POLL_CLASSIC)
+		err = blk_mq_poll_hybrid_set(q, BLK_MQ_POLL_CLASSIC);
+	else if (val >= 0 && val <= INT_MAX / 1000)
+		err = blk_mq_poll_hybrid_set(q, val * 1000);
+	else
+		return -EINVAL;
+
+	return err ? err : count;
+}
+
+/*
+ * What hybrid polling saved and cost: the CPU time given back by sleeping
+ * instead of spinning, the time still spun after a sleep, and the sleeps that
+ * overshot the completion together with the latency they added.
+ */
+static ssize_t queue_poll_stats_show(struct request_queue *q, char *page)
+{
+	struct blk_mq_poll_hybrid *ph = q->poll_hybrid;
+
+	if (!ph)
+		return sprintf(page, "sleeps 0\nsleep_ns 0\nspin_ns 0\n"
+			       "late 0\nlate_ns 0\n");
+
+	return sprintf(page, "sleeps %lld\nsleep_ns %lld\nspin_ns %lld\n"
+		       "late %lld\nlate_ns %lld\n",
+		       atomic64_read(&ph->sleeps),
+		       atomic64_read(&ph->sleep_ns),
+		       atomic64_read(&ph->spin_ns),
+		       atomic64_read(&ph->late),
+		       atomic64_read(&ph->late_ns));
 }
 
 static ssize_t queue_poll_show(struct request_queue *q, char *page)
@@ -506,6 +551,11 @@ static ssize_t queue_wb_lat_store(struct request_queue *q, const char *page,
 	return count;
 }
 
+static ssize_t queue_wb_model_show(struct request_queue *q, char *page)
+{
+	return wbt_show_model(q, page);
+}
+
 static ssize_t queue_wc_show(struct request_queue *q, char *page)
 {
 	if (test_bit(QUEUE_FLAG_WC, &q->queue_flags))
@@ -594,11 +644,13 @@ QUEUE_RW_ENTRY(queue_nomerges, "nomerges");
 QUEUE_RW_ENTRY(queue_rq_affinity, "rq_affinity");
 QUEUE_RW_ENTRY(queue_poll, "io_poll");
 QUEUE_RW_ENTRY(queue_poll_delay, "io_poll_delay");
+QUEUE_RO_ENTRY(queue_poll_stats, "io_poll_stats");
 QUEUE_RW_ENTRY(queue_wc, "write_cache");
 QUEUE_RO_ENTRY(queue_fua, "fua");
 QUEUE_RO_ENTRY(queue_dax, "dax");
 QUEUE_RW_ENTRY(queue_io_timeout, "io_timeout");
 QUEUE_RW_ENTRY(queue_wb_lat, "wbt_lat_usec");
+QUEUE_RO_ENTRY(queue_wb_model, "wbt_model");
 QUEUE_RO_ENTRY(queue_virt_boundary_mask, "virt_boundary_mask");
 QUEUE_RO_ENTRY(queue_dma_alignment, "dma_alignment");
 
@@ -656,7 +708,9 @@ static struct attribute *queue_attrs[] = {
 	&queue_fua_entry.attr,
 	&queue_dax_entry.attr,
 	&queue_wb_lat_entry.attr,
+	&queue_wb_model_entry.attr,
 	&queue_poll_delay_entry.attr,
+	&queue_poll_stats_entry.attr,
 	&queue_io_timeout_entry.attr,
 #ifdef CONFIG_BLK_DEV_THROTTLING_LOW
 	&blk_throtl_sample_time_entry.attr,
@@ -881,6 +935,8 @@ void blk_unregister_queue(struct gendisk *disk)
 	mutex_lock(&q->sysfs_lock);
 	elv_unregister_queue(q);
 	disk_unregister_independent_access_ranges(disk);
+	if (queue_is_mq(q))
+		blk_mq_poll_hybrid_stop(q);
 	mutex_unlock(&q->sysfs_lock);
 
 	/* Now that we've deleted all child objects, we can delete the queue. */
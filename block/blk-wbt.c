@@ -16,6 +16,12 @@
  *   positive scaling steps where we shrink the monitoring window, a negative
  *   scaling step retains the default step==0 window size.
  *
+ * Unless a latency target was set, wbt also learns a model of the device (see
+ * wbt_update_model()) and uses it instead of the fixed default target and the
+ * 2x depth steps: the read target follows the unloaded read latency, and the
+ * depth is adjusted in proportion to how far reads are off that target, capped
+ * by what the device can drain within it at its learned write bandwidth.
+ *
  * Copyright (C) 2016 Jens Axboe
  *
  */
@@ -24,6 +30,7 @@
 #include <linux/slab.h>
 #include <linux/backing-dev.h>
 #include <linux/swap.h>
+#include <linux/math64.h>
 
 #include "blk-stat.h"
 #include "blk-wbt.h"
@@ -61,6 +68,21 @@ enum {
 	WBT_STATE_OFF_MANUAL	= 4,	/* off manually by sysfs */
 };
 
+/* Writeback depth buckets of the learned read latency curve, 1, 2-3, 4-7, ... */
+#define WBT_MODEL_DEPTH_BKTS	8
+
+struct wbt_model {
+	u64 last_ns;				/* end of the last window */
+	atomic64_t write_sectors;		/* completed in this window */
+	atomic_t write_ios;
+
+	u64 read_base_nsec;			/* read latency without writes */
+	u64 read_lat_nsec[WBT_MODEL_DEPTH_BKTS]; /* by writeback depth */
+	u64 write_bw;				/* sustainable, bytes/sec */
+	u64 write_size;				/* average write, bytes */
+	u64 target_nsec;			/* read latency target in use */
+};
+
 struct rq_wb {
 	/*
 	 * Settings that govern how we throttle
@@ -92,6 +114,7 @@ struct rq_wb {
 	struct rq_qos rqos;
 	struct rq_wait rq_wait[WBT_NUM_RWQ];
 	struct rq_depth rq_depth;
+	struct wbt_model model;
 };
 
 static inline struct rq_wb *RQWB(struct rq_qos *rqos)
@@ -141,6 +164,14 @@ enum {
 	 * information to scale up or down, scale up.
 	 */
 	RWB_UNKNOWN_BUMP	= 5,
+
+	/*
+	 * The learned read target is this multiple of the unloaded read
+	 * latency, but no lower than RWB_MODEL_MIN_LAT_NSEC and no higher
+	 * than the default target.
+	 */
+	RWB_MODEL_LAT_MULT	= 4,
+	RWB_MODEL_MIN_LAT_NSEC	= 250 * 1000ULL,
 };
 
 static inline bool rwb_enabled(struct rq_wb *rwb)
@@ -255,6 +286,11 @@ static void wbt_done(struct rq_qos *rqos, struct request *rq)
 {
 	struct rq_wb *rwb = RQWB(rqos);
 
+	if (req_op(rq) == REQ_OP_WRITE && (rq->rq_flags & RQF_STATS)) {
+		atomic64_add(rq->stats_sectors, &rwb->model.write_sectors);
+		atomic_inc(&rwb->model.write_ios);
+	}
+
 	if (!wbt_is_tracked(rq)) {
 		if (rwb->sync_cookie == rq) {
 			rwb->sync_issue = 0;
@@ -310,6 +346,131 @@ enum {
 	LAT_EXCEEDED,
 };
 
+/*
+ * The model replaces the fixed target only as long as nobody tuned the target
+ * away from the default, which then just serves as its upper bound.
+ */
+static bool wbt_model_enabled(struct rq_wb *rwb)
+{
+	return rwb->min_lat_nsec &&
+	       rwb->min_lat_nsec == wbt_default_latency_nsec(rwb->rqos.disk->queue) &&
+	       rwb->rq_depth.queue_depth > 2;
+}
+
+static u64 wbt_target_lat(struct rq_wb *rwb)
+{
+	struct wbt_model *m = &rwb->model;
+
+	if (!wbt_model_enabled(rwb) || !m->read_base_nsec)
+		return rwb->min_lat_nsec;
+
+	return clamp_t(u64, m->read_base_nsec * RWB_MODEL_LAT_MULT,
+		       RWB_MODEL_MIN_LAT_NSEC, rwb->min_lat_nsec);
+}
+
+static unsigned int wbt_model_bucket(unsigned int depth)
+{
+	return min_t(unsigned int, ilog2(max(depth, 1U)),
+		     WBT_MODEL_DEPTH_BKTS - 1);
+}
+
+static u64 wbt_ewma(u64 avg, u64 val, unsigned int shift)
+{
+	if (!avg)
+		return val;
+	if (val > avg)
+		return avg + ((val - avg) >> shift);
+	return avg - ((avg - val) >> shift);
+}
+
+/*
+ * Learn from the window that just ended:
+ *
+ * - the read latency of the device without writes in flight, which the read
+ *   target is derived from,
+ * - the read latency at each writeback depth, i.e. how much writes hurt reads
+ *   on this device,
+ * - the write bandwidth the device sustains while reads still meet their
+ *   target, and the average size of those writes.
+ */
+static void wbt_update_model(struct rq_wb *rwb, struct blk_rq_stat *stat,
+			     int status)
+{
+	struct wbt_model *m = &rwb->model;
+	u64 now = ktime_get_ns();
+	u64 elapsed = now - m->last_ns;
+	u64 bytes = (u64)atomic64_xchg(&m->write_sectors, 0) << SECTOR_SHIFT;
+	unsigned int ios = atomic_xchg(&m->write_ios, 0);
+
+	m->last_ns = now;
+
+	if (stat[READ].nr_samples && !stat[WRITE].nr_samples &&
+	    !wbt_inflight(rwb)) {
+		/* a faster device shows at once, a slower one only slowly */
+		if (!m->read_base_nsec || stat[READ].min < m->read_base_nsec)
+			m->read_base_nsec = stat[READ].min;
+		else
+			m->read_base_nsec = wbt_ewma(m->read_base_nsec,
+						     stat[READ].min, 3);
+	}
+
+	if (stat_sample_valid(stat)) {
+		unsigned int bkt = wbt_model_bucket(rwb->rq_depth.max_depth);
+
+		m->read_lat_nsec[bkt] = wbt_ewma(m->read_lat_nsec[bkt],
+						 stat[READ].min, 2);
+	}
+
+	if (ios >= RWB_MIN_WRITE_SAMPLES && elapsed) {
+		u64 bw = mul_u64_u64_div_u64(bytes, NSEC_PER_SEC, elapsed);
+
+		m->write_size = wbt_ewma(m->write_size, div_u64(bytes, ios), 2);
+
+		/*
+		 * Only a window that kept reads within their target counts as
+		 * sustainable. Remember the best such bandwidth, and let it
+		 * decay slowly so the model follows a device that slowed down.
+		 */
+		if (status != LAT_EXCEEDED) {
+			if (bw > m->write_bw)
+				m->write_bw = wbt_ewma(m->write_bw, bw, 2);
+			else
+				m->write_bw = wbt_ewma(m->write_bw, bw, 5);
+		}
+	}
+
+	m->target_nsec = wbt_target_lat(rwb);
+}
+
+/*
+ * The deepest writeback the model allows with reads around: as many writes as
+ * the device drains within the read target at its sustainable bandwidth, as a
+ * read queued behind more than that will miss it, and no deeper than the
+ * curve shows reads still meeting it.
+ */
+static unsigned int wbt_model_max_depth(struct rq_wb *rwb, unsigned int maxd)
+{
+	struct wbt_model *m = &rwb->model;
+	u64 target = m->target_nsec;
+	unsigned int bkt;
+
+	if (m->write_bw && m->write_size) {
+		u64 bdp = mul_u64_u64_div_u64(m->write_bw, target,
+					      (u64)NSEC_PER_SEC * m->write_size);
+
+		maxd = clamp_t(u64, bdp, 1, maxd);
+	}
+
+	/* walk down the curve past the depths where reads missed the target */
+	for (bkt = wbt_model_bucket(maxd); bkt; bkt--) {
+		if (m->read_lat_nsec[bkt] <= target)
+			break;
+		maxd = min(maxd, (1U << bkt) - 1);
+	}
+
+	return maxd;
+}
+
 static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 {
 	struct backing_dev_info *bdi = rwb->rqos.disk->bdi;
@@ -327,7 +488,7 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 	 */
 	thislat = rwb_sync_issue_lat(rwb);
 	if (thislat > rwb->cur_win_nsec ||
-	    (thislat > rwb->min_lat_nsec && !stat[READ].nr_samples)) {
+	    (thislat > wbt_target_lat(rwb) && !stat[READ].nr_samples)) {
 		trace_wbt_lat(bdi, thislat);
 		return LAT_EXCEEDED;
 	}
@@ -351,7 +512,7 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 	/*
 	 * If the 'min' latency exceeds our target, step down.
 	 */
-	if (stat[READ].min > rwb->min_lat_nsec) {
+	if (stat[READ].min > wbt_target_lat(rwb)) {
 		trace_wbt_lat(bdi, stat[READ].min);
 		trace_wbt_stat(bdi, stat);
 		return LAT_EXCEEDED;
@@ -404,6 +565,77 @@ static void scale_down(struct rq_wb *rwb, bool hard_throttle)
 	rwb_trace_step(rwb, tracepoint_string("scale down"));
 }
 
+/*
+ * Continuous version of scale_up()/scale_down() for the model: set the depth
+ * to @depth, and the scale step to the matching power of two so the window
+ * still shrinks while we throttle.
+ */
+static void scale_to(struct rq_wb *rwb, unsigned int depth, unsigned int maxd)
+{
+	struct rq_depth *rqd = &rwb->rq_depth;
+	unsigned int def = min(rqd->default_depth, rqd->queue_depth);
+	unsigned int old = rqd->max_depth;
+
+	depth = clamp(depth, 1U, maxd);
+	if (depth == old)
+		return;
+
+	rqd->max_depth = depth;
+	if (depth < def)
+		rqd->scale_step = ilog2(def) - ilog2(depth);
+	else
+		rqd->scale_step = -(int)(ilog2(depth) - ilog2(def));
+	rqd->scaled_max = depth >= maxd;
+
+	calc_wb_limits(rwb);
+	rwb->unknown_cnt = 0;
+	if (depth > old) {
+		rwb_wake_all(rwb);
+		rwb_trace_step(rwb, tracepoint_string("model up"));
+	} else {
+		rwb_trace_step(rwb, tracepoint_string("model down"));
+	}
+}
+
+/*
+ * Adjust the depth with the model. Returns false if it had nothing to go by,
+ * in which case the fixed steps apply.
+ */
+static bool wbt_model_scale(struct rq_wb *rwb, struct blk_rq_stat *stat,
+			    int status)
+{
+	struct rq_depth *rqd = &rwb->rq_depth;
+	unsigned int maxd = max(3 * rqd->queue_depth / 4, 1U);
+	unsigned int depth = rqd->max_depth;
+	u64 target = rwb->model.target_nsec;
+	u64 lat;
+
+	if (!wbt_model_enabled(rwb) || !rwb->model.read_base_nsec)
+		return false;
+
+	switch (status) {
+	case LAT_EXCEEDED:
+		/* throttle in proportion to how far reads are off target */
+		lat = max(stat[READ].nr_samples ? stat[READ].min : 0,
+			  rwb_sync_issue_lat(rwb));
+		if (lat > target)
+			depth = div64_u64((u64)depth * target, lat);
+		depth = clamp(depth, rqd->max_depth / 2, rqd->max_depth - 1);
+		scale_to(rwb, depth, wbt_model_max_depth(rwb, maxd));
+		return true;
+	case LAT_OK:
+		depth += max(depth / 8, 1U);
+		scale_to(rwb, depth, wbt_model_max_depth(rwb, maxd));
+		return true;
+	case LAT_UNKNOWN_WRITES:
+		/* no reads to protect, let writes use the device */
+		scale_to(rwb, depth + max(depth / 4, 1U), maxd);
+		return true;
+	default:
+		return false;
+	}
+}
+
 static void rwb_arm_timer(struct rq_wb *rwb)
 {
 	struct rq_depth *rqd = &rwb->rq_depth;
@@ -439,9 +671,13 @@ static void wb_timer_fn(struct blk_stat_callback *cb)
 		return;
 
 	status = latency_exceeded(rwb, cb->stat);
+	wbt_update_model(rwb, cb->stat, status);
 
 	trace_wbt_timer(rwb->rqos.disk->bdi, status, rqd->scale_step, inflight);
 
+	if (wbt_model_scale(rwb, cb->stat, status))
+		goto rearm;
+
 	/*
 	 * If we exceeded the latency target, step down. If we did not,
 	 * step one level up. If we don't know enough to say either exceeded
@@ -479,6 +715,7 @@ static void wb_timer_fn(struct blk_stat_callback *cb)
 		break;
 	}
 
+rearm:
 	/*
 	 * Re-arm timer, if we have IO in flight
 	 */
@@ -522,6 +759,8 @@ void wbt_set_min_lat(struct request_queue *q, u64 val)
 		return;
 
 	RQWB(rqos)->min_lat_nsec = val;
+	memset(RQWB(rqos)->model.read_lat_nsec, 0,
+	       sizeof(RQWB(rqos)->model.read_lat_nsec));
 	if (val)
 		RQWB(rqos)->enable_state = WBT_STATE_ON_MANUAL;
 	else
@@ -531,6 +770,31 @@ void wbt_set_min_lat(struct request_queue *q, u64 val)
 }
 
 
+ssize_t wbt_show_model(struct request_queue *q, char *page)
+{
+	struct rq_qos *rqos = wbt_rq_qos(q);
+	struct wbt_model *m;
+	ssize_t len;
+	int i;
+
+	if (!rqos)
+		return -EINVAL;
+	m = &RQWB(rqos)->model;
+
+	len = sprintf(page, "enabled %d\nread_base_nsec %llu\n"
+		      "read_target_nsec %llu\nwrite_bw %llu\n"
+		      "write_size %llu\ndepth %u\nread_lat_nsec",
+		      wbt_model_enabled(RQWB(rqos)), m->read_base_nsec,
+		      wbt_target_lat(RQWB(rqos)), m->write_bw, m->write_size,
+		      RQWB(rqos)->rq_depth.max_depth);
+	for (i = 0; i < WBT_MODEL_DEPTH_BKTS; i++)
+		len += sprintf(page + len, " %u:%llu", 1U << i,
+			       m->read_lat_nsec[i]);
+	len += sprintf(page + len, "\n");
+
+	return len;
+}
+
 static bool close_io(struct rq_wb *rwb)
 {
 	const unsigned long now = jiffies;
@@ -939,6 +1203,7 @@ int wbt_init(struct gendisk *disk)
 	rwb->rq_depth.default_depth = RWB_DEF_DEPTH;
 	rwb->min_lat_nsec = wbt_default_latency_nsec(q);
 	rwb->rq_depth.queue_depth = blk_queue_depth(q);
+	rwb->model.last_ns = ktime_get_ns();
 	wbt_update_limits(rwb);
 
 	/*
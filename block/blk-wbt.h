@@ -15,6 +15,7 @@ bool wbt_disabled(struct request_queue *);
 void wbt_set_write_cache(struct request_queue *, bool);
 
 u64 wbt_default_latency_nsec(struct request_queue *);
+ssize_t wbt_show_model(struct request_queue *q, char *page);
 
 #else
 
@@ -46,6 +47,10 @@ static inline bool wbt_disabled(struct request_queue *q)
 {
 	return true;
 }
+static inline ssize_t wbt_show_model(struct request_queue *q, char *page)
+{
+	return -EINVAL;
+}
 
 #endif /* CONFIG_BLK_WBT */
 
@@ -18,6 +18,7 @@
 #include "blk-mq.h"
 #include "blk-mq-debugfs.h"
 #include "blk-mq-sched.h"
+#include "blk-cgroup.h"
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/kyber.h>
@@ -64,6 +65,21 @@ static const unsigned int kyber_depth[] = {
 	[KYBER_OTHER] = 16,
 };
 
+/*
+ * Share of the device queue depth each scheduling domain may use at most.
+ *
+ * A shallow device, e.g. a single 64 tag queue, is already saturated by the
+ * write domain alone. Capping the other domains below the device depth keeps
+ * writeback and discards from owning every driver tag while reads wait behind
+ * them.
+ */
+static const unsigned int kyber_depth_percent[] = {
+	[KYBER_READ] = 100,
+	[KYBER_WRITE] = 75,
+	[KYBER_DISCARD] = 25,
+	[KYBER_OTHER] = 25,
+};
+
 /*
  * Default latency targets for each scheduling domain.
  */
@@ -174,10 +190,51 @@ struct kyber_queue_data {
 
 	int domain_p99[KYBER_OTHER];
 
+	/* Maximum depth of each scheduling domain on this device. */
+	unsigned int domain_depth[KYBER_NUM_DOMAINS];
+
 	/* Target latencies in nanoseconds. */
 	u64 latency_targets[KYBER_OTHER];
 };
 
+#ifdef CONFIG_BLK_CGROUP
+/*
+ * Per-cgroup latency targets, overriding the latency targets of the queue for
+ * requests issued by that cgroup. A target of 0 uses the queue's.
+ */
+struct kyber_blkcg {
+	struct blkcg_policy_data cpd;
+	u64 latency_targets[KYBER_OTHER];
+};
+
+static struct blkcg_policy blkcg_policy_kyber;
+
+static struct kyber_blkcg *blkcg_to_kyber_blkcg(struct blkcg *blkcg)
+{
+	struct blkcg_policy_data *cpd = blkcg_to_cpd(blkcg, &blkcg_policy_kyber);
+
+	return cpd ? container_of(cpd, struct kyber_blkcg, cpd) : NULL;
+}
+
+static u64 kyber_blkcg_latency_target(struct request *rq,
+				      unsigned int sched_domain)
+{
+	struct kyber_blkcg *kbc;
+
+	if (!rq->bio || !rq->bio->bi_blkg)
+		return 0;
+
+	kbc = blkcg_to_kyber_blkcg(rq->bio->bi_blkg->blkcg);
+	return kbc ? READ_ONCE(kbc->latency_targets[sched_domain]) : 0;
+}
+#else
+static u64 kyber_blkcg_latency_target(struct request *rq,
+				      unsigned int sched_domain)
+{
+	return 0;
+}
+#endif
+
 struct kyber_hctx_data {
 	spinlock_t lock;
 	struct list_head rqs[KYBER_NUM_DOMAINS];
@@ -266,7 +323,7 @@ static int calculate_percentile(struct kyber_queue_data *kqd,
 static void kyber_resize_domain(struct kyber_queue_data *kqd,
 				unsigned int sched_domain, unsigned int depth)
 {
-	depth = clamp(depth, 1U, kyber_depth[sched_domain]);
+	depth = clamp(depth, 1U, kqd->domain_depth[sched_domain]);
 	if (depth != kqd->domain_tokens[sched_domain].sb.depth) {
 		sbitmap_queue_resize(&kqd->domain_tokens[sched_domain], depth);
 		trace_kyber_adjust(kqd->dev, kyber_domain_names[sched_domain],
@@ -357,6 +414,7 @@ static void kyber_timer_fn(struct timer_list *t)
 static struct kyber_queue_data *kyber_queue_data_alloc(struct request_queue *q)
 {
 	struct kyber_queue_data *kqd;
+	unsigned int hw_depth;
 	int ret = -ENOMEM;
 	int i;
 
@@ -374,11 +432,15 @@ static struct kyber_queue_data *kyber_queue_data_alloc(struct request_queue *q)
 
 	timer_setup(&kqd->timer, kyber_timer_fn, 0);
 
+	hw_depth = q->tag_set->queue_depth * q->nr_hw_queues;
+
 	for (i = 0; i < KYBER_NUM_DOMAINS; i++) {
 		WARN_ON(!kyber_depth[i]);
 		WARN_ON(!kyber_batch_size[i]);
+		kqd->domain_depth[i] = clamp(hw_depth * kyber_depth_percent[i] / 100,
+					     1U, kyber_depth[i]);
 		ret = sbitmap_queue_init_node(&kqd->domain_tokens[i],
-					      kyber_depth[i], -1, false,
+					      kqd->domain_depth[i], -1, false,
 					      GFP_KERNEL, q->node);
 		if (ret) {
 			while (--i >= 0)
@@ -537,6 +599,21 @@ static void rq_set_domain_token(struct request *rq, int token)
 	rq->elv.priv[0] = (void *)(long)token;
 }
 
+/*
+ * The latency target of the cgroup that issued the request, or 0 for the
+ * target of the queue. Looked up at insertion, the bios are gone by the time
+ * the request completes.
+ */
+static u64 rq_get_latency_target(struct request *rq)
+{
+	return (unsigned long)rq->elv.priv[1];
+}
+
+static void rq_set_latency_target(struct request *rq, u64 target)
+{
+	rq->elv.priv[1] = (void *)(unsigned long)min_t(u64, target, ULONG_MAX);
+}
+
 static void rq_clear_domain_token(struct kyber_queue_data *kqd,
 				  struct request *rq)
 {
@@ -585,6 +662,7 @@ static bool kyber_bio_merge(struct request_queue *q, struct bio *bio,
 static void kyber_prepare_request(struct request *rq)
 {
 	rq_set_domain_token(rq, -1);
+	rq_set_latency_target(rq, 0);
 }
 
 static void kyber_insert_requests(struct blk_mq_hw_ctx *hctx,
@@ -599,6 +677,10 @@ static void kyber_insert_requests(struct blk_mq_hw_ctx *hctx,
 		struct kyber_ctx_queue *kcq = &khd->kcqs[rq->mq_ctx->index_hw[hctx->type]];
 		struct list_head *head = &kcq->rq_list[sched_domain];
 
+		if (sched_domain != KYBER_OTHER)
+			rq_set_latency_target(rq,
+				kyber_blkcg_latency_target(rq, sched_domain));
+
 		spin_lock(&kcq->lock);
 		trace_block_rq_insert(rq);
 		if (flags & BLK_MQ_INSERT_AT_HEAD)
@@ -647,8 +729,16 @@ static void kyber_completed_request(struct request *rq, u64 now)
 	if (sched_domain == KYBER_OTHER)
 		return;
 
+	/*
+	 * Samples are bucketed relative to the target of the cgroup that issued
+	 * them, so a cgroup with a tighter target can report congestion while
+	 * the rest of the queue still meets the default one.
+	 */
+	target = rq_get_latency_target(rq);
+	if (!target)
+		target = kqd->latency_targets[sched_domain];
+
 	cpu_latency = get_cpu_ptr(kqd->cpu_latency);
-	target = kqd->latency_targets[sched_domain];
 	add_latency_sample(cpu_latency, sched_domain, KYBER_TOTAL_LATENCY,
 			   target, now - rq->start_time_ns);
 	add_latency_sample(cpu_latency, sched_domain, KYBER_IO_LATENCY, target,
@@ -886,12 +976,14 @@ static ssize_t kyber_##name##_lat_store(struct elevator_queue *e,	\
 }
 KYBER_LAT_SHOW_STORE(KYBER_READ, read);
 KYBER_LAT_SHOW_STORE(KYBER_WRITE, write);
+KYBER_LAT_SHOW_STORE(KYBER_DISCARD, discard);
 #undef KYBER_LAT_SHOW_STORE
 
 #define KYBER_LAT_ATTR(op) __ATTR(op##_lat_nsec, 0644, kyber_##op##_lat_show, kyber_##op##_lat_store)
 static struct elv_fs_entry kyber_sched_attrs[] = {
 	KYBER_LAT_ATTR(read),
 	KYBER_LAT_ATTR(write),
+	KYBER_LAT_ATTR(discard),
 	__ATTR_NULL
 };
 #undef KYBER_LAT_ATTR
@@ -1011,6 +1103,117 @@ static const struct blk_mq_debugfs_attr kyber_hctx_debugfs_attrs[] = {
 #undef KYBER_HCTX_DOMAIN_ATTRS
 #endif
 
+#ifdef CONFIG_BLK_CGROUP
+static const char *kyber_blkcg_lat_names[] = {
+	[KYBER_READ] = "read",
+	[KYBER_WRITE] = "write",
+	[KYBER_DISCARD] = "discard",
+};
+
+static int kyber_blkcg_lat_show(struct seq_file *sf, void *v)
+{
+	struct kyber_blkcg *kbc = blkcg_to_kyber_blkcg(css_to_blkcg(seq_css(sf)));
+	unsigned int i;
+
+	for (i = 0; i < KYBER_OTHER; i++) {
+		u64 target = READ_ONCE(kbc->latency_targets[i]);
+
+		seq_printf(sf, "%s%s=", i ? " " : "", kyber_blkcg_lat_names[i]);
+		if (target)
+			seq_printf(sf, "%llu", target);
+		else
+			seq_puts(sf, "default");
+	}
+	seq_putc(sf, '\n');
+	return 0;
+}
+
+/*
+ * Takes any of "read=NSEC write=NSEC discard=NSEC", where NSEC may also be
+ * "default" to go back to the target of the queue.
+ */
+static ssize_t kyber_blkcg_lat_write(struct kernfs_open_file *of, char *buf,
+				     size_t nbytes, loff_t off)
+{
+	struct kyber_blkcg *kbc = blkcg_to_kyber_blkcg(css_to_blkcg(of_css(of)));
+	u64 targets[KYBER_OTHER];
+	unsigned int i;
+	char *tok;
+
+	memcpy(targets, kbc->latency_targets, sizeof(targets));
+
+	while ((tok = strsep(&buf, " \t\n"))) {
+		char *val;
+
+		if (!*tok)
+			continue;
+
+		val = strchr(tok, '=');
+		if (!val)
+			return -EINVAL;
+		*val++ = '\0';
+
+		for (i = 0; i < KYBER_OTHER; i++)
+			if (!strcmp(tok, kyber_blkcg_lat_names[i]))
+				break;
+		if (i == KYBER_OTHER)
+			return -EINVAL;
+
+		if (!strcmp(val, "default"))
+			targets[i] = 0;
+		else if (kstrtou64(val, 10, &targets[i]))
+			return -EINVAL;
+	}
+
+	for (i = 0; i < KYBER_OTHER; i++)
+		WRITE_ONCE(kbc->latency_targets[i], targets[i]);
+
+	return nbytes;
+}
+
+static struct blkcg_policy_data *kyber_cpd_alloc(gfp_t gfp)
+{
+	struct kyber_blkcg *kbc;
+
+	kbc = kzalloc(sizeof(*kbc), gfp);
+	if (!kbc)
+		return NULL;
+
+	return &kbc->cpd;
+}
+
+static void kyber_cpd_free(struct blkcg_policy_data *cpd)
+{
+	kfree(container_of(cpd, struct kyber_blkcg, cpd));
+}
+
+#define KYBER_BLKCG_FILES						\
+	{								\
+		.name = "kyber.latency",				\
+		.flags = CFTYPE_NOT_ON_ROOT,				\
+		.seq_show = kyber_blkcg_lat_show,			\
+		.write = kyber_blkcg_lat_write,				\
+	},								\
+	{ } /* terminate */
+
+static struct cftype kyber_blkcg_files[] = {
+	KYBER_BLKCG_FILES
+};
+
+static struct cftype kyber_blkcg_legacy_files[] = {
+	KYBER_BLKCG_FILES
+};
+#undef KYBER_BLKCG_FILES
+
+static struct blkcg_policy blkcg_policy_kyber = {
+	.dfl_cftypes		= kyber_blkcg_files,
+	.legacy_cftypes		= kyber_blkcg_legacy_files,
+
+	.cpd_alloc_fn		= kyber_cpd_alloc,
+	.cpd_free_fn		= kyber_cpd_free,
+};
+#endif /* CONFIG_BLK_CGROUP */
+
 static struct elevator_type kyber_sched = {
 	.ops = {
 		.init_sched = kyber_init_sched,
@@ -1039,12 +1242,33 @@ static struct elevator_type kyber_sched = {
 
 static int __init kyber_init(void)
 {
-	return elv_register(&kyber_sched);
+	int ret;
+
+#ifdef CONFIG_BLK_CGROUP
+	ret = blkcg_policy_register(&blkcg_policy_kyber);
+	if (ret)
+		return ret;
+#endif
+
+	ret = elv_register(&kyber_sched);
+	if (ret)
+		goto err_pol_unreg;
+
+	return 0;
+
+err_pol_unreg:
+#ifdef CONFIG_BLK_CGROUP
+	blkcg_policy_unregister(&blkcg_policy_kyber);
+#endif
+	return ret;
 }
 
 static void __exit kyber_exit(void)
 {
 	elv_unregister(&kyber_sched);
+#ifdef CONFIG_BLK_CGROUP
+	blkcg_policy_unregister(&blkcg_policy_kyber);
+#endif
 }
 
 module_init(kyber_init);
@@ -216,6 +216,37 @@ int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 }
 EXPORT_SYMBOL_GPL(crypto_shash_finup);
 
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	struct shash_alg *shash = crypto_shash_alg(tfm);
+	unsigned long alignmask = crypto_shash_alignmask(tfm);
+	SHASH_DESC_ON_STACK(desc2, tfm);
+	unsigned int i;
+	int err = 0;
+
+	if (num_msgs > 1 && num_msgs <= shash->mb_max_msgs && !alignmask) {
+		if (IS_ENABLED(CONFIG_CRYPTO_STATS)) {
+			struct crypto_istat_hash *istat = shash_get_stat(shash);
+
+			atomic64_add(num_msgs, &istat->hash_cnt);
+			atomic64_add((u64)len * num_msgs, &istat->hash_tlen);
+		}
+		err = shash->finup_mb(desc, data, len, outs, num_msgs);
+		return crypto_shash_errstat(shash, err);
+	}
+
+	for (i = 0; i < num_msgs && !err; i++) {
+		memcpy(desc2, desc, sizeof(*desc) + crypto_shash_descsize(tfm));
+		err = crypto_shash_finup(desc2, data[i], len, outs[i]);
+	}
+	shash_desc_zero(desc2);
+	return err;
+}
+EXPORT_SYMBOL_GPL(crypto_shash_finup_mb);
+
 static int shash_digest_unaligned(struct shash_desc *desc, const u8 *data,
 				  unsigned int len, u8 *out)
 {
@@ -655,6 +686,10 @@ static int shash_prepare_alg(struct shash_alg *alg)
 
 	if (!alg->finup)
 		alg->finup = shash_finup_unaligned;
+	if (!alg->finup_mb)
+		alg->mb_max_msgs = 1;
+	else if (alg->mb_max_msgs < 2)
+		return -EINVAL;
 	if (!alg->digest)
 		alg->digest = shash_digest_unaligned;
 	if (!alg->export) {
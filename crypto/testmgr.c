@@ -1894,6 +1894,117 @@ static int alloc_shash(const char *driver, u32 type, u32 mask,
 	return 0;
 }
 
+#define FINUP_MB_TEST_MAX_MSGS	8
+
+static int test_shash_finup_mb_one(const char *driver, struct shash_desc *desc,
+				   const u8 * const data[], u8 * const outs[],
+				   unsigned int num_msgs, unsigned int len,
+				   const u8 *prefix, unsigned int prefix_len)
+{
+	unsigned int digestsize = crypto_shash_digestsize(desc->tfm);
+	u8 ref[HASH_MAX_DIGESTSIZE];
+	unsigned int i;
+	int err;
+
+	err = crypto_shash_init(desc);
+	if (!err && prefix_len)
+		err = crypto_shash_update(desc, prefix, prefix_len);
+	if (!err)
+		err = crypto_shash_finup_mb(desc, data, len, outs, num_msgs);
+	if (err) {
+		pr_err("alg: shash: %s finup_mb() failed with err %d on %u messages of length %u, prefix %u\n",
+		       driver, err, num_msgs, len, prefix_len);
+		return err;
+	}
+
+	for (i = 0; i < num_msgs; i++) {
+		/* the first message also checks that @desc was left alone */
+		if (i) {
+			err = crypto_shash_init(desc);
+			if (!err && prefix_len)
+				err = crypto_shash_update(desc, prefix,
+							  prefix_len);
+		}
+		if (!err)
+			err = crypto_shash_finup(desc, data[i], len, ref);
+		if (err) {
+			pr_err("alg: shash: %s finup() failed with err %d\n",
+			       driver, err);
+			return err;
+		}
+		if (memcmp(ref, outs[i], digestsize)) {
+			pr_err("alg: shash: %s finup_mb() differs from finup() for message %u of %u, length %u, prefix %u\n",
+			       driver, i, num_msgs, len, prefix_len);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Check crypto_shash_finup_mb() against one crypto_shash_finup() per message
+ * for algorithms that implement it.  The lengths cover the padding corner
+ * cases of the 64-byte block hashes (55, 56, 63 and 64 byte tails) as well as
+ * multi-block messages, on a fresh state and on top of already hashed data.
+ */
+static int test_shash_finup_mb(const char *driver, struct shash_desc *desc)
+{
+	static const unsigned int lens[] = {
+		0, 1, 55, 56, 63, 64, 65, 119, 120, 127, 128, 129, 1000,
+		4096 + 55,
+	};
+	static const unsigned int prefix_lens[] = { 0, 1, 55, 64, 100 };
+	const unsigned int max_len = lens[ARRAY_SIZE(lens) - 1];
+	struct crypto_shash *tfm = desc->tfm;
+	unsigned int digestsize = crypto_shash_digestsize(tfm);
+	unsigned int max_msgs = crypto_shash_mb_max_msgs(tfm);
+	const u8 *data[FINUP_MB_TEST_MAX_MSGS];
+	u8 *outs[FINUP_MB_TEST_MAX_MSGS];
+	unsigned int l, p, n, i;
+	u8 *bufs, *digests, *prefix;
+	int err = 0;
+
+	if (max_msgs <= 1 || crypto_shash_get_flags(tfm) & CRYPTO_TFM_NEED_KEY)
+		return 0;
+	max_msgs = min_t(unsigned int, max_msgs, FINUP_MB_TEST_MAX_MSGS);
+
+	/* one more buffer for the prefix */
+	bufs = kmalloc_array(max_msgs + 1, max_len, GFP_KERNEL);
+	digests = kmalloc_array(max_msgs, digestsize, GFP_KERNEL);
+	if (!bufs || !digests) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	/* different contents for every message */
+	for (i = 0; i < (max_msgs + 1) * max_len; i++)
+		bufs[i] = i * 167 + i / 251;
+	for (i = 0; i < max_msgs; i++) {
+		data[i] = bufs + i * max_len;
+		outs[i] = digests + i * digestsize;
+	}
+	prefix = bufs + max_msgs * max_len;
+
+	for (n = 2; n <= max_msgs; n++) {
+		for (p = 0; p < ARRAY_SIZE(prefix_lens); p++) {
+			for (l = 0; l < ARRAY_SIZE(lens); l++) {
+				err = test_shash_finup_mb_one(driver, desc,
+							      data, outs, n,
+							      lens[l], prefix,
+							      prefix_lens[p]);
+				if (err)
+					goto out;
+			}
+			cond_resched();
+		}
+	}
+out:
+	kfree(digests);
+	kfree(bufs);
+	return err;
+}
+
 static int __alg_test_hash(const struct hash_testvec *vecs,
 			   unsigned int num_vecs, const char *driver,
 			   u32 type, u32 mask,
@@ -1970,6 +2081,8 @@ static int __alg_test_hash(const struct hash_testvec *vecs,
 	}
 	err = test_hash_vs_generic_impl(generic_driver, maxkeysize, req,
 					desc, tsgl, hashstate);
+	if (!err && desc)
+		err = test_shash_finup_mb(driver, desc);
 out:
 	kfree(hashstate);
 	if (tsgl) {
@@ -20,6 +20,7 @@
 
 #include <linux/device.h>
 #include <linux/export.h>
+#include <linux/fwnode.h>
 #include <linux/mutex.h>
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>
@@ -228,6 +229,11 @@ static void initcall_debug_report(struct device *dev, ktime_t calltime,
 		 (unsigned long long)ktime_us_delta(rettime, calltime));
 }
 
+static bool dpm_async_dev(struct device *dev)
+{
+	return dev->power.async_suspend || dev->power.async_auto;
+}
+
 /**
  * dpm_wait - Wait for a PM operation to complete.
  * @dev: Device to wait for.
@@ -238,7 +244,7 @@ static void dpm_wait(struct device *dev, bool async)
 	if (!dev)
 		return;
 
-	if (async || (pm_async_enabled && dev->power.async_suspend))
+	if (async || (pm_async_enabled && dpm_async_dev(dev)))
 		wait_for_completion(&dev->power.completion);
 }
 
@@ -450,6 +456,9 @@ static void pm_dev_err(struct device *dev, pm_message_t state, const char *info,
 		error);
 }
 
+/* Number of devices handled asynchronously in the current phase. */
+static unsigned int dpm_async_count;
+
 static void dpm_show_time(ktime_t starttime, pm_message_t state, int error,
 			  const char *info)
 {
@@ -464,10 +473,12 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, int error,
 	if (usecs == 0)
 		usecs = 1;
 
-	pm_pr_dbg("%s%s%s of devices %s after %ld.%03ld msecs\n",
+	pm_pr_dbg("%s%s%s of devices %s after %ld.%03ld msecs (%u async)\n",
 		  info ?: "", info ? " " : "", pm_verb(state.event),
 		  error ? "aborted" : "complete",
-		  usecs / USEC_PER_MSEC, usecs % USEC_PER_MSEC);
+		  usecs / USEC_PER_MSEC, usecs % USEC_PER_MSEC,
+		  dpm_async_count);
+	dpm_async_count = 0;
 }
 
 static int dpm_run_callback(pm_callback_t cb, struct device *dev,
@@ -660,15 +671,31 @@ static int device_resume_noirq(struct device *dev, pm_message_t state, bool asyn
 
 static bool is_async(struct device *dev)
 {
-	return dev->power.async_suspend && pm_async_enabled
+	return dpm_async_dev(dev) && pm_async_enabled
 		&& !pm_trace_is_enabled();
 }
 
+/*
+ * For pm_async == 2: the PM core orders suspend and resume by the parent and
+ * device link relations of a device, so it is safe to handle the device
+ * asynchronously once fw_devlink has turned every supplier described in its
+ * firmware node into a device link.
+ */
+static bool dpm_async_auto_ok(struct device *dev)
+{
+	struct fwnode_handle *fwnode = dev->fwnode;
+
+	return pm_async_enabled > 1 && fwnode &&
+		(fwnode->flags & FWNODE_FLAG_LINKS_ADDED) &&
+		list_empty(&fwnode->suppliers);
+}
+
 static bool dpm_async_fn(struct device *dev, async_func_t func)
 {
 	reinit_completion(&dev->power.completion);
 
 	if (is_async(dev)) {
+		dpm_async_count++;
 		get_device(dev);
 		async_schedule_dev(func, dev);
 		return true;
@@ -1826,6 +1853,12 @@ static int device_prepare(struct device *dev, pm_message_t state)
 	 */
 	pm_runtime_get_noresume(dev);
 
+	/*
+	 * Decide once per transition, so that all phases agree on which
+	 * devices have to be waited for.
+	 */
+	dev->power.async_auto = dpm_async_auto_ok(dev);
+
 	if (dev->power.syscore)
 		return 0;
 
@@ -1974,7 +2007,7 @@ EXPORT_SYMBOL_GPL(__suspend_report_result);
  */
 int device_pm_wait_for_dev(struct device *subordinate, struct device *dev)
 {
-	dpm_wait(dev, subordinate->power.async_suspend);
+	dpm_wait(dev, dpm_async_dev(subordinate));
 	return async_error;
 }
 EXPORT_SYMBOL_GPL(device_pm_wait_for_dev);
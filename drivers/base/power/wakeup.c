@@ -902,6 +902,30 @@ bool pm_wakeup_pending(void)
 }
 EXPORT_SYMBOL_GPL(pm_wakeup_pending);
 
+/**
+ * pm_wakeup_events_pending - Check for wakeup events reported by wakeup sources.
+ *
+ * Like pm_wakeup_pending(), but only looks at wakeup source events and leaves
+ * the event checking state alone, so that a following pm_wakeup_pending() call
+ * still reports them.
+ */
+bool pm_wakeup_events_pending(void)
+{
+	unsigned long flags;
+	bool ret = false;
+
+	raw_spin_lock_irqsave(&events_lock, flags);
+	if (events_check_enabled) {
+		unsigned int cnt, inpr;
+
+		split_counters(&cnt, &inpr);
+		ret = (cnt != saved_count || inpr > 0);
+	}
+	raw_spin_unlock_irqrestore(&events_lock, flags);
+
+	return ret;
+}
+
 void pm_system_wakeup(void)
 {
 	atomic_inc(&pm_abort_suspend);
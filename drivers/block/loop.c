@@ -81,6 +81,8 @@ struct loop_device {
 struct loop_cmd {
 	struct list_head list_entry;
 	bool use_aio; /* use AIO interface to handle I/O */
+	bool nowait; /* aio submitted from ->queue_rq with IOCB_NOWAIT */
+	bool blocked; /* nowait aio got -EAGAIN, retry from the worker */
 	atomic_t ref; /* only for aio */
 	long ret;
 	struct kiocb iocb;
@@ -341,6 +343,14 @@ static void lo_complete_rq(struct request *rq)
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
 	blk_status_t ret = BLK_STS_OK;
 
+	/* the backing file would have blocked, hand it to the worker */
+	if (cmd->nowait && cmd->ret == -EAGAIN) {
+		cmd->blocked = true;
+		cmd->ret = 0;
+		blk_mq_requeue_request(rq, true);
+		return;
+	}
+
 	if (!cmd->use_aio || cmd->ret < 0 || cmd->ret == blk_rq_bytes(rq) ||
 	    req_op(rq) != REQ_OP_READ) {
 		if (cmd->ret < 0)
@@ -411,9 +421,9 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	if (rq->bio != rq->biotail) {
 
 		bvec = kmalloc_array(nr_bvec, sizeof(struct bio_vec),
-				     GFP_NOIO);
+				     cmd->nowait ? GFP_NOWAIT : GFP_NOIO);
 		if (!bvec)
-			return -EIO;
+			return cmd->nowait ? -EAGAIN : -EIO;
 		cmd->bvec = bvec;
 
 		/*
@@ -446,6 +456,8 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	cmd->iocb.ki_filp = file;
 	cmd->iocb.ki_complete = lo_rw_aio_complete;
 	cmd->iocb.ki_flags = IOCB_DIRECT;
+	if (cmd->nowait)
+		cmd->iocb.ki_flags |= IOCB_NOWAIT;
 	cmd->iocb.ki_ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_NONE, 0);
 
 	if (rw == ITER_SOURCE)
@@ -453,6 +465,13 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	else
 		ret = call_read_iter(file, &cmd->iocb, &iter);
 
+	/* nothing was submitted, the caller falls back to the worker */
+	if (ret == -EAGAIN && cmd->nowait) {
+		kfree(cmd->bvec);
+		cmd->bvec = NULL;
+		return ret;
+	}
+
 	lo_rw_aio_do_completion(cmd);
 
 	if (ret != -EIOCBQUEUED)
@@ -1811,9 +1830,73 @@ static const struct kernel_param_ops loop_hw_qdepth_param_ops = {
 device_param_cb(hw_queue_depth, &loop_hw_qdepth_param_ops, &hw_queue_depth, 0444);
 MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default: " __stringify(LOOP_DEFAULT_HW_Q_DEPTH));
 
+static unsigned int nr_hw_queues = 1;
+module_param(nr_hw_queues, uint, 0444);
+MODULE_PARM_DESC(nr_hw_queues, "Number of hardware queues for each loop device. Default: 1");
+
+static bool nowait;
+module_param(nowait, bool, 0444);
+MODULE_PARM_DESC(nowait, "Submit direct IO to the backing file from the submitter with IOCB_NOWAIT, and only use the worker if it would block. Default: false");
+
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
+/*
+ * Issue direct IO to the backing file right from ->queue_rq, which saves
+ * the hop to the worker. Returns false if the command has to be handled
+ * by the worker instead, e.g. because the submission would block.
+ */
+static bool loop_try_nowait(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	loff_t pos = ((loff_t) blk_rq_pos(rq) << 9) + lo->lo_offset;
+	unsigned int throttle, noio_flags;
+	int rw, ret;
+
+	if (!nowait || !(lo->lo_backing_file->f_mode & FMODE_NOWAIT))
+		return false;
+
+	if (cmd->blocked) {
+		cmd->blocked = false;
+		return false;
+	}
+
+	switch (req_op(rq)) {
+	case REQ_OP_READ:
+		rw = ITER_DEST;
+		break;
+	case REQ_OP_WRITE:
+		/* let loop_handle_cmd() fail it */
+		if (lo->lo_flags & LO_FLAGS_READ_ONLY)
+			return false;
+		rw = ITER_SOURCE;
+		break;
+	default:
+		return false;
+	}
+
+	/*
+	 * Same as the worker: allocations for the backing file must not
+	 * recurse into writeback to this device, and its dirty pages are
+	 * throttled locally.
+	 */
+	throttle = current->flags & PF_LOCAL_THROTTLE;
+	current->flags |= PF_LOCAL_THROTTLE;
+	noio_flags = memalloc_noio_save();
+
+	cmd->nowait = true;
+	ret = lo_rw_aio(lo, cmd, pos, rw);
+
+	memalloc_noio_restore(noio_flags);
+	current->flags = (current->flags & ~PF_LOCAL_THROTTLE) | throttle;
+
+	if (ret == -EAGAIN) {
+		cmd->nowait = false;
+		return false;
+	}
+	return true;
+}
+
 static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		const struct blk_mq_queue_data *bd)
 {
@@ -1823,8 +1906,10 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 	blk_mq_start_request(rq);
 
-	if (lo->lo_state != Lo_bound)
+	if (lo->lo_state != Lo_bound) {
+		cmd->blocked = false;
 		return BLK_STS_IOERR;
+	}
 
 	switch (req_op(rq)) {
 	case REQ_OP_FLUSH:
@@ -1837,6 +1922,10 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		break;
 	}
 
+	cmd->nowait = false;
+	if (cmd->use_aio && loop_try_nowait(lo, cmd))
+		return BLK_STS_OK;
+
 	/* always use the first bio's css */
 	cmd->blkcg_css = NULL;
 	cmd->memcg_css = NULL;
@@ -1992,12 +2081,15 @@ static int loop_add(int i)
 	i = err;
 
 	lo->tag_set.ops = &loop_mq_ops;
-	lo->tag_set.nr_hw_queues = 1;
+	lo->tag_set.nr_hw_queues = clamp(nr_hw_queues, 1U, nr_cpu_ids);
 	lo->tag_set.queue_depth = hw_queue_depth;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
 	lo->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_STACKING |
 		BLK_MQ_F_NO_SCHED_BY_DEFAULT;
+	/* ->read_iter/->write_iter may still sleep even with IOCB_NOWAIT */
+	if (nowait)
+		lo->tag_set.flags |= BLK_MQ_F_BLOCKING;
 	lo->tag_set.driver_data = lo;
 
 	err = blk_mq_alloc_tag_set(&lo->tag_set);
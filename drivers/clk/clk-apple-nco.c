@@ -170,6 +170,20 @@ static int applnco_set_rate(struct clk_hw *hw, unsigned long rate,
 
 	spin_lock_irqsave(&chan->lock, flags);
 	was_enabled = applnco_is_enabled(hw);
+
+	/*
+	 * Small adjustments (clock recovery trims a few ppm at a time) keep
+	 * the coarse divisor, and only move the fractional increments. Those
+	 * can be updated on a running channel without restarting the
+	 * accumulator, so the output doesn't glitch.
+	 */
+	if (was_enabled && readl_relaxed(chan->base + REG_DIV) == div) {
+		writel_relaxed(inc1, chan->base + REG_INC1);
+		writel_relaxed(inc2, chan->base + REG_INC2);
+		spin_unlock_irqrestore(&chan->lock, flags);
+		return 0;
+	}
+
 	applnco_disable_nolock(hw);
 
 	writel_relaxed(div,  chan->base + REG_DIV);
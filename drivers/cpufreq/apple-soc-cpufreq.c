@@ -13,6 +13,7 @@
 #include <linux/cpufreq.h>
 #include <linux/cpumask.h>
 #include <linux/delay.h>
+#include <linux/energy_model.h>
 #include <linux/err.h>
 #include <linux/io.h>
 #include <linux/iopoll.h>
@@ -21,6 +22,7 @@
 #include <linux/of_address.h>
 #include <linux/pm_opp.h>
 #include <linux/slab.h>
+#include <linux/topology.h>
 
 #define APPLE_DVFS_CMD			0x20
 #define APPLE_DVFS_CMD_BUSY		BIT(31)
@@ -65,6 +67,9 @@ struct apple_cpu_priv {
 	struct device *cpu_dev;
 	void __iomem *reg_base;
 	const struct apple_soc_cpufreq_info *info;
+	/* last requested p-state, and the frequency the hardware capped it to */
+	int last_pstate;
+	unsigned int capped_freq;
 };
 
 static struct cpufreq_driver apple_soc_cpufreq_driver;
@@ -105,17 +110,33 @@ static const struct of_device_id apple_soc_cpufreq_of_match[] = {
 	{}
 };
 
+static unsigned int apple_soc_cpufreq_cur_pstate(struct apple_cpu_priv *priv)
+{
+	u64 reg = readq_relaxed(priv->reg_base + APPLE_DVFS_STATUS);
+
+	return (reg & priv->info->cur_pstate_mask) >> priv->info->cur_pstate_shift;
+}
+
+static unsigned int apple_soc_cpufreq_pstate_freq(struct cpufreq_policy *policy,
+						  unsigned int pstate)
+{
+	struct cpufreq_frequency_table *p;
+
+	cpufreq_for_each_valid_entry(p, policy->freq_table)
+		if (p->driver_data == pstate)
+			return p->frequency;
+
+	return 0;
+}
+
 static unsigned int apple_soc_cpufreq_get_rate(unsigned int cpu)
 {
 	struct cpufreq_policy *policy = cpufreq_cpu_get_raw(cpu);
 	struct apple_cpu_priv *priv = policy->driver_data;
-	struct cpufreq_frequency_table *p;
-	unsigned int pstate;
+	unsigned int freq, pstate;
 
 	if (priv->info->cur_pstate_mask) {
-		u64 reg = readq_relaxed(priv->reg_base + APPLE_DVFS_STATUS);
-
-		pstate = (reg & priv->info->cur_pstate_mask) >>  priv->info->cur_pstate_shift;
+		pstate = apple_soc_cpufreq_cur_pstate(priv);
 	} else {
 		/*
 		 * For the fallback case we might not know the layout of DVFS_STATUS,
@@ -126,13 +147,47 @@ static unsigned int apple_soc_cpufreq_get_rate(unsigned int cpu)
 		pstate = FIELD_GET(APPLE_DVFS_CMD_PS1, reg);
 	}
 
-	cpufreq_for_each_valid_entry(p, policy->freq_table)
-		if (p->driver_data == pstate)
-			return p->frequency;
+	freq = apple_soc_cpufreq_pstate_freq(policy, pstate);
+	if (!freq)
+		dev_err(priv->cpu_dev, "could not find frequency for pstate %d\n",
+			pstate);
+	return freq;
+}
 
-	dev_err(priv->cpu_dev, "could not find frequency for pstate %d\n",
-		pstate);
-	return 0;
+/*
+ * The cluster may deliver a lower p-state than requested, e.g. when boost
+ * states are not granted with several cores active. Once the previous request
+ * has been processed, compare the delivered p-state with it and report the
+ * shortfall to the scheduler as thermal pressure, so that capacity and the
+ * PELT-tracked pressure reflect what the hardware runs at.
+ */
+static void apple_soc_cpufreq_update_pressure(struct cpufreq_policy *policy)
+{
+	struct apple_cpu_priv *priv = policy->driver_data;
+	unsigned int pstate, freq = policy->cpuinfo.max_freq;
+
+	if (!priv->info->cur_pstate_mask || priv->last_pstate < 0)
+		return;
+
+	pstate = apple_soc_cpufreq_cur_pstate(priv);
+	if ((int)pstate < priv->last_pstate)
+		freq = apple_soc_cpufreq_pstate_freq(policy, pstate) ?: freq;
+
+	/*
+	 * cpufreq_cooling caps policy->max and sets the thermal pressure
+	 * for it, never report more capacity than that.
+	 */
+	freq = min(freq, policy->max);
+
+	/* no shortfall reported yet, so there is nothing to undo */
+	if (!priv->capped_freq && freq == policy->max)
+		return;
+
+	if (freq == priv->capped_freq)
+		return;
+
+	priv->capped_freq = freq;
+	arch_update_thermal_pressure(policy->related_cpus, freq);
 }
 
 static int apple_soc_cpufreq_set_target(struct cpufreq_policy *policy,
@@ -152,6 +207,9 @@ static int apple_soc_cpufreq_set_target(struct cpufreq_policy *policy,
 		return -EIO;
 	}
 
+	apple_soc_cpufreq_update_pressure(policy);
+	priv->last_pstate = pstate;
+
 	reg &= ~APPLE_DVFS_CMD_PS1;
 	reg |= FIELD_PREP(APPLE_DVFS_CMD_PS1, pstate);
 	if (priv->info->has_ps2) {
@@ -202,6 +260,56 @@ static int apple_soc_cpufreq_find_cluster(struct cpufreq_policy *policy,
 	return 0;
 }
 
+/*
+ * Fallback energy model for device trees that carry no power data in their
+ * OPP tables. Without per-OPP voltages we assume voltage scales linearly with
+ * frequency, so dynamic power goes as f^3, and weigh it by the core's
+ * capacity-dmips-mhz so that P-cores come out costlier than E-cores at the
+ * same clock. This is an abstract scale, only the ratios matter to EAS.
+ */
+static int apple_soc_cpufreq_est_power(struct device *cpu_dev, unsigned long *power,
+				       unsigned long *khz)
+{
+	unsigned long hz = *khz * 1000, mhz;
+	struct dev_pm_opp *opp;
+	u32 dmips = SCHED_CAPACITY_SCALE;
+	u64 est;
+
+	opp = dev_pm_opp_find_freq_ceil(cpu_dev, &hz);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+	dev_pm_opp_put(opp);
+
+	of_property_read_u32(cpu_dev->of_node, "capacity-dmips-mhz", &dmips);
+
+	mhz = hz / 1000000;
+	est = div_u64((u64)dmips * mhz * mhz * mhz, 1000000);
+
+	*khz = hz / 1000;
+	*power = clamp_t(u64, est, 1, EM_MAX_POWER);
+
+	return 0;
+}
+
+static void apple_soc_cpufreq_register_em(struct cpufreq_policy *policy)
+{
+	struct em_data_callback em_cb = EM_DATA_CB(apple_soc_cpufreq_est_power);
+	struct apple_cpu_priv *priv = policy->driver_data;
+	int nr_opp;
+
+	cpufreq_register_em_with_opp(policy);
+	if (em_cpu_get(policy->cpu))
+		return;
+
+	nr_opp = dev_pm_opp_get_opp_count(priv->cpu_dev);
+	if (nr_opp <= 0)
+		return;
+
+	if (em_dev_register_perf_domain(priv->cpu_dev, nr_opp, &em_cb,
+					policy->related_cpus, false))
+		dev_warn(priv->cpu_dev, "failed to register estimated energy model\n");
+}
+
 static struct freq_attr *apple_soc_cpufreq_hw_attr[] = {
 	&cpufreq_freq_attr_scaling_available_freqs,
 	NULL, /* Filled in below if boost is enabled */
@@ -277,6 +385,7 @@ static int apple_soc_cpufreq_init(struct cpufreq_policy *policy)
 	priv->cpu_dev = cpu_dev;
 	priv->reg_base = reg_base;
 	priv->info = info;
+	priv->last_pstate = -1;
 	policy->driver_data = priv;
 	policy->freq_table = freq_table;
 
@@ -316,6 +425,10 @@ static int apple_soc_cpufreq_exit(struct cpufreq_policy *policy)
 {
 	struct apple_cpu_priv *priv = policy->driver_data;
 
+	if (priv->capped_freq)
+		arch_update_thermal_pressure(policy->related_cpus,
+					     policy->cpuinfo.max_freq);
+
 	dev_pm_opp_free_cpufreq_table(priv->cpu_dev, &policy->freq_table);
 	dev_pm_opp_remove_all_dynamic(priv->cpu_dev);
 	iounmap(priv->reg_base);
@@ -334,7 +447,7 @@ static struct cpufreq_driver apple_soc_cpufreq_driver = {
 	.exit		= apple_soc_cpufreq_exit,
 	.target_index	= apple_soc_cpufreq_set_target,
 	.fast_switch	= apple_soc_cpufreq_fast_switch,
-	.register_em	= cpufreq_register_em_with_opp,
+	.register_em	= apple_soc_cpufreq_register_em,
 	.attr		= apple_soc_cpufreq_hw_attr,
 	.suspend	= cpufreq_generic_suspend,
 };
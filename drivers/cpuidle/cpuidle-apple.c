@@ -6,12 +6,33 @@
  */
 
 #include <linux/init.h>
+#include <linux/completion.h>
+#include <linux/cpu.h>
 #include <linux/cpuidle.h>
 #include <linux/cpu_pm.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
+#include <linux/topology.h>
+#include <linux/workqueue.h>
 #include <asm/cpuidle.h>
 
+/*
+ * Boot-time calibration: every CPU of a cluster is parked in the state
+ * being measured, so the cluster itself can fold, and one of them is then
+ * woken by an IPI from a CPU outside the cluster.
+ */
+#define APPLE_IDLE_CALIB_SAMPLES	8
+#define APPLE_IDLE_CALIB_SETTLE_US	200
+/* A state must be held this many times its own entry + exit cost */
+#define APPLE_IDLE_RESIDENCY_FACTOR	10
+
+static bool calibrate = true;
+module_param(calibrate, bool, 0444);
+MODULE_PARM_DESC(calibrate, "Measure idle state latencies at boot (default: true)");
+
 enum idle_state {
 	STATE_WFI,
 	STATE_PWRDOWN,
@@ -57,16 +78,8 @@ asm(
 
 void apple_cpu_deep_wfi(void);
 
-static __cpuidle int apple_enter_idle(struct cpuidle_device *dev, struct cpuidle_driver *drv, int index)
+static __always_inline void apple_idle_do_state(int index)
 {
-	/*
-	 * Deep WFI will clobber FP state, among other things.
-	 * The CPU PM notifier will take care of saving that and anything else
-	 * that needs to be notified of the CPU powering down.
-	 */
-	if (cpu_pm_enter())
-		return -1;
-
 	switch(index) {
 	case STATE_WFI:
 		cpu_do_idle();
@@ -78,6 +91,19 @@ static __cpuidle int apple_enter_idle(struct cpuidle_device *dev, struct cpuidle
 		WARN_ON(1);
 		break;
 	}
+}
+
+static __cpuidle int apple_enter_idle(struct cpuidle_device *dev, struct cpuidle_driver *drv, int index)
+{
+	/*
+	 * Deep WFI will clobber FP state, among other things.
+	 * The CPU PM notifier will take care of saving that and anything else
+	 * that needs to be notified of the CPU powering down.
+	 */
+	if (cpu_pm_enter())
+		return -1;
+
+	apple_idle_do_state(index);
 
 	cpu_pm_exit();
 
@@ -111,9 +137,245 @@ static struct cpuidle_driver apple_idle_driver = {
 	.state_count = STATE_COUNT,
 };
 
+struct apple_idle_calib {
+	struct work_struct work;
+	struct completion done;
+	atomic_t armed;
+	int state;
+	int err;
+	u64 t_enter;
+	u64 t_idle;
+	u64 t_exit;
+};
+
+static DEFINE_PER_CPU(struct apple_idle_calib, apple_idle_calib);
+
+struct apple_idle_cluster {
+	struct device *dev;
+	struct cpuidle_driver *drv;
+	struct cpumask *cpus;
+	unsigned int cpu;
+};
+
+static void apple_idle_calib_work(struct work_struct *work)
+{
+	struct apple_idle_calib *c = container_of(work, struct apple_idle_calib, work);
+
+	/* Mirror the idle path: IRQs stay masked, a pending one ends WFI */
+	local_irq_disable();
+	c->t_enter = ktime_get_ns();
+	c->err = cpu_pm_enter();
+	if (!c->err) {
+		c->t_idle = ktime_get_ns();
+		atomic_set_release(&c->armed, 1);
+		apple_idle_do_state(c->state);
+		cpu_pm_exit();
+		c->t_exit = ktime_get_ns();
+	} else {
+		atomic_set_release(&c->armed, 1);
+	}
+	local_irq_enable();
+
+	complete(&c->done);
+}
+
+static void apple_idle_calib_wake(void *info)
+{
+}
+
+static int apple_idle_calib_sample(struct apple_idle_cluster *cl, int state,
+				   u64 *entry, u64 *exit)
+{
+	struct apple_idle_calib *c;
+	unsigned int cpu;
+	u64 t_send;
+	int err = 0;
+
+	for_each_cpu(cpu, cl->cpus) {
+		c = per_cpu_ptr(&apple_idle_calib, cpu);
+		INIT_WORK(&c->work, apple_idle_calib_work);
+		init_completion(&c->done);
+		atomic_set(&c->armed, 0);
+		c->state = state;
+		queue_work_on(cpu, system_highpri_wq, &c->work);
+	}
+
+	for_each_cpu(cpu, cl->cpus) {
+		c = per_cpu_ptr(&apple_idle_calib, cpu);
+		while (!atomic_read_acquire(&c->armed))
+			cond_resched();
+	}
+
+	/* Give the cores, and then the cluster, time to actually power down */
+	udelay(APPLE_IDLE_CALIB_SETTLE_US);
+
+	c = per_cpu_ptr(&apple_idle_calib, cl->cpu);
+	preempt_disable();
+	t_send = ktime_get_ns();
+	smp_call_function_single(cl->cpu, apple_idle_calib_wake, NULL, 0);
+	preempt_enable();
+	wait_for_completion(&c->done);
+
+	preempt_disable();
+	smp_call_function_many(cl->cpus, apple_idle_calib_wake, NULL, false);
+	preempt_enable();
+
+	for_each_cpu(cpu, cl->cpus) {
+		struct apple_idle_calib *o = per_cpu_ptr(&apple_idle_calib, cpu);
+
+		wait_for_completion(&o->done);
+		if (o->err && !err)
+			err = o->err;
+	}
+	if (err)
+		return err;
+
+	*entry = c->t_idle - c->t_enter;
+	*exit = c->t_exit > t_send ? c->t_exit - t_send : 0;
+
+	return 0;
+}
+
+static int apple_idle_calib_cluster(void *data)
+{
+	struct apple_idle_cluster *cl = data;
+	int state, i, ret;
+
+	for (state = 0; state < STATE_COUNT; state++) {
+		struct cpuidle_state *s = &cl->drv->states[state];
+		u64 entry = 0, exit = 0;
+
+		for (i = 0; i < APPLE_IDLE_CALIB_SAMPLES; i++) {
+			u64 e, x;
+
+			ret = apple_idle_calib_sample(cl, state, &e, &x);
+			if (ret)
+				return ret;
+
+			/* IRQ latency budgets care about the worst case */
+			entry = max(entry, e);
+			exit = max(exit, x);
+		}
+
+		s->exit_latency = 0;
+		s->exit_latency_ns = max_t(u64, exit, NSEC_PER_USEC);
+		s->target_residency = 0;
+		s->target_residency_ns = max_t(u64, s->exit_latency_ns,
+					       APPLE_IDLE_RESIDENCY_FACTOR * (entry + exit));
+
+		dev_info(cl->dev, "cpu%u %s: entry %llu ns, exit %llu ns, residency %llu ns\n",
+			 cl->cpu, s->name, entry, exit, s->target_residency_ns);
+	}
+
+	return 0;
+}
+
+static int apple_cpuidle_calibrate(struct device *dev, struct cpuidle_driver *drv)
+{
+	struct apple_idle_cluster cl = {
+		.dev = dev,
+		.drv = drv,
+	};
+	cpumask_var_t cpus, others;
+	unsigned int sender;
+	int ret = -ENODEV;
+
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		return -ENOMEM;
+	if (!zalloc_cpumask_var(&others, GFP_KERNEL)) {
+		free_cpumask_var(cpus);
+		return -ENOMEM;
+	}
+
+	cpus_read_lock();
+
+	cpumask_and(cpus, drv->cpumask, cpu_online_mask);
+	cpumask_andnot(others, cpu_online_mask, cpus);
+
+	/*
+	 * Prefer a sender outside the cluster so the whole cluster can power
+	 * down; otherwise borrow one of its CPUs and measure core-level exit.
+	 */
+	sender = cpumask_first(others);
+	if (sender >= nr_cpu_ids && cpumask_weight(cpus) > 1)
+		sender = cpumask_last(cpus);
+	if (sender >= nr_cpu_ids)
+		goto out;
+
+	cpumask_clear_cpu(sender, cpus);
+	cl.cpus = cpus;
+	cl.cpu = cpumask_first(cpus);
+
+	ret = smp_call_on_cpu(sender, apple_idle_calib_cluster, &cl, false);
+
+out:
+	cpus_read_unlock();
+	free_cpumask_var(others);
+	free_cpumask_var(cpus);
+
+	return ret;
+}
+
+static void apple_cpuidle_unregister(void *data)
+{
+	cpuidle_unregister(data);
+}
+
 static int apple_cpuidle_probe(struct platform_device *pdev)
 {
-	return cpuidle_register(&apple_idle_driver, NULL);
+	struct device *dev = &pdev->dev;
+	cpumask_var_t covered;
+	unsigned int cpu;
+	int ret = 0;
+
+	if (!zalloc_cpumask_var(&covered, GFP_KERNEL))
+		return -ENOMEM;
+
+	/*
+	 * One driver per cluster: P and E clusters have different wakeup
+	 * costs, and cluster power-down is only reached once every core in it
+	 * sits in deep WFI, which the hardware coordinates by itself.
+	 */
+	for_each_possible_cpu(cpu) {
+		struct cpuidle_driver *drv;
+		struct cpumask *mask;
+
+		if (cpumask_test_cpu(cpu, covered))
+			continue;
+
+		drv = devm_kmemdup(dev, &apple_idle_driver, sizeof(*drv), GFP_KERNEL);
+		mask = devm_kzalloc(dev, cpumask_size(), GFP_KERNEL);
+		if (!drv || !mask) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		cpumask_and(mask, topology_cluster_cpumask(cpu), cpu_possible_mask);
+		cpumask_set_cpu(cpu, mask);
+		cpumask_andnot(mask, mask, covered);
+		drv->cpumask = mask;
+
+		if (calibrate) {
+			ret = apple_cpuidle_calibrate(dev, drv);
+			if (ret)
+				dev_warn(dev, "cpu%u: calibration failed (%d), using defaults\n",
+					 cpu, ret);
+		}
+
+		ret = cpuidle_register(drv, NULL);
+		if (ret)
+			break;
+
+		ret = devm_add_action_or_reset(dev, apple_cpuidle_unregister, drv);
+		if (ret)
+			break;
+
+		cpumask_or(covered, covered, mask);
+	}
+
+	free_cpumask_var(covered);
+
+	return ret;
 }
 
 static struct platform_driver apple_cpuidle_driver = {
@@ -42,6 +42,16 @@ struct dma_buf_list {
 
 static struct dma_buf_list db_list;
 
+/*
+ * Attachments whose cached mapping is not mapped by the importer right now,
+ * oldest first.  The mapping is kept so that the next map does not have to
+ * rebuild IOMMU page tables, and is released by dma_buf_shrinker if memory
+ * gets tight.
+ */
+static LIST_HEAD(dma_buf_cached_lru);
+static DEFINE_SPINLOCK(dma_buf_cached_lock);
+static unsigned long dma_buf_cached_count;
+
 static char *dmabuffs_dname(struct dentry *dentry, char *buffer, int buflen)
 {
 	struct dma_buf *dmabuf;
@@ -910,6 +920,7 @@ dma_buf_dynamic_attach(struct dma_buf *dmabuf, struct device *dev,
 
 	attach->dev = dev;
 	attach->dmabuf = dmabuf;
+	INIT_LIST_HEAD(&attach->lru);
 	if (importer_ops)
 		attach->peer2peer = importer_ops->allow_peer2peer;
 	attach->importer_ops = importer_ops;
@@ -984,6 +995,47 @@ struct dma_buf_attachment *dma_buf_attach(struct dma_buf *dmabuf,
 }
 EXPORT_SYMBOL_NS_GPL(dma_buf_attach, DMA_BUF);
 
+/*
+ * Only mappings cached because the exporter asked for it are given back to the
+ * shrinker, the ones dma_buf_dynamic_attach() sets up have to stay. Static
+ * importers of a dynamic exporter hold a pin for as long as the mapping is
+ * cached, which dma_buf_detach() only drops if attach->sgt is still set, so
+ * those stay too.
+ */
+static bool dma_buf_cache_reclaimable(struct dma_buf_attachment *attach)
+{
+	return attach->dmabuf->ops->cache_sgt_mapping &&
+	       !dma_buf_attachment_is_dynamic(attach) &&
+	       !dma_buf_is_dynamic(attach->dmabuf);
+}
+
+static void dma_buf_cache_get(struct dma_buf_attachment *attach)
+{
+	if (attach->map_count++ || !dma_buf_cache_reclaimable(attach))
+		return;
+
+	spin_lock(&dma_buf_cached_lock);
+	if (!list_empty(&attach->lru)) {
+		list_del_init(&attach->lru);
+		dma_buf_cached_count--;
+	}
+	spin_unlock(&dma_buf_cached_lock);
+}
+
+static void dma_buf_cache_put(struct dma_buf_attachment *attach)
+{
+	if (WARN_ON(!attach->map_count))
+		return;
+
+	if (--attach->map_count || !dma_buf_cache_reclaimable(attach))
+		return;
+
+	spin_lock(&dma_buf_cached_lock);
+	list_add_tail(&attach->lru, &dma_buf_cached_lru);
+	dma_buf_cached_count++;
+	spin_unlock(&dma_buf_cached_lock);
+}
+
 static void __unmap_dma_buf(struct dma_buf_attachment *attach,
 			    struct sg_table *sg_table,
 			    enum dma_data_direction direction)
@@ -1011,6 +1063,12 @@ void dma_buf_detach(struct dma_buf *dmabuf, struct dma_buf_attachment *attach)
 	dma_resv_lock(dmabuf->resv, NULL);
 
 	if (attach->sgt) {
+		spin_lock(&dma_buf_cached_lock);
+		if (!list_empty(&attach->lru)) {
+			list_del(&attach->lru);
+			dma_buf_cached_count--;
+		}
+		spin_unlock(&dma_buf_cached_lock);
 
 		__unmap_dma_buf(attach, attach->sgt, attach->dir);
 
@@ -1122,6 +1180,7 @@ struct sg_table *dma_buf_map_attachment(struct dma_buf_attachment *attach,
 		    attach->dir != DMA_BIDIRECTIONAL)
 			return ERR_PTR(-EBUSY);
 
+		dma_buf_cache_get(attach);
 		return attach->sgt;
 	}
 
@@ -1144,6 +1203,7 @@ struct sg_table *dma_buf_map_attachment(struct dma_buf_attachment *attach,
 	if (!IS_ERR(sg_table) && attach->dmabuf->ops->cache_sgt_mapping) {
 		attach->sgt = sg_table;
 		attach->dir = direction;
+		dma_buf_cache_get(attach);
 	}
 
 #ifdef CONFIG_DMA_API_DEBUG
@@ -1216,8 +1276,10 @@ void dma_buf_unmap_attachment(struct dma_buf_attachment *attach,
 
 	dma_resv_assert_held(attach->dmabuf->resv);
 
-	if (attach->sgt == sg_table)
+	if (attach->sgt == sg_table) {
+		dma_buf_cache_put(attach);
 		return;
+	}
 
 	__unmap_dma_buf(attach, sg_table, direction);
 
@@ -1717,6 +1779,55 @@ static inline void dma_buf_uninit_debugfs(void)
 }
 #endif
 
+static unsigned long dma_buf_shrink_count(struct shrinker *shrinker,
+					  struct shrink_control *sc)
+{
+	return READ_ONCE(dma_buf_cached_count) ?: SHRINK_EMPTY;
+}
+
+static unsigned long dma_buf_shrink_scan(struct shrinker *shrinker,
+					 struct shrink_control *sc)
+{
+	struct dma_buf_attachment *attach;
+	unsigned long scanned, freed = 0;
+	struct dma_resv *resv;
+
+	spin_lock(&dma_buf_cached_lock);
+	for (scanned = 0; scanned < sc->nr_to_scan; scanned++) {
+		attach = list_first_entry_or_null(&dma_buf_cached_lru,
+						  typeof(*attach), lru);
+		if (!attach)
+			break;
+
+		/* the reverse of the lock order in dma_buf_detach() */
+		resv = attach->dmabuf->resv;
+		if (!dma_resv_trylock(resv)) {
+			list_move_tail(&attach->lru, &dma_buf_cached_lru);
+			continue;
+		}
+		list_del_init(&attach->lru);
+		dma_buf_cached_count--;
+		spin_unlock(&dma_buf_cached_lock);
+
+		__unmap_dma_buf(attach, attach->sgt, attach->dir);
+		attach->sgt = NULL;
+		/* attach may be detached and freed as soon as this drops */
+		dma_resv_unlock(resv);
+		freed++;
+
+		spin_lock(&dma_buf_cached_lock);
+	}
+	spin_unlock(&dma_buf_cached_lock);
+
+	return freed ?: SHRINK_STOP;
+}
+
+static struct shrinker dma_buf_shrinker = {
+	.count_objects = dma_buf_shrink_count,
+	.scan_objects = dma_buf_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static int __init dma_buf_init(void)
 {
 	int ret;
@@ -1725,6 +1836,10 @@ static int __init dma_buf_init(void)
 	if (ret)
 		return ret;
 
+	ret = register_shrinker(&dma_buf_shrinker, "dma-buf-mappings");
+	if (ret)
+		return ret;
+
 	dma_buf_mnt = kern_mount(&dma_buf_fs_type);
 	if (IS_ERR(dma_buf_mnt))
 		return PTR_ERR(dma_buf_mnt);
@@ -1739,6 +1854,7 @@ subsys_initcall(dma_buf_init);
 static void __exit dma_buf_deinit(void)
 {
 	dma_buf_uninit_debugfs();
+	unregister_shrinker(&dma_buf_shrinker);
 	kern_unmount(dma_buf_mnt);
 	dma_buf_uninit_sysfs_statistics();
 }
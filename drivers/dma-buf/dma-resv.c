@@ -35,6 +35,7 @@
 
 #include <linux/dma-resv.h>
 #include <linux/dma-fence-array.h>
+#include <linux/dma-fence-unwrap.h>
 #include <linux/export.h>
 #include <linux/mm.h>
 #include <linux/sched/mm.h>
@@ -633,6 +634,9 @@ int dma_resv_get_singleton(struct dma_resv *obj, enum dma_resv_usage usage,
 		return 0;
 	}
 
+	if (count > 1)
+		count = dma_fence_dedup_array(fences, count);
+
 	if (count == 1) {
 		*fence = fences[0];
 		kfree(fences);
@@ -70,6 +70,8 @@
 #define CHAN_FIFOCTL_LIMIT	GENMASK(31, 16)
 #define CHAN_FIFOCTL_THRESHOLD	GENMASK(15, 0)
 
+#define ADMAC_FIFO_THRESHOLD_WORDS	0x18
+
 #define REG_DESC_WRITE(ch)	(0x10000 + ((ch) / 2) * 0x4 + ((ch) & 1) * 0x4000)
 #define REG_REPORT_READ(ch)	(0x10100 + ((ch) / 2) * 0x4 + ((ch) & 1) * 0x4000)
 
@@ -103,6 +105,9 @@ struct admac_chan {
 	struct list_head submitted;
 	struct list_head issued;
 
+	/* completed slave_sg transactions awaiting their callback */
+	struct list_head done;
+
 	struct list_head to_free;
 };
 
@@ -130,6 +135,11 @@ struct admac_data {
 	struct admac_chan channels[];
 };
 
+struct admac_sg {
+	dma_addr_t addr;
+	u32 len;
+};
+
 struct admac_tx {
 	struct dma_async_tx_descriptor tx;
 	bool cyclic;
@@ -142,6 +152,12 @@ struct admac_tx {
 	size_t reclaimed_pos;
 
 	struct list_head node;
+
+	/* slave_sg only, one hardware descriptor per segment */
+	unsigned int nsegs;
+	unsigned int submitted_segs;
+	unsigned int reclaimed_segs;
+	struct admac_sg segs[];
 };
 
 static int admac_alloc_sram_carveout(struct admac_data *ad,
@@ -276,6 +292,38 @@ static struct dma_async_tx_descriptor *admac_prep_dma_cyclic(
 	return &adtx->tx;
 }
 
+static struct dma_async_tx_descriptor *admac_prep_slave_sg(
+		struct dma_chan *chan, struct scatterlist *sgl,
+		unsigned int sg_len, enum dma_transfer_direction direction,
+		unsigned long flags, void *context)
+{
+	struct admac_chan *adchan = to_admac_chan(chan);
+	struct scatterlist *sg;
+	struct admac_tx *adtx;
+	unsigned int i;
+
+	if (direction != admac_chan_direction(adchan->no) || !sg_len)
+		return NULL;
+
+	adtx = kzalloc(struct_size(adtx, segs, sg_len), GFP_NOWAIT);
+	if (!adtx)
+		return NULL;
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		adtx->segs[i].addr = sg_dma_address(sg);
+		adtx->segs[i].len = sg_dma_len(sg);
+		adtx->buf_len += sg_dma_len(sg);
+	}
+	adtx->nsegs = sg_len;
+
+	dma_async_tx_descriptor_init(&adtx->tx, chan);
+	adtx->tx.flags = flags;
+	adtx->tx.tx_submit = admac_tx_submit;
+	adtx->tx.desc_free = admac_desc_free;
+
+	return &adtx->tx;
+}
+
 /*
  * Write one hardware descriptor for a dmaengine cyclic transaction.
  */
@@ -302,18 +350,51 @@ static void admac_cyclic_write_one_desc(struct admac_data *ad, int channo,
 }
 
 /*
- * Write all the hardware descriptors for a dmaengine cyclic
- * transaction there is space for.
+ * Write the hardware descriptor for the next segment of a slave_sg
+ * transaction. Every segment reports completion so we know when the
+ * transaction is done.
+ */
+static void admac_sg_write_one_desc(struct admac_data *ad, int channo,
+				    struct admac_tx *tx)
+{
+	struct admac_sg *seg = &tx->segs[tx->submitted_segs++];
+
+	dev_dbg(ad->dev, "ch%d descriptor: addr=0x%pad len=0x%x flags=0x%lx\n",
+		channo, &seg->addr, seg->len, FLAG_DESC_NOTIFY);
+
+	writel_relaxed(lower_32_bits(seg->addr), ad->base + REG_DESC_WRITE(channo));
+	writel_relaxed(upper_32_bits(seg->addr), ad->base + REG_DESC_WRITE(channo));
+	writel_relaxed(seg->len,                 ad->base + REG_DESC_WRITE(channo));
+	writel_relaxed(FLAG_DESC_NOTIFY,         ad->base + REG_DESC_WRITE(channo));
+}
+
+static bool admac_tx_has_desc(struct admac_tx *tx)
+{
+	return tx->cyclic || tx->submitted_segs < tx->nsegs;
+}
+
+static void admac_write_one_desc(struct admac_data *ad, int channo,
+				 struct admac_tx *tx)
+{
+	if (tx->cyclic)
+		admac_cyclic_write_one_desc(ad, channo, tx);
+	else
+		admac_sg_write_one_desc(ad, channo, tx);
+}
+
+/*
+ * Write all the hardware descriptors for a dmaengine transaction there
+ * is space for.
  */
 static void admac_cyclic_write_desc(struct admac_data *ad, int channo,
 				    struct admac_tx *tx)
 {
 	int i;
 
-	for (i = 0; i < 4; i++) {
+	for (i = 0; i < 4 && admac_tx_has_desc(tx); i++) {
 		if (readl_relaxed(ad->base + REG_DESC_RING(channo)) & RING_FULL)
 			break;
-		admac_cyclic_write_one_desc(ad, channo, tx);
+		admac_write_one_desc(ad, channo, tx);
 	}
 }
 
@@ -366,6 +447,28 @@ static u32 admac_cyclic_read_residue(struct admac_data *ad, int channo,
 	return adtx->buf_len - pos % adtx->buf_len;
 }
 
+/*
+ * Residue of a slave_sg transaction: the segments not yet reported done,
+ * less what the controller already moved of the one in flight.
+ */
+static u32 admac_sg_read_residue(struct admac_data *ad, int channo,
+				 struct admac_tx *adtx)
+{
+	u32 residue = 0, inflight;
+	unsigned int i;
+
+	for (i = adtx->reclaimed_segs; i < adtx->nsegs; i++)
+		residue += adtx->segs[i].len;
+
+	if (adtx->reclaimed_segs < adtx->submitted_segs) {
+		inflight = readl_relaxed(ad->base + REG_RESIDUE(channo));
+		residue -= adtx->segs[adtx->reclaimed_segs].len -
+			   min(inflight, adtx->segs[adtx->reclaimed_segs].len);
+	}
+
+	return residue;
+}
+
 static enum dma_status admac_tx_status(struct dma_chan *chan, dma_cookie_t cookie,
 				       struct dma_tx_state *txstate)
 {
@@ -386,7 +489,10 @@ static enum dma_status admac_tx_status(struct dma_chan *chan, dma_cookie_t cooki
 
 	if (adtx && adtx->tx.cookie == cookie) {
 		ret = DMA_IN_PROGRESS;
-		residue = admac_cyclic_read_residue(ad, adchan->no, adtx);
+		if (adtx->cyclic)
+			residue = admac_cyclic_read_residue(ad, adchan->no, adtx);
+		else
+			residue = admac_sg_read_residue(ad, adchan->no, adtx);
 	} else {
 		ret = DMA_IN_PROGRESS;
 		residue = 0;
@@ -461,27 +567,35 @@ static void admac_start_current_tx(struct admac_chan *adchan)
 	admac_reset_rings(adchan);
 	writel_relaxed(0, ad->base + REG_CHAN_CTL(ch));
 
-	admac_cyclic_write_one_desc(ad, ch, adchan->current_tx);
+	admac_write_one_desc(ad, ch, adchan->current_tx);
 	admac_start_chan(adchan);
 	admac_cyclic_write_desc(ad, ch, adchan->current_tx);
 }
 
+/* Called with the channel lock held */
+static void admac_start_next_tx(struct admac_chan *adchan)
+{
+	struct admac_tx *tx;
+
+	if (list_empty(&adchan->issued) || adchan->current_tx)
+		return;
+
+	tx = list_first_entry(&adchan->issued, struct admac_tx, node);
+	list_del(&tx->node);
+
+	adchan->current_tx = tx;
+	adchan->nperiod_acks = 0;
+	admac_start_current_tx(adchan);
+}
+
 static void admac_issue_pending(struct dma_chan *chan)
 {
 	struct admac_chan *adchan = to_admac_chan(chan);
-	struct admac_tx *tx;
 	unsigned long flags;
 
 	spin_lock_irqsave(&adchan->lock, flags);
 	list_splice_tail_init(&adchan->submitted, &adchan->issued);
-	if (!list_empty(&adchan->issued) && !adchan->current_tx) {
-		tx = list_first_entry(&adchan->issued, struct admac_tx, node);
-		list_del(&tx->node);
-
-		adchan->current_tx = tx;
-		adchan->nperiod_acks = 0;
-		admac_start_current_tx(adchan);
-	}
+	admac_start_next_tx(adchan);
 	spin_unlock_irqrestore(&adchan->lock, flags);
 }
 
@@ -522,6 +636,7 @@ static int admac_terminate_all(struct dma_chan *chan)
 	 */
 	list_splice_tail_init(&adchan->submitted, &adchan->to_free);
 	list_splice_tail_init(&adchan->issued, &adchan->to_free);
+	list_splice_tail_init(&adchan->done, &adchan->to_free);
 	spin_unlock_irqrestore(&adchan->lock, flags);
 
 	return 0;
@@ -649,7 +764,7 @@ static void admac_handle_status_desc_done(struct admac_data *ad, int channo)
 	spin_lock_irqsave(&adchan->lock, flags);
 	nreports = admac_drain_reports(ad, channo);
 
-	if (adchan->current_tx) {
+	if (adchan->current_tx && adchan->current_tx->cyclic) {
 		struct admac_tx *tx = adchan->current_tx;
 
 		adchan->nperiod_acks += nreports;
@@ -658,6 +773,26 @@ static void admac_handle_status_desc_done(struct admac_data *ad, int channo)
 
 		admac_cyclic_write_desc(ad, channo, tx);
 		tasklet_schedule(&adchan->tasklet);
+	} else if (adchan->current_tx) {
+		struct admac_tx *tx = adchan->current_tx;
+
+		tx->reclaimed_segs = min(tx->reclaimed_segs + nreports,
+					 tx->submitted_segs);
+
+		if (tx->reclaimed_segs < tx->nsegs) {
+			admac_cyclic_write_desc(ad, channo, tx);
+		} else {
+			dma_cookie_complete(&tx->tx);
+			list_add_tail(&tx->node, &adchan->done);
+			adchan->current_tx = NULL;
+
+			if (list_empty(&adchan->issued))
+				admac_stop_chan(adchan);
+			else
+				admac_start_next_tx(adchan);
+
+			tasklet_schedule(&adchan->tasklet);
+		}
 	}
 	spin_unlock_irqrestore(&adchan->lock, flags);
 }
@@ -713,19 +848,30 @@ static void admac_chan_tasklet(struct tasklet_struct *t)
 	struct admac_tx *adtx;
 	struct dmaengine_desc_callback cb;
 	struct dmaengine_result tx_result;
+	struct admac_tx *done_tx, *_done_tx;
+	LIST_HEAD(done);
 	int nacks;
 
+	tx_result.result = DMA_TRANS_NOERROR;
+	tx_result.residue = 0;
+
 	spin_lock_irq(&adchan->lock);
+	list_splice_tail_init(&adchan->done, &done);
 	adtx = adchan->current_tx;
 	nacks = adchan->nperiod_acks;
 	adchan->nperiod_acks = 0;
 	spin_unlock_irq(&adchan->lock);
 
-	if (!adtx || !nacks)
-		return;
+	list_for_each_entry_safe(done_tx, _done_tx, &done, node) {
+		list_del(&done_tx->node);
+		dmaengine_desc_get_callback(&done_tx->tx, &cb);
+		dmaengine_desc_callback_invoke(&cb, &tx_result);
+		dma_run_dependencies(&done_tx->tx);
+		admac_desc_free(&done_tx->tx);
+	}
 
-	tx_result.result = DMA_TRANS_NOERROR;
-	tx_result.residue = 0;
+	if (!adtx || !adtx->cyclic || !nacks)
+		return;
 
 	dmaengine_desc_get_callback(&adtx->tx, &cb);
 	while (nacks--)
@@ -740,6 +886,7 @@ static int admac_device_config(struct dma_chan *chan,
 	bool is_tx = admac_chan_direction(adchan->no) == DMA_MEM_TO_DEV;
 	int wordsize = 0;
 	u32 bus_width = 0;
+	u32 maxburst;
 
 	switch (is_tx ? config->dst_addr_width : config->src_addr_width) {
 	case DMA_SLAVE_BUSWIDTH_1_BYTE:
@@ -785,10 +932,17 @@ static int admac_device_config(struct dma_chan *chan,
 	 * held in controller's per-channel FIFO. Transfers seem to be triggered
 	 * around the time FIFO occupancy touches FIFOCTL_THRESHOLD.
 	 *
-	 * The numbers we set are more or less arbitrary.
+	 * The default numbers are more or less arbitrary. A client asking for a
+	 * smaller maxburst (e.g. for sub-millisecond audio periods) gets a
+	 * proportionally shallower FIFO, so that less data sits in flight
+	 * between memory and the peripheral.
 	 */
-	writel_relaxed(FIELD_PREP(CHAN_FIFOCTL_LIMIT, 0x30 * wordsize)
-		       | FIELD_PREP(CHAN_FIFOCTL_THRESHOLD, 0x18 * wordsize),
+	maxburst = is_tx ? config->dst_maxburst : config->src_maxburst;
+	if (!maxburst || maxburst > ADMAC_FIFO_THRESHOLD_WORDS)
+		maxburst = ADMAC_FIFO_THRESHOLD_WORDS;
+
+	writel_relaxed(FIELD_PREP(CHAN_FIFOCTL_LIMIT, 2 * maxburst * wordsize)
+		       | FIELD_PREP(CHAN_FIFOCTL_THRESHOLD, maxburst * wordsize),
 		       ad->base + REG_CHAN_FIFOCTL(adchan->no));
 
 	return 0;
@@ -846,6 +1000,7 @@ static int admac_probe(struct platform_device *pdev)
 
 	dma_cap_set(DMA_PRIVATE, dma->cap_mask);
 	dma_cap_set(DMA_CYCLIC, dma->cap_mask);
+	dma_cap_set(DMA_SLAVE, dma->cap_mask);
 
 	dma->dev = &pdev->dev;
 	dma->device_alloc_chan_resources = admac_alloc_chan_resources;
@@ -855,6 +1010,7 @@ static int admac_probe(struct platform_device *pdev)
 	dma->device_terminate_all = admac_terminate_all;
 	dma->device_synchronize = admac_synchronize;
 	dma->device_prep_dma_cyclic = admac_prep_dma_cyclic;
+	dma->device_prep_slave_sg = admac_prep_slave_sg;
 	dma->device_config = admac_device_config;
 	dma->device_pause = admac_pause;
 	dma->device_resume = admac_resume;
@@ -878,6 +1034,7 @@ static int admac_probe(struct platform_device *pdev)
 		spin_lock_init(&adchan->lock);
 		INIT_LIST_HEAD(&adchan->submitted);
 		INIT_LIST_HEAD(&adchan->issued);
+		INIT_LIST_HEAD(&adchan->done);
 		INIT_LIST_HEAD(&adchan->to_free);
 		list_add_tail(&adchan->chan.device_node, &dma->channels);
 		tasklet_setup(&adchan->tasklet, admac_chan_tasklet);
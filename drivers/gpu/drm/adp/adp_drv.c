@@ -173,6 +173,9 @@ static int adp_plane_atomic_check(struct drm_plane *plane,
 	crtc_state = drm_atomic_get_crtc_state(state, new_plane_state->crtc);
 	if (IS_ERR(crtc_state))
 		return PTR_ERR(crtc_state);
+
+	drm_atomic_helper_check_plane_damage(state, new_plane_state);
+
 	return drm_atomic_helper_check_plane_state(new_plane_state,
 						   crtc_state,
 						   DRM_PLANE_NO_SCALING,
@@ -188,6 +191,8 @@ static void adp_plane_atomic_update(struct drm_plane *plane,
 	struct drm_gem_dma_object *obj;
 	struct drm_framebuffer *fb;
 	struct drm_plane_state *new_state = drm_atomic_get_new_plane_state(state, plane);
+	struct drm_plane_state *old_state = drm_atomic_get_old_plane_state(state, plane);
+	struct drm_rect damage;
 	u32 src_pos, src_size, dst_pos, dst_size;
 	if (!plane || !new_state)
 		return;
@@ -197,6 +202,16 @@ static void adp_plane_atomic_update(struct drm_plane *plane,
 		return;
 	adp = to_adp(plane->dev);
 
+	/*
+	 * The frame buffer is scanned out continuously, there is nothing to
+	 * reprogram if neither the layer nor its contents changed.
+	 */
+	if (old_state && old_state->fb == fb && old_state->visible &&
+	    drm_rect_equals(&old_state->src, &new_state->src) &&
+	    drm_rect_equals(&old_state->dst, &new_state->dst) &&
+	    !drm_atomic_helper_damage_merged(old_state, new_state, &damage))
+		return;
+
 	drm_rect_fp_to_int(&src_rect, &new_state->src);
 	src_pos = src_rect.x1 << 16 | src_rect.y1;
 	dst_pos = new_state->dst.x1 << 16 | new_state->dst.y1;
@@ -272,6 +287,7 @@ struct adp_plane *adp_plane_new(struct adp_drv_private *adp, u8 id)
 	plane->id = id;
 
 	drm_plane_helper_add(&plane->base_plane, &adp_plane_helper_funcs);
+	drm_plane_enable_fb_damage_clips(&plane->base_plane);
 	return plane;
 }
 
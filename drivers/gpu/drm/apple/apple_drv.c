@@ -17,7 +17,9 @@
 #include <drm/drm_aperture.h>
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
+#include <drm/drm_blend.h>
 #include <drm/drm_crtc.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_fb_helper.h>
 #include <drm/drm_fbdev_generic.h>
@@ -87,6 +89,8 @@ static int apple_plane_atomic_check(struct drm_plane *plane,
 	if (IS_ERR(crtc_state))
 		return PTR_ERR(crtc_state);
 
+	drm_atomic_helper_check_plane_damage(state, new_plane_state);
+
 	/*
 	 * DCP limits downscaling to 2x and upscaling to 4x. Attempting to
 	 * scale outside these bounds errors out when swapping.
@@ -120,7 +124,7 @@ static const struct drm_plane_helper_funcs apple_plane_helper_funcs = {
 static void apple_plane_cleanup(struct drm_plane *plane)
 {
 	drm_plane_cleanup(plane);
-	kfree(plane);
+	kfree(to_apple_plane(plane));
 }
 
 static const struct drm_plane_funcs apple_plane_funcs = {
@@ -151,28 +155,62 @@ static const u32 dcp_formats[] = {
 	DRM_FORMAT_ABGR8888,
 };
 
+static const u32 dcp_overlay_formats[] = {
+	DRM_FORMAT_ARGB8888,
+	DRM_FORMAT_ABGR8888,
+};
+
 u64 apple_format_modifiers[] = {
 	DRM_FORMAT_MOD_LINEAR,
 	DRM_FORMAT_MOD_INVALID
 };
 
+/*
+ * Every plane is backed by a fixed IOMFB swap surface. Surface 0 has
+ * limitations at least on t600x and is left unused. Higher surfaces are
+ * blended on top of lower ones, so the surface index doubles as the
+ * immutable zpos.
+ */
 static struct drm_plane *apple_plane_init(struct drm_device *dev,
 					  unsigned long possible_crtcs,
-					  enum drm_plane_type type)
+					  enum drm_plane_type type,
+					  unsigned int surface)
 {
 	int ret;
+	struct apple_plane *apple_plane;
 	struct drm_plane *plane;
+	const u32 *formats = dcp_formats;
+	unsigned int num_formats = ARRAY_SIZE(dcp_formats);
+
+	if (type != DRM_PLANE_TYPE_PRIMARY) {
+		formats = dcp_overlay_formats;
+		num_formats = ARRAY_SIZE(dcp_overlay_formats);
+	}
+
+	apple_plane = kzalloc(sizeof(*apple_plane), GFP_KERNEL);
+	if (!apple_plane)
+		return ERR_PTR(-ENOMEM);
 
-	plane = kzalloc(sizeof(*plane), GFP_KERNEL);
+	apple_plane->surface = surface;
+	plane = &apple_plane->base;
 
 	ret = drm_universal_plane_init(dev, plane, possible_crtcs,
 				       &apple_plane_funcs,
-				       dcp_formats, ARRAY_SIZE(dcp_formats),
+				       formats, num_formats,
 				       apple_format_modifiers, type, NULL);
-	if (ret)
+	if (ret) {
+		kfree(apple_plane);
 		return ERR_PTR(ret);
+	}
 
 	drm_plane_helper_add(plane, &apple_plane_helper_funcs);
+	drm_plane_enable_fb_damage_clips(plane);
+	drm_plane_create_zpos_immutable_property(plane, surface - 1);
+
+	if (type != DRM_PLANE_TYPE_PRIMARY)
+		drm_plane_create_blend_mode_property(plane,
+						     BIT(DRM_MODE_BLEND_PREMULTI) |
+						     BIT(DRM_MODE_BLEND_COVERAGE));
 
 	return plane;
 }
@@ -318,16 +356,24 @@ static int apple_probe_per_dcp(struct device *dev,
 	struct apple_crtc *crtc;
 	struct apple_connector *connector;
 	struct apple_encoder *enc;
-	struct drm_plane *primary;
+	struct drm_plane *primary, *overlay, *cursor;
 	int ret;
 
-	primary = apple_plane_init(drm, 1U << num, DRM_PLANE_TYPE_PRIMARY);
+	primary = apple_plane_init(drm, 1U << num, DRM_PLANE_TYPE_PRIMARY, 1);
 
 	if (IS_ERR(primary))
 		return PTR_ERR(primary);
 
+	overlay = apple_plane_init(drm, 1U << num, DRM_PLANE_TYPE_OVERLAY, 2);
+	if (IS_ERR(overlay))
+		return PTR_ERR(overlay);
+
+	cursor = apple_plane_init(drm, 1U << num, DRM_PLANE_TYPE_CURSOR, 3);
+	if (IS_ERR(cursor))
+		return PTR_ERR(cursor);
+
 	crtc = kzalloc(sizeof(*crtc), GFP_KERNEL);
-	ret = drm_crtc_init_with_planes(drm, &crtc->base, primary, NULL,
+	ret = drm_crtc_init_with_planes(drm, &crtc->base, primary, cursor,
 					&apple_crtc_funcs, NULL);
 	if (ret)
 		return ret;
@@ -351,6 +397,7 @@ static int apple_probe_per_dcp(struct device *dev,
 		return ret;
 
 	connector->base.polled = DRM_CONNECTOR_POLL_HPD;
+	drm_connector_attach_vrr_capable_property(&connector->base);
 	connector->connected = false;
 	connector->dcp = dcp;
 
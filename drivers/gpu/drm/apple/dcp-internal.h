@@ -6,6 +6,8 @@
 
 #include <linux/backlight.h>
 #include <linux/device.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
 #include <linux/scatterlist.h>
@@ -14,6 +16,10 @@
 #include "iomfb_v12_3.h"
 #include "iomfb_v13_3.h"
 
+/*
+ * Blend supports only 2 layers. Primary, overlay and cursor planes are all
+ * registered, dcp_crtc_atomic_check() rejects a commit that enables all three.
+ */
 #define DCP_MAX_PLANES 2
 
 struct apple_dcp;
@@ -70,8 +76,13 @@ struct dcp_channel {
 struct dcp_fb_reference {
 	struct list_head head;
 	struct drm_framebuffer *fb;
+	/* part of apple_dcp.fb_ref_pool, not allocated */
+	bool pooled;
 };
 
+/* Enough for a few swaps in flight with every surface changing */
+#define DCP_MAX_FB_REFS (4 * SWAP_SURFACES)
+
 #define MAX_NOTCH_HEIGHT 160
 
 struct dcp_brightness {
@@ -170,6 +181,17 @@ struct apple_dcp {
 	struct dcp_display_mode *modes;
 	unsigned int nr_modes;
 
+	/* Hash of the TimingElements blob the modes were parsed from */
+	u64 modes_hash;
+
+	/* Refresh rate range of the native resolution, in Hz */
+	unsigned int vrr_min;
+	unsigned int vrr_max;
+
+	/* Last frame sync properties sent by the DCP */
+	struct frame_sync_props frame_sync;
+	bool vrr_enabled;
+
 	/* Attributes of the connector */
 	int connector_type;
 
@@ -178,14 +200,23 @@ struct apple_dcp {
 
 	unsigned notch_height;
 
-	/* Workqueue for sending vblank events when a dcp swap is not possible */
-	struct work_struct vblank_wq;
+	/* Timer for sending vblank events when a dcp swap is not possible */
+	struct hrtimer vblank_timer;
+	/* Time of the last real or synthetic vblank */
+	ktime_t last_vblank;
 
 	/* List of referenced drm_framebuffers which can be unreferenced
 	 * on the next successfully completed swap.
 	 */
 	struct list_head swapped_out_fbs;
 
+	/* Preallocated entries for swapped_out_fbs */
+	struct dcp_fb_reference fb_ref_pool[DCP_MAX_FB_REFS];
+	struct list_head free_fb_refs;
+
+	/* Time of the last flush, for the commit to swap complete latency */
+	ktime_t flush_ts;
+
 	struct dcp_brightness brightness;
 	/* Workqueue for updating the initial initial brightness */
 	struct work_struct bl_register_wq;
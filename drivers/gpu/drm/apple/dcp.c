@@ -95,15 +95,41 @@ bool dcp_has_panel(struct apple_dcp *dcp)
 /*
  * Helper to send a DRM vblank event. We do not know how call swap_submit_dcp
  * without surfaces. To avoid timeouts in drm_atomic_helper_wait_for_vblanks
- * send a vblank event via a workqueue.
+ * send a synthetic vblank event from a timer instead, aligned to the refresh
+ * cadence of the current mode.
  */
-static void dcp_delayed_vblank(struct work_struct *work)
+static enum hrtimer_restart dcp_vblank_timer(struct hrtimer *timer)
 {
-	struct apple_dcp *dcp;
+	struct apple_dcp *dcp = container_of(timer, struct apple_dcp,
+					     vblank_timer);
 
-	dcp = container_of(work, struct apple_dcp, vblank_wq);
-	mdelay(5);
+	dcp->last_vblank = hrtimer_get_expires(timer);
 	dcp_drm_crtc_vblank(dcp->crtc);
+
+	return HRTIMER_NORESTART;
+}
+
+void dcp_schedule_vblank(struct apple_dcp *dcp)
+{
+	struct drm_crtc *crtc = &dcp->crtc->base;
+	int refresh = drm_mode_vrefresh(&crtc->mode);
+	u64 period, since;
+	ktime_t now, next;
+
+	if (refresh <= 0)
+		refresh = 60;
+	period = div_u64(NSEC_PER_SEC, refresh);
+
+	/* the next vblank boundary after now, counted from the last vblank */
+	now = ktime_get();
+	since = ktime_to_ns(ktime_sub(now, dcp->last_vblank));
+	if (ktime_before(now, dcp->last_vblank) || since > NSEC_PER_SEC)
+		next = ktime_add_ns(now, period);
+	else
+		next = ktime_add_ns(dcp->last_vblank,
+				    (div64_u64(since, period) + 1) * period);
+
+	hrtimer_start(&dcp->vblank_timer, next, HRTIMER_MODE_ABS);
 }
 
 static void dcp_recv_msg(void *cookie, u8 endpoint, u64 message)
@@ -205,10 +231,7 @@ int dcp_crtc_atomic_check(struct drm_crtc *crtc, struct drm_atomic_state *state)
 {
 	struct platform_device *pdev = to_apple_crtc(crtc)->dcp;
 	struct apple_dcp *dcp = platform_get_drvdata(pdev);
-	struct drm_plane_state *new_state, *old_state;
-	struct drm_plane *plane;
 	struct drm_crtc_state *crtc_state;
-	int plane_idx, plane_count = 0;
 	bool needs_modeset;
 
 	if (dcp->crashed)
@@ -222,16 +245,13 @@ int dcp_crtc_atomic_check(struct drm_crtc *crtc, struct drm_atomic_state *state)
 		return -EINVAL;
 	}
 
-	for_each_oldnew_plane_in_state(state, plane, old_state, new_state, plane_idx) {
-		/* skip planes not for this crtc */
-		if (new_state->crtc != crtc)
-			continue;
-
-		plane_count += 1;
-	}
-
-	if (plane_count > DCP_MAX_PLANES) {
-		dev_err(dcp->dev, "crtc_atomic_check: Blend supports only 2 layers!");
+	/*
+	 * Count all planes attached to the CRTC, not just the ones in this
+	 * commit: a cursor update doesn't carry the primary plane state.
+	 */
+	if (hweight32(crtc_state->plane_mask) > DCP_MAX_PLANES) {
+		dev_err(dcp->dev, "crtc_atomic_check: Blend supports only %d layers!",
+			DCP_MAX_PLANES);
 		return -EINVAL;
 	}
 
@@ -456,7 +476,7 @@ static int dcp_comp_bind(struct device *dev, struct device *main, void *data)
 	struct device_node *panel_np;
 	struct apple_dcp *dcp = dev_get_drvdata(dev);
 	u32 cpu_ctrl;
-	int ret;
+	int ret, i;
 
 	ret = dma_set_mask_and_coherent(dev, DMA_BIT_MASK(42));
 	if (ret)
@@ -535,10 +555,16 @@ static int dcp_comp_bind(struct device *dev, struct device *main, void *data)
 	// TDOD: mem_desc IDs start at 1, for simplicity just skip '0' entry
 	set_bit(0, dcp->memdesc_map);
 
-	INIT_WORK(&dcp->vblank_wq, dcp_delayed_vblank);
+	hrtimer_init(&dcp->vblank_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	dcp->vblank_timer.function = dcp_vblank_timer;
 
 	dcp->swapped_out_fbs =
 		(struct list_head)LIST_HEAD_INIT(dcp->swapped_out_fbs);
+	INIT_LIST_HEAD(&dcp->free_fb_refs);
+	for (i = 0; i < DCP_MAX_FB_REFS; i++) {
+		dcp->fb_ref_pool[i].pooled = true;
+		list_add_tail(&dcp->fb_ref_pool[i].head, &dcp->free_fb_refs);
+	}
 
 	cpu_ctrl =
 		readl_relaxed(dcp->coproc_reg + APPLE_DCP_COPROC_CPU_CONTROL);
@@ -569,6 +595,8 @@ static void dcp_comp_unbind(struct device *dev, struct device *main, void *data)
 	if (dcp && dcp->shmem)
 		iomfb_shutdown(dcp);
 
+	hrtimer_cancel(&dcp->vblank_timer);
+
 	if (dcp->piodma) {
 		iommu_detach_device(dcp->iommu_dom, &dcp->piodma->dev);
 		iommu_domain_free(dcp->iommu_dom);
@@ -660,6 +688,7 @@ static struct platform_driver apple_platform_driver = {
 		.name = "apple-dcp",
 		.of_match_table	= of_match,
 		.pm = pm_sleep_ptr(&dcp_platform_pm_ops),
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
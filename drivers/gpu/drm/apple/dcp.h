@@ -11,6 +11,15 @@
 #include "dcp-internal.h"
 #include "parser.h"
 
+struct apple_plane {
+	struct drm_plane base;
+
+	/* IOMFB swap surface used for this plane */
+	unsigned int surface;
+};
+
+#define to_apple_plane(x) container_of(x, struct apple_plane, base)
+
 struct apple_crtc {
 	struct drm_crtc base;
 	struct drm_pending_vblank_event *event;
@@ -54,6 +63,7 @@ void dcp_flush(struct drm_crtc *crtc, struct drm_atomic_state *state);
 bool dcp_is_initialized(struct platform_device *pdev);
 void apple_crtc_vblank(struct apple_crtc *apple);
 void dcp_drm_crtc_vblank(struct apple_crtc *crtc);
+void dcp_schedule_vblank(struct apple_dcp *dcp);
 int dcp_get_modes(struct drm_connector *connector);
 int dcp_mode_valid(struct drm_connector *connector,
 		   struct drm_display_mode *mode);
@@ -399,6 +399,43 @@ struct dcp_rect drm_to_dcp_rect(struct drm_rect *rect)
 				  .h = drm_rect_height(rect) };
 }
 
+void dcp_fb_reference_get(struct apple_dcp *dcp, struct drm_framebuffer *fb)
+{
+	struct dcp_fb_reference *entry;
+
+	entry = list_first_entry_or_null(&dcp->free_fb_refs,
+					 struct dcp_fb_reference, head);
+	if (entry) {
+		list_del(&entry->head);
+	} else {
+		/* only reached if many swaps in a row failed */
+		entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+		if (!entry)
+			return;
+	}
+
+	drm_framebuffer_get(fb);
+	entry->fb = fb;
+	list_add_tail(&entry->head, &dcp->swapped_out_fbs);
+}
+
+void dcp_fb_references_release(struct apple_dcp *dcp)
+{
+	struct dcp_fb_reference *entry, *tmp;
+
+	list_for_each_entry_safe(entry, tmp, &dcp->swapped_out_fbs, head) {
+		if (entry->fb)
+			drm_framebuffer_put(entry->fb);
+		entry->fb = NULL;
+		list_del(&entry->head);
+
+		if (entry->pooled)
+			list_add_tail(&entry->head, &dcp->free_fb_refs);
+		else
+			kfree(entry);
+	}
+}
+
 u32 drm_format_to_dcp(u32 drm)
 {
 	switch (drm) {
@@ -418,6 +455,43 @@ u32 drm_format_to_dcp(u32 drm)
 	return 0;
 }
 
+static bool vrr;
+module_param(vrr, bool, 0644);
+MODULE_PARM_DESC(vrr, "Expose adaptive sync for displays supporting several refresh rates (experimental)");
+
+bool dcp_vrr_allowed(void)
+{
+	return READ_ONCE(vrr);
+}
+
+/*
+ * DCP reports every refresh rate a panel supports as a separate timing mode.
+ * Take the range of the refresh rates offered for the native (first)
+ * resolution as the adaptive sync range.
+ */
+void dcp_set_vrr_range(struct apple_dcp *dcp)
+{
+	struct drm_display_mode *native, *mode;
+	unsigned int i, refresh;
+
+	dcp->vrr_min = dcp->vrr_max = 0;
+	if (!dcp->nr_modes)
+		return;
+
+	native = &dcp->modes[0].mode;
+	for (i = 0; i < dcp->nr_modes; ++i) {
+		mode = &dcp->modes[i].mode;
+		if (mode->hdisplay != native->hdisplay ||
+		    mode->vdisplay != native->vdisplay)
+			continue;
+
+		refresh = drm_mode_vrefresh(mode);
+		if (!dcp->vrr_min || refresh < dcp->vrr_min)
+			dcp->vrr_min = refresh;
+		dcp->vrr_max = max(dcp->vrr_max, refresh);
+	}
+}
+
 int dcp_get_modes(struct drm_connector *connector)
 {
 	struct apple_connector *apple_connector = to_apple_connector(connector);
@@ -439,6 +513,13 @@ int dcp_get_modes(struct drm_connector *connector)
 		drm_mode_probed_add(connector, mode);
 	}
 
+	drm_connector_set_vrr_capable_property(connector,
+					       vrr && dcp->vrr_max > dcp->vrr_min);
+	if (connector->display_info.monitor_range.max_vfreq == 0) {
+		connector->display_info.monitor_range.min_vfreq = dcp->vrr_min;
+		connector->display_info.monitor_range.max_vfreq = dcp->vrr_max;
+	}
+
 	return dcp->nr_modes;
 }
 EXPORT_SYMBOL_GPL(dcp_get_modes);
@@ -489,13 +570,15 @@ void dcp_flush(struct drm_crtc *crtc, struct drm_atomic_state *state)
 	struct platform_device *pdev = to_apple_crtc(crtc)->dcp;
 	struct apple_dcp *dcp = platform_get_drvdata(pdev);
 
+	dcp->flush_ts = ktime_get();
+
 	if (dcp_channel_busy(&dcp->ch_cmd))
 	{
 		dev_err(dcp->dev, "unexpected busy command channel");
 		/* HACK: issue a delayed vblank event to avoid timeouts in
 		 * drm_atomic_helper_wait_for_vblanks().
 		 */
-		schedule_work(&dcp->vblank_wq);
+		dcp_schedule_vblank(dcp);
 		return;
 	}
 
@@ -118,6 +118,19 @@ struct dcp_rect drm_to_dcp_rect(struct drm_rect *rect);
 
 u32 drm_format_to_dcp(u32 drm);
 
+/* Derive the adaptive sync range from the parsed timing modes */
+void dcp_set_vrr_range(struct apple_dcp *dcp);
+
+/* Is the experimental 'vrr' module parameter set */
+bool dcp_vrr_allowed(void);
+
+/*
+ * Keep a framebuffer referenced until the next successful swap, see
+ * apple_dcp.swapped_out_fbs. Entries come from a preallocated pool.
+ */
+void dcp_fb_reference_get(struct apple_dcp *dcp, struct drm_framebuffer *fb);
+void dcp_fb_references_release(struct apple_dcp *dcp);
+
 /* The user may own drm_display_mode, so we need to search for our copy */
 struct dcp_display_mode *lookup_mode(struct apple_dcp *dcp,
 					    const struct drm_display_mode *mode);
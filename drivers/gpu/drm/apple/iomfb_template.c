@@ -16,7 +16,10 @@
 #include <linux/of_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/slab.h>
+#include <linux/xxhash.h>
 
+#include <drm/drm_blend.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_fb_dma_helper.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_framebuffer.h>
@@ -124,6 +127,13 @@ static void dcpep_cb_swap_complete(struct apple_dcp *dcp,
 				   struct DCP_FW_NAME(dc_swap_complete_resp) *resp)
 {
 	trace_iomfb_swap_complete(dcp, resp->swap_id);
+	dcp->last_vblank = ktime_get();
+	if (dcp->flush_ts) {
+		trace_iomfb_swap_latency(dcp, resp->swap_id,
+					 ktime_to_ns(ktime_sub(ktime_get(),
+							       dcp->flush_ts)));
+		dcp->flush_ts = 0;
+	}
 
 	dcp_drm_crtc_vblank(dcp->crtc);
 }
@@ -540,7 +550,9 @@ static u8 dcpep_cb_prop_chunk(struct apple_dcp *dcp,
 static bool dcpep_process_chunks(struct apple_dcp *dcp,
 				 struct dcp_set_dcpav_prop_end_req *req)
 {
+	struct dcp_display_mode *modes;
 	struct dcp_parse_ctx ctx;
+	u64 hash;
 	int ret;
 
 	if (!dcp->chunks.data) {
@@ -559,16 +571,31 @@ static bool dcpep_process_chunks(struct apple_dcp *dcp,
 	}
 
 	if (!strcmp(req->key, "TimingElements")) {
-		dcp->modes = enumerate_modes(&ctx, &dcp->nr_modes,
-					     dcp->width_mm, dcp->height_mm,
-					     dcp->notch_height);
+		/*
+		 * The DCP resends the same timing elements on every hotplug
+		 * of the same display. Parsing them is slow for displays with
+		 * many modes, keep the mode list if nothing changed.
+		 */
+		hash = xxh64(dcp->chunks.data, dcp->chunks.length,
+			     dcp->notch_height);
+		if (dcp->modes && hash == dcp->modes_hash)
+			return true;
 
-		if (IS_ERR(dcp->modes)) {
+		modes = enumerate_modes(&ctx, &dcp->nr_modes, dcp->width_mm,
+					dcp->height_mm, dcp->notch_height);
+
+		kfree(dcp->modes);
+		if (IS_ERR(modes)) {
 			dev_warn(dcp->dev, "failed to parse modes\n");
 			dcp->modes = NULL;
 			dcp->nr_modes = 0;
 			return false;
 		}
+
+		dcp->modes = modes;
+		dcp->modes_hash = hash;
+
+		dcp_set_vrr_range(dcp);
 	} else if (!strcmp(req->key, "DisplayAttributes")) {
 		/* DisplayAttributes are empty for integrated displays, use
 		 * display dimensions read from the devicetree
@@ -684,11 +711,25 @@ static struct dcp_rt_bandwidth dcpep_cb_rt_bandwidth(struct apple_dcp *dcp)
 	}
 }
 
+/*
+ * The DCP announces its frame sync (adaptive refresh) configuration here.
+ * The layout is unknown. With the experimental 'vrr' parameter set, keep the
+ * last one and acknowledge it unchanged. Otherwise reply with zeroed props
+ * as before.
+ */
 static struct dcp_set_frame_sync_props_resp
 dcpep_cb_set_frame_sync_props(struct apple_dcp *dcp,
 			      struct dcp_set_frame_sync_props_req *req)
 {
-	return (struct dcp_set_frame_sync_props_resp){};
+	if (!dcp_vrr_allowed())
+		return (struct dcp_set_frame_sync_props_resp){};
+
+	if (!req->frame_sync_props_null)
+		dcp->frame_sync = req->props;
+
+	return (struct dcp_set_frame_sync_props_resp){
+		.props = dcp->frame_sync,
+	};
 }
 
 /* Callback to get the current time as milliseconds since the UNIX epoch */
@@ -728,15 +769,7 @@ static void dcp_swap_cleared(struct apple_dcp *dcp, void *data, void *cookie)
 		return;
 	}
 
-	while (!list_empty(&dcp->swapped_out_fbs)) {
-		struct dcp_fb_reference *entry;
-		entry = list_first_entry(&dcp->swapped_out_fbs,
-					 struct dcp_fb_reference, head);
-		if (entry->fb)
-			drm_framebuffer_put(entry->fb);
-		list_del(&entry->head);
-		kfree(entry);
-	}
+	dcp_fb_references_release(dcp);
 }
 
 static void dcp_swap_clear_started(struct apple_dcp *dcp, void *data,
@@ -991,7 +1024,7 @@ static void dcpep_cb_hotplug(struct apple_dcp *dcp, u64 *connected)
 		dcp->valid_mode = false;
 		/* after unplug swap will not complete until the next
 		 * set_digital_out_mode */
-		schedule_work(&dcp->vblank_wq);
+		dcp_schedule_vblank(dcp);
 	}
 
 	if (connector && connector->connected != !!(*connected)) {
@@ -1091,15 +1124,7 @@ static void dcp_swapped(struct apple_dcp *dcp, void *data, void *cookie)
 		return;
 	}
 
-	while (!list_empty(&dcp->swapped_out_fbs)) {
-		struct dcp_fb_reference *entry;
-		entry = list_first_entry(&dcp->swapped_out_fbs,
-					 struct dcp_fb_reference, head);
-		if (entry->fb)
-			drm_framebuffer_put(entry->fb);
-		list_del(&entry->head);
-		kfree(entry);
-	}
+	dcp_fb_references_release(dcp);
 }
 
 static void dcp_swap_started(struct apple_dcp *dcp, void *data, void *cookie)
@@ -1143,7 +1168,7 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 	struct drm_crtc_state *crtc_state;
 	struct DCP_FW_NAME(dcp_swap_submit_req) *req = &DCP_FW_UNION(dcp->swap);
 	int plane_idx, l;
-	int has_surface = 0;
+	int has_surface = 0, skipped = 0;
 	bool modeset;
 	dev_dbg(dcp->dev, "%s", __func__);
 
@@ -1151,6 +1176,13 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 
 	modeset = drm_atomic_crtc_needs_modeset(crtc_state) || !dcp->valid_mode;
 
+	if (crtc_state->vrr_enabled != dcp->vrr_enabled) {
+		dev_dbg(dcp->dev, "adaptive sync %s (%u-%u Hz)",
+			crtc_state->vrr_enabled ? "enabled" : "disabled",
+			dcp->vrr_min, dcp->vrr_max);
+		dcp->vrr_enabled = crtc_state->vrr_enabled;
+	}
+
 	/* Reset to defaults */
 	memset(req, 0, sizeof(*req));
 	for (l = 0; l < SWAP_SURFACES; l++)
@@ -1172,19 +1204,36 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 		dcp->surfaces_cleared = true;
 	}
 
-	// Surface 0 has limitations at least on t600x.
-	l = 1;
 	for_each_oldnew_plane_in_state(state, plane, old_state, new_state, plane_idx) {
 		struct drm_framebuffer *fb = new_state->fb;
 		struct drm_gem_dma_object *obj;
-		struct drm_rect src_rect;
+		struct drm_rect src_rect, damage;
 		bool is_premultiplied = false;
 
 		/* skip planes not for this crtc */
 		if (old_state->crtc != crtc && new_state->crtc != crtc)
 			continue;
 
-		WARN_ON(l >= SWAP_SURFACES);
+		/* each plane has a fixed surface, see apple_plane_init() */
+		l = to_apple_plane(plane)->surface;
+		if (WARN_ON(l >= SWAP_SURFACES))
+			continue;
+
+		/*
+		 * The surface keeps being displayed without a swap. Leave it
+		 * out if neither its position nor the damaged area of the
+		 * frame buffer require an update.
+		 */
+		if (!modeset && fb && fb == old_state->fb &&
+		    old_state->crtc == crtc && new_state->crtc == crtc &&
+		    drm_rect_equals(&old_state->src, &new_state->src) &&
+		    drm_rect_equals(&old_state->dst, &new_state->dst) &&
+		    !drm_atomic_helper_damage_merged(old_state, new_state,
+						     &damage)) {
+			has_surface = 1;
+			skipped++;
+			continue;
+		}
 
 		req->swap.swap_enabled |= BIT(l);
 
@@ -1198,20 +1247,11 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 			 * after we get a swap complete for the swap unbinding
 			 * it.
 			 */
-			struct dcp_fb_reference *entry =
-				kzalloc(sizeof(*entry), GFP_KERNEL);
-			if (entry) {
-				entry->fb = old_state->fb;
-				list_add_tail(&entry->head,
-					      &dcp->swapped_out_fbs);
-			}
-			drm_framebuffer_get(old_state->fb);
+			dcp_fb_reference_get(dcp, old_state->fb);
 		}
 
-		if (!new_state->fb) {
-			l += 1;
+		if (!new_state->fb)
 			continue;
-		}
 		req->surf_null[l] = false;
 		has_surface = 1;
 
@@ -1223,6 +1263,9 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 		if (fb->format->format == DRM_FORMAT_XRGB8888 ||
 		    fb->format->format == DRM_FORMAT_XBGR8888)
 		    is_premultiplied = true;
+		else if (plane->blend_mode_property)
+			is_premultiplied = new_state->pixel_blend_mode ==
+					   DRM_MODE_BLEND_PREMULTI;
 
 		drm_rect_fp_to_int(&src_rect, &new_state->src);
 
@@ -1258,8 +1301,6 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 			.has_comp = 1,
 			.has_planes = 1,
 		};
-
-		l += 1;
 	}
 
 	if (modeset) {
@@ -1271,7 +1312,7 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 		if (!mode) {
 			dev_warn(dcp->dev, "no match for " DRM_MODE_FMT,
 				 DRM_MODE_ARG(&crtc_state->mode));
-			schedule_work(&dcp->vblank_wq);
+			dcp_schedule_vblank(dcp);
 			return;
 		}
 
@@ -1284,7 +1325,7 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 
 		cookie = kzalloc(sizeof(*cookie), GFP_KERNEL);
 		if (!cookie) {
-			schedule_work(&dcp->vblank_wq);
+			dcp_schedule_vblank(dcp);
 			return;
 		}
 
@@ -1304,7 +1345,7 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 
 		if (ret == 0) {
 			dev_info(dcp->dev, "set_digital_out_mode timed out");
-			schedule_work(&dcp->vblank_wq);
+			dcp_schedule_vblank(dcp);
 			return;
 		} else if (ret > 0) {
 			dev_dbg(dcp->dev,
@@ -1318,7 +1359,7 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 	if (!has_surface && !crtc_state->color_mgmt_changed) {
 		if (crtc_state->enable && crtc_state->active &&
 		    !crtc_state->planes_changed) {
-			schedule_work(&dcp->vblank_wq);
+			dcp_schedule_vblank(dcp);
 			return;
 		}
 
@@ -1328,6 +1369,14 @@ void DCP_FW_NAME(iomfb_flush)(struct apple_dcp *dcp, struct drm_crtc *crtc, stru
 		req->clear = 1;
 	}
 
+	/* nothing to swap, all surfaces are unchanged */
+	if (skipped && !req->swap.swap_enabled &&
+	    !crtc_state->color_mgmt_changed &&
+	    !(dcp_has_panel(dcp) && dcp->brightness.update)) {
+		dcp_schedule_vblank(dcp);
+		return;
+	}
+
 	/* These fields should be set together */
 	req->swap.swap_completed = req->swap.swap_enabled;
 
@@ -117,25 +117,35 @@ static int skip(struct dcp_parse_ctx *handle)
 	}
 }
 
-/* Caller must free the result */
-static char *parse_string(struct dcp_parse_ctx *handle)
+/*
+ * Dictionary keys are compared in place, no need to copy them out of the blob
+ * for every entry. Large TimingElements blobs contain thousands of keys.
+ */
+struct dcp_parse_key {
+	const char *str;
+	u32 len;
+};
+
+static int parse_key(struct dcp_parse_ctx *handle, struct dcp_parse_key *key)
 {
 	struct dcp_parse_tag *tag = parse_tag_of_type(handle, DCP_TYPE_STRING);
 	const char *in;
-	char *out;
 
 	if (IS_ERR(tag))
-		return (void *)tag;
+		return PTR_ERR(tag);
 
 	in = parse_bytes(handle, tag->size);
 	if (IS_ERR(in))
-		return (void *)in;
+		return PTR_ERR(in);
 
-	out = kmalloc(tag->size + 1, GFP_KERNEL);
+	key->str = in;
+	key->len = tag->size;
+	return 0;
+}
 
-	memcpy(out, in, tag->size);
-	out[tag->size] = '\0';
-	return out;
+static bool key_is(const struct dcp_parse_key *key, const char *str)
+{
+	return key->len == strlen(str) && !memcmp(key->str, str, key->len);
 }
 
 static int parse_int(struct dcp_parse_ctx *handle, s64 *value)
@@ -226,26 +236,25 @@ static int parse_dimension(struct dcp_parse_ctx *handle, struct dimension *dim)
 	int ret = 0;
 
 	dcp_parse_foreach_in_dict(handle, it) {
-		char *key = parse_string(it.handle);
+		struct dcp_parse_key key;
+
+		ret = parse_key(it.handle, &key);
+		if (ret)
+			return ret;
 
-		if (IS_ERR(key))
-			ret = PTR_ERR(key);
-		else if (!strcmp(key, "Active"))
+		if (key_is(&key, "Active"))
 			ret = parse_int(it.handle, &dim->active);
-		else if (!strcmp(key, "Total"))
+		else if (key_is(&key, "Total"))
 			ret = parse_int(it.handle, &dim->total);
-		else if (!strcmp(key, "FrontPorch"))
+		else if (key_is(&key, "FrontPorch"))
 			ret = parse_int(it.handle, &dim->front_porch);
-		else if (!strcmp(key, "SyncWidth"))
+		else if (key_is(&key, "SyncWidth"))
 			ret = parse_int(it.handle, &dim->sync_width);
-		else if (!strcmp(key, "PreciseSyncRate"))
+		else if (key_is(&key, "PreciseSyncRate"))
 			ret = parse_int(it.handle, &dim->precise_sync_rate);
 		else
 			skip(it.handle);
 
-		if (!IS_ERR_OR_NULL(key))
-			kfree(key);
-
 		if (ret)
 			return ret;
 	}
@@ -278,32 +287,31 @@ static int parse_color_modes(struct dcp_parse_ctx *handle, s64 *preferred_id)
 		struct color_mode cmode;
 
 		dcp_parse_foreach_in_dict(handle, it) {
-			char *key = parse_string(it.handle);
+			struct dcp_parse_key key;
 
-			if (IS_ERR(key))
-				ret = PTR_ERR(key);
-			else if (!strcmp(key, "Colorimetry"))
+			ret = parse_key(it.handle, &key);
+			if (ret)
+				return ret;
+
+			if (key_is(&key, "Colorimetry"))
 				ret = parse_int(it.handle, &cmode.colorimetry);
-			else if (!strcmp(key, "Depth"))
+			else if (key_is(&key, "Depth"))
 				ret = parse_int(it.handle, &cmode.depth);
-			else if (!strcmp(key, "DynamicRange"))
+			else if (key_is(&key, "DynamicRange"))
 				ret = parse_int(it.handle, &cmode.dynamic_range);
-			else if (!strcmp(key, "EOTF"))
+			else if (key_is(&key, "EOTF"))
 				ret = parse_int(it.handle, &cmode.eotf);
-			else if (!strcmp(key, "ID"))
+			else if (key_is(&key, "ID"))
 				ret = parse_int(it.handle, &cmode.id);
-			else if (!strcmp(key, "IsVirtual"))
+			else if (key_is(&key, "IsVirtual"))
 				ret = parse_bool(it.handle, &is_virtual);
-			else if (!strcmp(key, "PixelEncoding"))
+			else if (key_is(&key, "PixelEncoding"))
 				ret = parse_int(it.handle, &cmode.pixel_encoding);
-			else if (!strcmp(key, "Score"))
+			else if (key_is(&key, "Score"))
 				ret = parse_int(it.handle, &cmode.score);
 			else
 				skip(it.handle);
 
-			if (!IS_ERR_OR_NULL(key))
-				kfree(key);
-
 			if (ret)
 				return ret;
 		}
@@ -366,30 +374,29 @@ static int parse_mode(struct dcp_parse_ctx *handle,
 	struct drm_display_mode *mode = &out->mode;
 
 	dcp_parse_foreach_in_dict(handle, it) {
-		char *key = parse_string(it.handle);
+		struct dcp_parse_key key;
+
+		ret = parse_key(it.handle, &key);
+		if (ret)
+			return ret;
 
-		if (IS_ERR(key))
-			ret = PTR_ERR(key);
-		else if (is_virtual)
+		if (is_virtual)
 			skip(it.handle);
-		else if (!strcmp(key, "HorizontalAttributes"))
+		else if (key_is(&key, "HorizontalAttributes"))
 			ret = parse_dimension(it.handle, &horiz);
-		else if (!strcmp(key, "VerticalAttributes"))
+		else if (key_is(&key, "VerticalAttributes"))
 			ret = parse_dimension(it.handle, &vert);
-		else if (!strcmp(key, "ColorModes"))
+		else if (key_is(&key, "ColorModes"))
 			ret = parse_color_modes(it.handle, &best_color_mode);
-		else if (!strcmp(key, "ID"))
+		else if (key_is(&key, "ID"))
 			ret = parse_int(it.handle, &id);
-		else if (!strcmp(key, "IsVirtual"))
+		else if (key_is(&key, "IsVirtual"))
 			ret = parse_bool(it.handle, &is_virtual);
-		else if (!strcmp(key, "Score"))
+		else if (key_is(&key, "Score"))
 			ret = parse_int(it.handle, score);
 		else
 			skip(it.handle);
 
-		if (!IS_ERR_OR_NULL(key))
-			kfree(key);
-
 		if (ret)
 			return ret;
 	}
@@ -509,20 +516,19 @@ int parse_display_attributes(struct dcp_parse_ctx *handle, int *width_mm,
 	s64 width_cm = 0, height_cm = 0;
 
 	dcp_parse_foreach_in_dict(handle, it) {
-		char *key = parse_string(it.handle);
+		struct dcp_parse_key key;
+
+		ret = parse_key(it.handle, &key);
+		if (ret)
+			return ret;
 
-		if (IS_ERR(key))
-			ret = PTR_ERR(key);
-		else if (!strcmp(key, "MaxHorizontalImageSize"))
+		if (key_is(&key, "MaxHorizontalImageSize"))
 			ret = parse_int(it.handle, &width_cm);
-		else if (!strcmp(key, "MaxVerticalImageSize"))
+		else if (key_is(&key, "MaxVerticalImageSize"))
 			ret = parse_int(it.handle, &height_cm);
 		else
 			skip(it.handle);
 
-		if (!IS_ERR_OR_NULL(key))
-			kfree(key);
-
 		if (ret)
 			return ret;
 	}
@@ -130,6 +130,26 @@ TRACE_EVENT(iomfb_swap_complete,
 	    )
 );
 
+TRACE_EVENT(iomfb_swap_latency,
+	    TP_PROTO(struct apple_dcp *dcp, u32 swap_id, s64 latency_ns),
+	    TP_ARGS(dcp, swap_id, latency_ns),
+	    TP_STRUCT__entry(
+			     __field(u64, dcp)
+			     __field(u32, swap_id)
+			     __field(s64, latency_ns)
+	    ),
+	    TP_fast_assign(
+			   __entry->dcp = (u64)dcp;
+			   __entry->swap_id = swap_id;
+			   __entry->latency_ns = latency_ns;
+	    ),
+	    TP_printk("dcp=%llx, swap_id=%d, flush to swap complete %lld ns",
+		      __entry->dcp,
+		      __entry->swap_id,
+		      __entry->latency_ns
+	    )
+);
+
 TRACE_EVENT(iomfb_swap_complete_intent_gated,
 	    TP_PROTO(struct apple_dcp *dcp, u32 swap_id, u32 width, u32 height),
 	    TP_ARGS(dcp, swap_id, width, height),
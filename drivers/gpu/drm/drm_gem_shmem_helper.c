@@ -447,6 +447,8 @@ drm_gem_shmem_create_with_handle(struct drm_file *file_priv,
  */
 int drm_gem_shmem_madvise(struct drm_gem_shmem_object *shmem, int madv)
 {
+	struct drm_gem_shmem_shrinker *shrinker = shmem->base.dev->shmem_shrinker;
+
 	mutex_lock(&shmem->pages_lock);
 
 	if (shmem->madv >= 0)
@@ -454,6 +456,19 @@ int drm_gem_shmem_madvise(struct drm_gem_shmem_object *shmem, int madv)
 
 	madv = shmem->madv;
 
+	/*
+	 * With a device wide shrinker registered, the helpers track the
+	 * purgeable objects themselves. Whether an object on the LRU can
+	 * actually be purged is re-checked at scan time.
+	 */
+	if (shrinker) {
+		if (madv > 0)
+			drm_gem_lru_move_tail(&shrinker->lru_purgeable,
+					      &shmem->base);
+		else
+			drm_gem_lru_remove(&shmem->base);
+	}
+
 	mutex_unlock(&shmem->pages_lock);
 
 	return (madv >= 0);
@@ -476,6 +491,8 @@ void drm_gem_shmem_purge_locked(struct drm_gem_shmem_object *shmem)
 
 	shmem->madv = -1;
 
+	drm_gem_lru_remove(obj);
+
 	drm_vma_node_unmap(&obj->vma_node, dev->anon_inode->i_mapping);
 	drm_gem_free_mmap_offset(obj);
 
@@ -501,6 +518,114 @@ bool drm_gem_shmem_purge(struct drm_gem_shmem_object *shmem)
 }
 EXPORT_SYMBOL(drm_gem_shmem_purge);
 
+static unsigned long
+drm_gem_shmem_shrinker_count_objects(struct shrinker *shrinker,
+				     struct shrink_control *sc)
+{
+	struct drm_gem_shmem_shrinker *shmem_shrinker =
+		container_of(shrinker, struct drm_gem_shmem_shrinker, base);
+	unsigned long count = READ_ONCE(shmem_shrinker->lru_purgeable.count);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+static bool drm_gem_shmem_shrinker_purge(struct drm_gem_object *obj)
+{
+	struct drm_gem_shmem_object *shmem = to_drm_gem_shmem_obj(obj);
+	bool ret = false;
+
+	if (!dma_resv_test_signaled(obj->resv, DMA_RESV_USAGE_BOOKKEEP))
+		return false;
+
+	if (!mutex_trylock(&shmem->pages_lock))
+		return false;
+
+	if (drm_gem_shmem_is_purgeable(shmem)) {
+		drm_gem_shmem_purge_locked(shmem);
+		ret = true;
+	}
+
+	mutex_unlock(&shmem->pages_lock);
+
+	return ret;
+}
+
+static unsigned long
+drm_gem_shmem_shrinker_scan_objects(struct shrinker *shrinker,
+				    struct shrink_control *sc)
+{
+	struct drm_gem_shmem_shrinker *shmem_shrinker =
+		container_of(shrinker, struct drm_gem_shmem_shrinker, base);
+	unsigned long remaining = 0;
+	unsigned long freed;
+
+	freed = drm_gem_lru_scan(&shmem_shrinker->lru_purgeable,
+				 sc->nr_to_scan, &remaining,
+				 drm_gem_shmem_shrinker_purge);
+
+	return (freed > 0 && remaining > 0) ? freed : SHRINK_STOP;
+}
+
+/**
+ * drm_gem_shmem_shrinker_init - Register a shrinker for shmem GEM objects
+ * @shmem_shrinker: shrinker to initialize, usually embedded in the driver's
+ *                  device structure
+ * @dev: DRM device the shrinker operates on
+ * @name: name of the shrinker, as shown in debugfs
+ *
+ * This function registers a memory shrinker that purges the backing pages of
+ * idle shmem GEM objects that userspace marked as purgeable with
+ * drm_gem_shmem_madvise(). Objects are reclaimed in least recently madvised
+ * order. Drivers using this no longer need to maintain their own purgeable
+ * list and shrinker.
+ *
+ * Returns:
+ * 0 on success or a negative error code on failure.
+ */
+int drm_gem_shmem_shrinker_init(struct drm_gem_shmem_shrinker *shmem_shrinker,
+				struct drm_device *dev, const char *name)
+{
+	int ret;
+
+	if (drm_WARN_ON(dev, dev->shmem_shrinker))
+		return -EBUSY;
+
+	mutex_init(&shmem_shrinker->lock);
+	drm_gem_lru_init(&shmem_shrinker->lru_purgeable, &shmem_shrinker->lock);
+
+	shmem_shrinker->base.count_objects = drm_gem_shmem_shrinker_count_objects;
+	shmem_shrinker->base.scan_objects = drm_gem_shmem_shrinker_scan_objects;
+	shmem_shrinker->base.seeks = DEFAULT_SEEKS;
+
+	ret = register_shrinker(&shmem_shrinker->base, "drm-shmem:%s", name);
+	if (ret) {
+		mutex_destroy(&shmem_shrinker->lock);
+		return ret;
+	}
+
+	dev->shmem_shrinker = shmem_shrinker;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(drm_gem_shmem_shrinker_init);
+
+/**
+ * drm_gem_shmem_shrinker_fini - Unregister a shmem GEM object shrinker
+ * @shmem_shrinker: shrinker initialized with drm_gem_shmem_shrinker_init()
+ * @dev: DRM device the shrinker was registered for
+ *
+ * All GEM objects of @dev must have been released before calling this.
+ */
+void drm_gem_shmem_shrinker_fini(struct drm_gem_shmem_shrinker *shmem_shrinker,
+				 struct drm_device *dev)
+{
+	unregister_shrinker(&shmem_shrinker->base);
+	drm_WARN_ON(dev, !list_empty(&shmem_shrinker->lru_purgeable.list));
+	dev->shmem_shrinker = NULL;
+	mutex_destroy(&shmem_shrinker->lock);
+}
+EXPORT_SYMBOL_GPL(drm_gem_shmem_shrinker_fini);
+
 /**
  * drm_gem_shmem_dumb_create - Create a dumb shmem buffer object
  * @file: DRM file structure to create the dumb buffer for
@@ -13,6 +13,7 @@
 #include <linux/firmware.h>
 #include <linux/gpio/consumer.h>
 #include <linux/hid.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/soc/apple/dockchannel.h>
 #include <linux/of.h>
@@ -25,6 +26,7 @@
 
 /* Data + checksum */
 #define MAX_PKT_SIZE (0xffff + 4)
+#define RX_RING_SIZE SZ_16K
 
 #define DCHID_CHANNEL_CMD 0x11
 #define DCHID_CHANNEL_REPORT 0x12
@@ -191,6 +193,10 @@ struct dockchannel_hid {
 	struct dchid_iface *comm;
 	struct dchid_iface *ifaces[MAX_INTERFACES];
 
+	/* Packet reassembly state, only touched from the RX ring callback */
+	struct dchid_hdr rx_hdr;
+	size_t rx_hdr_pos;
+	size_t rx_pos;
 	u8 pkt_buf[MAX_PKT_SIZE];
 
 	/* Workqueue to asynchronously create HID devices */
@@ -1020,75 +1026,98 @@ static void dchid_handle_ack(struct dchid_iface *iface, struct dchid_hdr *hdr, v
 	complete(&iface->out_complete);
 }
 
-static void dchid_handle_packet(void *cookie, size_t avail)
+static void dchid_handle_packet(struct dockchannel_hid *dchid,
+				struct dchid_hdr *hdr)
 {
-	struct dockchannel_hid *dchid = cookie;
-	struct dchid_hdr hdr;
 	struct dchid_work *work;
 	struct dchid_iface *iface;
 	u32 checksum;
 
-	if (dockchannel_recv(dchid->dc, &hdr, sizeof(hdr)) != sizeof(hdr)) {
-		dev_err(dchid->dev, "Read failed (header)\n");
-		return;
-	}
-
-	if (hdr.hdr_len != sizeof(hdr)) {
-		dev_err(dchid->dev, "Bad header length %d\n", hdr.hdr_len);
-		goto done;
-	}
-
-	if (dockchannel_recv(dchid->dc, dchid->pkt_buf, hdr.length + 4) != (hdr.length + 4)) {
-		dev_err(dchid->dev, "Read failed (body)\n");
-		goto done;
-	}
-
-	checksum = dchid_checksum(&hdr, sizeof(hdr));
-	checksum += dchid_checksum(dchid->pkt_buf, hdr.length + 4);
+	checksum = dchid_checksum(hdr, sizeof(*hdr));
+	checksum += dchid_checksum(dchid->pkt_buf, hdr->length + 4);
 
 	if (checksum != 0xffffffff) {
 		dev_err(dchid->dev, "Checksum mismatch (iface %d): 0x%08x != 0xffffffff\n",
-			hdr.iface, checksum);
-		goto done;
+			hdr->iface, checksum);
+		return;
 	}
 
-
-	if (hdr.iface >= MAX_INTERFACES) {
-		dev_err(dchid->dev, "Bad iface %d\n", hdr.iface);
+	if (hdr->iface >= MAX_INTERFACES) {
+		dev_err(dchid->dev, "Bad iface %d\n", hdr->iface);
+		return;
 	}
 
-	iface = dchid->ifaces[hdr.iface];
+	iface = dchid->ifaces[hdr->iface];
 
 	if (!iface) {
-		dev_err(dchid->dev, "Received packet for uninitialized iface %d\n", hdr.iface);
-		goto done;
+		dev_err(dchid->dev, "Received packet for uninitialized iface %d\n", hdr->iface);
+		return;
 	}
 
-	switch (hdr.channel) {
+	switch (hdr->channel) {
 		case DCHID_CHANNEL_CMD:
-			dchid_handle_ack(iface, &hdr, dchid->pkt_buf);
-			goto done;
+			dchid_handle_ack(iface, hdr, dchid->pkt_buf);
+			return;
 		case DCHID_CHANNEL_REPORT:
 			break;
 		default:
 			dev_warn(dchid->dev, "Unknown channel 0x%x, treating as report...\n",
-				 hdr.channel);
+				 hdr->channel);
 			break;
 	}
 
-	work = kzalloc(sizeof(*work) + hdr.length, GFP_KERNEL);
+	work = kzalloc(sizeof(*work) + hdr->length, GFP_KERNEL);
 	if (!work)
 		return;
 
-	work->hdr = hdr;
+	work->hdr = *hdr;
 	work->iface = iface;
-	memcpy(work->data, dchid->pkt_buf, hdr.length);
+	memcpy(work->data, dchid->pkt_buf, hdr->length);
 	INIT_WORK(&work->work, dchid_packet_work);
 
 	queue_work(iface->wq, &work->work);
+}
 
-done:
-	dockchannel_await(dchid->dc, dchid_handle_packet, dchid, sizeof(struct dchid_hdr));
+/*
+ * Called from the dockchannel RX thread with whatever has arrived so far.
+ * Packets may straddle calls, so reassemble them header first, then body
+ * plus trailing checksum.
+ */
+static void dchid_rx_ring(void *cookie, size_t avail)
+{
+	struct dockchannel_hid *dchid = cookie;
+	struct dchid_hdr *hdr = &dchid->rx_hdr;
+	size_t len;
+
+	while (avail) {
+		if (dchid->rx_hdr_pos < sizeof(*hdr)) {
+			len = dockchannel_rx_ring_read(dchid->dc,
+						       (u8 *)hdr + dchid->rx_hdr_pos,
+						       sizeof(*hdr) - dchid->rx_hdr_pos);
+			dchid->rx_hdr_pos += len;
+			avail -= len;
+			if (dchid->rx_hdr_pos < sizeof(*hdr))
+				break;
+
+			if (hdr->hdr_len != sizeof(*hdr)) {
+				dev_err(dchid->dev, "Bad header length %d\n", hdr->hdr_len);
+				dchid->rx_hdr_pos = 0;
+				continue;
+			}
+			dchid->rx_pos = 0;
+		}
+
+		len = dockchannel_rx_ring_read(dchid->dc,
+					       dchid->pkt_buf + dchid->rx_pos,
+					       hdr->length + 4 - dchid->rx_pos);
+		dchid->rx_pos += len;
+		avail -= len;
+		if (dchid->rx_pos < hdr->length + 4)
+			break;
+
+		dchid_handle_packet(dchid, hdr);
+		dchid->rx_hdr_pos = 0;
+	}
 }
 
 static int dockchannel_hid_probe(struct platform_device *pdev)
@@ -1182,8 +1211,11 @@ static int dockchannel_hid_probe(struct platform_device *pdev)
 		return -EIO;
 	}
 
+	ret = dockchannel_rx_ring_start(dchid->dc, RX_RING_SIZE, dchid_rx_ring, dchid);
+	if (ret)
+		return dev_err_probe(dchid->dev, ret, "Failed to start RX ring");
+
 	dev_info(dchid->dev, "Initialized, awaiting packets\n");
-	dockchannel_await(dchid->dc, dchid_handle_packet, dchid, sizeof(struct dchid_hdr));
 
 	return 0;
 }
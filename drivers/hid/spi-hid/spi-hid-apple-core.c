@@ -52,6 +52,13 @@
 
 #define SPI_RW_CHG_DELAY_US 200 /* 'Inter Stage Us'? */
 
+#define SPIHID_MAX_RX_BATCH 4
+
+static unsigned int rx_batch = 1;
+module_param(rx_batch, uint, 0444);
+MODULE_PARM_DESC(rx_batch,
+		 "Packets read per interrupt (1-" __stringify(SPIHID_MAX_RX_BATCH) ")");
+
 static const u8 spi_hid_apple_booted[4] = { 0xa0, 0x80, 0x00, 0x00 };
 static const u8 spi_hid_apple_status_ok[4] = { 0xac, 0x27, 0x68, 0xd5 };
 
@@ -90,7 +97,7 @@ struct spihid_apple {
 
 	struct spi_message rx_msg;
 	struct spi_message tx_msg;
-	struct spi_transfer rx_transfer;
+	struct spi_transfer rx_transfer[SPIHID_MAX_RX_BATCH];
 	struct spi_transfer tx_transfer;
 	struct spi_transfer status_transfer;
 
@@ -98,6 +105,9 @@ struct spihid_apple {
 	u8 *tx_buf;
 	u8 *status_buf;
 
+	/* number of packets read by each rx_msg */
+	unsigned int rx_batch;
+
 	u8 vendor[32];
 	u8 product[64];
 	u8 serial[32];
@@ -734,17 +744,25 @@ static void spihid_assemble_message(struct spihid_apple *spihid,
 	}
 }
 
-static void spihid_process_read(struct spihid_apple *spihid)
+static void spihid_process_read(struct spihid_apple *spihid, u8 *buf,
+				bool batched)
 {
 	u16 crc;
 	size_t length;
 	struct device *dev = &spihid->spidev->dev;
 	struct spihid_transfer_packet *pkt;
 
-	pkt = (struct spihid_transfer_packet *)spihid->rx_buf;
+	pkt = (struct spihid_transfer_packet *)buf;
+
+	/*
+	 * Packets after the first one of a batch are speculative reads. The
+	 * device clocks out an all-zero packet when it has nothing queued.
+	 */
+	if (batched && !pkt->flags && !pkt->length)
+		return;
 
 	/* check transfer packet crc */
-	crc = crc16(0, spihid->rx_buf,
+	crc = crc16(0, buf,
 		    offsetof(struct spihid_transfer_packet, crc16));
 	if (crc != le16_to_cpu(pkt->crc16)) {
 		dev_warn_ratelimited(dev, "Read package crc mismatch\n");
@@ -775,7 +793,7 @@ static void spihid_process_read(struct spihid_apple *spihid)
 		pkt->flags, pkt->device, pkt->offset, pkt->remain, length);
 #if defined(DEBUG) && DEBUG > 2
 	print_hex_dump_debug("spihid pkt: ", DUMP_PREFIX_OFFSET, 16, 1,
-			     spihid->rx_buf,
+			     buf,
 			     sizeof(struct spihid_transfer_packet), true);
 #endif
 #endif
@@ -785,7 +803,7 @@ static void spihid_process_read(struct spihid_apple *spihid)
 		return;
 	}
 
-	/* short message */
+	/* short message, parsed in place from the SPI buffer */
 	if (pkt->offset == 0 && pkt->remain == 0) {
 		spihid_process_message(spihid, pkt->data, length, pkt->device,
 				       pkt->flags);
@@ -796,11 +814,14 @@ static void spihid_process_read(struct spihid_apple *spihid)
 
 static void spihid_read_packet_sync(struct spihid_apple *spihid)
 {
-	int err;
+	int err, i;
 
 	err = spi_sync(spihid->spidev, &spihid->rx_msg);
 	if (!err) {
-		spihid_process_read(spihid);
+		for (i = 0; i < spihid->rx_batch; i++)
+			spihid_process_read(spihid, spihid->rx_buf +
+					    i * sizeof(struct spihid_transfer_packet),
+					    i > 0);
 	} else {
 		dev_warn(&spihid->spidev->dev, "RX failed: %d\n", err);
 	}
@@ -819,15 +840,28 @@ EXPORT_SYMBOL_GPL(spihid_apple_core_irq);
 
 static void spihid_apple_setup_spi_msgs(struct spihid_apple *spihid)
 {
+	int i;
+
 	memset(&spihid->rx_transfer, 0, sizeof(spihid->rx_transfer));
+	spi_message_init(&spihid->rx_msg);
 
-	spihid->rx_transfer.rx_buf = spihid->rx_buf;
-	spihid->rx_transfer.len = sizeof(struct spihid_transfer_packet);
+	/*
+	 * Reading several packets per interrupt lets a burst of trackpad
+	 * reports be drained with a single thread wakeup. Each packet is
+	 * still framed by its own chip select cycle.
+	 */
+	for (i = 0; i < spihid->rx_batch; i++) {
+		struct spi_transfer *t = &spihid->rx_transfer[i];
 
-	spi_message_init(&spihid->rx_msg);
-	spi_message_add_tail(&spihid->rx_transfer, &spihid->rx_msg);
+		t->rx_buf = spihid->rx_buf +
+			    i * sizeof(struct spihid_transfer_packet);
+		t->len = sizeof(struct spihid_transfer_packet);
+		t->cs_change = i + 1 < spihid->rx_batch;
 
-	memset(&spihid->tx_transfer, 0, sizeof(spihid->rx_transfer));
+		spi_message_add_tail(t, &spihid->rx_msg);
+	}
+
+	memset(&spihid->tx_transfer, 0, sizeof(spihid->tx_transfer));
 	memset(&spihid->status_transfer, 0, sizeof(spihid->status_transfer));
 
 	spihid->tx_transfer.tx_buf = spihid->tx_buf;
@@ -923,9 +957,12 @@ int spihid_apple_core_probe(struct spi_device *spi, struct spihid_apple_ops *ops
 	// init spi
 	spi_set_drvdata(spi, spihid);
 
+	spihid->rx_batch = clamp_t(unsigned int, rx_batch, 1, SPIHID_MAX_RX_BATCH);
+
 	/* allocate SPI buffers */
-	spihid->rx_buf = devm_kmalloc(
-		&spi->dev, sizeof(struct spihid_transfer_packet), GFP_KERNEL);
+	spihid->rx_buf = devm_kmalloc_array(
+		&spi->dev, spihid->rx_batch,
+		sizeof(struct spihid_transfer_packet), GFP_KERNEL);
 	spihid->tx_buf = devm_kmalloc(
 		&spi->dev, sizeof(struct spihid_transfer_packet), GFP_KERNEL);
 	spihid->status_buf = devm_kmalloc(
@@ -0,0 +1,265 @@
+// SPDX-License-Identifier: GPL-2.0-only OR MIT
+/*
+ * Apple SMC sensor streaming via IIO
+ * Copyright The Asahi Linux Contributors
+ *
+ * Exposes a set of SMC power, voltage, current and temperature keys as IIO
+ * channels. Direct reads go through the normal key read path; buffered
+ * capture reads all enabled keys in one apple_smc_read_multi() call per
+ * trigger, so a high rate software trigger (e.g. iio-trig-hrtimer) can sample
+ * the rails without a syscall per value.
+ */
+
+#include <linux/device.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
+#include <linux/mfd/core.h>
+#include <linux/mfd/macsmc.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+
+enum macsmc_iio_fmt {
+	MACSMC_IIO_FLT,
+	MACSMC_IIO_U16,
+	MACSMC_IIO_S16,
+	MACSMC_IIO_S32,
+};
+
+/*
+ * Values are converted to the IIO base units for their channel type
+ * (milliwatts, millivolts, milliamps, millidegrees) as
+ * (raw + offset) * mul.
+ */
+struct macsmc_iio_sensor {
+	smc_key key;
+	const char *label;
+	enum iio_chan_type type;
+	enum macsmc_iio_fmt fmt;
+	int offset;
+	int mul;
+};
+
+static const struct macsmc_iio_sensor macsmc_iio_sensors[] = {
+	{ SMC_KEY(PDTR), "input", IIO_POWER, MACSMC_IIO_FLT, 0, 1000 },
+	{ SMC_KEY(PSTR), "system", IIO_POWER, MACSMC_IIO_FLT, 0, 1000 },
+	{ SMC_KEY(PMVR), "3v8", IIO_POWER, MACSMC_IIO_FLT, 0, 1000 },
+	{ SMC_KEY(PHPC), "cpu", IIO_POWER, MACSMC_IIO_FLT, 0, 1000 },
+	{ SMC_KEY(PSVR), "clvr", IIO_POWER, MACSMC_IIO_FLT, 0, 1000 },
+	{ SMC_KEY(PPMC), "mpmu", IIO_POWER, MACSMC_IIO_FLT, 0, 1000 },
+	{ SMC_KEY(PPSC), "spmu", IIO_POWER, MACSMC_IIO_FLT, 0, 1000 },
+	{ SMC_KEY(B0AP), "battery", IIO_POWER, MACSMC_IIO_S32, 0, 1 },
+	{ SMC_KEY(B0AV), "battery", IIO_VOLTAGE, MACSMC_IIO_U16, 0, 1 },
+	{ SMC_KEY(B0AC), "battery", IIO_CURRENT, MACSMC_IIO_S16, 0, 1 },
+	{ SMC_KEY(B0AT), "battery", IIO_TEMP, MACSMC_IIO_U16, -2732, 100 },
+};
+
+#define MACSMC_IIO_MAX_CHANNELS ARRAY_SIZE(macsmc_iio_sensors)
+
+struct macsmc_iio {
+	struct device *dev;
+	struct apple_smc *smc;
+
+	const struct macsmc_iio_sensor *sensors[MACSMC_IIO_MAX_CHANNELS];
+	unsigned int num_sensors;
+
+	struct apple_smc_read_req reqs[MACSMC_IIO_MAX_CHANNELS];
+	u32 raw[MACSMC_IIO_MAX_CHANNELS];
+
+	struct {
+		s32 data[MACSMC_IIO_MAX_CHANNELS];
+		s64 timestamp __aligned(8);
+	} scan;
+};
+
+static size_t macsmc_iio_fmt_size(enum macsmc_iio_fmt fmt)
+{
+	switch (fmt) {
+	case MACSMC_IIO_U16:
+	case MACSMC_IIO_S16:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+static int macsmc_iio_convert(const struct macsmc_iio_sensor *sensor, u32 raw)
+{
+	switch (sensor->fmt) {
+	case MACSMC_IIO_FLT:
+		return apple_smc_f32_to_scaled(raw, sensor->mul);
+	case MACSMC_IIO_U16:
+		return ((int)(u16)raw + sensor->offset) * sensor->mul;
+	case MACSMC_IIO_S16:
+		return ((int)(s16)raw + sensor->offset) * sensor->mul;
+	case MACSMC_IIO_S32:
+	default:
+		return ((s32)raw + sensor->offset) * sensor->mul;
+	}
+}
+
+static int macsmc_iio_read_raw(struct iio_dev *indio_dev,
+			       struct iio_chan_spec const *chan,
+			       int *val, int *val2, long mask)
+{
+	struct macsmc_iio *smciio = iio_priv(indio_dev);
+	const struct macsmc_iio_sensor *sensor = smciio->sensors[chan->address];
+	u32 raw = 0;
+	int ret;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+		ret = apple_smc_read(smciio->smc, sensor->key, &raw,
+				     macsmc_iio_fmt_size(sensor->fmt));
+		if (ret < 0)
+			return ret;
+
+		*val = macsmc_iio_convert(sensor, raw);
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SCALE:
+		*val = 1;
+		return IIO_VAL_INT;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int macsmc_iio_read_label(struct iio_dev *indio_dev,
+				 struct iio_chan_spec const *chan, char *label)
+{
+	struct macsmc_iio *smciio = iio_priv(indio_dev);
+	const struct macsmc_iio_sensor *sensor = smciio->sensors[chan->address];
+
+	return sysfs_emit(label, "%s (%p4ch)\n", sensor->label, &sensor->key);
+}
+
+static const struct iio_info macsmc_iio_info = {
+	.read_raw = macsmc_iio_read_raw,
+	.read_label = macsmc_iio_read_label,
+};
+
+static irqreturn_t macsmc_iio_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct macsmc_iio *smciio = iio_priv(indio_dev);
+	unsigned int count = 0, i, bit;
+
+	for_each_set_bit(bit, indio_dev->active_scan_mask, indio_dev->masklength) {
+		const struct macsmc_iio_sensor *sensor = smciio->sensors[bit];
+
+		smciio->raw[count] = 0;
+		smciio->reqs[count].key = sensor->key;
+		smciio->reqs[count].buf = &smciio->raw[count];
+		smciio->reqs[count].size = macsmc_iio_fmt_size(sensor->fmt);
+		count++;
+	}
+
+	/* Always go to the SMC, the point is to see every sample */
+	apple_smc_read_multi(smciio->smc, smciio->reqs, count, 0);
+
+	i = 0;
+	for_each_set_bit(bit, indio_dev->active_scan_mask, indio_dev->masklength) {
+		if (smciio->reqs[i].ret < 0)
+			smciio->scan.data[i] = 0;
+		else
+			smciio->scan.data[i] = macsmc_iio_convert(smciio->sensors[bit],
+								  smciio->raw[i]);
+		i++;
+	}
+
+	iio_push_to_buffers_with_timestamp(indio_dev, &smciio->scan,
+					   iio_get_time_ns(indio_dev));
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
+static int macsmc_iio_probe(struct platform_device *pdev)
+{
+	struct apple_smc *smc = dev_get_drvdata(pdev->dev.parent);
+	struct device *dev = &pdev->dev;
+	struct iio_chan_spec *channels;
+	struct macsmc_iio *smciio;
+	struct iio_dev *indio_dev;
+	unsigned int i, n = 0;
+	int ret;
+
+	indio_dev = devm_iio_device_alloc(dev, sizeof(*smciio));
+	if (!indio_dev)
+		return -ENOMEM;
+
+	smciio = iio_priv(indio_dev);
+	smciio->dev = dev;
+	smciio->smc = smc;
+
+	channels = devm_kcalloc(dev, MACSMC_IIO_MAX_CHANNELS + 1, sizeof(*channels),
+				GFP_KERNEL);
+	if (!channels)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(macsmc_iio_sensors); i++) {
+		const struct macsmc_iio_sensor *sensor = &macsmc_iio_sensors[i];
+		struct apple_smc_key_info info;
+		struct iio_chan_spec *chan = &channels[n];
+
+		if (apple_smc_get_key_info(smc, sensor->key, &info) < 0)
+			continue;
+		if (info.size != macsmc_iio_fmt_size(sensor->fmt)) {
+			dev_dbg(dev, "Skipping key %p4ch with size %d\n",
+				&sensor->key, info.size);
+			continue;
+		}
+
+		chan->type = sensor->type;
+		chan->indexed = 1;
+		chan->channel = n;
+		chan->address = n;
+		chan->info_mask_separate = BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE);
+		chan->scan_index = n;
+		chan->scan_type.sign = 's';
+		chan->scan_type.realbits = 32;
+		chan->scan_type.storagebits = 32;
+		chan->scan_type.endianness = IIO_CPU;
+
+		smciio->sensors[n++] = sensor;
+	}
+
+	if (!n)
+		return -ENODEV;
+
+	smciio->num_sensors = n;
+	channels[n] = (struct iio_chan_spec)IIO_CHAN_SOFT_TIMESTAMP(n);
+
+	indio_dev->name = "macsmc";
+	indio_dev->info = &macsmc_iio_info;
+	indio_dev->modes = INDIO_DIRECT_MODE;
+	indio_dev->channels = channels;
+	indio_dev->num_channels = n + 1;
+
+	ret = devm_iio_triggered_buffer_setup(dev, indio_dev, NULL,
+					      macsmc_iio_trigger_handler, NULL);
+	if (ret)
+		return dev_err_probe(dev, ret, "Failed to set up triggered buffer\n");
+
+	ret = devm_iio_device_register(dev, indio_dev);
+	if (ret)
+		return dev_err_probe(dev, ret, "Failed to register IIO device\n");
+
+	dev_info(dev, "Registered %u SMC sensor channels\n", n);
+
+	return 0;
+}
+
+static struct platform_driver macsmc_iio_driver = {
+	.driver = {
+		.name = "macsmc-iio",
+	},
+	.probe = macsmc_iio_probe,
+};
+module_platform_driver(macsmc_iio_driver);
+
+MODULE_LICENSE("Dual MIT/GPL");
+MODULE_DESCRIPTION("Apple SMC IIO sensor driver");
+MODULE_ALIAS("platform:macsmc-iio");
@@ -11,6 +11,7 @@
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
+#define EVDEV_READ_BATCH	16
 
 #include <linux/poll.h>
 #include <linux/sched.h>
@@ -41,6 +42,7 @@ struct evdev_client {
 	unsigned int head;
 	unsigned int tail;
 	unsigned int packet_head; /* [future] position of the first element of next packet */
+	unsigned int last_packet; /* position of the first element of the last complete packet */
 	spinlock_t buffer_lock; /* protects access to buffer, head and tail */
 	wait_queue_head_t wait;
 	struct fasync_struct *fasync;
@@ -48,6 +50,7 @@ struct evdev_client {
 	struct list_head node;
 	enum input_clock_type clk_type;
 	bool revoked;
+	bool coalesce;
 	unsigned long *evmasks[EV_CNT];
 	unsigned int bufsize;
 	struct input_event buffer[];
@@ -138,6 +141,7 @@ static void __evdev_flush_queue(struct evdev_client *client, unsigned int type)
 	}
 
 	client->head = head;
+	client->last_packet = client->packet_head;
 }
 
 static void __evdev_queue_syn_dropped(struct evdev_client *client)
@@ -160,6 +164,7 @@ static void __evdev_queue_syn_dropped(struct evdev_client *client)
 		client->tail = (client->head - 1) & (client->bufsize - 1);
 		client->packet_head = client->tail;
 	}
+	client->last_packet = client->packet_head;
 }
 
 static void evdev_queue_syn_dropped(struct evdev_client *client)
@@ -202,6 +207,7 @@ static int evdev_set_clk_type(struct evdev_client *client, unsigned int clkid)
 
 		if (client->head != client->tail) {
 			client->packet_head = client->head = client->tail;
+			client->last_packet = client->packet_head;
 			__evdev_queue_syn_dropped(client);
 		}
 
@@ -233,14 +239,183 @@ static void __pass_event(struct evdev_client *client,
 		};
 
 		client->packet_head = client->tail;
+		client->last_packet = client->packet_head;
 	}
 
 	if (event->type == EV_SYN && event->code == SYN_REPORT) {
+		client->last_packet = client->packet_head;
 		client->packet_head = client->head;
 		kill_fasync(&client->fasync, SIGIO, POLL_IN);
 	}
 }
 
+/*
+ * ABS_MT_TRACKING_ID is not motion: it starts and ends contacts, and
+ * folding two values together would lose a release or a whole touch.
+ */
+static bool evdev_is_motion(unsigned int type, unsigned int code)
+{
+	if (type == EV_ABS)
+		return code != ABS_MT_TRACKING_ID;
+
+	return type == EV_MSC && code == MSC_TIMESTAMP;
+}
+
+/*
+ * Check whether @vals is a complete frame of motion updates that can be folded
+ * into the last queued packet: the client lags behind, the last packet is
+ * pure motion too, not even partially read yet, and there is enough room to
+ * grow it without dropping events. Caller must hold client->buffer_lock.
+ */
+static bool __evdev_can_coalesce(struct evdev_client *client,
+				 const struct input_value *vals,
+				 unsigned int count)
+{
+	unsigned int mask = client->bufsize - 1;
+	unsigned int used = (client->head - client->tail) & mask;
+	const struct input_value *v;
+	unsigned int i;
+
+	if (!client->coalesce || used < client->bufsize / 2 ||
+	    client->bufsize - used <= 2 * count + 2)
+		return false;
+
+	if (client->packet_head != client->head ||
+	    ((client->last_packet - client->tail) & mask) >= used)
+		return false;
+
+	if (!count || vals[count - 1].type != EV_SYN ||
+	    vals[count - 1].code != SYN_REPORT)
+		return false;
+
+	for (v = vals; v != vals + count - 1; v++) {
+		if (__evdev_is_filtered(client, v->type, v->code))
+			continue;
+		if (!evdev_is_motion(v->type, v->code))
+			return false;
+	}
+
+	/* everything but the closing SYN_REPORT */
+	for (i = client->last_packet; ((i + 1) & mask) != client->head;
+	     i = (i + 1) & mask) {
+		if (!evdev_is_motion(client->buffer[i].type,
+				     client->buffer[i].code))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Look up the event for (@type, @code) in @slot within the packet starting at
+ * @start. Slot -1 stands for the slot that was current before that packet.
+ */
+static struct input_event *__evdev_coalesce_find(struct evdev_client *client,
+						 unsigned int start,
+						 unsigned int type,
+						 unsigned int code, int slot)
+{
+	unsigned int mask = client->bufsize - 1;
+	struct input_event *ev;
+	int cur = -1;
+	unsigned int i;
+
+	for (i = start; i != client->head; i = (i + 1) & mask) {
+		ev = &client->buffer[i];
+
+		if (ev->type == EV_ABS && ev->code == ABS_MT_SLOT) {
+			cur = ev->value;
+			continue;
+		}
+
+		if (ev->type == type && ev->code == code &&
+		    (!input_is_mt_value(code) || cur == slot))
+			return ev;
+	}
+
+	return NULL;
+}
+
+/* Fold the frame in @vals into the last queued packet, see EVIOCSCOALESCE. */
+static void __evdev_coalesce_values(struct evdev_client *client,
+				    const struct input_value *vals,
+				    unsigned int count,
+				    const struct input_event *time)
+{
+	unsigned int mask = client->bufsize - 1;
+	unsigned int start = client->last_packet;
+	struct input_event event = *time;
+	const struct input_value *v;
+	struct input_event *ev;
+	int slot = -1, tail_slot = -1;
+	unsigned int i;
+
+	/* reopen the last packet by dropping its SYN_REPORT */
+	client->head = (client->head - 1) & mask;
+	client->packet_head = start;
+
+	for (i = start; i != client->head; i = (i + 1) & mask) {
+		ev = &client->buffer[i];
+		if (ev->type == EV_ABS && ev->code == ABS_MT_SLOT)
+			tail_slot = ev->value;
+	}
+
+	/* the new frame continues in the slot the last packet ended with */
+	slot = tail_slot;
+
+	for (v = vals; v != vals + count - 1; v++) {
+		bool mt;
+
+		if (__evdev_is_filtered(client, v->type, v->code))
+			continue;
+
+		if (v->type == EV_ABS && v->code == ABS_MT_SLOT) {
+			slot = v->value;
+			continue;
+		}
+
+		mt = v->type == EV_ABS && input_is_mt_value(v->code);
+		ev = __evdev_coalesce_find(client, start, v->type, v->code,
+					   slot);
+		if (ev) {
+			ev->value = v->value;
+			continue;
+		}
+
+		if (mt && slot != tail_slot) {
+			event.type = EV_ABS;
+			event.code = ABS_MT_SLOT;
+			event.value = slot;
+			__pass_event(client, &event);
+			tail_slot = slot;
+		}
+
+		event.type = v->type;
+		event.code = v->code;
+		event.value = v->value;
+		__pass_event(client, &event);
+	}
+
+	/* leave the client in the slot the frame ended with */
+	if (slot != tail_slot) {
+		event.type = EV_ABS;
+		event.code = ABS_MT_SLOT;
+		event.value = slot;
+		__pass_event(client, &event);
+	}
+
+	/* the merged packet now carries the time of the newest frame */
+	for (i = start; i != client->head; i = (i + 1) & mask) {
+		client->buffer[i].input_event_sec = time->input_event_sec;
+		client->buffer[i].input_event_usec = time->input_event_usec;
+	}
+
+	event.type = EV_SYN;
+	event.code = SYN_REPORT;
+	event.value = 0;
+	__pass_event(client, &event);
+}
+
 static void evdev_pass_values(struct evdev_client *client,
 			const struct input_value *vals, unsigned int count,
 			ktime_t *ev_time)
@@ -260,6 +435,14 @@ static void evdev_pass_values(struct evdev_client *client,
 	/* Interrupts are disabled, just acquire the lock. */
 	spin_lock(&client->buffer_lock);
 
+	if (__evdev_can_coalesce(client, vals, count)) {
+		__evdev_coalesce_values(client, vals, count, &event);
+		spin_unlock(&client->buffer_lock);
+		wake_up_interruptible_poll(&client->wait,
+			EPOLLIN | EPOLLOUT | EPOLLRDNORM | EPOLLWRNORM);
+		return;
+	}
+
 	for (v = vals; v != vals + count; v++) {
 		if (__evdev_is_filtered(client, v->type, v->code))
 			continue;
@@ -537,22 +720,22 @@ static ssize_t evdev_write(struct file *file, const char __user *buffer,
 	return retval;
 }
 
-static int evdev_fetch_next_event(struct evdev_client *client,
-				  struct input_event *event)
+static unsigned int evdev_fetch_events(struct evdev_client *client,
+				       struct input_event *events,
+				       unsigned int max)
 {
-	int have_event;
+	unsigned int n = 0;
 
 	spin_lock_irq(&client->buffer_lock);
 
-	have_event = client->packet_head != client->tail;
-	if (have_event) {
-		*event = client->buffer[client->tail++];
+	while (n < max && client->packet_head != client->tail) {
+		events[n++] = client->buffer[client->tail++];
 		client->tail &= client->bufsize - 1;
 	}
 
 	spin_unlock_irq(&client->buffer_lock);
 
-	return have_event;
+	return n;
 }
 
 static ssize_t evdev_read(struct file *file, char __user *buffer,
@@ -560,7 +743,8 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 {
 	struct evdev_client *client = file->private_data;
 	struct evdev *evdev = client->evdev;
-	struct input_event event;
+	struct input_event events[EVDEV_READ_BATCH];
+	unsigned int i, n;
 	size_t read = 0;
 	int error;
 
@@ -582,14 +766,21 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 		if (count == 0)
 			break;
 
-		while (read + input_event_size() <= count &&
-		       evdev_fetch_next_event(client, &event)) {
+		/* grab as many events per buffer_lock round trip as fit */
+		do {
+			n = min_t(size_t, (count - read) / input_event_size(),
+				  EVDEV_READ_BATCH);
+			if (n)
+				n = evdev_fetch_events(client, events, n);
 
-			if (input_event_to_user(buffer + read, &event))
-				return -EFAULT;
+			for (i = 0; i < n; i++) {
+				if (input_event_to_user(buffer + read,
+							&events[i]))
+					return -EFAULT;
 
-			read += input_event_size();
-		}
+				read += input_event_size();
+			}
+		} while (n == EVDEV_READ_BATCH);
 
 		if (read)
 			break;
@@ -1125,6 +1316,10 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 
 		return evdev_set_clk_type(client, i);
 
+	case EVIOCSCOALESCE:
+		client->coalesce = !!p;
+		return 0;
+
 	case EVIOCGKEYCODE:
 		return evdev_handle_get_keycode(dev, p);
 
@@ -14,6 +14,7 @@
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/spi/spi.h>
+#include <linux/workqueue.h>
 
 #define APPLE_Z2_NUM_FINGERS_OFFSET      16
 #define APPLE_Z2_FINGERS_OFFSET          24
@@ -26,6 +27,10 @@
 #define LOAD_COMMAND_SEND_BLOB           1
 #define LOAD_COMMAND_SEND_CALIBRATION    2
 
+static bool async_boot;
+module_param(async_boot, bool, 0644);
+MODULE_PARM_DESC(async_boot, "Boot the controller in the background on open");
+
 struct apple_z2 {
 	struct spi_device *spidev;
 	struct gpio_desc *cs_gpio;
@@ -34,11 +39,19 @@ struct apple_z2 {
 	struct completion boot_irq;
 	int booted;
 	int open;
+	int irq_enabled;
 	int counter;
 	int y_size;
 	const char *fw_name;
 	const char *cal_blob;
 	int cal_size;
+	/* firmware and calibration blob, kept across power cycles */
+	const struct firmware *fw;
+	struct completion fw_preload;
+	char *cal_data;
+	u32 cal_data_size;
+	u32 cal_data_addr;
+	struct work_struct boot_work;
 };
 
 struct apple_z2_finger {
@@ -225,6 +238,68 @@ static void apple_z2_build_cal_blob(struct apple_z2 *z2, u32 address, char *data
 	*(u32 *)(data + z2->cal_size + 10) = checksum;
 }
 
+static const char *apple_z2_get_cal_blob(struct apple_z2 *z2, u32 address, u32 *size)
+{
+	if (z2->cal_data && z2->cal_data_addr == address) {
+		*size = z2->cal_data_size;
+		return z2->cal_data;
+	}
+
+	kfree(z2->cal_data);
+	z2->cal_data_size = z2->cal_size + sizeof(struct apple_z2_hbpp_blob_hdr) + 4;
+	z2->cal_data = kzalloc(z2->cal_data_size, GFP_KERNEL);
+	if (!z2->cal_data)
+		return NULL;
+
+	apple_z2_build_cal_blob(z2, address, z2->cal_data);
+	z2->cal_data_addr = address;
+	*size = z2->cal_data_size;
+	return z2->cal_data;
+}
+
+static void apple_z2_fw_preloaded(const struct firmware *fw, void *context)
+{
+	struct apple_z2 *z2 = context;
+
+	z2->fw = fw;
+	complete_all(&z2->fw_preload);
+}
+
+static int apple_z2_get_firmware(struct apple_z2 *z2)
+{
+	const struct apple_z2_fw_hdr *fw_hdr;
+	int error;
+
+	wait_for_completion(&z2->fw_preload);
+	if (!z2->fw) {
+		error = request_firmware(&z2->fw, z2->fw_name, &z2->spidev->dev);
+		if (error) {
+			dev_err(&z2->spidev->dev, "unable to load firmware");
+			return error;
+		}
+	}
+
+	fw_hdr = (const struct apple_z2_fw_hdr *)z2->fw->data;
+	if (z2->fw->size < sizeof(*fw_hdr) ||
+	    fw_hdr->magic != APPLE_Z2_FW_MAGIC || fw_hdr->version != 1) {
+		dev_err(&z2->spidev->dev, "invalid firmware header");
+		release_firmware(z2->fw);
+		z2->fw = NULL;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void apple_z2_release_firmware(void *data)
+{
+	struct apple_z2 *z2 = data;
+
+	wait_for_completion(&z2->fw_preload);
+	release_firmware(z2->fw);
+	kfree(z2->cal_data);
+}
+
 static int apple_z2_send_firmware_blob(struct apple_z2 *z2, const char *data, u32 size, u8 bpw)
 {
 	struct spi_message msg;
@@ -255,25 +330,17 @@ static int apple_z2_send_firmware_blob(struct apple_z2 *z2, const char *data, u3
 static int apple_z2_upload_firmware(struct apple_z2 *z2)
 {
 	const struct firmware *fw;
-	struct apple_z2_fw_hdr *fw_hdr;
 	size_t fw_idx = sizeof(struct apple_z2_fw_hdr);
 	int error;
 	u32 load_cmd;
 	u32 size;
 	u32 address;
-	char *data;
+	const char *data;
 
-	error = request_firmware(&fw, z2->fw_name, &z2->spidev->dev);
-	if (error) {
-		dev_err(&z2->spidev->dev, "unable to load firmware");
+	error = apple_z2_get_firmware(z2);
+	if (error)
 		return error;
-	}
-
-	fw_hdr = (struct apple_z2_fw_hdr *)fw->data;
-	if (fw_hdr->magic != APPLE_Z2_FW_MAGIC || fw_hdr->version != 1) {
-		dev_err(&z2->spidev->dev, "invalid firmware header");
-		return -EINVAL;
-	}
+	fw = z2->fw;
 
 	while (fw_idx < fw->size) {
 		if (fw->size - fw_idx < 8) {
@@ -300,11 +367,12 @@ static int apple_z2_upload_firmware(struct apple_z2 *z2)
 		} else if (load_cmd == 2) {
 			address = *(u32 *)(fw->data + fw_idx);
 			fw_idx += 4;
-			size = z2->cal_size + sizeof(struct apple_z2_hbpp_blob_hdr) + 4;
-			data = kzalloc(size, GFP_KERNEL);
-			apple_z2_build_cal_blob(z2, address, data);
+			data = apple_z2_get_cal_blob(z2, address, &size);
+			if (!data) {
+				error = -ENOMEM;
+				goto error;
+			}
 			error = apple_z2_send_firmware_blob(z2, data, size, 16);
-			kfree(data);
 			if (error)
 				goto error;
 		} else {
@@ -320,7 +388,6 @@ static int apple_z2_upload_firmware(struct apple_z2 *z2)
 	z2->booted = 1;
 	apple_z2_read_packet(z2);
  error:
-	release_firmware(fw);
 	return error;
 }
 
@@ -328,6 +395,7 @@ static int apple_z2_boot(struct apple_z2 *z2)
 {
 	int timeout;
 	enable_irq(z2->spidev->irq);
+	z2->irq_enabled = 1;
 	gpiod_direction_output(z2->reset_gpio, 0);
 	timeout = wait_for_completion_timeout(&z2->boot_irq, msecs_to_jiffies(20));
 	if (timeout == 0)
@@ -335,6 +403,24 @@ static int apple_z2_boot(struct apple_z2 *z2)
 	return apple_z2_upload_firmware(z2);
 }
 
+static void apple_z2_boot_work(struct work_struct *work)
+{
+	struct apple_z2 *z2 = container_of(work, struct apple_z2, boot_work);
+	int error;
+
+	/*
+	 * The IRQ stays enabled on failure so that close() is balanced; the
+	 * controller is held in reset and will not raise it.
+	 */
+	error = apple_z2_boot(z2);
+	if (error) {
+		dev_err(&z2->spidev->dev, "boot failed: %d\n", error);
+		gpiod_direction_output(z2->reset_gpio, 1);
+	} else {
+		z2->open = 1;
+	}
+}
+
 static int apple_z2_open(struct input_dev *dev)
 {
 	struct apple_z2 *z2 = input_get_drvdata(dev);
@@ -343,10 +429,17 @@ static int apple_z2_open(struct input_dev *dev)
 	/* Reset the device on boot */
 	gpiod_direction_output(z2->reset_gpio, 1);
 	usleep_range(5000, 10000);
+
+	if (async_boot) {
+		schedule_work(&z2->boot_work);
+		return 0;
+	}
+
 	error = apple_z2_boot(z2);
 	if (error) {
 		gpiod_direction_output(z2->reset_gpio, 1);
 		disable_irq(z2->spidev->irq);
+		z2->irq_enabled = 0;
 	} else
 		z2->open = 1;
 	return error;
@@ -356,7 +449,12 @@ static void apple_z2_close(struct input_dev *dev)
 {
 	struct apple_z2 *z2 = input_get_drvdata(dev);
 
-	disable_irq(z2->spidev->irq);
+	cancel_work_sync(&z2->boot_work);
+	/* an async boot cancelled before it started never enabled it */
+	if (z2->irq_enabled) {
+		disable_irq(z2->spidev->irq);
+		z2->irq_enabled = 0;
+	}
 	gpiod_direction_output(z2->reset_gpio, 1);
 	z2->open = 0;
 	z2->booted = 0;
@@ -376,6 +474,8 @@ static int apple_z2_probe(struct spi_device *spi)
 
 	z2->spidev = spi;
 	init_completion(&z2->boot_irq);
+	init_completion(&z2->fw_preload);
+	INIT_WORK(&z2->boot_work, apple_z2_boot_work);
 	spi_set_drvdata(spi, z2);
 
 	z2->cs_gpio = devm_gpiod_get_index(dev, "cs", 0, 0);
@@ -433,6 +533,16 @@ static int apple_z2_probe(struct spi_device *spi)
 		return -EINVAL;
 	}
 
+	/* Start fetching the firmware now so that open() does not wait on it */
+	error = request_firmware_nowait(THIS_MODULE, FW_ACTION_UEVENT, z2->fw_name,
+					dev, GFP_KERNEL, z2, apple_z2_fw_preloaded);
+	if (error)
+		complete_all(&z2->fw_preload);
+
+	error = devm_add_action_or_reset(dev, apple_z2_release_firmware, z2);
+	if (error)
+		return error;
+
 	z2->input_dev = devm_input_allocate_device(dev);
 	if (!z2->input_dev)
 		return -ENOMEM;
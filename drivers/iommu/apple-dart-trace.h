@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Apple DART IOMMU trace points
+ *
+ * Copyright (C) The Asahi Linux Contributors
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM apple_dart
+
+#if !defined(_TRACE_APPLE_DART_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_APPLE_DART_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+TRACE_EVENT(apple_dart_flush,
+	    TP_PROTO(struct device *dev, const unsigned long *sidmap,
+		     unsigned int nr_sids, u64 wait_ns, bool coalesced),
+	    TP_ARGS(dev, sidmap, nr_sids, wait_ns, coalesced),
+
+	    TP_STRUCT__entry(__string(devname, dev_name(dev))
+			     __bitmask(sids, nr_sids)
+			     __field(u64, wait_ns)
+			     __field(bool, coalesced)),
+
+	    TP_fast_assign(__assign_str(devname, dev_name(dev));
+			   __assign_bitmask(sids, sidmap, nr_sids);
+			   __entry->wait_ns = wait_ns;
+			   __entry->coalesced = coalesced;),
+
+	    TP_printk("%s: sids %s flush %s after %llu ns",
+		      __get_str(devname), __get_bitmask(sids),
+		      __entry->coalesced ? "coalesced" : "done",
+		      __entry->wait_ns));
+
+DECLARE_EVENT_CLASS(apple_dart_map_class,
+	    TP_PROTO(struct device *dev, const unsigned long *sidmap,
+		     unsigned int nr_sids, unsigned long iova, size_t size),
+	    TP_ARGS(dev, sidmap, nr_sids, iova, size),
+
+	    TP_STRUCT__entry(__string(devname, dev_name(dev))
+			     __bitmask(sids, nr_sids)
+			     __field(unsigned long, iova)
+			     __field(size_t, size)),
+
+	    TP_fast_assign(__assign_str(devname, dev_name(dev));
+			   __assign_bitmask(sids, sidmap, nr_sids);
+			   __entry->iova = iova;
+			   __entry->size = size;),
+
+	    TP_printk("%s: sids %s iova 0x%lx size 0x%zx",
+		      __get_str(devname), __get_bitmask(sids), __entry->iova,
+		      __entry->size));
+
+DEFINE_EVENT(apple_dart_map_class, apple_dart_map,
+	     TP_PROTO(struct device *dev, const unsigned long *sidmap,
+		      unsigned int nr_sids, unsigned long iova, size_t size),
+	     TP_ARGS(dev, sidmap, nr_sids, iova, size));
+
+DEFINE_EVENT(apple_dart_map_class, apple_dart_unmap,
+	     TP_PROTO(struct device *dev, const unsigned long *sidmap,
+		      unsigned int nr_sids, unsigned long iova, size_t size),
+	     TP_ARGS(dev, sidmap, nr_sids, iova, size));
+
+TRACE_EVENT(apple_dart_fault,
+	    TP_PROTO(struct device *dev, int sid, u32 error, u64 addr),
+	    TP_ARGS(dev, sid, error, addr),
+
+	    TP_STRUCT__entry(__string(devname, dev_name(dev))
+			     __field(int, sid)
+			     __field(u32, error)
+			     __field(u64, addr)),
+
+	    TP_fast_assign(__assign_str(devname, dev_name(dev));
+			   __entry->sid = sid;
+			   __entry->error = error;
+			   __entry->addr = addr;),
+
+	    TP_printk("%s: sid %d error 0x%x at 0x%llx", __get_str(devname),
+		      __entry->sid, __entry->error, __entry->addr));
+
+#endif /* _TRACE_APPLE_DART_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE apple-dart-trace
+#include <trace/define_trace.h>
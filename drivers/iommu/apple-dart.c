@@ -14,6 +14,7 @@
 #include <linux/atomic.h>
 #include <linux/bitfield.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/dev_printk.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
@@ -21,8 +22,11 @@
 #include <linux/io-pgtable.h>
 #include <linux/iommu.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/minmax.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/of_iommu.h>
@@ -30,12 +34,16 @@
 #include <linux/pci.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/swab.h>
 #include <linux/types.h>
 
 #include "dma-iommu.h"
 
+#define CREATE_TRACE_POINTS
+#include "apple-dart-trace.h"
+
 #define DART_MAX_STREAMS 256
 #define DART_MAX_TTBR 4
 #define MAX_DARTS_PER_DEVICE 2
@@ -190,6 +198,31 @@ struct apple_dart_hw {
 	int ttbr_count;
 };
 
+/*
+ * Per-stream statistics, exposed through debugfs.
+ *
+ * The flush counters are only updated with dart->lock held, the map/unmap
+ * and fault counters are updated locklessly from the map path and the
+ * fault handler.
+ *
+ * @flushes: number of TLB flushes issued for this stream
+ * @flushes_coalesced: number of flushes skipped because another CPU flushed
+ * @flush_ns: total time spent waiting for TLB flushes
+ * @flush_max_ns: longest time spent waiting for a single TLB flush
+ * @map_bytes: number of bytes mapped
+ * @unmap_bytes: number of bytes unmapped
+ * @faults: number of translation faults
+ */
+struct apple_dart_stream_stats {
+	u64 flushes;
+	u64 flushes_coalesced;
+	u64 flush_ns;
+	u64 flush_max_ns;
+	atomic64_t map_bytes;
+	atomic64_t unmap_bytes;
+	atomic64_t faults;
+};
+
 /*
  * Private structure associated with each DART device.
  *
@@ -206,6 +239,8 @@ struct apple_dart_hw {
  * @locked: indicates if this DART is locked
  * @sid2group: maps stream ids to iommu_groups
  * @iommu: iommu core device
+ * @stats: per-stream statistics, @num_streams entries
+ * @debugfs: debugfs directory of this DART
  */
 struct apple_dart {
 	struct device *dev;
@@ -239,6 +274,9 @@ struct apple_dart {
 
 	u64 *locked_ttbr[DART_MAX_STREAMS][DART_MAX_TTBR];
 	u64 *shadow_ttbr[DART_MAX_STREAMS][DART_MAX_TTBR];
+
+	struct apple_dart_stream_stats *stats;
+	struct dentry *debugfs;
 };
 
 /*
@@ -253,8 +291,13 @@ struct apple_dart {
  * and never changed again afterwards. Devices with different dart pointers
  * cannot be attached to the same domain.
  *
+ * The atomic variant additionally carries a TLB flush sequence number which
+ * is only modified under dart->lock and allows concurrent flushes of the same
+ * streams to be coalesced, see apple_dart_domain_flush_tlb().
+ *
  * @dart dart pointer
  * @sid stream id bitmap
+ * @flush_seq number of TLB flushes started for these streams
  */
 struct apple_dart_stream_map {
 	struct apple_dart *dart;
@@ -263,6 +306,7 @@ struct apple_dart_stream_map {
 struct apple_dart_atomic_stream_map {
 	struct apple_dart *dart;
 	atomic_long_t sidmap[BITS_TO_LONGS(DART_MAX_STREAMS)];
+	unsigned int flush_seq;
 };
 
 /*
@@ -476,11 +520,10 @@ static int
 apple_dart_t8020_hw_stream_command(struct apple_dart_stream_map *stream_map,
 			     u32 command)
 {
-	unsigned long flags;
 	int ret;
 	u32 command_reg;
 
-	spin_lock_irqsave(&stream_map->dart->lock, flags);
+	lockdep_assert_held(&stream_map->dart->lock);
 
 	writel(stream_map->sidmap[0], stream_map->dart->regs + DART_T8020_STREAM_SELECT);
 	writel(command, stream_map->dart->regs + DART_T8020_STREAM_COMMAND);
@@ -490,8 +533,6 @@ apple_dart_t8020_hw_stream_command(struct apple_dart_stream_map *stream_map,
 		!(command_reg & DART_T8020_STREAM_COMMAND_BUSY), 1,
 		DART_STREAM_COMMAND_BUSY_TIMEOUT);
 
-	spin_unlock_irqrestore(&stream_map->dart->lock, flags);
-
 	if (ret) {
 		dev_err(stream_map->dart->dev,
 			"busy bit did not clear after command %x for streams %lx\n",
@@ -507,11 +548,10 @@ apple_dart_t8110_hw_tlb_command(struct apple_dart_stream_map *stream_map,
 				u32 command)
 {
 	struct apple_dart *dart = stream_map->dart;
-	unsigned long flags;
 	int ret = 0;
 	int sid;
 
-	spin_lock_irqsave(&dart->lock, flags);
+	lockdep_assert_held(&dart->lock);
 
 	for_each_set_bit(sid, stream_map->sidmap, dart->num_streams) {
 		u32 val = FIELD_PREP(DART_T8110_TLB_CMD_OP, command) |
@@ -528,8 +568,6 @@ apple_dart_t8110_hw_tlb_command(struct apple_dart_stream_map *stream_map,
 
 	}
 
-	spin_unlock_irqrestore(&dart->lock, flags);
-
 	if (ret) {
 		dev_err(stream_map->dart->dev,
 			"busy bit did not clear after command %x for stream %d\n",
@@ -554,6 +592,18 @@ apple_dart_t8110_hw_invalidate_tlb(struct apple_dart_stream_map *stream_map)
 		stream_map, DART_T8110_TLB_CMD_OP_FLUSH_SID);
 }
 
+static int apple_dart_invalidate_tlb(struct apple_dart_stream_map *stream_map)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&stream_map->dart->lock, flags);
+	ret = stream_map->dart->hw->invalidate_tlb(stream_map);
+	spin_unlock_irqrestore(&stream_map->dart->lock, flags);
+
+	return ret;
+}
+
 static int apple_dart_hw_reset(struct apple_dart *dart)
 {
 	struct apple_dart_stream_map stream_map;
@@ -575,14 +625,89 @@ static int apple_dart_hw_reset(struct apple_dart *dart)
 	if (dart->hw->type == DART_T8110)
 		writel(0,  dart->regs + DART_T8110_ERROR_MASK);
 
-	return dart->hw->invalidate_tlb(&stream_map);
+	return apple_dart_invalidate_tlb(&stream_map);
+}
+
+static void apple_dart_account_flush(struct apple_dart *dart,
+				     const unsigned long *sidmap, u64 wait,
+				     bool coalesced)
+{
+	struct apple_dart_stream_stats *stats;
+	int sid;
+
+	lockdep_assert_held(&dart->lock);
+
+	for_each_set_bit(sid, sidmap, dart->num_streams) {
+		stats = &dart->stats[sid];
+		if (coalesced) {
+			stats->flushes_coalesced++;
+			continue;
+		}
+		stats->flushes++;
+		stats->flush_ns += wait;
+		stats->flush_max_ns = max(stats->flush_max_ns, wait);
+	}
+}
+
+static void apple_dart_account_map(struct apple_dart_domain *domain,
+				   unsigned long iova, size_t size, bool unmap)
+{
+	struct apple_dart_atomic_stream_map *domain_stream_map;
+	struct apple_dart_stream_map stream_map;
+	struct apple_dart_stream_stats *stats;
+	int i, j, sid;
+
+	for_each_stream_map(i, domain, domain_stream_map) {
+		stream_map.dart = domain_stream_map->dart;
+
+		for (j = 0; j < BITS_TO_LONGS(stream_map.dart->num_streams); j++)
+			stream_map.sidmap[j] = atomic_long_read(&domain_stream_map->sidmap[j]);
+
+		for_each_set_bit(sid, stream_map.sidmap,
+				 stream_map.dart->num_streams) {
+			stats = &stream_map.dart->stats[sid];
+			atomic64_add(size, unmap ? &stats->unmap_bytes :
+						   &stats->map_bytes);
+		}
+
+		if (unmap)
+			trace_apple_dart_unmap(stream_map.dart->dev,
+					       stream_map.sidmap,
+					       stream_map.dart->num_streams,
+					       iova, size);
+		else
+			trace_apple_dart_map(stream_map.dart->dev,
+					     stream_map.sidmap,
+					     stream_map.dart->num_streams,
+					     iova, size);
+	}
 }
 
+/*
+ * Neither DART variant can invalidate an IOVA range, everything here ends up
+ * as a flush of the whole stream. These flushes are fairly expensive since we
+ * have to poll for completion with dart->lock held, and when multiple CPUs
+ * unmap from the same domain at the same time most of them are redundant:
+ * Any flush of the same streams that was started after our page table
+ * updates already covers them.
+ *
+ * Track this with a per-stream map sequence number which is incremented under
+ * dart->lock right before a flush is issued. If it moved by the time we own
+ * the lock someone else flushed after our updates and we're done.
+ */
 static void apple_dart_domain_flush_tlb(struct apple_dart_domain *domain)
 {
 	int i, j;
 	struct apple_dart_atomic_stream_map *domain_stream_map;
 	struct apple_dart_stream_map stream_map;
+	struct apple_dart *dart;
+	unsigned long flags;
+	unsigned int seq;
+	bool coalesced;
+	u64 start, wait;
+
+	/* order the page table updates against reading flush_seq */
+	smp_mb();
 
 	for_each_stream_map(i, domain, domain_stream_map) {
 		stream_map.dart = domain_stream_map->dart;
@@ -590,13 +715,33 @@ static void apple_dart_domain_flush_tlb(struct apple_dart_domain *domain)
 		for (j = 0; j < BITS_TO_LONGS(stream_map.dart->num_streams); j++)
 			stream_map.sidmap[j] = atomic_long_read(&domain_stream_map->sidmap[j]);
 
-		WARN_ON(pm_runtime_get_sync(stream_map.dart->dev) < 0);
+		if (bitmap_empty(stream_map.sidmap, stream_map.dart->num_streams))
+			continue;
+
+		seq = READ_ONCE(domain_stream_map->flush_seq);
+
+		dart = stream_map.dart;
+		WARN_ON(pm_runtime_get_sync(dart->dev) < 0);
+
+		start = ktime_get_ns();
+		spin_lock_irqsave(&dart->lock, flags);
+		coalesced = domain_stream_map->flush_seq != seq;
+		if (!coalesced) {
+			WRITE_ONCE(domain_stream_map->flush_seq, seq + 1);
 
-		if (stream_map.dart->locked)
-			apple_dart_hw_sync_locked(&stream_map);
+			if (dart->locked)
+				apple_dart_hw_sync_locked(&stream_map);
 
-		stream_map.dart->hw->invalidate_tlb(&stream_map);
-		pm_runtime_put(stream_map.dart->dev);
+			dart->hw->invalidate_tlb(&stream_map);
+		}
+		wait = ktime_get_ns() - start;
+		apple_dart_account_flush(dart, stream_map.sidmap, wait, coalesced);
+		spin_unlock_irqrestore(&dart->lock, flags);
+
+		pm_runtime_put(dart->dev);
+
+		trace_apple_dart_flush(dart->dev, stream_map.sidmap,
+				       dart->num_streams, wait, coalesced);
 	}
 }
 
@@ -608,7 +753,14 @@ static void apple_dart_flush_iotlb_all(struct iommu_domain *domain)
 static void apple_dart_iotlb_sync(struct iommu_domain *domain,
 				  struct iommu_iotlb_gather *gather)
 {
+	/* nothing was unmapped, the TLB can't hold any stale entries */
+	if (gather->start > gather->end)
+		return;
+
 	apple_dart_domain_flush_tlb(to_dart_domain(domain));
+
+	/* page tables unhooked by io-pgtable can only go after the flush */
+	put_pages_list(&gather->freelist);
 }
 
 static void apple_dart_iotlb_sync_map(struct iommu_domain *domain,
@@ -636,12 +788,17 @@ static int apple_dart_map_pages(struct iommu_domain *domain, unsigned long iova,
 {
 	struct apple_dart_domain *dart_domain = to_dart_domain(domain);
 	struct io_pgtable_ops *ops = dart_domain->pgtbl_ops;
+	int ret;
 
 	if (!ops)
 		return -ENODEV;
 
-	return ops->map_pages(ops, iova & dart_domain->mask, paddr, pgsize,
-			      pgcount, prot, gfp, mapped);
+	ret = ops->map_pages(ops, iova & dart_domain->mask, paddr, pgsize,
+			     pgcount, prot, gfp, mapped);
+	if (*mapped)
+		apple_dart_account_map(dart_domain, iova, *mapped, false);
+
+	return ret;
 }
 
 static size_t apple_dart_unmap_pages(struct iommu_domain *domain,
@@ -651,9 +808,16 @@ static size_t apple_dart_unmap_pages(struct iommu_domain *domain,
 {
 	struct apple_dart_domain *dart_domain = to_dart_domain(domain);
 	struct io_pgtable_ops *ops = dart_domain->pgtbl_ops;
+	size_t unmapped;
+
+	unmapped = ops->unmap_pages(ops, iova & dart_domain->mask, pgsize,
+				    pgcount, gather);
+	if (unmapped) {
+		iommu_iotlb_gather_add_range(gather, iova, unmapped);
+		apple_dart_account_map(dart_domain, iova, unmapped, true);
+	}
 
-	return ops->unmap_pages(ops, iova & dart_domain->mask, pgsize, pgcount,
-				gather);
+	return unmapped;
 }
 
 static void
@@ -682,7 +846,7 @@ apple_dart_setup_translation(struct apple_dart_domain *domain,
 		apple_dart_hw_enable_translation(stream_map,
 						 pgtbl_cfg->apple_dart_cfg.n_levels);
 	}
-	stream_map->dart->hw->invalidate_tlb(stream_map);
+	apple_dart_invalidate_tlb(stream_map);
 }
 
 static int apple_dart_setup_resv_locked(struct iommu_domain *domain,
@@ -863,6 +1027,7 @@ static int apple_dart_attach_dev(struct iommu_domain *domain,
 	if (!dart0->supports_bypass && domain->type == IOMMU_DOMAIN_IDENTITY)
 		return -EINVAL;
 	if (dart0->locked && domain->type != IOMMU_DOMAIN_DMA &&
+	    domain->type != IOMMU_DOMAIN_DMA_FQ &&
 	    domain->type != IOMMU_DOMAIN_UNMANAGED)
 		return -EINVAL;
 
@@ -875,6 +1040,7 @@ static int apple_dart_attach_dev(struct iommu_domain *domain,
 
 	switch (domain->type) {
 	case IOMMU_DOMAIN_DMA:
+	case IOMMU_DOMAIN_DMA_FQ:
 	case IOMMU_DOMAIN_UNMANAGED:
 		ret = apple_dart_domain_add_streams(dart_domain, cfg);
 		if (ret)
@@ -936,8 +1102,9 @@ static struct iommu_domain *apple_dart_domain_alloc(unsigned int type)
 {
 	struct apple_dart_domain *dart_domain;
 
-	if (type != IOMMU_DOMAIN_DMA && type != IOMMU_DOMAIN_UNMANAGED &&
-	    type != IOMMU_DOMAIN_IDENTITY && type != IOMMU_DOMAIN_BLOCKED)
+	if (type != IOMMU_DOMAIN_DMA && type != IOMMU_DOMAIN_DMA_FQ &&
+	    type != IOMMU_DOMAIN_UNMANAGED && type != IOMMU_DOMAIN_IDENTITY &&
+	    type != IOMMU_DOMAIN_BLOCKED)
 		return NULL;
 
 	dart_domain = kzalloc(sizeof(*dart_domain), GFP_KERNEL);
@@ -1133,10 +1300,17 @@ static int apple_dart_def_domain_type(struct device *dev)
 
 	if (dart->force_bypass)
 		return IOMMU_DOMAIN_IDENTITY;
-	if (dart->locked)
-		return IOMMU_DOMAIN_DMA;
-	if (dart->supports_bypass)
-		return IOMMU_DOMAIN_DMA;
+
+	/*
+	 * Locked DARTs (and, by policy, those supporting bypass) must always
+	 * translate. If the global default already is a translated domain let
+	 * the core pick it though, so that iommu.strict=0 gives us a
+	 * IOMMU_DOMAIN_DMA_FQ domain with deferred invalidation. Locked DARTs
+	 * are fine with that: the shadow L1 table is synced to the locked one
+	 * on every flush, including the ones issued by the flush queue.
+	 */
+	if (dart->locked || dart->supports_bypass)
+		return iommu_default_passthrough() ? IOMMU_DOMAIN_DMA : 0;
 
 	return 0;
 }
@@ -1221,6 +1395,10 @@ static irqreturn_t apple_dart_t8020_irq(int irq, void *dev)
 		"translation fault: status:0x%x stream:%d code:0x%x (%s) at 0x%llx",
 		error, stream_idx, error_code, fault_name, addr);
 
+	if (stream_idx < dart->num_streams)
+		atomic64_inc(&dart->stats[stream_idx].faults);
+	trace_apple_dart_fault(dart->dev, stream_idx, error_code, addr);
+
 	writel(error, dart->regs + DART_T8020_ERROR);
 	return IRQ_HANDLED;
 }
@@ -1261,6 +1439,10 @@ static irqreturn_t apple_dart_t8110_irq(int irq, void *dev)
 		"translation fault: status:0x%x stream:%d code:0x%x (%s) at 0x%llx",
 		error, stream_idx, error_code, fault_name, addr);
 
+	if (stream_idx < dart->num_streams)
+		atomic64_inc(&dart->stats[stream_idx].faults);
+	trace_apple_dart_fault(dart->dev, stream_idx, error_code, addr);
+
 	writel(error, dart->regs + DART_T8110_ERROR);
 	for (i = 0; i < BITS_TO_U32(dart->num_streams); i++)
 		writel(U32_MAX, dart->regs + DART_T8110_ERROR_STREAMS + 4 * i);
@@ -1268,6 +1450,65 @@ static irqreturn_t apple_dart_t8110_irq(int irq, void *dev)
 	return IRQ_HANDLED;
 }
 
+#ifdef CONFIG_IOMMU_DEBUGFS
+static struct dentry *apple_dart_debugfs_dir;
+static DEFINE_MUTEX(apple_dart_debugfs_lock);
+
+static int apple_dart_stats_show(struct seq_file *m, void *unused)
+{
+	struct apple_dart *dart = m->private;
+	struct apple_dart_stream_stats *stats;
+	u64 flushes, coalesced, flush_ns, flush_max_ns;
+	unsigned long flags;
+	int sid;
+
+	seq_puts(m, "sid flushes coalesced flush_avg_ns flush_max_ns map_bytes unmap_bytes faults\n");
+
+	for (sid = 0; sid < dart->num_streams; sid++) {
+		stats = &dart->stats[sid];
+
+		spin_lock_irqsave(&dart->lock, flags);
+		flushes = stats->flushes;
+		coalesced = stats->flushes_coalesced;
+		flush_ns = stats->flush_ns;
+		flush_max_ns = stats->flush_max_ns;
+		spin_unlock_irqrestore(&dart->lock, flags);
+
+		if (!flushes && !coalesced && !atomic64_read(&stats->map_bytes) &&
+		    !atomic64_read(&stats->faults))
+			continue;
+
+		seq_printf(m, "%3d %llu %llu %llu %llu %lld %lld %lld\n", sid,
+			   flushes, coalesced,
+			   flushes ? div64_u64(flush_ns, flushes) : 0,
+			   flush_max_ns, atomic64_read(&stats->map_bytes),
+			   atomic64_read(&stats->unmap_bytes),
+			   atomic64_read(&stats->faults));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(apple_dart_stats);
+
+static void apple_dart_debugfs_init(struct apple_dart *dart)
+{
+	mutex_lock(&apple_dart_debugfs_lock);
+	if (!apple_dart_debugfs_dir) {
+		iommu_debugfs_setup();
+		apple_dart_debugfs_dir = debugfs_create_dir("apple-dart",
+							    iommu_debugfs_dir);
+	}
+	mutex_unlock(&apple_dart_debugfs_lock);
+
+	dart->debugfs = debugfs_create_dir(dev_name(dart->dev),
+					   apple_dart_debugfs_dir);
+	debugfs_create_file("stats", 0444, dart->debugfs, dart,
+			    &apple_dart_stats_fops);
+}
+#else
+static inline void apple_dart_debugfs_init(struct apple_dart *dart) {}
+#endif
+
 static bool apple_dart_is_locked(struct apple_dart *dart)
 {
 	return !!(readl(dart->regs + dart->hw->lock) & dart->hw->lock_bit);
@@ -1370,6 +1611,13 @@ static int apple_dart_probe(struct platform_device *pdev)
 		goto err_clk_disable;
 	}
 
+	dart->stats = devm_kcalloc(dev, dart->num_streams, sizeof(*dart->stats),
+				   GFP_KERNEL);
+	if (!dart->stats) {
+		ret = -ENOMEM;
+		goto err_clk_disable;
+	}
+
 	dart->force_bypass = dart->pgsize > PAGE_SIZE;
 
 	dart->locked = apple_dart_is_locked(dart);
@@ -1395,6 +1643,8 @@ static int apple_dart_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_sysfs_remove;
 
+	apple_dart_debugfs_init(dart);
+
 	pm_runtime_put(dev);
 
 	dev_info(
@@ -1424,6 +1674,8 @@ static void apple_dart_remove(struct platform_device *pdev)
 
 	free_irq(dart->irq, dart);
 
+	debugfs_remove_recursive(dart->debugfs);
+
 	iommu_device_unregister(&dart->iommu);
 	iommu_device_sysfs_remove(&dart->iommu);
 
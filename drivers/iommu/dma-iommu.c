@@ -83,6 +83,16 @@ static int __init iommu_dma_forcedac_setup(char *str)
 }
 early_param("iommu.forcedac", iommu_dma_forcedac_setup);
 
+/* Largest mapping whose IOVA is kept in the per-CPU caches of a domain */
+static unsigned long iommu_dma_rcache_range __read_mostly = SZ_4M;
+
+static int __init iommu_dma_rcache_range_setup(char *str)
+{
+	iommu_dma_rcache_range = memparse(str, &str);
+	return 0;
+}
+early_param("iommu.dma_rcache_range", iommu_dma_rcache_range_setup);
+
 /* Number of entries per flush queue */
 #define IOVA_FQ_SIZE	256
 
@@ -586,7 +596,8 @@ static int iommu_dma_init_domain(struct iommu_domain *domain, dma_addr_t base,
 	}
 
 	init_iova_domain(iovad, 1UL << order, base_pfn);
-	ret = iova_domain_init_rcaches(iovad);
+	ret = iova_domain_init_rcaches_max(iovad,
+					   iommu_dma_rcache_range >> order);
 	if (ret)
 		goto done_unlock;
 
@@ -1060,6 +1071,118 @@ static void iommu_dma_unmap_page(struct device *dev, dma_addr_t dma_handle,
 		swiotlb_tbl_unmap_single(dev, phys, size, dir, attrs);
 }
 
+/*
+ * Map @nr pages of @size bytes each and make all of them visible to the
+ * device with one ->iotlb_sync_map() over the range they ended up in.
+ */
+static void iommu_dma_map_page_batch(struct device *dev, struct page **pages,
+		dma_addr_t *dma_handles, unsigned int nr, size_t size,
+		enum dma_data_direction dir, unsigned long attrs)
+{
+	bool coherent = dev_is_dma_coherent(dev);
+	int prot = dma_info_to_prot(dir, coherent, attrs);
+	struct iommu_domain *domain = iommu_get_dma_domain(dev);
+	struct iommu_dma_cookie *cookie = domain->iova_cookie;
+	struct iova_domain *iovad = &cookie->iovad;
+	dma_addr_t start = DMA_MAPPING_ERROR, end = 0;
+	u64 dma_mask = dma_get_mask(dev);
+	unsigned int i;
+
+	if (dev_use_swiotlb(dev) ||
+	    static_branch_unlikely(&iommu_deferred_attach_enabled)) {
+		for (i = 0; i < nr; i++)
+			dma_handles[i] = iommu_dma_map_page(dev, pages[i], 0,
+							    size, dir, attrs);
+		return;
+	}
+
+	for (i = 0; i < nr; i++) {
+		phys_addr_t phys = page_to_phys(pages[i]);
+		size_t iova_off = iova_offset(iovad, phys);
+		size_t len = iova_align(iovad, size + iova_off);
+		dma_addr_t iova;
+
+		if (!coherent && !(attrs & DMA_ATTR_SKIP_CPU_SYNC))
+			arch_sync_dma_for_device(phys, size, dir);
+
+		iova = iommu_dma_alloc_iova(domain, len, dma_mask, dev);
+		if (iova && iommu_map_nosync(domain, iova, phys - iova_off, len,
+					     prot, GFP_ATOMIC)) {
+			iommu_dma_free_iova(cookie, iova, len, NULL);
+			iova = 0;
+		}
+		if (!iova) {
+			dma_handles[i] = DMA_MAPPING_ERROR;
+			continue;
+		}
+
+		start = min(start, iova);
+		end = max(end, iova + len);
+		dma_handles[i] = iova + iova_off;
+	}
+
+	if (end)
+		iommu_sync_map(domain, start, end - start);
+}
+
+/*
+ * Unmap @nr mappings with a single IOTLB invalidation.  The IOVAs are only
+ * released once that is done, so none of them can be reused while a stale
+ * translation may still be cached.
+ */
+static void iommu_dma_unmap_page_batch(struct device *dev,
+		dma_addr_t *dma_handles, size_t *sizes, unsigned int nr,
+		enum dma_data_direction dir, unsigned long attrs)
+{
+	struct iommu_domain *domain = iommu_get_dma_domain(dev);
+	struct iommu_dma_cookie *cookie = domain->iova_cookie;
+	struct iova_domain *iovad = &cookie->iovad;
+	bool sync = !(attrs & DMA_ATTR_SKIP_CPU_SYNC) &&
+		    !dev_is_dma_coherent(dev);
+	struct iommu_iotlb_gather iotlb_gather;
+	unsigned int i;
+
+	/* bounce buffers are torn down one by one after their unmap */
+	if (dev_use_swiotlb(dev)) {
+		for (i = 0; i < nr; i++)
+			iommu_dma_unmap_page(dev, dma_handles[i], sizes[i],
+					     dir, attrs);
+		return;
+	}
+
+	iommu_iotlb_gather_init(&iotlb_gather);
+	iotlb_gather.queued = READ_ONCE(cookie->fq_domain);
+
+	for (i = 0; i < nr; i++) {
+		size_t iova_off = iova_offset(iovad, dma_handles[i]);
+		size_t len = iova_align(iovad, sizes[i] + iova_off);
+		size_t unmapped;
+
+		if (sync) {
+			phys_addr_t phys;
+
+			phys = iommu_iova_to_phys(domain, dma_handles[i]);
+			if (!WARN_ON(!phys))
+				arch_sync_dma_for_cpu(phys, sizes[i], dir);
+		}
+
+		unmapped = iommu_unmap_fast(domain, dma_handles[i] - iova_off,
+					    len, &iotlb_gather);
+		WARN_ON(unmapped != len);
+	}
+
+	if (!iotlb_gather.queued)
+		iommu_iotlb_sync(domain, &iotlb_gather);
+
+	for (i = 0; i < nr; i++) {
+		size_t iova_off = iova_offset(iovad, dma_handles[i]);
+
+		iommu_dma_free_iova(cookie, dma_handles[i] - iova_off,
+				    iova_align(iovad, sizes[i] + iova_off),
+				    &iotlb_gather);
+	}
+}
+
 /*
  * Prepare a successfully-mapped scatterlist to give back to the caller.
  *
@@ -1569,6 +1692,8 @@ static const struct dma_map_ops iommu_dma_ops = {
 	.get_sgtable		= iommu_dma_get_sgtable,
 	.map_page		= iommu_dma_map_page,
 	.unmap_page		= iommu_dma_unmap_page,
+	.map_page_batch		= iommu_dma_map_page_batch,
+	.unmap_page_batch	= iommu_dma_unmap_page_batch,
 	.map_sg			= iommu_dma_map_sg,
 	.unmap_sg		= iommu_dma_unmap_sg,
 	.sync_single_for_cpu	= iommu_dma_sync_single_for_cpu,
@@ -114,7 +114,11 @@ static void *__dart_alloc_pages(size_t size, gfp_t gfp)
 	struct page *p;
 
 	VM_BUG_ON((gfp & __GFP_HIGHMEM));
-	p = alloc_pages(gfp | __GFP_ZERO, order);
+	/*
+	 * Tables can be handed back through iommu_iotlb_gather.freelist which
+	 * is released with put_pages_list(), so they must be compound.
+	 */
+	p = alloc_pages(gfp | __GFP_ZERO | __GFP_COMP, order);
 	if (!p)
 		return NULL;
 
@@ -184,7 +188,8 @@ static int dart_get_last_index(struct dart_io_pgtable *data, unsigned long iova)
 		 ((1 << data->bits_per_level) - 1);
 }
 
-static dart_iopte *dart_get_last(struct dart_io_pgtable *data, unsigned long iova)
+static dart_iopte *__dart_get_last(struct dart_io_pgtable *data,
+				    unsigned long iova, dart_iopte **parentp)
 {
 	dart_iopte pte, *ptep;
 	int level = data->levels;
@@ -205,6 +210,9 @@ static dart_iopte *dart_get_last(struct dart_io_pgtable *data, unsigned long iov
 		if (!pte)
 			return NULL;
 
+		if (parentp)
+			*parentp = ptep;
+
 		/* Deref to get next level table */
 		ptep = iopte_deref(pte, data);
 	}
@@ -212,6 +220,50 @@ static dart_iopte *dart_get_last(struct dart_io_pgtable *data, unsigned long iov
 	return ptep;
 }
 
+static dart_iopte *dart_get_last(struct dart_io_pgtable *data, unsigned long iova)
+{
+	return __dart_get_last(data, iova, NULL);
+}
+
+/*
+ * Like dart_get_last() but allocates any missing tables on the way down.
+ */
+static dart_iopte *dart_get_last_alloc(struct dart_io_pgtable *data,
+				       unsigned long iova, gfp_t gfp)
+{
+	size_t tblsz = DART_GRANULE(data);
+	dart_iopte pte, *cptep, *ptep;
+	int level = data->levels;
+	int tbl = dart_get_index(data, iova, level);
+
+	if (tbl > (1 << data->tbl_bits))
+		return NULL;
+
+	ptep = data->pgd[tbl];
+	while (--level > 1) {
+		ptep += dart_get_index(data, iova, level);
+		pte = READ_ONCE(*ptep);
+
+		/* no table present */
+		if (!pte) {
+			cptep = __dart_alloc_pages(tblsz, gfp);
+			if (!cptep)
+				return NULL;
+
+			pte = dart_install_table(cptep, ptep, 0, data);
+			if (pte)
+				free_pages((unsigned long)cptep, get_order(tblsz));
+
+			/* L2 table is present (now) */
+			pte = READ_ONCE(*ptep);
+		}
+
+		ptep = iopte_deref(pte, data);
+	}
+
+	return ptep;
+}
+
 static dart_iopte dart_prot_to_pte(struct dart_io_pgtable *data,
 					   int prot)
 {
@@ -241,11 +293,9 @@ static int dart_map_pages(struct io_pgtable_ops *ops, unsigned long iova,
 {
 	struct dart_io_pgtable *data = io_pgtable_ops_to_data(ops);
 	struct io_pgtable_cfg *cfg = &data->iop.cfg;
-	size_t tblsz = DART_GRANULE(data);
-	int ret = 0, tbl, num_entries, max_entries, map_idx_start;
-	dart_iopte pte, *cptep, *ptep;
+	int ret = 0, num_entries, max_entries, map_idx_start;
+	dart_iopte *ptep;
 	dart_iopte prot;
-	int level = data->levels;
 
 	if (WARN_ON(pgsize != cfg->pgsize_bitmap))
 		return -EINVAL;
@@ -257,43 +307,37 @@ static int dart_map_pages(struct io_pgtable_ops *ops, unsigned long iova,
 	if (!(iommu_prot & (IOMMU_READ | IOMMU_WRITE)))
 		return 0;
 
-	tbl = dart_get_index(data, iova, level);
-
-	if (tbl > (1 << data->tbl_bits))
-		return -ENOMEM;
-
-	ptep = data->pgd[tbl];
-	while (--level > 1) {
-		ptep += dart_get_index(data, iova, level);
-		pte = READ_ONCE(*ptep);
+	prot = dart_prot_to_pte(data, iommu_prot);
 
-		/* no table present */
-		if (!pte) {
-			cptep = __dart_alloc_pages(tblsz, gfp);
-			if (!cptep)
-				return -ENOMEM;
+	/*
+	 * Fill as many L2 tables as needed in one go instead of returning to
+	 * the IOMMU core after each one, which would then walk all the way
+	 * down from the TTBR again for every table.
+	 */
+	while (pgcount) {
+		ptep = dart_get_last_alloc(data, iova, gfp);
+		if (!ptep) {
+			ret = -ENOMEM;
+			break;
+		}
 
-			pte = dart_install_table(cptep, ptep, 0, data);
-			if (pte)
-				free_pages((unsigned long)cptep, get_order(tblsz));
+		/* install a leaf entries into L2 table */
+		map_idx_start = dart_get_last_index(data, iova);
+		max_entries = DART_PTES_PER_TABLE(data) - map_idx_start;
+		num_entries = min_t(size_t, pgcount, max_entries);
+		ret = dart_init_pte(data, iova, paddr, prot, num_entries,
+				    ptep + map_idx_start);
+		if (ret)
+			break;
 
-			/* L2 table is present (now) */
-			pte = READ_ONCE(*ptep);
-		}
+		if (mapped)
+			*mapped += num_entries * pgsize;
 
-		ptep = iopte_deref(pte, data);
+		iova += num_entries * pgsize;
+		paddr += num_entries * pgsize;
+		pgcount -= num_entries;
 	}
 
-	/* install a leaf entries into L2 table */
-	prot = dart_prot_to_pte(data, iommu_prot);
-	map_idx_start = dart_get_last_index(data, iova);
-	max_entries = DART_PTES_PER_TABLE(data) - map_idx_start;
-	num_entries = min_t(int, pgcount, max_entries);
-	ptep += map_idx_start;
-	ret = dart_init_pte(data, iova, paddr, prot, num_entries, ptep);
-	if (!ret && mapped)
-		*mapped += num_entries * pgsize;
-
 	/*
 	 * Synchronise all PTE updates for the new mapping before there's
 	 * a chance for anything to kick off a table walk for the new iova.
@@ -309,41 +353,57 @@ static size_t dart_unmap_pages(struct io_pgtable_ops *ops, unsigned long iova,
 {
 	struct dart_io_pgtable *data = io_pgtable_ops_to_data(ops);
 	struct io_pgtable_cfg *cfg = &data->iop.cfg;
-	int i = 0, num_entries, max_entries, unmap_idx_start;
-	dart_iopte pte, *ptep;
+	int i, num_entries, max_entries, unmap_idx_start;
+	dart_iopte pte, *ptep, *tblp, *parentp = NULL;
+	size_t unmapped = 0;
 
 	if (WARN_ON(pgsize != cfg->pgsize_bitmap || !pgcount))
 		return 0;
 
-	ptep = dart_get_last(data, iova);
+	while (pgcount) {
+		tblp = __dart_get_last(data, iova, &parentp);
 
-	/* Valid L2 IOPTE pointer? */
-	if (WARN_ON(!ptep))
-		return 0;
+		/* Valid L2 IOPTE pointer? */
+		if (WARN_ON(!tblp))
+			break;
 
-	unmap_idx_start = dart_get_last_index(data, iova);
-	ptep += unmap_idx_start;
+		unmap_idx_start = dart_get_last_index(data, iova);
+		ptep = tblp + unmap_idx_start;
 
-	max_entries = DART_PTES_PER_TABLE(data) - unmap_idx_start;
-	num_entries = min_t(int, pgcount, max_entries);
+		max_entries = DART_PTES_PER_TABLE(data) - unmap_idx_start;
+		num_entries = min_t(size_t, pgcount, max_entries);
 
-	while (i < num_entries) {
-		pte = READ_ONCE(*ptep);
-		if (WARN_ON(!pte))
-			break;
+		for (i = 0; i < num_entries; i++) {
+			pte = READ_ONCE(*ptep);
+			if (WARN_ON(!pte))
+				return unmapped;
 
-		/* clear pte */
-		*ptep = 0;
+			/* clear pte */
+			*ptep = 0;
 
-		if (!iommu_iotlb_gather_queued(gather))
-			io_pgtable_tlb_add_page(&data->iop, gather,
-						iova + i * pgsize, pgsize);
+			if (!iommu_iotlb_gather_queued(gather))
+				io_pgtable_tlb_add_page(&data->iop, gather,
+							iova, pgsize);
 
-		ptep++;
-		i++;
+			unmapped += pgsize;
+			iova += pgsize;
+			ptep++;
+		}
+		pgcount -= num_entries;
+
+		/*
+		 * If the caller just unmapped the whole range covered by this
+		 * table nobody else can be mapping into it, so unhook it and
+		 * hand it to the caller to free once the TLB has been flushed.
+		 */
+		if (num_entries == DART_PTES_PER_TABLE(data) && gather) {
+			WRITE_ONCE(*parentp, 0);
+			list_add_tail(&virt_to_page(tblp)->lru,
+				      &gather->freelist);
+		}
 	}
 
-	return i * pgsize;
+	return unmapped;
 }
 
 static phys_addr_t dart_iova_to_phys(struct io_pgtable_ops *ops,
@@ -462,6 +522,7 @@ apple_dart_alloc_pgtable(struct io_pgtable_cfg *cfg, void *cookie)
 
 static void apple_dart_free_pgtables(struct dart_io_pgtable *data, dart_iopte *ptep, int level)
 {
+	dart_iopte *start = ptep;
 	dart_iopte *end;
 
 	if (level > 1) {
@@ -474,7 +535,7 @@ static void apple_dart_free_pgtables(struct dart_io_pgtable *data, dart_iopte *p
 				apple_dart_free_pgtables(data, iopte_deref(pte, data), level - 1);
 		}
 	}
-	free_pages((unsigned long)ptep, get_order(DART_GRANULE(data)));
+	free_pages((unsigned long)start, get_order(DART_GRANULE(data)));
 }
 
 static void apple_dart_free_pgtable(struct io_pgtable *iop)
@@ -2428,12 +2428,14 @@ static int __iommu_map(struct iommu_domain *domain, unsigned long iova,
 	return ret;
 }
 
-int iommu_map(struct iommu_domain *domain, unsigned long iova,
-	      phys_addr_t paddr, size_t size, int prot, gfp_t gfp)
+/*
+ * Like iommu_map(), but the caller has to call iommu_sync_map() before the
+ * device may use the new mapping.  This lets several mappings share a single
+ * ->iotlb_sync_map() call.
+ */
+int iommu_map_nosync(struct iommu_domain *domain, unsigned long iova,
+		     phys_addr_t paddr, size_t size, int prot, gfp_t gfp)
 {
-	const struct iommu_domain_ops *ops = domain->ops;
-	int ret;
-
 	might_sleep_if(gfpflags_allow_blocking(gfp));
 
 	/* Discourage passing strange GFP flags */
@@ -2441,9 +2443,28 @@ int iommu_map(struct iommu_domain *domain, unsigned long iova,
 				__GFP_HIGHMEM)))
 		return -EINVAL;
 
-	ret = __iommu_map(domain, iova, paddr, size, prot, gfp);
-	if (ret == 0 && ops->iotlb_sync_map)
+	return __iommu_map(domain, iova, paddr, size, prot, gfp);
+}
+EXPORT_SYMBOL_GPL(iommu_map_nosync);
+
+void iommu_sync_map(struct iommu_domain *domain, unsigned long iova,
+		    size_t size)
+{
+	const struct iommu_domain_ops *ops = domain->ops;
+
+	if (ops->iotlb_sync_map)
 		ops->iotlb_sync_map(domain, iova, size);
+}
+EXPORT_SYMBOL_GPL(iommu_sync_map);
+
+int iommu_map(struct iommu_domain *domain, unsigned long iova,
+	      phys_addr_t paddr, size_t size, int prot, gfp_t gfp)
+{
+	int ret;
+
+	ret = iommu_map_nosync(domain, iova, paddr, size, prot, gfp);
+	if (ret == 0)
+		iommu_sync_map(domain, iova, size);
 
 	return ret;
 }
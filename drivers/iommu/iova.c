@@ -15,7 +15,9 @@
 /* The anchor node sits above the top of the usable address space */
 #define IOVA_ANCHOR	~0UL
 
-#define IOVA_RANGE_CACHE_MAX_SIZE 6	/* log of max cached IOVA range size (in pages) */
+/* log of max cached IOVA range size (in pages), by default and at most */
+#define IOVA_RANGE_CACHE_DEFAULT_SIZE 6
+#define IOVA_RANGE_CACHE_MAX_SIZE 12
 
 static bool iova_rcache_insert(struct iova_domain *iovad,
 			       unsigned long pfn,
@@ -28,7 +30,7 @@ static void free_iova_rcaches(struct iova_domain *iovad);
 
 unsigned long iova_rcache_range(void)
 {
-	return PAGE_SIZE << (IOVA_RANGE_CACHE_MAX_SIZE - 1);
+	return PAGE_SIZE << (IOVA_RANGE_CACHE_DEFAULT_SIZE - 1);
 }
 
 static int iova_cpuhp_dead(unsigned int cpu, struct hlist_node *node)
@@ -448,7 +450,7 @@ alloc_iova_fast(struct iova_domain *iovad, unsigned long size,
 	 * rounding up anything cacheable to make sure that can't happen. The
 	 * order of the unadjusted size will still match upon freeing.
 	 */
-	if (size < (1 << (IOVA_RANGE_CACHE_MAX_SIZE - 1)))
+	if (size < (1 << (iovad->rcache_orders - 1)))
 		size = roundup_pow_of_two(size);
 
 	iova_pfn = iova_rcache_get(iovad, size, limit_pfn + 1);
@@ -678,14 +680,19 @@ iova_magazine_free_pfns(struct iova_magazine *mag, struct iova_domain *iovad)
 	mag->size = 0;
 }
 
+/*
+ * Magazines of the orders above IOVA_RANGE_CACHE_DEFAULT_SIZE are only
+ * allocated once a range of that order is freed on the CPU, so a missing
+ * magazine counts as both full and empty.
+ */
 static bool iova_magazine_full(struct iova_magazine *mag)
 {
-	return mag->size == IOVA_MAG_SIZE;
+	return !mag || mag->size == IOVA_MAG_SIZE;
 }
 
 static bool iova_magazine_empty(struct iova_magazine *mag)
 {
-	return mag->size == 0;
+	return !mag || mag->size == 0;
 }
 
 static unsigned long iova_magazine_pop(struct iova_magazine *mag,
@@ -711,18 +718,33 @@ static void iova_magazine_push(struct iova_magazine *mag, unsigned long pfn)
 	mag->pfns[mag->size++] = pfn;
 }
 
-int iova_domain_init_rcaches(struct iova_domain *iovad)
+/**
+ * iova_domain_init_rcaches_max - set up the per-CPU caches of a domain
+ * @iovad: - iova domain in question
+ * @max_size: - largest allocation to cache, in granules
+ *
+ * Allocations up to @max_size granules, rounded up to a power of two, are
+ * cached. The cached range is never smaller than the default one and is
+ * capped at 1 << (IOVA_RANGE_CACHE_MAX_SIZE - 1) granules. Magazines for
+ * the orders above the default are allocated on demand.
+ */
+int iova_domain_init_rcaches_max(struct iova_domain *iovad,
+				 unsigned long max_size)
 {
 	unsigned int cpu;
 	int i, ret;
 
-	iovad->rcaches = kcalloc(IOVA_RANGE_CACHE_MAX_SIZE,
+	iovad->rcache_orders = clamp_t(unsigned int,
+				       order_base_2(max_size) + 1,
+				       IOVA_RANGE_CACHE_DEFAULT_SIZE,
+				       IOVA_RANGE_CACHE_MAX_SIZE);
+	iovad->rcaches = kcalloc(iovad->rcache_orders,
 				 sizeof(struct iova_rcache),
 				 GFP_KERNEL);
 	if (!iovad->rcaches)
 		return -ENOMEM;
 
-	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
+	for (i = 0; i < iovad->rcache_orders; ++i) {
 		struct iova_cpu_rcache *cpu_rcache;
 		struct iova_rcache *rcache;
 
@@ -739,6 +761,8 @@ int iova_domain_init_rcaches(struct iova_domain *iovad)
 			cpu_rcache = per_cpu_ptr(rcache->cpu_rcaches, cpu);
 
 			spin_lock_init(&cpu_rcache->lock);
+			if (i >= IOVA_RANGE_CACHE_DEFAULT_SIZE)
+				continue;
 			cpu_rcache->loaded = iova_magazine_alloc(GFP_KERNEL);
 			cpu_rcache->prev = iova_magazine_alloc(GFP_KERNEL);
 			if (!cpu_rcache->loaded || !cpu_rcache->prev) {
@@ -758,6 +782,12 @@ int iova_domain_init_rcaches(struct iova_domain *iovad)
 	free_iova_rcaches(iovad);
 	return ret;
 }
+EXPORT_SYMBOL_GPL(iova_domain_init_rcaches_max);
+
+int iova_domain_init_rcaches(struct iova_domain *iovad)
+{
+	return iova_domain_init_rcaches_max(iovad, 0);
+}
 EXPORT_SYMBOL_GPL(iova_domain_init_rcaches);
 
 /*
@@ -787,14 +817,17 @@ static bool __iova_rcache_insert(struct iova_domain *iovad,
 		struct iova_magazine *new_mag = iova_magazine_alloc(GFP_ATOMIC);
 
 		if (new_mag) {
-			spin_lock(&rcache->lock);
-			if (rcache->depot_size < MAX_GLOBAL_MAGS) {
-				rcache->depot[rcache->depot_size++] =
-						cpu_rcache->loaded;
-			} else {
-				mag_to_free = cpu_rcache->loaded;
+			/* NULL for the first range of this order on this CPU */
+			if (cpu_rcache->loaded) {
+				spin_lock(&rcache->lock);
+				if (rcache->depot_size < MAX_GLOBAL_MAGS) {
+					rcache->depot[rcache->depot_size++] =
+							cpu_rcache->loaded;
+				} else {
+					mag_to_free = cpu_rcache->loaded;
+				}
+				spin_unlock(&rcache->lock);
 			}
-			spin_unlock(&rcache->lock);
 
 			cpu_rcache->loaded = new_mag;
 			can_insert = true;
@@ -819,7 +852,7 @@ static bool iova_rcache_insert(struct iova_domain *iovad, unsigned long pfn,
 {
 	unsigned int log_size = order_base_2(size);
 
-	if (log_size >= IOVA_RANGE_CACHE_MAX_SIZE)
+	if (log_size >= iovad->rcache_orders)
 		return false;
 
 	return __iova_rcache_insert(iovad, &iovad->rcaches[log_size], pfn);
@@ -875,7 +908,7 @@ static unsigned long iova_rcache_get(struct iova_domain *iovad,
 {
 	unsigned int log_size = order_base_2(size);
 
-	if (log_size >= IOVA_RANGE_CACHE_MAX_SIZE)
+	if (log_size >= iovad->rcache_orders)
 		return 0;
 
 	return __iova_rcache_get(&iovad->rcaches[log_size], limit_pfn - size);
@@ -891,7 +924,7 @@ static void free_iova_rcaches(struct iova_domain *iovad)
 	unsigned int cpu;
 	int i, j;
 
-	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
+	for (i = 0; i < iovad->rcache_orders; ++i) {
 		rcache = &iovad->rcaches[i];
 		if (!rcache->cpu_rcaches)
 			break;
@@ -919,12 +952,14 @@ static void free_cpu_cached_iovas(unsigned int cpu, struct iova_domain *iovad)
 	unsigned long flags;
 	int i;
 
-	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
+	for (i = 0; i < iovad->rcache_orders; ++i) {
 		rcache = &iovad->rcaches[i];
 		cpu_rcache = per_cpu_ptr(rcache->cpu_rcaches, cpu);
 		spin_lock_irqsave(&cpu_rcache->lock, flags);
-		iova_magazine_free_pfns(cpu_rcache->loaded, iovad);
-		iova_magazine_free_pfns(cpu_rcache->prev, iovad);
+		if (cpu_rcache->loaded)
+			iova_magazine_free_pfns(cpu_rcache->loaded, iovad);
+		if (cpu_rcache->prev)
+			iova_magazine_free_pfns(cpu_rcache->prev, iovad);
 		spin_unlock_irqrestore(&cpu_rcache->lock, flags);
 	}
 }
@@ -938,7 +973,7 @@ static void free_global_cached_iovas(struct iova_domain *iovad)
 	unsigned long flags;
 	int i, j;
 
-	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
+	for (i = 0; i < iovad->rcache_orders; ++i) {
 		rcache = &iovad->rcaches[i];
 		spin_lock_irqsave(&rcache->lock, flags);
 		for (j = 0; j < rcache->depot_size; ++j) {
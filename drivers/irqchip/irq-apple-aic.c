@@ -48,15 +48,20 @@
 #include <linux/bits.h>
 #include <linux/bitfield.h>
 #include <linux/cpuhotplug.h>
+#include <linux/debugfs.h>
 #include <linux/io.h>
 #include <linux/irqchip.h>
 #include <linux/irqchip/arm-vgic-info.h>
 #include <linux/irqdomain.h>
 #include <linux/jump_label.h>
 #include <linux/limits.h>
+#include <linux/log2.h>
+#include <linux/moduleparam.h>
 #include <linux/of_address.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <asm/apple_m1_pmu.h>
+#include <asm/arch_timer.h>
 #include <asm/cputype.h>
 #include <asm/exception.h>
 #include <asm/sysreg.h>
@@ -236,6 +241,16 @@ enum fiq_hwirq {
 
 static DEFINE_STATIC_KEY_TRUE(use_fast_ipi);
 
+/*
+ * AICv2 has no per-IRQ affinity and distributes IRQs across all CPUs by
+ * itself. It can be told to prefer P-cores for delivery. Unless asked for
+ * either way, keep whatever the firmware configured.
+ */
+static int aic_prefer_pcpu = -1;
+module_param_named(prefer_pcpu, aic_prefer_pcpu, int, 0444);
+MODULE_PARM_DESC(prefer_pcpu,
+		 "Prefer P-cores for AICv2 IRQ delivery (0: no, 1: yes, -1: firmware default)");
+
 struct aic_info {
 	int version;
 
@@ -316,6 +331,95 @@ static struct aic_irq_chip *aic_irqc;
 
 static void aic_handle_ipi(struct pt_regs *regs);
 
+/*
+ * Optional dispatch statistics, enabled through debugfs. Besides per-class
+ * event counters, two latencies can be measured exactly: timer FIQs against
+ * the programmed compare value and IPIs against the time they were sent.
+ */
+enum aic_stat {
+	AIC_STAT_IRQ,
+	AIC_STAT_IPI,
+	AIC_STAT_TIMER,
+	AIC_STAT_PMU,
+	AIC_STAT_UPMC,
+	AIC_STAT_SPURIOUS,
+	AIC_NR_STAT,
+};
+
+/* Bucket 0 is < 1us, bucket n covers [2^(n-1), 2^n) us */
+#define AIC_HIST_BUCKETS	12
+
+enum aic_lat {
+	AIC_LAT_TIMER,
+	AIC_LAT_IPI,
+	AIC_NR_LAT,
+};
+
+struct aic_cpu_stats {
+	u64 count[AIC_NR_STAT];
+	u64 hist[AIC_NR_LAT][AIC_HIST_BUCKETS];
+	u64 max_ns[AIC_NR_LAT];
+	/* counter value of the last IPI sent to this CPU */
+	u64 ipi_sent;
+};
+
+#ifdef CONFIG_DEBUG_FS
+static DEFINE_STATIC_KEY_FALSE(aic_stats_key);
+static DEFINE_PER_CPU(struct aic_cpu_stats, aic_cpu_stats);
+
+static void aic_stat_inc(enum aic_stat stat)
+{
+	if (static_branch_unlikely(&aic_stats_key))
+		__this_cpu_inc(aic_cpu_stats.count[stat]);
+}
+
+static void aic_stat_latency(enum aic_lat lat, u64 ticks)
+{
+	struct aic_cpu_stats *stats = this_cpu_ptr(&aic_cpu_stats);
+	u64 ns = div_u64(ticks * NSEC_PER_USEC, arch_timer_get_rate() / USEC_PER_SEC);
+	int bucket = min_t(int, fls64(div_u64(ns, NSEC_PER_USEC)),
+			   AIC_HIST_BUCKETS - 1);
+
+	stats->hist[lat][bucket]++;
+	stats->max_ns[lat] = max(stats->max_ns[lat], ns);
+}
+
+static void aic_stat_timer(u64 cval, u64 cnt)
+{
+	if (!static_branch_unlikely(&aic_stats_key))
+		return;
+
+	__this_cpu_inc(aic_cpu_stats.count[AIC_STAT_TIMER]);
+	if (cnt > cval)
+		aic_stat_latency(AIC_LAT_TIMER, cnt - cval);
+}
+
+static void aic_stat_ipi_sent(int cpu)
+{
+	if (static_branch_unlikely(&aic_stats_key))
+		WRITE_ONCE(per_cpu(aic_cpu_stats.ipi_sent, cpu),
+			   read_sysreg(cntpct_el0));
+}
+
+static void aic_stat_ipi(void)
+{
+	u64 sent;
+
+	if (!static_branch_unlikely(&aic_stats_key))
+		return;
+
+	__this_cpu_inc(aic_cpu_stats.count[AIC_STAT_IPI]);
+	sent = xchg(this_cpu_ptr(&aic_cpu_stats.ipi_sent), 0);
+	if (sent)
+		aic_stat_latency(AIC_LAT_IPI, read_sysreg(cntpct_el0) - sent);
+}
+#else
+static inline void aic_stat_inc(enum aic_stat stat) {}
+static inline void aic_stat_timer(u64 cval, u64 cnt) {}
+static inline void aic_stat_ipi_sent(int cpu) {}
+static inline void aic_stat_ipi(void) {}
+#endif
+
 static u32 aic_ic_read(struct aic_irq_chip *ic, u32 reg)
 {
 	return readl_relaxed(ic->base + reg);
@@ -376,12 +480,15 @@ static void __exception_irq_entry aic_handle_irq(struct pt_regs *regs)
 		type = FIELD_GET(AIC_EVENT_TYPE, event);
 		irq = FIELD_GET(AIC_EVENT_NUM, event);
 
-		if (type == AIC_EVENT_TYPE_IRQ)
+		if (type == AIC_EVENT_TYPE_IRQ) {
+			aic_stat_inc(AIC_STAT_IRQ);
 			generic_handle_domain_irq(aic_irqc->hw_domain, event);
-		else if (type == AIC_EVENT_TYPE_IPI && irq == 1)
+		} else if (type == AIC_EVENT_TYPE_IPI && irq == 1) {
 			aic_handle_ipi(regs);
-		else if (event != 0)
+		} else if (event != 0) {
+			aic_stat_inc(AIC_STAT_SPURIOUS);
 			pr_err_ratelimited("Unknown IRQ event %d, %d\n", type, irq);
+		}
 	} while (event);
 
 	/*
@@ -408,17 +515,41 @@ static int aic_irq_set_affinity(struct irq_data *d,
 {
 	irq_hw_number_t hwirq = irqd_to_hwirq(d);
 	struct aic_irq_chip *ic = irq_data_get_irq_chip_data(d);
+	struct cpumask *pcpus = NULL;
+	cpumask_t targets;
+	u32 val = 0;
 	int cpu;
 
 	BUG_ON(!ic->info.target_cpu);
 
-	if (force)
+	if (force) {
 		cpu = cpumask_first(mask_val);
-	else
-		cpu = cpumask_any_and(mask_val, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			return -EINVAL;
+		cpumask_copy(&targets, cpumask_of(cpu));
+	} else if (!cpumask_and(&targets, mask_val, cpu_online_mask)) {
+		return -EINVAL;
+	}
+
+	/*
+	 * The target register is a CPU mask and AIC delivers the IRQ to
+	 * whichever of the targets is available. If the requested mask spans
+	 * both clusters, keep the IRQ on the P-cores.
+	 */
+	if (ic->fiq_aff[AIC_CPU_PMU_P])
+		pcpus = &ic->fiq_aff[AIC_CPU_PMU_P]->aff;
+	if (pcpus && cpumask_intersects(&targets, pcpus) &&
+	    !cpumask_subset(&targets, pcpus))
+		cpumask_and(&targets, &targets, pcpus);
+
+	for_each_cpu(cpu, &targets) {
+		if (WARN_ON_ONCE(cpu >= 32))
+			break;
+		val |= BIT(cpu);
+	}
 
-	aic_ic_write(ic, ic->info.target_cpu + AIC_HWIRQ_IRQ(hwirq) * 4, BIT(cpu));
-	irq_data_update_effective_affinity(d, cpumask_of(cpu));
+	aic_ic_write(ic, ic->info.target_cpu + AIC_HWIRQ_IRQ(hwirq) * 4, val);
+	irq_data_update_effective_affinity(d, &targets);
 
 	return IRQ_SET_MASK_OK;
 }
@@ -541,26 +672,34 @@ static void __exception_irq_entry aic_handle_fiq(struct pt_regs *regs)
 		}
 	}
 
-	if (TIMER_FIRING(read_sysreg(cntp_ctl_el0)))
+	if (TIMER_FIRING(read_sysreg(cntp_ctl_el0))) {
+		aic_stat_timer(read_sysreg(cntp_cval_el0), read_sysreg(cntpct_el0));
 		generic_handle_domain_irq(aic_irqc->hw_domain,
 					  AIC_FIQ_HWIRQ(AIC_TMR_EL0_PHYS));
+	}
 
-	if (TIMER_FIRING(read_sysreg(cntv_ctl_el0)))
+	if (TIMER_FIRING(read_sysreg(cntv_ctl_el0))) {
+		aic_stat_timer(read_sysreg(cntv_cval_el0), read_sysreg(cntvct_el0));
 		generic_handle_domain_irq(aic_irqc->hw_domain,
 					  AIC_FIQ_HWIRQ(AIC_TMR_EL0_VIRT));
+	}
 
 	if (is_kernel_in_hyp_mode()) {
 		uint64_t enabled = read_sysreg_s(SYS_IMP_APL_VM_TMR_FIQ_ENA_EL2);
 
 		if ((enabled & VM_TMR_FIQ_ENABLE_P) &&
-		    TIMER_FIRING(read_sysreg_s(SYS_CNTP_CTL_EL02)))
+		    TIMER_FIRING(read_sysreg_s(SYS_CNTP_CTL_EL02))) {
+			aic_stat_inc(AIC_STAT_TIMER);
 			generic_handle_domain_irq(aic_irqc->hw_domain,
 						  AIC_FIQ_HWIRQ(AIC_TMR_EL02_PHYS));
+		}
 
 		if ((enabled & VM_TMR_FIQ_ENABLE_V) &&
-		    TIMER_FIRING(read_sysreg_s(SYS_CNTV_CTL_EL02)))
+		    TIMER_FIRING(read_sysreg_s(SYS_CNTV_CTL_EL02))) {
+			aic_stat_inc(AIC_STAT_TIMER);
 			generic_handle_domain_irq(aic_irqc->hw_domain,
 						  AIC_FIQ_HWIRQ(AIC_TMR_EL02_VIRT));
+		}
 	}
 
 	if (read_sysreg_s(SYS_IMP_APL_PMCR0_EL1) & PMCR0_IACT) {
@@ -570,6 +709,7 @@ static void __exception_irq_entry aic_handle_fiq(struct pt_regs *regs)
 			irq = AIC_CPU_PMU_P;
 		else
 			irq = AIC_CPU_PMU_E;
+		aic_stat_inc(AIC_STAT_PMU);
 		generic_handle_domain_irq(aic_irqc->hw_domain,
 					  AIC_FIQ_HWIRQ(irq));
 	}
@@ -577,6 +717,7 @@ static void __exception_irq_entry aic_handle_fiq(struct pt_regs *regs)
 	if (FIELD_GET(UPMCR0_IMODE, read_sysreg_s(SYS_IMP_APL_UPMCR0_EL1)) == UPMCR0_IMODE_FIQ &&
 			(read_sysreg_s(SYS_IMP_APL_UPMSR_EL1) & UPMSR_IACT)) {
 		/* Same story with uncore PMCs */
+		aic_stat_inc(AIC_STAT_UPMC);
 		pr_err_ratelimited("Uncore PMC FIQ fired. Masking.\n");
 		sysreg_clear_set_s(SYS_IMP_APL_UPMCR0_EL1, UPMCR0_IMODE,
 				   FIELD_PREP(UPMCR0_IMODE, UPMCR0_IMODE_OFF));
@@ -614,7 +755,9 @@ static int aic_irq_domain_map(struct irq_domain *id, unsigned int irq,
 	if (type == AIC_EVENT_TYPE_IRQ) {
 		irq_domain_set_info(id, irq, hw, chip, id->host_data,
 				    handle_fasteoi_irq, NULL, NULL);
-		irqd_set_single_target(irq_desc_get_irq_data(irq_to_desc(irq)));
+		/* AICv1 IRQs may target several CPUs, see aic_irq_set_affinity() */
+		if (ic->info.version == 2)
+			irqd_set_single_target(irq_desc_get_irq_data(irq_to_desc(irq)));
 	} else {
 		int fiq = FIELD_GET(AIC_EVENT_NUM, hw);
 
@@ -775,6 +918,7 @@ static void aic_handle_ipi(struct pt_regs *regs)
 		aic_ic_write(aic_irqc, AIC_IPI_ACK, AIC_IPI_OTHER);
 	}
 
+	aic_stat_ipi();
 	ipi_mux_process();
 
 	/*
@@ -787,6 +931,7 @@ static void aic_handle_ipi(struct pt_regs *regs)
 
 static void aic_ipi_send_single(unsigned int cpu)
 {
+	aic_stat_ipi_sent(cpu);
 	if (static_branch_likely(&use_fast_ipi))
 		aic_ipi_send_fast(cpu);
 	else
@@ -1032,6 +1177,10 @@ static int __init aic_of_ic_init(struct device_node *node, struct device_node *p
 		u32 config = aic_ic_read(irqc, AIC2_CONFIG);
 
 		config |= AIC2_CONFIG_ENABLE;
+		if (aic_prefer_pcpu > 0)
+			config |= AIC2_CONFIG_PREFER_PCPU;
+		else if (!aic_prefer_pcpu)
+			config &= ~AIC2_CONFIG_PREFER_PCPU;
 		aic_ic_write(irqc, AIC2_CONFIG, config);
 	}
 
@@ -1077,5 +1226,92 @@ static int __init aic_of_ic_init(struct device_node *node, struct device_node *p
 	return -ENODEV;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static const char * const aic_stat_names[AIC_NR_STAT] = {
+	[AIC_STAT_IRQ] = "irq",
+	[AIC_STAT_IPI] = "ipi",
+	[AIC_STAT_TIMER] = "timer",
+	[AIC_STAT_PMU] = "pmu",
+	[AIC_STAT_UPMC] = "upmc",
+	[AIC_STAT_SPURIOUS] = "spurious",
+};
+
+static const char * const aic_lat_names[AIC_NR_LAT] = {
+	[AIC_LAT_TIMER] = "timer",
+	[AIC_LAT_IPI] = "ipi",
+};
+
+static int aic_stats_show(struct seq_file *s, void *data)
+{
+	int cpu, i, j;
+
+	for_each_possible_cpu(cpu) {
+		struct aic_cpu_stats *stats = per_cpu_ptr(&aic_cpu_stats, cpu);
+
+		seq_printf(s, "cpu%d:", cpu);
+		for (i = 0; i < AIC_NR_STAT; i++)
+			seq_printf(s, " %s=%llu", aic_stat_names[i],
+				   stats->count[i]);
+		seq_puts(s, "\n");
+
+		for (i = 0; i < AIC_NR_LAT; i++) {
+			seq_printf(s, "  %s latency (max %llu ns):",
+				   aic_lat_names[i], stats->max_ns[i]);
+			for (j = 0; j < AIC_HIST_BUCKETS; j++)
+				seq_printf(s, " %llu", stats->hist[i][j]);
+			seq_puts(s, "\n");
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(aic_stats);
+
+static int aic_stats_enable_get(void *data, u64 *val)
+{
+	*val = static_key_enabled(&aic_stats_key);
+	return 0;
+}
+
+static int aic_stats_enable_set(void *data, u64 val)
+{
+	int cpu;
+
+	if (!val) {
+		static_branch_disable(&aic_stats_key);
+		return 0;
+	}
+
+	if (static_key_enabled(&aic_stats_key))
+		return 0;
+
+	/* Start from scratch, the key is off so nothing updates these */
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&aic_cpu_stats, cpu), 0,
+		       sizeof(struct aic_cpu_stats));
+
+	static_branch_enable(&aic_stats_key);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(aic_stats_enable_fops, aic_stats_enable_get,
+			 aic_stats_enable_set, "%llu\n");
+
+static int __init aic_debugfs_init(void)
+{
+	struct dentry *root;
+
+	if (!aic_irqc)
+		return 0;
+
+	root = debugfs_create_dir("apple-aic", NULL);
+	debugfs_create_file("stats", 0400, root, NULL, &aic_stats_fops);
+	debugfs_create_file_unsafe("stats_enable", 0600, root, NULL,
+				   &aic_stats_enable_fops);
+
+	return 0;
+}
+late_initcall(aic_debugfs_init);
+#endif
+
 IRQCHIP_DECLARE(apple_aic, "apple,aic", aic_of_ic_init);
 IRQCHIP_DECLARE(apple_aic2, "apple,aic2", aic_of_ic_init);
@@ -74,6 +74,7 @@ struct dm_crypt_io {
 	u8 *integrity_metadata;
 	bool integrity_metadata_from_pool:1;
 	bool in_tasklet:1;
+	bool crypt_inline:1;
 
 	struct work_struct work;
 	struct tasklet_struct tasklet;
@@ -137,7 +138,8 @@ struct iv_elephant_private {
 enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
 	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_OFFLOAD,
 	     DM_CRYPT_NO_READ_WORKQUEUE, DM_CRYPT_NO_WRITE_WORKQUEUE,
-	     DM_CRYPT_WRITE_INLINE };
+	     DM_CRYPT_WRITE_INLINE, DM_CRYPT_ADAPTIVE,
+	     DM_CRYPT_ADAPTIVE_INLINE };
 
 enum cipher_flags {
 	CRYPT_MODE_INTEGRITY_AEAD,	/* Use authenticated mode for cipher */
@@ -1128,6 +1130,16 @@ static bool crypt_integrity_hmac(struct crypt_config *cc)
 	return crypt_integrity_aead(cc) && cc->key_mac_size;
 }
 
+static bool crypt_tfm_async(struct crypt_config *cc)
+{
+	if (crypt_integrity_aead(cc))
+		return crypto_aead_alg(any_tfm_aead(cc))->base.cra_flags &
+		       CRYPTO_ALG_ASYNC;
+
+	return crypto_skcipher_alg(any_tfm(cc))->base.cra_flags &
+	       CRYPTO_ALG_ASYNC;
+}
+
 /* Get sg containing data */
 static struct scatterlist *crypt_get_sg_data(struct crypt_config *cc,
 					     struct scatterlist *sg)
@@ -1733,6 +1745,7 @@ static void crypt_io_init(struct dm_crypt_io *io, struct crypt_config *cc,
 	io->integrity_metadata = NULL;
 	io->integrity_metadata_from_pool = false;
 	io->in_tasklet = false;
+	io->crypt_inline = false;
 	atomic_set(&io->io_pending, 0);
 }
 
@@ -1965,8 +1978,14 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 
 	clone->bi_iter.bi_sector = cc->start + io->sector;
 
+	/*
+	 * Sorting writes only pays off when seeking is expensive, so in
+	 * adaptive mode non-rotational devices get them submitted directly.
+	 */
 	if ((likely(!async) && test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags)) ||
-	    test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags)) {
+	    test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags) ||
+	    (test_bit(DM_CRYPT_ADAPTIVE, &cc->flags) &&
+	     bdev_nonrot(cc->dev->bdev))) {
 		dm_submit_bio_remap(io->base_bio, clone);
 		return;
 	}
@@ -2068,8 +2087,7 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 	sector += bio_sectors(clone);
 
 	crypt_inc_pending(io);
-	r = crypt_convert(cc, ctx,
-			  test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags), true);
+	r = crypt_convert(cc, ctx, io->crypt_inline, true);
 	/*
 	 * Crypto API backlogged the request, because its queue was full
 	 * and we're in softirq context, so continue from a workqueue
@@ -2133,8 +2151,7 @@ static void kcryptd_crypt_read_convert(struct dm_crypt_io *io)
 	crypt_convert_init(cc, &io->ctx, io->base_bio, io->base_bio,
 			   io->sector);
 
-	r = crypt_convert(cc, &io->ctx,
-			  test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags), true);
+	r = crypt_convert(cc, &io->ctx, io->crypt_inline, true);
 	/*
 	 * Crypto API backlogged the request, because its queue was full
 	 * and we're in softirq context, so continue from a workqueue
@@ -2221,12 +2238,35 @@ static void kcryptd_crypt_tasklet(unsigned long work)
 	kcryptd_crypt((struct work_struct *)work);
 }
 
+/*
+ * In adaptive mode bios up to this size are processed by the CPU that
+ * submitted or completed them, when the cipher is synchronous. Bigger
+ * ones are worth spreading over the kcryptd workers.
+ */
+#define DM_CRYPT_ADAPTIVE_INLINE_SIZE	(64 << 10)
+
+static bool kcryptd_crypt_inline(struct dm_crypt_io *io)
+{
+	struct crypt_config *cc = io->cc;
+
+	if (bio_data_dir(io->base_bio) == READ) {
+		if (test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags))
+			return true;
+	} else {
+		if (test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags))
+			return true;
+	}
+
+	return test_bit(DM_CRYPT_ADAPTIVE_INLINE, &cc->flags) &&
+	       io->base_bio->bi_iter.bi_size <= DM_CRYPT_ADAPTIVE_INLINE_SIZE;
+}
+
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->cc;
 
-	if ((bio_data_dir(io->base_bio) == READ && test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags)) ||
-	    (bio_data_dir(io->base_bio) == WRITE && test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags))) {
+	if (kcryptd_crypt_inline(io)) {
+		io->crypt_inline = true;
 		/*
 		 * in_hardirq(): Crypto API's skcipher_walk_first() refuses to work in hard IRQ context.
 		 * irqs_disabled(): the kernel may run some IO completion from the idle thread, but
@@ -3072,7 +3112,7 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 	struct crypt_config *cc = ti->private;
 	struct dm_arg_set as;
 	static const struct dm_arg _args[] = {
-		{0, 8, "Invalid number of feature args"},
+		{0, 9, "Invalid number of feature args"},
 	};
 	unsigned int opt_params, val;
 	const char *opt_string, *sval;
@@ -3106,6 +3146,8 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 			set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
 		else if (!strcasecmp(opt_string, "no_write_workqueue"))
 			set_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+		else if (!strcasecmp(opt_string, "adaptive_workqueue"))
+			set_bit(DM_CRYPT_ADAPTIVE, &cc->flags);
 		else if (sscanf(opt_string, "integrity:%u:", &val) == 1) {
 			if (val == 0 || val > MAX_TAG_SIZE) {
 				ti->error = "Invalid integrity arguments";
@@ -3217,6 +3259,13 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	if (ret < 0)
 		goto bad;
 
+	/*
+	 * Inline processing would stall the submitter on an asynchronous
+	 * cipher's queue, leave those to the workqueue.
+	 */
+	if (test_bit(DM_CRYPT_ADAPTIVE, &cc->flags) && !crypt_tfm_async(cc))
+		set_bit(DM_CRYPT_ADAPTIVE_INLINE, &cc->flags);
+
 	if (crypt_integrity_aead(cc)) {
 		cc->dmreq_start = sizeof(struct aead_request);
 		cc->dmreq_start += crypto_aead_reqsize(any_tfm_aead(cc));
@@ -3488,6 +3537,7 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		num_feature_args += test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+		num_feature_args += test_bit(DM_CRYPT_ADAPTIVE, &cc->flags);
 		num_feature_args += cc->sector_size != (1 << SECTOR_SHIFT);
 		num_feature_args += test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags);
 		if (cc->on_disk_tag_size)
@@ -3504,6 +3554,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 				DMEMIT(" no_read_workqueue");
 			if (test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags))
 				DMEMIT(" no_write_workqueue");
+			if (test_bit(DM_CRYPT_ADAPTIVE, &cc->flags))
+				DMEMIT(" adaptive_workqueue");
 			if (cc->on_disk_tag_size)
 				DMEMIT(" integrity:%u:%s", cc->on_disk_tag_size, cc->cipher_auth);
 			if (cc->sector_size != (1 << SECTOR_SHIFT))
@@ -3523,6 +3575,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		       'y' : 'n');
 		DMEMIT(",no_write_workqueue=%c", test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags) ?
 		       'y' : 'n');
+		DMEMIT(",adaptive_workqueue=%c", test_bit(DM_CRYPT_ADAPTIVE, &cc->flags) ?
+		       'y' : 'n');
 		DMEMIT(",iv_large_sectors=%c", test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags) ?
 		       'y' : 'n');
 
@@ -3644,7 +3698,7 @@ static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 24, 0},
+	.version = {1, 25, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -145,6 +145,9 @@ static int verity_hash_init(struct dm_verity *v, struct ahash_request *req,
 					crypto_req_done, (void *)wait);
 	crypto_init_wait(wait);
 
+	if (likely(v->initial_hashstate))
+		return crypto_ahash_import(req, v->initial_hashstate);
+
 	r = crypto_wait_req(crypto_ahash_init(req), wait);
 
 	if (unlikely(r < 0)) {
@@ -964,6 +967,7 @@ static void verity_dtr(struct dm_target *ti)
 
 	kvfree(v->validated_blocks);
 	kfree(v->salt);
+	kfree(v->initial_hashstate);
 	kfree(v->root_digest);
 	kfree(v->zero_digest);
 
@@ -990,6 +994,45 @@ static void verity_dtr(struct dm_target *ti)
 	dm_audit_log_dtr(DM_MSG_PREFIX, ti, 1);
 }
 
+/*
+ * With the salt prepended (version >= 1), every hash starts out the same way.
+ * Hash the salt once and keep the exported state, so that verity_hash_init()
+ * only has to import it instead of re-hashing the salt for each block.
+ * Algorithms that cannot export their state just keep doing the latter.
+ */
+static int verity_init_salted_state(struct dm_verity *v)
+{
+	struct ahash_request *req;
+	struct crypto_wait wait;
+	u8 *state, *digest;
+	int r;
+
+	state = kmalloc(crypto_ahash_statesize(v->tfm), GFP_KERNEL);
+	digest = kmalloc(v->digest_size, GFP_KERNEL);
+	req = kmalloc(v->ahash_reqsize, GFP_KERNEL);
+	if (!state || !digest || !req) {
+		r = -ENOMEM;
+		goto out;
+	}
+
+	r = verity_hash_init(v, req, &wait);
+	if (unlikely(r < 0))
+		goto out;
+
+	if (!crypto_ahash_export(req, state)) {
+		v->initial_hashstate = state;
+		state = NULL;
+	}
+
+	/* finish the request, some drivers hold resources until final */
+	r = verity_hash_final(v, req, digest, &wait);
+out:
+	kfree(req);
+	kfree(digest);
+	kfree(state);
+	return r;
+}
+
 static int verity_alloc_most_once(struct dm_verity *v)
 {
 	struct dm_target *ti = v->ti;
@@ -1342,6 +1385,14 @@ static int verity_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 			r = -EINVAL;
 			goto bad;
 		}
+
+		if (v->version >= 1) {
+			r = verity_init_salted_state(v);
+			if (r) {
+				ti->error = "Cannot hash salt";
+				goto bad;
+			}
+		}
 	}
 
 	argv += 10;
@@ -68,6 +68,16 @@ static bool devices_handle_discard_safely = false;
 module_param(devices_handle_discard_safely, bool, 0644);
 MODULE_PARM_DESC(devices_handle_discard_safely,
 		 "Set to Y if all devices in each array reliably return zeroes on reads from discarded regions");
+
+/*
+ * Workers are only kicked in proportion to the number of queued stripes
+ * (see raid5_wakeup_stripe_thread()), so a non-zero default just caps how
+ * far stripe handling scales out under load.
+ */
+static unsigned int default_group_thread_cnt;
+module_param(default_group_thread_cnt, uint, 0644);
+MODULE_PARM_DESC(default_group_thread_cnt,
+		 "Default group_thread_cnt of new arrays, 0 handles stripes in raid5d only (default), at most 8192");
 static struct workqueue_struct *raid5_wq;
 
 static inline struct hlist_head *stripe_hash(struct r5conf *conf, sector_t sect)
@@ -7477,6 +7487,7 @@ static struct r5conf *setup_conf(struct mddev *mddev)
 	char pers_name[6];
 	int i;
 	int group_cnt;
+	unsigned int worker_cnt;
 	struct r5worker_group *new_group;
 	int ret = -ENOMEM;
 
@@ -7527,10 +7538,11 @@ static struct r5conf *setup_conf(struct mddev *mddev)
 		goto abort;
 	for (i = 0; i < PENDING_IO_MAX; i++)
 		list_add(&conf->pending_data[i].sibling, &conf->free_list);
-	/* Don't enable multi-threading by default*/
-	if (!alloc_thread_groups(conf, 0, &group_cnt, &new_group)) {
+	/* Don't enable multi-threading unless asked for by default */
+	worker_cnt = min(READ_ONCE(default_group_thread_cnt), 8192U);
+	if (!alloc_thread_groups(conf, worker_cnt, &group_cnt, &new_group)) {
 		conf->group_cnt = group_cnt;
-		conf->worker_cnt_per_group = 0;
+		conf->worker_cnt_per_group = worker_cnt;
 		conf->worker_groups = new_group;
 	} else
 		goto abort;
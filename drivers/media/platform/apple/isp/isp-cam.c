@@ -360,7 +360,18 @@ int apple_isp_detect_camera(struct apple_isp *isp)
 	return err;
 }
 
-static int isp_ch_load_setfile(struct apple_isp *isp, u32 ch)
+void apple_isp_release_camera(struct apple_isp *isp)
+{
+	release_firmware(isp->setfile);
+	isp->setfile = NULL;
+}
+
+/*
+ * Fetching the setfile from the filesystem dominates the time to the
+ * first frame, so it is requested once and kept until the driver goes away.
+ */
+static const struct firmware *isp_ch_get_setfile(struct apple_isp *isp,
+						 u32 ch)
 {
 	struct isp_format *fmt = isp_get_format(isp, ch);
 	const struct isp_setfile *setfile = &isp_setfiles[fmt->id];
@@ -368,29 +379,46 @@ static int isp_ch_load_setfile(struct apple_isp *isp, u32 ch)
 	u32 magic;
 	int err;
 
+	if (isp->setfile)
+		return isp->setfile;
+
 	err = request_firmware(&fw, setfile->path, isp->dev);
 	if (err) {
 		dev_err(isp->dev, "failed to request setfile '%s': %d\n",
 			setfile->path, err);
-		return err;
+		return ERR_PTR(err);
 	}
 
 	if (fw->size < setfile->size) {
 		dev_err(isp->dev, "setfile too small (0x%lx/0x%zx)\n", fw->size,
 			setfile->size);
 		release_firmware(fw);
-		return -EINVAL;
+		return ERR_PTR(-EINVAL);
 	}
 
 	magic = be32_to_cpup((__be32 *)fw->data);
 	if (magic != setfile->magic) {
 		dev_err(isp->dev, "setfile '%s' corrupted?\n", setfile->path);
 		release_firmware(fw);
-		return -EINVAL;
+		return ERR_PTR(-EINVAL);
 	}
 
+	isp->setfile = fw;
+
+	return fw;
+}
+
+static int isp_ch_load_setfile(struct apple_isp *isp, u32 ch)
+{
+	struct isp_format *fmt = isp_get_format(isp, ch);
+	const struct isp_setfile *setfile = &isp_setfiles[fmt->id];
+	const struct firmware *fw;
+
+	fw = isp_ch_get_setfile(isp, ch);
+	if (IS_ERR(fw))
+		return PTR_ERR(fw);
+
 	isp_iowrite(isp, isp->data_surf->iova, (void *)fw->data, setfile->size);
-	release_firmware(fw);
 
 	return isp_cmd_ch_set_file_load(isp, ch, isp->data_surf->iova,
 					setfile->size);
@@ -499,6 +527,13 @@ static int isp_ch_configure_capture(struct apple_isp *isp, u32 ch)
 	return 0;
 }
 
+/*
+ * Only a single output per channel is configured. The firmware renders into
+ * the CISP_POOL_TYPE_RENDERED pool set up by CISP_CMD_CH_OUTPUT_CONFIG_SET;
+ * how secondary (scaled) outputs are selected is not known yet. The same
+ * goes for the layout of the per-frame CISP_POOL_TYPE_META buffer, which is
+ * why it is not exposed to userspace.
+ */
 static int isp_configure_capture(struct apple_isp *isp)
 {
 	return isp_ch_configure_capture(isp, isp->current_ch);
@@ -10,6 +10,7 @@
 #define ISP_FRAME_RATE_DEN 7680
 
 int apple_isp_detect_camera(struct apple_isp *isp);
+void apple_isp_release_camera(struct apple_isp *isp);
 
 int apple_isp_start_camera(struct apple_isp *isp);
 void apple_isp_stop_camera(struct apple_isp *isp);
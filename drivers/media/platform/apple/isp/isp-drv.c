@@ -182,6 +182,7 @@ static int apple_isp_init_iommu(struct apple_isp *isp)
 	/* Allocate read-only coprocessor private heap */
 	fw->heap = isp_alloc_surface(isp, heap_size);
 	if (!fw->heap) {
+		isp_surf_pool_drain(isp);
 		drm_mm_takedown(&isp->iovad);
 		err = -ENOMEM;
 		goto out;
@@ -200,6 +201,7 @@ static int apple_isp_init_iommu(struct apple_isp *isp)
 static void apple_isp_free_iommu(struct apple_isp *isp)
 {
 	isp_free_surface(isp, isp->fw.heap);
+	isp_surf_pool_drain(isp);
 	drm_mm_takedown(&isp->iovad);
 	for (int i = isp->fw.count; i-- > 0; )
 		apple_isp_unresv_region(isp, i);
@@ -281,10 +283,12 @@ static int apple_isp_probe(struct platform_device *pdev)
 	}
 
 	mutex_init(&isp->iovad_lock);
+	mutex_init(&isp->surf_pool_lock);
 	mutex_init(&isp->video_lock);
 	spin_lock_init(&isp->buf_lock);
 	init_waitqueue_head(&isp->wait);
 	INIT_LIST_HEAD(&isp->gc);
+	INIT_LIST_HEAD(&isp->surf_pool);
 	INIT_LIST_HEAD(&isp->buffers);
 	isp->wq = alloc_workqueue("apple-isp-wq", WQ_UNBOUND, 0);
 	if (!isp->wq) {
@@ -318,6 +322,7 @@ static int apple_isp_probe(struct platform_device *pdev)
 	return 0;
 
 free_iommu:
+	apple_isp_release_camera(isp);
 	pm_runtime_disable(dev);
 	apple_isp_free_iommu(isp);
 destroy_wq:
@@ -332,6 +337,7 @@ static int apple_isp_remove(struct platform_device *pdev)
 	struct apple_isp *isp = platform_get_drvdata(pdev);
 
 	apple_isp_remove_video(isp);
+	apple_isp_release_camera(isp);
 	pm_runtime_disable(isp->dev);
 	apple_isp_free_iommu(isp);
 	destroy_workqueue(isp->wq);
@@ -4,6 +4,7 @@
 #ifndef __ISP_DRV_H__
 #define __ISP_DRV_H__
 
+#include <linux/firmware.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/types.h>
@@ -203,10 +204,16 @@ struct apple_isp {
 		struct isp_surf *heap;
 	} fw;
 
+	/* Validated calibration data, kept across firmware boots */
+	const struct firmware *setfile;
+
 	struct isp_surf *ipc_surf;
 	struct isp_surf *extra_surf;
 	struct isp_surf *data_surf;
 	struct list_head gc;
+	struct list_head surf_pool;
+	unsigned int surf_pool_count;
+	struct mutex surf_pool_lock;
 	struct workqueue_struct *wq;
 
 	int num_ipc_chans;
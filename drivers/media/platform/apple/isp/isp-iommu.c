@@ -2,9 +2,17 @@
 /* Copyright 2023 Eileen Yoon <eyn@gmx.com> */
 
 #include <linux/iommu.h>
+#include <linux/sizes.h>
 
 #include "isp-iommu.h"
 
+/* Largest chunk tried for surface backing, maps to a DART block */
+#define ISP_SURF_MAX_ORDER	min_t(unsigned int, get_order(SZ_2M), MAX_ORDER)
+
+/* Freed surfaces kept mapped for reuse, firmware reallocates them on boot */
+#define ISP_SURF_POOL_MAX	32
+#define ISP_SURF_POOL_MAX_SIZE	SZ_8M
+
 void apple_isp_iommu_sync_ttbr(struct apple_isp *isp)
 {
 	writel(readl(isp->dart0 + isp->hw->ttbr), isp->dart1 + isp->hw->ttbr);
@@ -32,15 +40,39 @@ static void isp_surf_free_pages(struct isp_surf *surf)
 
 static int isp_surf_alloc_pages(struct isp_surf *surf)
 {
-	surf->pages = kvmalloc_array(surf->num_pages, sizeof(*surf->pages),
-				     GFP_KERNEL);
+	unsigned int order = ISP_SURF_MAX_ORDER;
+	u32 i = 0;
+
+	surf->pages = kvcalloc(surf->num_pages, sizeof(*surf->pages),
+			       GFP_KERNEL);
 	if (!surf->pages)
 		return -ENOMEM;
 
-	for (u32 i = 0; i < surf->num_pages; i++) {
-		surf->pages[i] = alloc_page(GFP_KERNEL);
-		if (surf->pages[i] == NULL)
-			goto free_pages;
+	/*
+	 * Prefer physically contiguous runs: sg_alloc_table_from_pages()
+	 * merges them and the DART then maps them with block entries. Only
+	 * try hard for order-0 pages, the pages array is kept per page for
+	 * vmap() and freeing.
+	 */
+	while (i < surf->num_pages) {
+		struct page *page;
+
+		while (order && (1U << order) > surf->num_pages - i)
+			order--;
+
+		page = alloc_pages(order ? GFP_KERNEL | __GFP_NOWARN |
+					   __GFP_NORETRY | __GFP_NOMEMALLOC :
+					   GFP_KERNEL, order);
+		if (!page) {
+			if (!order)
+				goto free_pages;
+			order--;
+			continue;
+		}
+
+		split_page(page, order);
+		for (u32 j = 0; j < (1U << order); j++)
+			surf->pages[i++] = page + j;
 	}
 
 	return 0;
@@ -52,6 +84,10 @@ static int isp_surf_alloc_pages(struct isp_surf *surf)
 
 int isp_surf_vmap(struct apple_isp *isp, struct isp_surf *surf)
 {
+	/* recycled surfaces may still be mapped */
+	if (surf->virt)
+		return 0;
+
 	surf->virt = vmap(surf->pages, surf->num_pages, VM_MAP,
 			  pgprot_writecombine(PAGE_KERNEL));
 	if (surf->virt == NULL) {
@@ -151,11 +187,75 @@ static void __isp_surf_init(struct apple_isp *isp, struct isp_surf *surf,
 	surf->gc = gc;
 }
 
+static struct isp_surf *isp_surf_pool_get(struct apple_isp *isp, u64 size)
+{
+	struct isp_surf *surf;
+
+	size = ALIGN(size, 1UL << isp->shift);
+
+	mutex_lock(&isp->surf_pool_lock);
+	list_for_each_entry(surf, &isp->surf_pool, head) {
+		if (surf->size == size) {
+			list_del(&surf->head);
+			isp->surf_pool_count--;
+			mutex_unlock(&isp->surf_pool_lock);
+			return surf;
+		}
+	}
+	mutex_unlock(&isp->surf_pool_lock);
+
+	return NULL;
+}
+
+static bool isp_surf_pool_put(struct apple_isp *isp, struct isp_surf *surf)
+{
+	bool pooled = false;
+
+	mutex_lock(&isp->surf_pool_lock);
+	if (surf->size <= ISP_SURF_POOL_MAX_SIZE &&
+	    isp->surf_pool_count < ISP_SURF_POOL_MAX) {
+		list_add(&surf->head, &isp->surf_pool);
+		isp->surf_pool_count++;
+		pooled = true;
+	}
+	mutex_unlock(&isp->surf_pool_lock);
+
+	return pooled;
+}
+
+static void isp_surf_destroy(struct apple_isp *isp, struct isp_surf *surf)
+{
+	isp_surf_vunmap(isp, surf);
+	isp_surf_iommu_unmap(isp, surf);
+	isp_surf_unreserve_iova(isp, surf);
+	isp_surf_free_pages(surf);
+	kfree(surf);
+}
+
+void isp_surf_pool_drain(struct apple_isp *isp)
+{
+	struct isp_surf *surf, *tmp;
+
+	mutex_lock(&isp->surf_pool_lock);
+	list_for_each_entry_safe(surf, tmp, &isp->surf_pool, head) {
+		list_del(&surf->head);
+		isp_surf_destroy(isp, surf);
+	}
+	isp->surf_pool_count = 0;
+	mutex_unlock(&isp->surf_pool_lock);
+}
+
 struct isp_surf *__isp_alloc_surface(struct apple_isp *isp, u64 size, bool gc)
 {
 	int err;
+	struct isp_surf *surf = isp_surf_pool_get(isp, size);
+
+	if (surf) {
+		surf->gc = gc;
+		goto done;
+	}
 
-	struct isp_surf *surf = kzalloc(sizeof(struct isp_surf), GFP_KERNEL);
+	surf = kzalloc(sizeof(struct isp_surf), GFP_KERNEL);
 	if (!surf)
 		return NULL;
 
@@ -183,6 +283,7 @@ struct isp_surf *__isp_alloc_surface(struct apple_isp *isp, u64 size, bool gc)
 		goto unreserve_iova;
 	}
 
+done:
 	refcount_set(&surf->refcount, 1);
 	if (surf->gc)
 		list_add_tail(&surf->head, &isp->gc);
@@ -220,13 +321,10 @@ struct isp_surf *isp_alloc_surface_vmap(struct apple_isp *isp, u64 size)
 void isp_free_surface(struct apple_isp *isp, struct isp_surf *surf)
 {
 	if (refcount_dec_and_test(&surf->refcount)) {
-		isp_surf_vunmap(isp, surf);
-		isp_surf_iommu_unmap(isp, surf);
-		isp_surf_unreserve_iova(isp, surf);
-		isp_surf_free_pages(surf);
 		if (surf->gc)
 			list_del(&surf->head);
-		kfree(surf);
+		if (!isp_surf_pool_put(isp, surf))
+			isp_surf_destroy(isp, surf);
 	}
 }
 
@@ -15,6 +15,7 @@ struct isp_surf *__isp_alloc_surface(struct apple_isp *isp, u64 size, bool gc);
 struct isp_surf *isp_alloc_surface_vmap(struct apple_isp *isp, u64 size);
 int isp_surf_vmap(struct apple_isp *isp, struct isp_surf *surf);
 void isp_free_surface(struct apple_isp *isp, struct isp_surf *surf);
+void isp_surf_pool_drain(struct apple_isp *isp);
 void *isp_iotranslate(struct apple_isp *isp, dma_addr_t iova);
 
 static inline void isp_ioread(struct apple_isp *isp, dma_addr_t iova,
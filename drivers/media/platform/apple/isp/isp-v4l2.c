@@ -144,8 +144,19 @@ static int isp_vb2_buf_init(struct vb2_buffer *vb)
 	if (!buf->meta)
 		return -ENOMEM;
 
+	/*
+	 * For imported DMABUFs this runs whenever a new buffer gets attached,
+	 * after vb2 mapped it. The pages are mapped into the ISP DART directly,
+	 * frames never pass through the CPU.
+	 */
 	for (i = 0; i < vb->num_planes; i++) {
 		struct sg_table *sgt = vb2_dma_sg_plane_desc(vb, i);
+
+		if (!sgt) {
+			err = -EINVAL;
+			goto cleanup;
+		}
+
 		err = apple_isp_iommu_map_sgt(isp, &buf->surfs[i], sgt,
 					      vb2_plane_size(vb, i));
 		if (err)
@@ -549,7 +560,7 @@ int apple_isp_setup_video(struct apple_isp *isp)
 
 	vbq->drv_priv = isp;
 	vbq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	vbq->io_modes = VB2_MMAP;
+	vbq->io_modes = VB2_MMAP | VB2_DMABUF;
 	vbq->dev = isp->dev;
 	vbq->ops = &isp_vb2_ops;
 	vbq->mem_ops = &vb2_dma_sg_memops;
@@ -300,7 +300,7 @@ static netdev_tx_t brcmf_netdev_start_xmit(struct sk_buff *skb,
 	/* Can the device send data? */
 	if (drvr->bus_if->state != BRCMF_BUS_UP) {
 		bphy_err(drvr, "xmit rejected state=%d\n", drvr->bus_if->state);
-		netif_stop_queue(ndev);
+		netif_tx_stop_all_queues(ndev);
 		dev_kfree_skb(skb);
 		ret = -ENODEV;
 		goto done;
@@ -390,17 +390,18 @@ void brcmf_txflowblock_if(struct brcmf_if *ifp,
 	spin_lock_irqsave(&ifp->netif_stop_lock, flags);
 	if (state) {
 		if (!ifp->netif_stop)
-			netif_stop_queue(ifp->ndev);
+			netif_tx_stop_all_queues(ifp->ndev);
 		ifp->netif_stop |= reason;
 	} else {
 		ifp->netif_stop &= ~reason;
 		if (!ifp->netif_stop)
-			netif_wake_queue(ifp->ndev);
+			netif_tx_wake_all_queues(ifp->ndev);
 	}
 	spin_unlock_irqrestore(&ifp->netif_stop_lock, flags);
 }
 
-void brcmf_netif_rx(struct brcmf_if *ifp, struct sk_buff *skb)
+void brcmf_netif_napi_rx(struct brcmf_if *ifp, struct sk_buff *skb,
+			 struct napi_struct *napi)
 {
 	/* Most of Broadcom's firmwares send 802.11f ADD frame every time a new
 	 * STA connects to the AP interface. This is an obsoleted standard most
@@ -423,7 +424,15 @@ void brcmf_netif_rx(struct brcmf_if *ifp, struct sk_buff *skb)
 	ifp->ndev->stats.rx_packets++;
 
 	brcmf_dbg(DATA, "rx proto=0x%X\n", ntohs(skb->protocol));
-	netif_rx(skb);
+	if (napi)
+		napi_gro_receive(napi, skb);
+	else
+		netif_rx(skb);
+}
+
+void brcmf_netif_rx(struct brcmf_if *ifp, struct sk_buff *skb)
+{
+	brcmf_netif_napi_rx(ifp, skb, NULL);
 }
 
 void brcmf_netif_mon_rx(struct brcmf_if *ifp, struct sk_buff *skb)
@@ -535,7 +544,8 @@ void brcmf_rx_event(struct device *dev, struct sk_buff *skb)
 	brcmu_pkt_buf_free_skb(skb);
 }
 
-void brcmf_txfinalize(struct brcmf_if *ifp, struct sk_buff *txp, bool success)
+void brcmf_txfinalize_napi(struct brcmf_if *ifp, struct sk_buff *txp,
+			   bool success, int budget)
 {
 	struct ethhdr *eh;
 	u16 type;
@@ -549,10 +559,19 @@ void brcmf_txfinalize(struct brcmf_if *ifp, struct sk_buff *txp, bool success)
 			wake_up(&ifp->pend_8021x_wait);
 	}
 
-	if (!success)
+	if (!success) {
 		ifp->ndev->stats.tx_errors++;
+		brcmu_pkt_buf_free_skb(txp);
+		return;
+	}
 
-	brcmu_pkt_buf_free_skb(txp);
+	/* from NAPI, completed skbs go to the bulk free cache */
+	napi_consume_skb(txp, budget);
+}
+
+void brcmf_txfinalize(struct brcmf_if *ifp, struct sk_buff *txp, bool success)
+{
+	brcmf_txfinalize_napi(ifp, txp, success, 0);
 }
 
 static void brcmf_ethtool_get_drvinfo(struct net_device *ndev,
@@ -584,6 +603,7 @@ static int brcmf_netdev_stop(struct net_device *ndev)
 	brcmf_cfg80211_down(ndev);
 
 	brcmf_net_setcarrier(ifp, false);
+	brcmf_proto_reset_txq(ifp->drvr, ifp);
 
 	return 0;
 }
@@ -622,10 +642,30 @@ static int brcmf_netdev_open(struct net_device *ndev)
 	return 0;
 }
 
+/* 802.1d priority to TX queue, one queue per access category (VO first) */
+static const u16 brcmf_prio2queue[] = {
+	2, 3, 3, 2, 1, 1, 0, 0
+};
+
+static u16 brcmf_netdev_select_queue(struct net_device *ndev,
+				     struct sk_buff *skb,
+				     struct net_device *sb_dev)
+{
+	if ((skb->priority == 0) || (skb->priority > 7))
+		skb->priority = cfg80211_classify8021d(skb, NULL);
+
+	/*
+	 * Flowrings are keyed by priority, so every flowring feeds exactly
+	 * one queue and concurrent senders on different ACs do not contend.
+	 */
+	return brcmf_prio2queue[skb->priority];
+}
+
 static const struct net_device_ops brcmf_netdev_ops_pri = {
 	.ndo_open = brcmf_netdev_open,
 	.ndo_stop = brcmf_netdev_stop,
 	.ndo_start_xmit = brcmf_netdev_start_xmit,
+	.ndo_select_queue = brcmf_netdev_select_queue,
 	.ndo_set_mac_address = brcmf_netdev_set_mac_address,
 	.ndo_set_rx_mode = brcmf_netdev_set_multicast_list
 };
@@ -856,7 +896,7 @@ struct brcmf_if *brcmf_add_if(struct brcmf_pub *drvr, s32 bsscfgidx, s32 ifidx,
 		if (ifidx) {
 			bphy_err(drvr, "ERROR: netdev:%s already exists\n",
 				 ifp->ndev->name);
-			netif_stop_queue(ifp->ndev);
+			netif_tx_stop_all_queues(ifp->ndev);
 			brcmf_net_detach(ifp->ndev, false);
 			drvr->iflist[bsscfgidx] = NULL;
 		} else {
@@ -875,8 +915,9 @@ struct brcmf_if *brcmf_add_if(struct brcmf_pub *drvr, s32 bsscfgidx, s32 ifidx,
 	} else {
 		brcmf_dbg(INFO, "allocate netdev interface\n");
 		/* Allocate netdev, including space for private structure */
-		ndev = alloc_netdev(sizeof(*ifp), is_p2pdev ? "p2p%d" : name,
-				    NET_NAME_UNKNOWN, ether_setup);
+		ndev = alloc_netdev_mqs(sizeof(*ifp), is_p2pdev ? "p2p%d" : name,
+					NET_NAME_UNKNOWN, ether_setup,
+					BRCMF_NUM_TX_QUEUES, 1);
 		if (!ndev)
 			return ERR_PTR(-ENOMEM);
 
@@ -928,7 +969,7 @@ static void brcmf_del_if(struct brcmf_pub *drvr, s32 bsscfgidx,
 				rtnl_unlock();
 			}
 		} else {
-			netif_stop_queue(ifp->ndev);
+			netif_tx_stop_all_queues(ifp->ndev);
 		}
 
 		if (ifp->ndev->netdev_ops == &brcmf_netdev_ops_pri) {
@@ -1521,8 +1562,7 @@ void brcmf_bus_change_state(struct brcmf_bus *bus, enum brcmf_bus_state state)
 			if ((drvr->iflist[ifidx]) &&
 			    (drvr->iflist[ifidx]->ndev)) {
 				ndev = drvr->iflist[ifidx]->ndev;
-				if (netif_queue_stopped(ndev))
-					netif_wake_queue(ndev);
+				netif_tx_wake_all_queues(ndev);
 			}
 		}
 	}
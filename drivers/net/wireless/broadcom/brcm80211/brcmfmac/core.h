@@ -25,6 +25,9 @@
 /* For supporting multiple interfaces */
 #define BRCMF_MAX_IFS	16
 
+/* netdev TX queues, one per access category */
+#define BRCMF_NUM_TX_QUEUES	4
+
 /* Small, medium and maximum buffer size for dcmd
  */
 #define BRCMF_DCMD_SMLEN	256
@@ -217,7 +220,11 @@ void brcmf_remove_interface(struct brcmf_if *ifp, bool locked);
 void brcmf_txflowblock_if(struct brcmf_if *ifp,
 			  enum brcmf_netif_stop_reason reason, bool state);
 void brcmf_txfinalize(struct brcmf_if *ifp, struct sk_buff *txp, bool success);
+void brcmf_txfinalize_napi(struct brcmf_if *ifp, struct sk_buff *txp,
+			   bool success, int budget);
 void brcmf_netif_rx(struct brcmf_if *ifp, struct sk_buff *skb);
+void brcmf_netif_napi_rx(struct brcmf_if *ifp, struct sk_buff *skb,
+			 struct napi_struct *napi);
 void brcmf_netif_mon_rx(struct brcmf_if *ifp, struct sk_buff *skb);
 void brcmf_net_detach(struct net_device *ndev, bool locked);
 int brcmf_net_mon_attach(struct brcmf_if *ifp);
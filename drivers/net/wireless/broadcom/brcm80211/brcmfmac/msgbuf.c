@@ -11,6 +11,7 @@
 #include <linux/types.h>
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
+#include <net/page_pool.h>
 
 #include <brcmu_utils.h>
 #include <brcmu_wifi.h>
@@ -80,6 +81,11 @@
 #define BRCMF_IOCTL_REQ_PKTID			0xFFFE
 
 #define BRCMF_MSGBUF_MAX_PKT_SIZE		2048
+/* page pool fragment backing one posted RX data buffer */
+#define BRCMF_MSGBUF_RX_HEADROOM		NET_SKB_PAD
+#define BRCMF_MSGBUF_RX_TRUESIZE					\
+	(SKB_DATA_ALIGN(BRCMF_MSGBUF_RX_HEADROOM + BRCMF_MSGBUF_MAX_PKT_SIZE) + \
+	 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
 #define BRCMF_MSGBUF_MAX_CTL_PKT_SIZE           8192
 #define BRCMF_MSGBUF_RXBUFPOST_THRESHOLD	32
 #define BRCMF_MSGBUF_MAX_IOCTLRESPBUF_POST	8
@@ -309,6 +315,26 @@ struct brcmf_msgbuf {
 	unsigned long *flow_map;
 	unsigned long *txstatus_done_map;
 
+	/* NAPI context of the poll in progress, for GRO */
+	struct napi_struct *napi;
+	int napi_budget;
+
+	/* BQL completions gathered over one pass of the TX complete ring */
+	struct {
+		u32 pkts;
+		u32 bytes;
+	} tx_done[BRCMF_MAX_IFS][BRCMF_NUM_TX_QUEUES];
+	/*
+	 * Bumped by brcmf_msgbuf_bql_reset(); packets posted under an older
+	 * generation are not reported to BQL when they complete.
+	 */
+	u8 bql_gen[BRCMF_MAX_IFS][BRCMF_NUM_TX_QUEUES];
+	/* serializes BQL sent and completed counts and resets */
+	spinlock_t bql_lock;
+
+	/* pre-mapped, recycled RX data buffers */
+	struct page_pool *rx_pool;
+
 	struct work_struct flowring_work;
 	spinlock_t flowring_work_lock;
 	struct list_head work_queue;
@@ -317,7 +343,11 @@ struct brcmf_msgbuf {
 struct brcmf_msgbuf_pktid {
 	atomic_t  allocated;
 	u16 data_offset;
+	u8 bql_gen;
 	struct sk_buff *skb;
+	/* page pool fragment instead of skb, for RX data buffers */
+	struct page *page;
+	u32 page_offset;
 	dma_addr_t physaddr;
 };
 
@@ -326,6 +356,7 @@ struct brcmf_msgbuf_pktids {
 	u32 last_allocated_idx;
 	enum dma_data_direction direction;
 	struct brcmf_msgbuf_pktid *array;
+	struct page_pool *pool;
 };
 
 static void brcmf_msgbuf_rxbuf_ioctlresp_post(struct brcmf_msgbuf *msgbuf);
@@ -354,6 +385,34 @@ brcmf_msgbuf_init_pktids(u32 nr_array_entries,
 }
 
 
+static int
+brcmf_msgbuf_find_pktid(struct brcmf_msgbuf_pktids *pktids, u32 *idx)
+{
+	struct brcmf_msgbuf_pktid *array = pktids->array;
+	u32 count;
+
+	*idx = pktids->last_allocated_idx;
+
+	count = 0;
+	do {
+		(*idx)++;
+		if (*idx == pktids->array_size)
+			*idx = 0;
+		if (array[*idx].allocated.counter == 0)
+			if (atomic_cmpxchg(&array[*idx].allocated, 0, 1) == 0)
+				break;
+		count++;
+	} while (count < pktids->array_size);
+
+	if (count == pktids->array_size)
+		return -ENOMEM;
+
+	pktids->last_allocated_idx = *idx;
+
+	return 0;
+}
+
+
 static int
 brcmf_msgbuf_alloc_pktid(struct device *dev,
 			 struct brcmf_msgbuf_pktids *pktids,
@@ -361,7 +420,6 @@ brcmf_msgbuf_alloc_pktid(struct device *dev,
 			 dma_addr_t *physaddr, u32 *idx)
 {
 	struct brcmf_msgbuf_pktid *array;
-	u32 count;
 
 	array = pktids->array;
 
@@ -373,20 +431,7 @@ brcmf_msgbuf_alloc_pktid(struct device *dev,
 		return -ENOMEM;
 	}
 
-	*idx = pktids->last_allocated_idx;
-
-	count = 0;
-	do {
-		(*idx)++;
-		if (*idx == pktids->array_size)
-			*idx = 0;
-		if (array[*idx].allocated.counter == 0)
-			if (atomic_cmpxchg(&array[*idx].allocated, 0, 1) == 0)
-				break;
-		count++;
-	} while (count < pktids->array_size);
-
-	if (count == pktids->array_size) {
+	if (brcmf_msgbuf_find_pktid(pktids, idx)) {
 		dma_unmap_single(dev, *physaddr, skb->len - data_offset,
 				 pktids->direction);
 		return -ENOMEM;
@@ -395,13 +440,61 @@ brcmf_msgbuf_alloc_pktid(struct device *dev,
 	array[*idx].data_offset = data_offset;
 	array[*idx].physaddr = *physaddr;
 	array[*idx].skb = skb;
+	array[*idx].page = NULL;
 
-	pktids->last_allocated_idx = *idx;
+	return 0;
+}
+
+
+/*
+ * Page pool buffers stay mapped for as long as the pool owns them, so unlike
+ * brcmf_msgbuf_alloc_pktid() there is nothing to map here.
+ */
+static int
+brcmf_msgbuf_alloc_page_pktid(struct brcmf_msgbuf_pktids *pktids,
+			      struct page *page, u32 page_offset,
+			      dma_addr_t physaddr, u32 *idx)
+{
+	struct brcmf_msgbuf_pktid *array = pktids->array;
+
+	if (brcmf_msgbuf_find_pktid(pktids, idx))
+		return -ENOMEM;
+
+	array[*idx].data_offset = 0;
+	array[*idx].physaddr = physaddr;
+	array[*idx].skb = NULL;
+	array[*idx].page = page;
+	array[*idx].page_offset = page_offset;
 
 	return 0;
 }
 
 
+static struct page *
+brcmf_msgbuf_get_page_pktid(struct brcmf_msgbuf_pktids *pktids, u32 idx,
+			    u32 *page_offset, dma_addr_t *physaddr)
+{
+	struct brcmf_msgbuf_pktid *pktid;
+
+	if (idx >= pktids->array_size) {
+		brcmf_err("Invalid packet id %d (max %d)\n", idx,
+			  pktids->array_size);
+		return NULL;
+	}
+
+	pktid = &pktids->array[idx];
+	if (!pktid->allocated.counter || !pktid->page) {
+		brcmf_err("Invalid packet id %d (not a data buffer)\n", idx);
+		return NULL;
+	}
+
+	*page_offset = pktid->page_offset;
+	*physaddr = pktid->physaddr;
+	pktid->allocated.counter = 0;
+	return pktid->page;
+}
+
+
 static struct sk_buff *
 brcmf_msgbuf_get_pktid(struct device *dev, struct brcmf_msgbuf_pktids *pktids,
 		       u32 idx)
@@ -414,7 +507,9 @@ brcmf_msgbuf_get_pktid(struct device *dev, struct brcmf_msgbuf_pktids *pktids,
 			  pktids->array_size);
 		return NULL;
 	}
-	if (pktids->array[idx].allocated.counter) {
+	if (pktids->array[idx].allocated.counter && pktids->array[idx].page) {
+		brcmf_err("Invalid packet id %d (data buffer)\n", idx);
+	} else if (pktids->array[idx].allocated.counter) {
 		pktid = &pktids->array[idx];
 		dma_unmap_single(dev, pktid->physaddr,
 				 pktid->skb->len - pktid->data_offset,
@@ -441,7 +536,10 @@ brcmf_msgbuf_release_array(struct device *dev,
 	array = pktids->array;
 	count = 0;
 	do {
-		if (array[count].allocated.counter) {
+		if (array[count].allocated.counter && array[count].page) {
+			page_pool_put_full_page(pktids->pool, array[count].page,
+						false);
+		} else if (array[count].allocated.counter) {
 			pktid = &array[count];
 			dma_unmap_single(dev, pktid->physaddr,
 					 pktid->skb->len - pktid->data_offset,
@@ -591,6 +689,9 @@ brcmf_msgbuf_remove_flowring(struct brcmf_msgbuf *msgbuf, u16 flowid)
 
 	brcmf_dbg(MSGBUF, "Removing flowring %d\n", flowid);
 
+	brcmf_msgbuf_bql_reset(msgbuf,
+			       brcmf_flowring_ifidx_get(msgbuf->flow, flowid));
+
 	dma_sz = BRCMF_H2D_TXFLOWRING_MAX_ITEM * BRCMF_H2D_TXFLOWRING_ITEMSIZE;
 	dma_buf = msgbuf->flowrings[flowid]->buf_addr;
 	dma_free_coherent(msgbuf->drvr->bus_if->dev, dma_sz, dma_buf,
@@ -745,12 +846,18 @@ static void brcmf_msgbuf_txflow(struct brcmf_msgbuf *msgbuf, u16 flowid)
 	dma_addr_t physaddr;
 	u32 pktid;
 	struct msgbuf_tx_msghdr *tx_msghdr;
+	struct net_device *ndev = NULL;
+	struct brcmf_if *ifp;
 	u64 address;
 
 	commonring = msgbuf->flowrings[flowid];
 	if (!brcmf_commonring_write_available(commonring))
 		return;
 
+	ifp = brcmf_get_ifp(drvr, brcmf_flowring_ifidx_get(flow, flowid));
+	if (ifp)
+		ndev = ifp->ndev;
+
 	brcmf_commonring_lock(commonring);
 
 	count = BRCMF_MSGBUF_TX_FLUSH_CNT2 - BRCMF_MSGBUF_TX_FLUSH_CNT1;
@@ -797,6 +904,13 @@ static void brcmf_msgbuf_txflow(struct brcmf_msgbuf *msgbuf, u16 flowid)
 		tx_msghdr->metadata_buf_addr.high_addr = 0;
 		tx_msghdr->metadata_buf_addr.low_addr = 0;
 		atomic_inc(&commonring->outstanding_tx);
+		if (ndev && skb_get_queue_mapping(skb) < BRCMF_NUM_TX_QUEUES) {
+			spin_lock_bh(&msgbuf->bql_lock);
+			msgbuf->tx_pktids->array[pktid].bql_gen =
+				msgbuf->bql_gen[ifp->ifidx][skb_get_queue_mapping(skb)];
+			netdev_tx_sent_queue(skb_get_tx_queue(ndev, skb), skb->len);
+			spin_unlock_bh(&msgbuf->bql_lock);
+		}
 		if (count >= BRCMF_MSGBUF_TX_FLUSH_CNT2) {
 			brcmf_commonring_write_complete(commonring);
 			count = 0;
@@ -842,6 +956,7 @@ static int brcmf_msgbuf_tx_queue_data(struct brcmf_pub *drvr, int ifidx,
 	struct brcmf_msgbuf *msgbuf = (struct brcmf_msgbuf *)drvr->proto->pd;
 	struct brcmf_flowring *flow = msgbuf->flow;
 	struct ethhdr *eh = (struct ethhdr *)(skb->data);
+	struct netdev_queue *txq = skb_get_tx_queue(skb->dev, skb);
 	u32 flowid;
 	u32 queue_count;
 	bool force;
@@ -858,6 +973,29 @@ static int brcmf_msgbuf_tx_queue_data(struct brcmf_pub *drvr, int ifidx,
 	}
 	queue_count = brcmf_flowring_enqueue(flow, flowid, skb);
 	force = ((queue_count % BRCMF_MSGBUF_TRICKLE_TXWORKER_THRS) == 0);
+
+	/*
+	 * More packets are on their way from the stack; leave the flowring
+	 * marked and let the last one of the burst kick the worker, so that
+	 * the whole burst goes out behind a single doorbell.
+	 */
+	if (!force && netdev_xmit_more() && !netif_xmit_stopped(txq)) {
+		set_bit(flowid, msgbuf->flow_map);
+		return 0;
+	}
+
+	/*
+	 * Post straight from the sending CPU rather than bouncing through the
+	 * single TX worker. While lots of packets are outstanding the worker
+	 * is left to pick the ring up from the TX completion path instead,
+	 * which gives the firmware bigger batches.
+	 */
+	if (force || atomic_read(&msgbuf->flowrings[flowid]->outstanding_tx) <
+		     BRCMF_MSGBUF_DELAY_TXWORKER_THRS) {
+		brcmf_msgbuf_txflow(msgbuf, flowid);
+		return 0;
+	}
+
 	brcmf_msgbuf_schedule_txdata(msgbuf, flowid, force);
 
 	return 0;
@@ -919,12 +1057,15 @@ brcmf_msgbuf_process_txstatus(struct brcmf_msgbuf *msgbuf, void *buf)
 	struct msgbuf_tx_status *tx_status;
 	u32 idx;
 	struct sk_buff *skb;
-	u16 flowid;
+	u16 flowid, q;
+	u8 ifidx, gen = 0;
 
 	tx_status = (struct msgbuf_tx_status *)buf;
 	idx = le32_to_cpu(tx_status->msg.request_id) - 1;
 	flowid = le16_to_cpu(tx_status->compl_hdr.flow_ring_id);
 	flowid -= BRCMF_H2D_MSGRING_FLOWRING_IDSTART;
+	if (idx < msgbuf->tx_pktids->array_size)
+		gen = msgbuf->tx_pktids->array[idx].bql_gen;
 	skb = brcmf_msgbuf_get_pktid(msgbuf->drvr->bus_if->dev,
 				     msgbuf->tx_pktids, idx);
 	if (!skb)
@@ -934,8 +1075,79 @@ brcmf_msgbuf_process_txstatus(struct brcmf_msgbuf *msgbuf, void *buf)
 	commonring = msgbuf->flowrings[flowid];
 	atomic_dec(&commonring->outstanding_tx);
 
-	brcmf_txfinalize(brcmf_get_ifp(msgbuf->drvr, tx_status->msg.ifidx),
-			 skb, true);
+	/* called with bql_lock held, see brcmf_proto_msgbuf_napi_poll() */
+	ifidx = tx_status->msg.ifidx;
+	q = skb_get_queue_mapping(skb);
+	if (ifidx < BRCMF_MAX_IFS && q < BRCMF_NUM_TX_QUEUES &&
+	    gen == msgbuf->bql_gen[ifidx][q]) {
+		msgbuf->tx_done[ifidx][q].pkts++;
+		msgbuf->tx_done[ifidx][q].bytes += skb->len;
+	}
+
+	brcmf_txfinalize_napi(brcmf_get_ifp(msgbuf->drvr, tx_status->msg.ifidx),
+			      skb, true, msgbuf->napi_budget);
+}
+
+
+/*
+ * Forget the BQL state of the TX queues of @ifidx when packets posted to them
+ * may never be reported complete: a flowring was deleted, the interface went
+ * down or the bus is being torn down. Packets still in flight keep the old
+ * generation and are left out when they do complete, so that DQL never sees
+ * more completed than queued.
+ */
+static void brcmf_msgbuf_bql_reset(struct brcmf_msgbuf *msgbuf, int ifidx)
+{
+	struct brcmf_if *ifp;
+	int q;
+
+	if (ifidx < 0 || ifidx >= BRCMF_MAX_IFS)
+		return;
+
+	ifp = brcmf_get_ifp(msgbuf->drvr, ifidx);
+
+	spin_lock_bh(&msgbuf->bql_lock);
+	for (q = 0; q < BRCMF_NUM_TX_QUEUES; q++) {
+		msgbuf->bql_gen[ifidx][q]++;
+		msgbuf->tx_done[ifidx][q].pkts = 0;
+		msgbuf->tx_done[ifidx][q].bytes = 0;
+
+		if (ifp && ifp->ndev && q < ifp->ndev->real_num_tx_queues)
+			netdev_tx_reset_queue(netdev_get_tx_queue(ifp->ndev, q));
+	}
+	spin_unlock_bh(&msgbuf->bql_lock);
+}
+
+
+static void brcmf_msgbuf_reset_txq(struct brcmf_if *ifp)
+{
+	struct brcmf_msgbuf *msgbuf = (struct brcmf_msgbuf *)ifp->drvr->proto->pd;
+
+	brcmf_msgbuf_bql_reset(msgbuf, ifp->ifidx);
+}
+
+
+static void brcmf_msgbuf_tx_done_flush(struct brcmf_msgbuf *msgbuf)
+{
+	struct brcmf_if *ifp;
+	int ifidx, q;
+
+	for (ifidx = 0; ifidx < BRCMF_MAX_IFS; ifidx++) {
+		for (q = 0; q < BRCMF_NUM_TX_QUEUES; q++) {
+			if (!msgbuf->tx_done[ifidx][q].pkts)
+				continue;
+
+			ifp = brcmf_get_ifp(msgbuf->drvr, ifidx);
+			if (ifp && ifp->ndev &&
+			    q < ifp->ndev->real_num_tx_queues)
+				netdev_tx_completed_queue(netdev_get_tx_queue(ifp->ndev, q),
+							  msgbuf->tx_done[ifidx][q].pkts,
+							  msgbuf->tx_done[ifidx][q].bytes);
+
+			msgbuf->tx_done[ifidx][q].pkts = 0;
+			msgbuf->tx_done[ifidx][q].bytes = 0;
+		}
+	}
 }
 
 
@@ -944,7 +1156,8 @@ static u32 brcmf_msgbuf_rxbuf_data_post(struct brcmf_msgbuf *msgbuf, u32 count)
 	struct brcmf_pub *drvr = msgbuf->drvr;
 	struct brcmf_commonring *commonring;
 	void *ret_ptr;
-	struct sk_buff *skb;
+	struct page *page;
+	unsigned int offset;
 	u16 alloced;
 	u32 pktlen;
 	dma_addr_t physaddr;
@@ -966,19 +1179,20 @@ static u32 brcmf_msgbuf_rxbuf_data_post(struct brcmf_msgbuf *msgbuf, u32 count)
 		rx_bufpost = (struct msgbuf_rx_bufpost *)ret_ptr;
 		memset(rx_bufpost, 0, sizeof(*rx_bufpost));
 
-		skb = brcmu_pkt_buf_get_skb(BRCMF_MSGBUF_MAX_PKT_SIZE);
-
-		if (skb == NULL) {
-			bphy_err(drvr, "Failed to alloc SKB\n");
+		page = page_pool_dev_alloc_frag(msgbuf->rx_pool, &offset,
+						BRCMF_MSGBUF_RX_TRUESIZE);
+		if (!page) {
+			bphy_err(drvr, "Failed to alloc RX buffer\n");
 			brcmf_commonring_write_cancel(commonring, alloced - i);
 			break;
 		}
 
-		pktlen = skb->len;
-		if (brcmf_msgbuf_alloc_pktid(msgbuf->drvr->bus_if->dev,
-					     msgbuf->rx_pktids, skb, 0,
-					     &physaddr, &pktid)) {
-			dev_kfree_skb_any(skb);
+		pktlen = BRCMF_MSGBUF_MAX_PKT_SIZE;
+		physaddr = page_pool_get_dma_addr(page) + offset +
+			   BRCMF_MSGBUF_RX_HEADROOM;
+		if (brcmf_msgbuf_alloc_page_pktid(msgbuf->rx_pktids, page,
+						  offset, physaddr, &pktid)) {
+			page_pool_put_full_page(msgbuf->rx_pool, page, false);
 			bphy_err(drvr, "No PKTID available !!\n");
 			brcmf_commonring_write_cancel(commonring, alloced - i);
 			break;
@@ -993,8 +1207,7 @@ static u32 brcmf_msgbuf_rxbuf_data_post(struct brcmf_msgbuf *msgbuf, u32 count)
 			rx_bufpost->metadata_buf_addr.low_addr =
 				cpu_to_le32(address & 0xffffffff);
 
-			skb_pull(skb, msgbuf->rx_metadata_offset);
-			pktlen = skb->len;
+			pktlen -= msgbuf->rx_metadata_offset;
 			physaddr += msgbuf->rx_metadata_offset;
 		}
 		rx_bufpost->msg.msgtype = MSGBUF_TYPE_RXBUF_POST;
@@ -1188,6 +1401,10 @@ brcmf_msgbuf_process_rx_complete(struct brcmf_msgbuf *msgbuf, void *buf)
 	struct brcmf_pub *drvr = msgbuf->drvr;
 	struct msgbuf_rx_complete *rx_complete;
 	struct sk_buff *skb;
+	struct page *page;
+	dma_addr_t physaddr;
+	u32 page_offset;
+	void *va;
 	u16 data_offset;
 	u16 buflen;
 	u16 flags;
@@ -1202,10 +1419,30 @@ brcmf_msgbuf_process_rx_complete(struct brcmf_msgbuf *msgbuf, void *buf)
 	idx = le32_to_cpu(rx_complete->msg.request_id);
 	flags = le16_to_cpu(rx_complete->flags);
 
-	skb = brcmf_msgbuf_get_pktid(msgbuf->drvr->bus_if->dev,
-				     msgbuf->rx_pktids, idx);
-	if (!skb)
+	page = brcmf_msgbuf_get_page_pktid(msgbuf->rx_pktids, idx,
+					   &page_offset, &physaddr);
+	if (!page)
+		return;
+
+	/* physaddr is the start of the posted area: metadata, then data */
+	dma_sync_single_for_cpu(msgbuf->drvr->bus_if->dev, physaddr,
+				BRCMF_MSGBUF_MAX_PKT_SIZE,
+				page_pool_get_dma_dir(msgbuf->rx_pool));
+
+	va = page_address(page) + page_offset;
+	if (msgbuf->napi)
+		skb = napi_build_skb(va, BRCMF_MSGBUF_RX_TRUESIZE);
+	else
+		skb = build_skb(va, BRCMF_MSGBUF_RX_TRUESIZE);
+	if (!skb) {
+		page_pool_put_full_page(msgbuf->rx_pool, page, false);
 		return;
+	}
+
+	/* hand the buffer back to the pool once the stack is done with it */
+	skb_mark_for_recycle(skb);
+	skb_reserve(skb, BRCMF_MSGBUF_RX_HEADROOM + msgbuf->rx_metadata_offset);
+	skb_put(skb, BRCMF_MSGBUF_MAX_PKT_SIZE - msgbuf->rx_metadata_offset);
 
 	if (data_offset)
 		skb_pull(skb, data_offset);
@@ -1237,7 +1474,7 @@ brcmf_msgbuf_process_rx_complete(struct brcmf_msgbuf *msgbuf, void *buf)
 	}
 
 	skb->protocol = eth_type_trans(skb, ifp->ndev);
-	brcmf_netif_rx(ifp, skb);
+	brcmf_netif_napi_rx(ifp, skb, msgbuf->napi);
 }
 
 static void brcmf_msgbuf_process_gen_status(struct brcmf_msgbuf *msgbuf,
@@ -1387,17 +1624,22 @@ static void brcmf_msgbuf_process_msgtype(struct brcmf_msgbuf *msgbuf, void *buf)
 }
 
 
-static void brcmf_msgbuf_process_rx(struct brcmf_msgbuf *msgbuf,
-				    struct brcmf_commonring *commonring)
+static int brcmf_msgbuf_process_rx(struct brcmf_msgbuf *msgbuf,
+				   struct brcmf_commonring *commonring,
+				   int budget)
 {
 	void *buf;
 	u16 count;
 	u16 processed;
+	int done = 0;
 
 again:
 	buf = brcmf_commonring_get_read_ptr(commonring, &count);
 	if (buf == NULL)
-		return;
+		return done;
+
+	if (count > budget - done)
+		count = budget - done;
 
 	processed = 0;
 	while (count) {
@@ -1405,6 +1647,7 @@ static void brcmf_msgbuf_process_rx(struct brcmf_msgbuf *msgbuf,
 					     buf + msgbuf->rx_dataoffset);
 		buf += brcmf_commonring_len_item(commonring);
 		processed++;
+		done++;
 		if (processed == BRCMF_MSGBUF_UPDATE_RX_PTR_THRS) {
 			brcmf_commonring_read_complete(commonring, processed);
 			processed = 0;
@@ -1414,12 +1657,34 @@ static void brcmf_msgbuf_process_rx(struct brcmf_msgbuf *msgbuf,
 	if (processed)
 		brcmf_commonring_read_complete(commonring, processed);
 
-	if (commonring->r_ptr == 0)
+	if (done < budget && commonring->r_ptr == 0)
 		goto again;
+
+	return done;
 }
 
 
+/*
+ * Control completions may free ring memory and sleep, so they stay in the
+ * bus IRQ thread; data completions are handled from NAPI, see
+ * brcmf_proto_msgbuf_napi_poll().
+ */
 int brcmf_proto_msgbuf_rx_trigger(struct device *dev)
+{
+	struct brcmf_bus *bus_if = dev_get_drvdata(dev);
+	struct brcmf_pub *drvr = bus_if->drvr;
+	struct brcmf_msgbuf *msgbuf = (struct brcmf_msgbuf *)drvr->proto->pd;
+	void *buf;
+
+	buf = msgbuf->commonrings[BRCMF_D2H_MSGRING_CONTROL_COMPLETE];
+	brcmf_msgbuf_process_rx(msgbuf, buf, INT_MAX);
+
+	return 0;
+}
+
+
+int brcmf_proto_msgbuf_napi_poll(struct device *dev, struct napi_struct *napi,
+				 int budget)
 {
 	struct brcmf_bus *bus_if = dev_get_drvdata(dev);
 	struct brcmf_pub *drvr = bus_if->drvr;
@@ -1428,13 +1693,23 @@ int brcmf_proto_msgbuf_rx_trigger(struct device *dev)
 	void *buf;
 	u32 flowid;
 	int qlen;
+	int done;
 
-	buf = msgbuf->commonrings[BRCMF_D2H_MSGRING_RX_COMPLETE];
-	brcmf_msgbuf_process_rx(msgbuf, buf);
+	msgbuf->napi = napi;
+	msgbuf->napi_budget = budget;
+
+	/* TX completions are cheap and not counted against the budget */
 	buf = msgbuf->commonrings[BRCMF_D2H_MSGRING_TX_COMPLETE];
-	brcmf_msgbuf_process_rx(msgbuf, buf);
-	buf = msgbuf->commonrings[BRCMF_D2H_MSGRING_CONTROL_COMPLETE];
-	brcmf_msgbuf_process_rx(msgbuf, buf);
+	spin_lock(&msgbuf->bql_lock);
+	brcmf_msgbuf_process_rx(msgbuf, buf, INT_MAX);
+	brcmf_msgbuf_tx_done_flush(msgbuf);
+	spin_unlock(&msgbuf->bql_lock);
+
+	buf = msgbuf->commonrings[BRCMF_D2H_MSGRING_RX_COMPLETE];
+	done = brcmf_msgbuf_process_rx(msgbuf, buf, budget);
+
+	msgbuf->napi = NULL;
+	msgbuf->napi_budget = 0;
 
 	for_each_set_bit(flowid, msgbuf->txstatus_done_map,
 			 msgbuf->max_flowrings) {
@@ -1447,7 +1722,7 @@ int brcmf_proto_msgbuf_rx_trigger(struct device *dev)
 			brcmf_msgbuf_schedule_txdata(msgbuf, flowid, true);
 	}
 
-	return 0;
+	return done;
 }
 
 
@@ -1611,6 +1886,14 @@ static void brcmf_msgbuf_debugfs_create(struct brcmf_pub *drvr)
 
 int brcmf_proto_msgbuf_attach(struct brcmf_pub *drvr)
 {
+	struct page_pool_params pp_params = {
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV |
+			 PP_FLAG_PAGE_FRAG,
+		.order = 0,
+		.nid = NUMA_NO_NODE,
+		.dma_dir = DMA_FROM_DEVICE,
+		.max_len = PAGE_SIZE,
+	};
 	struct brcmf_bus_msgbuf *if_msgbuf;
 	struct brcmf_msgbuf *msgbuf;
 	u64 address;
@@ -1663,6 +1946,7 @@ int brcmf_proto_msgbuf_attach(struct brcmf_pub *drvr)
 	drvr->proto->delete_peer = brcmf_msgbuf_delete_peer;
 	drvr->proto->add_tdls_peer = brcmf_msgbuf_add_tdls_peer;
 	drvr->proto->rxreorder = brcmf_msgbuf_rxreorder;
+	drvr->proto->reset_txq = brcmf_msgbuf_reset_txq;
 	drvr->proto->debugfs_create = brcmf_msgbuf_debugfs_create;
 	drvr->proto->pd = msgbuf;
 
@@ -1693,6 +1977,15 @@ int brcmf_proto_msgbuf_attach(struct brcmf_pub *drvr)
 	if (!msgbuf->rx_pktids)
 		goto fail;
 
+	pp_params.pool_size = msgbuf->max_rxbufpost;
+	pp_params.dev = drvr->bus_if->dev;
+	msgbuf->rx_pool = page_pool_create(&pp_params);
+	if (IS_ERR(msgbuf->rx_pool)) {
+		msgbuf->rx_pool = NULL;
+		goto fail;
+	}
+	msgbuf->rx_pktids->pool = msgbuf->rx_pool;
+
 	msgbuf->flow = brcmf_flowring_attach(drvr->bus_if->dev,
 					     if_msgbuf->max_flowrings);
 	if (!msgbuf->flow)
@@ -1714,6 +2007,7 @@ int brcmf_proto_msgbuf_attach(struct brcmf_pub *drvr)
 	brcmf_msgbuf_rxbuf_event_post(msgbuf);
 	brcmf_msgbuf_rxbuf_ioctlresp_post(msgbuf);
 
+	spin_lock_init(&msgbuf->bql_lock);
 	INIT_WORK(&msgbuf->flowring_work, brcmf_msgbuf_flowring_worker);
 	spin_lock_init(&msgbuf->flowring_work_lock);
 	INIT_LIST_HEAD(&msgbuf->work_queue);
@@ -1725,6 +2019,8 @@ int brcmf_proto_msgbuf_attach(struct brcmf_pub *drvr)
 		kfree(msgbuf->flow_map);
 		kfree(msgbuf->txstatus_done_map);
 		brcmf_msgbuf_release_pktids(msgbuf);
+		if (msgbuf->rx_pool)
+			page_pool_destroy(msgbuf->rx_pool);
 		kfree(msgbuf->flowring_dma_handle);
 		if (msgbuf->ioctbuf)
 			dma_free_coherent(drvr->bus_if->dev,
@@ -1746,8 +2042,12 @@ void brcmf_proto_msgbuf_detach(struct brcmf_pub *drvr)
 
 	brcmf_dbg(TRACE, "Enter\n");
 	if (drvr->proto->pd) {
+		int ifidx;
+
 		msgbuf = (struct brcmf_msgbuf *)drvr->proto->pd;
 		cancel_work_sync(&msgbuf->flowring_work);
+		for (ifidx = 0; ifidx < BRCMF_MAX_IFS; ifidx++)
+			brcmf_msgbuf_bql_reset(msgbuf, ifidx);
 		while (!list_empty(&msgbuf->work_queue)) {
 			work = list_first_entry(&msgbuf->work_queue,
 						struct brcmf_msgbuf_work_item,
@@ -1765,6 +2065,8 @@ void brcmf_proto_msgbuf_detach(struct brcmf_pub *drvr)
 				  BRCMF_TX_IOCTL_MAX_MSG_SIZE,
 				  msgbuf->ioctbuf, msgbuf->ioctbuf_handle);
 		brcmf_msgbuf_release_pktids(msgbuf);
+		if (msgbuf->rx_pool)
+			page_pool_destroy(msgbuf->rx_pool);
 		kfree(msgbuf->flowring_dma_handle);
 		kfree(msgbuf);
 		drvr->proto->pd = NULL;
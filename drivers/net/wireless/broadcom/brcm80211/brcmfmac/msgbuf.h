@@ -29,6 +29,8 @@ struct msgbuf_buf_addr {
 };
 
 int brcmf_proto_msgbuf_rx_trigger(struct device *dev);
+int brcmf_proto_msgbuf_napi_poll(struct device *dev, struct napi_struct *napi,
+				 int budget);
 void brcmf_msgbuf_delete_flowring(struct brcmf_pub *drvr, u16 flowid);
 int brcmf_proto_msgbuf_attach(struct brcmf_pub *drvr);
 void brcmf_proto_msgbuf_detach(struct brcmf_pub *drvr);
@@ -7,6 +7,7 @@
 #include <linux/module.h>
 #include <linux/firmware.h>
 #include <linux/pci.h>
+#include <linux/netdevice.h>
 #include <linux/vmalloc.h>
 #include <linux/delay.h>
 #include <linux/interrupt.h>
@@ -411,6 +412,8 @@ struct brcmf_pciedev_info {
 	bool irq_allocated;
 	bool irq_ready;
 	bool have_msi;
+	struct net_device napi_dev;
+	struct napi_struct napi;
 	bool wowl_enabled;
 	u8 dma_idx_sz;
 	void *idxbuf;
@@ -1035,6 +1038,7 @@ static irqreturn_t brcmf_pcie_quick_check_isr(int irq, void *arg)
 static irqreturn_t brcmf_pcie_isr_thread(int irq, void *arg)
 {
 	struct brcmf_pciedev_info *devinfo = (struct brcmf_pciedev_info *)arg;
+	bool polling = false;
 	u32 status;
 
 	devinfo->in_irq = true;
@@ -1047,18 +1051,42 @@ static irqreturn_t brcmf_pcie_isr_thread(int irq, void *arg)
 			brcmf_pcie_poll_mb_data(devinfo);
 	}
 	if (devinfo->have_msi || status & devinfo->reginfo->int_d2h_db) {
-		if (devinfo->state == BRCMFMAC_PCIE_STATE_UP && devinfo->irq_ready)
+		if (devinfo->state == BRCMFMAC_PCIE_STATE_UP && devinfo->irq_ready) {
 			brcmf_proto_msgbuf_rx_trigger(&devinfo->pdev->dev);
+
+			/* Data rings are drained by NAPI, which unmasks the IRQ */
+			if (napi_schedule_prep(&devinfo->napi)) {
+				local_bh_disable();
+				__napi_schedule(&devinfo->napi);
+				local_bh_enable();
+				polling = true;
+			}
+		}
 	}
 
 	brcmf_pcie_bus_console_read(devinfo, false);
-	if (devinfo->state == BRCMFMAC_PCIE_STATE_UP)
+	if (devinfo->state == BRCMFMAC_PCIE_STATE_UP && !polling)
 		brcmf_pcie_intr_enable(devinfo);
 	devinfo->in_irq = false;
 	return IRQ_HANDLED;
 }
 
 
+static int brcmf_pcie_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct brcmf_pciedev_info *devinfo =
+		container_of(napi, struct brcmf_pciedev_info, napi);
+	int done;
+
+	done = brcmf_proto_msgbuf_napi_poll(&devinfo->pdev->dev, napi, budget);
+	if (done < budget && napi_complete_done(napi, done) &&
+	    devinfo->state == BRCMFMAC_PCIE_STATE_UP)
+		brcmf_pcie_intr_enable(devinfo);
+
+	return done;
+}
+
+
 static int brcmf_pcie_request_irq(struct brcmf_pciedev_info *devinfo)
 {
 	struct pci_dev *pdev = devinfo->pdev;
@@ -1072,9 +1100,15 @@ static int brcmf_pcie_request_irq(struct brcmf_pciedev_info *devinfo)
 	if (devinfo->have_msi)
 		brcmf_dbg(PCIE, "MSI enabled\n");
 
+	init_dummy_netdev(&devinfo->napi_dev);
+	netif_napi_add(&devinfo->napi_dev, &devinfo->napi, brcmf_pcie_napi_poll);
+	napi_enable(&devinfo->napi);
+
 	if (request_threaded_irq(pdev->irq, brcmf_pcie_quick_check_isr,
 				 brcmf_pcie_isr_thread, IRQF_SHARED,
 				 "brcmf_pcie_intr", devinfo)) {
+		napi_disable(&devinfo->napi);
+		netif_napi_del(&devinfo->napi);
 		pci_disable_msi(pdev);
 		brcmf_err(bus, "Failed to request IRQ %d\n", pdev->irq);
 		return -EIO;
@@ -1094,8 +1128,12 @@ static void brcmf_pcie_release_irq(struct brcmf_pciedev_info *devinfo)
 	if (!devinfo->irq_allocated)
 		return;
 
+	brcmf_pcie_intr_disable(devinfo);
+	napi_disable(&devinfo->napi);
+	/* a final poll may have unmasked the mailbox again */
 	brcmf_pcie_intr_disable(devinfo);
 	free_irq(pdev->irq, devinfo);
+	netif_napi_del(&devinfo->napi);
 	pci_disable_msi(pdev);
 
 	msleep(50);
@@ -36,6 +36,7 @@ struct brcmf_proto {
 	void (*add_if)(struct brcmf_if *ifp);
 	void (*del_if)(struct brcmf_if *ifp);
 	void (*reset_if)(struct brcmf_if *ifp);
+	void (*reset_txq)(struct brcmf_if *ifp);
 	int (*init_done)(struct brcmf_pub *drvr);
 	void (*debugfs_create)(struct brcmf_pub *drvr);
 	void *pd;
@@ -138,6 +139,14 @@ brcmf_proto_reset_if(struct brcmf_pub *drvr, struct brcmf_if *ifp)
 	drvr->proto->reset_if(ifp);
 }
 
+static inline void
+brcmf_proto_reset_txq(struct brcmf_pub *drvr, struct brcmf_if *ifp)
+{
+	if (!drvr->proto->reset_txq)
+		return;
+	drvr->proto->reset_txq(ifp);
+}
+
 static inline int
 brcmf_proto_init_done(struct brcmf_pub *drvr)
 {
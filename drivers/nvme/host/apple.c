@@ -129,6 +129,13 @@ struct apple_nvmmu_tcb {
  * an array indexed by the command tag on this hardware. Commands must also be
  * present in the NVMMU's tcb array. They are triggered by writing their tag to
  * a MMIO register.
+ *
+ * Since there is no SQ tail to maintain, commands can be placed into the
+ * submission array from any CPU without serializing against each other. We
+ * take advantage of that by exposing several blk-mq hardware contexts which
+ * all share this one hardware queue and a single tag space (see
+ * apple_nvme_alloc_tagsets()), so submitters no longer contend on a single
+ * hctx.
  */
 struct apple_nvme_queue {
 	struct nvme_command *sqes;
@@ -192,6 +199,8 @@ struct apple_nvme {
 
 	struct blk_mq_tag_set admin_tagset;
 	struct blk_mq_tag_set tagset;
+	unsigned int nr_hctx;
+	unsigned int nr_poll_hctx;
 
 	int irq;
 	spinlock_t lock;
@@ -203,11 +212,48 @@ struct apple_nvme {
 	unsigned long flush_interval;
 	unsigned long last_flush;
 	struct delayed_work flush_dwork;
+
+	/*
+	 * Flush coalescing state, see apple_nvme_coalesce_flush().
+	 */
+	spinlock_t flush_lock;
+	bool flush_coalesce;
+	struct request *flush_leader;
+	struct request *flush_next;
+	struct list_head flush_waiters;
+	struct list_head flush_pending;
+	struct work_struct flush_kick_work;
+	u64 flushes_issued;
+	u64 flushes_merged;
+	u64 flushes_deferred;
+
+	/* ANS was left idle rather than shut down by apple_nvme_suspend() */
+	bool warm_suspended;
 };
 
-unsigned int flush_interval = 1000;
+/*
+ * A flush that falls into the grace period completes without reaching the
+ * device, so this trades durability for speed. Flush coalescing gives most
+ * of the speed back without that, hence it is off by default.
+ */
+unsigned int flush_interval;
 module_param(flush_interval, uint, 0644);
-MODULE_PARM_DESC(flush_interval, "Grace period in msecs between flushes");
+MODULE_PARM_DESC(flush_interval,
+		 "Grace period in msecs between flushes, 0 (default) to disable");
+
+static unsigned int io_queues;
+module_param(io_queues, uint, 0444);
+MODULE_PARM_DESC(io_queues,
+	"Number of blk-mq hardware contexts sharing the IO queue (0 = one per CPU)");
+
+static unsigned int poll_queues;
+module_param(poll_queues, uint, 0444);
+MODULE_PARM_DESC(poll_queues, "Number of blk-mq hardware contexts for polled IO");
+
+static bool warm_resume;
+module_param(warm_resume, bool, 0644);
+MODULE_PARM_DESC(warm_resume,
+	"Keep ANS idle across system suspend instead of resetting the controller");
 
 static_assert(sizeof(struct nvme_command) == 64);
 static_assert(sizeof(struct apple_nvmmu_tcb) == 128);
@@ -282,11 +328,23 @@ static const struct apple_rtkit_ops apple_nvme_rtkit_ops = {
 	.shmem_destroy = apple_nvme_sart_dma_destroy,
 };
 
+/*
+ * TCB invalidations are posted writes and are ordered against the doorbell
+ * write that could reuse the tag, which only happens once anv->lock is
+ * dropped. Completion processing therefore only queues them up per CQE and
+ * checks the status once per drain in apple_nvmmu_inval_sync().
+ */
 static void apple_nvmmu_inval(struct apple_nvme_queue *q, unsigned int tag)
 {
 	struct apple_nvme *anv = queue_to_apple_nvme(q);
 
 	writel(tag, anv->mmio_nvme + APPLE_NVMMU_TCB_INVAL);
+}
+
+static void apple_nvmmu_inval_sync(struct apple_nvme_queue *q)
+{
+	struct apple_nvme *anv = queue_to_apple_nvme(q);
+
 	if (readl(anv->mmio_nvme + APPLE_NVMMU_TCB_STAT))
 		dev_warn_ratelimited(anv->dev,
 				     "NVMMU TCB invalidation failed\n");
@@ -367,13 +425,19 @@ static void apple_nvme_free_prps(struct apple_nvme *anv, struct request *req)
 	}
 }
 
-static void apple_nvme_unmap_data(struct apple_nvme *anv, struct request *req)
+/* @batch is NULL outside of batched completions */
+static void apple_nvme_unmap_data(struct apple_nvme *anv, struct request *req,
+				  struct dma_unmap_batch *batch)
 {
 	struct apple_nvme_iod *iod = blk_mq_rq_to_pdu(req);
 
 	if (iod->dma_len) {
-		dma_unmap_page(anv->dev, iod->first_dma, iod->dma_len,
-			       rq_dma_dir(req));
+		if (batch)
+			dma_unmap_batch_add(batch, anv->dev, iod->first_dma,
+					    iod->dma_len, rq_dma_dir(req), 0);
+		else
+			dma_unmap_page(anv->dev, iod->first_dma, iod->dma_len,
+				       rq_dma_dir(req));
 		return;
 	}
 
@@ -558,18 +622,69 @@ static blk_status_t apple_nvme_map_data(struct apple_nvme *anv,
 	return ret;
 }
 
-static __always_inline void apple_nvme_unmap_rq(struct request *req)
+static __always_inline void apple_nvme_unmap_rq(struct request *req,
+		struct dma_unmap_batch *batch)
 {
 	struct apple_nvme_iod *iod = blk_mq_rq_to_pdu(req);
 	struct apple_nvme *anv = queue_to_apple_nvme(iod->q);
 
 	if (blk_rq_nr_phys_segments(req))
-		apple_nvme_unmap_data(anv, req);
+		apple_nvme_unmap_data(anv, req, batch);
+}
+
+/*
+ * Called when a device flush has finished. Everyone who was waiting on that
+ * flush now shares its result, and if more flushes arrived while it was
+ * running one of them is promoted to be the next device flush on behalf of
+ * all of them.
+ *
+ * This can be called with anv->lock held from the CQ handler, so the next
+ * flush is submitted from flush_kick_work instead of directly.
+ */
+static void apple_nvme_flush_done(struct apple_nvme *anv, struct request *req)
+{
+	struct request *rq, *next;
+	unsigned long flags;
+	LIST_HEAD(waiters);
+
+	spin_lock_irqsave(&anv->flush_lock, flags);
+	if (anv->flush_leader != req) {
+		spin_unlock_irqrestore(&anv->flush_lock, flags);
+		return;
+	}
+
+	list_splice_init(&anv->flush_waiters, &waiters);
+	anv->flush_leader = NULL;
+	if (!list_empty(&anv->flush_pending)) {
+		rq = list_first_entry(&anv->flush_pending, struct request,
+				      queuelist);
+		list_del_init(&rq->queuelist);
+		list_splice_init(&anv->flush_pending, &anv->flush_waiters);
+		anv->flush_leader = rq;
+		anv->flush_next = rq;
+		kblockd_schedule_work(&anv->flush_kick_work);
+	}
+	spin_unlock_irqrestore(&anv->flush_lock, flags);
+
+	list_for_each_entry_safe(rq, next, &waiters, queuelist) {
+		list_del_init(&rq->queuelist);
+		nvme_req(rq)->status = nvme_req(req)->status;
+		nvme_req(rq)->result = nvme_req(req)->result;
+		blk_mq_complete_request(rq);
+	}
 }
 
 static void apple_nvme_complete_rq(struct request *req)
 {
-	apple_nvme_unmap_rq(req);
+	struct apple_nvme_iod *iod = blk_mq_rq_to_pdu(req);
+
+	apple_nvme_unmap_rq(req, NULL);
+	/*
+	 * Flushes are never batched since blk-flush always sets ->end_io for
+	 * them, so this is the only completion path we need to hook.
+	 */
+	if (req_op(req) == REQ_OP_FLUSH)
+		apple_nvme_flush_done(queue_to_apple_nvme(iod->q), req);
 	nvme_complete_rq(req);
 }
 
@@ -645,8 +760,10 @@ static bool apple_nvme_poll_cq(struct apple_nvme_queue *q,
 		apple_nvme_update_cq_head(q);
 	}
 
-	if (found)
+	if (found) {
+		apple_nvmmu_inval_sync(q);
 		writel(q->cq_head, q->cq_db);
+	}
 
 	return found;
 }
@@ -744,21 +861,109 @@ static int apple_nvme_remove_sq(struct apple_nvme *anv)
 static bool apple_nvme_delayed_flush(struct apple_nvme *anv, struct nvme_ns *ns,
 				     struct request *req)
 {
-	if (!anv->flush_interval || req_op(req) != REQ_OP_FLUSH)
+	unsigned long flags;
+	bool deferred = false;
+
+	if (!READ_ONCE(anv->flush_interval) || req_op(req) != REQ_OP_FLUSH)
 		return false;
-	if (delayed_work_pending(&anv->flush_dwork))
-		return true;
+
+	spin_lock_irqsave(&anv->flush_lock, flags);
+	if (delayed_work_pending(&anv->flush_dwork)) {
+		deferred = true;
+		goto out;
+	}
 	if (time_before(jiffies, anv->last_flush + anv->flush_interval)) {
 		kblockd_mod_delayed_work_on(WORK_CPU_UNBOUND, &anv->flush_dwork,
 						anv->flush_interval);
 		if (WARN_ON_ONCE(anv->flush_ns && anv->flush_ns != ns))
-			goto out;
+			goto out_issue;
 		anv->flush_ns = ns;
-		return true;
+		deferred = true;
+		goto out;
 	}
-out:
+out_issue:
 	anv->last_flush = jiffies;
-	return false;
+out:
+	if (deferred)
+		anv->flushes_deferred++;
+	spin_unlock_irqrestore(&anv->flush_lock, flags);
+	return deferred;
+}
+
+/*
+ * Coalesce flushes across all hardware contexts. blk-flush already merges
+ * flushes issued behind the same hctx, but every hctx has its own flush
+ * queue and they all end up on the same device.
+ *
+ * The first flush becomes the leader and is sent to the device. Flushes for
+ * the same namespace that arrive while the leader is running can't be
+ * satisfied by it since they may need to cover writes that completed after
+ * it was issued. They're parked on flush_pending instead and are all served
+ * by a single device flush once the leader completes, see
+ * apple_nvme_flush_done().
+ *
+ * Returns true if the request was parked and must not be submitted.
+ */
+static bool apple_nvme_coalesce_flush(struct apple_nvme *anv,
+				      struct request *req)
+{
+	unsigned long flags;
+	bool parked = false;
+
+	spin_lock_irqsave(&anv->flush_lock, flags);
+	if (anv->flush_coalesce && !anv->flush_leader) {
+		anv->flush_leader = req;
+	} else if (anv->flush_coalesce && anv->flush_leader->q == req->q) {
+		list_add_tail(&req->queuelist, &anv->flush_pending);
+		parked = true;
+	}
+	if (!parked)
+		anv->flushes_issued++;
+	spin_unlock_irqrestore(&anv->flush_lock, flags);
+
+	return parked;
+}
+
+static void apple_nvme_flush_kick_work(struct work_struct *work)
+{
+	struct apple_nvme *anv =
+		container_of(work, struct apple_nvme, flush_kick_work);
+	struct apple_nvme_iod *iod;
+	struct request *req;
+	unsigned long flags;
+
+	spin_lock_irqsave(&anv->flush_lock, flags);
+	req = anv->flush_next;
+	anv->flush_next = NULL;
+	if (req) {
+		anv->flushes_issued++;
+		anv->flushes_merged += list_count_nodes(&anv->flush_waiters);
+	}
+	spin_unlock_irqrestore(&anv->flush_lock, flags);
+
+	if (!req)
+		return;
+
+	iod = blk_mq_rq_to_pdu(req);
+	apple_nvme_submit_cmd(iod->q, &iod->cmd);
+}
+
+/*
+ * Forget about all parked flushes. They have already been started and will
+ * be cancelled together with everything else on the tagset.
+ */
+static void apple_nvme_flush_reset(struct apple_nvme *anv)
+{
+	unsigned long flags;
+
+	cancel_work_sync(&anv->flush_kick_work);
+
+	spin_lock_irqsave(&anv->flush_lock, flags);
+	anv->flush_leader = NULL;
+	anv->flush_next = NULL;
+	INIT_LIST_HEAD(&anv->flush_waiters);
+	INIT_LIST_HEAD(&anv->flush_pending);
+	spin_unlock_irqrestore(&anv->flush_lock, flags);
 }
 
 static blk_status_t apple_nvme_queue_rq(struct blk_mq_hw_ctx *hctx,
@@ -802,6 +1007,9 @@ static blk_status_t apple_nvme_queue_rq(struct blk_mq_hw_ctx *hctx,
 		return BLK_STS_OK;
 	}
 
+	if (req_op(req) == REQ_OP_FLUSH && apple_nvme_coalesce_flush(anv, req))
+		return BLK_STS_OK;
+
 	apple_nvme_submit_cmd(q, cmnd);
 	return BLK_STS_OK;
 
@@ -897,6 +1105,7 @@ static void apple_nvme_disable(struct apple_nvme *anv, bool shutdown)
 	apple_nvme_handle_cq(&anv->adminq, true);
 	spin_unlock_irqrestore(&anv->lock, flags);
 
+	apple_nvme_flush_reset(anv);
 	nvme_cancel_tagset(&anv->ctrl);
 	nvme_cancel_admin_tagset(&anv->ctrl);
 
@@ -986,6 +1195,35 @@ static int apple_nvme_poll(struct blk_mq_hw_ctx *hctx,
 	return found;
 }
 
+static void apple_nvme_map_queues(struct blk_mq_tag_set *set)
+{
+	struct apple_nvme_queue *q = set->driver_data;
+	struct apple_nvme *anv = queue_to_apple_nvme(q);
+	unsigned int nr_queues[HCTX_MAX_TYPES] = {
+		[HCTX_TYPE_DEFAULT] = anv->nr_hctx,
+		[HCTX_TYPE_POLL] = anv->nr_poll_hctx,
+	};
+	int i, qoff;
+
+	for (i = 0, qoff = 0; i < set->nr_maps; i++) {
+		struct blk_mq_queue_map *map = &set->map[i];
+
+		map->nr_queues = nr_queues[i];
+		if (!map->nr_queues) {
+			BUG_ON(i == HCTX_TYPE_DEFAULT);
+			continue;
+		}
+
+		/*
+		 * There is only a single interrupt for the whole controller
+		 * so there's no IRQ affinity to follow here.
+		 */
+		map->queue_offset = qoff;
+		blk_mq_map_queues(map);
+		qoff += map->nr_queues;
+	}
+}
+
 static const struct blk_mq_ops apple_nvme_mq_admin_ops = {
 	.queue_rq = apple_nvme_queue_rq,
 	.complete = apple_nvme_complete_rq,
@@ -1001,6 +1239,7 @@ static const struct blk_mq_ops apple_nvme_mq_ops = {
 	.init_request = apple_nvme_init_request,
 	.timeout = apple_nvme_timeout,
 	.poll = apple_nvme_poll,
+	.map_queues = apple_nvme_map_queues,
 };
 
 static void apple_nvme_init_queue(struct apple_nvme_queue *q)
@@ -1193,7 +1432,8 @@ static void apple_nvme_reset_work(struct work_struct *work)
 
 	nvme_unquiesce_io_queues(&anv->ctrl);
 	nvme_wait_freeze(&anv->ctrl);
-	blk_mq_update_nr_hw_queues(&anv->tagset, 1);
+	blk_mq_update_nr_hw_queues(&anv->tagset,
+				   anv->nr_hctx + anv->nr_poll_hctx);
 	nvme_unfreeze(&anv->ctrl);
 
 	if (!nvme_change_ctrl_state(&anv->ctrl, NVME_CTRL_LIVE)) {
@@ -1265,6 +1505,109 @@ static void apple_nvme_free_ctrl(struct nvme_ctrl *ctrl)
 	put_device(anv->dev);
 }
 
+static ssize_t flush_coalesce_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct apple_nvme *anv = ctrl_to_apple_nvme(dev_get_drvdata(dev));
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(anv->flush_coalesce));
+}
+
+static ssize_t flush_coalesce_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct apple_nvme *anv = ctrl_to_apple_nvme(dev_get_drvdata(dev));
+	unsigned long flags;
+	bool new;
+
+	if (kstrtobool(buf, &new) < 0)
+		return -EINVAL;
+
+	/*
+	 * Turning coalescing off only stops new flushes from being parked, the
+	 * ones already waiting still get served by the running leader.
+	 */
+	spin_lock_irqsave(&anv->flush_lock, flags);
+	anv->flush_coalesce = new;
+	spin_unlock_irqrestore(&anv->flush_lock, flags);
+
+	return count;
+}
+static DEVICE_ATTR_RW(flush_coalesce);
+
+static ssize_t flush_interval_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct apple_nvme *anv = ctrl_to_apple_nvme(dev_get_drvdata(dev));
+
+	return sysfs_emit(buf, "%u\n",
+			  jiffies_to_msecs(READ_ONCE(anv->flush_interval)));
+}
+
+static ssize_t flush_interval_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct apple_nvme *anv = ctrl_to_apple_nvme(dev_get_drvdata(dev));
+	unsigned long flags;
+	unsigned int msecs;
+
+	if (kstrtouint(buf, 0, &msecs) < 0)
+		return -EINVAL;
+
+	spin_lock_irqsave(&anv->flush_lock, flags);
+	anv->flush_interval = msecs_to_jiffies(msecs);
+	anv->last_flush = jiffies - anv->flush_interval;
+	spin_unlock_irqrestore(&anv->flush_lock, flags);
+
+	/* don't leave a deferred flush hanging around if we just disabled it */
+	if (!msecs)
+		flush_delayed_work(&anv->flush_dwork);
+
+	return count;
+}
+static DEVICE_ATTR_RW(flush_interval);
+
+#define apple_nvme_flush_stat_attr(field)				\
+static ssize_t field##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct apple_nvme *anv = ctrl_to_apple_nvme(dev_get_drvdata(dev)); \
+	unsigned long flags;						\
+	u64 val;							\
+									\
+	spin_lock_irqsave(&anv->flush_lock, flags);			\
+	val = anv->field;						\
+	spin_unlock_irqrestore(&anv->flush_lock, flags);		\
+									\
+	return sysfs_emit(buf, "%llu\n", val);				\
+}									\
+static DEVICE_ATTR_RO(field)
+
+apple_nvme_flush_stat_attr(flushes_issued);
+apple_nvme_flush_stat_attr(flushes_merged);
+apple_nvme_flush_stat_attr(flushes_deferred);
+
+static struct attribute *apple_nvme_attrs[] = {
+	&dev_attr_flush_coalesce.attr,
+	&dev_attr_flush_interval.attr,
+	&dev_attr_flushes_issued.attr,
+	&dev_attr_flushes_merged.attr,
+	&dev_attr_flushes_deferred.attr,
+	NULL,
+};
+
+static const struct attribute_group apple_nvme_dev_attrs_group = {
+	.attrs = apple_nvme_attrs,
+};
+
+static const struct attribute_group *apple_nvme_dev_attr_groups[] = {
+	&nvme_dev_attrs_group,
+	&apple_nvme_dev_attrs_group,
+	NULL,
+};
+
 static const struct nvme_ctrl_ops nvme_ctrl_ops = {
 	.name = "apple-nvme",
 	.module = THIS_MODULE,
@@ -1274,6 +1617,7 @@ static const struct nvme_ctrl_ops nvme_ctrl_ops = {
 	.reg_read64 = apple_nvme_reg_read64,
 	.free_ctrl = apple_nvme_free_ctrl,
 	.get_address = apple_nvme_get_address,
+	.dev_attr_groups = apple_nvme_dev_attr_groups,
 };
 
 static void apple_nvme_async_probe(void *data, async_cookie_t cookie)
@@ -1311,9 +1655,24 @@ static int apple_nvme_alloc_tagsets(struct apple_nvme *anv)
 	if (ret)
 		return ret;
 
+	/*
+	 * All hardware contexts are backed by the same IO queue and NVMMU
+	 * TCB array. BLK_MQ_F_TAG_HCTX_SHARED makes blk-mq hand out tags from
+	 * a single bitmap shared by every hctx which keeps them unique across
+	 * the controller and keeps tags[0] valid for nvme_find_rq().
+	 */
+	anv->nr_hctx = io_queues ? min(io_queues, nr_cpu_ids) : nr_cpu_ids;
+	anv->nr_poll_hctx = min(poll_queues, nr_cpu_ids);
 	anv->tagset.ops = &apple_nvme_mq_ops;
-	anv->tagset.nr_hw_queues = 1;
-	anv->tagset.nr_maps = 1;
+	anv->tagset.nr_hw_queues = anv->nr_hctx + anv->nr_poll_hctx;
+	/*
+	 * Polled hctxs submit to the same hardware queue as everyone else.
+	 * The controller can't create a second CQ without an interrupt, but
+	 * polled requests are reaped by apple_nvme_poll() as soon as they
+	 * show up on the CQ, and when the interrupt happens to find them
+	 * first they are completed inline without a softirq round trip.
+	 */
+	anv->tagset.nr_maps = anv->nr_poll_hctx ? HCTX_MAX_TYPES : 1;
 	/*
 	 * Tags are used as an index to the NVMMU and must be unique across
 	 * both queues. The admin queue gets the first APPLE_NVME_AQ_DEPTH which
@@ -1324,7 +1683,7 @@ static int apple_nvme_alloc_tagsets(struct apple_nvme *anv)
 	anv->tagset.timeout = NVME_IO_TIMEOUT;
 	anv->tagset.numa_node = NUMA_NO_NODE;
 	anv->tagset.cmd_size = sizeof(struct apple_nvme_iod);
-	anv->tagset.flags = BLK_MQ_F_SHOULD_MERGE;
+	anv->tagset.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_TAG_HCTX_SHARED;
 	anv->tagset.driver_data = &anv->ioq;
 
 	ret = blk_mq_alloc_tag_set(&anv->tagset);
@@ -1451,6 +1810,9 @@ static void apple_nvme_flush_work(struct work_struct *work)
 
 	c.common.opcode = nvme_cmd_flush;
 	c.common.nsid = cpu_to_le32(anv->flush_ns->head->ns_id);
+	spin_lock_irq(&anv->flush_lock);
+	anv->flushes_issued++;
+	spin_unlock_irq(&anv->flush_lock);
 	err = nvme_submit_sync_cmd(ns->queue, &c, NULL, 0);
 	if (err) {
 		dev_err(anv->dev, "Deferred flush failed: %d\n", err);
@@ -1526,6 +1888,12 @@ static int apple_nvme_probe(struct platform_device *pdev)
 	INIT_WORK(&anv->ctrl.reset_work, apple_nvme_reset_work);
 	INIT_WORK(&anv->remove_work, apple_nvme_remove_dead_ctrl_work);
 	spin_lock_init(&anv->lock);
+	INIT_DELAYED_WORK(&anv->flush_dwork, apple_nvme_flush_work);
+	spin_lock_init(&anv->flush_lock);
+	anv->flush_coalesce = true;
+	INIT_LIST_HEAD(&anv->flush_waiters);
+	INIT_LIST_HEAD(&anv->flush_pending);
+	INIT_WORK(&anv->flush_kick_work, apple_nvme_flush_kick_work);
 
 	ret = apple_nvme_queue_alloc(anv, &anv->adminq);
 	if (ret)
@@ -1599,8 +1967,6 @@ static int apple_nvme_probe(struct platform_device *pdev)
 		anv->last_flush = jiffies - anv->flush_interval;
 	}
 
-	INIT_DELAYED_WORK(&anv->flush_dwork, apple_nvme_flush_work);
-
 	nvme_reset_ctrl(&anv->ctrl);
 	async_schedule(apple_nvme_async_probe, anv);
 
@@ -1647,9 +2013,114 @@ static void apple_nvme_shutdown(struct platform_device *pdev)
 	}
 }
 
+static void apple_nvme_flush_namespaces(struct apple_nvme *anv)
+{
+	struct nvme_command c = { };
+	struct nvme_ns *ns;
+	int err;
+
+	c.common.opcode = nvme_cmd_flush;
+
+	down_read(&anv->ctrl.namespaces_rwsem);
+	list_for_each_entry(ns, &anv->ctrl.namespaces, list) {
+		c.common.nsid = cpu_to_le32(ns->head->ns_id);
+		err = nvme_submit_sync_cmd(ns->queue, &c, NULL, 0);
+		if (err)
+			dev_warn(anv->dev, "Flush of nsid %u failed: %d\n",
+				 ns->head->ns_id, err);
+	}
+	up_read(&anv->ctrl.namespaces_rwsem);
+}
+
+/*
+ * Park the controller without tearing it down: the queues stay allocated
+ * on both sides and ANS is asked to go to IDLE, which retains its state as
+ * long as its power domains stay up. Marking the device as being in a
+ * wakeup path keeps genpd from powering those domains off.
+ */
+static int apple_nvme_warm_suspend(struct apple_nvme *anv)
+{
+	int i, ret;
+
+	if (anv->ctrl.state != NVME_CTRL_LIVE ||
+	    !apple_rtkit_is_running(anv->rtk))
+		return -ENODEV;
+
+	flush_delayed_work(&anv->flush_dwork);
+	apple_nvme_flush_namespaces(anv);
+
+	nvme_start_freeze(&anv->ctrl);
+	if (nvme_wait_freeze_timeout(&anv->ctrl, NVME_IO_TIMEOUT) <= 0) {
+		ret = -ETIMEDOUT;
+		goto out_unfreeze;
+	}
+
+	nvme_quiesce_io_queues(&anv->ctrl);
+	nvme_quiesce_admin_queue(&anv->ctrl);
+
+	ret = apple_rtkit_idle(anv->rtk);
+	if (ret)
+		goto out_unquiesce;
+
+	device_set_wakeup_path(anv->dev);
+	for (i = 0; anv->pd_count > 1 && i < anv->pd_count; i++)
+		device_set_wakeup_path(anv->pd_dev[i]);
+
+	anv->warm_suspended = true;
+	return 0;
+
+out_unquiesce:
+	nvme_unquiesce_admin_queue(&anv->ctrl);
+	nvme_unquiesce_io_queues(&anv->ctrl);
+out_unfreeze:
+	nvme_unfreeze(&anv->ctrl);
+	return ret;
+}
+
+static int apple_nvme_warm_resume(struct apple_nvme *anv)
+{
+	u32 csts, boot_status;
+	int ret;
+
+	anv->warm_suspended = false;
+
+	ret = apple_rtkit_wake(anv->rtk);
+	if (ret)
+		return ret;
+
+	csts = readl(anv->mmio_nvme + NVME_REG_CSTS);
+	boot_status = readl(anv->mmio_nvme + APPLE_ANS_BOOT_STATUS);
+	if (!(csts & NVME_CSTS_RDY) || (csts & NVME_CSTS_CFS) ||
+	    boot_status != APPLE_ANS_BOOT_STATUS_OK)
+		return -EIO;
+
+	nvme_unquiesce_admin_queue(&anv->ctrl);
+	nvme_unquiesce_io_queues(&anv->ctrl);
+	nvme_unfreeze(&anv->ctrl);
+	return 0;
+}
+
 static int apple_nvme_resume(struct device *dev)
 {
 	struct apple_nvme *anv = dev_get_drvdata(dev);
+	int ret;
+
+	if (anv->warm_suspended) {
+		ret = apple_nvme_warm_resume(anv);
+		if (!ret)
+			return 0;
+
+		dev_warn(dev, "Warm resume failed (%d), resetting controller\n",
+			 ret);
+		/*
+		 * Leave the queues frozen and quiesced, just like a cold
+		 * suspend would. If the firmware did come back the reset work
+		 * goes through apple_nvme_disable() which freezes them again,
+		 * so drop our reference in that case.
+		 */
+		if (apple_rtkit_is_running(anv->rtk))
+			nvme_unfreeze(&anv->ctrl);
+	}
 
 	return nvme_reset_ctrl(&anv->ctrl);
 }
@@ -1659,6 +2130,14 @@ static int apple_nvme_suspend(struct device *dev)
 	struct apple_nvme *anv = dev_get_drvdata(dev);
 	int ret = 0;
 
+	if (READ_ONCE(warm_resume)) {
+		ret = apple_nvme_warm_suspend(anv);
+		if (!ret)
+			return 0;
+		dev_warn(dev, "Warm suspend failed (%d), shutting down\n", ret);
+		ret = 0;
+	}
+
 	apple_nvme_disable(anv, true);
 
 	if (apple_rtkit_is_running(anv->rtk)) {
@@ -1684,6 +2163,7 @@ static struct platform_driver apple_nvme_driver = {
 		.name = "nvme-apple",
 		.of_match_table = apple_nvme_of_match,
 		.pm = pm_sleep_ptr(&apple_nvme_pm_ops),
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = apple_nvme_probe,
 	.remove = apple_nvme_remove,
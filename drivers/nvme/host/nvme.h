@@ -11,6 +11,7 @@
 #include <linux/pci.h>
 #include <linux/kref.h>
 #include <linux/blk-mq.h>
+#include <linux/dma-mapping.h>
 #include <linux/sed-opal.h>
 #include <linux/fault-inject.h>
 #include <linux/rcupdate.h>
@@ -182,6 +183,7 @@ enum {
 	NVME_REQ_CANCELLED		= (1 << 0),
 	NVME_REQ_USERCMD		= (1 << 1),
 	NVME_MPATH_IO_STATS		= (1 << 2),
+	NVME_MPATH_CNT_ACTIVE		= (1 << 3),
 };
 
 static inline struct nvme_request *nvme_req(struct request *req)
@@ -342,6 +344,7 @@ struct nvme_ctrl {
 	struct nvme_ana_rsp_hdr *ana_log_buf;
 	size_t ana_log_size;
 	struct timer_list anatt_timer;
+	atomic_t nr_active;	/* outstanding I/O for the queue-depth iopolicy */
 	struct work_struct ana_work;
 #endif
 
@@ -385,6 +388,7 @@ struct nvme_ctrl {
 enum nvme_iopolicy {
 	NVME_IOPOLICY_NUMA,
 	NVME_IOPOLICY_RR,
+	NVME_IOPOLICY_QD,
 };
 
 struct nvme_subsystem {
@@ -723,15 +727,23 @@ static inline bool nvme_is_aen_req(u16 qid, __u16 command_id)
 void nvme_complete_rq(struct request *req);
 void nvme_complete_batch_req(struct request *req);
 
+/*
+ * @fn unmaps the data of a request, and may queue its page mappings in
+ * @batch so that they are all torn down with a single IOTLB invalidation.
+ */
 static __always_inline void nvme_complete_batch(struct io_comp_batch *iob,
-						void (*fn)(struct request *rq))
+		void (*fn)(struct request *rq, struct dma_unmap_batch *batch))
 {
+	struct dma_unmap_batch batch;
 	struct request *req;
 
+	dma_unmap_batch_init(&batch);
 	rq_list_for_each(&iob->req_list, req) {
-		fn(req);
+		fn(req, &batch);
 		nvme_complete_batch_req(req);
 	}
+	/* the bios may only complete once the device can't reach them */
+	dma_unmap_batch_flush(&batch);
 	blk_mq_end_request_batch(iob);
 }
 
@@ -906,6 +918,7 @@ static inline void nvme_trace_bio_complete(struct request *req)
 extern bool multipath;
 extern struct device_attribute dev_attr_ana_grpid;
 extern struct device_attribute dev_attr_ana_state;
+extern struct device_attribute dev_attr_queue_depth;
 extern struct device_attribute subsys_attr_iopolicy;
 
 #else
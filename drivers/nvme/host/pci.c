@@ -538,13 +538,24 @@ static void nvme_free_prps(struct nvme_dev *dev, struct request *req)
 	}
 }
 
-static void nvme_unmap_data(struct nvme_dev *dev, struct request *req)
+/* @batch is NULL outside of batched completions */
+static void nvme_unmap_page(struct nvme_dev *dev, struct request *req,
+		struct dma_unmap_batch *batch, dma_addr_t addr, size_t size)
+{
+	if (batch)
+		dma_unmap_batch_add(batch, dev->dev, addr, size,
+				    rq_dma_dir(req), 0);
+	else
+		dma_unmap_page(dev->dev, addr, size, rq_dma_dir(req));
+}
+
+static void nvme_unmap_data(struct nvme_dev *dev, struct request *req,
+		struct dma_unmap_batch *batch)
 {
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 
 	if (iod->dma_len) {
-		dma_unmap_page(dev->dev, iod->first_dma, iod->dma_len,
-			       rq_dma_dir(req));
+		nvme_unmap_page(dev, req, batch, iod->first_dma, iod->dma_len);
 		return;
 	}
 
@@ -863,7 +874,7 @@ static blk_status_t nvme_prep_rq(struct nvme_dev *dev, struct request *req)
 	nvme_start_request(req);
 	return BLK_STS_OK;
 out_unmap_data:
-	nvme_unmap_data(dev, req);
+	nvme_unmap_data(dev, req, NULL);
 out_free_cmd:
 	nvme_cleanup_cmd(req);
 	return ret;
@@ -959,7 +970,8 @@ static void nvme_queue_rqs(struct request **rqlist)
 	*rqlist = requeue_list;
 }
 
-static __always_inline void nvme_pci_unmap_rq(struct request *req)
+static __always_inline void nvme_pci_unmap_rq(struct request *req,
+		struct dma_unmap_batch *batch)
 {
 	struct nvme_queue *nvmeq = req->mq_hctx->driver_data;
 	struct nvme_dev *dev = nvmeq->dev;
@@ -967,17 +979,17 @@ static __always_inline void nvme_pci_unmap_rq(struct request *req)
 	if (blk_integrity_rq(req)) {
 	        struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 
-		dma_unmap_page(dev->dev, iod->meta_dma,
-			       rq_integrity_vec(req)->bv_len, rq_dma_dir(req));
+		nvme_unmap_page(dev, req, batch, iod->meta_dma,
+				rq_integrity_vec(req)->bv_len);
 	}
 
 	if (blk_rq_nr_phys_segments(req))
-		nvme_unmap_data(dev, req);
+		nvme_unmap_data(dev, req, batch);
 }
 
 static void nvme_pci_complete_rq(struct request *req)
 {
-	nvme_pci_unmap_rq(req);
+	nvme_pci_unmap_rq(req, NULL);
 	nvme_complete_rq(req);
 }
 
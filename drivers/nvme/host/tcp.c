@@ -31,6 +31,14 @@ static int so_priority;
 module_param(so_priority, int, 0644);
 MODULE_PARM_DESC(so_priority, "nvme tcp socket optimize priority");
 
+/* Move a queue's io_work to the cpu the NIC steers its receive traffic to
+ * (RSS/aRFS), so that the socket, its receive queue and the io_work stay
+ * cache hot on one cpu instead of bouncing to a blindly assigned one.
+ */
+static bool follow_rx_cpu;
+module_param(follow_rx_cpu, bool, 0644);
+MODULE_PARM_DESC(follow_rx_cpu, "run queue io_work on the cpu receiving its traffic");
+
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 /* lockdep can detect a circular dependency of the form
  *   sk_lock -> mmap_lock (page fault) -> fs locks -> sk_lock
@@ -926,8 +934,12 @@ static void nvme_tcp_data_ready(struct sock *sk)
 	read_lock_bh(&sk->sk_callback_lock);
 	queue = sk->sk_user_data;
 	if (likely(queue && queue->rd_enabled) &&
-	    !test_bit(NVME_TCP_Q_POLLING, &queue->flags))
+	    !test_bit(NVME_TCP_Q_POLLING, &queue->flags)) {
+		/* io_work is non-reentrant, so it can move between cpus */
+		if (follow_rx_cpu)
+			WRITE_ONCE(queue->io_cpu, smp_processor_id());
 		queue_work_on(queue->io_cpu, nvme_tcp_wq, &queue->io_work);
+	}
 	read_unlock_bh(&sk->sk_callback_lock);
 }
 
@@ -35,6 +35,18 @@ static int link_up_timeout = 500;
 module_param(link_up_timeout, int, 0644);
 MODULE_PARM_DESC(link_up_timeout, "PCIe link training timeout in milliseconds");
 
+static bool aspm = true;
+module_param(aspm, bool, 0644);
+MODULE_PARM_DESC(aspm, "Enable ASPM L1 on root port links");
+
+static bool aspm_l1ss;
+module_param(aspm_l1ss, bool, 0644);
+MODULE_PARM_DESC(aspm_l1ss, "Also enable L1 PM substates (requires CLKREQ#)");
+
+static unsigned int aspm_disable_ports;
+module_param(aspm_disable_ports, uint, 0644);
+MODULE_PARM_DESC(aspm_disable_ports, "Bitmask of port indices kept in L0");
+
 #define CORE_RC_PHYIF_CTL		0x00024
 #define   CORE_RC_PHYIF_CTL_RUN		BIT(0)
 #define CORE_RC_PHYIF_STAT		0x00028
@@ -263,18 +275,85 @@ static struct irq_chip apple_msi_bottom_chip = {
 	.irq_compose_msi_msg	= apple_msi_compose_msg,
 };
 
+/*
+ * The MSI vectors are shared between all ports. Each port gets a preferred
+ * slice of them so that single vectors allocated on one port do not
+ * fragment the space another port needs for aligned multi-MSI blocks.
+ * Ports borrow from the whole range once their slice is exhausted.
+ */
+static void apple_msi_port_pool(struct apple_pcie *pcie, struct device *dev,
+				unsigned int *start, unsigned int *end)
+{
+	struct apple_pcie_port *port;
+	struct pci_dev *port_pdev;
+	unsigned int nr_ports = 0, pool = 0, size;
+	bool found = false;
+
+	*start = 0;
+	*end = pcie->nvecs;
+
+	if (!dev || !dev_is_pci(dev))
+		return;
+
+	port_pdev = pcie_find_root_port(to_pci_dev(dev));
+	if (!port_pdev)
+		return;
+
+	list_for_each_entry(port, &pcie->ports, entry) {
+		if (port->idx == PCI_SLOT(port_pdev->devfn)) {
+			pool = nr_ports;
+			found = true;
+		}
+		nr_ports++;
+	}
+
+	if (!found || nr_ports < 2)
+		return;
+
+	size = rounddown_pow_of_two(pcie->nvecs / nr_ports);
+	if (!size)
+		return;
+
+	*start = pool * size;
+	*end = *start + size;
+}
+
+static int apple_msi_alloc_region(struct apple_pcie *pcie, struct device *dev,
+				  unsigned int order)
+{
+	unsigned int start, end, nr = 1 << order;
+	unsigned long hwirq;
+
+	lockdep_assert_held(&pcie->lock);
+
+	apple_msi_port_pool(pcie, dev, &start, &end);
+
+	hwirq = bitmap_find_next_zero_area(pcie->bitmap, end, start, nr,
+					   nr - 1);
+	if (hwirq >= end)
+		return bitmap_find_free_region(pcie->bitmap, pcie->nvecs,
+					       order);
+
+	bitmap_set(pcie->bitmap, hwirq, nr);
+	return hwirq;
+}
+
 static int apple_msi_domain_alloc(struct irq_domain *domain, unsigned int virq,
 				  unsigned int nr_irqs, void *args)
 {
 	struct apple_pcie *pcie = domain->host_data;
 	struct irq_fwspec fwspec = pcie->fwspec;
+	msi_alloc_info_t *info = args;
+	struct device *dev = NULL;
 	unsigned int i;
 	int ret, hwirq;
 
+	if (info && info->desc)
+		dev = msi_desc_to_dev(info->desc);
+
 	mutex_lock(&pcie->lock);
 
-	hwirq = bitmap_find_free_region(pcie->bitmap, pcie->nvecs,
-					order_base_2(nr_irqs));
+	hwirq = apple_msi_alloc_region(pcie, dev, order_base_2(nr_irqs));
 
 	mutex_unlock(&pcie->lock);
 
@@ -886,6 +965,35 @@ static void apple_pcie_release_device(struct apple_pcie_port *port,
 	mutex_unlock(&port->pcie->lock);
 }
 
+/*
+ * Nothing configures ASPM before the kernel runs, so the ASPM core leaves all
+ * links in L0. Enable L1 (and optionally its substates) on the link below the
+ * root port once the link state exists, i.e. before a driver binds. The ASPM
+ * core still checks the exit latencies against what the endpoint accepts.
+ * L0s is left off, its frequent exits cost more than it saves.
+ */
+static void apple_pcie_enable_aspm(struct apple_pcie_port *port,
+				   struct pci_dev *pdev)
+{
+	int state = PCIE_LINK_STATE_L1;
+
+	if (!aspm || !pci_is_pcie(pdev) || !pdev->bus->self ||
+	    pci_pcie_type(pdev->bus->self) != PCI_EXP_TYPE_ROOT_PORT)
+		return;
+
+	if (aspm_disable_ports & BIT(port->idx)) {
+		pci_disable_link_state(pdev, PCIE_LINK_STATE_ALL);
+		return;
+	}
+
+	if (aspm_l1ss)
+		state |= PCIE_LINK_STATE_L1_1 | PCIE_LINK_STATE_L1_2 |
+			 PCIE_LINK_STATE_L1_1_PCIPM | PCIE_LINK_STATE_L1_2_PCIPM;
+
+	if (pci_enable_link_state(pdev, state))
+		dev_dbg(&pdev->dev, "failed to enable ASPM\n");
+}
+
 static int apple_pcie_bus_notifier(struct notifier_block *nb,
 				   unsigned long action,
 				   void *data)
@@ -911,6 +1019,9 @@ static int apple_pcie_bus_notifier(struct notifier_block *nb,
 		if (err)
 			return notifier_from_errno(err);
 		break;
+	case BUS_NOTIFY_BIND_DRIVER:
+		apple_pcie_enable_aspm(port, pdev);
+		break;
 	case BUS_NOTIFY_DEL_DEVICE:
 		apple_pcie_release_device(port, pdev);
 		break;
@@ -1018,6 +1129,7 @@ static struct platform_driver apple_pcie_driver = {
 		.name			= "pcie-apple",
 		.of_match_table		= apple_pcie_of_match,
 		.suppress_bind_attrs	= true,
+		.probe_type		= PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 module_platform_driver(apple_pcie_driver);
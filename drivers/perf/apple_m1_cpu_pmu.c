@@ -28,9 +28,10 @@
 #define ONLY_5_6_7			(BIT(5) | BIT(6) | BIT(7))
 
 /*
- * Description of the events we actually know about, as well as those with
- * a specific counter affinity. Yes, this is a grand total of two known
- * counters, and the rest is anybody's guess.
+ * Description of the events we know about, as well as those with a
+ * specific counter affinity. The names follow the ones used by Apple's
+ * own tooling (kpep), which is where most of them were learnt from; the
+ * few that remain UNKNOWN have an observed affinity but no known meaning.
  *
  * Not all counters can count all events. Counters #0 and #1 are wired to
  * count cycles and instructions respectively, and some events have
@@ -38,55 +39,90 @@
  * restrictions equally apply to both P and E cores.
  *
  * It is worth noting that the PMUs attached to P and E cores are likely
- * to be different because the underlying uarches are different. At the
- * moment, we don't really need to distinguish between the two because we
- * know next to nothing about the events themselves, and we already have
- * per cpu-type PMU abstractions.
+ * to be different because the underlying uarches are different. So far
+ * the event numbers have turned out to be identical on both, and we
+ * already have per cpu-type PMU abstractions.
  *
  * If we eventually find out that the events are different across
  * implementations, we'll have to introduce per cpu-type tables.
+ *
+ * Events with a _NONSPEC suffix only count on the architectural path
+ * (retired instructions), the others also count speculative work.
  */
 enum m1_pmu_events {
-	M1_PMU_PERFCTR_UNKNOWN_01	= 0x01,
-	M1_PMU_PERFCTR_CPU_CYCLES	= 0x02,
-	M1_PMU_PERFCTR_INSTRUCTIONS	= 0x8c,
-	M1_PMU_PERFCTR_UNKNOWN_8d	= 0x8d,
-	M1_PMU_PERFCTR_UNKNOWN_8e	= 0x8e,
-	M1_PMU_PERFCTR_UNKNOWN_8f	= 0x8f,
-	M1_PMU_PERFCTR_UNKNOWN_90	= 0x90,
-	M1_PMU_PERFCTR_UNKNOWN_93	= 0x93,
-	M1_PMU_PERFCTR_UNKNOWN_94	= 0x94,
-	M1_PMU_PERFCTR_UNKNOWN_95	= 0x95,
-	M1_PMU_PERFCTR_UNKNOWN_96	= 0x96,
-	M1_PMU_PERFCTR_UNKNOWN_97	= 0x97,
-	M1_PMU_PERFCTR_UNKNOWN_98	= 0x98,
-	M1_PMU_PERFCTR_UNKNOWN_99	= 0x99,
-	M1_PMU_PERFCTR_UNKNOWN_9a	= 0x9a,
-	M1_PMU_PERFCTR_UNKNOWN_9b	= 0x9b,
-	M1_PMU_PERFCTR_UNKNOWN_9c	= 0x9c,
-	M1_PMU_PERFCTR_UNKNOWN_9f	= 0x9f,
-	M1_PMU_PERFCTR_UNKNOWN_bf	= 0xbf,
-	M1_PMU_PERFCTR_UNKNOWN_c0	= 0xc0,
-	M1_PMU_PERFCTR_UNKNOWN_c1	= 0xc1,
-	M1_PMU_PERFCTR_UNKNOWN_c4	= 0xc4,
-	M1_PMU_PERFCTR_UNKNOWN_c5	= 0xc5,
-	M1_PMU_PERFCTR_UNKNOWN_c6	= 0xc6,
-	M1_PMU_PERFCTR_UNKNOWN_c8	= 0xc8,
-	M1_PMU_PERFCTR_UNKNOWN_ca	= 0xca,
-	M1_PMU_PERFCTR_UNKNOWN_cb	= 0xcb,
-	M1_PMU_PERFCTR_UNKNOWN_f5	= 0xf5,
-	M1_PMU_PERFCTR_UNKNOWN_f6	= 0xf6,
-	M1_PMU_PERFCTR_UNKNOWN_f7	= 0xf7,
-	M1_PMU_PERFCTR_UNKNOWN_f8	= 0xf8,
-	M1_PMU_PERFCTR_UNKNOWN_fd	= 0xfd,
-	M1_PMU_PERFCTR_LAST		= M1_PMU_CFG_EVENT,
+	M1_PMU_PERFCTR_RETIRE_UOP				= 0x01,
+	M1_PMU_PERFCTR_CORE_ACTIVE_CYCLE			= 0x02,
+	M1_PMU_PERFCTR_L1I_TLB_FILL				= 0x04,
+	M1_PMU_PERFCTR_L1D_TLB_FILL				= 0x05,
+	M1_PMU_PERFCTR_MMU_TABLE_WALK_INSTRUCTION		= 0x07,
+	M1_PMU_PERFCTR_MMU_TABLE_WALK_DATA			= 0x08,
+	M1_PMU_PERFCTR_L2_TLB_MISS_INSTRUCTION			= 0x0a,
+	M1_PMU_PERFCTR_L2_TLB_MISS_DATA				= 0x0b,
+	M1_PMU_PERFCTR_MMU_VIRTUAL_MEMORY_FAULT_NONSPEC		= 0x0d,
+	M1_PMU_PERFCTR_SCHEDULE_UOP				= 0x52,
+	M1_PMU_PERFCTR_INTERRUPT_PENDING			= 0x6c,
+	M1_PMU_PERFCTR_MAP_STALL_DISPATCH			= 0x70,
+	M1_PMU_PERFCTR_MAP_REWIND				= 0x75,
+	M1_PMU_PERFCTR_MAP_STALL				= 0x76,
+	M1_PMU_PERFCTR_MAP_INT_UOP				= 0x7c,
+	M1_PMU_PERFCTR_MAP_LDST_UOP				= 0x7d,
+	M1_PMU_PERFCTR_MAP_SIMD_UOP				= 0x7e,
+	M1_PMU_PERFCTR_FLUSH_RESTART_OTHER_NONSPEC		= 0x84,
+	M1_PMU_PERFCTR_INST_ALL					= 0x8c,
+	M1_PMU_PERFCTR_INST_BRANCH				= 0x8d,
+	M1_PMU_PERFCTR_INST_BRANCH_CALL				= 0x8e,
+	M1_PMU_PERFCTR_INST_BRANCH_RET				= 0x8f,
+	M1_PMU_PERFCTR_INST_BRANCH_TAKEN			= 0x90,
+	M1_PMU_PERFCTR_INST_BRANCH_INDIR			= 0x93,
+	M1_PMU_PERFCTR_INST_BRANCH_COND				= 0x94,
+	M1_PMU_PERFCTR_INST_INT_LD				= 0x95,
+	M1_PMU_PERFCTR_INST_INT_ST				= 0x96,
+	M1_PMU_PERFCTR_INST_INT_ALU				= 0x97,
+	M1_PMU_PERFCTR_INST_SIMD_LD				= 0x98,
+	M1_PMU_PERFCTR_INST_SIMD_ST				= 0x99,
+	M1_PMU_PERFCTR_INST_SIMD_ALU				= 0x9a,
+	M1_PMU_PERFCTR_INST_LDST				= 0x9b,
+	M1_PMU_PERFCTR_INST_BARRIER				= 0x9c,
+	M1_PMU_PERFCTR_UNKNOWN_9f				= 0x9f,
+	M1_PMU_PERFCTR_L1D_TLB_ACCESS				= 0xa0,
+	M1_PMU_PERFCTR_L1D_TLB_MISS				= 0xa1,
+	M1_PMU_PERFCTR_L1D_CACHE_MISS_ST			= 0xa2,
+	M1_PMU_PERFCTR_L1D_CACHE_MISS_LD			= 0xa3,
+	M1_PMU_PERFCTR_LD_UNIT_UOP				= 0xa6,
+	M1_PMU_PERFCTR_ST_UNIT_UOP				= 0xa7,
+	M1_PMU_PERFCTR_L1D_CACHE_WRITEBACK			= 0xa8,
+	M1_PMU_PERFCTR_LDST_X64_UOP				= 0xb1,
+	M1_PMU_PERFCTR_LDST_XPG_UOP				= 0xb2,
+	M1_PMU_PERFCTR_ATOMIC_OR_EXCLUSIVE_SUCC			= 0xb3,
+	M1_PMU_PERFCTR_ATOMIC_OR_EXCLUSIVE_FAIL			= 0xb4,
+	M1_PMU_PERFCTR_L1D_CACHE_MISS_LD_NONSPEC		= 0xbf,
+	M1_PMU_PERFCTR_L1D_CACHE_MISS_ST_NONSPEC		= 0xc0,
+	M1_PMU_PERFCTR_L1D_TLB_MISS_NONSPEC			= 0xc1,
+	M1_PMU_PERFCTR_ST_MEMORY_ORDER_VIOLATION_NONSPEC	= 0xc4,
+	M1_PMU_PERFCTR_BRANCH_COND_MISPRED_NONSPEC		= 0xc5,
+	M1_PMU_PERFCTR_BRANCH_INDIR_MISPRED_NONSPEC		= 0xc6,
+	M1_PMU_PERFCTR_BRANCH_RET_INDIR_MISPRED_NONSPEC		= 0xc8,
+	M1_PMU_PERFCTR_BRANCH_CALL_INDIR_MISPRED_NONSPEC	= 0xca,
+	M1_PMU_PERFCTR_BRANCH_MISPRED_NONSPEC			= 0xcb,
+	M1_PMU_PERFCTR_L1I_TLB_MISS_DEMAND			= 0xd4,
+	M1_PMU_PERFCTR_MAP_DISPATCH_BUBBLE			= 0xd6,
+	M1_PMU_PERFCTR_L1I_CACHE_MISS_DEMAND			= 0xdb,
+	M1_PMU_PERFCTR_FETCH_RESTART				= 0xde,
+	M1_PMU_PERFCTR_ST_NT_UOP				= 0xe5,
+	M1_PMU_PERFCTR_LD_NT_UOP				= 0xe6,
+	M1_PMU_PERFCTR_UNKNOWN_f5				= 0xf5,
+	M1_PMU_PERFCTR_UNKNOWN_f6				= 0xf6,
+	M1_PMU_PERFCTR_UNKNOWN_f7				= 0xf7,
+	M1_PMU_PERFCTR_UNKNOWN_f8				= 0xf8,
+	M1_PMU_PERFCTR_UNKNOWN_fd				= 0xfd,
+	M1_PMU_PERFCTR_LAST					= M1_PMU_CFG_EVENT,
 
 	/*
 	 * From this point onwards, these are not actual HW events,
 	 * but attributes that get stored in hw->config_base.
 	 */
-	M1_PMU_CFG_COUNT_USER		= BIT(8),
-	M1_PMU_CFG_COUNT_KERNEL		= BIT(9),
+	M1_PMU_CFG_COUNT_USER					= BIT(8),
+	M1_PMU_CFG_COUNT_KERNEL					= BIT(9),
 };
 
 /*
@@ -96,46 +132,74 @@ enum m1_pmu_events {
  * counters had strange affinities.
  */
 static const u16 m1_pmu_event_affinity[M1_PMU_PERFCTR_LAST + 1] = {
-	[0 ... M1_PMU_PERFCTR_LAST]	= ANY_BUT_0_1,
-	[M1_PMU_PERFCTR_UNKNOWN_01]	= BIT(7),
-	[M1_PMU_PERFCTR_CPU_CYCLES]	= ANY_BUT_0_1 | BIT(0),
-	[M1_PMU_PERFCTR_INSTRUCTIONS]	= BIT(7) | BIT(1),
-	[M1_PMU_PERFCTR_UNKNOWN_8d]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_8e]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_8f]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_90]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_93]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_94]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_95]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_96]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_97]	= BIT(7),
-	[M1_PMU_PERFCTR_UNKNOWN_98]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_99]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_9a]	= BIT(7),
-	[M1_PMU_PERFCTR_UNKNOWN_9b]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_9c]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_9f]	= BIT(7),
-	[M1_PMU_PERFCTR_UNKNOWN_bf]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_c0]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_c1]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_c4]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_c5]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_c6]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_c8]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_ca]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_cb]	= ONLY_5_6_7,
-	[M1_PMU_PERFCTR_UNKNOWN_f5]	= ONLY_2_4_6,
-	[M1_PMU_PERFCTR_UNKNOWN_f6]	= ONLY_2_4_6,
-	[M1_PMU_PERFCTR_UNKNOWN_f7]	= ONLY_2_4_6,
-	[M1_PMU_PERFCTR_UNKNOWN_f8]	= ONLY_2_TO_7,
-	[M1_PMU_PERFCTR_UNKNOWN_fd]	= ONLY_2_4_6,
+	[0 ... M1_PMU_PERFCTR_LAST]				= ANY_BUT_0_1,
+	[M1_PMU_PERFCTR_RETIRE_UOP]				= BIT(7),
+	[M1_PMU_PERFCTR_CORE_ACTIVE_CYCLE]			= ANY_BUT_0_1 | BIT(0),
+	[M1_PMU_PERFCTR_INST_ALL]				= BIT(7) | BIT(1),
+	[M1_PMU_PERFCTR_INST_BRANCH]				= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_BRANCH_CALL]			= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_BRANCH_RET]			= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_BRANCH_TAKEN]			= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_BRANCH_INDIR]			= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_BRANCH_COND]			= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_INT_LD]				= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_INT_ST]				= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_INT_ALU]				= BIT(7),
+	[M1_PMU_PERFCTR_INST_SIMD_LD]				= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_SIMD_ST]				= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_SIMD_ALU]				= BIT(7),
+	[M1_PMU_PERFCTR_INST_LDST]				= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_INST_BARRIER]				= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_UNKNOWN_9f]				= BIT(7),
+	[M1_PMU_PERFCTR_L1D_CACHE_MISS_LD_NONSPEC]		= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_L1D_CACHE_MISS_ST_NONSPEC]		= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_L1D_TLB_MISS_NONSPEC]			= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_ST_MEMORY_ORDER_VIOLATION_NONSPEC]	= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_BRANCH_COND_MISPRED_NONSPEC]		= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_BRANCH_INDIR_MISPRED_NONSPEC]		= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_BRANCH_RET_INDIR_MISPRED_NONSPEC]	= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_BRANCH_CALL_INDIR_MISPRED_NONSPEC]	= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_BRANCH_MISPRED_NONSPEC]			= ONLY_5_6_7,
+	[M1_PMU_PERFCTR_UNKNOWN_f5]				= ONLY_2_4_6,
+	[M1_PMU_PERFCTR_UNKNOWN_f6]				= ONLY_2_4_6,
+	[M1_PMU_PERFCTR_UNKNOWN_f7]				= ONLY_2_4_6,
+	[M1_PMU_PERFCTR_UNKNOWN_f8]				= ONLY_2_TO_7,
+	[M1_PMU_PERFCTR_UNKNOWN_fd]				= ONLY_2_4_6,
 };
 
 static const unsigned m1_pmu_perf_map[PERF_COUNT_HW_MAX] = {
 	PERF_MAP_ALL_UNSUPPORTED,
-	[PERF_COUNT_HW_CPU_CYCLES]	= M1_PMU_PERFCTR_CPU_CYCLES,
-	[PERF_COUNT_HW_INSTRUCTIONS]	= M1_PMU_PERFCTR_INSTRUCTIONS,
-	/* No idea about the rest yet */
+	[PERF_COUNT_HW_CPU_CYCLES]		= M1_PMU_PERFCTR_CORE_ACTIVE_CYCLE,
+	[PERF_COUNT_HW_INSTRUCTIONS]		= M1_PMU_PERFCTR_INST_ALL,
+	[PERF_COUNT_HW_BRANCH_INSTRUCTIONS]	= M1_PMU_PERFCTR_INST_BRANCH,
+	[PERF_COUNT_HW_BRANCH_MISSES]		= M1_PMU_PERFCTR_BRANCH_MISPRED_NONSPEC,
+	[PERF_COUNT_HW_STALLED_CYCLES_FRONTEND]	= M1_PMU_PERFCTR_MAP_DISPATCH_BUBBLE,
+	[PERF_COUNT_HW_STALLED_CYCLES_BACKEND]	= M1_PMU_PERFCTR_MAP_STALL,
+};
+
+/*
+ * There is no known event for the cluster-shared L2, so only the
+ * per-core caches and TLBs are described here.
+ */
+static const unsigned m1_pmu_cache_map[PERF_COUNT_HW_CACHE_MAX]
+				      [PERF_COUNT_HW_CACHE_OP_MAX]
+				      [PERF_COUNT_HW_CACHE_RESULT_MAX] = {
+	PERF_CACHE_MAP_ALL_UNSUPPORTED,
+
+	[C(L1D)][C(OP_READ)][C(RESULT_ACCESS)]	= M1_PMU_PERFCTR_LD_UNIT_UOP,
+	[C(L1D)][C(OP_READ)][C(RESULT_MISS)]	= M1_PMU_PERFCTR_L1D_CACHE_MISS_LD,
+	[C(L1D)][C(OP_WRITE)][C(RESULT_ACCESS)]	= M1_PMU_PERFCTR_ST_UNIT_UOP,
+	[C(L1D)][C(OP_WRITE)][C(RESULT_MISS)]	= M1_PMU_PERFCTR_L1D_CACHE_MISS_ST,
+
+	[C(L1I)][C(OP_READ)][C(RESULT_MISS)]	= M1_PMU_PERFCTR_L1I_CACHE_MISS_DEMAND,
+
+	[C(DTLB)][C(OP_READ)][C(RESULT_ACCESS)]	= M1_PMU_PERFCTR_L1D_TLB_ACCESS,
+	[C(DTLB)][C(OP_READ)][C(RESULT_MISS)]	= M1_PMU_PERFCTR_L1D_TLB_MISS,
+
+	[C(ITLB)][C(OP_READ)][C(RESULT_MISS)]	= M1_PMU_PERFCTR_L1I_TLB_MISS_DEMAND,
+
+	[C(BPU)][C(OP_READ)][C(RESULT_ACCESS)]	= M1_PMU_PERFCTR_INST_BRANCH,
+	[C(BPU)][C(OP_READ)][C(RESULT_MISS)]	= M1_PMU_PERFCTR_BRANCH_MISPRED_NONSPEC,
 };
 
 /* sysfs definitions */
@@ -154,8 +218,67 @@ static ssize_t m1_pmu_events_sysfs_show(struct device *dev,
 	PMU_EVENT_ATTR_ID(name, m1_pmu_events_sysfs_show, config)
 
 static struct attribute *m1_pmu_event_attrs[] = {
-	M1_PMU_EVENT_ATTR(cycles, M1_PMU_PERFCTR_CPU_CYCLES),
-	M1_PMU_EVENT_ATTR(instructions, M1_PMU_PERFCTR_INSTRUCTIONS),
+	M1_PMU_EVENT_ATTR(cycles, M1_PMU_PERFCTR_CORE_ACTIVE_CYCLE),
+	M1_PMU_EVENT_ATTR(instructions, M1_PMU_PERFCTR_INST_ALL),
+	M1_PMU_EVENT_ATTR(retire_uop, M1_PMU_PERFCTR_RETIRE_UOP),
+	M1_PMU_EVENT_ATTR(core_active_cycle, M1_PMU_PERFCTR_CORE_ACTIVE_CYCLE),
+	M1_PMU_EVENT_ATTR(l1i_tlb_fill, M1_PMU_PERFCTR_L1I_TLB_FILL),
+	M1_PMU_EVENT_ATTR(l1d_tlb_fill, M1_PMU_PERFCTR_L1D_TLB_FILL),
+	M1_PMU_EVENT_ATTR(mmu_table_walk_instruction, M1_PMU_PERFCTR_MMU_TABLE_WALK_INSTRUCTION),
+	M1_PMU_EVENT_ATTR(mmu_table_walk_data, M1_PMU_PERFCTR_MMU_TABLE_WALK_DATA),
+	M1_PMU_EVENT_ATTR(l2_tlb_miss_instruction, M1_PMU_PERFCTR_L2_TLB_MISS_INSTRUCTION),
+	M1_PMU_EVENT_ATTR(l2_tlb_miss_data, M1_PMU_PERFCTR_L2_TLB_MISS_DATA),
+	M1_PMU_EVENT_ATTR(mmu_virtual_memory_fault_nonspec, M1_PMU_PERFCTR_MMU_VIRTUAL_MEMORY_FAULT_NONSPEC),
+	M1_PMU_EVENT_ATTR(schedule_uop, M1_PMU_PERFCTR_SCHEDULE_UOP),
+	M1_PMU_EVENT_ATTR(interrupt_pending, M1_PMU_PERFCTR_INTERRUPT_PENDING),
+	M1_PMU_EVENT_ATTR(map_stall_dispatch, M1_PMU_PERFCTR_MAP_STALL_DISPATCH),
+	M1_PMU_EVENT_ATTR(map_rewind, M1_PMU_PERFCTR_MAP_REWIND),
+	M1_PMU_EVENT_ATTR(map_stall, M1_PMU_PERFCTR_MAP_STALL),
+	M1_PMU_EVENT_ATTR(map_int_uop, M1_PMU_PERFCTR_MAP_INT_UOP),
+	M1_PMU_EVENT_ATTR(map_ldst_uop, M1_PMU_PERFCTR_MAP_LDST_UOP),
+	M1_PMU_EVENT_ATTR(map_simd_uop, M1_PMU_PERFCTR_MAP_SIMD_UOP),
+	M1_PMU_EVENT_ATTR(flush_restart_other_nonspec, M1_PMU_PERFCTR_FLUSH_RESTART_OTHER_NONSPEC),
+	M1_PMU_EVENT_ATTR(inst_all, M1_PMU_PERFCTR_INST_ALL),
+	M1_PMU_EVENT_ATTR(inst_branch, M1_PMU_PERFCTR_INST_BRANCH),
+	M1_PMU_EVENT_ATTR(inst_branch_call, M1_PMU_PERFCTR_INST_BRANCH_CALL),
+	M1_PMU_EVENT_ATTR(inst_branch_ret, M1_PMU_PERFCTR_INST_BRANCH_RET),
+	M1_PMU_EVENT_ATTR(inst_branch_taken, M1_PMU_PERFCTR_INST_BRANCH_TAKEN),
+	M1_PMU_EVENT_ATTR(inst_branch_indir, M1_PMU_PERFCTR_INST_BRANCH_INDIR),
+	M1_PMU_EVENT_ATTR(inst_branch_cond, M1_PMU_PERFCTR_INST_BRANCH_COND),
+	M1_PMU_EVENT_ATTR(inst_int_ld, M1_PMU_PERFCTR_INST_INT_LD),
+	M1_PMU_EVENT_ATTR(inst_int_st, M1_PMU_PERFCTR_INST_INT_ST),
+	M1_PMU_EVENT_ATTR(inst_int_alu, M1_PMU_PERFCTR_INST_INT_ALU),
+	M1_PMU_EVENT_ATTR(inst_simd_ld, M1_PMU_PERFCTR_INST_SIMD_LD),
+	M1_PMU_EVENT_ATTR(inst_simd_st, M1_PMU_PERFCTR_INST_SIMD_ST),
+	M1_PMU_EVENT_ATTR(inst_simd_alu, M1_PMU_PERFCTR_INST_SIMD_ALU),
+	M1_PMU_EVENT_ATTR(inst_ldst, M1_PMU_PERFCTR_INST_LDST),
+	M1_PMU_EVENT_ATTR(inst_barrier, M1_PMU_PERFCTR_INST_BARRIER),
+	M1_PMU_EVENT_ATTR(l1d_tlb_access, M1_PMU_PERFCTR_L1D_TLB_ACCESS),
+	M1_PMU_EVENT_ATTR(l1d_tlb_miss, M1_PMU_PERFCTR_L1D_TLB_MISS),
+	M1_PMU_EVENT_ATTR(l1d_cache_miss_st, M1_PMU_PERFCTR_L1D_CACHE_MISS_ST),
+	M1_PMU_EVENT_ATTR(l1d_cache_miss_ld, M1_PMU_PERFCTR_L1D_CACHE_MISS_LD),
+	M1_PMU_EVENT_ATTR(ld_unit_uop, M1_PMU_PERFCTR_LD_UNIT_UOP),
+	M1_PMU_EVENT_ATTR(st_unit_uop, M1_PMU_PERFCTR_ST_UNIT_UOP),
+	M1_PMU_EVENT_ATTR(l1d_cache_writeback, M1_PMU_PERFCTR_L1D_CACHE_WRITEBACK),
+	M1_PMU_EVENT_ATTR(ldst_x64_uop, M1_PMU_PERFCTR_LDST_X64_UOP),
+	M1_PMU_EVENT_ATTR(ldst_xpg_uop, M1_PMU_PERFCTR_LDST_XPG_UOP),
+	M1_PMU_EVENT_ATTR(atomic_or_exclusive_succ, M1_PMU_PERFCTR_ATOMIC_OR_EXCLUSIVE_SUCC),
+	M1_PMU_EVENT_ATTR(atomic_or_exclusive_fail, M1_PMU_PERFCTR_ATOMIC_OR_EXCLUSIVE_FAIL),
+	M1_PMU_EVENT_ATTR(l1d_cache_miss_ld_nonspec, M1_PMU_PERFCTR_L1D_CACHE_MISS_LD_NONSPEC),
+	M1_PMU_EVENT_ATTR(l1d_cache_miss_st_nonspec, M1_PMU_PERFCTR_L1D_CACHE_MISS_ST_NONSPEC),
+	M1_PMU_EVENT_ATTR(l1d_tlb_miss_nonspec, M1_PMU_PERFCTR_L1D_TLB_MISS_NONSPEC),
+	M1_PMU_EVENT_ATTR(st_memory_order_violation_nonspec, M1_PMU_PERFCTR_ST_MEMORY_ORDER_VIOLATION_NONSPEC),
+	M1_PMU_EVENT_ATTR(branch_cond_mispred_nonspec, M1_PMU_PERFCTR_BRANCH_COND_MISPRED_NONSPEC),
+	M1_PMU_EVENT_ATTR(branch_indir_mispred_nonspec, M1_PMU_PERFCTR_BRANCH_INDIR_MISPRED_NONSPEC),
+	M1_PMU_EVENT_ATTR(branch_ret_indir_mispred_nonspec, M1_PMU_PERFCTR_BRANCH_RET_INDIR_MISPRED_NONSPEC),
+	M1_PMU_EVENT_ATTR(branch_call_indir_mispred_nonspec, M1_PMU_PERFCTR_BRANCH_CALL_INDIR_MISPRED_NONSPEC),
+	M1_PMU_EVENT_ATTR(branch_mispred_nonspec, M1_PMU_PERFCTR_BRANCH_MISPRED_NONSPEC),
+	M1_PMU_EVENT_ATTR(l1i_tlb_miss_demand, M1_PMU_PERFCTR_L1I_TLB_MISS_DEMAND),
+	M1_PMU_EVENT_ATTR(map_dispatch_bubble, M1_PMU_PERFCTR_MAP_DISPATCH_BUBBLE),
+	M1_PMU_EVENT_ATTR(l1i_cache_miss_demand, M1_PMU_PERFCTR_L1I_CACHE_MISS_DEMAND),
+	M1_PMU_EVENT_ATTR(fetch_restart, M1_PMU_PERFCTR_FETCH_RESTART),
+	M1_PMU_EVENT_ATTR(st_nt_uop, M1_PMU_PERFCTR_ST_NT_UOP),
+	M1_PMU_EVENT_ATTR(ld_nt_uop, M1_PMU_PERFCTR_LD_NT_UOP),
 	NULL,
 };
 
@@ -482,26 +605,53 @@ static void m1_pmu_stop(struct arm_pmu *cpu_pmu)
 	__m1_pmu_set_mode(PMCR0_IMODE_OFF);
 }
 
+/*
+ * There is no PEBS/SPE-like facility: samples are taken from the FIQ
+ * handler and carry the usual interrupt skid. Say so rather than
+ * pretending, so that tools fall back to a non-precise event.
+ */
+static int m1_pmu_check_event(struct perf_event *event)
+{
+	if (event->attr.precise_ip)
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
 static int m1_pmu_map_event(struct perf_event *event)
 {
+	int ret;
+
+	ret = m1_pmu_check_event(event);
+	if (ret)
+		return ret;
+
 	/*
 	 * Although the counters are 48bit wide, bit 47 is what
 	 * triggers the overflow interrupt. Advertise the counters
 	 * being 47bit wide to mimick the behaviour of the ARM PMU.
 	 */
 	event->hw.flags |= ARMPMU_EVT_47BIT;
-	return armpmu_map_event(event, &m1_pmu_perf_map, NULL, M1_PMU_CFG_EVENT);
+	return armpmu_map_event(event, &m1_pmu_perf_map, &m1_pmu_cache_map,
+				M1_PMU_CFG_EVENT);
 }
 
 static int m2_pmu_map_event(struct perf_event *event)
 {
+	int ret;
+
+	ret = m1_pmu_check_event(event);
+	if (ret)
+		return ret;
+
 	/*
 	 * Same deal as the above, except that M2 has 64bit counters.
 	 * Which, as far as we're concerned, actually means 63 bits.
 	 * Yes, this is getting awkward.
 	 */
 	event->hw.flags |= ARMPMU_EVT_63BIT;
-	return armpmu_map_event(event, &m1_pmu_perf_map, NULL, M1_PMU_CFG_EVENT);
+	return armpmu_map_event(event, &m1_pmu_perf_map, &m1_pmu_cache_map,
+				M1_PMU_CFG_EVENT);
 }
 
 static void m1_pmu_reset(void *info)
@@ -11,6 +11,7 @@
 
 #include <dt-bindings/phy/phy.h>
 #include <linux/bitfield.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/iopoll.h>
 #include <linux/module.h>
@@ -27,6 +28,11 @@
 #include <linux/usb/typec_mux.h>
 #include <linux/usb/typec_tbt.h>
 
+static unsigned int off_grace_ms = 1000;
+module_param(off_grace_ms, uint, 0644);
+MODULE_PARM_DESC(off_grace_ms,
+		 "Keep the PHY powered this long after unplug to speed up re-plug (0 disables)");
+
 #define rcdev_to_apple_atcphy(_rcdev) \
 	container_of(_rcdev, struct apple_atcphy, rcdev)
 
@@ -1531,12 +1537,36 @@ static int atcphy_cio_configure(struct apple_atcphy *atcphy,
 
 	BUG_ON(!mutex_is_locked(&atcphy->lock));
 
+	cancel_delayed_work(&atcphy->cio_off_work);
+
+	/*
+	 * Still powered from a recent unplug: if the same mode and
+	 * orientation come back the PLLs and tunables are already set up and
+	 * only the lanes need to be brought back. Tunables of different modes
+	 * touch overlapping registers, so anything else gets a power cycle.
+	 */
+	if (atcphy->cio_powered && atcphy->tunables_mode == mode &&
+	    atcphy->tunables_swapped == atcphy->swap_lanes) {
+		atcphy->fast_reconfigs++;
+		goto configure_lanes;
+	}
+
+	if (atcphy->cio_powered) {
+		atcphy->cio_powered = false;
+		ret = atcphy_cio_power_off(atcphy);
+		if (ret)
+			return ret;
+	}
+
 	ret = atcphy_cio_power_on(atcphy);
 	if (ret)
 		return ret;
+	atcphy->cio_powered = true;
 
 	atcphy_setup_pll_fuses(atcphy);
 	atcphy_apply_tunables(atcphy, mode);
+	atcphy->tunables_mode = mode;
+	atcphy->tunables_swapped = atcphy->swap_lanes;
 
 	// TODO: without this sometimes device aren't recognized but no idea what it does
 	// ACIOPHY_PLL_TOP_BLK_AUSPLL_PCTL_FSM_CTRL1.APB_REQ_OV_SEL = 255
@@ -1548,6 +1578,7 @@ static int atcphy_cio_configure(struct apple_atcphy *atcphy,
 	writel(0x15570cff, atcphy->regs.core + 0x1b0); // ACIOPHY_SLEEP_CTRL
 	writel(0x11833fef, atcphy->regs.core + 0x8); // ACIOPHY_CFG0
 
+configure_lanes:
 	/* enable clocks and configure lanes */
 	core_set32(atcphy, CIO3PLL_CLK_CTRL, CIO3PLL_CLK_PCLK_EN);
 	core_set32(atcphy, CIO3PLL_CLK_CTRL, CIO3PLL_CLK_REFCLK_EN);
@@ -2004,13 +2035,36 @@ static void atcphy_mux_set_work(struct work_struct *work)
 	case APPLE_ATCPHY_MODE_OFF:
 		atcphy->mode = APPLE_ATCPHY_MODE_OFF;
 		atcphy_disable_dp_aux(atcphy);
-		atcphy_cio_power_off(atcphy);
+		if (atcphy->cio_powered && off_grace_ms) {
+			/* lanes off and in reset, PLLs and tunables kept */
+			atcphy_configure_lanes(atcphy, APPLE_ATCPHY_MODE_OFF);
+			core_clear32(atcphy, ATCPHY_POWER_CTRL,
+				     ATCPHY_POWER_PHY_RESET_N);
+			schedule_delayed_work(&atcphy->cio_off_work,
+					      msecs_to_jiffies(off_grace_ms));
+		} else {
+			atcphy->cio_powered = false;
+			atcphy_cio_power_off(atcphy);
+		}
 	}
 
 	complete(&atcphy->atcphy_online_event);
 	mutex_unlock(&atcphy->lock);
 }
 
+static void atcphy_cio_off_work(struct work_struct *work)
+{
+	struct apple_atcphy *atcphy =
+		container_of(work, struct apple_atcphy, cio_off_work.work);
+
+	mutex_lock(&atcphy->lock);
+	if (atcphy->mode == APPLE_ATCPHY_MODE_OFF && atcphy->cio_powered) {
+		atcphy->cio_powered = false;
+		atcphy_cio_power_off(atcphy);
+	}
+	mutex_unlock(&atcphy->lock);
+}
+
 static int atcphy_mux_set(struct typec_mux_dev *mux,
 			  struct typec_mux_state *state)
 {
@@ -2072,6 +2126,73 @@ static int atcphy_probe_mux(struct apple_atcphy *atcphy)
 	return PTR_ERR_OR_ZERO(typec_mux_register(atcphy->dev, &mux_desc));
 }
 
+static const char *const atcphy_mode_names[] = {
+	[APPLE_ATCPHY_MODE_OFF] = "off",
+	[APPLE_ATCPHY_MODE_USB2] = "usb2",
+	[APPLE_ATCPHY_MODE_USB3] = "usb3",
+	[APPLE_ATCPHY_MODE_USB3_DP] = "usb3+dp",
+	[APPLE_ATCPHY_MODE_USB4] = "usb4",
+	[APPLE_ATCPHY_MODE_DP] = "dp",
+};
+
+static const char *const atcphy_lane_mode_names[] = {
+	[ACIOPHY_LANE_MODE_USB4] = "usb4",
+	[ACIOPHY_LANE_MODE_USB3] = "usb3",
+	[ACIOPHY_LANE_MODE_DP] = "dp",
+	[ACIOPHY_LANE_MODE_OFF] = "off",
+};
+
+static const char *atcphy_lane_mode_name(u32 mode)
+{
+	if (mode < ARRAY_SIZE(atcphy_lane_mode_names))
+		return atcphy_lane_mode_names[mode];
+	return "?";
+}
+
+static int atcphy_state_show(struct seq_file *s, void *data)
+{
+	struct apple_atcphy *atcphy = s->private;
+	u32 lanes;
+
+	mutex_lock(&atcphy->lock);
+
+	seq_printf(s, "mode: %s\n", atcphy_mode_names[atcphy->mode]);
+	seq_printf(s, "target mode: %s\n",
+		   atcphy_mode_names[atcphy->target_mode]);
+	seq_printf(s, "orientation: %s\n",
+		   atcphy->swap_lanes ? "reverse" : "normal");
+	seq_printf(s, "cio powered: %d\n", atcphy->cio_powered);
+	seq_printf(s, "dwc3 online: %d\n", atcphy->dwc3_online);
+	seq_printf(s, "pipehandler: %d\n", atcphy->pipehandler_state);
+	seq_printf(s, "dp link rate: %d\n", atcphy->dp_link_rate);
+	seq_printf(s, "fast reconfigs: %llu\n", atcphy->fast_reconfigs);
+
+	if (atcphy->cio_powered) {
+		lanes = readl(atcphy->regs.core + ACIOPHY_LANE_MODE);
+		seq_printf(s, "lane0: rx %s tx %s\n",
+			   atcphy_lane_mode_name(FIELD_GET(ACIOPHY_LANE_MODE_RX0, lanes)),
+			   atcphy_lane_mode_name(FIELD_GET(ACIOPHY_LANE_MODE_TX0, lanes)));
+		seq_printf(s, "lane1: rx %s tx %s\n",
+			   atcphy_lane_mode_name(FIELD_GET(ACIOPHY_LANE_MODE_RX1, lanes)),
+			   atcphy_lane_mode_name(FIELD_GET(ACIOPHY_LANE_MODE_TX1, lanes)));
+		seq_printf(s, "crossbar: 0x%08x\n",
+			   readl(atcphy->regs.core + ACIOPHY_CROSSBAR));
+	}
+
+	mutex_unlock(&atcphy->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(atcphy_state);
+
+static void atcphy_teardown(void *data)
+{
+	struct apple_atcphy *atcphy = data;
+
+	debugfs_remove_recursive(atcphy->debugfs);
+	cancel_delayed_work_sync(&atcphy->cio_off_work);
+}
+
 static int atcphy_parse_legacy_tunable(struct apple_atcphy *atcphy,
 				       struct atcphy_tunable *tunable,
 				       const char *name)
@@ -2331,6 +2452,7 @@ static int atcphy_probe(struct platform_device *pdev)
 	init_completion(&atcphy->dwc3_shutdown_event);
 	init_completion(&atcphy->atcphy_online_event);
 	INIT_WORK(&atcphy->mux_set_work, atcphy_mux_set_work);
+	INIT_DELAYED_WORK(&atcphy->cio_off_work, atcphy_cio_off_work);
 
 	atcphy->regs.core = devm_platform_ioremap_resource_byname(pdev, "core");
 	if (IS_ERR(atcphy->regs.core))
@@ -2365,6 +2487,14 @@ static int atcphy_probe(struct platform_device *pdev)
 	atcphy->mode = APPLE_ATCPHY_MODE_OFF;
 	atcphy->pipehandler_state = ATCPHY_PIPEHANDLER_STATE_INVALID;
 
+	atcphy->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+	debugfs_create_file("state", 0444, atcphy->debugfs, atcphy,
+			    &atcphy_state_fops);
+
+	ret = devm_add_action_or_reset(dev, atcphy_teardown, atcphy);
+	if (ret)
+		return ret;
+
 	ret = atcphy_probe_rcdev(atcphy);
 	if (ret)
 		return ret;
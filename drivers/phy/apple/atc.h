@@ -108,6 +108,18 @@ struct apple_atcphy {
 	enum atcphy_mode mode;
 	int dp_link_rate;
 
+	/*
+	 * CIO power and the mode/orientation whose tunables are currently
+	 * applied, so re-plugging within the power-off grace period can skip
+	 * the power cycle and PLL/tunable setup.
+	 */
+	bool cio_powered;
+	enum atcphy_mode tunables_mode;
+	bool tunables_swapped;
+	u64 fast_reconfigs;
+	struct delayed_work cio_off_work;
+	struct dentry *debugfs;
+
 	struct {
 		void __iomem *core;
 		void __iomem *axi2af;
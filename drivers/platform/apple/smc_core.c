@@ -6,11 +6,30 @@
 
 #include <linux/bitfield.h>
 #include <linux/device.h>
+#include <linux/hash.h>
+#include <linux/jiffies.h>
 #include <linux/mfd/core.h>
 #include <linux/mutex.h>
 #include <linux/notifier.h>
+#include <linux/spinlock.h>
 #include "smc.h"
 
+#define SMC_CACHE_BITS		6
+#define SMC_CACHE_SIZE		BIT(SMC_CACHE_BITS)
+#define SMC_CACHE_MAX_VALUE	8
+
+/*
+ * Direct-mapped cache of recently read small keys, used by
+ * apple_smc_read_cached() and apple_smc_read_multi().
+ */
+struct apple_smc_cache_entry {
+	smc_key key;
+	u8 size;
+	bool valid;
+	unsigned long stamp;
+	u8 data[SMC_CACHE_MAX_VALUE];
+};
+
 struct apple_smc {
 	struct device *dev;
 
@@ -19,6 +38,9 @@ struct apple_smc {
 
 	struct mutex mutex;
 
+	spinlock_t cache_lock;
+	struct apple_smc_cache_entry cache[SMC_CACHE_SIZE];
+
 	u32 key_count;
 	smc_key first_key;
 	smc_key last_key;
@@ -33,6 +55,9 @@ static const struct mfd_cell apple_smc_devs[] = {
 	{
 		.name = "macsmc-hid",
 	},
+	{
+		.name = "macsmc-iio",
+	},
 	{
 		.name = "macsmc-power",
 	},
@@ -44,6 +69,76 @@ static const struct mfd_cell apple_smc_devs[] = {
 	},
 };
 
+static struct apple_smc_cache_entry *apple_smc_cache_slot(struct apple_smc *smc,
+							  smc_key key)
+{
+	return &smc->cache[hash_32(key, SMC_CACHE_BITS)];
+}
+
+static bool apple_smc_cache_get(struct apple_smc *smc, smc_key key, void *buf,
+				size_t size, unsigned int max_age_ms, int *ret)
+{
+	struct apple_smc_cache_entry *entry = apple_smc_cache_slot(smc, key);
+	unsigned long flags;
+	bool hit;
+
+	spin_lock_irqsave(&smc->cache_lock, flags);
+	hit = entry->valid && entry->key == key && entry->size == size &&
+	      time_before(jiffies, entry->stamp + msecs_to_jiffies(max_age_ms));
+	if (hit) {
+		memcpy(buf, entry->data, size);
+		*ret = size;
+	}
+	spin_unlock_irqrestore(&smc->cache_lock, flags);
+
+	return hit;
+}
+
+static void apple_smc_cache_put(struct apple_smc *smc, smc_key key,
+				const void *buf, size_t size)
+{
+	struct apple_smc_cache_entry *entry = apple_smc_cache_slot(smc, key);
+	unsigned long flags;
+
+	spin_lock_irqsave(&smc->cache_lock, flags);
+	entry->key = key;
+	entry->size = size;
+	entry->stamp = jiffies;
+	memcpy(entry->data, buf, size);
+	entry->valid = true;
+	spin_unlock_irqrestore(&smc->cache_lock, flags);
+}
+
+static void apple_smc_cache_invalidate(struct apple_smc *smc, smc_key key)
+{
+	struct apple_smc_cache_entry *entry = apple_smc_cache_slot(smc, key);
+	unsigned long flags;
+
+	spin_lock_irqsave(&smc->cache_lock, flags);
+	if (entry->key == key)
+		entry->valid = false;
+	spin_unlock_irqrestore(&smc->cache_lock, flags);
+}
+
+static int apple_smc_read_locked(struct apple_smc *smc, smc_key key, void *buf,
+				 size_t size, unsigned int max_age_ms)
+{
+	int ret;
+
+	lockdep_assert_held(&smc->mutex);
+
+	/* someone else might have refreshed the key while we were waiting */
+	if (max_age_ms && size <= SMC_CACHE_MAX_VALUE &&
+	    apple_smc_cache_get(smc, key, buf, size, max_age_ms, &ret))
+		return ret;
+
+	ret = smc->be->read_key(smc->be_cookie, key, buf, size);
+	if (max_age_ms && ret == size && size <= SMC_CACHE_MAX_VALUE)
+		apple_smc_cache_put(smc, key, buf, size);
+
+	return ret;
+}
+
 int apple_smc_read(struct apple_smc *smc, smc_key key, void *buf, size_t size)
 {
 	int ret;
@@ -61,6 +156,7 @@ int apple_smc_write(struct apple_smc *smc, smc_key key, void *buf, size_t size)
 	int ret;
 
 	mutex_lock(&smc->mutex);
+	apple_smc_cache_invalidate(smc, key);
 	ret = smc->be->write_key(smc->be_cookie, key, buf, size);
 	mutex_unlock(&smc->mutex);
 
@@ -79,6 +175,7 @@ int apple_smc_write_atomic(struct apple_smc *smc, smc_key key, void *buf, size_t
 	if (!mutex_trylock(&smc->mutex))
 		return -EBUSY;
 
+	apple_smc_cache_invalidate(smc, key);
 	ret = smc->be->write_key_atomic(smc->be_cookie, key, buf, size);
 	mutex_unlock(&smc->mutex);
 
@@ -92,6 +189,7 @@ int apple_smc_rw(struct apple_smc *smc, smc_key key, void *wbuf, size_t wsize,
 	int ret;
 
 	mutex_lock(&smc->mutex);
+	apple_smc_cache_invalidate(smc, key);
 	ret = smc->be->rw_key(smc->be_cookie, key, wbuf, wsize, rbuf, rsize);
 	mutex_unlock(&smc->mutex);
 
@@ -99,16 +197,83 @@ int apple_smc_rw(struct apple_smc *smc, smc_key key, void *wbuf, size_t wsize,
 }
 EXPORT_SYMBOL(apple_smc_rw);
 
-int apple_smc_read_f32_scaled(struct apple_smc *smc, smc_key key, int *p, int scale)
+/*
+ * Read a key, returning a cached value if it was read less than max_age_ms
+ * ago. Only values of up to SMC_CACHE_MAX_VALUE bytes are cached, this is
+ * meant for sensors and other read-mostly keys that are polled frequently.
+ * Writes through this API invalidate the cached value.
+ */
+int apple_smc_read_cached(struct apple_smc *smc, smc_key key, void *buf,
+			  size_t size, unsigned int max_age_ms)
 {
-	u32 fval;
-	u64 val;
-	int ret, exp;
+	int ret;
 
-	ret = apple_smc_read_u32(smc, key, &fval);
-	if (ret < 0)
+	if (max_age_ms && size <= SMC_CACHE_MAX_VALUE &&
+	    apple_smc_cache_get(smc, key, buf, size, max_age_ms, &ret))
 		return ret;
 
+	mutex_lock(&smc->mutex);
+	ret = apple_smc_read_locked(smc, key, buf, size, max_age_ms);
+	mutex_unlock(&smc->mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL(apple_smc_read_cached);
+
+/*
+ * Read a set of keys while holding the SMC lock only once, so other users
+ * can't interleave their commands and the whole set is read back-to-back.
+ * The result of each read is stored in reqs[i].ret. Values younger than
+ * max_age_ms are served from the cache, pass 0 to always read from the SMC.
+ *
+ * Returns the number of keys that were read successfully.
+ */
+int apple_smc_read_multi(struct apple_smc *smc, struct apple_smc_read_req *reqs,
+			 unsigned int count, unsigned int max_age_ms)
+{
+	unsigned int i, pending = 0;
+	int done = 0;
+
+	for (i = 0; i < count; i++) {
+		if (max_age_ms && reqs[i].size <= SMC_CACHE_MAX_VALUE &&
+		    apple_smc_cache_get(smc, reqs[i].key, reqs[i].buf,
+					reqs[i].size, max_age_ms, &reqs[i].ret)) {
+			done++;
+		} else {
+			reqs[i].ret = -EAGAIN;
+			pending++;
+		}
+	}
+
+	if (!pending)
+		return done;
+
+	mutex_lock(&smc->mutex);
+	for (i = 0; i < count; i++) {
+		if (reqs[i].ret != -EAGAIN)
+			continue;
+
+		reqs[i].ret = apple_smc_read_locked(smc, reqs[i].key,
+						    reqs[i].buf, reqs[i].size,
+						    max_age_ms);
+		if (reqs[i].ret >= 0)
+			done++;
+	}
+	mutex_unlock(&smc->mutex);
+
+	return done;
+}
+EXPORT_SYMBOL(apple_smc_read_multi);
+
+/*
+ * Convert a raw IEEE 754 single precision SMC value to an integer multiplied
+ * by scale (or divided by -scale if negative), saturating on overflow.
+ */
+int apple_smc_f32_to_scaled(u32 fval, int scale)
+{
+	u64 val;
+	int exp;
+
 	val = ((u64)((fval & GENMASK(22, 0)) | BIT(23)));
 	exp = ((fval >> 23) & 0xff) - 127 - 23;
 	if (scale < 0) {
@@ -132,16 +297,26 @@ int apple_smc_read_f32_scaled(struct apple_smc *smc, smc_key key, int *p, int sc
 
 	if (fval & BIT(31)) {
 		if (val > (-(s64)INT_MIN))
-			*p = INT_MIN;
-		else
-			*p = -val;
-	} else {
-		if (val > INT_MAX)
-			*p = INT_MAX;
-		else
-			*p = val;
+			return INT_MIN;
+		return -val;
 	}
 
+	if (val > INT_MAX)
+		return INT_MAX;
+	return val;
+}
+EXPORT_SYMBOL(apple_smc_f32_to_scaled);
+
+int apple_smc_read_f32_scaled(struct apple_smc *smc, smc_key key, int *p, int scale)
+{
+	u32 fval;
+	int ret;
+
+	ret = apple_smc_read_u32(smc, key, &fval);
+	if (ret < 0)
+		return ret;
+
+	*p = apple_smc_f32_to_scaled(fval, scale);
 	return ret;
 }
 EXPORT_SYMBOL(apple_smc_read_f32_scaled);
@@ -250,6 +425,7 @@ int apple_smc_probe(struct device *dev, const struct apple_smc_backend_ops *ops,
 	smc->be_cookie = cookie;
 	smc->be = ops;
 	mutex_init(&smc->mutex);
+	spin_lock_init(&smc->cache_lock);
 	BLOCKING_INIT_NOTIFIER_HEAD(&smc->event_handlers);
 
 	ret = apple_smc_read_u32(smc, SMC_KEY(#KEY), &count);
@@ -440,6 +440,7 @@ static struct platform_driver apple_smc_rtkit_driver = {
 		.name = "macsmc-rtkit",
 		.owner = THIS_MODULE,
 		.of_match_table = apple_smc_rtkit_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = apple_smc_rtkit_probe,
 	.remove = apple_smc_rtkit_remove,
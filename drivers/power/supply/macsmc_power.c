@@ -13,10 +13,31 @@
 #include <linux/power_supply.h>
 #include <linux/reboot.h>
 #include <linux/delay.h>
+#include <linux/spinlock.h>
 #include <linux/workqueue.h>
 
 #define MAX_STRING_LENGTH 256
 
+struct macsmc_cached_prop {
+	unsigned long stamp;
+	int intval;
+	int ret;
+	bool valid;
+	bool pinned;
+};
+
+/*
+ * Property values last read from the SMC. Entries expire after cache_ms and
+ * are dropped early whenever the SMC tells us something about the charger
+ * changed. Design values that never change are pinned after the first read.
+ */
+struct macsmc_prop_cache {
+	spinlock_t lock;
+	const enum power_supply_property *props;
+	size_t num_props;
+	struct macsmc_cached_prop *vals;
+};
+
 struct macsmc_power {
 	struct device *dev;
 	struct apple_smc *smc;
@@ -30,6 +51,9 @@ struct macsmc_power {
 
 	struct power_supply *ac;
 
+	struct macsmc_prop_cache batt_cache;
+	struct macsmc_prop_cache ac_cache;
+
 	struct notifier_block nb;
 
 	struct work_struct critical_work;
@@ -51,6 +75,10 @@ MODULE_PARM_DESC(log_power, "Periodically log power consumption for debugging");
 
 #define POWER_LOG_INTERVAL (HZ)
 
+static unsigned int cache_ms = 1000;
+module_param(cache_ms, uint, 0644);
+MODULE_PARM_DESC(cache_ms, "Maximum age in msecs of cached SMC readings (0 = disable)");
+
 static struct macsmc_power *g_power;
 
 #define CHNC_BATTERY_FULL	BIT(0)
@@ -296,11 +324,104 @@ static int macsmc_battery_get_capacity_level(struct macsmc_power *power)
 		return POWER_SUPPLY_CAPACITY_LEVEL_UNKNOWN;
 }
 
-static int macsmc_battery_get_property(struct power_supply *psy,
-				       enum power_supply_property psp,
-				       union power_supply_propval *val)
+static struct macsmc_cached_prop *macsmc_cache_find(struct macsmc_prop_cache *cache,
+						     enum power_supply_property psp)
+{
+	size_t i;
+
+	/* String properties live in struct macsmc_power already */
+	if (psp >= POWER_SUPPLY_PROP_MODEL_NAME)
+		return NULL;
+
+	for (i = 0; i < cache->num_props; i++)
+		if (cache->props[i] == psp)
+			return &cache->vals[i];
+
+	return NULL;
+}
+
+static bool macsmc_cache_lookup(struct macsmc_prop_cache *cache,
+				enum power_supply_property psp,
+				union power_supply_propval *val, int *ret)
+{
+	unsigned long ttl = msecs_to_jiffies(READ_ONCE(cache_ms));
+	struct macsmc_cached_prop *c = macsmc_cache_find(cache, psp);
+	bool hit = false;
+
+	if (!c)
+		return false;
+
+	spin_lock(&cache->lock);
+	if (c->valid && (c->pinned || (ttl && time_before(jiffies, c->stamp + ttl)))) {
+		val->intval = c->intval;
+		*ret = c->ret;
+		hit = true;
+	}
+	spin_unlock(&cache->lock);
+
+	return hit;
+}
+
+static void macsmc_cache_store(struct macsmc_prop_cache *cache,
+			       enum power_supply_property psp,
+			       const union power_supply_propval *val, int ret,
+			       bool pin)
+{
+	struct macsmc_cached_prop *c = macsmc_cache_find(cache, psp);
+
+	if (!c)
+		return;
+
+	spin_lock(&cache->lock);
+	c->stamp = jiffies;
+	c->intval = val->intval;
+	c->ret = ret;
+	c->valid = true;
+	c->pinned = pin && !ret;
+	spin_unlock(&cache->lock);
+}
+
+static void macsmc_cache_invalidate(struct macsmc_prop_cache *cache)
+{
+	size_t i;
+
+	spin_lock(&cache->lock);
+	for (i = 0; i < cache->num_props; i++)
+		if (!cache->vals[i].pinned)
+			cache->vals[i].valid = false;
+	spin_unlock(&cache->lock);
+}
+
+static int macsmc_cache_init(struct device *dev, struct macsmc_prop_cache *cache,
+			     const enum power_supply_property *props,
+			     size_t num_props)
+{
+	spin_lock_init(&cache->lock);
+	cache->props = props;
+	cache->num_props = num_props;
+	cache->vals = devm_kcalloc(dev, num_props, sizeof(*cache->vals), GFP_KERNEL);
+
+	return cache->vals ? 0 : -ENOMEM;
+}
+
+static bool macsmc_battery_prop_is_constant(enum power_supply_property psp)
+{
+	switch (psp) {
+	case POWER_SUPPLY_PROP_VOLTAGE_MIN_DESIGN:
+	case POWER_SUPPLY_PROP_CHARGE_TERM_CURRENT:
+	case POWER_SUPPLY_PROP_CONSTANT_CHARGE_CURRENT_MAX:
+	case POWER_SUPPLY_PROP_CONSTANT_CHARGE_VOLTAGE:
+	case POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static int macsmc_battery_read_property(struct macsmc_power *power,
+					enum power_supply_property psp,
+					union power_supply_propval *val)
 {
-	struct macsmc_power *power = power_supply_get_drvdata(psy);
 	int ret = 0;
 	u8 vu8;
 	u16 vu16;
@@ -434,15 +555,35 @@ static int macsmc_battery_get_property(struct power_supply *psy,
 	return ret;
 }
 
+static int macsmc_battery_get_property(struct power_supply *psy,
+				       enum power_supply_property psp,
+				       union power_supply_propval *val)
+{
+	struct macsmc_power *power = power_supply_get_drvdata(psy);
+	int ret;
+
+	if (macsmc_cache_lookup(&power->batt_cache, psp, val, &ret))
+		return ret;
+
+	ret = macsmc_battery_read_property(power, psp, val);
+	if (ret != -EINVAL)
+		macsmc_cache_store(&power->batt_cache, psp, val, ret,
+				   macsmc_battery_prop_is_constant(psp));
+
+	return ret;
+}
+
 static int macsmc_battery_set_property(struct power_supply *psy,
 				       enum power_supply_property psp,
 				       const union power_supply_propval *val)
 {
 	struct macsmc_power *power = power_supply_get_drvdata(psy);
+	int ret;
 
 	switch (psp) {
 	case POWER_SUPPLY_PROP_CHARGE_BEHAVIOUR:
-		return macsmc_battery_set_charge_behaviour(power, val->intval);
+		ret = macsmc_battery_set_charge_behaviour(power, val->intval);
+		break;
 	case POWER_SUPPLY_PROP_CHARGE_CONTROL_START_THRESHOLD:
 		/*
 		 * Ignore, we allow writes so userspace isn't confused but this is
@@ -451,11 +592,16 @@ static int macsmc_battery_set_property(struct power_supply *psy,
 		 */
 		return 0;
 	case POWER_SUPPLY_PROP_CHARGE_CONTROL_END_THRESHOLD:
-		return apple_smc_write_flag(power->smc, SMC_KEY(CHWA),
-					    val->intval <= CHWA_PROP_WRITE_THRESHOLD);
+		ret = apple_smc_write_flag(power->smc, SMC_KEY(CHWA),
+					   val->intval <= CHWA_PROP_WRITE_THRESHOLD);
+		break;
 	default:
 		return -EINVAL;
 	}
+
+	/* Charge control feeds into the status, so drop everything */
+	macsmc_cache_invalidate(&power->batt_cache);
+	return ret;
 }
 
 static int macsmc_battery_property_is_writeable(struct power_supply *psy,
@@ -517,11 +663,10 @@ static const struct power_supply_desc macsmc_battery_desc = {
 	.num_properties		= ARRAY_SIZE(macsmc_battery_props),
 };
 
-static int macsmc_ac_get_property(struct power_supply *psy,
-				       enum power_supply_property psp,
-				       union power_supply_propval *val)
+static int macsmc_ac_read_property(struct macsmc_power *power,
+				   enum power_supply_property psp,
+				   union power_supply_propval *val)
 {
-	struct macsmc_power *power = power_supply_get_drvdata(psy);
 	int ret = 0;
 	u16 vu16;
 	u32 vu32;
@@ -550,6 +695,23 @@ static int macsmc_ac_get_property(struct power_supply *psy,
 	return ret;
 }
 
+static int macsmc_ac_get_property(struct power_supply *psy,
+				       enum power_supply_property psp,
+				       union power_supply_propval *val)
+{
+	struct macsmc_power *power = power_supply_get_drvdata(psy);
+	int ret;
+
+	if (macsmc_cache_lookup(&power->ac_cache, psp, val, &ret))
+		return ret;
+
+	ret = macsmc_ac_read_property(power, psp, val);
+	if (ret != -EINVAL)
+		macsmc_cache_store(&power->ac_cache, psp, val, ret, false);
+
+	return ret;
+}
+
 static enum power_supply_property macsmc_ac_props[] = {
 	POWER_SUPPLY_PROP_ONLINE,
 	POWER_SUPPLY_PROP_VOLTAGE_NOW,
@@ -651,11 +813,14 @@ static int macsmc_power_event(struct notifier_block *nb, unsigned long event, vo
 		bool charging = (event & 0xff) != 0;
 
 		dev_info(power->dev, "Charging: %d\n", charging);
+		macsmc_cache_invalidate(&power->batt_cache);
+		macsmc_cache_invalidate(&power->ac_cache);
 		power_supply_changed(power->batt);
 		power_supply_changed(power->ac);
 
 		return NOTIFY_OK;
 	} else if (event == 0x71020000) {
+		macsmc_cache_invalidate(&power->batt_cache);
 		schedule_work(&power->critical_work);
 
 		return NOTIFY_OK;
@@ -669,6 +834,8 @@ static int macsmc_power_event(struct notifier_block *nb, unsigned long event, vo
 				 changed_port + 1, cur_port);
 		}
 
+		macsmc_cache_invalidate(&power->batt_cache);
+		macsmc_cache_invalidate(&power->ac_cache);
 		power_supply_changed(power->batt);
 		power_supply_changed(power->ac);
 
@@ -728,6 +895,16 @@ static int macsmc_power_probe(struct platform_device *pdev)
 	/* Doing one read of this flag enables critical shutdown notifications */
 	apple_smc_read_u32(power->smc, SMC_KEY(BCF0), &val);
 
+	ret = macsmc_cache_init(&pdev->dev, &power->batt_cache, power->batt_desc.properties,
+				power->batt_desc.num_properties);
+	if (ret)
+		return ret;
+
+	ret = macsmc_cache_init(&pdev->dev, &power->ac_cache, macsmc_ac_desc.properties,
+				macsmc_ac_desc.num_properties);
+	if (ret)
+		return ret;
+
 	psy_cfg.drv_data = power;
 	power->batt = devm_power_supply_register(&pdev->dev, &power->batt_desc, &psy_cfg);
 	if (IS_ERR(power->batt)) {
@@ -7,7 +7,9 @@
 
 #include <linux/bitops.h>
 #include <linux/bitfield.h>
+#include <linux/debugfs.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/platform_device.h>
@@ -16,6 +18,7 @@
 #include <linux/mfd/syscon.h>
 #include <linux/reset-controller.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 
 #define APPLE_PMGR_RESET        BIT(31)
 #define APPLE_PMGR_AUTO_ENABLE  BIT(28)
@@ -45,8 +48,24 @@ struct apple_pmgr_ps {
 	u32 offset;
 	u32 min_state;
 	u32 pre_state;
+
+	/* transition timing, in ns, updated under the genpd lock */
+	struct {
+		u64 on_count;
+		u64 off_count;
+		u64 on_last;
+		u64 on_max;
+		u64 on_total;
+		u64 off_last;
+		u64 off_max;
+		u64 timeouts;
+	} stats;
+	struct dentry *debugfs;
 };
 
+static struct dentry *apple_pmgr_ps_debugfs_root;
+static DEFINE_MUTEX(apple_pmgr_ps_debugfs_lock);
+
 #define genpd_to_apple_pmgr_ps(_genpd) container_of(_genpd, struct apple_pmgr_ps, genpd)
 #define rcdev_to_apple_pmgr_ps(_rcdev) container_of(_rcdev, struct apple_pmgr_ps, rcdev)
 
@@ -106,21 +125,66 @@ static bool apple_pmgr_ps_is_active(struct apple_pmgr_ps *ps)
 
 static int apple_pmgr_ps_power_on(struct generic_pm_domain *genpd)
 {
-	return apple_pmgr_ps_set(genpd, APPLE_PMGR_PS_ACTIVE, true);
+	struct apple_pmgr_ps *ps = genpd_to_apple_pmgr_ps(genpd);
+	u64 start = ktime_get_ns(), delta;
+	int ret;
+
+	ret = apple_pmgr_ps_set(genpd, APPLE_PMGR_PS_ACTIVE, true);
+
+	delta = ktime_get_ns() - start;
+	ps->stats.on_count++;
+	ps->stats.on_last = delta;
+	ps->stats.on_max = max(ps->stats.on_max, delta);
+	ps->stats.on_total += delta;
+	if (ret)
+		ps->stats.timeouts++;
+
+	return ret;
 }
 
 static int apple_pmgr_ps_power_off(struct generic_pm_domain *genpd)
 {
 	// FIXME please makes this better
 	struct apple_pmgr_ps *ps = genpd_to_apple_pmgr_ps(genpd);
+	u64 start = ktime_get_ns(), delta;
+	int ret = 0;
+
 	if (ps->pre_state != APPLE_PMGR_PS_PWRGATE) {
 		u32 reg;
 		regmap_read(ps->regmap, ps->offset, &reg);
 		regmap_write(ps->regmap, ps->offset, reg | ps->pre_state);
 		regmap_write(ps->regmap, ps->offset, APPLE_PMGR_PS_PWRGATE);
-		return 0;
+	} else {
+		ret = apple_pmgr_ps_set(genpd, APPLE_PMGR_PS_PWRGATE, false);
 	}
-	return apple_pmgr_ps_set(genpd, APPLE_PMGR_PS_PWRGATE, false);
+
+	delta = ktime_get_ns() - start;
+	ps->stats.off_count++;
+	ps->stats.off_last = delta;
+	ps->stats.off_max = max(ps->stats.off_max, delta);
+	if (ret)
+		ps->stats.timeouts++;
+
+	return ret;
+}
+
+static void apple_pmgr_ps_debugfs_init(struct apple_pmgr_ps *ps)
+{
+	mutex_lock(&apple_pmgr_ps_debugfs_lock);
+	if (!apple_pmgr_ps_debugfs_root)
+		apple_pmgr_ps_debugfs_root = debugfs_create_dir("apple_pmgr_pwrstate", NULL);
+	mutex_unlock(&apple_pmgr_ps_debugfs_lock);
+
+	/* Labels are only unique per PMGR instance, so key by device name */
+	ps->debugfs = debugfs_create_dir(dev_name(ps->dev), apple_pmgr_ps_debugfs_root);
+	debugfs_create_u64("on_count", 0444, ps->debugfs, &ps->stats.on_count);
+	debugfs_create_u64("off_count", 0444, ps->debugfs, &ps->stats.off_count);
+	debugfs_create_u64("on_last_ns", 0444, ps->debugfs, &ps->stats.on_last);
+	debugfs_create_u64("on_max_ns", 0444, ps->debugfs, &ps->stats.on_max);
+	debugfs_create_u64("on_total_ns", 0444, ps->debugfs, &ps->stats.on_total);
+	debugfs_create_u64("off_last_ns", 0444, ps->debugfs, &ps->stats.off_last);
+	debugfs_create_u64("off_max_ns", 0444, ps->debugfs, &ps->stats.off_max);
+	debugfs_create_u64("timeouts", 0444, ps->debugfs, &ps->stats.timeouts);
 }
 
 static int apple_pmgr_reset_assert(struct reset_controller_dev *rcdev, unsigned long id)
@@ -315,6 +379,8 @@ static int apple_pmgr_ps_probe(struct platform_device *pdev)
 	if (ret < 0)
 		goto err_remove;
 
+	apple_pmgr_ps_debugfs_init(ps);
+
 	return 0;
 err_remove:
 	of_genpd_del_provider(node);
@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: GPL-2.0-only OR MIT
+/*
+ * Apple SoC micro-benchmarks
+ *
+ * Times driver primitives that are otherwise only visible through full
+ * workloads: DMA map/unmap through the DART of a given device and SMC key
+ * reads. Everything is driven through debugfs:
+ *
+ *   /sys/kernel/debug/apple-bench/iterations	number of samples per run
+ *   /sys/kernel/debug/apple-bench/dart		write a platform device name
+ *   /sys/kernel/debug/apple-bench/smc		write a four character key
+ *   /sys/kernel/debug/apple-bench/result	histogram of the last run
+ *
+ * Copyright The Asahi Linux Contributors
+ */
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/dma-mapping.h>
+#include <linux/iommu.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/mfd/macsmc.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#define APPLE_BENCH_BUCKETS	32
+#define APPLE_BENCH_MAX_ITERS	1000000
+
+struct apple_bench_hist {
+	u64 buckets[APPLE_BENCH_BUCKETS];
+	u64 count;
+	u64 sum;
+	u64 min;
+	u64 max;
+};
+
+struct apple_bench_result {
+	char name[64];
+	int error;
+	/* the DART benchmark fills both, the SMC benchmark only the first */
+	struct apple_bench_hist hist[2];
+	const char *label[2];
+};
+
+static struct dentry *apple_bench_dir;
+static DEFINE_MUTEX(apple_bench_lock);
+static struct apple_bench_result apple_bench_last;
+static u32 apple_bench_iterations = 10000;
+
+static void apple_bench_hist_reset(struct apple_bench_hist *h)
+{
+	memset(h, 0, sizeof(*h));
+	h->min = U64_MAX;
+}
+
+static void apple_bench_hist_add(struct apple_bench_hist *h, u64 ns)
+{
+	unsigned int b = ns ? min_t(unsigned int, ilog2(ns) + 1,
+				    APPLE_BENCH_BUCKETS - 1) : 0;
+
+	h->buckets[b]++;
+	h->count++;
+	h->sum += ns;
+	h->min = min(h->min, ns);
+	h->max = max(h->max, ns);
+}
+
+static u32 apple_bench_iters(void)
+{
+	return clamp_t(u32, READ_ONCE(apple_bench_iterations), 1,
+		       APPLE_BENCH_MAX_ITERS);
+}
+
+/*
+ * Map and unmap a single page for @dev through the DMA API. With the device
+ * behind a DART this exercises apple_dart_map_pages(), apple_dart_unmap_pages()
+ * and the TLB flush issued from iotlb_sync. The mapping is never handed to the
+ * device, so this is safe on a live, bound device.
+ */
+static int apple_bench_dart(struct device *dev, struct apple_bench_result *res)
+{
+	struct apple_bench_hist *map = &res->hist[0], *unmap = &res->hist[1];
+	u32 i, iters = apple_bench_iters();
+	dma_addr_t dma;
+	ktime_t t0, t1;
+	void *buf;
+
+	if (!device_iommu_mapped(dev))
+		return -ENODEV;
+
+	buf = (void *)__get_free_page(GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	res->label[0] = "map";
+	res->label[1] = "unmap";
+
+	for (i = 0; i < iters; i++) {
+		t0 = ktime_get();
+		dma = dma_map_single(dev, buf, PAGE_SIZE, DMA_TO_DEVICE);
+		t1 = ktime_get();
+		if (dma_mapping_error(dev, dma)) {
+			free_page((unsigned long)buf);
+			return -ENOMEM;
+		}
+		apple_bench_hist_add(map, ktime_to_ns(ktime_sub(t1, t0)));
+
+		t0 = ktime_get();
+		dma_unmap_single(dev, dma, PAGE_SIZE, DMA_TO_DEVICE);
+		t1 = ktime_get();
+		apple_bench_hist_add(unmap, ktime_to_ns(ktime_sub(t1, t0)));
+
+		cond_resched();
+	}
+
+	free_page((unsigned long)buf);
+	return 0;
+}
+
+#if IS_REACHABLE(CONFIG_APPLE_SMC)
+static int apple_bench_match_any(struct device *dev, void *data)
+{
+	return 1;
+}
+
+static struct device *apple_bench_find_smc(void)
+{
+	struct device_driver *drv;
+
+	drv = driver_find("macsmc-rtkit", &platform_bus_type);
+	if (!drv)
+		return NULL;
+
+	return driver_find_device(drv, NULL, NULL, apple_bench_match_any);
+}
+
+/*
+ * The device lock is held for the whole run so that the SMC driver cannot be
+ * unbound, and its drvdata freed, while we are still reading through it.
+ */
+static int apple_bench_smc(smc_key key, struct apple_bench_result *res)
+{
+	struct apple_bench_hist *read = &res->hist[0];
+	u32 i, iters = apple_bench_iters();
+	struct apple_smc_key_info info;
+	struct apple_smc *smc;
+	struct device *dev;
+	ktime_t t0, t1;
+	u8 buf[255];
+	int ret;
+
+	dev = apple_bench_find_smc();
+	if (!dev)
+		return -ENODEV;
+
+	device_lock(dev);
+	smc = dev->driver ? dev_get_drvdata(dev) : NULL;
+	if (!smc) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	ret = apple_smc_get_key_info(smc, key, &info);
+	if (ret < 0)
+		goto out;
+	if (!(info.flags & APPLE_SMC_READABLE) || !info.size) {
+		ret = -EPERM;
+		goto out;
+	}
+
+	res->label[0] = "read";
+
+	for (i = 0; i < iters; i++) {
+		t0 = ktime_get();
+		ret = apple_smc_read(smc, key, buf, info.size);
+		t1 = ktime_get();
+		if (ret < 0)
+			goto out;
+		apple_bench_hist_add(read, ktime_to_ns(ktime_sub(t1, t0)));
+
+		cond_resched();
+	}
+	ret = 0;
+out:
+	device_unlock(dev);
+	put_device(dev);
+	return ret;
+}
+#else
+static int apple_bench_smc(smc_key key, struct apple_bench_result *res)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
+static void apple_bench_begin(struct apple_bench_result *res, const char *name)
+{
+	memset(res, 0, sizeof(*res));
+	strscpy(res->name, name, sizeof(res->name));
+	apple_bench_hist_reset(&res->hist[0]);
+	apple_bench_hist_reset(&res->hist[1]);
+}
+
+static ssize_t apple_bench_dart_write(struct file *file,
+				      const char __user *ubuf, size_t count,
+				      loff_t *ppos)
+{
+	struct device *dev;
+	char name[64];
+	int ret;
+
+	if (count >= sizeof(name))
+		return -EINVAL;
+	if (copy_from_user(name, ubuf, count))
+		return -EFAULT;
+	name[count] = '\0';
+	strim(name);
+
+	dev = bus_find_device_by_name(&platform_bus_type, NULL, name);
+	if (!dev)
+		return -ENODEV;
+
+	mutex_lock(&apple_bench_lock);
+	apple_bench_begin(&apple_bench_last, name);
+	ret = apple_bench_dart(dev, &apple_bench_last);
+	apple_bench_last.error = ret;
+	mutex_unlock(&apple_bench_lock);
+
+	put_device(dev);
+	return ret ? ret : count;
+}
+
+static const struct file_operations apple_bench_dart_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = apple_bench_dart_write,
+	.llseek = default_llseek,
+};
+
+static ssize_t apple_bench_smc_write(struct file *file,
+				     const char __user *ubuf, size_t count,
+				     loff_t *ppos)
+{
+	char name[8];
+	int ret;
+
+	if (count >= sizeof(name))
+		return -EINVAL;
+	if (copy_from_user(name, ubuf, count))
+		return -EFAULT;
+	name[count] = '\0';
+	if (count && name[count - 1] == '\n')
+		name[count - 1] = '\0';
+	if (strlen(name) != 4)
+		return -EINVAL;
+
+	mutex_lock(&apple_bench_lock);
+	apple_bench_begin(&apple_bench_last, name);
+	ret = apple_bench_smc(_SMC_KEY(name), &apple_bench_last);
+	apple_bench_last.error = ret;
+	mutex_unlock(&apple_bench_lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations apple_bench_smc_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = apple_bench_smc_write,
+	.llseek = default_llseek,
+};
+
+static void apple_bench_show_hist(struct seq_file *s, const char *label,
+				  const struct apple_bench_hist *h)
+{
+	int b;
+
+	if (!h->count)
+		return;
+
+	seq_printf(s, "%s: samples %llu min %llu avg %llu max %llu ns\n",
+		   label, h->count, h->min, div64_u64(h->sum, h->count),
+		   h->max);
+
+	for (b = 0; b < APPLE_BENCH_BUCKETS; b++) {
+		if (!h->buckets[b])
+			continue;
+		seq_printf(s, "  < %10llu ns: %llu\n",
+			   b ? 1ULL << b : 1ULL, h->buckets[b]);
+	}
+}
+
+static int apple_bench_result_show(struct seq_file *s, void *unused)
+{
+	struct apple_bench_result *res = &apple_bench_last;
+	int i;
+
+	mutex_lock(&apple_bench_lock);
+	if (!res->name[0]) {
+		mutex_unlock(&apple_bench_lock);
+		return 0;
+	}
+
+	seq_printf(s, "target: %s\n", res->name);
+	if (res->error)
+		seq_printf(s, "error: %d\n", res->error);
+	for (i = 0; i < ARRAY_SIZE(res->hist); i++)
+		if (res->label[i])
+			apple_bench_show_hist(s, res->label[i], &res->hist[i]);
+	mutex_unlock(&apple_bench_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(apple_bench_result);
+
+static int __init apple_bench_init(void)
+{
+	apple_bench_dir = debugfs_create_dir("apple-bench", NULL);
+
+	debugfs_create_u32("iterations", 0600, apple_bench_dir,
+			   &apple_bench_iterations);
+	debugfs_create_file("dart", 0200, apple_bench_dir, NULL,
+			    &apple_bench_dart_fops);
+	debugfs_create_file("smc", 0200, apple_bench_dir, NULL,
+			    &apple_bench_smc_fops);
+	debugfs_create_file("result", 0400, apple_bench_dir, NULL,
+			    &apple_bench_result_fops);
+
+	return 0;
+}
+module_init(apple_bench_init);
+
+static void __exit apple_bench_exit(void)
+{
+	debugfs_remove_recursive(apple_bench_dir);
+}
+module_exit(apple_bench_exit);
+
+MODULE_LICENSE("Dual MIT/GPL");
+MODULE_DESCRIPTION("Apple SoC driver micro-benchmarks");
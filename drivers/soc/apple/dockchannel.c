@@ -12,6 +12,7 @@
 #include <linux/irq.h>
 #include <linux/irqchip/chained_irq.h>
 #include <linux/irqdomain.h>
+#include <linux/kfifo.h>
 #include <linux/soc/apple/dockchannel.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
@@ -56,6 +57,11 @@ struct dockchannel {
 
 	void *cookie;
 	void (*data_available)(void *cookie, size_t avail);
+
+	/* Asynchronous receive mode, see dockchannel_rx_ring_start() */
+	bool ring_mode;
+	struct kfifo rx_ring;
+	u64 rx_ring_overflows;
 };
 
 struct dockchannel_common {
@@ -84,7 +90,7 @@ static irqreturn_t dockchannel_rx_irq(int irq, void *data)
 
 	disable_irq_nosync(irq);
 
-	if (dockchannel->awaiting) {
+	if (dockchannel->ring_mode || dockchannel->awaiting) {
 		return IRQ_WAKE_THREAD;
 	} else {
 		complete(&dockchannel->rx_comp);
@@ -92,11 +98,70 @@ static irqreturn_t dockchannel_rx_irq(int irq, void *data)
 	}
 }
 
+static void dockchannel_fifo_read(struct dockchannel *dockchannel, u8 *p,
+				  size_t count)
+{
+	while (count >= 4) {
+		put_unaligned_le32(readl_relaxed(dockchannel->data_base + DATA_RX32), p);
+		p += 4;
+		count -= 4;
+	}
+	while (count > 0) {
+		*p++ = readl_relaxed(dockchannel->data_base + DATA_RX8) >> 8;
+		count--;
+	}
+}
+
+/*
+ * Move everything the hardware FIFO holds into the ring, handing it to the
+ * consumer in between whenever the ring fills up.
+ */
+static void dockchannel_rx_ring_fill(struct dockchannel *dockchannel)
+{
+	struct kfifo *ring = &dockchannel->rx_ring;
+	u8 buf[64];
+
+	for (;;) {
+		size_t avail = readl_relaxed(dockchannel->data_base + DATA_RX_COUNT);
+		size_t block;
+
+		if (!avail)
+			break;
+
+		if (kfifo_is_full(ring)) {
+			dockchannel->data_available(dockchannel->cookie,
+						    kfifo_len(ring));
+			if (kfifo_is_full(ring)) {
+				dockchannel->rx_ring_overflows++;
+				dev_err_ratelimited(dockchannel->dev,
+						    "RX ring overflow, dropping %u bytes\n",
+						    kfifo_len(ring));
+				kfifo_reset(ring);
+			}
+			continue;
+		}
+
+		block = min3(avail, sizeof(buf), (size_t)kfifo_avail(ring));
+		dockchannel_fifo_read(dockchannel, buf, block);
+		kfifo_in(ring, buf, block);
+	}
+
+	if (!kfifo_is_empty(ring))
+		dockchannel->data_available(dockchannel->cookie, kfifo_len(ring));
+}
+
 static irqreturn_t dockchannel_rx_irq_thread(int irq, void *data)
 {
 	struct dockchannel *dockchannel = data;
-	size_t avail = readl_relaxed(dockchannel->data_base + DATA_RX_COUNT);
+	size_t avail;
+
+	if (dockchannel->ring_mode) {
+		dockchannel_rx_ring_fill(dockchannel);
+		enable_irq(irq);
+		return IRQ_HANDLED;
+	}
 
+	avail = readl_relaxed(dockchannel->data_base + DATA_RX_COUNT);
 	dockchannel->awaiting = false;
 	dockchannel->data_available(dockchannel->cookie, avail);
 
@@ -170,17 +235,9 @@ int dockchannel_recv(struct dockchannel *dockchannel, void *buf, size_t count)
 			continue;
 		}
 
-		while (block >= 4) {
-			put_unaligned_le32(readl_relaxed(dockchannel->data_base + DATA_RX32), p);
-			p += 4;
-			left -= 4;
-			block -= 4;
-		}
-		while (block > 0) {
-			*p++ = readl_relaxed(dockchannel->data_base + DATA_RX8) >> 8;
-			left--;
-			block--;
-		}
+		dockchannel_fifo_read(dockchannel, p, block);
+		p += block;
+		left -= block;
 	}
 
 	return count;
@@ -193,6 +250,9 @@ int dockchannel_await(struct dockchannel *dockchannel,
 {
 	size_t threshold = min((size_t)dockchannel->fifo_size, count);
 
+	if (dockchannel->ring_mode)
+		return -EBUSY;
+
 	if (!count) {
 		dockchannel->awaiting = false;
 		disable_irq(dockchannel->rx_irq);
@@ -209,6 +269,54 @@ int dockchannel_await(struct dockchannel *dockchannel,
 }
 EXPORT_SYMBOL(dockchannel_await);
 
+static void dockchannel_rx_ring_free(void *data)
+{
+	struct dockchannel *dockchannel = data;
+
+	disable_irq(dockchannel->rx_irq);
+	dockchannel->ring_mode = false;
+	kfifo_free(&dockchannel->rx_ring);
+}
+
+/*
+ * Switch the channel to asynchronous receive. From now on the RX IRQ thread
+ * drains the FIFO into a ring of ring_size bytes and calls callback with the
+ * number of buffered bytes; the callback consumes them with
+ * dockchannel_rx_ring_read() and may leave a partial message in the ring.
+ */
+int dockchannel_rx_ring_start(struct dockchannel *dockchannel, size_t ring_size,
+			      void (*callback)(void *cookie, size_t avail),
+			      void *cookie)
+{
+	int ret;
+
+	if (dockchannel->ring_mode || dockchannel->awaiting)
+		return -EBUSY;
+
+	ret = kfifo_alloc(&dockchannel->rx_ring, ring_size, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	dockchannel->data_available = callback;
+	dockchannel->cookie = cookie;
+	dockchannel->ring_mode = true;
+
+	writel_relaxed(1, dockchannel->config_base + CONFIG_RX_THRESH);
+	enable_irq(dockchannel->rx_irq);
+
+	return devm_add_action_or_reset(dockchannel->dev, dockchannel_rx_ring_free,
+					dockchannel);
+}
+EXPORT_SYMBOL(dockchannel_rx_ring_start);
+
+/* Only valid from the data_available callback of the ring. */
+size_t dockchannel_rx_ring_read(struct dockchannel *dockchannel, void *buf,
+				size_t count)
+{
+	return kfifo_out(&dockchannel->rx_ring, (u8 *)buf, count);
+}
+EXPORT_SYMBOL(dockchannel_rx_ring_read);
+
 struct dockchannel *dockchannel_init(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -73,6 +73,7 @@
 #define APPLE_MBOX_MSG1_MSG GENMASK(31, 0)
 
 #define APPLE_MBOX_TX_TIMEOUT 500
+#define APPLE_MBOX_RX_BUDGET 16
 
 struct apple_mbox_hw {
 	unsigned int control_full;
@@ -93,6 +94,51 @@ struct apple_mbox_hw {
 	unsigned int irq_bit_send_empty;
 };
 
+static bool apple_mbox_tx_full(struct apple_mbox *mbox)
+{
+	return readl_relaxed(mbox->regs + mbox->hw->a2i_control) &
+	       mbox->hw->control_full;
+}
+
+static void apple_mbox_tx_write(struct apple_mbox *mbox,
+				const struct apple_mbox_msg *msg)
+{
+	writeq_relaxed(msg->msg0, mbox->regs + mbox->hw->a2i_send0);
+	writeq_relaxed(FIELD_PREP(APPLE_MBOX_MSG1_MSG, msg->msg1),
+		       mbox->regs + mbox->hw->a2i_send1);
+}
+
+/*
+ * Move as many queued messages as possible into the A2I FIFO. Returns true
+ * once the software queue is empty.
+ */
+static bool apple_mbox_tx_fill_locked(struct apple_mbox *mbox)
+{
+	lockdep_assert_held(&mbox->tx_lock);
+
+	while (mbox->tx_head != mbox->tx_tail) {
+		if (apple_mbox_tx_full(mbox))
+			return false;
+
+		apple_mbox_tx_write(
+			mbox,
+			&mbox->tx_queue[mbox->tx_tail % APPLE_MBOX_TX_QUEUE_SIZE]);
+		mbox->tx_tail++;
+	}
+
+	return true;
+}
+
+/*
+ * Messages are written to the FIFO directly as long as it has space and
+ * nothing is queued in front of them. Otherwise they are added to a small
+ * software queue which is drained from the send-empty interrupt, so that
+ * neither atomic nor sleeping callers have to wait for the co-processor.
+ *
+ * Only when the software queue itself is full do we have to wait: Sleeping
+ * callers wait for the interrupt to make space, atomic callers poll the FIFO
+ * and drain the queue themselves.
+ */
 int apple_mbox_send(struct apple_mbox *mbox, const struct apple_mbox_msg msg,
 		    bool atomic)
 {
@@ -102,9 +148,14 @@ int apple_mbox_send(struct apple_mbox *mbox, const struct apple_mbox_msg msg,
 	long t;
 
 	spin_lock_irqsave(&mbox->tx_lock, flags);
-	mbox_ctrl = readl_relaxed(mbox->regs + mbox->hw->a2i_control);
 
-	while (mbox_ctrl & mbox->hw->control_full) {
+	if (mbox->tx_head == mbox->tx_tail && !apple_mbox_tx_full(mbox)) {
+		apple_mbox_tx_write(mbox, &msg);
+		spin_unlock_irqrestore(&mbox->tx_lock, flags);
+		return 0;
+	}
+
+	while (mbox->tx_head - mbox->tx_tail >= APPLE_MBOX_TX_QUEUE_SIZE) {
 		if (atomic) {
 			ret = readl_poll_timeout_atomic(
 				mbox->regs + mbox->hw->a2i_control, mbox_ctrl,
@@ -116,22 +167,10 @@ int apple_mbox_send(struct apple_mbox *mbox, const struct apple_mbox_msg msg,
 				return ret;
 			}
 
-			break;
-		}
-		/*
-		 * The interrupt is level triggered and will keep firing as long as the
-		 * FIFO is empty. It will also keep firing if the FIFO was empty
-		 * at any point in the past until it has been acknowledged at the
-		 * mailbox level. By acknowledging it here we can ensure that we will
-		 * only get the interrupt once the FIFO has been cleared again.
-		 * If the FIFO is already empty before the ack it will fire again
-		 * immediately after the ack.
-		 */
-		if (mbox->hw->has_irq_controls) {
-			writel_relaxed(mbox->hw->irq_bit_send_empty,
-				       mbox->regs + mbox->hw->irq_ack);
+			apple_mbox_tx_fill_locked(mbox);
+			continue;
 		}
-		enable_irq(mbox->irq_send_empty);
+
 		reinit_completion(&mbox->tx_empty);
 		spin_unlock_irqrestore(&mbox->tx_lock, flags);
 
@@ -144,12 +183,34 @@ int apple_mbox_send(struct apple_mbox *mbox, const struct apple_mbox_msg msg,
 			return -ETIMEDOUT;
 
 		spin_lock_irqsave(&mbox->tx_lock, flags);
-		mbox_ctrl = readl_relaxed(mbox->regs + mbox->hw->a2i_control);
 	}
 
-	writeq_relaxed(msg.msg0, mbox->regs + mbox->hw->a2i_send0);
-	writeq_relaxed(FIELD_PREP(APPLE_MBOX_MSG1_MSG, msg.msg1),
-		       mbox->regs + mbox->hw->a2i_send1);
+	mbox->tx_queue[mbox->tx_head % APPLE_MBOX_TX_QUEUE_SIZE] = msg;
+	mbox->tx_head++;
+
+	/* the FIFO might have drained while we were queueing */
+	if (apple_mbox_tx_fill_locked(mbox)) {
+		spin_unlock_irqrestore(&mbox->tx_lock, flags);
+		return 0;
+	}
+
+	if (!mbox->tx_irq_enabled) {
+		/*
+		 * The interrupt is level triggered and will keep firing as long
+		 * as the FIFO is empty. It will also keep firing if the FIFO was
+		 * empty at any point in the past until it has been acknowledged
+		 * at the mailbox level. By acknowledging it here we can ensure
+		 * that we will only get the interrupt once the FIFO has been
+		 * cleared again. If the FIFO is already empty before the ack it
+		 * will fire again immediately after the ack.
+		 */
+		if (mbox->hw->has_irq_controls) {
+			writel_relaxed(mbox->hw->irq_bit_send_empty,
+				       mbox->regs + mbox->hw->irq_ack);
+		}
+		mbox->tx_irq_enabled = true;
+		enable_irq(mbox->irq_send_empty);
+	}
 
 	spin_unlock_irqrestore(&mbox->tx_lock, flags);
 
@@ -161,22 +222,34 @@ static irqreturn_t apple_mbox_send_empty_irq(int irq, void *data)
 {
 	struct apple_mbox *mbox = data;
 
-	/*
-	 * We don't need to acknowledge the interrupt at the mailbox level
-	 * here even if supported by the hardware. It will keep firing but that
-	 * doesn't matter since it's disabled at the main interrupt controller.
-	 * apple_mbox_send will acknowledge it before enabling
-	 * it at the main controller again.
-	 */
 	spin_lock(&mbox->tx_lock);
-	disable_irq_nosync(mbox->irq_send_empty);
-	complete(&mbox->tx_empty);
+	if (apple_mbox_tx_fill_locked(mbox)) {
+		/*
+		 * We don't need to acknowledge the interrupt at the mailbox
+		 * level here even if supported by the hardware. It will keep
+		 * firing but that doesn't matter since it's disabled at the
+		 * main interrupt controller. apple_mbox_send will acknowledge
+		 * it before enabling it at the main controller again.
+		 */
+		mbox->tx_irq_enabled = false;
+		disable_irq_nosync(mbox->irq_send_empty);
+	} else if (mbox->hw->has_irq_controls) {
+		/* the FIFO is full again, only fire once it has drained */
+		writel_relaxed(mbox->hw->irq_bit_send_empty,
+			       mbox->regs + mbox->hw->irq_ack);
+	}
+	complete_all(&mbox->tx_empty);
 	spin_unlock(&mbox->tx_lock);
 
 	return IRQ_HANDLED;
 }
 
-static int apple_mbox_poll_locked(struct apple_mbox *mbox)
+/*
+ * Pop up to budget messages from the I2A FIFO. Returns the number of
+ * messages handled, which is equal to budget if the FIFO may still contain
+ * more messages.
+ */
+static int apple_mbox_poll_locked(struct apple_mbox *mbox, int budget)
 {
 	struct apple_mbox_msg msg;
 	int ret = 0;
@@ -184,6 +257,9 @@ static int apple_mbox_poll_locked(struct apple_mbox *mbox)
 	u32 mbox_ctrl = readl_relaxed(mbox->regs + mbox->hw->i2a_control);
 
 	while (!(mbox_ctrl & mbox->hw->control_empty)) {
+		if (ret == budget)
+			return ret;
+
 		msg.msg0 = readq_relaxed(mbox->regs + mbox->hw->i2a_recv0);
 		msg.msg1 = FIELD_GET(
 			APPLE_MBOX_MSG1_MSG,
@@ -210,14 +286,37 @@ static int apple_mbox_poll_locked(struct apple_mbox *mbox)
 	return ret;
 }
 
+/*
+ * Handle a burst of up to APPLE_MBOX_RX_BUDGET messages directly from the
+ * interrupt. If the co-processor keeps sending, hand over to the IRQ thread
+ * which keeps polling the FIFO with the interrupt masked until it is empty.
+ */
 static irqreturn_t apple_mbox_recv_irq(int irq, void *data)
 {
 	struct apple_mbox *mbox = data;
+	int ret;
 
 	spin_lock(&mbox->rx_lock);
-	apple_mbox_poll_locked(mbox);
+	ret = apple_mbox_poll_locked(mbox, APPLE_MBOX_RX_BUDGET);
 	spin_unlock(&mbox->rx_lock);
 
+	return ret == APPLE_MBOX_RX_BUDGET ? IRQ_WAKE_THREAD : IRQ_HANDLED;
+}
+
+static irqreturn_t apple_mbox_recv_thread(int irq, void *data)
+{
+	struct apple_mbox *mbox = data;
+	unsigned long flags;
+	int ret;
+
+	do {
+		spin_lock_irqsave(&mbox->rx_lock, flags);
+		ret = apple_mbox_poll_locked(mbox, APPLE_MBOX_RX_BUDGET);
+		spin_unlock_irqrestore(&mbox->rx_lock, flags);
+
+		cond_resched();
+	} while (ret == APPLE_MBOX_RX_BUDGET);
+
 	return IRQ_HANDLED;
 }
 
@@ -227,7 +326,7 @@ int apple_mbox_poll(struct apple_mbox *mbox)
 	int ret;
 
 	spin_lock_irqsave(&mbox->rx_lock, flags);
-	ret = apple_mbox_poll_locked(mbox);
+	ret = apple_mbox_poll_locked(mbox, INT_MAX);
 	spin_unlock_irqrestore(&mbox->rx_lock, flags);
 
 	return ret;
@@ -267,11 +366,23 @@ EXPORT_SYMBOL(apple_mbox_start);
 
 void apple_mbox_stop(struct apple_mbox *mbox)
 {
+	unsigned long flags;
+
 	if (!mbox->active)
 		return;
 
 	mbox->active = false;
 	disable_irq(mbox->irq_recv_not_empty);
+
+	/* drop messages the co-processor never picked up */
+	spin_lock_irqsave(&mbox->tx_lock, flags);
+	mbox->tx_tail = mbox->tx_head;
+	if (mbox->tx_irq_enabled) {
+		mbox->tx_irq_enabled = false;
+		disable_irq_nosync(mbox->irq_send_empty);
+	}
+	complete_all(&mbox->tx_empty);
+	spin_unlock_irqrestore(&mbox->tx_lock, flags);
 	pm_runtime_mark_last_busy(mbox->dev);
 	pm_runtime_put_autosuspend(mbox->dev);
 }
@@ -354,9 +465,12 @@ static int apple_mbox_probe(struct platform_device *pdev)
 	if (!irqname)
 		return -ENOMEM;
 
-	ret = devm_request_irq(dev, mbox->irq_recv_not_empty,
-			       apple_mbox_recv_irq,
-			       IRQF_NO_AUTOEN | IRQF_NO_SUSPEND, irqname, mbox);
+	ret = devm_request_threaded_irq(dev, mbox->irq_recv_not_empty,
+					apple_mbox_recv_irq,
+					apple_mbox_recv_thread,
+					IRQF_NO_AUTOEN | IRQF_NO_SUSPEND |
+						IRQF_ONESHOT,
+					irqname, mbox);
 	if (ret)
 		return ret;
 
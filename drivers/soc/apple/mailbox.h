@@ -11,6 +11,8 @@
 #include <linux/device.h>
 #include <linux/types.h>
 
+#define APPLE_MBOX_TX_QUEUE_SIZE 64
+
 /* encodes a single 96bit message sent over the single channel */
 struct apple_mbox_msg {
 	u64 msg0;
@@ -31,6 +33,12 @@ struct apple_mbox {
 
 	struct completion tx_empty;
 
+	/* messages waiting for space in the A2I FIFO, protected by tx_lock */
+	struct apple_mbox_msg tx_queue[APPLE_MBOX_TX_QUEUE_SIZE];
+	unsigned int tx_head;
+	unsigned int tx_tail;
+	bool tx_irq_enabled;
+
 	/** Receive callback for incoming messages */
 	void (*rx)(struct apple_mbox *mbox, struct apple_mbox_msg msg, void *cookie);
 	void *cookie;
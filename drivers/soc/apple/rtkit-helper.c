@@ -141,6 +141,7 @@ static struct platform_driver apple_rtkit_helper_driver = {
 	.driver = {
 		.name = "rtkit-helper",
 		.of_match_table = apple_rtkit_helper_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = apple_rtkit_helper_probe,
 	.remove = apple_rtkit_helper_remove,
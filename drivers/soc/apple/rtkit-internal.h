@@ -10,17 +10,26 @@
 #include <linux/bitfield.h>
 #include <linux/bitmap.h>
 #include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/soc/apple/rtkit.h>
+#include <linux/spinlock.h>
 #include <linux/workqueue.h>
 #include "mailbox.h"
 
 #define APPLE_RTKIT_APP_ENDPOINT_START 0x20
 #define APPLE_RTKIT_MAX_ENDPOINTS 0x100
+#define APPLE_RTKIT_RX_RING_SIZE 256
+
+struct apple_rtkit_rx_msg {
+	u64 msg;
+	u8 ep;
+};
 
 struct apple_rtkit {
 	void *cookie;
@@ -51,7 +60,29 @@ struct apple_rtkit {
 	size_t syslog_n_entries;
 	size_t syslog_msg_size;
 
+	/* most recent syslog entries, stored unformatted */
+	spinlock_t syslog_ring_lock;
+	void *syslog_ring;
+	size_t syslog_ring_entry_size;
+	u32 syslog_ring_entries;
+	u32 syslog_ring_head;
+	u32 syslog_ring_count;
+	u64 syslog_messages;
+	u64 oslog_messages;
+
 	struct workqueue_struct *wq;
+
+	spinlock_t rx_lock;
+	struct work_struct rx_work;
+	struct apple_rtkit_rx_msg rx_ring[APPLE_RTKIT_RX_RING_SIZE];
+	unsigned int rx_head;
+	unsigned int rx_tail;
+
+	u64 rx_queued;
+	u64 rx_dropped;
+	u32 rx_max_depth;
+	u32 rx_max_batch;
+	struct dentry *debugfs;
 };
 
 void apple_rtkit_crashlog_dump(struct apple_rtkit *rtk, u8 *bfr, size_t size);
@@ -6,6 +6,17 @@
 
 #include "rtkit-internal.h"
 
+#include <linux/uaccess.h>
+
+static bool syslog_printk = true;
+module_param(syslog_printk, bool, 0644);
+MODULE_PARM_DESC(syslog_printk, "Forward coprocessor syslog messages to the kernel log");
+
+static unsigned int syslog_ring_entries = 256;
+module_param(syslog_ring_entries, uint, 0444);
+MODULE_PARM_DESC(syslog_ring_entries,
+		 "Number of coprocessor syslog messages kept for debugfs (0 disables)");
+
 enum {
 	APPLE_RTKIT_PWR_STATE_OFF = 0x00, /* power off, cannot be restarted */
 	APPLE_RTKIT_PWR_STATE_SLEEP = 0x01, /* sleeping, can be restarted */
@@ -74,13 +85,6 @@ enum {
 #define APPLE_RTKIT_MIN_SUPPORTED_VERSION 11
 #define APPLE_RTKIT_MAX_SUPPORTED_VERSION 12
 
-struct apple_rtkit_rx_work {
-	struct apple_rtkit *rtk;
-	u8 ep;
-	u64 msg;
-	struct work_struct work;
-};
-
 bool apple_rtkit_is_running(struct apple_rtkit *rtk)
 {
 	if (rtk->crashed)
@@ -420,12 +424,83 @@ static void apple_rtkit_ioreport_rx(struct apple_rtkit *rtk, u64 msg)
 	}
 }
 
+struct apple_rtkit_syslog_entry {
+	u64 timestamp;
+	char context[24];
+	char msg[];
+};
+
+static void apple_rtkit_syslog_ring_free(struct apple_rtkit *rtk)
+{
+	unsigned long flags;
+	void *ring;
+
+	spin_lock_irqsave(&rtk->syslog_ring_lock, flags);
+	ring = rtk->syslog_ring;
+	rtk->syslog_ring = NULL;
+	rtk->syslog_ring_entries = 0;
+	rtk->syslog_ring_head = 0;
+	rtk->syslog_ring_count = 0;
+	spin_unlock_irqrestore(&rtk->syslog_ring_lock, flags);
+
+	kvfree(ring);
+}
+
+static void apple_rtkit_syslog_ring_alloc(struct apple_rtkit *rtk)
+{
+	size_t entry_size;
+	unsigned long flags;
+	void *ring;
+
+	if (!syslog_ring_entries || !rtk->syslog_msg_size)
+		return;
+
+	entry_size = ALIGN(sizeof(struct apple_rtkit_syslog_entry) +
+			   rtk->syslog_msg_size, 8);
+	ring = kvcalloc(syslog_ring_entries, entry_size, GFP_KERNEL);
+	if (!ring)
+		return;
+
+	apple_rtkit_syslog_ring_free(rtk);
+
+	spin_lock_irqsave(&rtk->syslog_ring_lock, flags);
+	rtk->syslog_ring = ring;
+	rtk->syslog_ring_entry_size = entry_size;
+	rtk->syslog_ring_entries = syslog_ring_entries;
+	spin_unlock_irqrestore(&rtk->syslog_ring_lock, flags);
+}
+
+static void apple_rtkit_syslog_ring_add(struct apple_rtkit *rtk,
+					const char *context, const char *msg,
+					size_t len)
+{
+	struct apple_rtkit_syslog_entry *entry;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rtk->syslog_ring_lock, flags);
+	if (rtk->syslog_ring) {
+		entry = rtk->syslog_ring +
+			rtk->syslog_ring_head * rtk->syslog_ring_entry_size;
+		entry->timestamp = ktime_get_boottime_ns();
+		memcpy(entry->context, context, sizeof(entry->context));
+		memcpy(entry->msg, msg, len);
+		entry->msg[len] = 0;
+
+		rtk->syslog_ring_head = (rtk->syslog_ring_head + 1) %
+					rtk->syslog_ring_entries;
+		if (rtk->syslog_ring_count < rtk->syslog_ring_entries)
+			rtk->syslog_ring_count++;
+	}
+	spin_unlock_irqrestore(&rtk->syslog_ring_lock, flags);
+}
+
 static void apple_rtkit_syslog_rx_init(struct apple_rtkit *rtk, u64 msg)
 {
 	rtk->syslog_n_entries = FIELD_GET(APPLE_RTKIT_SYSLOG_N_ENTRIES, msg);
 	rtk->syslog_msg_size = FIELD_GET(APPLE_RTKIT_SYSLOG_MSG_SIZE, msg);
 
 	rtk->syslog_msg_buffer = kzalloc(rtk->syslog_msg_size, GFP_KERNEL);
+	apple_rtkit_syslog_ring_alloc(rtk);
 
 	dev_dbg(rtk->dev,
 		"RTKit: syslog initialized: entries: %zd, msg_size: %zd\n",
@@ -482,8 +557,13 @@ static void apple_rtkit_syslog_rx_log(struct apple_rtkit *rtk, u64 msg)
 		msglen--;
 
 	rtk->syslog_msg_buffer[msglen] = 0;
-	dev_info(rtk->dev, "RTKit: syslog message: %s: %s\n", log_context,
-		 rtk->syslog_msg_buffer);
+	rtk->syslog_messages++;
+
+	apple_rtkit_syslog_ring_add(rtk, log_context, rtk->syslog_msg_buffer,
+				    msglen);
+	if (syslog_printk)
+		dev_info(rtk->dev, "RTKit: syslog message: %s: %s\n",
+			 log_context, rtk->syslog_msg_buffer);
 
 done:
 	apple_rtkit_send_message(rtk, APPLE_RTKIT_EP_SYSLOG, msg, NULL, false);
@@ -520,57 +600,84 @@ static void apple_rtkit_oslog_rx(struct apple_rtkit *rtk, u64 msg)
 						 APPLE_RTKIT_EP_OSLOG, msg);
 		break;
 	default:
-		dev_warn(rtk->dev, "RTKit: Unknown oslog message: %llx\n",
-			 msg);
+		/*
+		 * The entries themselves live in oslog_buffer, which is
+		 * exported raw through debugfs; don't warn for each one.
+		 */
+		rtk->oslog_messages++;
+		dev_dbg(rtk->dev, "RTKit: oslog message: %llx\n", msg);
 	}
 }
 
-static void apple_rtkit_rx_work(struct work_struct *work)
+static void apple_rtkit_rx_dispatch(struct apple_rtkit *rtk, u8 ep, u64 msg)
 {
-	struct apple_rtkit_rx_work *rtk_work =
-		container_of(work, struct apple_rtkit_rx_work, work);
-	struct apple_rtkit *rtk = rtk_work->rtk;
-
-	switch (rtk_work->ep) {
+	switch (ep) {
 	case APPLE_RTKIT_EP_MGMT:
-		apple_rtkit_management_rx(rtk, rtk_work->msg);
+		apple_rtkit_management_rx(rtk, msg);
 		break;
 	case APPLE_RTKIT_EP_CRASHLOG:
-		apple_rtkit_crashlog_rx(rtk, rtk_work->msg);
+		apple_rtkit_crashlog_rx(rtk, msg);
 		break;
 	case APPLE_RTKIT_EP_SYSLOG:
-		apple_rtkit_syslog_rx(rtk, rtk_work->msg);
+		apple_rtkit_syslog_rx(rtk, msg);
 		break;
 	case APPLE_RTKIT_EP_IOREPORT:
-		apple_rtkit_ioreport_rx(rtk, rtk_work->msg);
+		apple_rtkit_ioreport_rx(rtk, msg);
 		break;
 	case APPLE_RTKIT_EP_OSLOG:
-		apple_rtkit_oslog_rx(rtk, rtk_work->msg);
+		apple_rtkit_oslog_rx(rtk, msg);
 		break;
 	case APPLE_RTKIT_APP_ENDPOINT_START ... 0xff:
 		if (rtk->ops->recv_message)
-			rtk->ops->recv_message(rtk->cookie, rtk_work->ep,
-					       rtk_work->msg);
+			rtk->ops->recv_message(rtk->cookie, ep, msg);
 		else
 			dev_warn(
 				rtk->dev,
 				"Received unexpected message to EP%02d: %llx\n",
-				rtk_work->ep, rtk_work->msg);
+				ep, msg);
 		break;
 	default:
 		dev_warn(rtk->dev,
 			 "RTKit: message to unknown endpoint %02x: %llx\n",
-			 rtk_work->ep, rtk_work->msg);
+			 ep, msg);
 	}
+}
+
+/*
+ * Drain all messages queued by apple_rtkit_rx() in a single work invocation.
+ * The ring is only consumed from here and rtk->wq is ordered, so messages are
+ * always handled in the order they were received.
+ */
+static void apple_rtkit_rx_work(struct work_struct *work)
+{
+	struct apple_rtkit *rtk = container_of(work, struct apple_rtkit, rx_work);
+	struct apple_rtkit_rx_msg rx;
+	unsigned long flags;
+	u32 batch = 0;
+
+	for (;;) {
+		spin_lock_irqsave(&rtk->rx_lock, flags);
+		if (rtk->rx_head == rtk->rx_tail) {
+			rtk->rx_max_batch = max(rtk->rx_max_batch, batch);
+			spin_unlock_irqrestore(&rtk->rx_lock, flags);
+			break;
+		}
+		rx = rtk->rx_ring[rtk->rx_tail % APPLE_RTKIT_RX_RING_SIZE];
+		rtk->rx_tail++;
+		spin_unlock_irqrestore(&rtk->rx_lock, flags);
 
-	kfree(rtk_work);
+		apple_rtkit_rx_dispatch(rtk, rx.ep, rx.msg);
+		batch++;
+	}
 }
 
 static void apple_rtkit_rx(struct apple_mbox *mbox, struct apple_mbox_msg msg,
 			   void *cookie)
 {
 	struct apple_rtkit *rtk = cookie;
-	struct apple_rtkit_rx_work *work;
+	struct apple_rtkit_rx_msg *rx;
+	unsigned long flags;
+	unsigned int depth;
 	u8 ep = msg.msg1;
 
 	/*
@@ -590,15 +697,26 @@ static void apple_rtkit_rx(struct apple_mbox *mbox, struct apple_mbox_msg msg,
 	    rtk->ops->recv_message_early(rtk->cookie, ep, msg.msg0))
 		return;
 
-	work = kzalloc(sizeof(*work), GFP_ATOMIC);
-	if (!work)
+	spin_lock_irqsave(&rtk->rx_lock, flags);
+	depth = rtk->rx_head - rtk->rx_tail;
+	if (depth >= APPLE_RTKIT_RX_RING_SIZE) {
+		rtk->rx_dropped++;
+		spin_unlock_irqrestore(&rtk->rx_lock, flags);
+		dev_warn_ratelimited(rtk->dev,
+				     "RTKit: RX ring full, dropping message to EP%02d: %llx\n",
+				     ep, msg.msg0);
 		return;
+	}
 
-	work->rtk = rtk;
-	work->ep = ep;
-	work->msg = msg.msg0;
-	INIT_WORK(&work->work, apple_rtkit_rx_work);
-	queue_work(rtk->wq, &work->work);
+	rx = &rtk->rx_ring[rtk->rx_head % APPLE_RTKIT_RX_RING_SIZE];
+	rx->ep = ep;
+	rx->msg = msg.msg0;
+	rtk->rx_head++;
+	rtk->rx_queued++;
+	rtk->rx_max_depth = max(rtk->rx_max_depth, depth + 1);
+	spin_unlock_irqrestore(&rtk->rx_lock, flags);
+
+	queue_work(rtk->wq, &rtk->rx_work);
 }
 
 int apple_rtkit_send_message(struct apple_rtkit *rtk, u8 ep, u64 message,
@@ -657,6 +775,94 @@ int apple_rtkit_start_ep(struct apple_rtkit *rtk, u8 endpoint)
 }
 EXPORT_SYMBOL_GPL(apple_rtkit_start_ep);
 
+static struct dentry *apple_rtkit_debugfs_root;
+static DEFINE_MUTEX(apple_rtkit_debugfs_lock);
+
+static int apple_rtkit_syslog_show(struct seq_file *s, void *data)
+{
+	struct apple_rtkit *rtk = s->private;
+	struct apple_rtkit_syslog_entry *entry;
+	unsigned long flags;
+	u32 i, idx;
+
+	spin_lock_irqsave(&rtk->syslog_ring_lock, flags);
+	for (i = 0; i < rtk->syslog_ring_count; i++) {
+		idx = (rtk->syslog_ring_head + rtk->syslog_ring_entries -
+		       rtk->syslog_ring_count + i) % rtk->syslog_ring_entries;
+		entry = rtk->syslog_ring + idx * rtk->syslog_ring_entry_size;
+		seq_printf(s, "[%5llu.%06llu] %s: %s\n",
+			   entry->timestamp / NSEC_PER_SEC,
+			   (entry->timestamp % NSEC_PER_SEC) / NSEC_PER_USEC,
+			   entry->context, entry->msg);
+	}
+	spin_unlock_irqrestore(&rtk->syslog_ring_lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(apple_rtkit_syslog);
+
+static ssize_t apple_rtkit_oslog_read(struct file *file, char __user *ubuf,
+				      size_t count, loff_t *ppos)
+{
+	struct apple_rtkit *rtk = file->private_data;
+	struct apple_rtkit_shmem *bfr = &rtk->oslog_buffer;
+	size_t size = bfr->size;
+	ssize_t ret;
+	void *tmp;
+
+	if (!size || (!bfr->buffer && !bfr->iomem))
+		return 0;
+	if (*ppos >= size)
+		return 0;
+
+	count = min_t(size_t, count, size - *ppos);
+	tmp = kvmalloc(count, GFP_KERNEL);
+	if (!tmp)
+		return -ENOMEM;
+
+	apple_rtkit_memcpy(rtk, tmp, bfr, *ppos, count);
+	ret = count - copy_to_user(ubuf, tmp, count);
+	kvfree(tmp);
+	if (!ret)
+		return -EFAULT;
+
+	*ppos += ret;
+	return ret;
+}
+
+static const struct file_operations apple_rtkit_oslog_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = apple_rtkit_oslog_read,
+	.llseek = default_llseek,
+};
+
+static void apple_rtkit_debugfs_init(struct apple_rtkit *rtk)
+{
+	mutex_lock(&apple_rtkit_debugfs_lock);
+	if (!apple_rtkit_debugfs_root)
+		apple_rtkit_debugfs_root = debugfs_create_dir("apple_rtkit", NULL);
+	mutex_unlock(&apple_rtkit_debugfs_lock);
+
+	rtk->debugfs = debugfs_create_dir(dev_name(rtk->dev),
+					  apple_rtkit_debugfs_root);
+
+	debugfs_create_u64("rx_queued", 0444, rtk->debugfs, &rtk->rx_queued);
+	debugfs_create_u64("rx_dropped", 0444, rtk->debugfs, &rtk->rx_dropped);
+	debugfs_create_u32("rx_max_depth", 0444, rtk->debugfs,
+			   &rtk->rx_max_depth);
+	debugfs_create_u32("rx_max_batch", 0444, rtk->debugfs,
+			   &rtk->rx_max_batch);
+	debugfs_create_u64("syslog_messages", 0444, rtk->debugfs,
+			   &rtk->syslog_messages);
+	debugfs_create_u64("oslog_messages", 0444, rtk->debugfs,
+			   &rtk->oslog_messages);
+	debugfs_create_file("syslog", 0400, rtk->debugfs, rtk,
+			    &apple_rtkit_syslog_fops);
+	debugfs_create_file("oslog", 0400, rtk->debugfs, rtk,
+			    &apple_rtkit_oslog_fops);
+}
+
 struct apple_rtkit *apple_rtkit_init(struct device *dev, void *cookie,
 					    const char *mbox_name, int mbox_idx,
 					    const struct apple_rtkit_ops *ops)
@@ -682,6 +888,10 @@ struct apple_rtkit *apple_rtkit_init(struct device *dev, void *cookie,
 	bitmap_zero(rtk->endpoints, APPLE_RTKIT_MAX_ENDPOINTS);
 	set_bit(APPLE_RTKIT_EP_MGMT, rtk->endpoints);
 
+	spin_lock_init(&rtk->rx_lock);
+	INIT_WORK(&rtk->rx_work, apple_rtkit_rx_work);
+	spin_lock_init(&rtk->syslog_ring_lock);
+
 	if (mbox_name)
 		rtk->mbox = apple_mbox_get_byname(dev, mbox_name);
 	else
@@ -706,6 +916,8 @@ struct apple_rtkit *apple_rtkit_init(struct device *dev, void *cookie,
 	if (ret)
 		goto destroy_wq;
 
+	apple_rtkit_debugfs_init(rtk);
+
 	return rtk;
 
 destroy_wq:
@@ -742,6 +954,7 @@ int apple_rtkit_reinit(struct apple_rtkit *rtk)
 	apple_rtkit_free_buffer(rtk, &rtk->syslog_buffer);
 
 	kfree(rtk->syslog_msg_buffer);
+	apple_rtkit_syslog_ring_free(rtk);
 
 	rtk->syslog_msg_buffer = NULL;
 	rtk->syslog_n_entries = 0;
@@ -924,12 +1137,15 @@ void apple_rtkit_free(struct apple_rtkit *rtk)
 	apple_mbox_stop(rtk->mbox);
 	destroy_workqueue(rtk->wq);
 
+	debugfs_remove_recursive(rtk->debugfs);
+
 	apple_rtkit_free_buffer(rtk, &rtk->ioreport_buffer);
 	apple_rtkit_free_buffer(rtk, &rtk->crashlog_buffer);
 	apple_rtkit_free_buffer(rtk, &rtk->oslog_buffer);
 	apple_rtkit_free_buffer(rtk, &rtk->syslog_buffer);
 
 	kfree(rtk->syslog_msg_buffer);
+	apple_rtkit_syslog_ring_free(rtk);
 	kfree(rtk);
 }
 EXPORT_SYMBOL_GPL(apple_rtkit_free);
@@ -964,6 +1180,12 @@ void devm_apple_rtkit_free(struct device *dev, struct apple_rtkit *rtk)
 }
 EXPORT_SYMBOL_GPL(devm_apple_rtkit_free);
 
+static void __exit apple_rtkit_exit(void)
+{
+	debugfs_remove(apple_rtkit_debugfs_root);
+}
+module_exit(apple_rtkit_exit);
+
 MODULE_LICENSE("Dual MIT/GPL");
 MODULE_AUTHOR("Sven Peter <sven@svenpeter.dev>");
 MODULE_DESCRIPTION("Apple RTKit driver");
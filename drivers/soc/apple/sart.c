@@ -13,6 +13,7 @@
 
 #include <linux/soc/apple/sart.h>
 #include <linux/atomic.h>
+#include <linux/bitops.h>
 #include <linux/bits.h>
 #include <linux/bitfield.h>
 #include <linux/device.h>
@@ -21,9 +22,11 @@
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
 
 #define APPLE_SART_MAX_ENTRIES 16
+#define APPLE_SART_ALL_ENTRIES GENMASK(APPLE_SART_MAX_ENTRIES - 1, 0)
 
 /* This is probably a bitfield but the exact meaning of each bit is unknown. */
 #define APPLE_SART_FLAGS_ALLOW 0xff
@@ -58,16 +61,33 @@ struct apple_sart_ops {
 	size_t size_max;
 };
 
+struct apple_sart_entry {
+	phys_addr_t paddr;
+	size_t size;
+};
+
 struct apple_sart {
 	struct device *dev;
 	void __iomem *regs;
 
 	const struct apple_sart_ops *ops;
 
+	/*
+	 * Shadow copy of the entries we programmed so that lookups and
+	 * allocations never have to go through MMIO. Protected by lock.
+	 */
+	spinlock_t lock;
+	struct apple_sart_entry entries[APPLE_SART_MAX_ENTRIES];
 	unsigned long protected_entries;
 	unsigned long used_entries;
 };
 
+static unsigned int apple_sart_free_entries(struct apple_sart *sart)
+{
+	return hweight_long(~(sart->protected_entries | sart->used_entries) &
+			    APPLE_SART_ALL_ENTRIES);
+}
+
 static void sart2_get_entry(struct apple_sart *sart, int index, u8 *flags,
 			    phys_addr_t *paddr, size_t *size)
 {
@@ -139,6 +159,7 @@ static int apple_sart_probe(struct platform_device *pdev)
 
 	sart->dev = dev;
 	sart->ops = of_device_get_match_data(dev);
+	spin_lock_init(&sart->lock);
 
 	sart->regs = devm_platform_ioremap_resource(pdev, 0);
 	if (IS_ERR(sart->regs))
@@ -204,93 +225,144 @@ struct apple_sart *devm_apple_sart_get(struct device *dev)
 }
 EXPORT_SYMBOL_GPL(devm_apple_sart_get);
 
-static int sart_set_entry(struct apple_sart *sart, int index, u8 flags,
-			  phys_addr_t paddr, size_t size)
+static int sart_check_region(struct apple_sart *sart, phys_addr_t paddr,
+			     size_t size)
 {
 	if (size & ((1 << sart->ops->size_shift) - 1))
 		return -EINVAL;
 	if (paddr & ((1 << sart->ops->paddr_shift) - 1))
 		return -EINVAL;
-
-	paddr >>= sart->ops->size_shift;
-	size >>= sart->ops->paddr_shift;
-
-	if (size > sart->ops->size_max)
+	if ((size >> sart->ops->size_shift) > sart->ops->size_max)
 		return -EINVAL;
 
-	sart->ops->set_entry(sart, index, flags, paddr, size);
 	return 0;
 }
 
+static void sart_set_entry(struct apple_sart *sart, int index, u8 flags,
+			   phys_addr_t paddr, size_t size)
+{
+	sart->entries[index].paddr = paddr;
+	sart->entries[index].size = size;
+
+	sart->ops->set_entry(sart, index, flags,
+			     paddr >> sart->ops->paddr_shift,
+			     size >> sart->ops->size_shift);
+}
+
+/* Must be called with sart->lock held and at least one free entry. */
+static void sart_add_region_locked(struct apple_sart *sart, phys_addr_t paddr,
+				   size_t size)
+{
+	unsigned long free;
+	int i;
+
+	free = ~(sart->protected_entries | sart->used_entries) &
+	       APPLE_SART_ALL_ENTRIES;
+	i = __ffs(free);
+
+	__set_bit(i, &sart->used_entries);
+	sart_set_entry(sart, i, APPLE_SART_FLAGS_ALLOW, paddr, size);
+
+	dev_dbg(sart->dev, "wrote [%pa, 0x%zx] to %d\n", &paddr, size, i);
+}
+
+static int sart_remove_region_locked(struct apple_sart *sart,
+				     phys_addr_t paddr, size_t size)
+{
+	int i;
+
+	for_each_set_bit(i, &sart->used_entries, APPLE_SART_MAX_ENTRIES) {
+		if (sart->entries[i].paddr != paddr ||
+		    sart->entries[i].size != size)
+			continue;
+
+		sart_set_entry(sart, i, 0, 0, 0);
+		__clear_bit(i, &sart->used_entries);
+		dev_dbg(sart->dev, "cleared entry %d\n", i);
+		return 0;
+	}
+
+	dev_warn(sart->dev, "entry [paddr: 0x%pa, size: 0x%zx] not found\n",
+		 &paddr, size);
+	return -EINVAL;
+}
+
 int apple_sart_add_allowed_region(struct apple_sart *sart, phys_addr_t paddr,
 				  size_t size)
 {
-	int i, ret;
+	struct apple_sart_region region = { .paddr = paddr, .size = size };
 
-	for (i = 0; i < APPLE_SART_MAX_ENTRIES; ++i) {
-		if (test_bit(i, &sart->protected_entries))
-			continue;
-		if (test_and_set_bit(i, &sart->used_entries))
-			continue;
+	return apple_sart_add_allowed_regions(sart, &region, 1);
+}
+EXPORT_SYMBOL_GPL(apple_sart_add_allowed_region);
 
-		ret = sart_set_entry(sart, i, APPLE_SART_FLAGS_ALLOW, paddr,
-				     size);
+int apple_sart_add_allowed_regions(struct apple_sart *sart,
+				   const struct apple_sart_region *regions,
+				   unsigned int count)
+{
+	unsigned long flags;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < count; i++) {
+		ret = sart_check_region(sart, regions[i].paddr,
+					regions[i].size);
 		if (ret) {
-			dev_dbg(sart->dev,
-				"unable to set entry %d to [%pa, 0x%zx]\n",
-				i, &paddr, size);
-			clear_bit(i, &sart->used_entries);
+			dev_dbg(sart->dev, "invalid region [%pa, 0x%zx]\n",
+				&regions[i].paddr, regions[i].size);
 			return ret;
 		}
+	}
 
-		dev_dbg(sart->dev, "wrote [%pa, 0x%zx] to %d\n", &paddr, size,
-			i);
-		return 0;
+	spin_lock_irqsave(&sart->lock, flags);
+	if (apple_sart_free_entries(sart) < count) {
+		spin_unlock_irqrestore(&sart->lock, flags);
+		dev_warn(sart->dev,
+			 "not enough free entries left to add %u region(s)\n",
+			 count);
+		return -EBUSY;
 	}
 
-	dev_warn(sart->dev,
-		 "no free entries left to add [paddr: 0x%pa, size: 0x%zx]\n",
-		 &paddr, size);
+	for (i = 0; i < count; i++)
+		sart_add_region_locked(sart, regions[i].paddr, regions[i].size);
+	spin_unlock_irqrestore(&sart->lock, flags);
 
-	return -EBUSY;
+	return 0;
 }
-EXPORT_SYMBOL_GPL(apple_sart_add_allowed_region);
+EXPORT_SYMBOL_GPL(apple_sart_add_allowed_regions);
 
 int apple_sart_remove_allowed_region(struct apple_sart *sart, phys_addr_t paddr,
 				     size_t size)
 {
-	int i;
-
-	dev_dbg(sart->dev,
-		"will remove [paddr: %pa, size: 0x%zx] from allowed regions\n",
-		&paddr, size);
-
-	for (i = 0; i < APPLE_SART_MAX_ENTRIES; ++i) {
-		u8 eflags;
-		size_t esize;
-		phys_addr_t epaddr;
+	struct apple_sart_region region = { .paddr = paddr, .size = size };
 
-		if (test_bit(i, &sart->protected_entries))
-			continue;
-
-		sart->ops->get_entry(sart, i, &eflags, &epaddr, &esize);
+	return apple_sart_remove_allowed_regions(sart, &region, 1);
+}
+EXPORT_SYMBOL_GPL(apple_sart_remove_allowed_region);
 
-		if (epaddr != paddr || esize != size)
-			continue;
+int apple_sart_remove_allowed_regions(struct apple_sart *sart,
+				      const struct apple_sart_region *regions,
+				      unsigned int count)
+{
+	unsigned long flags;
+	unsigned int i;
+	int ret = 0;
 
-		sart->ops->set_entry(sart, i, 0, 0, 0);
+	spin_lock_irqsave(&sart->lock, flags);
+	for (i = 0; i < count; i++) {
+		dev_dbg(sart->dev,
+			"will remove [paddr: %pa, size: 0x%zx] from allowed regions\n",
+			&regions[i].paddr, regions[i].size);
 
-		clear_bit(i, &sart->used_entries);
-		dev_dbg(sart->dev, "cleared entry %d\n", i);
-		return 0;
+		if (sart_remove_region_locked(sart, regions[i].paddr,
+					      regions[i].size))
+			ret = -EINVAL;
 	}
+	spin_unlock_irqrestore(&sart->lock, flags);
 
-	dev_warn(sart->dev, "entry [paddr: 0x%pa, size: 0x%zx] not found\n",
-		 &paddr, size);
-
-	return -EINVAL;
+	return ret;
 }
-EXPORT_SYMBOL_GPL(apple_sart_remove_allowed_region);
+EXPORT_SYMBOL_GPL(apple_sart_remove_allowed_regions);
 
 static void apple_sart_shutdown(struct platform_device *pdev)
 {
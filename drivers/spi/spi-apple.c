@@ -10,9 +10,11 @@
 #include <linux/bitfield.h>
 #include <linux/bits.h>
 #include <linux/clk.h>
+#include <linux/dmaengine.h>
 #include <linux/module.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/math64.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
@@ -121,10 +123,18 @@
  */
 #define APPLE_SPI_TIMEOUT_MS		200
 
+/*
+ * Below this length the DMA setup costs more than just feeding the FIFO by
+ * hand, so keep using PIO.
+ */
+#define APPLE_SPI_DMA_MIN_LEN		(4 * APPLE_SPI_FIFO_DEPTH)
+
 struct apple_spi {
 	void __iomem      *regs;        /* MMIO register address */
+	phys_addr_t       phys;         /* MMIO physical address, for DMA */
 	struct clk        *clk;         /* bus clock */
 	struct completion done;         /* wake-up from interrupt */
+	struct completion dma_done;     /* wake-up from DMA completion */
 };
 
 static inline void reg_write(struct apple_spi *spi, int offset, u32 value)
@@ -355,6 +365,136 @@ static void apple_spi_rx(struct apple_spi *spi, void **rx_ptr, u32 *left,
 	*rx_ptr = ((u8 *)*rx_ptr) + bytes_per_word * read;
 }
 
+static void apple_spi_dma_callback(void *data)
+{
+	struct apple_spi *spi = data;
+
+	complete(&spi->dma_done);
+}
+
+static int apple_spi_transfer_one_dma(struct spi_controller *ctlr, struct spi_transfer *t,
+				      unsigned int bytes_per_word, bool poll)
+{
+	struct apple_spi *spi = spi_controller_get_devdata(ctlr);
+	struct dma_async_tx_descriptor *rxd = NULL, *txd = NULL;
+	struct dma_slave_config cfg = {
+		.src_addr = spi->phys + APPLE_SPI_RXDATA,
+		.dst_addr = spi->phys + APPLE_SPI_TXDATA,
+		.src_addr_width = bytes_per_word,
+		.dst_addr_width = bytes_per_word,
+		.src_maxburst = APPLE_SPI_FIFO_DEPTH / 2,
+		.dst_maxburst = APPLE_SPI_FIFO_DEPTH / 2,
+	};
+	unsigned long timeout;
+	u32 words = t->len / bytes_per_word;
+	u32 xfer_flags = 0;
+	int ret;
+
+	/* Reset FIFOs */
+	reg_write(spi, APPLE_SPI_CTRL, APPLE_SPI_CTRL_RX_RESET | APPLE_SPI_CTRL_TX_RESET);
+
+	/* Clear IRQ flags */
+	reg_write(spi, APPLE_SPI_IF_XFER, ~0);
+	reg_write(spi, APPLE_SPI_IF_FIFO, ~0);
+
+	reg_write(spi, APPLE_SPI_TXCNT, t->tx_buf ? words : 0);
+	reg_write(spi, APPLE_SPI_RXCNT, t->rx_buf ? words : 0);
+
+	reinit_completion(&spi->dma_done);
+
+	if (t->rx_buf) {
+		cfg.direction = DMA_DEV_TO_MEM;
+		ret = dmaengine_slave_config(ctlr->dma_rx, &cfg);
+		if (ret)
+			return ret;
+
+		rxd = dmaengine_prep_slave_sg(ctlr->dma_rx, t->rx_sg.sgl, t->rx_sg.nents,
+					      DMA_DEV_TO_MEM,
+					      DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+		if (!rxd)
+			return -ENOMEM;
+
+		/* RX finishes last, so that is the one we wait for */
+		rxd->callback = apple_spi_dma_callback;
+		rxd->callback_param = spi;
+		xfer_flags |= APPLE_SPI_XFER_RXCOMPLETE;
+	}
+
+	if (t->tx_buf) {
+		cfg.direction = DMA_MEM_TO_DEV;
+		ret = dmaengine_slave_config(ctlr->dma_tx, &cfg);
+		if (ret)
+			goto err;
+
+		txd = dmaengine_prep_slave_sg(ctlr->dma_tx, t->tx_sg.sgl, t->tx_sg.nents,
+					      DMA_MEM_TO_DEV,
+					      DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+		if (!txd) {
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		if (!rxd) {
+			txd->callback = apple_spi_dma_callback;
+			txd->callback_param = spi;
+		}
+		xfer_flags |= APPLE_SPI_XFER_TXCOMPLETE;
+	}
+
+	reg_mask(spi, APPLE_SPI_CFG, APPLE_SPI_CFG_MODE,
+		 FIELD_PREP(APPLE_SPI_CFG_MODE, APPLE_SPI_CFG_MODE_DMA));
+
+	/* Arm RX before TX so that no incoming word is missed */
+	if (rxd) {
+		dmaengine_submit(rxd);
+		dma_async_issue_pending(ctlr->dma_rx);
+	}
+	if (txd) {
+		dmaengine_submit(txd);
+		dma_async_issue_pending(ctlr->dma_tx);
+	}
+
+	/* Start transfer */
+	reg_write(spi, APPLE_SPI_CTRL, APPLE_SPI_CTRL_RUN);
+
+	/* Allow twice the time the transfer takes on the wire, plus the usual slack */
+	timeout = msecs_to_jiffies(APPLE_SPI_TIMEOUT_MS +
+				   div_u64(2ULL * MSEC_PER_SEC * 8 * t->len, t->speed_hz));
+	if (!wait_for_completion_timeout(&spi->dma_done, timeout)) {
+		dev_err(&ctlr->dev, "DMA transfer timed out\n");
+		ret = -ETIMEDOUT;
+		goto err;
+	}
+
+	while (xfer_flags) {
+		ret = apple_spi_wait(spi, 0, xfer_flags, poll);
+		if (ret) {
+			dev_err(&ctlr->dev, "DMA transfer did not complete\n");
+			goto err;
+		}
+
+		xfer_flags &= ~reg_read(spi, APPLE_SPI_IF_XFER);
+	}
+
+	ret = 0;
+
+err:
+	/* also drops an RX descriptor that was prepared but never started */
+	if (ret) {
+		if (rxd)
+			dmaengine_terminate_sync(ctlr->dma_rx);
+		if (txd)
+			dmaengine_terminate_sync(ctlr->dma_tx);
+	}
+
+	/* Stop transfer and go back to PIO */
+	reg_write(spi, APPLE_SPI_CTRL, 0);
+	reg_mask(spi, APPLE_SPI_CFG, APPLE_SPI_CFG_MODE,
+		 FIELD_PREP(APPLE_SPI_CFG_MODE, APPLE_SPI_CFG_MODE_IRQ));
+
+	return ret;
+}
+
 static int apple_spi_transfer_one(struct spi_controller *ctlr, struct spi_device *device,
 				  struct spi_transfer *t)
 {
@@ -376,6 +516,9 @@ static int apple_spi_transfer_one(struct spi_controller *ctlr, struct spi_device
 	else
 		bytes_per_word = 1;
 
+	if (ctlr->cur_msg_mapped && ctlr->can_dma && ctlr->can_dma(ctlr, device, t))
+		return apple_spi_transfer_one_dma(ctlr, t, bytes_per_word, poll);
+
 	words = t->len / bytes_per_word;
 	remaining_tx = tx_ptr ? words : 0;
 	remaining_rx = rx_ptr ? words : 0;
@@ -455,6 +598,52 @@ static int apple_spi_transfer_one(struct spi_controller *ctlr, struct spi_device
 	return ret;
 }
 
+static bool apple_spi_can_dma(struct spi_controller *ctlr, struct spi_device *device,
+			      struct spi_transfer *t)
+{
+	return t->len >= APPLE_SPI_DMA_MIN_LEN;
+}
+
+static void apple_spi_release_dma(void *data)
+{
+	struct spi_controller *ctlr = data;
+
+	if (ctlr->dma_tx)
+		dma_release_channel(ctlr->dma_tx);
+	if (ctlr->dma_rx)
+		dma_release_channel(ctlr->dma_rx);
+}
+
+static int apple_spi_request_dma(struct device *dev, struct spi_controller *ctlr)
+{
+	struct dma_chan *tx, *rx;
+	int ret;
+
+	tx = dma_request_chan(dev, "tx");
+	if (IS_ERR(tx))
+		return PTR_ERR(tx);
+
+	rx = dma_request_chan(dev, "rx");
+	if (IS_ERR(rx)) {
+		dma_release_channel(tx);
+		return PTR_ERR(rx);
+	}
+
+	/* registered first, so a failure leaves the controller on PIO */
+	ret = devm_add_action(dev, apple_spi_release_dma, ctlr);
+	if (ret) {
+		dma_release_channel(rx);
+		dma_release_channel(tx);
+		return ret;
+	}
+
+	ctlr->dma_tx = tx;
+	ctlr->dma_rx = rx;
+	ctlr->can_dma = apple_spi_can_dma;
+
+	return 0;
+}
+
 static void apple_spi_clk_disable_unprepare(void *data)
 {
         clk_disable_unprepare(data);
@@ -465,6 +654,7 @@ static int apple_spi_probe(struct platform_device *pdev)
 	struct apple_spi *spi;
 	int ret, irq;
 	struct spi_controller *ctlr;
+	struct resource *res;
 
 	ctlr = devm_spi_alloc_master(&pdev->dev, sizeof(struct apple_spi));
 	if (!ctlr)
@@ -472,11 +662,13 @@ static int apple_spi_probe(struct platform_device *pdev)
 
 	spi = spi_controller_get_devdata(ctlr);
 	init_completion(&spi->done);
+	init_completion(&spi->dma_done);
 	platform_set_drvdata(pdev, ctlr);
 
-	spi->regs = devm_platform_ioremap_resource(pdev, 0);
+	spi->regs = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
 	if (IS_ERR(spi->regs))
 		return PTR_ERR(spi->regs);
+	spi->phys = res->start;
 
 	spi->clk = devm_clk_get(&pdev->dev, NULL);
 	if (IS_ERR(spi->clk))
@@ -511,6 +703,13 @@ static int apple_spi_probe(struct platform_device *pdev)
 	ctlr->transfer_one = apple_spi_transfer_one;
 	ctlr->auto_runtime_pm = true;
 
+	/* DMA is optional, everything works (more slowly) over PIO */
+	ret = apple_spi_request_dma(&pdev->dev, ctlr);
+	if (ret == -EPROBE_DEFER)
+		return ret;
+	if (ret && ret != -ENODEV)
+		dev_warn(&pdev->dev, "DMA unavailable, using PIO: %d\n", ret);
+
 	pm_runtime_set_active(&pdev->dev);
 	devm_pm_runtime_enable(&pdev->dev);
 
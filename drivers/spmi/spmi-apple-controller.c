@@ -12,8 +12,8 @@
  */
 
 #include <linux/bits.h>
-#include <linux/delay.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
@@ -28,6 +28,9 @@
 #define SPMI_RX_FIFO_EMPTY BIT(24)
 #define SPMI_TX_FIFO_EMPTY BIT(8)
 
+#define SPMI_POLL_DELAY_US 5
+#define SPMI_TIMEOUT_US 50000
+
 /* Apple SPMI controler */
 struct apple_spmi {
 	void __iomem *regs;
@@ -44,49 +47,62 @@ static inline void write_reg(u32 value, struct apple_spmi *spmi, int offset)
 	writel_relaxed(value, spmi->regs + offset);
 }
 
+static int apple_spmi_wait_rx_not_empty(struct spmi_controller *ctrl)
+{
+	struct apple_spmi *spmi = spmi_controller_get_drvdata(ctrl);
+	u32 status;
+	int ret;
+
+	/*
+	 * Transactions complete in a few microseconds, so spin briefly
+	 * before backing off instead of sleeping a fixed 10ms per command.
+	 */
+	ret = readl_poll_timeout(spmi->regs + SPMI_STATUS_REG, status,
+				 !(status & SPMI_RX_FIFO_EMPTY),
+				 SPMI_POLL_DELAY_US, SPMI_TIMEOUT_US);
+	if (ret)
+		dev_err(&ctrl->dev, "timed out waiting for reply (status 0x%08x)\n",
+			status);
+
+	return ret;
+}
+
+static u32 apple_spmi_pack_cmd(u8 opc, u8 slave_id, u16 slave_addr, size_t bc)
+{
+	return opc | slave_id << 8 | slave_addr << 16 | (bc - 1) | (1 << 15);
+}
+
 static int spmi_read_cmd(struct spmi_controller *ctrl, u8 opc, u8 slave_id,
 			 u16 slave_addr, u8 *__buf, size_t bc)
 {
-	struct apple_spmi *spmi;
-	u32 spmi_cmd = opc | slave_id << 8 | slave_addr << 16 | (bc - 1) |
-		       (1 << 15);
+	struct apple_spmi *spmi = spmi_controller_get_drvdata(ctrl);
+	size_t len_to_read = 0;
 	u32 rsp;
-	volatile u32 status;
-	size_t len_to_read;
-	u8 i;
+	int ret;
 
-	spmi = spmi_controller_get_drvdata(ctrl);
+	write_reg(apple_spmi_pack_cmd(opc, slave_id, slave_addr, bc), spmi,
+		  SPMI_CMD_REG);
 
-	write_reg(spmi_cmd, spmi, SPMI_CMD_REG);
-
-	/* Wait for Rx FIFO to have something */
-	/* Quite ugly msleep, need to find a better way to do it */
-	i = 0;
-	do {
-		status = read_reg(spmi, SPMI_STATUS_REG);
-		msleep(10);
-		i += 1;
-	} while ((status & SPMI_RX_FIFO_EMPTY) && i < 5);
-
-	if (i >= 5) {
-		dev_err(&ctrl->dev,
-			"spmi_read_cmd:took to long to get the status");
-		return -1;
-	}
+	ret = apple_spmi_wait_rx_not_empty(ctrl);
+	if (ret)
+		return ret;
 
 	/* Read SPMI reply status */
 	rsp = read_reg(spmi, SPMI_RSP_REG);
 
-	len_to_read = 0;
-	/* Read SPMI data reply */
-	while (!(status & SPMI_RX_FIFO_EMPTY) && (len_to_read < bc)) {
-		rsp = read_reg(spmi, SPMI_RSP_REG);
-		i = 0;
-		while ((len_to_read < bc) && (i < 4)) {
-			__buf[len_to_read++] = ((0xff << (8 * i)) & rsp) >>
-					       (8 * i);
-			i += 1;
+	/* The whole burst follows, four bytes per FIFO word */
+	while (len_to_read < bc) {
+		unsigned int i;
+
+		if (read_reg(spmi, SPMI_STATUS_REG) & SPMI_RX_FIFO_EMPTY) {
+			ret = apple_spmi_wait_rx_not_empty(ctrl);
+			if (ret)
+				return ret;
 		}
+
+		rsp = read_reg(spmi, SPMI_RSP_REG);
+		for (i = 0; i < 4 && len_to_read < bc; i++)
+			__buf[len_to_read++] = rsp >> (8 * i);
 	}
 
 	return 0;
@@ -95,16 +111,13 @@ static int spmi_read_cmd(struct spmi_controller *ctrl, u8 opc, u8 slave_id,
 static int spmi_write_cmd(struct spmi_controller *ctrl, u8 opc, u8 slave_id,
 			  u16 slave_addr, const u8 *__buf, size_t bc)
 {
-	struct apple_spmi *spmi;
-	u32 spmi_cmd = opc | slave_id << 8 | slave_addr << 16 | (bc - 1) |
-		       (1 << 15);
-	volatile u32 rsp;
-	volatile u32 status;
+	struct apple_spmi *spmi = spmi_controller_get_drvdata(ctrl);
+	u32 spmi_cmd;
 	size_t i = 0, j;
+	int ret;
 
-	spmi = spmi_controller_get_drvdata(ctrl);
-
-	write_reg(spmi_cmd, spmi, SPMI_CMD_REG);
+	write_reg(apple_spmi_pack_cmd(opc, slave_id, slave_addr, bc), spmi,
+		  SPMI_CMD_REG);
 
 	while (i < bc) {
 		j = 0;
@@ -115,23 +128,11 @@ static int spmi_write_cmd(struct spmi_controller *ctrl, u8 opc, u8 slave_id,
 		write_reg(spmi_cmd, spmi, SPMI_CMD_REG);
 	}
 
-	/* Wait for Rx FIFO to have something */
-	/* Quite ugly msleep, need to find a better way to do it */
-	i = 0;
-	do {
-		status = read_reg(spmi, SPMI_STATUS_REG);
-		msleep(10);
-		i += 1;
-	} while ((status & SPMI_RX_FIFO_EMPTY) && i < 5);
-
-	if (i >= 5) {
-		dev_err(&ctrl->dev,
-			"spmi_write_cmd:took to long to get the status");
-		return -1;
-	}
+	ret = apple_spmi_wait_rx_not_empty(ctrl);
+	if (ret)
+		return ret;
 
-	rsp = read_reg(spmi, SPMI_RSP_REG);
-	(void)rsp; // TODO: check stuff here
+	read_reg(spmi, SPMI_RSP_REG); // TODO: check stuff here
 
 	return 0;
 }
@@ -3010,6 +3010,32 @@ static void xhci_update_erst_dequeue(struct xhci_hcd *xhci,
 	xhci_write_64(xhci, temp_64, &ir->ir_set->erst_dequeue);
 }
 
+/*
+ * Scale the moderation interval of an interrupter with the number of events
+ * its last interrupt had to handle, so that event storms from bulk streams
+ * cost fewer interrupts while sparse traffic keeps the configured latency.
+ */
+static void xhci_adapt_imod(struct xhci_hcd *xhci, struct xhci_interrupter *ir,
+			    unsigned int events)
+{
+	u32 imod = ir->imod_cur;
+	u32 temp;
+
+	if (events >= XHCI_IMOD_BUSY_EVENTS)
+		imod = min(imod * 2, ir->imod_max);
+	else if (events <= XHCI_IMOD_IDLE_EVENTS)
+		imod = max(imod / 2, xhci->imod_interval);
+
+	if (imod == ir->imod_cur)
+		return;
+
+	ir->imod_cur = imod;
+	temp = readl(&ir->ir_set->irq_control);
+	temp &= ~ER_IRQ_INTERVAL_MASK;
+	temp |= (imod / 250) & ER_IRQ_INTERVAL_MASK;
+	writel(temp, &ir->ir_set->irq_control);
+}
+
 /*
  * xHCI spec says we can get an interrupt, and if the HC has an error condition,
  * we might get bad data out of the event ring.  Section 4.10.2.7 has a list of
@@ -3024,6 +3050,7 @@ irqreturn_t xhci_irq(struct usb_hcd *hcd)
 	u64 temp_64;
 	u32 status;
 	int event_loop = 0;
+	unsigned int events = 0;
 
 	spin_lock(&xhci->lock);
 	/* Check if the xHC generated the interrupt, or the irq is shared */
@@ -3085,6 +3112,7 @@ irqreturn_t xhci_irq(struct usb_hcd *hcd)
 	 * that clears the EHB.
 	 */
 	while (xhci_handle_event(xhci, ir) > 0) {
+		events++;
 		if (event_loop++ < TRBS_PER_SEGMENT / 2)
 			continue;
 		xhci_update_erst_dequeue(xhci, ir, event_ring_deq);
@@ -3098,6 +3126,8 @@ irqreturn_t xhci_irq(struct usb_hcd *hcd)
 	}
 
 	xhci_update_erst_dequeue(xhci, ir, event_ring_deq);
+	if (ir->imod_max > xhci->imod_interval)
+		xhci_adapt_imod(xhci, ir, events);
 	ret = IRQ_HANDLED;
 
 out:
@@ -38,6 +38,10 @@ static unsigned long long quirks;
 module_param(quirks, ullong, S_IRUGO);
 MODULE_PARM_DESC(quirks, "Bit flags for quirks to be enabled as default");
 
+static bool adaptive_imod;
+module_param(adaptive_imod, bool, S_IRUGO);
+MODULE_PARM_DESC(adaptive_imod, "Raise the interrupt moderation interval under event load");
+
 static bool td_on_ring(struct xhci_td *td, struct xhci_ring *ring)
 {
 	struct xhci_segment *seg = ring->first_seg;
@@ -530,6 +534,12 @@ int xhci_run(struct usb_hcd *hcd)
 	temp &= ~ER_IRQ_INTERVAL_MASK;
 	temp |= (xhci->imod_interval / 250) & ER_IRQ_INTERVAL_MASK;
 	writel(temp, &ir->ir_set->irq_control);
+	ir->imod_cur = xhci->imod_interval;
+	if (adaptive_imod && xhci->imod_interval)
+		ir->imod_max = min_t(u32, xhci->imod_interval * XHCI_IMOD_ADAPTIVE_FACTOR,
+				     ER_IRQ_INTERVAL_MASK * 250);
+	else
+		ir->imod_max = xhci->imod_interval;
 
 	if (xhci->quirks & XHCI_NEC_HOST) {
 		struct xhci_command *command;
@@ -1541,6 +1541,16 @@ static inline const char *xhci_trb_type_string(u8 type)
 #define AVOID_BEI_INTERVAL_MIN	8
 #define AVOID_BEI_INTERVAL_MAX	32
 
+/*
+ * Adaptive interrupt moderation: an interrupt that drains at least
+ * XHCI_IMOD_BUSY_EVENTS events doubles the moderation interval, up to
+ * XHCI_IMOD_ADAPTIVE_FACTOR times the configured one; an interrupt that finds
+ * at most XHCI_IMOD_IDLE_EVENTS halves it again, back to the configured value.
+ */
+#define XHCI_IMOD_ADAPTIVE_FACTOR	8
+#define XHCI_IMOD_BUSY_EVENTS		32
+#define XHCI_IMOD_IDLE_EVENTS		2
+
 struct xhci_segment {
 	union xhci_trb		*trbs;
 	/* private to HCD */
@@ -1713,6 +1723,9 @@ struct xhci_interrupter {
 	struct xhci_erst	erst;
 	struct xhci_intr_reg __iomem *ir_set;
 	unsigned int		intr_num;
+	/* current and upper bound of the adaptive moderation interval, in ns */
+	u32			imod_cur;
+	u32			imod_max;
 	/* For interrupter registers save and restore over suspend/resume */
 	u32	s3_irq_pending;
 	u32	s3_irq_control;
@@ -187,12 +187,14 @@ EXPORT_SYMBOL_GPL(vhost_work_init);
 
 /* Init poll structure */
 void vhost_poll_init(struct vhost_poll *poll, vhost_work_fn_t fn,
-		     __poll_t mask, struct vhost_dev *dev)
+		     __poll_t mask, struct vhost_dev *dev,
+		     struct vhost_virtqueue *vq)
 {
 	init_waitqueue_func_entry(&poll->wait, vhost_poll_wakeup);
 	init_poll_funcptr(&poll->table, vhost_poll_func);
 	poll->mask = mask;
 	poll->dev = dev;
+	poll->vq = vq;
 	poll->wqh = NULL;
 
 	vhost_work_init(&poll->work, fn);
@@ -231,36 +233,71 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
-void vhost_dev_flush(struct vhost_dev *dev)
+static void vhost_worker_queue(struct vhost_worker *worker,
+			       struct vhost_work *work)
+{
+	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
+		/* We can only add the work to the list after we're
+		 * sure it was not in the list.
+		 * test_and_set_bit() implies a memory barrier.
+		 */
+		llist_add(&work->node, &worker->work_list);
+		vhost_task_wake(worker->vtsk);
+	}
+}
+
+static void vhost_worker_flush(struct vhost_worker *worker)
 {
 	struct vhost_flush_struct flush;
 
-	if (dev->worker.vtsk) {
-		init_completion(&flush.wait_event);
-		vhost_work_init(&flush.work, vhost_flush_work);
+	if (!worker->vtsk)
+		return;
 
-		vhost_work_queue(dev, &flush.work);
-		wait_for_completion(&flush.wait_event);
-	}
+	init_completion(&flush.wait_event);
+	vhost_work_init(&flush.work, vhost_flush_work);
+
+	vhost_worker_queue(worker, &flush.work);
+	wait_for_completion(&flush.wait_event);
+}
+
+void vhost_dev_flush(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	unsigned long i;
+
+	xa_for_each(&dev->worker_xa, i, worker)
+		vhost_worker_flush(worker);
 }
 EXPORT_SYMBOL_GPL(vhost_dev_flush);
 
+/* Queue work on the device's default worker. */
 void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
 {
 	if (!dev->worker.vtsk)
 		return;
 
-	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
-		/* We can only add the work to the list after we're
-		 * sure it was not in the list.
-		 * test_and_set_bit() implies a memory barrier.
-		 */
-		llist_add(&work->node, &dev->worker.work_list);
-		vhost_task_wake(dev->worker.vtsk);
-	}
+	vhost_worker_queue(&dev->worker, work);
 }
 EXPORT_SYMBOL_GPL(vhost_work_queue);
 
+/* Queue work on the worker the virtqueue is currently attached to. */
+bool vhost_vq_work_queue(struct vhost_virtqueue *vq, struct vhost_work *work)
+{
+	struct vhost_worker *worker;
+	bool queued = false;
+
+	rcu_read_lock();
+	worker = rcu_dereference(vq->worker);
+	if (worker && worker->vtsk) {
+		vhost_worker_queue(worker, work);
+		queued = true;
+	}
+	rcu_read_unlock();
+
+	return queued;
+}
+EXPORT_SYMBOL_GPL(vhost_vq_work_queue);
+
 /* A lockless hint for busy polling code to exit the loop */
 bool vhost_has_work(struct vhost_dev *dev)
 {
@@ -268,9 +305,28 @@ bool vhost_has_work(struct vhost_dev *dev)
 }
 EXPORT_SYMBOL_GPL(vhost_has_work);
 
+/* Same as vhost_has_work(), for the worker serving @vq */
+bool vhost_vq_has_work(struct vhost_virtqueue *vq)
+{
+	struct vhost_worker *worker;
+	bool has_work = false;
+
+	rcu_read_lock();
+	worker = rcu_dereference(vq->worker);
+	if (worker && !llist_empty(&worker->work_list))
+		has_work = true;
+	rcu_read_unlock();
+
+	return has_work;
+}
+EXPORT_SYMBOL_GPL(vhost_vq_has_work);
+
 void vhost_poll_queue(struct vhost_poll *poll)
 {
-	vhost_work_queue(poll->dev, &poll->work);
+	if (poll->vq)
+		vhost_vq_work_queue(poll->vq, &poll->work);
+	else
+		vhost_work_queue(poll->dev, &poll->work);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_queue);
 
@@ -460,6 +516,7 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->mm = NULL;
 	memset(&dev->worker, 0, sizeof(dev->worker));
 	init_llist_head(&dev->worker.work_list);
+	xa_init_flags(&dev->worker_xa, XA_FLAGS_ALLOC);
 	dev->iov_limit = iov_limit;
 	dev->weight = weight;
 	dev->byte_weight = byte_weight;
@@ -477,11 +534,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 		vq->indirect = NULL;
 		vq->heads = NULL;
 		vq->dev = dev;
+		RCU_INIT_POINTER(vq->worker, NULL);
 		mutex_init(&vq->mutex);
 		vhost_vq_reset(dev, vq);
 		if (vq->handle_kick)
 			vhost_poll_init(&vq->poll, vq->handle_kick,
-					EPOLLIN, dev);
+					EPOLLIN, dev, vq);
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_dev_init);
@@ -531,38 +589,166 @@ static void vhost_detach_mm(struct vhost_dev *dev)
 	dev->mm = NULL;
 }
 
-static void vhost_worker_free(struct vhost_dev *dev)
+static void vhost_worker_free(struct vhost_dev *dev,
+			      struct vhost_worker *worker)
 {
-	if (!dev->worker.vtsk)
+	if (!worker->vtsk)
 		return;
 
-	WARN_ON(!llist_empty(&dev->worker.work_list));
-	vhost_task_stop(dev->worker.vtsk);
-	dev->worker.kcov_handle = 0;
-	dev->worker.vtsk = NULL;
+	WARN_ON(!llist_empty(&worker->work_list));
+	xa_erase(&dev->worker_xa, worker->id);
+	vhost_task_stop(worker->vtsk);
+	worker->kcov_handle = 0;
+	worker->vtsk = NULL;
+	worker->attachment_cnt = 0;
+	if (worker != &dev->worker)
+		kfree(worker);
+}
+
+/* Caller should have device mutex and have stopped all virtqueues. */
+static void vhost_workers_free(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	unsigned long i;
+
+	for (i = 0; i < dev->nvqs; i++)
+		rcu_assign_pointer(dev->vqs[i]->worker, NULL);
+
+	xa_for_each(&dev->worker_xa, i, worker)
+		vhost_worker_free(dev, worker);
 }
 
-static int vhost_worker_create(struct vhost_dev *dev)
+static int vhost_worker_create(struct vhost_dev *dev,
+			       struct vhost_worker *worker)
 {
 	struct vhost_task *vtsk;
 	char name[TASK_COMM_LEN];
+	u32 id;
+	int ret;
 
 	snprintf(name, sizeof(name), "vhost-%d", current->pid);
 
-	vtsk = vhost_task_create(vhost_worker, &dev->worker, name);
-	if (!vtsk)
+	init_llist_head(&worker->work_list);
+	ret = xa_alloc(&dev->worker_xa, &id, worker, xa_limit_32b, GFP_KERNEL);
+	if (ret < 0)
+		return ret;
+
+	vtsk = vhost_task_create(vhost_worker, worker, name);
+	if (!vtsk) {
+		xa_erase(&dev->worker_xa, id);
 		return -ENOMEM;
+	}
 
-	dev->worker.kcov_handle = kcov_common_handle();
-	dev->worker.vtsk = vtsk;
+	worker->id = id;
+	worker->attachment_cnt = 0;
+	worker->kcov_handle = kcov_common_handle();
+	worker->vtsk = vtsk;
 	vhost_task_start(vtsk);
 	return 0;
 }
 
+/* Caller should have device mutex */
+static long vhost_new_worker(struct vhost_dev *dev, void __user *argp)
+{
+	struct vhost_worker_state state;
+	struct vhost_worker *worker;
+	long r;
+
+	if (!dev->use_worker)
+		return -EINVAL;
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL_ACCOUNT);
+	if (!worker)
+		return -ENOMEM;
+
+	r = vhost_worker_create(dev, worker);
+	if (r) {
+		kfree(worker);
+		return r;
+	}
+
+	state.worker_id = worker->id;
+	if (copy_to_user(argp, &state, sizeof(state))) {
+		vhost_worker_free(dev, worker);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+/* Caller should have device mutex */
+static long vhost_free_worker(struct vhost_dev *dev, void __user *argp)
+{
+	struct vhost_worker_state state;
+	struct vhost_worker *worker;
+
+	if (copy_from_user(&state, argp, sizeof(state)))
+		return -EFAULT;
+
+	worker = xa_load(&dev->worker_xa, state.worker_id);
+	/* The default worker lives as long as the device has an owner. */
+	if (!worker || worker == &dev->worker)
+		return -ENODEV;
+
+	if (worker->attachment_cnt)
+		return -EBUSY;
+
+	vhost_worker_free(dev, worker);
+	return 0;
+}
+
+/* Caller should have device mutex */
+static long vhost_vring_worker_ioctl(struct vhost_dev *dev, unsigned int ioctl,
+				     void __user *argp)
+{
+	struct vhost_worker *worker, *old_worker;
+	struct vhost_vring_worker ring_worker;
+	struct vhost_virtqueue *vq;
+
+	if (copy_from_user(&ring_worker, argp, sizeof(ring_worker)))
+		return -EFAULT;
+
+	if (ring_worker.index >= dev->nvqs)
+		return -ENOBUFS;
+	vq = dev->vqs[array_index_nospec(ring_worker.index, dev->nvqs)];
+
+	old_worker = rcu_dereference_protected(vq->worker,
+					       lockdep_is_held(&dev->mutex));
+	if (!old_worker)
+		return -EINVAL;
+
+	if (ioctl == VHOST_GET_VRING_WORKER) {
+		ring_worker.worker_id = old_worker->id;
+		if (copy_to_user(argp, &ring_worker, sizeof(ring_worker)))
+			return -EFAULT;
+		return 0;
+	}
+
+	worker = xa_load(&dev->worker_xa, ring_worker.worker_id);
+	if (!worker)
+		return -ENODEV;
+	if (worker == old_worker)
+		return 0;
+
+	mutex_lock(&vq->mutex);
+	rcu_assign_pointer(vq->worker, worker);
+	worker->attachment_cnt++;
+	old_worker->attachment_cnt--;
+	mutex_unlock(&vq->mutex);
+
+	/* Wait for vhost_vq_work_queue() callers still using the old worker
+	 * pointer, then let it drain whatever they queued so that the vq's
+	 * work never runs on two workers at once after we return.
+	 */
+	synchronize_rcu();
+	vhost_worker_flush(old_worker);
+	return 0;
+}
+
 /* Caller should have device mutex */
 long vhost_dev_set_owner(struct vhost_dev *dev)
 {
-	int err;
+	int err, i;
 
 	/* Is there an owner already? */
 	if (vhost_dev_has_owner(dev)) {
@@ -573,9 +759,16 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 	vhost_attach_mm(dev);
 
 	if (dev->use_worker) {
-		err = vhost_worker_create(dev);
+		err = vhost_worker_create(dev, &dev->worker);
 		if (err)
 			goto err_worker;
+
+		/* All virtqueues share the default worker until userspace
+		 * attaches them to workers created with VHOST_NEW_WORKER.
+		 */
+		for (i = 0; i < dev->nvqs; i++)
+			rcu_assign_pointer(dev->vqs[i]->worker, &dev->worker);
+		dev->worker.attachment_cnt = dev->nvqs;
 	}
 
 	err = vhost_dev_alloc_iovecs(dev);
@@ -584,7 +777,7 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	return 0;
 err_iovecs:
-	vhost_worker_free(dev);
+	vhost_workers_free(dev);
 err_worker:
 	vhost_detach_mm(dev);
 err_mm:
@@ -677,7 +870,7 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
-	vhost_worker_free(dev);
+	vhost_workers_free(dev);
 	vhost_detach_mm(dev);
 }
 EXPORT_SYMBOL_GPL(vhost_dev_cleanup);
@@ -1755,6 +1948,16 @@ long vhost_dev_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *argp)
 	case VHOST_SET_MEM_TABLE:
 		r = vhost_set_memory(d, argp);
 		break;
+	case VHOST_NEW_WORKER:
+		r = vhost_new_worker(d, argp);
+		break;
+	case VHOST_FREE_WORKER:
+		r = vhost_free_worker(d, argp);
+		break;
+	case VHOST_ATTACH_VRING_WORKER:
+	case VHOST_GET_VRING_WORKER:
+		r = vhost_vring_worker_ioctl(d, ioctl, argp);
+		break;
 	case VHOST_SET_LOG_BASE:
 		if (copy_from_user(&p, argp, sizeof p)) {
 			r = -EFAULT;
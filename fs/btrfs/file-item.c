@@ -8,6 +8,8 @@
 #include <linux/pagemap.h>
 #include <linux/highmem.h>
 #include <linux/sched/mm.h>
+#include <linux/crc32.h>
+#include <asm/unaligned.h>
 #include <crypto/hash.h>
 #include "messages.h"
 #include "misc.h"
@@ -716,6 +718,21 @@ int btrfs_lookup_csums_bitmap(struct btrfs_root *root, u64 start, u64 end,
 	return ret;
 }
 
+/*
+ * Checksum one sector.  crc32c, the default, calls the library directly, which
+ * uses the CRC instructions where available, instead of going through an
+ * indirect shash call and descriptor setup for every sector.
+ */
+static void csum_one_sector(const struct btrfs_fs_info *fs_info, bool crc32c,
+			    struct shash_desc *shash, const u8 *data, u8 *csum)
+{
+	if (crc32c)
+		put_unaligned_le32(~__crc32c_le(~0, data, fs_info->sectorsize),
+				   csum);
+	else
+		crypto_shash_digest(shash, data, fs_info->sectorsize, csum);
+}
+
 /*
  * Calculate checksums of the data contained inside a bio.
  */
@@ -735,6 +752,8 @@ blk_status_t btrfs_csum_one_bio(struct btrfs_bio *bbio)
 	unsigned int blockcount;
 	unsigned long total_bytes = 0;
 	unsigned long this_sum_bytes = 0;
+	const bool crc32c = btrfs_super_csum_type(fs_info->super_copy) ==
+			    BTRFS_CSUM_TYPE_CRC32;
 	int i;
 	unsigned nofs_flag;
 
@@ -775,6 +794,7 @@ blk_status_t btrfs_csum_one_bio(struct btrfs_bio *bbio)
 						 bvec.bv_len + fs_info->sectorsize
 						 - 1);
 
+		data = bvec_kmap_local(&bvec);
 		for (i = 0; i < blockcount; i++) {
 			if (!(bio->bi_opf & REQ_BTRFS_ONE_ORDERED) &&
 			    !in_range(offset, ordered->file_offset,
@@ -792,8 +812,10 @@ blk_status_t btrfs_csum_one_bio(struct btrfs_bio *bbio)
 				sums = kvzalloc(btrfs_ordered_sum_size(fs_info,
 						      bytes_left), GFP_KERNEL);
 				memalloc_nofs_restore(nofs_flag);
-				if (!sums)
+				if (!sums) {
+					kunmap_local(data);
 					return BLK_STS_RESOURCE;
+				}
 
 				sums->len = bytes_left;
 				ordered = btrfs_lookup_ordered_extent(inode,
@@ -804,17 +826,15 @@ blk_status_t btrfs_csum_one_bio(struct btrfs_bio *bbio)
 				index = 0;
 			}
 
-			data = bvec_kmap_local(&bvec);
-			crypto_shash_digest(shash,
-					    data + (i * fs_info->sectorsize),
-					    fs_info->sectorsize,
-					    sums->sums + index);
-			kunmap_local(data);
+			csum_one_sector(fs_info, crc32c, shash,
+					data + (i * fs_info->sectorsize),
+					sums->sums + index);
 			index += fs_info->csum_size;
 			offset += fs_info->sectorsize;
 			this_sum_bytes += fs_info->sectorsize;
 			total_bytes += fs_info->sectorsize;
 		}
+		kunmap_local(data);
 
 	}
 	this_sum_bytes = 0;
@@ -1530,6 +1530,23 @@ static noinline void async_cow_free(struct btrfs_work *work)
 		kvfree(async_cow);
 }
 
+/*
+ * Each async chunk is compressed by a single delalloc worker, one
+ * BTRFS_MAX_UNCOMPRESSED extent after the other.  Use smaller chunks when the
+ * range would otherwise not keep all workers busy, but never go below the
+ * size of one compressed extent.
+ */
+static u64 async_chunk_size(const struct btrfs_fs_info *fs_info, u64 len)
+{
+	const u32 workers = READ_ONCE(fs_info->thread_pool_size);
+	u64 size = SZ_512K;
+
+	while (size > BTRFS_MAX_UNCOMPRESSED && DIV_ROUND_UP(len, size) < workers)
+		size >>= 1;
+
+	return size;
+}
+
 static bool cow_file_range_async(struct btrfs_inode *inode,
 				 struct writeback_control *wbc,
 				 struct page *locked_page,
@@ -1541,7 +1558,8 @@ static bool cow_file_range_async(struct btrfs_inode *inode,
 	struct async_cow *ctx;
 	struct async_chunk *async_chunk;
 	unsigned long nr_pages;
-	u64 num_chunks = DIV_ROUND_UP(end - start, SZ_512K);
+	const u64 chunk_size = async_chunk_size(fs_info, end + 1 - start);
+	u64 num_chunks = DIV_ROUND_UP(end - start, chunk_size);
 	int i;
 	unsigned nofs_flag;
 	const blk_opf_t write_flags = wbc_to_write_flags(wbc);
@@ -1559,7 +1577,7 @@ static bool cow_file_range_async(struct btrfs_inode *inode,
 	atomic_set(&ctx->num_chunks, num_chunks);
 
 	for (i = 0; i < num_chunks; i++) {
-		u64 cur_end = min(end, start + SZ_512K - 1);
+		u64 cur_end = min(end, start + chunk_size - 1);
 
 		/*
 		 * igrab is called higher up in the call chain, take only the
@@ -45,7 +45,7 @@ struct scrub_ctx;
  *
  * This determines the batch size for stripe submitted in one go.
  */
-#define SCRUB_STRIPES_PER_SCTX	8	/* That would be 8 64K stripe per-device. */
+#define SCRUB_STRIPES_PER_SCTX	16	/* That would be 16 64K stripe per-device. */
 
 /*
  * The following value times PAGE_SIZE needs to be large enough to match the
@@ -53,6 +53,16 @@ struct scrub_ctx;
  */
 #define SCRUB_MAX_SECTORS_PER_BLOCK	(BTRFS_MAX_METADATA_BLOCKSIZE / SZ_4K)
 
+/*
+ * Adaptive throttling: a batch taking more than SCRUB_BACKOFF_RATIO times as
+ * long as the fastest recent one means the device is busy with other IO, and
+ * scrub sleeps for up to SCRUB_BACKOFF_MAX batch durations before the next
+ * one.  The fastest time is forgotten every SCRUB_BACKOFF_WINDOW batches.
+ */
+#define SCRUB_BACKOFF_RATIO	2
+#define SCRUB_BACKOFF_MAX	8
+#define SCRUB_BACKOFF_WINDOW	256
+
 /* Represent one sector and its needed info to verify the content. */
 struct scrub_sector_verification {
 	bool is_metadata;
@@ -186,6 +196,11 @@ struct scrub_ctx {
 	ktime_t			throttle_deadline;
 	u64			throttle_sent;
 
+	/* State of the adaptive throttling, see scrub_backoff() */
+	u64			backoff_min_ns;
+	unsigned int		backoff_batches;
+	unsigned int		backoff_level;
+
 	int			is_dev_replace;
 	u64			write_pointer;
 
@@ -1278,6 +1293,35 @@ static void scrub_throttle_dev_io(struct scrub_ctx *sctx, struct btrfs_device *d
 	sctx->throttle_deadline = 0;
 }
 
+/*
+ * Back off while the device is serving other IO, detected by the read time of
+ * a full batch of stripes going up compared to the best one seen lately.  On
+ * an idle device this never sleeps.  Dev-replace is not throttled this way.
+ */
+static void scrub_backoff(struct scrub_ctx *sctx, ktime_t start, int nr_stripes)
+{
+	u64 ns;
+
+	if (sctx->is_dev_replace || nr_stripes < SCRUB_STRIPES_PER_SCTX)
+		return;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (sctx->backoff_batches++ % SCRUB_BACKOFF_WINDOW == 0 ||
+	    ns < sctx->backoff_min_ns)
+		sctx->backoff_min_ns = ns;
+
+	if (ns > SCRUB_BACKOFF_RATIO * sctx->backoff_min_ns) {
+		if (sctx->backoff_level < SCRUB_BACKOFF_MAX)
+			sctx->backoff_level++;
+	} else if (sctx->backoff_level) {
+		sctx->backoff_level--;
+	}
+
+	if (sctx->backoff_level)
+		schedule_timeout_interruptible(nsecs_to_jiffies(ns *
+							sctx->backoff_level));
+}
+
 /*
  * Given a physical address, this will calculate it's
  * logical offset. if this is a parity stripe, it will return
@@ -1707,6 +1751,7 @@ static int flush_scrub_stripes(struct scrub_ctx *sctx)
 	struct btrfs_fs_info *fs_info = sctx->fs_info;
 	struct scrub_stripe *stripe;
 	const int nr_stripes = sctx->cur_stripe;
+	ktime_t start;
 	int ret = 0;
 
 	if (!nr_stripes)
@@ -1716,6 +1761,7 @@ static int flush_scrub_stripes(struct scrub_ctx *sctx)
 
 	scrub_throttle_dev_io(sctx, sctx->stripes[0].dev,
 			      btrfs_stripe_nr_to_offset(nr_stripes));
+	start = ktime_get();
 	for (int i = 0; i < nr_stripes; i++) {
 		stripe = &sctx->stripes[i];
 		scrub_submit_initial_read(sctx, stripe);
@@ -1727,6 +1773,7 @@ static int flush_scrub_stripes(struct scrub_ctx *sctx)
 		wait_event(stripe->repair_wait,
 			   test_bit(SCRUB_STRIPE_FLAG_REPAIR_DONE, &stripe->state));
 	}
+	scrub_backoff(sctx, start, nr_stripes);
 
 	/*
 	 * Submit the repaired sectors.  For zoned case, we cannot do repair
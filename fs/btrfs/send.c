@@ -5512,9 +5512,7 @@ static int send_encoded_inline_extent(struct send_ctx *sctx,
 				      struct btrfs_path *path, u64 offset,
 				      u64 len)
 {
-	struct btrfs_root *root = sctx->send_root;
-	struct btrfs_fs_info *fs_info = root->fs_info;
-	struct inode *inode;
+	struct btrfs_fs_info *fs_info = sctx->send_root->fs_info;
 	struct fs_path *fspath;
 	struct extent_buffer *leaf = path->nodes[0];
 	struct btrfs_key key;
@@ -5523,10 +5521,6 @@ static int send_encoded_inline_extent(struct send_ctx *sctx,
 	size_t inline_size;
 	int ret;
 
-	inode = btrfs_iget(fs_info->sb, sctx->cur_ino, root);
-	if (IS_ERR(inode))
-		return PTR_ERR(inode);
-
 	fspath = fs_path_alloc();
 	if (!fspath) {
 		ret = -ENOMEM;
@@ -5570,16 +5564,59 @@ static int send_encoded_inline_extent(struct send_ctx *sctx,
 tlv_put_failure:
 out:
 	fs_path_free(fspath);
-	iput(inode);
 	return ret;
 }
 
+/*
+ * Open the inode being sent, once for all of its extents. It is released by
+ * close_current_inode() when we move on to the next inode.
+ */
+static int get_cur_inode(struct send_ctx *sctx, u64 offset)
+{
+	struct btrfs_root *root = sctx->send_root;
+
+	if (sctx->cur_inode)
+		return 0;
+
+	sctx->cur_inode = btrfs_iget(root->fs_info->sb, sctx->cur_ino, root);
+	if (IS_ERR(sctx->cur_inode)) {
+		int err = PTR_ERR(sctx->cur_inode);
+
+		sctx->cur_inode = NULL;
+		return err;
+	}
+	memset(&sctx->ra, 0, sizeof(struct file_ra_state));
+	file_ra_state_init(&sctx->ra, sctx->cur_inode->i_mapping);
+
+	/*
+	 * It's very likely there are no pages from this inode in the page
+	 * cache, so after reading extents and sending their data, we clean
+	 * the page cache to avoid trashing the page cache (adding pressure
+	 * to the page cache and forcing eviction of other data more useful
+	 * for applications).
+	 *
+	 * We decide if we should clean the page cache simply by checking
+	 * if the inode's mapping nrpages is 0 when we first open it, and
+	 * not by using something like filemap_range_has_page() before
+	 * reading an extent because when we ask the readahead code to
+	 * read a given file range, it may (and almost always does) read
+	 * pages from beyond that range (see the documentation for
+	 * page_cache_sync_readahead()), so it would not be reliable,
+	 * because after reading the first extent future calls to
+	 * filemap_range_has_page() would return true because the readahead
+	 * on the previous extent resulted in reading pages of the current
+	 * extent as well.
+	 */
+	sctx->clean_page_cache = (sctx->cur_inode->i_mapping->nrpages == 0);
+	sctx->page_cache_clear_start = round_down(offset, PAGE_SIZE);
+
+	return 0;
+}
+
 static int send_encoded_extent(struct send_ctx *sctx, struct btrfs_path *path,
 			       u64 offset, u64 len)
 {
-	struct btrfs_root *root = sctx->send_root;
-	struct btrfs_fs_info *fs_info = root->fs_info;
-	struct inode *inode;
+	struct btrfs_fs_info *fs_info = sctx->send_root->fs_info;
 	struct fs_path *fspath;
 	struct extent_buffer *leaf = path->nodes[0];
 	struct btrfs_key key;
@@ -5590,9 +5627,9 @@ static int send_encoded_extent(struct send_ctx *sctx, struct btrfs_path *path,
 	u32 crc;
 	int ret;
 
-	inode = btrfs_iget(fs_info->sb, sctx->cur_ino, root);
-	if (IS_ERR(inode))
-		return PTR_ERR(inode);
+	ret = get_cur_inode(sctx, offset);
+	if (ret < 0)
+		return ret;
 
 	fspath = fs_path_alloc();
 	if (!fspath) {
@@ -5649,7 +5686,8 @@ static int send_encoded_extent(struct send_ctx *sctx, struct btrfs_path *path,
 	 * Note that send_buf is a mapping of send_buf_pages, so this is really
 	 * reading into send_buf.
 	 */
-	ret = btrfs_encoded_read_regular_fill_pages(BTRFS_I(inode), offset,
+	ret = btrfs_encoded_read_regular_fill_pages(BTRFS_I(sctx->cur_inode),
+						    offset,
 						    disk_bytenr, disk_num_bytes,
 						    sctx->send_buf_pages +
 						    (data_offset >> PAGE_SHIFT));
@@ -5675,7 +5713,6 @@ static int send_encoded_extent(struct send_ctx *sctx, struct btrfs_path *path,
 tlv_put_failure:
 out:
 	fs_path_free(fspath);
-	iput(inode);
 	return ret;
 }
 
@@ -5687,6 +5724,7 @@ static int send_extent_data(struct send_ctx *sctx, struct btrfs_path *path,
 	struct btrfs_file_extent_item *ei;
 	u64 read_size = max_send_read_size(sctx);
 	u64 sent = 0;
+	int ret;
 
 	if (sctx->flags & BTRFS_SEND_FLAG_NO_FILE_DATA)
 		return send_update_extent(sctx, offset, len);
@@ -5716,45 +5754,12 @@ static int send_extent_data(struct send_ctx *sctx, struct btrfs_path *path,
 		}
 	}
 
-	if (sctx->cur_inode == NULL) {
-		struct btrfs_root *root = sctx->send_root;
-
-		sctx->cur_inode = btrfs_iget(root->fs_info->sb, sctx->cur_ino, root);
-		if (IS_ERR(sctx->cur_inode)) {
-			int err = PTR_ERR(sctx->cur_inode);
-
-			sctx->cur_inode = NULL;
-			return err;
-		}
-		memset(&sctx->ra, 0, sizeof(struct file_ra_state));
-		file_ra_state_init(&sctx->ra, sctx->cur_inode->i_mapping);
-
-		/*
-		 * It's very likely there are no pages from this inode in the page
-		 * cache, so after reading extents and sending their data, we clean
-		 * the page cache to avoid trashing the page cache (adding pressure
-		 * to the page cache and forcing eviction of other data more useful
-		 * for applications).
-		 *
-		 * We decide if we should clean the page cache simply by checking
-		 * if the inode's mapping nrpages is 0 when we first open it, and
-		 * not by using something like filemap_range_has_page() before
-		 * reading an extent because when we ask the readahead code to
-		 * read a given file range, it may (and almost always does) read
-		 * pages from beyond that range (see the documentation for
-		 * page_cache_sync_readahead()), so it would not be reliable,
-		 * because after reading the first extent future calls to
-		 * filemap_range_has_page() would return true because the readahead
-		 * on the previous extent resulted in reading pages of the current
-		 * extent as well.
-		 */
-		sctx->clean_page_cache = (sctx->cur_inode->i_mapping->nrpages == 0);
-		sctx->page_cache_clear_start = round_down(offset, PAGE_SIZE);
-	}
+	ret = get_cur_inode(sctx, offset);
+	if (ret < 0)
+		return ret;
 
 	while (sent < len) {
 		u64 size = min(len - sent, read_size);
-		int ret;
 
 		ret = send_write(sctx, offset + sent, size);
 		if (ret < 0)
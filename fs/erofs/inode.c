@@ -293,6 +293,7 @@ static int erofs_fill_inode(struct inode *inode)
 		if (!erofs_is_fscache_mode(inode->i_sb) &&
 		    inode->i_sb->s_blocksize_bits == PAGE_SHIFT) {
 			inode->i_mapping->a_ops = &z_erofs_aops;
+			mapping_set_large_folios(inode->i_mapping);
 			err = 0;
 			goto out_unlock;
 		}
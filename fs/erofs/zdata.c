@@ -124,50 +124,52 @@ static inline unsigned int z_erofs_pclusterpages(struct z_erofs_pcluster *pcl)
 }
 
 /*
- * bit 30: I/O error occurred on this page
- * bit 0 - 29: remaining parts to complete this page
+ * The counter lives in folio->private of the (possibly large) file folio,
+ * every part of every page in it holds a reference.
+ * bit 30: I/O error occurred on this folio
+ * bit 0 - 29: remaining parts to complete this folio
  */
-#define Z_EROFS_PAGE_EIO			(1 << 30)
+#define Z_EROFS_FOLIO_EIO			(1 << 30)
 
-static inline void z_erofs_onlinepage_init(struct page *page)
+static inline void z_erofs_onlinefolio_init(struct folio *folio)
 {
 	union {
 		atomic_t o;
-		unsigned long v;
+		void *v;
 	} u = { .o = ATOMIC_INIT(1) };
 
-	set_page_private(page, u.v);
+	folio->private = u.v;
 	smp_wmb();
-	SetPagePrivate(page);
+	folio_set_private(folio);
 }
 
-static inline void z_erofs_onlinepage_split(struct page *page)
+static inline void z_erofs_onlinefolio_split(struct folio *folio)
 {
-	atomic_inc((atomic_t *)&page->private);
+	atomic_inc((atomic_t *)&folio->private);
 }
 
-static inline void z_erofs_page_mark_eio(struct page *page)
+static inline void z_erofs_folio_mark_eio(struct folio *folio)
 {
 	int orig;
 
 	do {
-		orig = atomic_read((atomic_t *)&page->private);
-	} while (atomic_cmpxchg((atomic_t *)&page->private, orig,
-				orig | Z_EROFS_PAGE_EIO) != orig);
+		orig = atomic_read((atomic_t *)&folio->private);
+	} while (atomic_cmpxchg((atomic_t *)&folio->private, orig,
+				orig | Z_EROFS_FOLIO_EIO) != orig);
 }
 
-static inline void z_erofs_onlinepage_endio(struct page *page)
+static inline void z_erofs_onlinefolio_end(struct folio *folio)
 {
 	unsigned int v;
 
-	DBG_BUGON(!PagePrivate(page));
-	v = atomic_dec_return((atomic_t *)&page->private);
-	if (!(v & ~Z_EROFS_PAGE_EIO)) {
-		set_page_private(page, 0);
-		ClearPagePrivate(page);
-		if (!(v & Z_EROFS_PAGE_EIO))
-			SetPageUptodate(page);
-		unlock_page(page);
+	DBG_BUGON(!folio_test_private(folio));
+	v = atomic_dec_return((atomic_t *)&folio->private);
+	if (!(v & ~Z_EROFS_FOLIO_EIO)) {
+		folio->private = NULL;
+		folio_clear_private(folio);
+		if (!(v & Z_EROFS_FOLIO_EIO))
+			folio_mark_uptodate(folio);
+		folio_unlock(folio);
 	}
 }
 
@@ -920,19 +922,17 @@ static int z_erofs_read_fragment(struct inode *inode, erofs_off_t pos,
 	return 0;
 }
 
+/* @page is a page of the online folio @folio, at file position @offset */
 static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
-				struct page *page, struct page **pagepool)
+				struct folio *folio, struct page *page,
+				loff_t offset, struct page **pagepool)
 {
 	struct inode *const inode = fe->inode;
 	struct erofs_map_blocks *const map = &fe->map;
-	const loff_t offset = page_offset(page);
 	bool tight = true, exclusive;
 	unsigned int cur, end, spiltted;
 	int err = 0;
 
-	/* register locked file pages as online pages in pack */
-	z_erofs_onlinepage_init(page);
-
 	spiltted = 0;
 	end = PAGE_SIZE;
 repeat:
@@ -1037,7 +1037,7 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 		goto out;
 	}
 
-	z_erofs_onlinepage_split(page);
+	z_erofs_onlinefolio_split(folio);
 	/* bump up the number of spiltted parts of a page */
 	++spiltted;
 	if (fe->pcl->pageofs_out != (map->m_la & ~PAGE_MASK))
@@ -1060,9 +1060,27 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 		goto repeat;
 
 out:
+	return err;
+}
+
+static int z_erofs_scan_folio(struct z_erofs_decompress_frontend *fe,
+			      struct folio *folio, struct page **pagepool)
+{
+	long i = folio_nr_pages(folio);
+	int err = 0;
+
+	/* register locked file folios as online folios in pack */
+	z_erofs_onlinefolio_init(folio);
+
+	/* pages are attached back to front, as readahead hands them out */
+	while (!err && --i >= 0)
+		err = z_erofs_do_read_page(fe, folio, folio_page(folio, i),
+					   folio_pos(folio) +
+					   ((loff_t)i << PAGE_SHIFT), pagepool);
+
 	if (err)
-		z_erofs_page_mark_eio(page);
-	z_erofs_onlinepage_endio(page);
+		z_erofs_folio_mark_eio(folio);
+	z_erofs_onlinefolio_end(folio);
 	return err;
 }
 
@@ -1083,7 +1101,7 @@ static bool z_erofs_get_sync_decompress_policy(struct erofs_sb_info *sbi,
 
 static bool z_erofs_page_is_invalidated(struct page *page)
 {
-	return !page->mapping && !z_erofs_is_shortlived_page(page);
+	return !page_folio(page)->mapping && !z_erofs_is_shortlived_page(page);
 }
 
 struct z_erofs_decompress_backend {
@@ -1166,8 +1184,8 @@ static void z_erofs_fill_other_copies(struct z_erofs_decompress_backend *be,
 		}
 		kunmap_local(dst);
 		if (err)
-			z_erofs_page_mark_eio(bvi->bvec.page);
-		z_erofs_onlinepage_endio(bvi->bvec.page);
+			z_erofs_folio_mark_eio(page_folio(bvi->bvec.page));
+		z_erofs_onlinefolio_end(page_folio(bvi->bvec.page));
 		list_del(p);
 		kfree(bvi);
 	}
@@ -1337,8 +1355,8 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 		if (z_erofs_put_shortlivedpage(be->pagepool, page))
 			continue;
 		if (err)
-			z_erofs_page_mark_eio(page);
-		z_erofs_onlinepage_endio(page);
+			z_erofs_folio_mark_eio(page_folio(page));
+		z_erofs_onlinefolio_end(page_folio(page));
 	}
 
 	if (be->decompressed_pages != be->onstack_pages)
@@ -1470,7 +1488,8 @@ static struct page *pickup_page_for_submission(struct z_erofs_pcluster *pcl,
 		tocache = true;
 		goto out_tocache;
 	}
-	mapping = READ_ONCE(page->mapping);
+	/* tail pages of large file folios have no ->mapping of their own */
+	mapping = READ_ONCE(page_folio(page)->mapping);
 
 	/*
 	 * file-backed online pages in plcuster are all locked steady,
@@ -1810,43 +1829,45 @@ static void z_erofs_pcluster_readmore(struct z_erofs_decompress_frontend *f,
 	cur = map->m_la + map->m_llen - 1;
 	while ((cur >= end) && (cur < i_size_read(inode))) {
 		pgoff_t index = cur >> PAGE_SHIFT;
-		struct page *page;
-
-		page = erofs_grab_cache_page_nowait(inode->i_mapping, index);
-		if (page) {
-			if (PageUptodate(page)) {
-				unlock_page(page);
+		erofs_off_t start = (erofs_off_t)index << PAGE_SHIFT;
+		struct folio *folio;
+
+		folio = erofs_grab_folio_nowait(inode->i_mapping, index);
+		if (!IS_ERR(folio)) {
+			start = folio_pos(folio);
+			if (folio_test_uptodate(folio)) {
+				folio_unlock(folio);
 			} else {
-				err = z_erofs_do_read_page(f, page, pagepool);
+				err = z_erofs_scan_folio(f, folio, pagepool);
 				if (err)
 					erofs_err(inode->i_sb,
 						  "readmore error at page %lu @ nid %llu",
 						  index, EROFS_I(inode)->nid);
 			}
-			put_page(page);
+			folio_put(folio);
 		}
 
-		if (cur < PAGE_SIZE)
+		if (!start)
 			break;
-		cur = (index << PAGE_SHIFT) - 1;
+		cur = start - 1;
 	}
 }
 
 static int z_erofs_read_folio(struct file *file, struct folio *folio)
 {
-	struct page *page = &folio->page;
-	struct inode *const inode = page->mapping->host;
+	struct inode *const inode = folio->mapping->host;
 	struct erofs_sb_info *const sbi = EROFS_I_SB(inode);
 	struct z_erofs_decompress_frontend f = DECOMPRESS_FRONTEND_INIT(inode);
 	struct page *pagepool = NULL;
 	int err;
 
-	trace_erofs_readpage(page, false);
-	f.headoffset = (erofs_off_t)page->index << PAGE_SHIFT;
+	trace_erofs_readpage(&folio->page, false);
+	f.headoffset = folio_pos(folio);
 
-	z_erofs_pcluster_readmore(&f, NULL, f.headoffset + PAGE_SIZE - 1,
+	z_erofs_pcluster_readmore(&f, NULL,
+				  f.headoffset + folio_size(folio) - 1,
 				  &pagepool, true);
-	err = z_erofs_do_read_page(&f, page, &pagepool);
+	err = z_erofs_scan_folio(&f, folio, &pagepool);
 	z_erofs_pcluster_readmore(&f, NULL, 0, &pagepool, false);
 
 	(void)z_erofs_collector_end(&f);
@@ -1868,7 +1889,8 @@ static void z_erofs_readahead(struct readahead_control *rac)
 	struct inode *const inode = rac->mapping->host;
 	struct erofs_sb_info *const sbi = EROFS_I_SB(inode);
 	struct z_erofs_decompress_frontend f = DECOMPRESS_FRONTEND_INIT(inode);
-	struct page *pagepool = NULL, *head = NULL, *page;
+	struct page *pagepool = NULL;
+	struct folio *head = NULL, *folio;
 	unsigned int nr_pages;
 
 	f.readahead = true;
@@ -1879,24 +1901,23 @@ static void z_erofs_readahead(struct readahead_control *rac)
 	nr_pages = readahead_count(rac);
 	trace_erofs_readpages(inode, readahead_index(rac), nr_pages, false);
 
-	while ((page = readahead_page(rac))) {
-		set_page_private(page, (unsigned long)head);
-		head = page;
+	while ((folio = readahead_folio(rac))) {
+		folio->private = head;
+		head = folio;
 	}
 
 	while (head) {
-		struct page *page = head;
+		struct folio *folio = head;
 		int err;
 
 		/* traversal in reverse order */
-		head = (void *)page_private(page);
+		head = folio->private;
 
-		err = z_erofs_do_read_page(&f, page, &pagepool);
+		err = z_erofs_scan_folio(&f, folio, &pagepool);
 		if (err)
 			erofs_err(inode->i_sb,
 				  "readahead error at page %lu @ nid %llu",
-				  page->index, EROFS_I(inode)->nid);
-		put_page(page);
+				  folio->index, EROFS_I(inode)->nid);
 	}
 	z_erofs_pcluster_readmore(&f, rac, 0, &pagepool, false);
 	(void)z_erofs_collector_end(&f);
@@ -227,6 +227,8 @@ struct eventpoll {
 #ifdef CONFIG_NET_RX_BUSY_POLL
 	/* used to track busy poll napi_id */
 	unsigned int napi_id;
+	/* SO_PREFER_BUSY_POLL of the socket that napi_id came from */
+	bool prefer_busy_poll;
 #endif
 
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
@@ -404,23 +406,40 @@ static bool ep_busy_loop_end(void *p, unsigned long start_time)
 static bool ep_busy_loop(struct eventpoll *ep, int nonblock)
 {
 	unsigned int napi_id = READ_ONCE(ep->napi_id);
+	bool prefer_busy_poll = READ_ONCE(ep->prefer_busy_poll);
 
 	if ((napi_id >= MIN_NAPI_ID) && net_busy_loop_on()) {
-		napi_busy_loop(napi_id, nonblock ? NULL : ep_busy_loop_end, ep, false,
-			       BUSY_POLL_BUDGET);
+		napi_busy_loop(napi_id, nonblock ? NULL : ep_busy_loop_end, ep,
+			       prefer_busy_poll, BUSY_POLL_BUDGET);
 		if (ep_events_available(ep))
 			return true;
 		/*
 		 * Busy poll timed out.  Drop NAPI ID for now, we can add
 		 * it back in when we have moved a socket with a valid NAPI
-		 * ID onto the ready list.
+		 * ID onto the ready list. Nobody is polling it any more,
+		 * so give it its interrupts back.
 		 */
+		if (prefer_busy_poll)
+			napi_resume_irqs(napi_id);
 		ep->napi_id = 0;
 		return false;
 	}
 	return false;
 }
 
+/*
+ * Events found while busy polling are about to be handed to user space,
+ * which is expected to come back and poll again: keep the device IRQs
+ * suspended meanwhile, bounded by the NAPI's irq_suspend_timeout.
+ */
+static void ep_suspend_napi_irqs(struct eventpoll *ep)
+{
+	unsigned int napi_id = READ_ONCE(ep->napi_id);
+
+	if (napi_id >= MIN_NAPI_ID && READ_ONCE(ep->prefer_busy_poll))
+		napi_suspend_irqs(napi_id);
+}
+
 /*
  * Set epoll busy poll NAPI ID from sk.
  */
@@ -454,6 +473,7 @@ static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
 
 	/* record NAPI ID for use in next busy poll */
 	ep->napi_id = napi_id;
+	WRITE_ONCE(ep->prefer_busy_poll, READ_ONCE(sk->sk_prefer_busy_poll));
 }
 
 #else
@@ -463,6 +483,10 @@ static inline bool ep_busy_loop(struct eventpoll *ep, int nonblock)
 	return false;
 }
 
+static inline void ep_suspend_napi_irqs(struct eventpoll *ep)
+{
+}
+
 static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
 {
 }
@@ -1180,6 +1204,7 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	__poll_t pollflags = key_to_poll(key);
 	unsigned long flags;
 	int ewake = 0;
+	bool queued = false;
 
 	read_lock_irqsave(&ep->lock, flags);
 
@@ -1210,17 +1235,25 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	 * chained in ep->ovflist and requeued later on.
 	 */
 	if (READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR) {
-		if (chain_epi_lockless(epi))
+		queued = chain_epi_lockless(epi);
+		if (queued)
 			ep_pm_stay_awake_rcu(epi);
 	} else if (!ep_is_linked(epi)) {
 		/* In the usual case, add event to ready list. */
-		if (list_add_tail_lockless(&epi->rdllink, &ep->rdllist))
+		queued = list_add_tail_lockless(&epi->rdllink, &ep->rdllist);
+		if (queued)
 			ep_pm_stay_awake_rcu(epi);
 	}
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
+	 *
+	 * If the item was already queued, whoever queued it has woken a
+	 * waiter that will harvest it (and ep_done_scan() wakes the next one
+	 * if anything is left), so another wake_up() would only bounce
+	 * ep->wq.lock on every event of a busy file. Still report the
+	 * exclusive wakeup as done, the event is pending on this ep.
 	 */
 	if (waitqueue_active(&ep->wq)) {
 		if ((epi->event.events & EPOLLEXCLUSIVE) &&
@@ -1239,7 +1272,8 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 				break;
 			}
 		}
-		wake_up(&ep->wq);
+		if (queued)
+			wake_up(&ep->wq);
 	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
@@ -1694,8 +1728,17 @@ static int ep_send_events(struct eventpoll *ep,
 	 * timely exit without the chance of finding more events available and
 	 * fetching repeatedly.
 	 */
-	if (fatal_signal_pending(current))
+	if (fatal_signal_pending(current)) {
+		/*
+		 * ep_poll_callback() does not wake anyone for an item that is
+		 * already queued, relying on the waiter it woke for it to
+		 * harvest it. We are leaving without doing so, pass the
+		 * wakeup on to the next waiter.
+		 */
+		if (ep_events_available(ep))
+			wake_up(&ep->wq);
 		return -EINTR;
+	}
 
 	init_poll_funcptr(&pt, NULL);
 
@@ -1870,8 +1913,11 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 			 * trying again in search of more luck.
 			 */
 			res = ep_send_events(ep, events, maxevents);
-			if (res)
+			if (res) {
+				if (res > 0)
+					ep_suspend_napi_irqs(ep);
 				return res;
+			}
 		}
 
 		if (timed_out)
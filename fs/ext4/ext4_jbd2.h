@@ -513,4 +513,28 @@ static inline int ext4_should_dioread_nolock(struct inode *inode)
 	return 1;
 }
 
+/*
+ * Buffered IO through iomap allocates unwritten extents at write time and
+ * converts them when the data is on disk, so it needs an extent mapped file
+ * whose data never goes to the journal or to the inode itself.
+ */
+static inline bool ext4_should_use_buffered_iomap(struct inode *inode)
+{
+	if (!test_opt2(inode->i_sb, BUFFERED_IOMAP))
+		return false;
+	if (!S_ISREG(inode->i_mode) || inode->i_ino < EXT4_FIRST_INO(inode->i_sb))
+		return false;
+	if (!ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS) ||
+	    ext4_test_inode_flag(inode, EXT4_INODE_EA_INODE))
+		return false;
+	if (ext4_should_journal_data(inode) || ext4_has_inline_data(inode) ||
+	    ext4_test_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA))
+		return false;
+	if (IS_DAX(inode) || IS_ENCRYPTED(inode) || IS_VERITY(inode))
+		return false;
+	if (ext4_has_feature_bigalloc(inode->i_sb))
+		return false;
+	return true;
+}
+
 #endif	/* _EXT4_JBD2_H */
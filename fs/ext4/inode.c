@@ -3074,11 +3074,13 @@ static sector_t ext4_bmap(struct address_space *mapping, sector_t block)
 
 	if (mapping_tagged(mapping, PAGECACHE_TAG_DIRTY) &&
 	    (test_opt(inode->i_sb, DELALLOC) ||
-	     ext4_should_journal_data(inode))) {
+	     ext4_should_journal_data(inode) ||
+	     ext4_test_inode_state(inode, EXT4_STATE_BUFFERED_IOMAP))) {
 		/*
-		 * With delalloc or journalled data we want to sync the file so
-		 * that we can make sure we allocate blocks for file and data
-		 * is in place for the user to see it
+		 * With delalloc, journalled data or unwritten extents from
+		 * iomap we want to sync the file so that we can make sure we
+		 * allocate blocks for file and data is in place for the user
+		 * to see it
 		 */
 		filemap_write_and_wait(mapping);
 	}
@@ -3481,6 +3483,240 @@ const struct iomap_ops ext4_iomap_report_ops = {
 	.iomap_begin = ext4_iomap_begin_report,
 };
 
+/*
+ * Find the blocks backing @map for buffered IO through iomap, allocating
+ * unwritten extents over holes.  The data only becomes visible once
+ * ext4_iomap_end_io_work() has converted them after writeback.
+ */
+static int ext4_iomap_get_blocks(struct inode *inode,
+				 struct ext4_map_blocks *map)
+{
+	handle_t *handle;
+	int ret, retries = 0;
+
+	ret = ext4_map_blocks(NULL, inode, map, 0);
+	if (ret)
+		return ret;
+
+	if (map->m_len > DIO_MAX_BLOCKS)
+		map->m_len = DIO_MAX_BLOCKS;
+retry:
+	handle = ext4_journal_start(inode, EXT4_HT_MAP_BLOCKS,
+				    ext4_chunk_trans_blocks(inode, map->m_len));
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	ret = ext4_map_blocks(handle, inode, map,
+			      EXT4_GET_BLOCKS_CREATE_UNWRIT_EXT);
+	ext4_journal_stop(handle);
+	if (ret == -ENOSPC && ext4_should_retry_alloc(inode->i_sb, &retries))
+		goto retry;
+
+	return ret;
+}
+
+/*
+ * Written data stays in the page cache on top of an unwritten extent until
+ * writeback completes, so zeroing must not skip such a block if it is dirty
+ * or under writeback.  Blocks that are not uptodate still read as zeroes.
+ */
+static bool ext4_iomap_zero_cached(struct inode *inode, loff_t offset,
+				   loff_t length)
+{
+	struct folio *folio;
+	bool ret;
+
+	folio = filemap_lock_folio(inode->i_mapping, offset >> PAGE_SHIFT);
+	if (IS_ERR(folio))
+		return false;
+
+	ret = (folio_test_dirty(folio) || folio_test_writeback(folio)) &&
+	      (folio_test_uptodate(folio) ||
+	       iomap_is_partially_uptodate(folio, offset_in_folio(folio, offset),
+					   length));
+	folio_unlock(folio);
+	folio_put(folio);
+	return ret;
+}
+
+static int ext4_iomap_buffered_write_begin(struct inode *inode, loff_t offset,
+		loff_t length, unsigned flags, struct iomap *iomap,
+		struct iomap *srcmap)
+{
+	struct ext4_map_blocks map;
+	u8 blkbits = inode->i_blkbits;
+	int ret;
+
+	if ((offset >> blkbits) > EXT4_MAX_LOGICAL_BLOCK)
+		return -EINVAL;
+
+	map.m_lblk = offset >> blkbits;
+	map.m_len = min_t(loff_t, (offset + length - 1) >> blkbits,
+			  EXT4_MAX_LOGICAL_BLOCK) - map.m_lblk + 1;
+
+	if (flags & (IOMAP_ZERO | IOMAP_FAULT)) {
+		/* the folio is locked for faults, see ext4_iomap_page_mkwrite() */
+		ret = ext4_map_blocks(NULL, inode, &map, 0);
+		if (ret < 0)
+			return ret;
+		if (!ret && (flags & IOMAP_FAULT))
+			return -EAGAIN;
+		if ((flags & IOMAP_ZERO) && (map.m_flags & EXT4_MAP_UNWRITTEN) &&
+		    ext4_iomap_zero_cached(inode, offset, length)) {
+			map.m_flags &= ~EXT4_MAP_UNWRITTEN;
+			map.m_flags |= EXT4_MAP_MAPPED;
+		}
+	} else {
+		ret = ext4_iomap_get_blocks(inode, &map);
+		if (ret < 0)
+			return ret;
+	}
+
+	ext4_set_iomap(inode, iomap, &map, offset, length, flags);
+	return 0;
+}
+
+const struct iomap_ops ext4_iomap_buffered_write_ops = {
+	.iomap_begin		= ext4_iomap_buffered_write_begin,
+};
+
+/*
+ * i_disksize follows the data that made it to disk, like the extent
+ * conversion, so a crash never exposes a tail that was not written.
+ */
+static int ext4_iomap_update_disksize(struct inode *inode, loff_t new_size)
+{
+	handle_t *handle;
+	int ret;
+
+	handle = ext4_journal_start(inode, EXT4_HT_INODE, 1);
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	down_write(&EXT4_I(inode)->i_data_sem);
+	new_size = min(new_size, i_size_read(inode));
+	if (new_size > EXT4_I(inode)->i_disksize)
+		EXT4_I(inode)->i_disksize = new_size;
+	up_write(&EXT4_I(inode)->i_data_sem);
+
+	ret = ext4_mark_inode_dirty(handle, inode);
+	ext4_journal_stop(handle);
+	return ret;
+}
+
+static void ext4_iomap_finish_ioend(struct iomap_ioend *ioend)
+{
+	struct inode *inode = ioend->io_inode;
+	loff_t offset = ioend->io_offset;
+	size_t size = ioend->io_size;
+	int err = blk_status_to_errno(ioend->io_bio->bi_status);
+
+	if (!err && ioend->io_type == IOMAP_UNWRITTEN)
+		err = ext4_convert_unwritten_extents(NULL, inode, offset, size);
+	if (!err && offset + size > READ_ONCE(EXT4_I(inode)->i_disksize))
+		err = ext4_iomap_update_disksize(inode, offset + size);
+
+	iomap_finish_ioends(ioend, err);
+}
+
+void ext4_iomap_end_io_work(struct work_struct *work)
+{
+	struct ext4_inode_info *ei = container_of(work, struct ext4_inode_info,
+						  i_iomap_ioend_work);
+	struct iomap_ioend *ioend;
+	struct list_head tmp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ei->i_completed_io_lock, flags);
+	list_replace_init(&ei->i_iomap_ioend_list, &tmp);
+	spin_unlock_irqrestore(&ei->i_completed_io_lock, flags);
+
+	iomap_sort_ioends(&tmp);
+	while ((ioend = list_first_entry_or_null(&tmp, struct iomap_ioend,
+						 io_list))) {
+		list_del_init(&ioend->io_list);
+		iomap_ioend_try_merge(ioend, &tmp);
+		ext4_iomap_finish_ioend(ioend);
+		cond_resched();
+	}
+}
+
+static void ext4_iomap_end_bio(struct bio *bio)
+{
+	struct iomap_ioend *ioend = bio->bi_private;
+	struct inode *inode = ioend->io_inode;
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct workqueue_struct *wq = EXT4_SB(inode->i_sb)->rsv_conversion_wq;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ei->i_completed_io_lock, flags);
+	if (list_empty(&ei->i_iomap_ioend_list))
+		WARN_ON_ONCE(!queue_work(wq, &ei->i_iomap_ioend_work));
+	list_add_tail(&ioend->io_list, &ei->i_iomap_ioend_list);
+	spin_unlock_irqrestore(&ei->i_completed_io_lock, flags);
+}
+
+static int ext4_iomap_map_blocks(struct iomap_writepage_ctx *wpc,
+				 struct inode *inode, loff_t offset)
+{
+	struct ext4_map_blocks map;
+	u8 blkbits = inode->i_blkbits;
+	loff_t end;
+	int ret;
+
+	if (unlikely(ext4_forced_shutdown(EXT4_SB(inode->i_sb))))
+		return -EIO;
+
+	/* no caching of the mapping, extent status lookups are cheap */
+	end = DIV_ROUND_UP_ULL(i_size_read(inode), 1U << blkbits);
+	map.m_lblk = offset >> blkbits;
+	map.m_len = clamp_t(loff_t, end - map.m_lblk, 1, INT_MAX);
+
+	ret = ext4_map_blocks(NULL, inode, &map, 0);
+	if (ret < 0)
+		return ret;
+
+	ext4_set_iomap(inode, &wpc->iomap, &map, offset,
+		       (loff_t)map.m_len << blkbits, 0);
+	return 0;
+}
+
+static int ext4_iomap_prepare_ioend(struct iomap_ioend *ioend, int status)
+{
+	if (!status &&
+	    (ioend->io_type == IOMAP_UNWRITTEN ||
+	     ioend->io_offset + ioend->io_size >
+			READ_ONCE(EXT4_I(ioend->io_inode)->i_disksize)))
+		ioend->io_bio->bi_end_io = ext4_iomap_end_bio;
+	return status;
+}
+
+static const struct iomap_writeback_ops ext4_iomap_writeback_ops = {
+	.map_blocks		= ext4_iomap_map_blocks,
+	.prepare_ioend		= ext4_iomap_prepare_ioend,
+};
+
+static int ext4_iomap_read_folio(struct file *file, struct folio *folio)
+{
+	return iomap_read_folio(folio, &ext4_iomap_ops);
+}
+
+static void ext4_iomap_readahead(struct readahead_control *rac)
+{
+	iomap_readahead(rac, &ext4_iomap_ops);
+}
+
+static int ext4_iomap_writepages(struct address_space *mapping,
+				 struct writeback_control *wbc)
+{
+	struct iomap_writepage_ctx wpc = { };
+
+	if (unlikely(ext4_forced_shutdown(EXT4_SB(mapping->host->i_sb))))
+		return -EIO;
+
+	return iomap_writepages(mapping, wbc, &wpc, &ext4_iomap_writeback_ops);
+}
+
 /*
  * For data=journal mode, folio should be marked dirty only when it was
  * writeably mapped. When that happens, it was already attached to the
@@ -3578,6 +3814,21 @@ static const struct address_space_operations ext4_dax_aops = {
 	.swap_activate		= ext4_iomap_swap_activate,
 };
 
+static const struct address_space_operations ext4_iomap_aops = {
+	.read_folio		= ext4_iomap_read_folio,
+	.readahead		= ext4_iomap_readahead,
+	.writepages		= ext4_iomap_writepages,
+	.dirty_folio		= filemap_dirty_folio,
+	.bmap			= ext4_bmap,
+	.invalidate_folio	= iomap_invalidate_folio,
+	.release_folio		= iomap_release_folio,
+	.direct_IO		= noop_direct_IO,
+	.migrate_folio		= filemap_migrate_folio,
+	.is_partially_uptodate  = iomap_is_partially_uptodate,
+	.error_remove_page	= generic_error_remove_page,
+	.swap_activate		= ext4_iomap_swap_activate,
+};
+
 void ext4_set_aops(struct inode *inode)
 {
 	switch (ext4_inode_journal_mode(inode)) {
@@ -3590,9 +3841,16 @@ void ext4_set_aops(struct inode *inode)
 	default:
 		BUG();
 	}
+	/* decided once per inode, the aops must not change under the cache */
+	if ((inode->i_state & I_NEW) && ext4_should_use_buffered_iomap(inode))
+		ext4_set_inode_state(inode, EXT4_STATE_BUFFERED_IOMAP);
+
 	if (IS_DAX(inode))
 		inode->i_mapping->a_ops = &ext4_dax_aops;
-	else if (test_opt(inode->i_sb, DELALLOC))
+	else if (ext4_test_inode_state(inode, EXT4_STATE_BUFFERED_IOMAP)) {
+		inode->i_mapping->a_ops = &ext4_iomap_aops;
+		mapping_set_large_folios(inode->i_mapping);
+	} else if (test_opt(inode->i_sb, DELALLOC))
 		inode->i_mapping->a_ops = &ext4_da_aops;
 	else
 		inode->i_mapping->a_ops = &ext4_aops;
@@ -3719,6 +3977,9 @@ static int ext4_block_zero_page_range(handle_t *handle,
 		return dax_zero_range(inode, from, length, NULL,
 				      &ext4_iomap_ops);
 	}
+	if (ext4_test_inode_state(inode, EXT4_STATE_BUFFERED_IOMAP))
+		return iomap_zero_range(inode, from, length, NULL,
+					&ext4_iomap_buffered_write_ops);
 	return __ext4_block_zero_page_range(handle, mapping, from, length);
 }
 
@@ -5962,6 +6223,10 @@ int ext4_change_inode_journal_flag(struct inode *inode, int val)
 	if (is_journal_aborted(journal))
 		return -EROFS;
 
+	/* the iomap aops cannot be swapped for the journalled ones */
+	if (val && ext4_test_inode_state(inode, EXT4_STATE_BUFFERED_IOMAP))
+		return -EOPNOTSUPP;
+
 	/* Wait for all existing dio workers */
 	inode_dio_wait(inode);
 
@@ -6034,6 +6299,45 @@ static int ext4_bh_unmapped(handle_t *handle, struct inode *inode,
 	return !buffer_mapped(bh);
 }
 
+/*
+ * iomap_page_mkwrite() maps the blocks with the folio locked, and a journal
+ * handle must not be started under a folio lock.  Allocate first, a hole
+ * the range grew into meanwhile makes the begin callback retry the fault.
+ */
+static vm_fault_t ext4_iomap_page_mkwrite(struct vm_fault *vmf)
+{
+	struct folio *folio = page_folio(vmf->page);
+	struct inode *inode = file_inode(vmf->vma->vm_file);
+	struct ext4_map_blocks map;
+	loff_t pos = folio_pos(folio);
+	loff_t end = min_t(loff_t, pos + folio_size(folio), i_size_read(inode));
+	vm_fault_t ret;
+	int err = 0;
+
+	sb_start_pagefault(inode->i_sb);
+	file_update_time(vmf->vma->vm_file);
+	filemap_invalidate_lock_shared(inode->i_mapping);
+
+	map.m_lblk = pos >> inode->i_blkbits;
+	while (((loff_t)map.m_lblk << inode->i_blkbits) < end) {
+		map.m_len = DIV_ROUND_UP_ULL(end, i_blocksize(inode)) -
+			    map.m_lblk;
+		err = ext4_iomap_get_blocks(inode, &map);
+		if (err < 0)
+			break;
+		map.m_lblk += map.m_len;
+	}
+
+	if (err < 0)
+		ret = block_page_mkwrite_return(err);
+	else
+		ret = iomap_page_mkwrite(vmf, &ext4_iomap_buffered_write_ops);
+
+	filemap_invalidate_unlock_shared(inode->i_mapping);
+	sb_end_pagefault(inode->i_sb);
+	return ret;
+}
+
 vm_fault_t ext4_page_mkwrite(struct vm_fault *vmf)
 {
 	struct vm_area_struct *vma = vmf->vma;
@@ -6052,6 +6356,9 @@ vm_fault_t ext4_page_mkwrite(struct vm_fault *vmf)
 	if (unlikely(IS_IMMUTABLE(inode)))
 		return VM_FAULT_SIGBUS;
 
+	if (ext4_test_inode_state(inode, EXT4_STATE_BUFFERED_IOMAP))
+		return ext4_iomap_page_mkwrite(vmf);
+
 	sb_start_pagefault(inode->i_sb);
 	file_update_time(vma->vm_file);
 
@@ -1038,7 +1038,7 @@ mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 	/* No need to move between order lists? */
 	if (!test_opt2(sb, MB_OPTIMIZE_SCAN) ||
 	    i == grp->bb_largest_free_order) {
-		grp->bb_largest_free_order = i;
+		WRITE_ONCE(grp->bb_largest_free_order, i);
 		return;
 	}
 
@@ -1049,7 +1049,7 @@ mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 		write_unlock(&sbi->s_mb_largest_free_orders_locks[
 					      grp->bb_largest_free_order]);
 	}
-	grp->bb_largest_free_order = i;
+	WRITE_ONCE(grp->bb_largest_free_order, i);
 	if (grp->bb_largest_free_order >= 0 && grp->bb_free) {
 		write_lock(&sbi->s_mb_largest_free_orders_locks[
 					      grp->bb_largest_free_order]);
@@ -1091,7 +1091,7 @@ void ext4_mb_generate_buddy(struct super_block *sb,
 		if (i < max)
 			i = mb_find_next_zero_bit(bitmap, max, i);
 	}
-	grp->bb_fragments = fragments;
+	WRITE_ONCE(grp->bb_fragments, fragments);
 
 	if (free != grp->bb_free) {
 		ext4_grp_locked_error(sb, group, 0, 0,
@@ -1102,7 +1102,7 @@ void ext4_mb_generate_buddy(struct super_block *sb,
 		 * If we intend to continue, we consider group descriptor
 		 * corrupt and update bb_free using bitmap value
 		 */
-		grp->bb_free = free;
+		WRITE_ONCE(grp->bb_free, free);
 		ext4_mark_group_bitmap_corrupted(sb, group,
 					EXT4_GROUP_INFO_BBITMAP_CORRUPT);
 	}
@@ -1776,7 +1776,7 @@ static void mb_free_blocks(struct inode *inode, struct ext4_buddy *e4b,
 	mb_free_blocks_double(inode, e4b, first, count);
 
 	this_cpu_inc(discard_pa_seq);
-	e4b->bd_info->bb_free += count;
+	WRITE_ONCE(e4b->bd_info->bb_free, e4b->bd_info->bb_free + count);
 	if (first < e4b->bd_info->bb_first_free)
 		e4b->bd_info->bb_first_free = first;
 
@@ -1810,9 +1810,11 @@ static void mb_free_blocks(struct inode *inode, struct ext4_buddy *e4b,
 
 	/* let's maintain fragments counter */
 	if (left_is_free && right_is_free)
-		e4b->bd_info->bb_fragments--;
+		WRITE_ONCE(e4b->bd_info->bb_fragments,
+			   e4b->bd_info->bb_fragments - 1);
 	else if (!left_is_free && !right_is_free)
-		e4b->bd_info->bb_fragments++;
+		WRITE_ONCE(e4b->bd_info->bb_fragments,
+			   e4b->bd_info->bb_fragments + 1);
 
 	/* buddy[0] == bd_bitmap is a special case, so handle
 	 * it right away and let mb_buddy_mark_free stay free of
@@ -1922,7 +1924,7 @@ static int mb_mark_used(struct ext4_buddy *e4b, struct ext4_free_extent *ex)
 	mb_mark_used_double(e4b, start, len);
 
 	this_cpu_inc(discard_pa_seq);
-	e4b->bd_info->bb_free -= len;
+	WRITE_ONCE(e4b->bd_info->bb_free, e4b->bd_info->bb_free - len);
 	if (e4b->bd_info->bb_first_free == start)
 		e4b->bd_info->bb_first_free += len;
 
@@ -1932,9 +1934,11 @@ static int mb_mark_used(struct ext4_buddy *e4b, struct ext4_free_extent *ex)
 	if (start + len < EXT4_SB(e4b->bd_sb)->s_mb_maxs[0])
 		max = !mb_test_bit(start + len, e4b->bd_bitmap);
 	if (mlen && max)
-		e4b->bd_info->bb_fragments++;
+		WRITE_ONCE(e4b->bd_info->bb_fragments,
+			   e4b->bd_info->bb_fragments + 1);
 	else if (!mlen && !max)
-		e4b->bd_info->bb_fragments--;
+		WRITE_ONCE(e4b->bd_info->bb_fragments,
+			   e4b->bd_info->bb_fragments - 1);
 
 	/* let's maintain buddy itself */
 	while (len) {
@@ -2404,6 +2408,10 @@ void ext4_mb_scan_aligned(struct ext4_allocation_context *ac,
  * This is also called BEFORE we load the buddy bitmap.
  * Returns either 1 or 0 indicating that the group is either suitable
  * for the allocation or not.
+ *
+ * The group lock is not required: the cached summaries are read once each,
+ * and a stale answer is caught by the re-check done under the lock before
+ * the group is actually scanned.
  */
 static bool ext4_mb_good_group(struct ext4_allocation_context *ac,
 				ext4_group_t group, int cr)
@@ -2417,11 +2425,11 @@ static bool ext4_mb_good_group(struct ext4_allocation_context *ac,
 	if (unlikely(EXT4_MB_GRP_BBITMAP_CORRUPT(grp) || !grp))
 		return false;
 
-	free = grp->bb_free;
+	free = READ_ONCE(grp->bb_free);
 	if (free == 0)
 		return false;
 
-	fragments = grp->bb_fragments;
+	fragments = READ_ONCE(grp->bb_fragments);
 	if (fragments == 0)
 		return false;
 
@@ -2441,7 +2449,7 @@ static bool ext4_mb_good_group(struct ext4_allocation_context *ac,
 		if (ac->ac_2order >= MB_NUM_ORDERS(ac->ac_sb))
 			return true;
 
-		if (grp->bb_largest_free_order < ac->ac_2order)
+		if (READ_ONCE(grp->bb_largest_free_order) < ac->ac_2order)
 			return false;
 
 		return true;
@@ -2462,16 +2470,32 @@ static bool ext4_mb_good_group(struct ext4_allocation_context *ac,
 	return false;
 }
 
+/*
+ * Quick check of the cached free count, done before the buddy is
+ * initialised.  Like ext4_mb_good_group() it does not need the group lock.
+ */
+static bool ext4_mb_group_has_free(struct ext4_allocation_context *ac,
+				   struct ext4_group_info *grp, int cr)
+{
+	ext4_grpblk_t free = READ_ONCE(grp->bb_free);
+
+	if (free == 0)
+		return false;
+	if (cr <= 2 && free < ac->ac_g_ex.fe_len)
+		return false;
+	return !EXT4_MB_GRP_BBITMAP_CORRUPT(grp);
+}
+
 /*
  * This could return negative error code if something goes wrong
  * during ext4_mb_init_group(). This should not be called with
  * ext4_lock_group() held.
  *
- * Note: because we are conditionally operating with the group lock in
- * the EXT4_MB_STRICT_CHECK case, we need to fake out sparse in this
- * function using __acquire and __release.  This means we need to be
- * super careful before messing with the error path handling via "goto
- * out"!
+ * Candidates are selected from the cached group summaries without taking
+ * the group lock, the caller re-checks under the lock before scanning.
+ * In the EXT4_MB_STRICT_CHECK case a group is only rejected after the
+ * lockless answer was confirmed under the group lock, so that blocks freed
+ * by a concurrent discard of preallocations are not missed.
  */
 static int ext4_mb_good_group_nolock(struct ext4_allocation_context *ac,
 				     ext4_group_t group, int cr)
@@ -2480,34 +2504,27 @@ static int ext4_mb_good_group_nolock(struct ext4_allocation_context *ac,
 	struct super_block *sb = ac->ac_sb;
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	bool should_lock = ac->ac_flags & EXT4_MB_STRICT_CHECK;
-	ext4_grpblk_t free;
-	int ret = 0;
+	bool good;
+	int ret;
 
 	if (!grp)
 		return -EFSCORRUPTED;
 	if (sbi->s_mb_stats)
 		atomic64_inc(&sbi->s_bal_cX_groups_considered[ac->ac_criteria]);
-	if (should_lock) {
+
+	good = ext4_mb_group_has_free(ac, grp, cr);
+	if (!good && should_lock) {
 		ext4_lock_group(sb, group);
-		__release(ext4_group_lock_ptr(sb, group));
-	}
-	free = grp->bb_free;
-	if (free == 0)
-		goto out;
-	if (cr <= 2 && free < ac->ac_g_ex.fe_len)
-		goto out;
-	if (unlikely(EXT4_MB_GRP_BBITMAP_CORRUPT(grp)))
-		goto out;
-	if (should_lock) {
-		__acquire(ext4_group_lock_ptr(sb, group));
+		good = ext4_mb_group_has_free(ac, grp, cr);
 		ext4_unlock_group(sb, group);
 	}
+	if (!good)
+		return 0;
 
 	/* We only do this if the grp has never been initialized */
 	if (unlikely(EXT4_MB_GRP_NEED_INIT(grp))) {
 		struct ext4_group_desc *gdp =
 			ext4_get_group_desc(sb, group, NULL);
-		int ret;
 
 		/* cr=0/1 is a very optimistic search to find large
 		 * good chunks almost for free.  If buddy data is not
@@ -2528,17 +2545,13 @@ static int ext4_mb_good_group_nolock(struct ext4_allocation_context *ac,
 			return ret;
 	}
 
-	if (should_lock) {
+	good = ext4_mb_good_group(ac, group, cr);
+	if (!good && should_lock) {
 		ext4_lock_group(sb, group);
-		__release(ext4_group_lock_ptr(sb, group));
-	}
-	ret = ext4_mb_good_group(ac, group, cr);
-out:
-	if (should_lock) {
-		__acquire(ext4_group_lock_ptr(sb, group));
+		good = ext4_mb_good_group(ac, group, cr);
 		ext4_unlock_group(sb, group);
 	}
-	return ret;
+	return good;
 }
 
 /*
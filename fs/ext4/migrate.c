@@ -614,6 +614,10 @@ int ext4_ind_migrate(struct inode *inode)
 	if (ext4_has_feature_bigalloc(inode->i_sb))
 		return -EOPNOTSUPP;
 
+	/* buffered IO through iomap needs unwritten extents */
+	if (ext4_test_inode_state(inode, EXT4_STATE_BUFFERED_IOMAP))
+		return -EOPNOTSUPP;
+
 	/*
 	 * In order to get correct extent info, force all delayed allocation
 	 * blocks to be allocated, otherwise delayed allocation blocks may not
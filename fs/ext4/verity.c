@@ -136,6 +136,13 @@ static int ext4_begin_enable_verity(struct file *filp)
 		return -EOPNOTSUPP;
 	}
 
+	/* the Merkle tree is written through ->write_begin() */
+	if (ext4_test_inode_state(inode, EXT4_STATE_BUFFERED_IOMAP)) {
+		ext4_warning_inode(inode,
+				   "verity is not supported with buffered_iomap");
+		return -EOPNOTSUPP;
+	}
+
 	/*
 	 * ext4 uses the last allocated block to find the verity descriptor, so
 	 * we must remove any other blocks past EOF which might confuse things.
@@ -229,6 +229,11 @@ __releases(fiq->lock)
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+	if (IS_ENABLED(CONFIG_FUSE_IO_URING) &&
+	    fuse_uring_queue_request(fiq, req)) {
+		spin_unlock(&fiq->lock);
+		return;
+	}
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
@@ -1192,6 +1197,81 @@ __releases(fiq->lock)
 		return fuse_read_batch_forget(fiq, cs, nbytes);
 }
 
+/*
+ * Copy a request taken off a pending list to the buffer of @cs and put it on
+ * the processing list of @fpq.  Returns the size of the request, or zero if
+ * it did not fit the buffer and was ended with an error.
+ */
+static ssize_t fuse_dev_do_send(struct fuse_conn *fc, struct fuse_pqueue *fpq,
+				struct fuse_copy_state *cs, size_t nbytes,
+				struct fuse_req *req)
+{
+	ssize_t err;
+	struct fuse_args *args = req->args;
+	unsigned reqsize = req->in.h.len;
+	unsigned int hash;
+
+	if (nbytes < reqsize) {
+		req->out.h.error = -EIO;
+		/* SETXATTR is special, since it may contain too large data */
+		if (args->opcode == FUSE_SETXATTR)
+			req->out.h.error = -E2BIG;
+		fuse_request_end(req);
+		return 0;
+	}
+	spin_lock(&fpq->lock);
+	/*
+	 *  Must not put request on fpq->io queue after having been shut down by
+	 *  fuse_abort_conn()
+	 */
+	if (!fpq->connected) {
+		req->out.h.error = err = -ECONNABORTED;
+		goto out_end;
+
+	}
+	list_add(&req->list, &fpq->io);
+	spin_unlock(&fpq->lock);
+	cs->req = req;
+	err = fuse_copy_one(cs, &req->in.h, sizeof(req->in.h));
+	if (!err)
+		err = fuse_copy_args(cs, args->in_numargs, args->in_pages,
+				     (struct fuse_arg *) args->in_args, 0);
+	fuse_copy_finish(cs);
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (!fpq->connected) {
+		err = fc->aborted ? -ECONNABORTED : -ENODEV;
+		goto out_end;
+	}
+	if (err) {
+		req->out.h.error = -EIO;
+		goto out_end;
+	}
+	if (!test_bit(FR_ISREPLY, &req->flags)) {
+		err = reqsize;
+		goto out_end;
+	}
+	hash = fuse_req_hash(req->in.h.unique);
+	list_move_tail(&req->list, &fpq->processing[hash]);
+	__fuse_get_request(req);
+	set_bit(FR_SENT, &req->flags);
+	spin_unlock(&fpq->lock);
+	/* matches barrier in request_wait_answer() */
+	smp_mb__after_atomic();
+	if (test_bit(FR_INTERRUPTED, &req->flags))
+		queue_interrupt(req);
+	fuse_put_request(req);
+
+	return reqsize;
+
+out_end:
+	if (!test_bit(FR_PRIVATE, &req->flags))
+		list_del_init(&req->list);
+	spin_unlock(&fpq->lock);
+	fuse_request_end(req);
+	return err;
+}
+
 /*
  * Read a single request into the userspace filesystem's buffer.  This
  * function waits until a request is available, then removes it from
@@ -1209,9 +1289,6 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	struct fuse_iqueue *fiq = &fc->iq;
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
-	struct fuse_args *args;
-	unsigned reqsize;
-	unsigned int hash;
 
 	/*
 	 * Require sane minimum read buffer - that has capacity for fixed part
@@ -1270,68 +1347,10 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
-	args = req->args;
-	reqsize = req->in.h.len;
-
-	/* If request is too large, reply with an error and restart the read */
-	if (nbytes < reqsize) {
-		req->out.h.error = -EIO;
-		/* SETXATTR is special, since it may contain too large data */
-		if (args->opcode == FUSE_SETXATTR)
-			req->out.h.error = -E2BIG;
-		fuse_request_end(req);
-		goto restart;
-	}
-	spin_lock(&fpq->lock);
-	/*
-	 *  Must not put request on fpq->io queue after having been shut down by
-	 *  fuse_abort_conn()
-	 */
-	if (!fpq->connected) {
-		req->out.h.error = err = -ECONNABORTED;
-		goto out_end;
-
-	}
-	list_add(&req->list, &fpq->io);
-	spin_unlock(&fpq->lock);
-	cs->req = req;
-	err = fuse_copy_one(cs, &req->in.h, sizeof(req->in.h));
+	/* If request is too large it has been ended, restart the read */
+	err = fuse_dev_do_send(fc, fpq, cs, nbytes, req);
 	if (!err)
-		err = fuse_copy_args(cs, args->in_numargs, args->in_pages,
-				     (struct fuse_arg *) args->in_args, 0);
-	fuse_copy_finish(cs);
-	spin_lock(&fpq->lock);
-	clear_bit(FR_LOCKED, &req->flags);
-	if (!fpq->connected) {
-		err = fc->aborted ? -ECONNABORTED : -ENODEV;
-		goto out_end;
-	}
-	if (err) {
-		req->out.h.error = -EIO;
-		goto out_end;
-	}
-	if (!test_bit(FR_ISREPLY, &req->flags)) {
-		err = reqsize;
-		goto out_end;
-	}
-	hash = fuse_req_hash(req->in.h.unique);
-	list_move_tail(&req->list, &fpq->processing[hash]);
-	__fuse_get_request(req);
-	set_bit(FR_SENT, &req->flags);
-	spin_unlock(&fpq->lock);
-	/* matches barrier in request_wait_answer() */
-	smp_mb__after_atomic();
-	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(req);
-	fuse_put_request(req);
-
-	return reqsize;
-
-out_end:
-	if (!test_bit(FR_PRIVATE, &req->flags))
-		list_del_init(&req->list);
-	spin_unlock(&fpq->lock);
-	fuse_request_end(req);
+		goto restart;
 	return err;
 
  err_unlock:
@@ -1339,6 +1358,25 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	return err;
 }
 
+ssize_t fuse_dev_send_req(struct fuse_conn *fc, struct fuse_pqueue *fpq,
+			  struct fuse_req *req, void __user *buf, size_t len)
+{
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	int err;
+
+	err = import_ubuf(ITER_DEST, buf, len, &iter);
+	if (err) {
+		req->out.h.error = err;
+		fuse_request_end(req);
+		return err;
+	}
+	fuse_copy_init(&cs, 1, &iter);
+
+	return fuse_dev_do_send(fc, fpq, &cs, len, req);
+}
+
+static int fuse_dev_open(struct inode *inode, struct file *file)
 static int fuse_dev_open(struct inode *inode, struct file *file)
 {
 	/*
@@ -1847,12 +1885,10 @@ static int copy_out_args(struct fuse_copy_state *cs, struct fuse_args *args,
  * it from the list and copy the rest of the buffer to the request.
  * The request is finished by calling fuse_request_end().
  */
-static ssize_t fuse_dev_do_write(struct fuse_dev *fud,
+static ssize_t fuse_dev_do_write(struct fuse_conn *fc, struct fuse_pqueue *fpq,
 				 struct fuse_copy_state *cs, size_t nbytes)
 {
 	int err;
-	struct fuse_conn *fc = fud->fc;
-	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_out_header oh;
 
@@ -1957,7 +1993,22 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, struct iov_iter *from)
 
 	fuse_copy_init(&cs, 0, from);
 
-	return fuse_dev_do_write(fud, &cs, iov_iter_count(from));
+	return fuse_dev_do_write(fud->fc, &fud->pq, &cs, iov_iter_count(from));
+}
+
+ssize_t fuse_dev_reply(struct fuse_conn *fc, struct fuse_pqueue *fpq,
+		       void __user *buf, size_t len)
+{
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	int err;
+
+	err = import_ubuf(ITER_SOURCE, buf, len, &iter);
+	if (err)
+		return err;
+	fuse_copy_init(&cs, 0, &iter);
+
+	return fuse_dev_do_write(fc, fpq, &cs, len);
 }
 
 static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
@@ -2038,7 +2089,7 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	if (flags & SPLICE_F_MOVE)
 		cs.move_pages = 1;
 
-	ret = fuse_dev_do_write(fud, &cs, len);
+	ret = fuse_dev_do_write(fud->fc, &fud->pq, &cs, len);
 
 	pipe_lock(pipe);
 out_free:
@@ -2104,6 +2155,33 @@ static void end_polls(struct fuse_conn *fc)
 	}
 }
 
+/*
+ * Move the requests of @fpq that are not being copied to @to_end, and the
+ * ones under copy are finished by unlock_request().
+ */
+void fuse_abort_pqueue(struct fuse_pqueue *fpq, struct list_head *to_end)
+{
+	struct fuse_req *req, *next;
+	unsigned int i;
+
+	spin_lock(&fpq->lock);
+	fpq->connected = 0;
+	list_for_each_entry_safe(req, next, &fpq->io, list) {
+		req->out.h.error = -ECONNABORTED;
+		spin_lock(&req->waitq.lock);
+		set_bit(FR_ABORTED, &req->flags);
+		if (!test_bit(FR_LOCKED, &req->flags)) {
+			set_bit(FR_PRIVATE, &req->flags);
+			__fuse_get_request(req);
+			list_move(&req->list, to_end);
+		}
+		spin_unlock(&req->waitq.lock);
+	}
+	for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
+		list_splice_tail_init(&fpq->processing[i], to_end);
+	spin_unlock(&fpq->lock);
+}
+
 /*
  * Abort all requests.
  *
@@ -2129,9 +2207,8 @@ void fuse_abort_conn(struct fuse_conn *fc)
 	spin_lock(&fc->lock);
 	if (fc->connected) {
 		struct fuse_dev *fud;
-		struct fuse_req *req, *next;
+		struct fuse_req *req;
 		LIST_HEAD(to_end);
-		unsigned int i;
 
 		/* Background queuing checks fc->connected under bg_lock */
 		spin_lock(&fc->bg_lock);
@@ -2139,27 +2216,10 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		spin_unlock(&fc->bg_lock);
 
 		fuse_set_initialized(fc);
-		list_for_each_entry(fud, &fc->devices, entry) {
-			struct fuse_pqueue *fpq = &fud->pq;
-
-			spin_lock(&fpq->lock);
-			fpq->connected = 0;
-			list_for_each_entry_safe(req, next, &fpq->io, list) {
-				req->out.h.error = -ECONNABORTED;
-				spin_lock(&req->waitq.lock);
-				set_bit(FR_ABORTED, &req->flags);
-				if (!test_bit(FR_LOCKED, &req->flags)) {
-					set_bit(FR_PRIVATE, &req->flags);
-					__fuse_get_request(req);
-					list_move(&req->list, &to_end);
-				}
-				spin_unlock(&req->waitq.lock);
-			}
-			for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
-				list_splice_tail_init(&fpq->processing[i],
-						      &to_end);
-			spin_unlock(&fpq->lock);
-		}
+		list_for_each_entry(fud, &fc->devices, entry)
+			fuse_abort_pqueue(&fud->pq, &to_end);
+		if (IS_ENABLED(CONFIG_FUSE_IO_URING))
+			fuse_uring_abort(fc, &to_end);
 		spin_lock(&fc->bg_lock);
 		fc->blocked = 0;
 		fc->max_background = UINT_MAX;
@@ -2256,6 +2316,8 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 {
 	int res;
 	int oldfd;
+	int backing_id;
+	struct fuse_backing_map map;
 	struct fuse_dev *fud = NULL;
 	struct fd f;
 
@@ -2283,6 +2345,32 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 		}
 		fdput(f);
 		break;
+	case FUSE_DEV_IOC_BACKING_OPEN:
+		if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+			return -EOPNOTSUPP;
+
+		fud = fuse_get_dev(file);
+		if (!fud)
+			return -EPERM;
+
+		if (copy_from_user(&map, (void __user *)arg, sizeof(map)))
+			return -EFAULT;
+
+		res = fuse_backing_open(fud->fc, &map);
+		break;
+	case FUSE_DEV_IOC_BACKING_CLOSE:
+		if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+			return -EOPNOTSUPP;
+
+		fud = fuse_get_dev(file);
+		if (!fud)
+			return -EPERM;
+
+		if (get_user(backing_id, (__u32 __user *)arg))
+			return -EFAULT;
+
+		res = fuse_backing_close(fud->fc, backing_id);
+		break;
 	default:
 		res = -ENOTTY;
 		break;
@@ -2303,6 +2391,9 @@ const struct file_operations fuse_dev_operations = {
 	.fasync		= fuse_dev_fasync,
 	.unlocked_ioctl = fuse_dev_ioctl,
 	.compat_ioctl   = compat_ptr_ioctl,
+#ifdef CONFIG_FUSE_IO_URING
+	.uring_cmd	= fuse_uring_cmd,
+#endif
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE over io_uring: requests are queued on the CPU that issued them and
+ * copied to buffers the server parked there with FUSE_URING_CMD_FETCH.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/io_uring.h>
+#include <linux/slab.h>
+
+struct fuse_ring_queue {
+	/* protects the lists below and fuse_uring_pdu->list */
+	spinlock_t lock;
+
+	/* parked commands, linked through fuse_uring_pdu->list */
+	struct list_head avail;
+
+	/* requests waiting for a parked command */
+	struct list_head pending;
+
+	/* set by fuse_uring_abort(), nothing is queued or parked after that */
+	bool stopped;
+
+	/* requests copied to the server and waiting for the reply */
+	struct fuse_pqueue fpq;
+};
+
+struct fuse_ring {
+	/* indexed by CPU, allocated when the first command names it */
+	struct fuse_ring_queue *queues[];
+};
+
+/* lives in io_uring_cmd->pdu while the command is in flight */
+struct fuse_uring_pdu {
+	struct list_head list;
+	void __user *buf;
+	u32 len;
+	u16 qid;
+};
+
+static struct fuse_uring_pdu *fuse_uring_pdu(struct io_uring_cmd *cmd)
+{
+	BUILD_BUG_ON(sizeof(struct fuse_uring_pdu) > sizeof(cmd->pdu));
+
+	return (struct fuse_uring_pdu *)cmd->pdu;
+}
+
+static struct io_uring_cmd *fuse_uring_pdu_cmd(struct fuse_uring_pdu *pdu)
+{
+	return container_of((void *)pdu, struct io_uring_cmd, pdu);
+}
+
+static struct fuse_conn *fuse_uring_cmd_conn(struct io_uring_cmd *cmd)
+{
+	struct fuse_dev *fud = READ_ONCE(cmd->file->private_data);
+
+	return fud->fc;
+}
+
+static struct fuse_ring_queue *fuse_uring_cmd_queue(struct io_uring_cmd *cmd)
+{
+	struct fuse_conn *fc = fuse_uring_cmd_conn(cmd);
+
+	return fc->ring->queues[fuse_uring_pdu(cmd)->qid];
+}
+
+/*
+ * Hand pending requests of the queue to @cmd, or park it if there are none.
+ * Runs in the context of the server task, so the buffer can be accessed.
+ */
+static void fuse_uring_send_cb(struct io_uring_cmd *cmd,
+			       unsigned int issue_flags)
+{
+	struct fuse_uring_pdu *pdu = fuse_uring_pdu(cmd);
+	struct fuse_conn *fc = fuse_uring_cmd_conn(cmd);
+	struct fuse_ring_queue *queue = fc->ring->queues[pdu->qid];
+	struct fuse_req *req;
+	ssize_t ret;
+
+	/* task work run from the fallback kthread after the task exited */
+	if (unlikely(current->flags & (PF_EXITING | PF_KTHREAD))) {
+		ret = -ECANCELED;
+		goto done;
+	}
+
+	do {
+		spin_lock(&queue->lock);
+		if (queue->stopped) {
+			spin_unlock(&queue->lock);
+			ret = -ENOTCONN;
+			break;
+		}
+		req = list_first_entry_or_null(&queue->pending,
+					       struct fuse_req, list);
+		if (!req) {
+			list_add(&pdu->list, &queue->avail);
+			spin_unlock(&queue->lock);
+			return;
+		}
+		list_del_init(&req->list);
+		spin_unlock(&queue->lock);
+
+		/* zero means the request did not fit and was ended */
+		ret = fuse_dev_send_req(fc, &queue->fpq, req, pdu->buf,
+					pdu->len);
+	} while (!ret);
+done:
+	io_uring_cmd_done(cmd, ret, 0, issue_flags);
+}
+
+/*
+ * Called by queue_request_and_unlock() with fiq->lock held.  Returns false if
+ * the current CPU has no queue, and the request goes to fiq->pending instead.
+ */
+bool fuse_uring_queue_request(struct fuse_iqueue *fiq, struct fuse_req *req)
+{
+	struct fuse_conn *fc = container_of(fiq, struct fuse_conn, iq);
+	struct fuse_ring *ring = smp_load_acquire(&fc->ring);
+	struct fuse_ring_queue *queue;
+	struct fuse_uring_pdu *pdu;
+
+	if (!ring)
+		return false;
+
+	queue = smp_load_acquire(&ring->queues[raw_smp_processor_id()]);
+	if (!queue)
+		return false;
+
+	spin_lock(&queue->lock);
+	if (queue->stopped) {
+		spin_unlock(&queue->lock);
+		return false;
+	}
+	/*
+	 * Not on fiq->pending, so an interrupted waiter must not try to take
+	 * it back from there.
+	 */
+	clear_bit(FR_PENDING, &req->flags);
+	list_add_tail(&req->list, &queue->pending);
+	pdu = list_first_entry_or_null(&queue->avail, struct fuse_uring_pdu,
+				       list);
+	if (pdu)
+		list_del_init(&pdu->list);
+	spin_unlock(&queue->lock);
+
+	if (pdu)
+		io_uring_cmd_complete_in_task(fuse_uring_pdu_cmd(pdu),
+					      fuse_uring_send_cb);
+	return true;
+}
+
+static struct fuse_ring_queue *fuse_uring_get_queue(struct fuse_conn *fc,
+						    unsigned int qid)
+{
+	struct fuse_ring *ring = smp_load_acquire(&fc->ring);
+	struct fuse_ring_queue *queue;
+	struct list_head *pq;
+	int err = 0;
+
+	if (!ring) {
+		ring = kzalloc(struct_size(ring, queues, nr_cpu_ids),
+			       GFP_KERNEL_ACCOUNT);
+		if (!ring)
+			return ERR_PTR(-ENOMEM);
+
+		spin_lock(&fc->lock);
+		if (!fc->ring) {
+			smp_store_release(&fc->ring, ring);
+			ring = NULL;
+		}
+		spin_unlock(&fc->lock);
+		kfree(ring);
+		ring = fc->ring;
+	}
+
+	queue = smp_load_acquire(&ring->queues[qid]);
+	if (queue)
+		return queue;
+
+	queue = kzalloc(sizeof(*queue), GFP_KERNEL_ACCOUNT);
+	pq = kcalloc(FUSE_PQ_HASH_SIZE, sizeof(struct list_head),
+		     GFP_KERNEL_ACCOUNT);
+	if (!queue || !pq) {
+		kfree(queue);
+		kfree(pq);
+		return ERR_PTR(-ENOMEM);
+	}
+	spin_lock_init(&queue->lock);
+	INIT_LIST_HEAD(&queue->avail);
+	INIT_LIST_HEAD(&queue->pending);
+	queue->fpq.processing = pq;
+	fuse_pqueue_init(&queue->fpq);
+
+	/* pairs with fuse_uring_abort(), which walks the queues under fc->lock */
+	spin_lock(&fc->lock);
+	if (!fc->connected)
+		err = -ENOTCONN;
+	else if (ring->queues[qid])
+		err = -EEXIST;
+	else
+		smp_store_release(&ring->queues[qid], queue);
+	spin_unlock(&fc->lock);
+
+	if (err) {
+		kfree(pq);
+		kfree(queue);
+		if (err != -EEXIST)
+			return ERR_PTR(err);
+		queue = ring->queues[qid];
+	}
+	return queue;
+}
+
+static void fuse_uring_cancel(struct io_uring_cmd *cmd,
+			      unsigned int issue_flags)
+{
+	struct fuse_uring_pdu *pdu = fuse_uring_pdu(cmd);
+	struct fuse_ring_queue *queue = fuse_uring_cmd_queue(cmd);
+	bool parked;
+
+	/* a command off the avail list is owned by whoever took it */
+	spin_lock(&queue->lock);
+	parked = !list_empty(&pdu->list);
+	list_del_init(&pdu->list);
+	spin_unlock(&queue->lock);
+
+	if (parked)
+		io_uring_cmd_done(cmd, -ENOTCONN, 0, issue_flags);
+}
+
+int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
+{
+	struct fuse_uring_pdu *pdu = fuse_uring_pdu(cmd);
+	const struct fuse_percpu_uring_req *cmd_req;
+	struct fuse_ring_queue *queue;
+	struct fuse_conn *fc;
+	ssize_t ret;
+	u32 len;
+
+	if (!READ_ONCE(cmd->file->private_data))
+		return -EPERM;
+	fc = fuse_uring_cmd_conn(cmd);
+
+	if (issue_flags & IO_URING_F_CANCEL) {
+		fuse_uring_cancel(cmd, issue_flags);
+		return 0;
+	}
+
+	if (!fc->io_uring)
+		return -EOPNOTSUPP;
+
+	if (cmd->cmd_op != FUSE_URING_CMD_FETCH &&
+	    cmd->cmd_op != FUSE_URING_CMD_COMMIT_AND_FETCH)
+		return -EINVAL;
+
+	cmd_req = (const struct fuse_percpu_uring_req *)cmd->sqe->cmd;
+	if (READ_ONCE(cmd_req->flags))
+		return -EINVAL;
+	pdu->buf = u64_to_user_ptr(READ_ONCE(cmd_req->buf));
+	pdu->len = READ_ONCE(cmd_req->buf_len);
+	pdu->qid = READ_ONCE(cmd_req->qid);
+
+	if (pdu->qid >= nr_cpu_ids || !cpu_possible(pdu->qid))
+		return -EINVAL;
+
+	/* same minimum as for read(2) of the fuse device */
+	if (pdu->len < max_t(size_t, FUSE_MIN_READ_BUFFER,
+			     sizeof(struct fuse_in_header) +
+			     sizeof(struct fuse_write_in) +
+			     fc->max_write))
+		return -EINVAL;
+
+	queue = fuse_uring_get_queue(fc, pdu->qid);
+	if (IS_ERR(queue))
+		return PTR_ERR(queue);
+
+	if (cmd->cmd_op == FUSE_URING_CMD_COMMIT_AND_FETCH) {
+		if (get_user(len, (u32 __user *)pdu->buf))
+			return -EFAULT;
+		if (len > pdu->len)
+			return -EINVAL;
+
+		ret = fuse_dev_reply(fc, &queue->fpq, pdu->buf, len);
+		if (ret < 0)
+			return ret;
+	}
+
+	/* until it is parked this is a no-op for fuse_uring_cancel() */
+	INIT_LIST_HEAD(&pdu->list);
+	io_uring_cmd_mark_cancelable(cmd, issue_flags);
+	fuse_uring_send_cb(cmd, issue_flags);
+
+	return -EIOCBQUEUED;
+}
+
+/*
+ * Called by fuse_abort_conn() under fc->lock.  Pending requests go to
+ * @to_end, and parked commands complete with -ENOTCONN from their task.
+ */
+void fuse_uring_abort(struct fuse_conn *fc, struct list_head *to_end)
+{
+	struct fuse_ring *ring = fc->ring;
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < nr_cpu_ids; qid++) {
+		struct fuse_ring_queue *queue = ring->queues[qid];
+		struct fuse_uring_pdu *pdu, *next;
+
+		if (!queue)
+			continue;
+
+		spin_lock(&queue->lock);
+		queue->stopped = true;
+		list_splice_tail_init(&queue->pending, to_end);
+		list_for_each_entry_safe(pdu, next, &queue->avail, list) {
+			list_del_init(&pdu->list);
+			io_uring_cmd_complete_in_task(fuse_uring_pdu_cmd(pdu),
+						      fuse_uring_send_cb);
+		}
+		spin_unlock(&queue->lock);
+
+		fuse_abort_pqueue(&queue->fpq, to_end);
+	}
+}
+
+void fuse_uring_destroy(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = fc->ring;
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < nr_cpu_ids; qid++) {
+		struct fuse_ring_queue *queue = ring->queues[qid];
+
+		if (!queue)
+			continue;
+
+		WARN_ON(!list_empty(&queue->pending));
+		WARN_ON(!list_empty(&queue->avail));
+		kfree(queue->fpq.processing);
+		kfree(queue);
+	}
+	kfree(ring);
+}
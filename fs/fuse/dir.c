@@ -687,6 +687,9 @@ static int fuse_create_open(struct inode *dir, struct dentry *entry,
 	ff->fh = outopen.fh;
 	ff->nodeid = outentry.nodeid;
 	ff->open_flags = outopen.open_flags;
+	ff->backing_id = outopen.backing_id;
+	if (!fm->fc->passthrough)
+		ff->open_flags &= ~FOPEN_PASSTHROUGH;
 	inode = fuse_iget(dir->i_sb, outentry.nodeid, outentry.generation,
 			  &outentry.attr, entry_attr_timeout(&outentry), 0);
 	if (!inode) {
@@ -706,6 +709,12 @@ static int fuse_create_open(struct inode *dir, struct dentry *entry,
 		fuse_sync_release(fi, ff, flags);
 	} else {
 		file->private_data = ff;
+		/* The file is open, on error ->release() cleans up */
+		if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH)) {
+			err = fuse_passthrough_open(inode, file);
+			if (err)
+				return err;
+		}
 		fuse_finish_open(inode, file);
 		if (fm->fc->atomic_o_trunc && trunc)
 			truncate_pagecache(inode, 0);
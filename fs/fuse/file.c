@@ -85,6 +85,8 @@ struct fuse_file *fuse_file_alloc(struct fuse_mount *fm)
 
 void fuse_file_free(struct fuse_file *ff)
 {
+	if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+		fuse_passthrough_release(ff);
 	kfree(ff->release_args);
 	mutex_destroy(&ff->readdir.lock);
 	kfree(ff);
@@ -122,6 +124,8 @@ static void fuse_file_put(struct fuse_file *ff, bool sync, bool isdir)
 						   GFP_KERNEL | __GFP_NOFAIL))
 				fuse_release_end(ff->fm, args, -ENOTCONN);
 		}
+		if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+			fuse_passthrough_release(ff);
 		kfree(ff);
 	}
 }
@@ -148,6 +152,7 @@ struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
 		if (!err) {
 			ff->fh = outarg.fh;
 			ff->open_flags = outarg.open_flags;
+			ff->backing_id = outarg.backing_id;
 
 		} else if (err != -ENOSYS) {
 			fuse_file_free(ff);
@@ -162,6 +167,8 @@ struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
 
 	if (isdir)
 		ff->open_flags &= ~FOPEN_DIRECT_IO;
+	if (isdir || !fc->passthrough)
+		ff->open_flags &= ~FOPEN_PASSTHROUGH;
 
 	ff->nodeid = nodeid;
 
@@ -251,6 +258,12 @@ int fuse_open_common(struct inode *inode, struct file *file, bool isdir)
 		fuse_set_nowrite(inode);
 
 	err = fuse_do_open(fm, get_node_id(inode), file, isdir);
+	if (!err && IS_ENABLED(CONFIG_FUSE_PASSTHROUGH)) {
+		err = fuse_passthrough_open(inode, file);
+		if (err)
+			fuse_sync_release(get_fuse_inode(inode),
+					  file->private_data, file->f_flags);
+	}
 	if (!err)
 		fuse_finish_open(inode, file);
 
@@ -1670,6 +1683,9 @@ static ssize_t fuse_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	if (fuse_is_bad(inode))
 		return -EIO;
 
+	if (FUSE_IS_PASSTHROUGH(ff))
+		return fuse_passthrough_read_iter(iocb, to);
+
 	if (FUSE_IS_DAX(inode))
 		return fuse_dax_read_iter(iocb, to);
 
@@ -1688,6 +1704,9 @@ static ssize_t fuse_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	if (fuse_is_bad(inode))
 		return -EIO;
 
+	if (FUSE_IS_PASSTHROUGH(ff))
+		return fuse_passthrough_write_iter(iocb, from);
+
 	if (FUSE_IS_DAX(inode))
 		return fuse_dax_write_iter(iocb, from);
 
@@ -2504,6 +2523,9 @@ static int fuse_file_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	struct fuse_file *ff = file->private_data;
 
+	if (FUSE_IS_PASSTHROUGH(ff))
+		return fuse_passthrough_mmap(file, vma);
+
 	/* DAX mmap is superior to direct_io mmap */
 	if (FUSE_IS_DAX(file_inode(file)))
 		return fuse_dax_mmap(file, vma);
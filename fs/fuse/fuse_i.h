@@ -31,6 +31,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
@@ -172,6 +173,7 @@ enum {
 struct fuse_conn;
 struct fuse_mount;
 struct fuse_release_args;
+struct fuse_ring;
 
 /** FUSE specific file data */
 struct fuse_file {
@@ -226,6 +228,12 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** backing_id from the open reply, if FOPEN_PASSTHROUGH is set */
+	int backing_id;
+
+	/** Backing file doing read, write and mmap for FOPEN_PASSTHROUGH */
+	struct file *passthrough;
 };
 
 /** One input argument of a request */
@@ -792,6 +800,15 @@ struct fuse_conn {
 	/* Is tmpfile not implemented by fs? */
 	unsigned int no_tmpfile:1;
 
+	/* Passthrough to backing files negotiated by INIT */
+	unsigned int passthrough:1;
+
+	/** Maximum stack depth of backing files, including this fs */
+	int max_stack_depth;
+
+	/* Requests may be delivered with io_uring, negotiated by INIT */
+	unsigned int io_uring:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -841,6 +858,16 @@ struct fuse_conn {
 
 	/* New writepages go into this bucket */
 	struct fuse_sync_bucket __rcu *curr_bucket;
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/** Backing files registered with FUSE_DEV_IOC_BACKING_OPEN */
+	struct idr backing_files_map;
+#endif
+
+#ifdef CONFIG_FUSE_IO_URING
+	/** Per-CPU io_uring request queues, allocated on first use */
+	struct fuse_ring *ring;
+#endif
 };
 
 /*
@@ -1317,6 +1344,38 @@ int fuse_fileattr_get(struct dentry *dentry, struct fileattr *fa);
 int fuse_fileattr_set(struct mnt_idmap *idmap,
 		      struct dentry *dentry, struct fileattr *fa);
 
+/* passthrough.c */
+
+#define FUSE_IS_PASSTHROUGH(ff) \
+	(IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) && (ff)->passthrough)
+
+void fuse_backing_files_init(struct fuse_conn *fc);
+void fuse_backing_files_free(struct fuse_conn *fc);
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map);
+int fuse_backing_close(struct fuse_conn *fc, int backing_id);
+int fuse_passthrough_open(struct inode *inode, struct file *file);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
+/* dev_uring.c */
+
+struct io_uring_cmd;
+
+bool fuse_uring_queue_request(struct fuse_iqueue *fiq, struct fuse_req *req);
+int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags);
+void fuse_uring_abort(struct fuse_conn *fc, struct list_head *to_end);
+void fuse_uring_destroy(struct fuse_conn *fc);
+
+/* dev.c helpers for dev_uring.c */
+void fuse_pqueue_init(struct fuse_pqueue *fpq);
+void fuse_abort_pqueue(struct fuse_pqueue *fpq, struct list_head *to_end);
+ssize_t fuse_dev_send_req(struct fuse_conn *fc, struct fuse_pqueue *fpq,
+			  struct fuse_req *req, void __user *buf, size_t len);
+ssize_t fuse_dev_reply(struct fuse_conn *fc, struct fuse_pqueue *fpq,
+		       void __user *buf, size_t len);
+
 /* file.c */
 
 struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
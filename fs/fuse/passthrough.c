@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE passthrough: read, write and mmap directly on a backing file
+ * registered by the server.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/uio.h>
+
+struct fuse_backing {
+	struct file *file;
+	refcount_t count;
+	struct rcu_head rcu;
+};
+
+static void fuse_backing_put(struct fuse_backing *fb)
+{
+	if (refcount_dec_and_test(&fb->count)) {
+		fput(fb->file);
+		kfree_rcu(fb, rcu);
+	}
+}
+
+void fuse_backing_files_init(struct fuse_conn *fc)
+{
+	idr_init(&fc->backing_files_map);
+}
+
+void fuse_backing_files_free(struct fuse_conn *fc)
+{
+	struct fuse_backing *fb;
+	int id;
+
+	idr_for_each_entry(&fc->backing_files_map, fb, id)
+		fuse_backing_put(fb);
+	idr_destroy(&fc->backing_files_map);
+}
+
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
+{
+	struct super_block *backing_sb;
+	struct fuse_backing *fb;
+	struct file *file;
+	int res;
+
+	/* The backing file is used with the credentials of whoever opened it */
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (!fc->passthrough)
+		return -EOPNOTSUPP;
+
+	if (map->flags || map->padding)
+		return -EINVAL;
+
+	file = fget(map->fd);
+	if (!file)
+		return -EBADF;
+
+	res = -EOPNOTSUPP;
+	if (!file->f_op->read_iter || !file->f_op->write_iter ||
+	    !S_ISREG(file_inode(file)->i_mode))
+		goto out_fput;
+
+	backing_sb = file_inode(file)->i_sb;
+	res = -ELOOP;
+	if (backing_sb->s_stack_depth >= fc->max_stack_depth)
+		goto out_fput;
+
+	res = -ENOMEM;
+	fb = kmalloc(sizeof(*fb), GFP_KERNEL);
+	if (!fb)
+		goto out_fput;
+
+	fb->file = file;
+	refcount_set(&fb->count, 1);
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->lock);
+	res = idr_alloc_cyclic(&fc->backing_files_map, fb, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->lock);
+	idr_preload_end();
+	if (res < 0) {
+		kfree(fb);
+		goto out_fput;
+	}
+	return res;
+
+out_fput:
+	fput(file);
+	return res;
+}
+
+int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (!fc->passthrough)
+		return -EOPNOTSUPP;
+
+	if (backing_id <= 0)
+		return -EINVAL;
+
+	spin_lock(&fc->lock);
+	fb = idr_remove(&fc->backing_files_map, backing_id);
+	spin_unlock(&fc->lock);
+	if (!fb)
+		return -ENOENT;
+
+	fuse_backing_put(fb);
+	return 0;
+}
+
+static struct fuse_backing *fuse_backing_lookup(struct fuse_conn *fc,
+						int backing_id)
+{
+	struct fuse_backing *fb;
+
+	rcu_read_lock();
+	fb = idr_find(&fc->backing_files_map, backing_id);
+	if (fb && !refcount_inc_not_zero(&fb->count))
+		fb = NULL;
+	rcu_read_unlock();
+
+	return fb;
+}
+
+/*
+ * Open the backing file for a FOPEN_PASSTHROUGH reply.  Like overlayfs, the
+ * new file shows the FUSE path but its inode and operations are those of the
+ * backing file, and it carries the credentials the backing file was opened
+ * with by the server.
+ */
+int fuse_passthrough_open(struct inode *inode, struct file *file)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_backing *fb;
+	struct file *backing_file;
+
+	if (!(ff->open_flags & FOPEN_PASSTHROUGH) || !S_ISREG(inode->i_mode))
+		return 0;
+
+	if (FUSE_IS_DAX(inode))
+		return -EINVAL;
+
+	fb = fuse_backing_lookup(fc, ff->backing_id);
+	if (!fb)
+		return -ENOENT;
+
+	backing_file = open_with_fake_path(&file->f_path,
+					   file->f_flags & ~(O_CREAT | O_EXCL |
+							     O_NOCTTY | O_TRUNC),
+					   file_inode(fb->file),
+					   fb->file->f_cred);
+	fuse_backing_put(fb);
+	if (IS_ERR(backing_file))
+		return PTR_ERR(backing_file);
+
+	ff->passthrough = backing_file;
+	return 0;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough) {
+		fput(ff->passthrough);
+		ff->passthrough = NULL;
+	}
+}
+
+static rwf_t fuse_passthrough_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = ff->passthrough;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	if (iocb->ki_flags & IOCB_DIRECT &&
+	    !(backing_file->f_mode & FMODE_CAN_ODIRECT))
+		return -EINVAL;
+
+	old_cred = override_creds(backing_file->f_cred);
+	ret = vfs_iter_read(backing_file, to, &iocb->ki_pos,
+			    fuse_passthrough_rwf(iocb->ki_flags));
+	revert_creds(old_cred);
+	fuse_invalidate_atime(file_inode(file));
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = ff->passthrough;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(from))
+		return 0;
+
+	if (iocb->ki_flags & IOCB_DIRECT &&
+	    !(backing_file->f_mode & FMODE_CAN_ODIRECT))
+		return -EINVAL;
+
+	inode_lock(inode);
+	old_cred = override_creds(backing_file->f_cred);
+	file_start_write(backing_file);
+	ret = vfs_iter_write(backing_file, from, &iocb->ki_pos,
+			     fuse_passthrough_rwf(iocb->ki_flags));
+	file_end_write(backing_file);
+	revert_creds(old_cred);
+	if (ret > 0)
+		fuse_write_update_attr(inode, iocb->ki_pos, ret);
+	inode_unlock(inode);
+
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = ff->passthrough;
+	const struct cred *old_cred;
+	int ret;
+
+	if (!backing_file->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma_set_file(vma, backing_file);
+
+	old_cred = override_creds(backing_file->f_cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+	file_accessed(file);
+
+	return ret;
+}
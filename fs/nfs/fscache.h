@@ -99,6 +99,11 @@ extern void nfs_fscache_release_file(struct inode *, struct file *);
 extern int nfs_netfs_readahead(struct readahead_control *ractl);
 extern int nfs_netfs_read_folio(struct file *file, struct folio *folio);
 
+static inline bool nfs_fscache_enabled(struct inode *inode)
+{
+	return netfs_i_cookie(netfs_inode(inode)) != NULL;
+}
+
 static inline bool nfs_fscache_release_folio(struct folio *folio, gfp_t gfp)
 {
 	if (folio_test_fscache(folio)) {
@@ -183,6 +188,11 @@ static inline int nfs_netfs_read_folio(struct file *file, struct folio *folio)
 	return -ENOBUFS;
 }
 
+static inline bool nfs_fscache_enabled(struct inode *inode)
+{
+	return false;
+}
+
 static inline bool nfs_fscache_release_folio(struct folio *folio, gfp_t gfp)
 {
 	return true; /* may release folio */
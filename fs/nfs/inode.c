@@ -580,6 +580,14 @@ nfs_fhget(struct super_block *sb, struct nfs_fh *fh, struct nfs_fattr *fattr)
 
 		nfs_fscache_init_inode(inode);
 
+		/*
+		 * Requests track folios, so let readahead build large
+		 * folios and a full rsize/wsize RPC only needs a handful of
+		 * nfs_pages.  The fscache read path still assumes pages.
+		 */
+		if (S_ISREG(inode->i_mode) && !nfs_fscache_enabled(inode))
+			mapping_set_large_folios(inode->i_mapping);
+
 		unlock_new_inode(inode);
 	} else {
 		int err = nfs_refresh_inode(inode, fattr);
@@ -78,6 +78,19 @@ static __be32			nfsd_init_request(struct svc_rqst *,
  */
 DEFINE_MUTEX(nfsd_mutex);
 
+/*
+ * On top of the threads configured through /proc/fs/nfsd/threads, up to
+ * nfsd_dynamic_threads more are started whenever a request finds all
+ * threads of its pool busy.  They exit again after NFSD_DYNAMIC_IDLE
+ * without work, so bursts don't require over-provisioning.
+ */
+static unsigned int nfsd_dynamic_threads;
+module_param_named(dynamic_threads, nfsd_dynamic_threads, uint, 0644);
+MODULE_PARM_DESC(dynamic_threads,
+		 "Number of extra nfsd threads started on demand. Default: 0");
+
+#define NFSD_DYNAMIC_IDLE	(30 * HZ)
+
 /*
  * nfsd_drc_lock protects nfsd_drc_max_pages and nfsd_drc_pages_used.
  * nfsd_drc_max_pages limits the total amount of memory available for
@@ -938,6 +951,28 @@ nfsd_init_request(struct svc_rqst *rqstp,
 	return rpc_prog_mismatch;
 }
 
+/*
+ * All threads of the pool were busy when a transport got queued, so add
+ * one more.  Server startup and shutdown hold nfsd_mutex, and shutdown
+ * waits for this thread, so only ever try to take it.
+ */
+static void nfsd_grow_pool(struct nfsd_net *nn, struct svc_rqst *rqstp)
+{
+	struct svc_serv *serv = rqstp->rq_server;
+	struct svc_pool *pool = rqstp->rq_pool;
+
+	if (!test_bit(SP_CONGESTED, &pool->sp_flags))
+		return;
+	if (READ_ONCE(serv->sv_nrdynamic) >= READ_ONCE(nfsd_dynamic_threads))
+		return;
+	if (!mutex_trylock(&nfsd_mutex))
+		return;
+	if (nn->nfsd_serv == serv && !kthread_should_stop() &&
+	    test_and_clear_bit(SP_CONGESTED, &pool->sp_flags))
+		svc_start_dynamic_thread(serv, pool);
+	mutex_unlock(&nfsd_mutex);
+}
+
 /*
  * This is the NFS server kernel thread
  */
@@ -948,6 +983,8 @@ nfsd(void *vrqstp)
 	struct svc_xprt *perm_sock = list_entry(rqstp->rq_server->sv_permsocks.next, typeof(struct svc_xprt), xpt_list);
 	struct net *net = perm_sock->xpt_net;
 	struct nfsd_net *nn = net_generic(net, nfsd_net_id);
+	bool dynamic = test_bit(RQ_DYNAMIC, &rqstp->rq_flags);
+	unsigned long last_work = jiffies;
 	int err;
 
 	/* At this point, the thread shares current->fs
@@ -984,10 +1021,19 @@ nfsd(void *vrqstp)
 		 * Find a socket with data available and call its
 		 * recvfrom routine.
 		 */
-		while ((err = svc_recv(rqstp, 60*60*HZ)) == -EAGAIN)
-			;
+		while ((err = svc_recv(rqstp, dynamic ? NFSD_DYNAMIC_IDLE :
+						  60*60*HZ)) == -EAGAIN) {
+			if (dynamic &&
+			    time_after(jiffies, last_work + NFSD_DYNAMIC_IDLE) &&
+			    svc_thread_try_retire(rqstp)) {
+				err = -EINTR;
+				break;
+			}
+		}
 		if (err == -EINTR)
 			break;
+		last_work = jiffies;
+		nfsd_grow_pool(nn, rqstp);
 		validate_process_creds();
 		svc_process(rqstp);
 		validate_process_creds();
@@ -24,6 +24,14 @@ struct ovl_aio_req {
 
 static struct kmem_cache *ovl_aio_request_cachep;
 
+/* file->private_data of regular files */
+struct ovl_file {
+	/* opened at open time */
+	struct file *realfile;
+	/* cached once the file was copied up since open */
+	struct file *upperfile;
+};
+
 static char ovl_whatisit(struct inode *inode, struct inode *realinode)
 {
 	if (realinode != ovl_inode_upper(inode))
@@ -46,9 +54,14 @@ static struct file *ovl_open_realfile(const struct file *file,
 	struct file *realfile;
 	const struct cred *old_cred;
 	int flags = file->f_flags | OVL_OPEN_FLAGS;
-	int acc_mode = ACC_MODE(flags);
+	int acc_mode;
 	int err;
 
+	/* Lower data of a lazily copied up file is only ever read */
+	if (realinode != ovl_inode_upper(inode))
+		flags = (flags & ~O_ACCMODE) | O_RDONLY;
+	acc_mode = ACC_MODE(flags);
+
 	if (flags & O_APPEND)
 		acc_mode |= MAY_APPEND;
 
@@ -102,14 +115,42 @@ static int ovl_change_flags(struct file *file, unsigned int flags)
 	return 0;
 }
 
+/*
+ * Like ovl_dir_real_file(), the upper file is opened once and kept until the
+ * file is released: a file opened for write with lazy_copy_up=on switches over
+ * from the lower data on its first write.
+ */
+static struct file *ovl_real_upperfile(const struct file *file,
+				       const struct path *upperpath)
+{
+	struct ovl_file *of = file->private_data;
+	struct file *old, *upperfile = smp_load_acquire(&of->upperfile);
+
+	if (upperfile)
+		return upperfile;
+
+	upperfile = ovl_open_realfile(file, upperpath);
+	if (IS_ERR(upperfile))
+		return upperfile;
+
+	old = cmpxchg_release(&of->upperfile, NULL, upperfile);
+	if (old) {
+		fput(upperfile);
+		upperfile = old;
+	}
+
+	return upperfile;
+}
+
 static int ovl_real_fdget_meta(const struct file *file, struct fd *real,
 			       bool allow_meta)
 {
+	struct ovl_file *of = file->private_data;
 	struct dentry *dentry = file_dentry(file);
 	struct path realpath;
 
 	real->flags = 0;
-	real->file = file->private_data;
+	real->file = of->realfile;
 
 	if (allow_meta)
 		ovl_path_real(dentry, &realpath);
@@ -118,14 +159,14 @@ static int ovl_real_fdget_meta(const struct file *file, struct fd *real,
 
 	/* Has it been copied up since we'd opened it? */
 	if (unlikely(file_inode(real->file) != d_inode(realpath.dentry))) {
-		real->flags = FDPUT_FPUT;
-		real->file = ovl_open_realfile(file, &realpath);
-
-		return PTR_ERR_OR_ZERO(real->file);
+		real->file = ovl_real_upperfile(file, &realpath);
+		if (IS_ERR(real->file))
+			return PTR_ERR(real->file);
 	}
 
 	/* Did the flags change since open? */
-	if (unlikely((file->f_flags ^ real->file->f_flags) & ~OVL_OPEN_FLAGS))
+	if (unlikely((file->f_flags ^ real->file->f_flags) &
+		     ~(OVL_OPEN_FLAGS | O_ACCMODE)))
 		return ovl_change_flags(real->file, file->f_flags);
 
 	return 0;
@@ -143,33 +184,80 @@ static int ovl_real_fdget(const struct file *file, struct fd *real)
 	return ovl_real_fdget_meta(file, real, false);
 }
 
+/*
+ * With lazy_copy_up=on, opening a lower file for write does not copy it up.
+ * Reads keep going to the lower data until the first operation that modifies
+ * the data copies it up, and ovl_real_fdget() then switches to the upper file.
+ */
+static bool ovl_open_lazy_copy_up(struct dentry *dentry, int flags)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+
+	return ofs->config.lazy_copy_up && d_is_reg(dentry) &&
+	       !(flags & O_TRUNC) && !ovl_has_upperdata(d_inode(dentry));
+}
+
+static int ovl_copy_up_for_write(struct file *file)
+{
+	struct dentry *dentry = file_dentry(file);
+	int err;
+
+	if (ovl_has_upperdata(file_inode(file)))
+		return 0;
+
+	err = ovl_want_write(dentry);
+	if (!err) {
+		err = ovl_copy_up_with_data(dentry);
+		ovl_drop_write(dentry);
+	}
+
+	return err;
+}
+
 static int ovl_open(struct inode *inode, struct file *file)
 {
 	struct dentry *dentry = file_dentry(file);
 	struct file *realfile;
+	struct ovl_file *of;
 	struct path realpath;
+	int flags = file->f_flags;
 	int err;
 
-	err = ovl_maybe_copy_up(dentry, file->f_flags);
+	if (ovl_open_lazy_copy_up(dentry, flags))
+		flags &= ~O_ACCMODE;
+
+	err = ovl_maybe_copy_up(dentry, flags);
 	if (err)
 		return err;
 
 	/* No longer need these flags, so don't pass them on to underlying fs */
 	file->f_flags &= ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC);
 
+	of = kzalloc(sizeof(*of), GFP_KERNEL);
+	if (!of)
+		return -ENOMEM;
+
 	ovl_path_realdata(dentry, &realpath);
 	realfile = ovl_open_realfile(file, &realpath);
-	if (IS_ERR(realfile))
+	if (IS_ERR(realfile)) {
+		kfree(of);
 		return PTR_ERR(realfile);
+	}
 
-	file->private_data = realfile;
+	of->realfile = realfile;
+	file->private_data = of;
 
 	return 0;
 }
 
 static int ovl_release(struct inode *inode, struct file *file)
 {
-	fput(file->private_data);
+	struct ovl_file *of = file->private_data;
+
+	fput(of->realfile);
+	if (of->upperfile)
+		fput(of->upperfile);
+	kfree(of);
 
 	return 0;
 }
@@ -357,6 +445,10 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	if (!iov_iter_count(iter))
 		return 0;
 
+	ret = ovl_copy_up_for_write(file);
+	if (ret)
+		return ret;
+
 	inode_lock(inode);
 	/* Update mode */
 	ovl_copyattr(inode);
@@ -435,6 +527,10 @@ static ssize_t ovl_splice_write(struct pipe_inode_info *pipe, struct file *out,
 	struct inode *inode = file_inode(out);
 	ssize_t ret;
 
+	ret = ovl_copy_up_for_write(out);
+	if (ret)
+		return ret;
+
 	inode_lock(inode);
 	/* Update mode */
 	ovl_copyattr(inode);
@@ -491,16 +587,34 @@ static int ovl_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 
 static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 {
-	struct file *realfile = file->private_data;
+	struct ovl_file *of = file->private_data;
+	struct file *upperfile = smp_load_acquire(&of->upperfile);
+	struct file *realfile = of->realfile;
 	const struct cred *old_cred;
 	int ret;
 
+	/* the upper file may only have been opened for its metadata so far */
+	if (upperfile && ovl_has_upperdata(file_inode(file)))
+		realfile = upperfile;
+
 	if (!realfile->f_op->mmap)
 		return -ENODEV;
 
 	if (WARN_ON(file != vma->vm_file))
 		return -EIO;
 
+	/*
+	 * Copy up cannot run under mmap_lock, so a file opened for write
+	 * whose data is still on the lower layer only gets read-only shared
+	 * mappings.
+	 */
+	if ((vma->vm_flags & VM_SHARED) &&
+	    file_inode(realfile) != ovl_inode_upper(file_inode(file))) {
+		if (vma->vm_flags & VM_WRITE)
+			return -EACCES;
+		vm_flags_clear(vma, VM_MAYWRITE);
+	}
+
 	vma_set_file(vma, realfile);
 
 	old_cred = ovl_override_creds(file_inode(file)->i_sb);
@@ -518,6 +632,10 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	const struct cred *old_cred;
 	int ret;
 
+	ret = ovl_copy_up_for_write(file);
+	if (ret)
+		return ret;
+
 	inode_lock(inode);
 	/* Update mode */
 	ovl_copyattr(inode);
@@ -578,6 +696,12 @@ static loff_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 	const struct cred *old_cred;
 	loff_t ret;
 
+	if (op != OVL_DEDUPE) {
+		ret = ovl_copy_up_for_write(file_out);
+		if (ret)
+			return ret;
+	}
+
 	inode_lock(inode_out);
 	if (op != OVL_DEDUPE) {
 		/* Update mode */
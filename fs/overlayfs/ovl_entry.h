@@ -18,6 +18,7 @@ struct ovl_config {
 	bool nfs_export;
 	int xino;
 	bool metacopy;
+	bool lazy_copy_up;
 	bool userxattr;
 	bool ovl_volatile;
 };
@@ -387,6 +387,8 @@ static int ovl_show_options(struct seq_file *m, struct dentry *dentry)
 	if (ofs->config.metacopy != ovl_metacopy_def)
 		seq_printf(m, ",metacopy=%s",
 			   ofs->config.metacopy ? "on" : "off");
+	if (ofs->config.lazy_copy_up)
+		seq_puts(m, ",lazy_copy_up=on");
 	if (ofs->config.ovl_volatile)
 		seq_puts(m, ",volatile");
 	if (ofs->config.userxattr)
@@ -445,6 +447,8 @@ enum {
 	OPT_XINO_AUTO,
 	OPT_METACOPY_ON,
 	OPT_METACOPY_OFF,
+	OPT_LAZY_COPY_UP_ON,
+	OPT_LAZY_COPY_UP_OFF,
 	OPT_VOLATILE,
 	OPT_ERR,
 };
@@ -467,6 +471,8 @@ static const match_table_t ovl_tokens = {
 	{OPT_XINO_AUTO,			"xino=auto"},
 	{OPT_METACOPY_ON,		"metacopy=on"},
 	{OPT_METACOPY_OFF,		"metacopy=off"},
+	{OPT_LAZY_COPY_UP_ON,		"lazy_copy_up=on"},
+	{OPT_LAZY_COPY_UP_OFF,		"lazy_copy_up=off"},
 	{OPT_VOLATILE,			"volatile"},
 	{OPT_ERR,			NULL}
 };
@@ -620,6 +626,14 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 			metacopy_opt = true;
 			break;
 
+		case OPT_LAZY_COPY_UP_ON:
+			config->lazy_copy_up = true;
+			break;
+
+		case OPT_LAZY_COPY_UP_OFF:
+			config->lazy_copy_up = false;
+			break;
+
 		case OPT_VOLATILE:
 			config->ovl_volatile = true;
 			break;
@@ -810,6 +810,47 @@ static void smap_gather_stats(struct vm_area_struct *vma,
 		walk_page_range(vma->vm_mm, start, vma->vm_end, ops, mss);
 }
 
+/*
+ * smaps_rollup walks large VMAs in chunks of this size so that a writer
+ * waiting for mmap_lock only has to wait for the current chunk rather than
+ * for the whole VMA. It must be a multiple of PMD_SIZE so that a PMD-mapped
+ * THP is never accounted from two chunks.
+ */
+#define SMAPS_ROLLUP_CHUNK	max_t(unsigned long, SZ_64M, PMD_SIZE)
+
+/*
+ * Like smap_gather_stats(), but stop early at a chunk boundary when mmap_lock
+ * is contended. Returns the address up to which @vma has been accounted, which
+ * is vm_end once the whole VMA is done.
+ *
+ * shmem and hugetlb VMAs are always walked in one go: the former may account
+ * swap for the whole VMA up front, the latter account whole huge pages that
+ * may straddle a chunk boundary.
+ */
+static unsigned long smap_gather_stats_rollup(struct vm_area_struct *vma,
+		struct mem_size_stats *mss, unsigned long start)
+{
+	unsigned long addr, end;
+
+	if (is_vm_hugetlb_page(vma) ||
+	    (vma->vm_file && shmem_mapping(vma->vm_file->f_mapping))) {
+		smap_gather_stats(vma, mss, start);
+		return vma->vm_end;
+	}
+
+	addr = start ? start : vma->vm_start;
+	while (addr < vma->vm_end) {
+		end = min(ALIGN(addr + 1, SMAPS_ROLLUP_CHUNK), vma->vm_end);
+		walk_page_range(vma->vm_mm, addr, end, &smaps_walk_ops, mss);
+		addr = end;
+
+		if (addr < vma->vm_end && mmap_lock_is_contended(vma->vm_mm))
+			break;
+	}
+
+	return addr;
+}
+
 #define SEQ_PUT_DEC(str, val) \
 		seq_put_decimal_ull_width(m, str, (val) >> 10, 8)
 
@@ -887,7 +928,7 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 	struct mem_size_stats mss;
 	struct mm_struct *mm = priv->mm;
 	struct vm_area_struct *vma;
-	unsigned long vma_start = 0, last_vma_end = 0;
+	unsigned long vma_start = 0, last_vma_end = 0, start = 0;
 	int ret = 0;
 	VMA_ITERATOR(vmi, mm, 0);
 
@@ -913,15 +954,15 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 		goto empty_set;
 
 	vma_start = vma->vm_start;
-	do {
-		smap_gather_stats(vma, &mss, 0);
-		last_vma_end = vma->vm_end;
+	for (;;) {
+		last_vma_end = smap_gather_stats_rollup(vma, &mss, start);
 
 		/*
 		 * Release mmap_lock temporarily if someone wants to
-		 * access it for write request.
+		 * access it for write request. A large VMA may have been
+		 * left part way through for the same reason.
 		 */
-		if (mmap_lock_is_contended(mm)) {
+		if (last_vma_end < vma->vm_end || mmap_lock_is_contended(mm)) {
 			vma_iter_invalidate(&vmi);
 			mmap_read_unlock(mm);
 			ret = mmap_read_lock_killable(mm);
@@ -945,6 +986,8 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 			 *
 			 *	last_vma_end = 16k
 			 *
+			 * Looking up the first VMA that ends above last_vma_end:
+			 *
 			 * 1) VMA2 is freed, but VMA3 exists:
 			 *
 			 *    vma_next(vmi) will return VMA3.
@@ -960,26 +1003,30 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 			 *    vma_next(vmi) will return NULL.
 			 *    No more things to do, just break.
 			 *
-			 * 4) (last_vma_end - 1) is the middle of a vma (VMA'):
+			 * 4) last_vma_end is the middle of a vma (VMA'),
+			 *    either because VMA2 was merged or expanded, or
+			 *    because we stopped part way through a large VMA:
 			 *
 			 *    vma_next(vmi) will return VMA' whose range
 			 *    contains last_vma_end.
 			 *    Iterate VMA' from last_vma_end.
 			 */
+			vma_iter_set(&vmi, last_vma_end);
 			vma = vma_next(&vmi);
 			/* Case 3 above */
 			if (!vma)
 				break;
 
-			/* Case 1 and 2 above */
-			if (vma->vm_start >= last_vma_end)
-				continue;
-
-			/* Case 4 above */
-			if (vma->vm_end > last_vma_end)
-				smap_gather_stats(vma, &mss, last_vma_end);
+			/* Case 1 and 2 above: start == 0, case 4: resume */
+			start = vma->vm_start < last_vma_end ? last_vma_end : 0;
+			continue;
 		}
-	} for_each_vma(vmi, vma);
+
+		vma = vma_next(&vmi);
+		if (!vma)
+			break;
+		start = 0;
+	}
 
 empty_set:
 	show_vma_header_prefix(m, vma_start, last_vma_end, 0, 0, 0, 0);
@@ -196,6 +196,11 @@ struct shash_desc {
  * @update: see struct ahash_alg
  * @final: see struct ahash_alg
  * @finup: see struct ahash_alg
+ * @finup_mb: **[optional]** Finish hashing @num_msgs messages of the same
+ *	      length, each on top of the state in @desc, which is left
+ *	      unchanged.  Implementations interleave the messages to keep
+ *	      more of the CPU busy.  Only called with 2 to @mb_max_msgs
+ *	      messages.
  * @digest: see struct ahash_alg
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
@@ -212,6 +217,8 @@ struct shash_desc {
  *	      This is a counterpart to @init_tfm, used to remove
  *	      various changes set in @init_tfm.
  * @clone_tfm: Copy transform into new object, may allocate memory.
+ * @mb_max_msgs: Maximum number of messages @finup_mb handles at once, 1 if
+ *		 it is not implemented.
  * @digestsize: see struct ahash_alg
  * @statesize: see struct ahash_alg
  * @descsize: Size of the operational state for the message digest. This state
@@ -229,6 +236,9 @@ struct shash_alg {
 	int (*final)(struct shash_desc *desc, u8 *out);
 	int (*finup)(struct shash_desc *desc, const u8 *data,
 		     unsigned int len, u8 *out);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 	int (*digest)(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out);
 	int (*export)(struct shash_desc *desc, void *out);
@@ -240,6 +250,7 @@ struct shash_alg {
 	int (*clone_tfm)(struct crypto_shash *dst, struct crypto_shash *src);
 
 	unsigned int descsize;
+	unsigned int mb_max_msgs;
 
 	union {
 		struct HASH_ALG_COMMON;
@@ -881,6 +892,19 @@ static inline unsigned int crypto_shash_descsize(struct crypto_shash *tfm)
 	return tfm->descsize;
 }
 
+/**
+ * crypto_shash_mb_max_msgs() - obtain the multibuffer limit of a hash
+ * @tfm: cipher handle
+ *
+ * Return: how many messages crypto_shash_finup_mb() hashes at once.  Users
+ *	   gain nothing from batching more than that, 1 means the algorithm
+ *	   hashes them one after the other.
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs;
+}
+
 static inline void *shash_desc_ctx(struct shash_desc *desc)
 {
 	return desc->__ctx;
@@ -1049,6 +1073,25 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_finup_mb() - finish hashing several messages of the same length
+ * @desc: state shared by all messages, e.g. after hashing a salt
+ * @data: the remaining data of each message
+ * @len: number of bytes in each entry of @data
+ * @outs: buffers for the message digests
+ * @num_msgs: number of entries in @data and @outs
+ *
+ * Equivalent to calling crypto_shash_finup() on a copy of @desc for each
+ * message, but algorithms that implement &shash_alg.finup_mb process up to
+ * crypto_shash_mb_max_msgs() messages in parallel.  @desc is left unchanged.
+ *
+ * Context: Any context.
+ * Return: 0 if all message digests were created; < 0 if an error occurred
+ */
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs);
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
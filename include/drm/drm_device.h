@@ -15,6 +15,7 @@ struct drm_master;
 struct drm_vblank_crtc;
 struct drm_vma_offset_manager;
 struct drm_vram_mm;
+struct drm_gem_shmem_shrinker;
 struct drm_fb_helper;
 
 struct inode;
@@ -293,6 +294,9 @@ struct drm_device {
 	/** @vram_mm: VRAM MM memory manager */
 	struct drm_vram_mm *vram_mm;
 
+	/** @shmem_shrinker: shmem GEM object shrinker, if registered */
+	struct drm_gem_shmem_shrinker *shmem_shrinker;
+
 	/**
 	 * @switch_power_state:
 	 *
@@ -6,6 +6,7 @@
 #include <linux/fs.h>
 #include <linux/mm.h>
 #include <linux/mutex.h>
+#include <linux/shrinker.h>
 
 #include <drm/drm_file.h>
 #include <drm/drm_gem.h>
@@ -103,6 +104,27 @@ struct drm_gem_shmem_object {
 	bool map_wc : 1;
 };
 
+/**
+ * struct drm_gem_shmem_shrinker - Generic memory shrinker for shmem GEM objects
+ */
+struct drm_gem_shmem_shrinker {
+	/**
+	 * @base: Shrinker registered with the core MM
+	 */
+	struct shrinker base;
+
+	/**
+	 * @lock: Protects @lru_purgeable
+	 */
+	struct mutex lock;
+
+	/**
+	 * @lru_purgeable: Objects marked purgeable through
+	 * drm_gem_shmem_madvise(), least recently marked first
+	 */
+	struct drm_gem_lru lru_purgeable;
+};
+
 #define to_drm_gem_shmem_obj(obj) \
 	container_of(obj, struct drm_gem_shmem_object, base)
 
@@ -131,6 +153,11 @@ static inline bool drm_gem_shmem_is_purgeable(struct drm_gem_shmem_object *shmem
 void drm_gem_shmem_purge_locked(struct drm_gem_shmem_object *shmem);
 bool drm_gem_shmem_purge(struct drm_gem_shmem_object *shmem);
 
+int drm_gem_shmem_shrinker_init(struct drm_gem_shmem_shrinker *shmem_shrinker,
+				struct drm_device *dev, const char *name);
+void drm_gem_shmem_shrinker_fini(struct drm_gem_shmem_shrinker *shmem_shrinker,
+				 struct drm_device *dev);
+
 struct sg_table *drm_gem_shmem_get_sg_table(struct drm_gem_shmem_object *shmem);
 struct sg_table *drm_gem_shmem_get_pages_sgt(struct drm_gem_shmem_object *shmem);
 
@@ -112,6 +112,11 @@
 /* KVM "vendor specific" services */
 #define ARM_SMCCC_KVM_FUNC_FEATURES		0
 #define ARM_SMCCC_KVM_FUNC_PTP			1
+/*
+ * Upstream allocates 2 to 65 (pKVM, errata discovery). Services local
+ * to this tree sit well above them so the two never overlap.
+ */
+#define ARM_SMCCC_KVM_FUNC_PV_SCHED		96
 #define ARM_SMCCC_KVM_FUNC_FEATURES_2		127
 #define ARM_SMCCC_KVM_NUM_FUNCS			128
 
@@ -138,6 +143,20 @@
 #define KVM_PTP_VIRT_COUNTER			0
 #define KVM_PTP_PHYS_COUNTER			1
 
+/*
+ * PV scheduling hints. Argument 1 selects the operation: IPA_INIT passes
+ * the IPA of the calling vCPU's 64 byte aligned struct pvsched_vcpu_state
+ * in argument 2, IPA_RELEASE stops the host from writing to it.
+ */
+#define ARM_SMCCC_VENDOR_HYP_KVM_PV_SCHED_FUNC_ID			\
+	ARM_SMCCC_CALL_VAL(ARM_SMCCC_FAST_CALL,				\
+			   ARM_SMCCC_SMC_64,				\
+			   ARM_SMCCC_OWNER_VENDOR_HYP,			\
+			   ARM_SMCCC_KVM_FUNC_PV_SCHED)
+
+#define KVM_PV_SCHED_IPA_INIT			0
+#define KVM_PV_SCHED_IPA_RELEASE		1
+
 /* Paravirtualised time calls (defined by ARM DEN0057A) */
 #define ARM_SMCCC_HV_PV_TIME_FEATURES				\
 	ARM_SMCCC_CALL_VAL(ARM_SMCCC_FAST_CALL,			\
@@ -38,6 +38,7 @@ struct pr_ops;
 struct rq_qos;
 struct blk_queue_stats;
 struct blk_stat_callback;
+struct blk_mq_poll_hybrid;
 struct blk_crypto_profile;
 
 extern const struct device_type disk_type;
@@ -461,6 +462,10 @@ struct request_queue {
 
 	unsigned int		rq_timeout;
 
+	/* hybrid polling: BLK_MQ_POLL_CLASSIC, 0 for adaptive or a fixed delay */
+	int			poll_nsec;
+	struct blk_mq_poll_hybrid *poll_hybrid;
+
 	struct timer_list	timeout;
 	struct work_struct	timeout_work;
 
@@ -553,6 +558,7 @@ struct request_queue {
 #define QUEUE_FLAG_FUA		18	/* device supports FUA writes */
 #define QUEUE_FLAG_DAX		19	/* device supports DAX */
 #define QUEUE_FLAG_STATS	20	/* track IO start and completion times */
+#define QUEUE_FLAG_POLL_STATS	21	/* collecting stats for hybrid polling */
 #define QUEUE_FLAG_REGISTERED	22	/* queue has been registered to a disk */
 #define QUEUE_FLAG_QUIESCED	24	/* queue has been quiesced */
 #define QUEUE_FLAG_PCI_P2PDMA	25	/* device supports PCI p2p requests */
@@ -40,6 +40,11 @@ struct dma_buf_ops {
 	  * If true the framework will cache the first mapping made for each
 	  * attachment. This avoids creating mappings for attachments multiple
 	  * times.
+	  *
+	  * The cached mapping is kept after the importer unmapped it, so a
+	  * buffer cycled through map and unmap every frame does not have its
+	  * IOMMU page tables rebuilt each time. It is only released on detach,
+	  * or by a shrinker while no importer has it mapped.
 	  */
 	bool cache_sgt_mapping;
 
@@ -490,6 +495,8 @@ struct dma_buf_attach_ops {
  * @node: list of dma_buf_attachment, protected by dma_resv lock of the dmabuf.
  * @sgt: cached mapping.
  * @dir: direction of cached mapping.
+ * @map_count: number of dma_buf_map_attachment() calls holding @sgt.
+ * @lru: entry in the list of unused cached mappings the shrinker may release.
  * @peer2peer: true if the importer can handle peer resources without pages.
  * @priv: exporter specific attachment data.
  * @importer_ops: importer operations for this attachment, if provided
@@ -511,6 +518,8 @@ struct dma_buf_attachment {
 	struct list_head node;
 	struct sg_table *sgt;
 	enum dma_data_direction dir;
+	unsigned int map_count;
+	struct list_head lru;
 	bool peer2peer;
 	const struct dma_buf_attach_ops *importer_ops;
 	void *importer_priv;
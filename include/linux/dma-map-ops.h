@@ -50,6 +50,17 @@ struct dma_map_ops {
 	void (*unmap_page)(struct device *dev, dma_addr_t dma_handle,
 			size_t size, enum dma_data_direction dir,
 			unsigned long attrs);
+	/*
+	 * Optional batched variants of map_page and unmap_page, which only
+	 * need to do TLB maintenance once for all @nr mappings.  map_page_batch
+	 * reports failed entries as DMA_MAPPING_ERROR.
+	 */
+	void (*map_page_batch)(struct device *dev, struct page **pages,
+			dma_addr_t *dma_handles, unsigned int nr, size_t size,
+			enum dma_data_direction dir, unsigned long attrs);
+	void (*unmap_page_batch)(struct device *dev, dma_addr_t *dma_handles,
+			size_t *sizes, unsigned int nr,
+			enum dma_data_direction dir, unsigned long attrs);
 	/*
 	 * map_sg should return a negative error code on error. See
 	 * dma_map_sgtable() for a list of appropriate error codes
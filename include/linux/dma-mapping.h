@@ -75,6 +75,27 @@
 
 #define DMA_BIT_MASK(n)	(((n) == 64) ? ~0ULL : ((1ULL<<(n))-1))
 
+#define DMA_UNMAP_BATCH_SIZE	16
+
+/*
+ * Page mappings queued with dma_unmap_batch_add(), to be torn down together
+ * by dma_unmap_batch_flush().  Meant to live on the stack of a completion
+ * handler that releases many buffers at once.
+ */
+struct dma_unmap_batch {
+	struct device *dev;
+	enum dma_data_direction dir;
+	unsigned long attrs;
+	unsigned int nr;
+	dma_addr_t addr[DMA_UNMAP_BATCH_SIZE];
+	size_t size[DMA_UNMAP_BATCH_SIZE];
+};
+
+static inline void dma_unmap_batch_init(struct dma_unmap_batch *batch)
+{
+	batch->nr = 0;
+}
+
 #ifdef CONFIG_DMA_API_DEBUG
 void debug_dma_mapping_error(struct device *dev, dma_addr_t dma_addr);
 void debug_dma_map_single(struct device *dev, const void *addr,
@@ -105,6 +126,13 @@ dma_addr_t dma_map_page_attrs(struct device *dev, struct page *page,
 		unsigned long attrs);
 void dma_unmap_page_attrs(struct device *dev, dma_addr_t addr, size_t size,
 		enum dma_data_direction dir, unsigned long attrs);
+unsigned int dma_map_page_batch(struct device *dev, struct page **pages,
+		dma_addr_t *addrs, unsigned int nr, size_t size,
+		enum dma_data_direction dir, unsigned long attrs);
+void dma_unmap_batch_add(struct dma_unmap_batch *batch, struct device *dev,
+		dma_addr_t addr, size_t size, enum dma_data_direction dir,
+		unsigned long attrs);
+void dma_unmap_batch_flush(struct dma_unmap_batch *batch);
 unsigned int dma_map_sg_attrs(struct device *dev, struct scatterlist *sg,
 		int nents, enum dma_data_direction dir, unsigned long attrs);
 void dma_unmap_sg_attrs(struct device *dev, struct scatterlist *sg,
@@ -167,6 +195,24 @@ static inline void dma_unmap_page_attrs(struct device *dev, dma_addr_t addr,
 		size_t size, enum dma_data_direction dir, unsigned long attrs)
 {
 }
+static inline unsigned int dma_map_page_batch(struct device *dev,
+		struct page **pages, dma_addr_t *addrs, unsigned int nr,
+		size_t size, enum dma_data_direction dir, unsigned long attrs)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		addrs[i] = DMA_MAPPING_ERROR;
+	return 0;
+}
+static inline void dma_unmap_batch_add(struct dma_unmap_batch *batch,
+		struct device *dev, dma_addr_t addr, size_t size,
+		enum dma_data_direction dir, unsigned long attrs)
+{
+}
+static inline void dma_unmap_batch_flush(struct dma_unmap_batch *batch)
+{
+}
 static inline unsigned int dma_map_sg_attrs(struct device *dev,
 		struct scatterlist *sg, int nents, enum dma_data_direction dir,
 		unsigned long attrs)
@@ -74,10 +74,21 @@ static inline void futex_init_task(struct task_struct *tsk)
 void futex_exit_recursive(struct task_struct *tsk);
 void futex_exit_release(struct task_struct *tsk);
 void futex_exec_release(struct task_struct *tsk);
+void futex_mm_init(struct mm_struct *mm);
+void futex_mm_free(struct mm_struct *mm);
+int futex_hash_prctl(unsigned long arg2, unsigned long arg3,
+		     unsigned long arg4);
 
 long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	      u32 __user *uaddr2, u32 val2, u32 val3);
 #else
+static inline void futex_mm_init(struct mm_struct *mm) { }
+static inline void futex_mm_free(struct mm_struct *mm) { }
+static inline int futex_hash_prctl(unsigned long arg2, unsigned long arg3,
+				   unsigned long arg4)
+{
+	return -EINVAL;
+}
 static inline void futex_init_task(struct task_struct *tsk) { }
 static inline void futex_exit_recursive(struct task_struct *tsk) { }
 static inline void futex_exit_release(struct task_struct *tsk) { }
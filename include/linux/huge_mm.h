@@ -135,6 +135,7 @@ static inline bool file_thp_enabled(struct vm_area_struct *vma)
 
 bool hugepage_vma_check(struct vm_area_struct *vma, unsigned long vm_flags,
 			bool smaps, bool in_pf, bool enforce_sysfs);
+unsigned long thp_vma_anon_orders(struct vm_area_struct *vma);
 
 #define transparent_hugepage_use_zero_page()				\
 	(transparent_hugepage_flags &					\
@@ -285,6 +286,11 @@ static inline bool hugepage_vma_check(struct vm_area_struct *vma,
 	return false;
 }
 
+static inline unsigned long thp_vma_anon_orders(struct vm_area_struct *vma)
+{
+	return 0;
+}
+
 static inline void prep_transhuge_page(struct page *page) {}
 
 #define transparent_hugepage_flags 0UL
@@ -143,6 +143,7 @@ struct file_system_type;
 
 /* Defined in init/main.c */
 extern int do_one_initcall(initcall_t fn);
+extern int initcall_schedule_async(initcall_t fn);
 extern char __initdata boot_command_line[];
 extern char *saved_command_line;
 extern unsigned int saved_command_line_len;
@@ -296,6 +297,25 @@ extern bool initcall_debug;
 #define late_initcall(fn)		__define_initcall(fn, 7)
 #define late_initcall_sync(fn)		__define_initcall(fn, 7s)
 
+/*
+ * An async initcall is run from an async worker, concurrently with the
+ * remaining initcalls of its level.  It may therefore only rely on what
+ * earlier levels have set up, and nothing else in its own level, _sync
+ * initcalls included, may rely on it.  All async initcalls of a level
+ * have completed before the next level starts.
+ */
+#define __define_async_initcall(fn, id)				\
+	static int __init __async_initcall_##fn(void)		\
+	{							\
+		return initcall_schedule_async(fn);		\
+	}							\
+	__define_initcall(__async_initcall_##fn, id)
+
+#define subsys_initcall_async(fn)	__define_async_initcall(fn, 4)
+#define fs_initcall_async(fn)		__define_async_initcall(fn, 5)
+#define device_initcall_async(fn)	__define_async_initcall(fn, 6)
+#define late_initcall_async(fn)		__define_async_initcall(fn, 7)
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn)						\
@@ -257,6 +257,12 @@ struct io_ring_ctx {
 		struct list_head	cq_overflow_list;
 		struct io_alloc_cache	apoll_cache;
 		struct io_alloc_cache	netmsg_cache;
+
+		/* armed futex and waitid requests, for cancelation */
+		struct hlist_head	futex_list;
+		struct hlist_head	waitid_list;
+		/* uring_cmds marked with io_uring_cmd_mark_cancelable() */
+		struct hlist_head	cancelable_uring_cmd;
 	} ____cacheline_aligned_in_smp;
 
 	/* IRQ completion list, under ->completion_lock */
@@ -268,6 +274,17 @@ struct io_ring_ctx {
 
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
+	/*
+	 * SQPOLL share and idle tracking, updated by the sq thread only.
+	 * sq_idle is how long to keep spinning after a submission, based on
+	 * the average gap between submissions.
+	 */
+	unsigned		sq_weight;
+	unsigned		sq_credit;
+	unsigned long		sq_idle;
+	u64			sq_last_submit_ns;
+	u64			sq_avg_gap_ns;
+	u64			sq_submitted;
 
 	unsigned long		check_cq;
 
@@ -338,6 +355,12 @@ struct io_ring_ctx {
 
 	struct list_head		io_buffers_pages;
 
+	/* registered wait arguments, see IORING_MEM_REGION_REG_WAIT_ARG */
+	void				*cq_wait_arg;
+	size_t				cq_wait_size;
+	struct page			**cq_wait_pages;
+	unsigned			cq_wait_nr_pages;
+
 	#if defined(CONFIG_UNIX)
 		struct socket		*ring_sock;
 	#endif
@@ -15,6 +15,9 @@
 #define DMA_MAP_TO_DEVICE       1
 #define DMA_MAP_FROM_DEVICE     2
 
+#define DMA_MAP_SINGLE_MODE     0 /* one dma_map_single() of granule pages */
+#define DMA_MAP_SG_MODE         1 /* dma_map_sg() of granule 1-page entries */
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -27,5 +30,7 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;  /* how many PAGE_SIZE will do map/unmap once a time */
+	__u32 map_mode; /* DMA_MAP_SINGLE_MODE or DMA_MAP_SG_MODE */
+	__u64 loops; /* map/unmap pairs completed by all threads */
 };
 #endif /* _KERNEL_DMA_BENCHMARK_H */
@@ -83,6 +83,30 @@ enum mem_cgroup_events_target {
 struct memcg_vmstats_percpu;
 struct memcg_vmstats;
 
+#ifdef CONFIG_LRU_GEN
+/* the most bins memory.workingset.page_age_intervals can set up */
+#define MAX_NR_WSR_BINS		8
+
+/*
+ * Working set reporting: a histogram of the pages of a memcg subtree by the
+ * age of the MGLRU generation they sit in, see memory.workingset.page_age.
+ */
+struct lru_gen_wsr {
+	/* protects intervals and nr_intervals */
+	struct mutex lock;
+	/* ascending upper bounds of the histogram bins in jiffies */
+	unsigned long intervals[MAX_NR_WSR_BINS];
+	unsigned int nr_intervals;
+	/* age on read if the youngest generation is older than this */
+	unsigned long refresh_interval;
+	/* the minimum time between two notifications, 0 to disable */
+	unsigned long report_threshold;
+	/* when memory.workingset.page_age was last notified */
+	unsigned long last_report;
+	struct cgroup_file page_age_file;
+};
+#endif
+
 struct mem_cgroup_reclaim_iter {
 	struct mem_cgroup *position;
 	/* scan generation, increased every round-trip */
@@ -324,6 +348,8 @@ struct mem_cgroup {
 #ifdef CONFIG_LRU_GEN
 	/* per-memcg mm_struct list */
 	struct lru_gen_mm_list mm_list;
+	/* working set reporting */
+	struct lru_gen_wsr wsr;
 #endif
 
 	struct mem_cgroup_per_node *nodeinfo[];
@@ -30,6 +30,25 @@ int apple_smc_write_atomic(struct apple_smc *smc, smc_key key, void *buf, size_t
 int apple_smc_rw(struct apple_smc *smc, smc_key key, void *wbuf, size_t wsize,
 		 void *rbuf, size_t rsize);
 
+/**
+ * struct apple_smc_read_req - a single key read for apple_smc_read_multi()
+ * @key: key to read
+ * @buf: buffer for the value
+ * @size: size of @buf
+ * @ret: number of bytes read or a negative error code
+ */
+struct apple_smc_read_req {
+	smc_key key;
+	void *buf;
+	size_t size;
+	int ret;
+};
+
+int apple_smc_read_cached(struct apple_smc *smc, smc_key key, void *buf,
+			  size_t size, unsigned int max_age_ms);
+int apple_smc_read_multi(struct apple_smc *smc, struct apple_smc_read_req *reqs,
+			 unsigned int count, unsigned int max_age_ms);
+
 int apple_smc_get_key_count(struct apple_smc *smc);
 int apple_smc_find_first_key_index(struct apple_smc *smc, smc_key key);
 int apple_smc_get_key_by_index(struct apple_smc *smc, int index, smc_key *key);
@@ -80,6 +99,7 @@ static inline int apple_smc_read_flag(struct apple_smc *smc, smc_key key)
 }
 #define apple_smc_write_flag apple_smc_write_u8
 
+int apple_smc_f32_to_scaled(u32 fval, int scale);
 int apple_smc_read_f32_scaled(struct apple_smc *smc, smc_key key, int *p, int scale);
 
 int apple_smc_register_notifier(struct apple_smc *smc, struct notifier_block *n);
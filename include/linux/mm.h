@@ -757,6 +757,19 @@ static inline void vma_mark_detached(struct vm_area_struct *vma,
 
 #endif /* CONFIG_PER_VMA_LOCK */
 
+/*
+ * Drop the lock a fault is being handled under, be it the per-VMA lock or
+ * mmap_lock. Used by fault handlers that wait for I/O or for a folio lock
+ * and then return VM_FAULT_RETRY or VM_FAULT_COMPLETED.
+ */
+static inline void release_fault_lock(struct vm_fault *vmf)
+{
+	if (vmf->flags & FAULT_FLAG_VMA_LOCK)
+		vma_end_read(vmf->vma);
+	else
+		mmap_read_unlock(vmf->vma->vm_mm);
+}
+
 /*
  * WARNING: vma_init does not initialize vma->vm_lock.
  * Use vm_area_alloc()/vm_area_free() if vma needs locking.
@@ -123,6 +123,10 @@ extern void cleanup_module(void);
 #define device_initcall_sync(fn)	module_init(fn)
 #define late_initcall(fn)		module_init(fn)
 #define late_initcall_sync(fn)		module_init(fn)
+#define subsys_initcall_async(fn)	module_init(fn)
+#define fs_initcall_async(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
+#define late_initcall_async(fn)		module_init(fn)
 
 #define console_initcall(fn)		module_init(fn)
 
@@ -37,6 +37,7 @@
 #include <linux/kcsan.h>
 #include <linux/rv.h>
 #include <linux/livepatch_sched.h>
+#include <linux/sched/ext.h>
 #include <asm/kmap_size.h>
 
 /* task_struct member predeclarations (sorted alphabetically): */
@@ -560,6 +561,9 @@ struct sched_entity {
 
 	u64				nr_migrations;
 
+	/* latency nice scaled to [-1024, 973], negative is latency sensitive */
+	int				latency_weight;
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	int				depth;
 	struct sched_entity		*parent;
@@ -642,11 +646,19 @@ struct sched_dl_entity {
 	 *
 	 * @dl_overrun tells if the task asked to be informed about runtime
 	 * overruns.
+	 *
+	 * @dl_server tells if this is not a task but a server entity
+	 * running another class' tasks out of its reservation; while
+	 * @dl_server_active, @dl_defer_armed tells if dl_timer is set to
+	 * the zero-laxity point at which the server starts competing.
 	 */
 	unsigned int			dl_throttled      : 1;
 	unsigned int			dl_yielded        : 1;
 	unsigned int			dl_non_contending : 1;
 	unsigned int			dl_overrun	  : 1;
+	unsigned int			dl_server         : 1;
+	unsigned int			dl_server_active  : 1;
+	unsigned int			dl_defer_armed    : 1;
 
 	/*
 	 * Bandwidth enforcement timer. Each -deadline task has its
@@ -663,6 +675,14 @@ struct sched_dl_entity {
 	 */
 	struct hrtimer inactive_timer;
 
+	/*
+	 * Server entities only: the runqueue they belong to and the hooks
+	 * into the class whose tasks they run.
+	 */
+	struct rq			*rq;
+	bool				(*server_has_tasks)(struct sched_dl_entity *dl_se);
+	struct task_struct		*(*server_pick)(struct sched_dl_entity *dl_se);
+
 #ifdef CONFIG_RT_MUTEXES
 	/*
 	 * Priority Inheritance. When a DEADLINE scheduling entity is boosted
@@ -786,10 +806,14 @@ struct task_struct {
 	int				static_prio;
 	int				normal_prio;
 	unsigned int			rt_priority;
+	int				latency_prio;
 
 	struct sched_entity		se;
 	struct sched_rt_entity		rt;
 	struct sched_dl_entity		dl;
+#ifdef CONFIG_SCHED_CLASS_EXT
+	struct sched_ext_entity		scx;
+#endif
 	const struct sched_class	*sched_class;
 
 #ifdef CONFIG_SCHED_CORE
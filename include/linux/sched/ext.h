@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * BPF extensible scheduler class: see kernel/sched/ext.c.
+ */
+#ifndef _LINUX_SCHED_EXT_H
+#define _LINUX_SCHED_EXT_H
+
+#ifdef CONFIG_SCHED_CLASS_EXT
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+struct task_struct;
+struct scx_dispatch_q;
+
+#define SCX_OPS_NAME_LEN	128
+#define SCX_SLICE_DFL		(20 * NSEC_PER_MSEC)
+
+/*
+ * Dispatch queue ids. User queues created with scx_bpf_create_dsq() use ids
+ * without SCX_DSQ_FLAG_BUILTIN. SCX_DSQ_LOCAL_ON | cpu targets the local
+ * queue of a specific CPU.
+ */
+enum scx_dsq_id_flags {
+	SCX_DSQ_FLAG_BUILTIN	= 1LLU << 63,
+	SCX_DSQ_FLAG_LOCAL_ON	= 1LLU << 62,
+
+	SCX_DSQ_GLOBAL		= SCX_DSQ_FLAG_BUILTIN | 1,
+	SCX_DSQ_LOCAL		= SCX_DSQ_FLAG_BUILTIN | 2,
+	SCX_DSQ_LOCAL_ON	= SCX_DSQ_FLAG_BUILTIN | SCX_DSQ_FLAG_LOCAL_ON,
+	SCX_DSQ_LOCAL_CPU_MASK	= 0xffffffffLLU,
+};
+
+/* @enq_flags for ops.enqueue() and scx_bpf_dispatch() */
+enum scx_enq_flags {
+	SCX_ENQ_WAKEUP		= 1LLU << 0,
+	/* queue at the head instead of the tail */
+	SCX_ENQ_HEAD		= 1LLU << 32,
+	/* preempt the current task when queueing on the local DSQ */
+	SCX_ENQ_PREEMPT		= 1LLU << 33,
+};
+
+/* argument to ops.exit(), also reported when the scheduler is unloaded */
+enum scx_exit_kind {
+	SCX_EXIT_NONE,
+	SCX_EXIT_UNREG,		/* the struct_ops map was detached */
+	SCX_EXIT_ERROR,		/* the BPF scheduler misbehaved */
+	SCX_EXIT_ERROR_BPF,	/* scx_bpf_error() */
+	SCX_EXIT_ERROR_STALL,	/* a runnable task was starved */
+};
+
+/* sched_ext_entity->flags */
+enum scx_ent_flags {
+	SCX_TASK_QUEUED		= 1 << 0, /* on the ext runqueue */
+	SCX_TASK_CONSUMED	= 1 << 1, /* moved here from a shared DSQ */
+};
+
+/**
+ * struct sched_ext_ops - BPF scheduler callbacks
+ *
+ * All callbacks are optional. Without @enqueue tasks go to the global DSQ,
+ * which every CPU consumes in FIFO order; without @select_cpu a wakeup picks
+ * an idle allowed CPU, preferring @prev_cpu.
+ */
+struct sched_ext_ops {
+	/*
+	 * Pick the CPU @p should be woken up on. The result is only a hint,
+	 * it must be in @p->cpus_ptr or the scheduler is disabled.
+	 */
+	s32 (*select_cpu)(struct task_struct *p, s32 prev_cpu, u64 wake_flags);
+
+	/*
+	 * @p became runnable or used up its slice. Dispatch it with
+	 * scx_bpf_dispatch(), otherwise it goes to the global DSQ.
+	 */
+	void (*enqueue)(struct task_struct *p, u64 enq_flags);
+
+	/*
+	 * @cpu ran out of local tasks. Use scx_bpf_consume() to move a task
+	 * from a shared DSQ to its local one. @prev is the ext task that was
+	 * running before, if any.
+	 */
+	void (*dispatch)(s32 cpu, struct task_struct *prev);
+
+	/* called before any task is switched to the ext class */
+	s32 (*init)(void);
+
+	/* called after every task has been switched back to CFS */
+	void (*exit)(u32 kind);
+
+	/* a runnable task not running for this long disables the scheduler */
+	u32 timeout_ms;
+
+	char name[SCX_OPS_NAME_LEN];
+};
+
+struct sched_ext_entity {
+	struct scx_dispatch_q	*dsq;
+	struct list_head	dsq_node;
+	struct list_head	runnable_node;
+	unsigned long		runnable_at;
+	u64			slice;
+	s32			dsq_cpu;	/* SCX_DSQ_LOCAL_ON target or -1 */
+	u32			flags;
+};
+
+#endif /* CONFIG_SCHED_CLASS_EXT */
+#endif /* _LINUX_SCHED_EXT_H */
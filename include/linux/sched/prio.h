@@ -26,6 +26,18 @@
 #define NICE_TO_PRIO(nice)	((nice) + DEFAULT_PRIO)
 #define PRIO_TO_NICE(prio)	((prio) - DEFAULT_PRIO)
 
+/*
+ * Latency nice [ -20 ... 0 ... 19 ] tells CFS how much scheduling latency a
+ * task tolerates, and maps to latency_prio [ 0 .. LATENCY_NICE_WIDTH-1 ].
+ */
+#define MAX_LATENCY_NICE	19
+#define MIN_LATENCY_NICE	-20
+#define LATENCY_NICE_WIDTH	(MAX_LATENCY_NICE - MIN_LATENCY_NICE + 1)
+#define DEFAULT_LATENCY_PRIO	(LATENCY_NICE_WIDTH / 2)
+
+#define NICE_TO_LATENCY(nice)	((nice) + DEFAULT_LATENCY_PRIO)
+#define LATENCY_TO_NICE(prio)	((prio) - DEFAULT_LATENCY_PRIO)
+
 /*
  * Convert nice value [19,-20] to rlimit style value [1,40].
  */
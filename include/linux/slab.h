@@ -471,6 +471,16 @@ void kmem_cache_free(struct kmem_cache *s, void *objp);
 void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p);
 int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size, void **p);
 
+#ifdef CONFIG_SLUB
+int kmem_cache_setup_percpu_array(struct kmem_cache *s, unsigned int count);
+#else
+static inline int kmem_cache_setup_percpu_array(struct kmem_cache *s,
+						unsigned int count)
+{
+	return 0;
+}
+#endif
+
 static __always_inline void kfree_bulk(size_t size, void **p)
 {
 	kmem_cache_free_bulk(NULL, size, p);
@@ -39,6 +39,10 @@ enum stat_item {
 	CPU_PARTIAL_FREE,	/* Refill cpu partial on free */
 	CPU_PARTIAL_NODE,	/* Refill cpu partial from node partial */
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
+	ALLOC_PCA,		/* Allocation from the per cpu array */
+	FREE_PCA,		/* Free to the per cpu array */
+	PCA_REFILL,		/* Per cpu array refilled from slabs */
+	PCA_FLUSH,		/* Per cpu array batch flushed to slabs */
 	NR_SLUB_STAT_ITEMS };
 
 #ifndef CONFIG_SLUB_TINY
@@ -92,6 +96,7 @@ struct kmem_cache_order_objects {
 struct kmem_cache {
 #ifndef CONFIG_SLUB_TINY
 	struct kmem_cache_cpu __percpu *cpu_slab;
+	struct slub_percpu_array __percpu *cpu_array;
 #endif
 	/* Used for retrieving partial slabs, etc. */
 	slab_flags_t flags;
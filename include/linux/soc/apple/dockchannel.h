@@ -21,6 +21,11 @@ int dockchannel_recv(struct dockchannel *dockchannel, void *buf, size_t count);
 int dockchannel_await(struct dockchannel *dockchannel,
 		      void (*callback)(void *cookie, size_t avail),
 		      void *cookie, size_t count);
+int dockchannel_rx_ring_start(struct dockchannel *dockchannel, size_t ring_size,
+			      void (*callback)(void *cookie, size_t avail),
+			      void *cookie);
+size_t dockchannel_rx_ring_read(struct dockchannel *dockchannel, void *buf,
+				size_t count);
 
 #endif
 #endif
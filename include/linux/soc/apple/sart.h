@@ -18,6 +18,11 @@
 
 struct apple_sart;
 
+struct apple_sart_region {
+	phys_addr_t paddr;
+	size_t size;
+};
+
 /*
  * Get a reference to the SART attached to dev.
  *
@@ -50,4 +55,32 @@ int apple_sart_add_allowed_region(struct apple_sart *sart, phys_addr_t paddr,
 int apple_sart_remove_allowed_region(struct apple_sart *sart, phys_addr_t paddr,
 				     size_t size);
 
+/*
+ * Adds several regions to the DMA allow list at once.
+ *
+ * Either all regions are added or, if any of them is invalid or there are
+ * not enough free entries left, none of them are.
+ *
+ * @sart: SART reference
+ * @regions: Regions to be used for DMA
+ * @count: Number of entries in @regions
+ */
+int apple_sart_add_allowed_regions(struct apple_sart *sart,
+				   const struct apple_sart_region *regions,
+				   unsigned int count);
+
+/*
+ * Removes several regions from the DMA allow list at once.
+ *
+ * The same rules as for apple_sart_remove_allowed_region apply to each
+ * region. All regions that are found are removed even if some are not.
+ *
+ * @sart: SART reference
+ * @regions: Regions no longer used for DMA
+ * @count: Number of entries in @regions
+ */
+int apple_sart_remove_allowed_regions(struct apple_sart *sart,
+				      const struct apple_sart_region *regions,
+				      unsigned int count);
+
 #endif /* _LINUX_SOC_APPLE_SART_H_ */
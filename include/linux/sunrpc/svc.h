@@ -65,6 +65,7 @@ struct svc_serv {
 	spinlock_t		sv_lock;
 	struct kref		sv_refcnt;
 	unsigned int		sv_nrthreads;	/* # of server threads */
+	unsigned int		sv_nrdynamic;	/* # of them started on demand */
 	unsigned int		sv_maxconn;	/* max connections allowed or
 						 * '0' causing max to be based
 						 * on number of threads. */
@@ -243,6 +244,7 @@ struct svc_rqst {
 #define	RQ_VICTIM	(5)			/* about to be shut down */
 #define	RQ_BUSY		(6)			/* request is busy */
 #define	RQ_DATA		(7)			/* request has data */
+#define	RQ_DYNAMIC	(8)			/* started on demand */
 	unsigned long		rq_flags;	/* flags field */
 	ktime_t			rq_qtime;	/* enqueue time */
 
@@ -419,6 +421,8 @@ void		   svc_exit_thread(struct svc_rqst *);
 struct svc_serv *  svc_create_pooled(struct svc_program *, unsigned int,
 				     int (*threadfn)(void *data));
 int		   svc_set_num_threads(struct svc_serv *, struct svc_pool *, int);
+int		   svc_start_dynamic_thread(struct svc_serv *, struct svc_pool *);
+bool		   svc_thread_try_retire(struct svc_rqst *);
 int		   svc_pool_stats_open(struct svc_serv *serv, struct file *file);
 void		   svc_process(struct svc_rqst *rqstp);
 int		   bc_svc_process(struct svc_serv *, struct rpc_rqst *,
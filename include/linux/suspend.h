@@ -313,6 +313,9 @@ extern bool pm_suspend_default_s2idle(void);
 extern void __init pm_states_init(void);
 extern void s2idle_set_ops(const struct platform_s2idle_ops *ops);
 extern void s2idle_wake(void);
+extern int s2idle_register_dark_wake(unsigned int irq,
+				     bool (*handler)(void *data), void *data);
+extern void s2idle_unregister_dark_wake(unsigned int irq, void *data);
 
 /**
  * arch_suspend_disable_irqs - disable IRQs for suspend
@@ -352,6 +355,13 @@ static inline bool idle_should_enter_s2idle(void) { return false; }
 static inline void __init pm_states_init(void) {}
 static inline void s2idle_set_ops(const struct platform_s2idle_ops *ops) {}
 static inline void s2idle_wake(void) {}
+static inline int s2idle_register_dark_wake(unsigned int irq,
+					    bool (*handler)(void *data),
+					    void *data)
+{
+	return 0;
+}
+static inline void s2idle_unregister_dark_wake(unsigned int irq, void *data) {}
 #endif /* !CONFIG_SUSPEND */
 
 /* struct pbe is used for creating lists of pages that should be restored
@@ -506,6 +516,7 @@ extern bool events_check_enabled;
 extern suspend_state_t pm_suspend_target_state;
 
 extern bool pm_wakeup_pending(void);
+extern bool pm_wakeup_events_pending(void);
 extern void pm_system_wakeup(void);
 extern void pm_system_cancel_wakeup(void);
 extern void pm_wakeup_clear(unsigned int irq_number);
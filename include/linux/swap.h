@@ -261,14 +261,22 @@ struct swap_cluster_info {
 #define CLUSTER_FLAG_NEXT_NULL 2 /* This cluster has no next cluster */
 #define CLUSTER_FLAG_HUGE 4 /* This cluster is backing a transparent huge page */
 
+#ifdef CONFIG_THP_SWAP
+/* PMD sized entries take a whole cluster and are not served per cpu */
+#define SWAP_NR_ORDERS		(PMD_SHIFT - PAGE_SHIFT)
+#else
+#define SWAP_NR_ORDERS		1
+#endif
+
+#define SWAP_NEXT_INVALID	0
+
 /*
- * We assign a cluster to each CPU, so each CPU can allocate swap entry from
- * its own cluster and swapout sequentially. The purpose is to optimize swapout
- * throughput.
+ * We assign a cluster to each CPU and allocation order, so each CPU can
+ * allocate naturally aligned runs of swap entries from its own cluster and
+ * swapout sequentially. The purpose is to optimize swapout throughput.
  */
 struct percpu_cluster {
-	struct swap_cluster_info index; /* Current cluster index */
-	unsigned int next; /* Likely next allocation offset */
+	unsigned int next[SWAP_NR_ORDERS]; /* Likely next allocation offset */
 };
 
 struct swap_cluster_list {
@@ -433,7 +441,8 @@ extern unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 extern unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 						  unsigned long nr_pages,
 						  gfp_t gfp_mask,
-						  unsigned int reclaim_options);
+						  unsigned int reclaim_options,
+						  unsigned long min_age);
 extern unsigned long mem_cgroup_shrink_node(struct mem_cgroup *mem,
 						gfp_t gfp_mask, bool noswap,
 						pg_data_t *pgdat,
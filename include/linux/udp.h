@@ -50,7 +50,8 @@ struct udp_sock {
 					   */
 			 gro_enabled:1,	/* Request GRO aggregation */
 			 accept_udp_l4:1,
-			 accept_udp_fraglist:1;
+			 accept_udp_fraglist:1,
+			 gro_list:1;	/* Request datagram list GRO */
 	/*
 	 * Following member retains the information to create a UDP header
 	 * when the socket is uncorked.
@@ -119,11 +120,38 @@ static inline bool udp_get_no_check6_rx(struct sock *sk)
 	return udp_sk(sk)->no_check6_rx;
 }
 
+/* The payload of a datagram list is the head datagram followed by the
+ * frag_list ones, report the size of each.
+ */
+static inline void udp_cmsg_recv_list(struct msghdr *msg, struct sk_buff *skb)
+{
+	u16 lens[UDP_MAX_SEGMENTS];
+	unsigned int head = skb->len;
+	struct sk_buff *frag;
+	int n = 1;
+
+	skb_walk_frags(skb, frag) {
+		if (n == UDP_MAX_SEGMENTS)
+			break;
+		lens[n++] = frag->len;
+		head -= frag->len;
+	}
+	lens[0] = head;
+
+	put_cmsg(msg, SOL_UDP, UDP_GRO_LIST, n * sizeof(lens[0]), lens);
+}
+
 static inline void udp_cmsg_recv(struct msghdr *msg, struct sock *sk,
 				 struct sk_buff *skb)
 {
 	int gso_size;
 
+	if (skb_shinfo(skb)->gso_type & SKB_GSO_FRAGLIST &&
+	    udp_sk(sk)->gro_list) {
+		udp_cmsg_recv_list(msg, skb);
+		return;
+	}
+
 	if (skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4) {
 		gso_size = skb_shinfo(skb)->gso_size;
 		put_cmsg(msg, SOL_UDP, UDP_GRO, sizeof(gso_size), &gso_size);
@@ -125,6 +125,18 @@ struct rcu_work {
 	struct workqueue_struct *wq;
 };
 
+/* CPUs of an unbound workqueue's pwq, see workqueue_attrs->affn_scope */
+enum wq_affn_scope {
+	WQ_AFFN_DFL,		/* use system default */
+	WQ_AFFN_CPU,		/* one pod per CPU */
+	WQ_AFFN_SMT,		/* one pod per SMT core */
+	WQ_AFFN_CACHE,		/* one pod per LLC */
+	WQ_AFFN_NUMA,		/* one pod per NUMA node */
+	WQ_AFFN_SYSTEM,		/* one pod across the whole system */
+
+	WQ_AFFN_NR_TYPES,
+};
+
 /**
  * struct workqueue_attrs - A struct for workqueue attributes.
  *
@@ -149,6 +161,13 @@ struct workqueue_attrs {
 	 * doesn't participate in pool hash calculations or equality comparisons.
 	 */
 	bool no_numa;
+
+	/**
+	 * @affn_scope: CPUs sharing a pool while affinity is enabled
+	 *
+	 * Like ``no_numa``, not a property of a worker_pool.
+	 */
+	enum wq_affn_scope affn_scope;
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
@@ -714,5 +733,6 @@ int workqueue_offline_cpu(unsigned int cpu);
 
 void __init workqueue_init_early(void);
 void __init workqueue_init(void);
+void __init workqueue_init_topology(void);
 
 #endif
@@ -183,6 +183,7 @@ enum {
 	NLA_REJECT,
 	NLA_BE16,
 	NLA_BE32,
+	NLA_UINT,
 	__NLA_TYPE_MAX,
 };
 
@@ -237,6 +238,7 @@ enum nla_policy_validation {
  *    NLA_MSECS            Leaving the length field zero will verify the
  *                         given type fits, using it verifies minimum length
  *                         just like "All other"
+ *    NLA_UINT             Unused, the payload is either a u32 or a u64
  *    NLA_BITFIELD32       Unused
  *    NLA_REJECT           Unused
  *    All other            Minimum length of attribute payload
@@ -264,6 +266,7 @@ enum nla_policy_validation {
  *    NLA_U16,
  *    NLA_U32,
  *    NLA_U64,
+ *    NLA_UINT,
  *    NLA_BE16,
  *    NLA_BE32,
  *    NLA_S8,
@@ -283,7 +286,8 @@ enum nla_policy_validation {
  *    NLA_U8,
  *    NLA_U16,
  *    NLA_U32,
- *    NLA_U64              If the validation_type field instead is set to
+ *    NLA_U64,
+ *    NLA_UINT             If the validation_type field instead is set to
  *                         NLA_VALIDATE_RANGE_PTR, `range' must be a pointer
  *                         to a struct netlink_range_validation that indicates
  *                         the min/max values.
@@ -376,7 +380,8 @@ struct nla_policy {
 	{ .type = NLA_BITFIELD32, .bitfield32_valid = valid }
 
 #define __NLA_IS_UINT_TYPE(tp)						\
-	(tp == NLA_U8 || tp == NLA_U16 || tp == NLA_U32 || tp == NLA_U64)
+	(tp == NLA_U8 || tp == NLA_U16 || tp == NLA_U32 ||		\
+	 tp == NLA_U64 || tp == NLA_UINT)
 #define __NLA_IS_SINT_TYPE(tp)						\
 	(tp == NLA_S8 || tp == NLA_S16 || tp == NLA_S32 || tp == NLA_S64)
 #define __NLA_IS_BEINT_TYPE(tp)						\
@@ -1415,6 +1420,24 @@ static inline int nla_put_u64_64bit(struct sk_buff *skb, int attrtype,
 	return nla_put_64bit(skb, attrtype, sizeof(u64), &tmp, padattr);
 }
 
+/**
+ * nla_put_uint - Add a variable-size unsigned int to a socket buffer
+ * @skb: socket buffer to add attribute to
+ * @attrtype: attribute type
+ * @value: numeric value
+ *
+ * The value is sent as a u32 when it fits, as an unaligned u64 otherwise.
+ */
+static inline int nla_put_uint(struct sk_buff *skb, int attrtype, u64 value)
+{
+	u64 tmp64 = value;
+	u32 tmp32 = value;
+
+	if (tmp64 == tmp32)
+		return nla_put_u32(skb, attrtype, tmp32);
+	return nla_put(skb, attrtype, sizeof(u64), &tmp64);
+}
+
 /**
  * nla_put_be64 - Add a __be64 netlink attribute to a socket buffer and align it
  * @skb: socket buffer to add attribute to
@@ -1671,6 +1694,17 @@ static inline u64 nla_get_u64(const struct nlattr *nla)
 	return tmp;
 }
 
+/**
+ * nla_get_uint - return payload of uint attribute
+ * @nla: uint netlink attribute
+ */
+static inline u64 nla_get_uint(const struct nlattr *nla)
+{
+	if (nla_len(nla) == sizeof(u32))
+		return nla_get_u32(nla);
+	return nla_get_u64(nla);
+}
+
 /**
  * nla_get_be64 - return payload of __be64 attribute
  * @nla: __be64 netlink attribute
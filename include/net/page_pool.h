@@ -71,6 +71,19 @@ struct pp_alloc_cache {
 	struct page *cache[PP_ALLOC_CACHE_SIZE];
 };
 
+/*
+ * Pages freed outside of the NAPI context of the pool are gathered per CPU
+ * and moved to the ptr_ring in batches, so CPUs freeing into the same pool
+ * don't contend on the producer lock for every page. The lock is only
+ * taken remotely when the pool is torn down.
+ */
+#define PP_PCPU_CACHE_SIZE	16
+struct pp_pcpu_cache {
+	spinlock_t lock;
+	u32 count;
+	struct page *cache[PP_PCPU_CACHE_SIZE];
+};
+
 struct page_pool_params {
 	unsigned int	flags;
 	unsigned int	order;
@@ -83,6 +96,10 @@ struct page_pool_params {
 	unsigned int	offset;  /* DMA addr offset */
 	void (*init_callback)(struct page *page, void *arg);
 	void *init_arg;
+	/* netdev the pool feeds, reported over netlink. Defaults to the
+	 * device of @napi.
+	 */
+	struct net_device *netdev;
 };
 
 #ifdef CONFIG_PAGE_POOL_STATS
@@ -195,6 +212,9 @@ struct page_pool {
 	 */
 	struct ptr_ring ring;
 
+	/* batches remote frees into ring, see pp_pcpu_cache */
+	struct pp_pcpu_cache __percpu *pcpu_cache;
+
 #ifdef CONFIG_PAGE_POOL_STATS
 	/* recycle stats are per-cpu to avoid locking */
 	struct page_pool_recycle_stats __percpu *recycle_stats;
@@ -208,6 +228,12 @@ struct page_pool {
 	refcount_t user_cnt;
 
 	u64 destroy_cnt;
+
+	/* netlink visible state, for pools feeding a netdev */
+	struct {
+		u32 id;
+		struct net_device *netdev;
+	} user;
 };
 
 struct page *page_pool_alloc_pages(struct page_pool *pool, gfp_t gfp);
@@ -145,9 +145,14 @@ struct tls_sw_context_rx {
 	u8 async_capable:1;
 	u8 zc_capable:1;
 	u8 reader_contended:1;
+	u8 no_pad_viol;		/* padded records seen with rx_no_pad */
 
 	struct tls_strparser strp;
 
+	/* request memory reused by synchronous decryption */
+	void *decrypt_mem;
+	size_t decrypt_mem_size;
+
 	atomic_t decrypt_pending;
 	/* protect crypto_wait with decrypt_pending*/
 	spinlock_t decrypt_compl_lock;
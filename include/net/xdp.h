@@ -76,6 +76,9 @@ enum xdp_buff_flags {
 	XDP_FLAGS_FRAGS_PF_MEMALLOC	= BIT(1), /* xdp paged memory is under
 						   * pressure
 						   */
+	XDP_FLAGS_FRAGS_SKB		= BIT(2), /* frags belong to an skb,
+						   * generic XDP only
+						   */
 };
 
 struct xdp_buff {
@@ -114,6 +117,16 @@ static __always_inline void xdp_buff_set_frag_pfmemalloc(struct xdp_buff *xdp)
 	xdp->flags |= XDP_FLAGS_FRAGS_PF_MEMALLOC;
 }
 
+static __always_inline bool xdp_buff_is_frags_skb(struct xdp_buff *xdp)
+{
+	return !!(xdp->flags & XDP_FLAGS_FRAGS_SKB);
+}
+
+static __always_inline void xdp_buff_set_frags_skb(struct xdp_buff *xdp)
+{
+	xdp->flags |= XDP_FLAGS_FRAGS_SKB;
+}
+
 static __always_inline void
 xdp_init_buff(struct xdp_buff *xdp, u32 frame_sz, struct xdp_rxq_info *rxq)
 {
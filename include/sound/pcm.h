@@ -343,6 +343,28 @@ static inline void snd_pcm_pack_audio_tstamp_report(__u32 *data, __u32 *accuracy
 	*accuracy = report->accuracy;
 }
 
+/*
+ * Batched timestamps: a ring of (hw_ptr, system time) pairs, one per period
+ * interrupt, living in the otherwise unused tail of the status record page.
+ * User-space mapping the status record can read the history directly.
+ * The writer fills entries[head % nr_entries] and then publishes it by
+ * incrementing head; readers must re-check head after copying entries.
+ */
+struct snd_pcm_tstamp_entry {
+	u64 hw_ptr;		/* hw_ptr at the time of the interrupt */
+	s64 tstamp_sec;		/* system timestamp, tstamp_type clock */
+	s64 tstamp_nsec;
+};
+
+struct snd_pcm_tstamp_ring {
+	u32 head;		/* number of entries written so far */
+	u32 nr_entries;		/* capacity of entries[] */
+	u64 reserved;
+	struct snd_pcm_tstamp_entry entries[];
+};
+
+#define SNDRV_PCM_TSTAMP_RING_OFFSET \
+	ALIGN(sizeof(struct snd_pcm_mmap_status), 64)
 
 struct snd_pcm_runtime {
 	/* -- Status -- */
@@ -396,6 +418,7 @@ struct snd_pcm_runtime {
 	/* -- mmap -- */
 	struct snd_pcm_mmap_status *status;
 	struct snd_pcm_mmap_control *control;
+	struct snd_pcm_tstamp_ring *tstamp_ring; /* in the status page tail */
 
 	/* -- locking / scheduling -- */
 	snd_pcm_uframes_t twake; 	/* do transfer (!poll) wakeup if non-zero */
@@ -594,6 +594,46 @@ TRACE_EVENT_RCU(rcu_kvfree_callback,
 		  __entry->qlen)
 );
 
+/*
+ * Tracepoint for lazy callbacks held back by a CPU that is not offloaded.
+ * The first argument is the RCU type, the second is the CPU, the third
+ * is the number of lazy callbacks concerned, and the fourth is a string
+ * describing what happened to them:
+ *
+ *	"Queued": A lazy callback was queued, third argument is queue length.
+ *	"Hurry": A non-lazy callback flushed the lazy callbacks along with it.
+ *	"Timer": The lazy callbacks waited long enough and were flushed.
+ *	"Qlen": Too many lazy callbacks were queued, so they were flushed.
+ *	"Shrink": The lazy callbacks were flushed due to memory pressure.
+ *	"Barrier": rcu_barrier() flushed the lazy callbacks.
+ *	"Offline": The lazy callbacks of an offline CPU were flushed.
+ *	"Offload": The CPU is being offloaded, so the lazy callbacks were
+ *		flushed before the rcuo kthreads take over.
+ */
+TRACE_EVENT_RCU(rcu_lazy,
+
+	TP_PROTO(const char *rcuname, int cpu, long qlen, const char *reason),
+
+	TP_ARGS(rcuname, cpu, qlen, reason),
+
+	TP_STRUCT__entry(
+		__field(const char *, rcuname)
+		__field(int, cpu)
+		__field(long, qlen)
+		__field(const char *, reason)
+	),
+
+	TP_fast_assign(
+		__entry->rcuname = rcuname;
+		__entry->cpu = cpu;
+		__entry->qlen = qlen;
+		__entry->reason = reason;
+	),
+
+	TP_printk("%s %d %s %ld", __entry->rcuname, __entry->cpu,
+		  __entry->reason, __entry->qlen)
+);
+
 /*
  * Tracepoint for marking the beginning rcu_do_batch, performed to start
  * RCU callback invocation.  The first argument is the RCU flavor,
@@ -315,6 +315,7 @@ struct fuse_file_lock {
  * FOPEN_STREAM: the file is stream-like (no file position at all)
  * FOPEN_NOFLUSH: don't flush data cache on close (unless FUSE_WRITEBACK_CACHE)
  * FOPEN_PARALLEL_DIRECT_WRITES: Allow concurrent direct writes on the same inode
+ * FOPEN_PASSTHROUGH: read, write and mmap go to the backing file in backing_id
  */
 #define FOPEN_DIRECT_IO		(1 << 0)
 #define FOPEN_KEEP_CACHE	(1 << 1)
@@ -323,6 +324,7 @@ struct fuse_file_lock {
 #define FOPEN_STREAM		(1 << 4)
 #define FOPEN_NOFLUSH		(1 << 5)
 #define FOPEN_PARALLEL_DIRECT_WRITES	(1 << 6)
+#define FOPEN_PASSTHROUGH	(1 << 7)
 
 /**
  * INIT request/reply flags
@@ -371,6 +373,12 @@ struct fuse_file_lock {
  * FUSE_CREATE_SUPP_GROUP: add supplementary group info to create, mkdir,
  *			symlink and mknod (single group that matches parent)
  * FUSE_HAS_EXPIRE_ONLY: kernel supports expiry-only entry invalidation
+ * FUSE_PASSTHROUGH: passthrough read/write/mmap to a backing file, see
+ *		     FUSE_DEV_IOC_BACKING_OPEN
+ * FUSE_PERCPU_URING: requests may be fetched and replied to with io_uring
+ *		      commands on the fuse device, see fuse_percpu_uring_req.
+ *		      Local to this kernel and not the upstream
+ *		      FUSE_OVER_IO_URING protocol, so it uses a bit of its own.
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -409,6 +417,8 @@ struct fuse_file_lock {
 #define FUSE_HAS_INODE_DAX	(1ULL << 33)
 #define FUSE_CREATE_SUPP_GROUP	(1ULL << 34)
 #define FUSE_HAS_EXPIRE_ONLY	(1ULL << 35)
+#define FUSE_PASSTHROUGH	(1ULL << 37)
+#define FUSE_PERCPU_URING	(1ULL << 63)
 
 /**
  * CUSE INIT request/reply flags
@@ -701,7 +711,7 @@ struct fuse_create_in {
 struct fuse_open_out {
 	uint64_t	fh;
 	uint32_t	open_flags;
-	uint32_t	padding;
+	int32_t		backing_id;
 };
 
 struct fuse_release_in {
@@ -817,7 +827,8 @@ struct fuse_init_out {
 	uint16_t	max_pages;
 	uint16_t	map_alignment;
 	uint32_t	flags2;
-	uint32_t	unused[7];
+	uint32_t	max_stack_depth;
+	uint32_t	unused[6];
 };
 
 #define CUSE_INIT_INFO_MAX 4096
@@ -989,9 +1000,44 @@ struct fuse_notify_retrieve_in {
 	uint64_t	dummy4;
 };
 
+/* FUSE_DEV_IOC_BACKING_OPEN argument, the ioctl returns the backing_id */
+struct fuse_backing_map {
+	int32_t		fd;
+	uint32_t	flags;
+	uint64_t	padding;
+};
+
 /* Device ioctls: */
 #define FUSE_DEV_IOC_MAGIC		229
 #define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+#define FUSE_DEV_IOC_BACKING_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 1, \
+					     struct fuse_backing_map)
+#define FUSE_DEV_IOC_BACKING_CLOSE	_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
+
+/*
+ * IORING_OP_URING_CMD commands on the fuse device, cmd_op of the sqe.
+ *
+ * FUSE_URING_CMD_FETCH: park buf on the queue of CPU qid.  Once a request
+ * is queued on that CPU it is copied to buf in the format read(2) of the
+ * fuse device returns, and the command completes with its length.
+ *
+ * FUSE_URING_CMD_COMMIT_AND_FETCH: buf holds the reply to the request last
+ * fetched into it, in the format write(2) of the fuse device takes.  The
+ * reply is processed and buf is parked again as with FUSE_URING_CMD_FETCH.
+ */
+enum fuse_percpu_uring_cmd {
+	FUSE_URING_CMD_INVALID		= 0,
+	FUSE_URING_CMD_FETCH		= 1,
+	FUSE_URING_CMD_COMMIT_AND_FETCH	= 2,
+};
+
+/* in sqe->cmd of the FUSE_URING_CMD_* commands */
+struct fuse_percpu_uring_req {
+	uint64_t	buf;
+	uint32_t	buf_len;
+	uint16_t	qid;
+	uint16_t	flags;
+};
 
 struct fuse_lseek_in {
 	uint64_t	fh;
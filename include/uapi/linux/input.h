@@ -242,6 +242,17 @@ struct input_mask {
 
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
 
+/**
+ * EVIOCSCOALESCE - enable or disable coalescing of motion frames
+ *
+ * With a non-zero argument, a client whose queue is at least half full gets
+ * consecutive frames carrying only EV_ABS and MSC_TIMESTAMP updates folded
+ * into the last unread frame, per multitouch slot, instead of queueing each
+ * of them. The resulting state seen by the client is unchanged, only the
+ * intermediate positions are lost. Disabled by default.
+ */
+#define EVIOCSCOALESCE		_IOW('E', 0xa1, int)			/* Coalesce motion frames while lagging */
+
 /*
  * IDs.
  */
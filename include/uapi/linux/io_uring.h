@@ -65,6 +65,8 @@ struct io_uring_sqe {
 		__u32		xattr_flags;
 		__u32		msg_ring_flags;
 		__u32		uring_cmd_flags;
+		__u32		waitid_flags;
+		__u32		futex_flags;
 	};
 	__u64	user_data;	/* data to be passed back at completion time */
 	/* pack this to avoid bogus arm OABI complaints */
@@ -223,6 +225,10 @@ enum io_uring_op {
 	IORING_OP_URING_CMD,
 	IORING_OP_SEND_ZC,
 	IORING_OP_SENDMSG_ZC,
+	__IORING_OP_READ_MULTISHOT,	/* reserved, not supported */
+	IORING_OP_WAITID,
+	IORING_OP_FUTEX_WAIT,
+	IORING_OP_FUTEX_WAKE,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -313,11 +319,20 @@ enum io_uring_op {
  *				0 is reported if zerocopy was actually possible.
  *				IORING_NOTIF_USAGE_ZC_COPIED if data was copied
  *				(at least partially).
+ *
+ * IORING_RECVSEND_BUNDLE	Used with IOSQE_BUFFER_SELECT and a provided
+ *				buffer ring for send and recv. A single
+ *				transfer may then use several consecutive
+ *				buffers of the ring. The CQE carries the ID
+ *				of the first buffer and cqe.res the total
+ *				number of bytes; the buffers that bytes
+ *				landed in (or came from) are all consumed.
  */
 #define IORING_RECVSEND_POLL_FIRST	(1U << 0)
 #define IORING_RECV_MULTISHOT		(1U << 1)
 #define IORING_RECVSEND_FIXED_BUF	(1U << 2)
 #define IORING_SEND_ZC_REPORT_USAGE	(1U << 3)
+#define IORING_RECVSEND_BUNDLE		(1U << 4)
 
 /*
  * cqe.res for IORING_CQE_F_NOTIF if
@@ -443,6 +458,7 @@ struct io_cqring_offsets {
 #define IORING_ENTER_SQ_WAIT		(1U << 2)
 #define IORING_ENTER_EXT_ARG		(1U << 3)
 #define IORING_ENTER_REGISTERED_RING	(1U << 4)
+#define IORING_ENTER_EXT_ARG_REG	(1U << 6)
 
 /*
  * Passed in for io_uring_setup(2). Copied back with updated info on success
@@ -477,6 +493,8 @@ struct io_uring_params {
 #define IORING_FEAT_CQE_SKIP		(1U << 11)
 #define IORING_FEAT_LINKED_FILE		(1U << 12)
 #define IORING_FEAT_REG_REG_RING	(1U << 13)
+#define IORING_FEAT_RECVSEND_BUNDLE	(1U << 14)
+#define IORING_FEAT_MIN_TIMEOUT		(1U << 15)
 
 /*
  * io_uring_register(2) opcodes and arguments
@@ -523,6 +541,20 @@ enum {
 	/* register a range of fixed file slots for automatic slot allocation */
 	IORING_REGISTER_FILE_ALLOC_RANGE	= 25,
 
+	/* register a memory region, see struct io_uring_mem_region_reg */
+	IORING_REGISTER_MEM_REGION		= 34,
+
+	/*
+	 * Opcodes from here on are local to this tree. They start well
+	 * above the upstream ones so the two ranges never overlap.
+	 */
+
+	/* set/clear the io-wq affinity of one worker category */
+	IORING_REGISTER_IOWQ_ACCT_AFF		= 128,
+
+	/* set the share (1-32) of a ring on a shared SQPOLL thread */
+	IORING_REGISTER_SQ_WEIGHT		= 129,
+
 	/* this goes last */
 	IORING_REGISTER_LAST,
 
@@ -536,6 +568,18 @@ enum {
 	IO_WQ_UNBOUND,
 };
 
+/*
+ * Argument for IORING_REGISTER_IOWQ_ACCT_AFF: restrict the workers of one
+ * category to the CPUs in mask (a cpu_set_t of mask_len bytes), within the
+ * set from IORING_REGISTER_IOWQ_AFF. A mask_len of 0 drops the restriction.
+ */
+struct io_uring_iowq_acct_aff {
+	__u32	acct;		/* IO_WQ_BOUND or IO_WQ_UNBOUND */
+	__u32	mask_len;
+	__u64	mask;
+	__u64	resv[2];
+};
+
 /* deprecated, see struct io_uring_rsrc_update */
 struct io_uring_files_update {
 	__u32 offset;
@@ -671,10 +715,58 @@ enum {
 struct io_uring_getevents_arg {
 	__u64	sigmask;
 	__u32	sigmask_sz;
-	__u32	pad;
+	__u32	min_wait_usec;
 	__u64	ts;
 };
 
+/*
+ * Wait arguments in a region registered with IORING_MEM_REGION_REG_WAIT_ARG.
+ * With IORING_ENTER_EXT_ARG | IORING_ENTER_EXT_ARG_REG, the argp passed to
+ * io_uring_enter(2) is the byte offset of one in the region and argsz must be
+ * sizeof(struct io_uring_reg_wait). ts is a relative timeout, used if
+ * IORING_REG_WAIT_TS is set in flags.
+ *
+ * If min_wait_usec is set, the wait for min_complete events only lasts that
+ * long; after it expires, a single completion is enough to return.
+ */
+#define IORING_REG_WAIT_TS		(1U << 0)
+
+struct io_uring_reg_wait {
+	struct __kernel_timespec	ts;
+	__u32				min_wait_usec;
+	__u32				flags;
+	__u64				sigmask;
+	__u32				sigmask_sz;
+	__u32				pad[3];
+	__u64				pad2[2];
+};
+
+enum {
+	/* initialise with user provided memory pointed by user_addr */
+	IORING_MEM_REGION_TYPE_USER		= 1,
+};
+
+/* argument for IORING_REGISTER_MEM_REGION */
+struct io_uring_region_desc {
+	__u64 user_addr;
+	__u64 size;
+	__u32 flags;
+	__u32 id;
+	__u64 mmap_offset;
+	__u64 __resv[4];
+};
+
+enum {
+	/* expose the region as registered wait arguments */
+	IORING_MEM_REGION_REG_WAIT_ARG		= 1,
+};
+
+struct io_uring_mem_region_reg {
+	__u64 region_uptr; /* struct io_uring_region_desc * */
+	__u64 flags;
+	__u64 __resv[2];
+};
+
 /*
  * Argument for IORING_REGISTER_SYNC_CANCEL
  */
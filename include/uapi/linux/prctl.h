@@ -300,4 +300,9 @@ struct prctl_mm_map {
 # define PR_SET_MEM_MODEL_DEFAULT	0
 # define PR_SET_MEM_MODEL_TSO		1
 
+/* FUTEX hash management */
+#define PR_FUTEX_HASH			78
+# define PR_FUTEX_HASH_SET_SLOTS	1
+# define PR_FUTEX_HASH_GET_SLOTS	2
+
 #endif /* _LINUX_PRCTL_H */
@@ -10,6 +10,7 @@ struct sched_param {
 
 #define SCHED_ATTR_SIZE_VER0	48	/* sizeof first published struct */
 #define SCHED_ATTR_SIZE_VER1	56	/* add: util_{min,max} */
+#define SCHED_ATTR_SIZE_VER2	60	/* add: latency_nice */
 
 /*
  * Extended scheduling parameters data structure.
@@ -98,6 +99,19 @@ struct sched_param {
  * scheduled on a CPU with no more capacity than the specified value.
  *
  * A task utilization boundary can be reset by setting the attribute to -1.
+ *
+ * Latency Tolerance Attributes
+ * ============================
+ *
+ * A subset of sched_attr attributes allows to specify how much scheduling
+ * latency a CFS task tolerates, relative to the other tasks:
+ *
+ *  @sched_latency_nice	task's latency nice value, used with
+ *			SCHED_FLAG_LATENCY_NICE
+ *
+ * The value is in the range [-20..19]. A negative value lets a waking task
+ * preempt the running one earlier and gives it shorter time slices, a
+ * positive value does the opposite. The default is 0.
  */
 struct sched_attr {
 	__u32 size;
@@ -120,6 +134,8 @@ struct sched_attr {
 	__u32 sched_util_min;
 	__u32 sched_util_max;
 
+	/* latency requirement hint */
+	__s32 sched_latency_nice;
 };
 
 #endif /* _UAPI_LINUX_SCHED_TYPES_H */
@@ -1291,6 +1291,46 @@ static int __init ignore_unknown_bootoption(char *param, char *val,
 	return 0;
 }
 
+static bool initcall_async = true;
+core_param(initcall_async, initcall_async, bool, 0444);
+
+static ASYNC_DOMAIN(initcall_async_domain);
+static unsigned int initcall_async_pending __initdata;
+
+static void __init do_async_initcall(void *data, async_cookie_t cookie)
+{
+	do_one_initcall(data);
+}
+
+/*
+ * Called from the stub that an async initcall leaves in its level, in
+ * place of the initcall itself.  With initcall_async=0 the initcall runs
+ * right away instead, when its stub does.
+ */
+int __init initcall_schedule_async(initcall_t fn)
+{
+	if (!initcall_async)
+		return do_one_initcall(fn);
+
+	initcall_async_pending++;
+	async_schedule_domain(do_async_initcall, (void *)fn,
+			      &initcall_async_domain);
+	return 0;
+}
+
+static void __init initcall_async_synchronize(int level)
+{
+	ktime_t calltime = ktime_get();
+
+	async_synchronize_full_domain(&initcall_async_domain);
+	if (initcall_debug)
+		pr_info("initcall level %s: waited %lld usecs for %u async initcalls\n",
+			initcall_level_names[level],
+			ktime_us_delta(ktime_get(), calltime),
+			initcall_async_pending);
+	initcall_async_pending = 0;
+}
+
 static void __init do_initcall_level(int level, char *command_line)
 {
 	initcall_entry_t *fn;
@@ -1304,6 +1344,9 @@ static void __init do_initcall_level(int level, char *command_line)
 	trace_initcall_level(initcall_level_names[level]);
 	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
 		do_one_initcall(initcall_from_entry(fn));
+
+	if (initcall_async_pending)
+		initcall_async_synchronize(level);
 }
 
 static void __init do_initcalls(void)
@@ -1552,6 +1595,8 @@ static noinline void __init kernel_init_freeable(void)
 	smp_init();
 	sched_init_smp();
 
+	workqueue_init_topology();
+
 	padata_init();
 	page_alloc_init_late();
 
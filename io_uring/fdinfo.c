@@ -144,6 +144,13 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 	seq_printf(m, "SqThread:\t%d\n", sq ? task_pid_nr(sq->thread) : -1);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq ? task_cpu(sq->thread) : -1);
+	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		seq_printf(m, "SqWeight:\t%u\n", READ_ONCE(ctx->sq_weight));
+		seq_printf(m, "SqSubmitted:\t%llu\n", READ_ONCE(ctx->sq_submitted));
+		seq_printf(m, "SqAvgGapNs:\t%llu\n", READ_ONCE(ctx->sq_avg_gap_ns));
+		seq_printf(m, "SqIdleMs:\t%u\n",
+			   jiffies_to_msecs(READ_ONCE(ctx->sq_idle)));
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -56,6 +56,9 @@ struct io_worker {
 
 	struct completion ref_done;
 
+	/* acct->mask_seq the current affinity was taken from */
+	unsigned mask_seq;
+
 	unsigned long create_state;
 	struct callback_head create_work;
 	int create_index;
@@ -82,6 +85,14 @@ struct io_wq_acct {
 	raw_spinlock_t lock;
 	struct io_wq_work_list work_list;
 	unsigned long flags;
+	/*
+	 * Placement hint for this class of work, and the mask its workers
+	 * actually run on: the hint within io_wq->cpu_mask, or all of the
+	 * latter if the two don't overlap. mask_seq is bumped on updates.
+	 */
+	cpumask_var_t aff_mask;
+	cpumask_var_t cpu_mask;
+	unsigned mask_seq;
 };
 
 enum {
@@ -168,6 +179,34 @@ static inline struct io_wq_acct *io_wq_get_acct(struct io_worker *worker)
 	return io_get_acct(worker->wq, worker->flags & IO_WORKER_F_BOUND);
 }
 
+static void io_wq_update_acct_masks(struct io_wq *wq)
+{
+	int i;
+
+	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+		struct io_wq_acct *acct = &wq->acct[i];
+
+		if (!cpumask_and(acct->cpu_mask, wq->cpu_mask, acct->aff_mask))
+			cpumask_copy(acct->cpu_mask, wq->cpu_mask);
+		WRITE_ONCE(acct->mask_seq, acct->mask_seq + 1);
+	}
+}
+
+/*
+ * Move an existing worker after its class was re-placed, called from the
+ * worker itself before it looks for work.
+ */
+static void io_worker_update_affinity(struct io_worker *worker,
+				      struct io_wq_acct *acct)
+{
+	unsigned seq = READ_ONCE(acct->mask_seq);
+
+	if (likely(worker->mask_seq == seq))
+		return;
+	worker->mask_seq = seq;
+	set_cpus_allowed_ptr(current, acct->cpu_mask);
+}
+
 static void io_worker_ref_put(struct io_wq *wq)
 {
 	if (atomic_dec_and_test(&wq->worker_refs))
@@ -610,6 +649,7 @@ static int io_wq_worker(void *data)
 	while (!test_bit(IO_WQ_BIT_EXIT, &wq->state)) {
 		long ret;
 
+		io_worker_update_affinity(worker, acct);
 		set_current_state(TASK_INTERRUPTIBLE);
 		while (io_acct_run_queue(acct))
 			io_worker_handle_work(worker);
@@ -641,7 +681,7 @@ static int io_wq_worker(void *data)
 		if (!ret) {
 			last_timeout = true;
 			exit_mask = !cpumask_test_cpu(raw_smp_processor_id(),
-							wq->cpu_mask);
+							acct->cpu_mask);
 		}
 	}
 
@@ -691,9 +731,12 @@ void io_wq_worker_sleeping(struct task_struct *tsk)
 static void io_init_new_worker(struct io_wq *wq, struct io_worker *worker,
 			       struct task_struct *tsk)
 {
+	struct io_wq_acct *acct = io_wq_get_acct(worker);
+
 	tsk->worker_private = worker;
 	worker->task = tsk;
-	set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+	worker->mask_seq = READ_ONCE(acct->mask_seq);
+	set_cpus_allowed_ptr(tsk, acct->cpu_mask);
 
 	raw_spin_lock(&wq->lock);
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &wq->free_list);
@@ -1107,6 +1150,16 @@ static int io_wq_hash_wake(struct wait_queue_entry *wait, unsigned mode,
 	return 1;
 }
 
+static void io_wq_free_acct_masks(struct io_wq *wq)
+{
+	int i;
+
+	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+		free_cpumask_var(wq->acct[i].aff_mask);
+		free_cpumask_var(wq->acct[i].cpu_mask);
+	}
+}
+
 struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 {
 	int ret, i;
@@ -1134,6 +1187,15 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	if (!alloc_cpumask_var(&wq->cpu_mask, GFP_KERNEL))
 		goto err;
 	cpumask_copy(wq->cpu_mask, cpu_possible_mask);
+	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+		struct io_wq_acct *acct = &wq->acct[i];
+
+		if (!zalloc_cpumask_var(&acct->aff_mask, GFP_KERNEL) ||
+		    !zalloc_cpumask_var(&acct->cpu_mask, GFP_KERNEL))
+			goto err;
+		cpumask_copy(acct->aff_mask, cpu_possible_mask);
+		cpumask_copy(acct->cpu_mask, cpu_possible_mask);
+	}
 	wq->acct[IO_WQ_ACCT_BOUND].max_workers = bounded;
 	wq->acct[IO_WQ_ACCT_UNBOUND].max_workers =
 				task_rlimit(current, RLIMIT_NPROC);
@@ -1160,6 +1222,7 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	io_wq_put_hash(data->hash);
 	cpuhp_state_remove_instance_nocalls(io_wq_online, &wq->cpuhp_node);
 
+	io_wq_free_acct_masks(wq);
 	free_cpumask_var(wq->cpu_mask);
 err_wq:
 	kfree(wq);
@@ -1229,6 +1292,7 @@ static void io_wq_destroy(struct io_wq *wq)
 
 	cpuhp_state_remove_instance_nocalls(io_wq_online, &wq->cpuhp_node);
 	io_wq_cancel_pending_work(wq, &match);
+	io_wq_free_acct_masks(wq);
 	free_cpumask_var(wq->cpu_mask);
 	io_wq_put_hash(wq->hash);
 	kfree(wq);
@@ -1267,6 +1331,7 @@ static int __io_wq_cpu_online(struct io_wq *wq, unsigned int cpu, bool online)
 
 	rcu_read_lock();
 	io_wq_for_each_worker(wq, io_wq_worker_affinity, &od);
+	io_wq_update_acct_masks(wq);
 	rcu_read_unlock();
 	return 0;
 }
@@ -1292,6 +1357,33 @@ int io_wq_cpu_affinity(struct io_wq *wq, cpumask_var_t mask)
 		cpumask_copy(wq->cpu_mask, mask);
 	else
 		cpumask_copy(wq->cpu_mask, cpu_possible_mask);
+	io_wq_update_acct_masks(wq);
+	rcu_read_unlock();
+
+	return 0;
+}
+
+/*
+ * Set the placement hint of one class of workers, e.g. to keep bounded
+ * (regular file) punts on the fast cluster and unbounded ones elsewhere.
+ * A NULL mask drops the hint. The hint only ever narrows the io_wq mask.
+ */
+int io_wq_acct_cpu_affinity(struct io_wq *wq, int index, cpumask_var_t mask)
+{
+	struct io_wq_acct *acct;
+
+	if (index < 0 || index >= IO_WQ_ACCT_NR)
+		return -EINVAL;
+	if (mask && !cpumask_intersects(mask, cpu_possible_mask))
+		return -EINVAL;
+
+	acct = &wq->acct[index];
+	rcu_read_lock();
+	if (mask)
+		cpumask_copy(acct->aff_mask, mask);
+	else
+		cpumask_copy(acct->aff_mask, cpu_possible_mask);
+	io_wq_update_acct_masks(wq);
 	rcu_read_unlock();
 
 	return 0;
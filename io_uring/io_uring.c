@@ -72,6 +72,7 @@
 #include <linux/io_uring.h>
 #include <linux/audit.h>
 #include <linux/security.h>
+#include <linux/vmalloc.h>
 #include <asm/shmparam.h>
 
 #define CREATE_TRACE_POINTS
@@ -92,6 +93,8 @@
 #include "cancel.h"
 #include "net.h"
 #include "notif.h"
+#include "futex.h"
+#include "waitid.h"
 
 #include "timeout.h"
 #include "poll.h"
@@ -149,7 +152,6 @@ static void io_dismantle_req(struct io_kiocb *req);
 static void io_clean_op(struct io_kiocb *req);
 static void io_queue_sqe(struct io_kiocb *req);
 static void io_move_task_work_from_local(struct io_ring_ctx *ctx);
-static void __io_submit_flush_completions(struct io_ring_ctx *ctx);
 static __cold void io_fallback_tw(struct io_uring_task *tctx);
 
 struct kmem_cache *req_cachep;
@@ -167,13 +169,6 @@ struct sock *io_uring_get_socket(struct file *file)
 }
 EXPORT_SYMBOL(io_uring_get_socket);
 
-static inline void io_submit_flush_completions(struct io_ring_ctx *ctx)
-{
-	if (!wq_list_empty(&ctx->submit_state.compl_reqs) ||
-	    ctx->submit_state.cqes_count)
-		__io_submit_flush_completions(ctx);
-}
-
 static inline unsigned int __io_cqring_events(struct io_ring_ctx *ctx)
 {
 	return ctx->cached_cq_tail - READ_ONCE(ctx->rings->cq.head);
@@ -326,6 +321,9 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	spin_lock_init(&ctx->timeout_lock);
 	INIT_WQ_LIST(&ctx->iopoll_list);
 	INIT_LIST_HEAD(&ctx->io_buffers_pages);
+	INIT_HLIST_HEAD(&ctx->futex_list);
+	INIT_HLIST_HEAD(&ctx->waitid_list);
+	INIT_HLIST_HEAD(&ctx->cancelable_uring_cmd);
 	INIT_LIST_HEAD(&ctx->io_buffers_comp);
 	INIT_LIST_HEAD(&ctx->defer_list);
 	INIT_LIST_HEAD(&ctx->timeout_list);
@@ -1545,7 +1543,7 @@ void io_free_batch_list(struct io_ring_ctx *ctx, struct io_wq_work_node *node)
 		io_put_task(task, task_refs);
 }
 
-static void __io_submit_flush_completions(struct io_ring_ctx *ctx)
+void __io_submit_flush_completions(struct io_ring_ctx *ctx)
 	__must_hold(&ctx->uring_lock)
 {
 	struct io_submit_state *state = &ctx->submit_state;
@@ -2530,6 +2528,15 @@ struct io_wait_queue {
 	unsigned cq_tail;
 	unsigned nr_timeouts;
 	ktime_t timeout;
+	ktime_t min_timeout;
+};
+
+struct ext_arg {
+	size_t argsz;
+	const sigset_t __user *sig;
+	ktime_t min_time;
+	struct timespec64 ts;
+	bool ts_set;
 };
 
 static inline bool io_has_work(struct io_ring_ctx *ctx)
@@ -2588,10 +2595,21 @@ static bool current_pending_io(void)
 	return percpu_counter_read_positive(&tctx->inflight);
 }
 
+/*
+ * The min wait time passed without min_events completions showing up. Stop
+ * waiting for the whole batch, from now on a single completion is enough.
+ */
+static void io_cqring_min_timeout(struct io_wait_queue *iowq)
+{
+	iowq->min_timeout = KTIME_MAX;
+	iowq->cq_tail = READ_ONCE(iowq->ctx->rings->cq.head) + 1;
+}
+
 /* when returns >0, the caller should retry */
 static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
 					  struct io_wait_queue *iowq)
 {
+	ktime_t timeout = min(iowq->timeout, iowq->min_timeout);
 	int io_wait, ret;
 
 	if (unlikely(READ_ONCE(ctx->check_cq)))
@@ -2614,10 +2632,14 @@ static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
 	if (current_pending_io())
 		current->in_iowait = 1;
 	ret = 0;
-	if (iowq->timeout == KTIME_MAX)
+	if (timeout == KTIME_MAX)
 		schedule();
-	else if (!schedule_hrtimeout(&iowq->timeout, HRTIMER_MODE_ABS))
-		ret = -ETIME;
+	else if (!schedule_hrtimeout(&timeout, HRTIMER_MODE_ABS)) {
+		if (timeout == iowq->timeout)
+			ret = -ETIME;
+		else
+			io_cqring_min_timeout(iowq);
+	}
 	current->in_iowait = io_wait;
 	return ret;
 }
@@ -2627,11 +2649,11 @@ static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
  * application must reap them itself, as they reside on the shared cq ring.
  */
 static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
-			  const sigset_t __user *sig, size_t sigsz,
-			  struct __kernel_timespec __user *uts)
+			  struct ext_arg *ext_arg)
 {
 	struct io_wait_queue iowq;
 	struct io_rings *rings = ctx->rings;
+	ktime_t now;
 	int ret;
 
 	if (!io_allowed_run_tw(ctx))
@@ -2644,14 +2666,14 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 	if (__io_cqring_events_user(ctx) >= min_events)
 		return 0;
 
-	if (sig) {
+	if (ext_arg->sig) {
 #ifdef CONFIG_COMPAT
 		if (in_compat_syscall())
-			ret = set_compat_user_sigmask((const compat_sigset_t __user *)sig,
-						      sigsz);
+			ret = set_compat_user_sigmask((const compat_sigset_t __user *)ext_arg->sig,
+						      ext_arg->argsz);
 		else
 #endif
-			ret = set_user_sigmask(sig, sigsz);
+			ret = set_user_sigmask(ext_arg->sig, ext_arg->argsz);
 
 		if (ret)
 			return ret;
@@ -2664,13 +2686,16 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 	iowq.nr_timeouts = atomic_read(&ctx->cq_timeouts);
 	iowq.cq_tail = READ_ONCE(ctx->rings->cq.head) + min_events;
 	iowq.timeout = KTIME_MAX;
-
-	if (uts) {
-		struct timespec64 ts;
-
-		if (get_timespec64(&ts, uts))
-			return -EFAULT;
-		iowq.timeout = ktime_add_ns(timespec64_to_ktime(ts), ktime_get_ns());
+	iowq.min_timeout = KTIME_MAX;
+
+	if (ext_arg->ts_set || ext_arg->min_time) {
+		now = ktime_get();
+		if (ext_arg->ts_set)
+			iowq.timeout = ktime_add(timespec64_to_ktime(ext_arg->ts),
+						 now);
+		/* waiting for one event, the min wait time is moot */
+		if (ext_arg->min_time && min_events > 1)
+			iowq.min_timeout = ktime_add_ns(now, ext_arg->min_time);
 	}
 
 	trace_io_uring_cqring_wait(ctx, min_events);
@@ -2857,6 +2882,21 @@ static void io_rsrc_node_cache_free(struct io_cache_entry *entry)
 	kfree(container_of(entry, struct io_rsrc_node, cache));
 }
 
+static void io_unregister_mem_region(struct io_ring_ctx *ctx)
+{
+	if (!ctx->cq_wait_pages)
+		return;
+
+	vunmap(ctx->cq_wait_arg);
+	unpin_user_pages(ctx->cq_wait_pages, ctx->cq_wait_nr_pages);
+	if (ctx->user)
+		__io_unaccount_mem(ctx->user, ctx->cq_wait_nr_pages);
+	kvfree(ctx->cq_wait_pages);
+	ctx->cq_wait_pages = NULL;
+	ctx->cq_wait_arg = NULL;
+	ctx->cq_wait_size = 0;
+}
+
 static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 {
 	io_sq_thread_finish(ctx);
@@ -2875,6 +2915,7 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	io_alloc_cache_free(&ctx->netmsg_cache, io_netmsg_cache_free);
 	io_destroy_buffers(ctx);
 	mutex_unlock(&ctx->uring_lock);
+	io_unregister_mem_region(ctx);
 	if (ctx->sq_creds)
 		put_cred(ctx->sq_creds);
 	if (ctx->submitter_task)
@@ -3284,6 +3325,9 @@ static __cold bool io_uring_try_cancel_requests(struct io_ring_ctx *ctx,
 	ret |= io_cancel_defer_files(ctx, task, cancel_all);
 	mutex_lock(&ctx->uring_lock);
 	ret |= io_poll_remove_all(ctx, task, cancel_all);
+	ret |= io_futex_remove_all(ctx, task, cancel_all);
+	ret |= io_waitid_remove_all(ctx, task, cancel_all);
+	ret |= io_uring_try_cancel_uring_cmd(ctx, task, cancel_all);
 	mutex_unlock(&ctx->uring_lock);
 	ret |= io_kill_timeouts(ctx, task, cancel_all);
 	if (task)
@@ -3510,8 +3554,37 @@ static unsigned long io_uring_nommu_get_unmapped_area(struct file *file,
 
 #endif /* !CONFIG_MMU */
 
-static int io_validate_ext_arg(unsigned flags, const void __user *argp, size_t argsz)
+/*
+ * With IORING_ENTER_EXT_ARG_REG, argp is the byte offset of a struct
+ * io_uring_reg_wait in the region registered for wait arguments.
+ */
+static struct io_uring_reg_wait *io_get_ext_arg_reg(struct io_ring_ctx *ctx,
+						   const void __user *argp)
 {
+	unsigned long size = sizeof(struct io_uring_reg_wait);
+	unsigned long offset = (uintptr_t) argp;
+	unsigned long end;
+
+	if (unlikely(offset % sizeof(long)))
+		return ERR_PTR(-EFAULT);
+
+	/* also catches a missing region, whose size is 0 */
+	if (unlikely(check_add_overflow(offset, size, &end) ||
+		     end > ctx->cq_wait_size))
+		return ERR_PTR(-EFAULT);
+
+	offset = array_index_nospec(offset, ctx->cq_wait_size - size + 1);
+	return ctx->cq_wait_arg + offset;
+}
+
+static int io_validate_ext_arg(struct io_ring_ctx *ctx, unsigned flags,
+			       const void __user *argp, size_t argsz)
+{
+	if (flags & IORING_ENTER_EXT_ARG_REG) {
+		if (argsz != sizeof(struct io_uring_reg_wait))
+			return -EINVAL;
+		return PTR_ERR_OR_ZERO(io_get_ext_arg_reg(ctx, argp));
+	}
 	if (flags & IORING_ENTER_EXT_ARG) {
 		struct io_uring_getevents_arg arg;
 
@@ -3523,10 +3596,10 @@ static int io_validate_ext_arg(unsigned flags, const void __user *argp, size_t a
 	return 0;
 }
 
-static int io_get_ext_arg(unsigned flags, const void __user *argp, size_t *argsz,
-			  struct __kernel_timespec __user **ts,
-			  const sigset_t __user **sig)
+static int io_get_ext_arg(struct io_ring_ctx *ctx, unsigned flags,
+			  const void __user *argp, struct ext_arg *ext_arg)
 {
+	const struct __kernel_timespec __user *uts;
 	struct io_uring_getevents_arg arg;
 
 	/*
@@ -3534,8 +3607,35 @@ static int io_get_ext_arg(unsigned flags, const void __user *argp, size_t *argsz
 	 * is just a pointer to the sigset_t.
 	 */
 	if (!(flags & IORING_ENTER_EXT_ARG)) {
-		*sig = (const sigset_t __user *) argp;
-		*ts = NULL;
+		ext_arg->sig = (const sigset_t __user *) argp;
+		return 0;
+	}
+
+	/*
+	 * Registered wait arguments live in kernel mapped memory already,
+	 * no copies are needed beyond reading the entry once.
+	 */
+	if (flags & IORING_ENTER_EXT_ARG_REG) {
+		struct io_uring_reg_wait *w;
+		u32 wflags;
+
+		if (ext_arg->argsz != sizeof(*w))
+			return -EINVAL;
+		w = io_get_ext_arg_reg(ctx, argp);
+		if (IS_ERR(w))
+			return PTR_ERR(w);
+		wflags = READ_ONCE(w->flags);
+		if (wflags & ~IORING_REG_WAIT_TS)
+			return -EINVAL;
+		ext_arg->min_time = (u64) READ_ONCE(w->min_wait_usec) *
+					NSEC_PER_USEC;
+		ext_arg->sig = u64_to_user_ptr(READ_ONCE(w->sigmask));
+		ext_arg->argsz = READ_ONCE(w->sigmask_sz);
+		if (wflags & IORING_REG_WAIT_TS) {
+			ext_arg->ts.tv_sec = READ_ONCE(w->ts.tv_sec);
+			ext_arg->ts.tv_nsec = READ_ONCE(w->ts.tv_nsec);
+			ext_arg->ts_set = true;
+		}
 		return 0;
 	}
 
@@ -3543,15 +3643,19 @@ static int io_get_ext_arg(unsigned flags, const void __user *argp, size_t *argsz
 	 * EXT_ARG is set - ensure we agree on the size of it and copy in our
 	 * timespec and sigset_t pointers if good.
 	 */
-	if (*argsz != sizeof(arg))
+	if (ext_arg->argsz != sizeof(arg))
 		return -EINVAL;
 	if (copy_from_user(&arg, argp, sizeof(arg)))
 		return -EFAULT;
-	if (arg.pad)
-		return -EINVAL;
-	*sig = u64_to_user_ptr(arg.sigmask);
-	*argsz = arg.sigmask_sz;
-	*ts = u64_to_user_ptr(arg.ts);
+	ext_arg->min_time = (u64) arg.min_wait_usec * NSEC_PER_USEC;
+	ext_arg->sig = u64_to_user_ptr(arg.sigmask);
+	ext_arg->argsz = arg.sigmask_sz;
+	uts = u64_to_user_ptr(arg.ts);
+	if (uts) {
+		if (get_timespec64(&ext_arg->ts, uts))
+			return -EFAULT;
+		ext_arg->ts_set = true;
+	}
 	return 0;
 }
 
@@ -3565,7 +3669,11 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 
 	if (unlikely(flags & ~(IORING_ENTER_GETEVENTS | IORING_ENTER_SQ_WAKEUP |
 			       IORING_ENTER_SQ_WAIT | IORING_ENTER_EXT_ARG |
-			       IORING_ENTER_REGISTERED_RING)))
+			       IORING_ENTER_REGISTERED_RING |
+			       IORING_ENTER_EXT_ARG_REG)))
+		return -EINVAL;
+	if (unlikely((flags & IORING_ENTER_EXT_ARG_REG) &&
+		     !(flags & IORING_ENTER_EXT_ARG)))
 		return -EINVAL;
 
 	/*
@@ -3651,7 +3759,7 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 			 */
 			mutex_lock(&ctx->uring_lock);
 iopoll_locked:
-			ret2 = io_validate_ext_arg(flags, argp, argsz);
+			ret2 = io_validate_ext_arg(ctx, flags, argp, argsz);
 			if (likely(!ret2)) {
 				min_complete = min(min_complete,
 						   ctx->cq_entries);
@@ -3659,15 +3767,14 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 			}
 			mutex_unlock(&ctx->uring_lock);
 		} else {
-			const sigset_t __user *sig;
-			struct __kernel_timespec __user *ts;
+			struct ext_arg ext_arg = { .argsz = argsz };
 
-			ret2 = io_get_ext_arg(flags, argp, &argsz, &ts, &sig);
+			ret2 = io_get_ext_arg(ctx, flags, argp, &ext_arg);
 			if (likely(!ret2)) {
 				min_complete = min(min_complete,
 						   ctx->cq_entries);
-				ret2 = io_cqring_wait(ctx, min_complete, sig,
-						      argsz, ts);
+				ret2 = io_cqring_wait(ctx, min_complete,
+						      &ext_arg);
 			}
 		}
 
@@ -3952,7 +4059,8 @@ static __cold int io_uring_create(unsigned entries, struct io_uring_params *p,
 			IORING_FEAT_POLL_32BITS | IORING_FEAT_SQPOLL_NONFIXED |
 			IORING_FEAT_EXT_ARG | IORING_FEAT_NATIVE_WORKERS |
 			IORING_FEAT_RSRC_TAGS | IORING_FEAT_CQE_SKIP |
-			IORING_FEAT_LINKED_FILE | IORING_FEAT_REG_REG_RING;
+			IORING_FEAT_LINKED_FILE | IORING_FEAT_REG_REG_RING |
+			IORING_FEAT_RECVSEND_BUNDLE | IORING_FEAT_MIN_TIMEOUT;
 
 	if (copy_to_user(params, p, sizeof(*p))) {
 		ret = -EFAULT;
@@ -4173,6 +4281,26 @@ static int io_register_enable_rings(struct io_ring_ctx *ctx)
 	return 0;
 }
 
+static int io_copy_cpumask(cpumask_var_t mask, const void __user *arg,
+			   unsigned len)
+{
+	int ret;
+
+	cpumask_clear(mask);
+	if (len > cpumask_size())
+		len = cpumask_size();
+
+	if (in_compat_syscall()) {
+		ret = compat_get_bitmap(cpumask_bits(mask),
+					(const compat_ulong_t __user *)arg,
+					len * 8 /* CHAR_BIT */);
+	} else {
+		ret = copy_from_user(mask, arg, len);
+	}
+
+	return ret ? -EFAULT : 0;
+}
+
 static __cold int io_register_iowq_aff(struct io_ring_ctx *ctx,
 				       void __user *arg, unsigned len)
 {
@@ -4186,24 +4314,43 @@ static __cold int io_register_iowq_aff(struct io_ring_ctx *ctx,
 	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL))
 		return -ENOMEM;
 
-	cpumask_clear(new_mask);
-	if (len > cpumask_size())
-		len = cpumask_size();
+	ret = io_copy_cpumask(new_mask, arg, len);
+	if (!ret)
+		ret = io_wq_cpu_affinity(tctx->io_wq, new_mask);
+	free_cpumask_var(new_mask);
+	return ret;
+}
 
-	if (in_compat_syscall()) {
-		ret = compat_get_bitmap(cpumask_bits(new_mask),
-					(const compat_ulong_t __user *)arg,
-					len * 8 /* CHAR_BIT */);
-	} else {
-		ret = copy_from_user(new_mask, arg, len);
-	}
+static __cold int io_register_iowq_acct_aff(struct io_ring_ctx *ctx,
+					    void __user *arg)
+{
+	struct io_uring_task *tctx = current->io_uring;
+	struct io_uring_iowq_acct_aff aff;
+	cpumask_var_t new_mask;
+	int ret;
 
-	if (ret) {
-		free_cpumask_var(new_mask);
+	if (!tctx || !tctx->io_wq)
+		return -EINVAL;
+	if (copy_from_user(&aff, arg, sizeof(aff)))
 		return -EFAULT;
+	if (aff.resv[0] || aff.resv[1])
+		return -EINVAL;
+	if (aff.acct != IO_WQ_BOUND && aff.acct != IO_WQ_UNBOUND)
+		return -EINVAL;
+
+	if (!aff.mask_len) {
+		if (aff.mask)
+			return -EINVAL;
+		return io_wq_acct_cpu_affinity(tctx->io_wq, aff.acct, NULL);
 	}
 
-	ret = io_wq_cpu_affinity(tctx->io_wq, new_mask);
+	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = io_copy_cpumask(new_mask, u64_to_user_ptr(aff.mask),
+			      aff.mask_len);
+	if (!ret)
+		ret = io_wq_acct_cpu_affinity(tctx->io_wq, aff.acct, new_mask);
 	free_cpumask_var(new_mask);
 	return ret;
 }
@@ -4218,6 +4365,85 @@ static __cold int io_unregister_iowq_aff(struct io_ring_ctx *ctx)
 	return io_wq_cpu_affinity(tctx->io_wq, NULL);
 }
 
+/*
+ * Register a region of user memory holding struct io_uring_reg_wait entries,
+ * which io_uring_enter(2) can then refer to by offset with
+ * IORING_ENTER_EXT_ARG_REG rather than copying in a struct
+ * io_uring_getevents_arg and the timeout on every wait. The region stays
+ * until the ring goes away. Only user provided memory is supported, and
+ * wait arguments are the only use of a region so far.
+ */
+static __cold int io_register_mem_region(struct io_ring_ctx *ctx,
+					 void __user *uarg)
+{
+	struct io_uring_mem_region_reg reg;
+	struct io_uring_region_desc rd;
+	struct page **pages;
+	unsigned long end;
+	int nr_pages, ret;
+	void *ptr;
+
+	if (ctx->cq_wait_pages)
+		return -EBUSY;
+	if (copy_from_user(&reg, uarg, sizeof(reg)))
+		return -EFAULT;
+	if (memchr_inv(&reg.__resv, 0, sizeof(reg.__resv)))
+		return -EINVAL;
+	if (reg.flags != IORING_MEM_REGION_REG_WAIT_ARG)
+		return -EINVAL;
+	/*
+	 * Waiters don't hold the uring_lock. Only allow this while the ring
+	 * is still disabled, so that nobody can be looking at the region.
+	 */
+	if (!(ctx->flags & IORING_SETUP_R_DISABLED))
+		return -EINVAL;
+
+	if (copy_from_user(&rd, u64_to_user_ptr(reg.region_uptr), sizeof(rd)))
+		return -EFAULT;
+	if (memchr_inv(&rd.__resv, 0, sizeof(rd.__resv)))
+		return -EINVAL;
+	if (rd.flags & ~IORING_MEM_REGION_TYPE_USER)
+		return -EINVAL;
+	/* kernel allocated regions that userspace mmaps are not supported */
+	if (!(rd.flags & IORING_MEM_REGION_TYPE_USER))
+		return -EOPNOTSUPP;
+	if (!rd.user_addr || !rd.size || rd.mmap_offset || rd.id)
+		return -EINVAL;
+	if ((rd.size >> PAGE_SHIFT) > INT_MAX)
+		return -E2BIG;
+	if ((rd.user_addr | rd.size) & ~PAGE_MASK)
+		return -EINVAL;
+	if (check_add_overflow(rd.user_addr, rd.size, &end))
+		return -EOVERFLOW;
+
+	pages = io_pin_pages(rd.user_addr, rd.size, &nr_pages);
+	if (IS_ERR(pages))
+		return PTR_ERR(pages);
+	if (ctx->user) {
+		ret = __io_account_mem(ctx->user, nr_pages);
+		if (ret)
+			goto out_free;
+	}
+
+	ret = -ENOMEM;
+	ptr = vmap(pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	if (!ptr)
+		goto out_unaccount;
+
+	ctx->cq_wait_pages = pages;
+	ctx->cq_wait_nr_pages = nr_pages;
+	ctx->cq_wait_arg = ptr;
+	ctx->cq_wait_size = rd.size;
+	return 0;
+out_unaccount:
+	if (ctx->user)
+		__io_unaccount_mem(ctx->user, nr_pages);
+out_free:
+	unpin_user_pages(pages, nr_pages);
+	kvfree(pages);
+	return ret;
+}
+
 static __cold int io_register_iowq_max_workers(struct io_ring_ctx *ctx,
 					       void __user *arg)
 	__must_hold(&ctx->uring_lock)
@@ -4423,6 +4649,24 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_unregister_iowq_aff(ctx);
 		break;
+	case IORING_REGISTER_IOWQ_ACCT_AFF:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_iowq_acct_aff(ctx, arg);
+		break;
+	case IORING_REGISTER_SQ_WEIGHT:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_sqpoll_set_weight(ctx, arg);
+		break;
+	case IORING_REGISTER_MEM_REGION:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_mem_region(ctx, arg);
+		break;
 	case IORING_REGISTER_IOWQ_MAX_WORKERS:
 		ret = -EINVAL;
 		if (!arg || nr_args != 2)
@@ -4593,6 +4837,7 @@ static int __init io_uring_init(void)
 
 	req_cachep = KMEM_CACHE(io_kiocb, SLAB_HWCACHE_ALIGN | SLAB_PANIC |
 				SLAB_ACCOUNT | SLAB_TYPESAFE_BY_RCU);
+	kmem_cache_setup_percpu_array(req_cachep, 32);
 	return 0;
 };
 __initcall(io_uring_init);
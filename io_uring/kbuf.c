@@ -125,6 +125,20 @@ static void __user *io_provided_buffer_select(struct io_kiocb *req, size_t *len,
 	return NULL;
 }
 
+static struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+					       __u16 head)
+{
+	struct io_uring_buf *buf;
+
+	head &= bl->mask;
+	/* mmaped buffers are always contig */
+	if (bl->is_mmap || head < IO_BUFFER_LIST_BUF_PER_PAGE)
+		return &bl->buf_ring->bufs[head];
+
+	buf = page_address(bl->buf_pages[head / IO_BUFFER_LIST_BUF_PER_PAGE]);
+	return buf + (head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1));
+}
+
 static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 					  struct io_buffer_list *bl,
 					  unsigned int issue_flags)
@@ -136,16 +150,7 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 	if (unlikely(smp_load_acquire(&br->tail) == head))
 		return NULL;
 
-	head &= bl->mask;
-	/* mmaped buffers are always contig */
-	if (bl->is_mmap || head < IO_BUFFER_LIST_BUF_PER_PAGE) {
-		buf = &br->bufs[head];
-	} else {
-		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
-		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
-		buf = page_address(bl->buf_pages[index]);
-		buf += off;
-	}
+	buf = io_ring_head_to_buf(bl, head);
 	if (*len == 0 || *len > buf->len)
 		*len = buf->len;
 	req->flags |= REQ_F_BUFFER_RING;
@@ -189,6 +194,90 @@ void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 	return ret;
 }
 
+/*
+ * Map the buffers available at the head of the ring, without consuming them.
+ * The request completes with io_put_kbufs() for the number of buffers it
+ * actually used, or recycles them all.
+ */
+static int io_ring_buffers_peek(struct io_kiocb *req, struct buf_sel_arg *arg,
+				struct io_buffer_list *bl)
+{
+	size_t max_len = arg->max_len;
+	__u16 head = bl->head;
+	__u16 tail;
+	int nr = 0;
+
+	tail = smp_load_acquire(&bl->buf_ring->tail);
+	while (head != tail && nr < arg->nr_iovs) {
+		struct io_uring_buf *buf = io_ring_head_to_buf(bl, head);
+		size_t len = READ_ONCE(buf->len);
+
+		if (!nr)
+			req->buf_index = buf->bid;
+		if (arg->max_len) {
+			if (!max_len)
+				break;
+			len = min(len, max_len);
+			max_len -= len;
+		}
+		arg->iovs[nr].iov_base = u64_to_user_ptr(buf->addr);
+		arg->iovs[nr].iov_len = len;
+		nr++;
+		head++;
+	}
+
+	if (nr) {
+		req->flags |= REQ_F_BUFFER_RING;
+		req->buf_list = bl;
+	}
+	return nr;
+}
+
+/*
+ * Select buffers for a bundle send or receive into @arg->iovs. Returns the
+ * number of buffers selected, 0 if none are available.
+ *
+ * Only a buffer ring used from the locked issue path can hand out several
+ * buffers, as they stay on the ring until the request completes. Otherwise
+ * this falls back to a single buffer, selected the same way as for
+ * io_buffer_select().
+ */
+int io_buffers_select(struct io_kiocb *req, struct buf_sel_arg *arg,
+		      unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer_list *bl;
+	void __user *buf;
+	size_t len;
+	int ret = 0;
+
+	io_ring_submit_lock(ctx, issue_flags);
+
+	bl = io_buffer_get_list(ctx, req->buf_index);
+	if (unlikely(!bl))
+		goto out_unlock;
+
+	if (bl->is_mapped && !(issue_flags & IO_URING_F_UNLOCKED) &&
+	    file_can_poll(req->file)) {
+		ret = io_ring_buffers_peek(req, arg, bl);
+		goto out_unlock;
+	}
+
+	len = arg->max_len;
+	if (bl->is_mapped)
+		buf = io_ring_buffer_select(req, &len, bl, issue_flags);
+	else
+		buf = io_provided_buffer_select(req, &len, bl);
+	if (buf) {
+		arg->iovs[0].iov_base = buf;
+		arg->iovs[0].iov_len = len;
+		ret = 1;
+	}
+out_unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+
 static __cold int io_init_bl_list(struct io_ring_ctx *ctx)
 {
 	int i;
@@ -38,8 +38,16 @@ struct io_buffer {
 	__u16 bgid;
 };
 
+struct buf_sel_arg {
+	struct iovec *iovs;
+	size_t max_len;		/* 0 for no limit */
+	unsigned short nr_iovs;
+};
+
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 			      unsigned int issue_flags);
+int io_buffers_select(struct io_kiocb *req, struct buf_sel_arg *arg,
+		      unsigned int issue_flags);
 void io_destroy_buffers(struct io_ring_ctx *ctx);
 
 int io_remove_buffers_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
@@ -136,4 +144,16 @@ static inline unsigned int io_put_kbuf(struct io_kiocb *req,
 		return 0;
 	return __io_put_kbuf(req, issue_flags);
 }
+
+/* Like io_put_kbuf(), but consumes @nbufs ring buffers of a bundle */
+static inline unsigned int io_put_kbufs(struct io_kiocb *req, int nbufs,
+					unsigned issue_flags)
+{
+	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
+		return 0;
+	/* __io_put_kbuf() consumes the first one */
+	if ((req->flags & REQ_F_BUFFER_RING) && req->buf_list && nbufs > 1)
+		req->buf_list->head += nbufs - 1;
+	return __io_put_kbuf(req, issue_flags);
+}
 #endif
@@ -257,6 +257,47 @@ void io_sendmsg_recvmsg_cleanup(struct io_kiocb *req)
 	kfree(io->free_iov);
 }
 
+/* Number of ring buffers a bundle transfer can span */
+#define IO_BUNDLE_MAX_IOVS	16
+
+/*
+ * Select the buffers for a bundle send or receive and set up @iter over them.
+ * Returns the number of buffers selected, or -ENOBUFS.
+ */
+static int io_bundle_import(struct io_kiocb *req, struct iovec *iovs,
+			    size_t max_len, int dir, struct iov_iter *iter,
+			    unsigned int issue_flags)
+{
+	struct buf_sel_arg arg = {
+		.iovs = iovs,
+		.max_len = max_len,
+		.nr_iovs = IO_BUNDLE_MAX_IOVS,
+	};
+	size_t total = 0;
+	int nr, i;
+
+	nr = io_buffers_select(req, &arg, issue_flags);
+	if (!nr)
+		return -ENOBUFS;
+
+	for (i = 0; i < nr; i++)
+		total += iovs[i].iov_len;
+	iov_iter_init(iter, dir, iovs, nr, total);
+	return nr;
+}
+
+/* The number of bundle buffers that a transfer of @ret bytes touched */
+static int io_bundle_nbufs(const struct iovec *iovs, int nr_iovs, int ret)
+{
+	int nbufs = 0;
+
+	while (ret > 0 && nbufs < nr_iovs) {
+		ret -= min_t(size_t, ret, iovs[nbufs].iov_len);
+		nbufs++;
+	}
+	return nbufs;
+}
+
 int io_sendmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
@@ -273,11 +314,18 @@ int io_sendmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	sr->umsg = u64_to_user_ptr(READ_ONCE(sqe->addr));
 	sr->len = READ_ONCE(sqe->len);
 	sr->flags = READ_ONCE(sqe->ioprio);
-	if (sr->flags & ~IORING_RECVSEND_POLL_FIRST)
+	if (sr->flags & ~(IORING_RECVSEND_POLL_FIRST | IORING_RECVSEND_BUNDLE))
 		return -EINVAL;
 	sr->msg_flags = READ_ONCE(sqe->msg_flags) | MSG_NOSIGNAL;
 	if (sr->msg_flags & MSG_DONTWAIT)
 		req->flags |= REQ_F_NOWAIT;
+	if (req->flags & REQ_F_BUFFER_SELECT) {
+		/* a short send completes, the buffers are not retried */
+		if (sr->msg_flags & MSG_WAITALL)
+			return -EINVAL;
+	} else if (sr->flags & IORING_RECVSEND_BUNDLE) {
+		return -EINVAL;
+	}
 
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
@@ -353,9 +401,12 @@ int io_send(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct sockaddr_storage __address;
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
+	struct iovec iovs[IO_BUNDLE_MAX_IOVS];
 	struct msghdr msg;
 	struct socket *sock;
+	unsigned int cflags;
 	unsigned flags;
+	int nr_iovs = 0;
 	int min_ret = 0;
 	int ret;
 
@@ -387,9 +438,26 @@ int io_send(struct io_kiocb *req, unsigned int issue_flags)
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
-	ret = import_ubuf(ITER_SOURCE, sr->buf, sr->len, &msg.msg_iter);
-	if (unlikely(ret))
-		return ret;
+	if (io_do_buffer_select(req) && (sr->flags & IORING_RECVSEND_BUNDLE)) {
+		ret = io_bundle_import(req, iovs, sr->len, ITER_SOURCE,
+				       &msg.msg_iter, issue_flags);
+		if (unlikely(ret < 0))
+			return ret;
+		nr_iovs = ret;
+	} else {
+		size_t len = sr->len;
+		void __user *buf = sr->buf;
+
+		if (io_do_buffer_select(req)) {
+			buf = io_buffer_select(req, &len, issue_flags);
+			if (!buf)
+				return -ENOBUFS;
+		}
+
+		ret = import_ubuf(ITER_SOURCE, buf, len, &msg.msg_iter);
+		if (unlikely(ret))
+			return ret;
+	}
 
 	flags = sr->msg_flags;
 	if (issue_flags & IO_URING_F_NONBLOCK)
@@ -418,7 +486,15 @@ int io_send(struct io_kiocb *req, unsigned int issue_flags)
 		ret += sr->done_io;
 	else if (sr->done_io)
 		ret = sr->done_io;
-	io_req_set_res(req, ret, 0);
+
+	if (ret <= 0)
+		io_kbuf_recycle(req, issue_flags);
+	if (sr->flags & IORING_RECVSEND_BUNDLE)
+		cflags = io_put_kbufs(req, io_bundle_nbufs(iovs, nr_iovs, ret),
+				      issue_flags);
+	else
+		cflags = io_put_kbuf(req, issue_flags);
+	io_req_set_res(req, ret, cflags);
 	return IOU_OK;
 }
 
@@ -562,7 +638,8 @@ int io_recvmsg_prep_async(struct io_kiocb *req)
 	return ret;
 }
 
-#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT)
+#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT | \
+		       IORING_RECVSEND_BUNDLE)
 
 int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
@@ -599,6 +676,14 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		 */
 		sr->buf_group = req->buf_index;
 	}
+	if (sr->flags & IORING_RECVSEND_BUNDLE) {
+		if (req->opcode == IORING_OP_RECVMSG)
+			return -EINVAL;
+		if (!(req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		if (sr->msg_flags & MSG_WAITALL)
+			return -EINVAL;
+	}
 
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
@@ -852,11 +937,13 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
+	struct iovec iovs[IO_BUNDLE_MAX_IOVS];
 	struct msghdr msg;
 	struct socket *sock;
 	unsigned int cflags;
 	unsigned flags;
 	int ret, min_ret = 0;
+	int nr_iovs = 0;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
 	size_t len = sr->len;
 
@@ -872,18 +959,26 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		return -ENOTSOCK;
 
 retry_multishot:
-	if (io_do_buffer_select(req)) {
-		void __user *buf;
+	if (io_do_buffer_select(req) && (sr->flags & IORING_RECVSEND_BUNDLE)) {
+		ret = io_bundle_import(req, iovs, len, ITER_DEST,
+				       &msg.msg_iter, issue_flags);
+		if (unlikely(ret < 0))
+			return ret;
+		nr_iovs = ret;
+	} else {
+		if (io_do_buffer_select(req)) {
+			void __user *buf;
 
-		buf = io_buffer_select(req, &len, issue_flags);
-		if (!buf)
-			return -ENOBUFS;
-		sr->buf = buf;
-	}
+			buf = io_buffer_select(req, &len, issue_flags);
+			if (!buf)
+				return -ENOBUFS;
+			sr->buf = buf;
+		}
 
-	ret = import_ubuf(ITER_DEST, sr->buf, len, &msg.msg_iter);
-	if (unlikely(ret))
-		goto out_free;
+		ret = import_ubuf(ITER_DEST, sr->buf, len, &msg.msg_iter);
+		if (unlikely(ret))
+			goto out_free;
+	}
 
 	msg.msg_name = NULL;
 	msg.msg_namelen = 0;
@@ -932,7 +1027,11 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	cflags = io_put_kbuf(req, issue_flags);
+	if (sr->flags & IORING_RECVSEND_BUNDLE)
+		cflags = io_put_kbufs(req, io_bundle_nbufs(iovs, nr_iovs, ret),
+				      issue_flags);
+	else
+		cflags = io_put_kbuf(req, issue_flags);
 	if (msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
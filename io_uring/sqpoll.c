@@ -17,7 +17,11 @@
 #include "io_uring.h"
 #include "sqpoll.h"
 
+/* per round share of a weight 1 ring when the thread serves several */
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
+#define IORING_SQPOLL_MAX_WEIGHT	32
+/* keep spinning for this many average submission gaps */
+#define IORING_SQPOLL_IDLE_GAPS		4
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
@@ -164,6 +168,57 @@ static inline bool io_sqd_events_pending(struct io_sq_data *sqd)
 	return READ_ONCE(sqd->state);
 }
 
+/*
+ * Track the average submission gap of a ring and derive from it how long
+ * the thread should keep polling after the ring submitted. Spinning well
+ * past the usual gap is wasted, and if the gap is longer than the idle
+ * period the next submission won't be caught by spinning anyway.
+ */
+static void io_sq_update_idle(struct io_ring_ctx *ctx)
+{
+	u64 max_ns = jiffies_to_nsecs(ctx->sq_thread_idle);
+	u64 now = ktime_get_ns();
+	unsigned long idle;
+
+	if (ctx->sq_last_submit_ns) {
+		u64 gap = min(now - ctx->sq_last_submit_ns, 2 * max_ns);
+
+		if (!ctx->sq_avg_gap_ns)
+			ctx->sq_avg_gap_ns = gap;
+		else
+			ctx->sq_avg_gap_ns += (gap >> 3) - (ctx->sq_avg_gap_ns >> 3);
+
+		idle = nsecs_to_jiffies(ctx->sq_avg_gap_ns *
+					IORING_SQPOLL_IDLE_GAPS);
+		if (ctx->sq_avg_gap_ns >= max_ns)
+			ctx->sq_idle = 1;
+		else
+			ctx->sq_idle = clamp_t(unsigned long, idle, 1,
+					       ctx->sq_thread_idle);
+	}
+	ctx->sq_last_submit_ns = now;
+}
+
+/*
+ * Deficit round robin between the rings sharing a thread: every round a
+ * ring with pending SQEs earns a quantum scaled by its weight, and may
+ * carry up to one unused quantum over to the next round.
+ */
+static unsigned int io_sq_fair_share(struct io_ring_ctx *ctx,
+				     unsigned int to_submit)
+{
+	unsigned int quantum;
+
+	if (!to_submit) {
+		ctx->sq_credit = 0;
+		return 0;
+	}
+
+	quantum = READ_ONCE(ctx->sq_weight) * IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	ctx->sq_credit = min(ctx->sq_credit + quantum, 2 * quantum);
+	return min(to_submit, ctx->sq_credit);
+}
+
 static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 {
 	unsigned int to_submit;
@@ -171,8 +226,8 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 
 	to_submit = io_sqring_entries(ctx);
 	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	if (cap_entries)
+		to_submit = io_sq_fair_share(ctx, to_submit);
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -193,6 +248,14 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 			ret = io_submit_sqes(ctx, to_submit);
 		mutex_unlock(&ctx->uring_lock);
 
+		if (ret > 0) {
+			if (cap_entries)
+				ctx->sq_credit -= min_t(unsigned int, ret,
+							ctx->sq_credit);
+			ctx->sq_submitted += ret;
+			io_sq_update_idle(ctx);
+		}
+
 		if (to_submit && wq_has_sleeper(&ctx->sqo_sq_wait))
 			wake_up(&ctx->sqo_sq_wait);
 		if (creds)
@@ -222,7 +285,7 @@ static int io_sq_thread(void *data)
 {
 	struct io_sq_data *sqd = data;
 	struct io_ring_ctx *ctx;
-	unsigned long timeout = 0;
+	unsigned long timeout = 0, idle = sqd->sq_thread_idle;
 	char buf[TASK_COMM_LEN];
 	DEFINE_WAIT(wait);
 
@@ -241,22 +304,24 @@ static int io_sq_thread(void *data)
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = jiffies + idle;
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
+		idle = 0;
 		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 			int ret = __io_sq_thread(ctx, cap_entries);
 
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
+			idle = max(idle, ctx->sq_idle);
 		}
 		if (io_run_task_work())
 			sqt_spin = true;
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+				timeout = jiffies + idle;
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
 				cond_resched();
@@ -301,7 +366,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = jiffies + idle;
 	}
 
 	io_uring_cancel_generic(true, sqd);
@@ -315,6 +380,21 @@ static int io_sq_thread(void *data)
 	do_exit(0);
 }
 
+int io_sqpoll_set_weight(struct io_ring_ctx *ctx, void __user *arg)
+{
+	u32 weight;
+
+	if (!(ctx->flags & IORING_SETUP_SQPOLL))
+		return -EINVAL;
+	if (copy_from_user(&weight, arg, sizeof(weight)))
+		return -EFAULT;
+	if (!weight || weight > IORING_SQPOLL_MAX_WEIGHT)
+		return -EINVAL;
+
+	WRITE_ONCE(ctx->sq_weight, weight);
+	return 0;
+}
+
 void io_sqpoll_wait_sq(struct io_ring_ctx *ctx)
 {
 	DEFINE_WAIT(wait);
@@ -371,6 +451,8 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
+		ctx->sq_idle = ctx->sq_thread_idle;
+		ctx->sq_weight = 1;
 
 		io_sq_thread_park(sqd);
 		list_add(&ctx->sqd_list, &sqd->ctx_list);
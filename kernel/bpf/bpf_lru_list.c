@@ -439,7 +439,7 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 	struct bpf_lru_locallist *loc_l, *steal_loc_l;
 	struct bpf_common_lru *clru = &lru->common_lru;
 	struct bpf_lru_node *node;
-	int steal, first_steal;
+	int steal, first_steal, pass;
 	unsigned long flags;
 	int cpu = raw_smp_processor_id();
 
@@ -467,23 +467,38 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 	 * Steal from the local free/pending list of the
 	 * current CPU and remote CPU in RR.  It starts
 	 * with the loc_l->next_steal CPU.
+	 *
+	 * When the map is full every CPU updating it ends up
+	 * here at the same time.  The first pass skips local
+	 * lists whose lock is held instead of convoying behind
+	 * them, only the second pass waits.
 	 */
 
 	first_steal = loc_l->next_steal;
 	steal = first_steal;
-	do {
-		steal_loc_l = per_cpu_ptr(clru->local_list, steal);
-
-		raw_spin_lock_irqsave(&steal_loc_l->lock, flags);
-
-		node = __local_list_pop_free(steal_loc_l);
-		if (!node)
-			node = __local_list_pop_pending(lru, steal_loc_l);
-
-		raw_spin_unlock_irqrestore(&steal_loc_l->lock, flags);
-
-		steal = get_next_cpu(steal);
-	} while (!node && steal != first_steal);
+	for (pass = 0; !node && pass < 2; pass++) {
+		do {
+			steal_loc_l = per_cpu_ptr(clru->local_list, steal);
+
+			if (pass) {
+				raw_spin_lock_irqsave(&steal_loc_l->lock,
+						      flags);
+			} else if (!raw_spin_trylock_irqsave(&steal_loc_l->lock,
+							     flags)) {
+				steal = get_next_cpu(steal);
+				continue;
+			}
+
+			node = __local_list_pop_free(steal_loc_l);
+			if (!node)
+				node = __local_list_pop_pending(lru,
+								steal_loc_l);
+
+			raw_spin_unlock_irqrestore(&steal_loc_l->lock, flags);
+
+			steal = get_next_cpu(steal);
+		} while (!node && steal != first_steal);
+	}
 
 	loc_l->next_steal = steal;
 
@@ -38,10 +38,16 @@ struct bpf_ringbuf {
 	u64 mask;
 	struct page **pages;
 	int nr_pages;
-	spinlock_t spinlock ____cacheline_aligned_in_smp;
+	/* Kernel producers claim space by advancing reserve_pos with a
+	 * cmpxchg(), then publish it by advancing producer_pos in the order the
+	 * space was claimed. Claiming and publishing happen with IRQs disabled
+	 * and only a handful of stores apart, so producers waiting for earlier
+	 * ones to publish spin very briefly.
+	 */
+	unsigned long reserve_pos ____cacheline_aligned_in_smp;
 	/* For user-space producer ring buffers, an atomic_t busy bit is used
 	 * to synchronize access to the ring buffers in the kernel, rather than
-	 * the spinlock that is used for kernel-producer ring buffers. This is
+	 * the lockless reservation used for kernel producers. This is
 	 * done because the ring buffer must hold a lock across a BPF program's
 	 * callback:
 	 *
@@ -169,7 +175,7 @@ static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 	if (!rb)
 		return NULL;
 
-	spin_lock_init(&rb->spinlock);
+	rb->reserve_pos = 0;
 	atomic_set(&rb->busy, 0);
 	init_waitqueue_head(&rb->waitq);
 	init_irq_work(&rb->work, bpf_ringbuf_notify);
@@ -421,35 +427,48 @@ static void *__bpf_ringbuf_reserve(struct bpf_ringbuf *rb, u64 size)
 
 	cons_pos = smp_load_acquire(&rb->consumer_pos);
 
-	if (in_nmi()) {
-		if (!spin_trylock_irqsave(&rb->spinlock, flags))
-			return NULL;
-	} else {
-		spin_lock_irqsave(&rb->spinlock, flags);
-	}
+	local_irq_save(flags);
 
-	prod_pos = rb->producer_pos;
-	new_prod_pos = prod_pos + len;
+	prod_pos = READ_ONCE(rb->reserve_pos);
+	do {
+		new_prod_pos = prod_pos + len;
 
-	/* check for out of ringbuf space by ensuring producer position
-	 * doesn't advance more than (ringbuf_size - 1) ahead
-	 */
-	if (new_prod_pos - cons_pos > rb->mask) {
-		spin_unlock_irqrestore(&rb->spinlock, flags);
-		return NULL;
-	}
+		/* check for out of ringbuf space by ensuring producer position
+		 * doesn't advance more than (ringbuf_size - 1) ahead
+		 */
+		if (new_prod_pos - cons_pos > rb->mask)
+			goto fail;
+
+		/* An NMI may have interrupted a producer on this CPU between
+		 * claiming and publishing, and would wait for it forever. Only
+		 * claim space when nothing is pending; if the cmpxchg() below
+		 * succeeds nothing was claimed in between either.
+		 */
+		if (in_nmi() && prod_pos != READ_ONCE(rb->producer_pos))
+			goto fail;
+	} while (!try_cmpxchg(&rb->reserve_pos, &prod_pos, new_prod_pos));
 
 	hdr = (void *)rb->data + (prod_pos & rb->mask);
 	pg_off = bpf_ringbuf_rec_pg_off(rb, hdr);
 	hdr->len = size | BPF_RINGBUF_BUSY_BIT;
 	hdr->pg_off = pg_off;
 
+	/* the consumer stops at the first busy record, so records must become
+	 * visible in reservation order
+	 */
+	while (smp_load_acquire(&rb->producer_pos) != prod_pos)
+		cpu_relax();
+
 	/* pairs with consumer's smp_load_acquire() */
 	smp_store_release(&rb->producer_pos, new_prod_pos);
 
-	spin_unlock_irqrestore(&rb->spinlock, flags);
+	local_irq_restore(flags);
 
 	return (void *)hdr + BPF_RINGBUF_HDR_SZ;
+
+fail:
+	local_irq_restore(flags);
+	return NULL;
 }
 
 BPF_CALL_3(bpf_ringbuf_reserve, struct bpf_map *, map, u64, size, u64, flags)
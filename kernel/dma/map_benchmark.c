@@ -16,6 +16,7 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 
@@ -38,12 +39,26 @@ static int map_benchmark_thread(void *data)
 	struct map_benchmark_data *map = data;
 	int npages = map->bparam.granule;
 	u64 size = npages * PAGE_SIZE;
+	bool sg_mode = map->bparam.map_mode == DMA_MAP_SG_MODE;
+	struct scatterlist *sgl = NULL;
 	int ret = 0;
+	int i;
 
 	buf = alloc_pages_exact(size, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
 
+	if (sg_mode) {
+		sgl = kcalloc(npages, sizeof(*sgl), GFP_KERNEL);
+		if (!sgl) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		sg_init_table(sgl, npages);
+		for (i = 0; i < npages; i++)
+			sg_set_buf(&sgl[i], buf + i * PAGE_SIZE, PAGE_SIZE);
+	}
+
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
 		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
@@ -59,12 +74,22 @@ static int map_benchmark_thread(void *data)
 			memset(buf, 0x66, size);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
-			goto out;
+		if (sg_mode) {
+			if (unlikely(!dma_map_sg(map->dev, sgl, npages,
+						 map->dir))) {
+				pr_err("dma_map_sg failed on %s\n",
+					dev_name(map->dev));
+				ret = -ENOMEM;
+				goto out;
+			}
+		} else {
+			dma_addr = dma_map_single(map->dev, buf, size, map->dir);
+			if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
+				pr_err("dma_map_single failed on %s\n",
+					dev_name(map->dev));
+				ret = -ENOMEM;
+				goto out;
+			}
 		}
 		map_etime = ktime_get();
 		map_delta = ktime_sub(map_etime, map_stime);
@@ -73,7 +98,10 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		if (sg_mode)
+			dma_unmap_sg(map->dev, sgl, npages, map->dir);
+		else
+			dma_unmap_single(map->dev, dma_addr, size, map->dir);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -92,6 +120,7 @@ static int map_benchmark_thread(void *data)
 	}
 
 out:
+	kfree(sgl);
 	free_pages_exact(buf, size);
 	return ret;
 }
@@ -147,6 +176,7 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	}
 
 	loops = atomic64_read(&map->loops);
+	map->bparam.loops = loops;
 	if (likely(loops > 0)) {
 		u64 map_variance, unmap_variance;
 		u64 sum_map = atomic64_read(&map->sum_map_100ns);
@@ -218,6 +248,12 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if (map->bparam.map_mode != DMA_MAP_SINGLE_MODE &&
+		    map->bparam.map_mode != DMA_MAP_SG_MODE) {
+			pr_err("invalid map mode\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -183,6 +183,127 @@ void dma_unmap_page_attrs(struct device *dev, dma_addr_t addr, size_t size,
 }
 EXPORT_SYMBOL(dma_unmap_page_attrs);
 
+static bool dma_batch_supported(struct device *dev,
+		const struct dma_map_ops *ops)
+{
+	return !dma_map_direct(dev, ops) &&
+	       !IS_ENABLED(CONFIG_ARCH_HAS_DMA_MAP_DIRECT);
+}
+
+/**
+ * dma_map_page_batch - map several pages at once
+ * @dev: device to map the pages for
+ * @pages: pages to map, from offset 0
+ * @addrs: returns the DMA address of each page, or DMA_MAPPING_ERROR
+ * @nr: number of entries in @pages and @addrs
+ * @size: number of bytes to map from each page
+ * @dir: DMA direction
+ * @attrs: DMA attributes
+ *
+ * Equivalent to calling dma_map_page_attrs() on each page, but lets an IOMMU
+ * make all the new mappings visible with a single TLB maintenance operation.
+ * Returns the number of pages that were mapped; the others have to be
+ * checked for with dma_mapping_error().
+ */
+unsigned int dma_map_page_batch(struct device *dev, struct page **pages,
+		dma_addr_t *addrs, unsigned int nr, size_t size,
+		enum dma_data_direction dir, unsigned long attrs)
+{
+	const struct dma_map_ops *ops = get_dma_ops(dev);
+	unsigned int i, mapped = 0;
+
+	BUG_ON(!valid_dma_direction(dir));
+
+	if (WARN_ON_ONCE(!dev->dma_mask))
+		return 0;
+
+	if (!dma_batch_supported(dev, ops) || !ops->map_page_batch) {
+		for (i = 0; i < nr; i++) {
+			addrs[i] = dma_map_page_attrs(dev, pages[i], 0, size,
+						      dir, attrs);
+			if (addrs[i] != DMA_MAPPING_ERROR)
+				mapped++;
+		}
+		return mapped;
+	}
+
+	ops->map_page_batch(dev, pages, addrs, nr, size, dir, attrs);
+	for (i = 0; i < nr; i++) {
+		kmsan_handle_dma(pages[i], 0, size, dir);
+		debug_dma_map_page(dev, pages[i], 0, size, dir, addrs[i],
+				   attrs);
+		if (addrs[i] != DMA_MAPPING_ERROR)
+			mapped++;
+	}
+	return mapped;
+}
+EXPORT_SYMBOL_GPL(dma_map_page_batch);
+
+/**
+ * dma_unmap_batch_add - queue the unmap of a page mapping
+ * @batch: batch initialised with dma_unmap_batch_init()
+ * @dev: device the mapping was made for
+ * @addr: DMA address returned by dma_map_page_attrs()
+ * @size: size of the mapping
+ * @dir: DMA direction
+ * @attrs: DMA attributes
+ *
+ * The mapping is torn down by the next dma_unmap_batch_flush(), together with
+ * all other mappings in @batch, so that an IOMMU only has to invalidate its
+ * TLB once.  The memory must not be reused before the batch is flushed.
+ * Mappings that do not need an IOMMU are unmapped immediately.
+ */
+void dma_unmap_batch_add(struct dma_unmap_batch *batch, struct device *dev,
+		dma_addr_t addr, size_t size, enum dma_data_direction dir,
+		unsigned long attrs)
+{
+	const struct dma_map_ops *ops = get_dma_ops(dev);
+
+	if (!dma_batch_supported(dev, ops) || !ops->unmap_page_batch) {
+		dma_unmap_page_attrs(dev, addr, size, dir, attrs);
+		return;
+	}
+
+	BUG_ON(!valid_dma_direction(dir));
+	if (batch->nr &&
+	    (batch->dev != dev || batch->dir != dir || batch->attrs != attrs))
+		dma_unmap_batch_flush(batch);
+
+	batch->dev = dev;
+	batch->dir = dir;
+	batch->attrs = attrs;
+	batch->addr[batch->nr] = addr;
+	batch->size[batch->nr] = size;
+	if (++batch->nr == DMA_UNMAP_BATCH_SIZE)
+		dma_unmap_batch_flush(batch);
+}
+EXPORT_SYMBOL_GPL(dma_unmap_batch_add);
+
+/**
+ * dma_unmap_batch_flush - unmap everything queued in a batch
+ * @batch: batch to flush
+ *
+ * After this returns the device can no longer access any of the memory that
+ * was queued in @batch, and @batch is empty again.
+ */
+void dma_unmap_batch_flush(struct dma_unmap_batch *batch)
+{
+	const struct dma_map_ops *ops;
+	unsigned int i;
+
+	if (!batch->nr)
+		return;
+
+	ops = get_dma_ops(batch->dev);
+	ops->unmap_page_batch(batch->dev, batch->addr, batch->size, batch->nr,
+			      batch->dir, batch->attrs);
+	for (i = 0; i < batch->nr; i++)
+		debug_dma_unmap_page(batch->dev, batch->addr[i],
+				     batch->size[i], batch->dir);
+	batch->nr = 0;
+}
+EXPORT_SYMBOL_GPL(dma_unmap_batch_flush);
+
 static int __dma_map_sg_attrs(struct device *dev, struct scatterlist *sg,
 	 int nents, enum dma_data_direction dir, unsigned long attrs)
 {
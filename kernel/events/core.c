@@ -10347,6 +10347,43 @@ static void perf_event_free_filter(struct perf_event *event)
 }
 
 #ifdef CONFIG_BPF_SYSCALL
+/*
+ * Prepare only the parts of a sample that a BPF program can look at:
+ * the callchain used by bpf_get_stack{,id}(), the branch stack used by
+ * bpf_read_branch_records() and the address in bpf_perf_event_data.
+ *
+ * Profilers that aggregate stacks in a BPF map and return 0 never need
+ * anything else, so perf_prepare_sample() fills in the rest of the
+ * sample only when the program asks for it to be output.  That skips the
+ * user register and stack copies, page size lookups and the like on
+ * every sample that stays in the kernel.
+ *
+ * Programs that can reach the whole perf_sample_data through
+ * bpf_cast_to_kern_ctx() or bpf_rdonly_cast(), or that tail call into a
+ * program that might, get the full perf_prepare_sample() instead.
+ */
+static void perf_prepare_sample_bpf(struct perf_sample_data *data,
+				    struct perf_event *event,
+				    struct pt_regs *regs,
+				    struct bpf_prog *prog)
+{
+	u64 sample_type = event->attr.sample_type & ~data->sample_flags;
+
+	if ((sample_type & PERF_SAMPLE_CALLCHAIN) && prog->call_get_stack)
+		perf_sample_save_callchain(data, event, regs);
+
+	if (sample_type & PERF_SAMPLE_BRANCH_STACK) {
+		data->br_stack = NULL;
+		data->dyn_size += sizeof(u64);
+		data->sample_flags |= PERF_SAMPLE_BRANCH_STACK;
+	}
+
+	if (sample_type & PERF_SAMPLE_ADDR) {
+		data->addr = 0;
+		data->sample_flags |= PERF_SAMPLE_ADDR;
+	}
+}
+
 static void bpf_overflow_handler(struct perf_event *event,
 				 struct perf_sample_data *data,
 				 struct pt_regs *regs)
@@ -10364,7 +10401,10 @@ static void bpf_overflow_handler(struct perf_event *event,
 	rcu_read_lock();
 	prog = READ_ONCE(event->prog);
 	if (prog) {
-		perf_prepare_sample(data, event, regs);
+		if (prog->kern_ctx_access)
+			perf_prepare_sample(data, event, regs);
+		else
+			perf_prepare_sample_bpf(data, event, regs, prog);
 		ret = bpf_prog_run(prog, &ctx);
 	}
 	rcu_read_unlock();
@@ -36,6 +36,7 @@
 #include <linux/pagemap.h>
 #include <linux/memblock.h>
 #include <linux/fault-inject.h>
+#include <linux/prctl.h>
 #include <linux/slab.h>
 
 #include "futex.h"
@@ -53,6 +54,17 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+/*
+ * Optional per-mm hash for process private futexes, see
+ * PR_FUTEX_HASH_SET_SLOTS. Once installed it lives as long as the mm.
+ */
+struct futex_private_hash {
+	unsigned int			hash_mask;
+	struct futex_hash_bucket	queues[];
+};
+
+#define FUTEX_PRIVATE_HASH_MAX	(1U << 16)
+
 
 /*
  * Fault injections for futexes.
@@ -110,16 +122,115 @@ late_initcall(fail_futex_debugfs);
  * @key:	Pointer to the futex key for which the hash is calculated
  *
  * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * corresponding hash bucket in the global hash, or in the private hash of the
+ * futex's mm for process private futexes when the process installed one.
  */
 struct futex_hash_bucket *futex_hash(union futex_key *key)
 {
 	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
 			  key->both.offset);
 
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED)) &&
+	    key->private.mm) {
+		struct futex_private_hash *fph;
+
+		fph = READ_ONCE(key->private.mm->futex_phash);
+		if (fph)
+			return &fph->queues[hash & fph->hash_mask];
+	}
+
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
+static void futex_hash_bucket_init(struct futex_hash_bucket *fhb)
+{
+	atomic_set(&fhb->waiters, 0);
+	plist_head_init(&fhb->chain);
+	spin_lock_init(&fhb->lock);
+}
+
+/*
+ * io_uring keeps IORING_OP_FUTEX_WAIT requests queued without a task
+ * sleeping on them, so being the sole user of the mm doesn't rule out
+ * waiters once the task has used io_uring.
+ */
+static bool futex_hash_may_have_async_waiters(void)
+{
+#ifdef CONFIG_IO_URING
+	return current->io_uring;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Switching hashes while futexes are queued would strand the waiters in the
+ * old buckets, so a private hash can only be installed while the caller is
+ * the sole user of its mm, i.e. before it creates threads or CLONE_VM
+ * children, and before it uses io_uring.
+ */
+static int futex_hash_allocate(unsigned int slots)
+{
+	struct mm_struct *mm = current->mm;
+	struct futex_private_hash *fph;
+	unsigned int i;
+
+	if (!slots)
+		return mm->futex_phash ? -EBUSY : 0;
+
+	if (slots < 2 || slots > FUTEX_PRIVATE_HASH_MAX || !is_power_of_2(slots))
+		return -EINVAL;
+
+	if (mm->futex_phash || atomic_read(&mm->mm_users) != 1 ||
+	    futex_hash_may_have_async_waiters())
+		return -EBUSY;
+
+	fph = kvzalloc(struct_size(fph, queues, slots), GFP_KERNEL_ACCOUNT);
+	if (!fph)
+		return -ENOMEM;
+
+	fph->hash_mask = slots - 1;
+	for (i = 0; i < slots; i++)
+		futex_hash_bucket_init(&fph->queues[i]);
+
+	smp_store_release(&mm->futex_phash, fph);
+	return 0;
+}
+
+int futex_hash_prctl(unsigned long arg2, unsigned long arg3,
+		     unsigned long arg4)
+{
+	struct futex_private_hash *fph;
+
+	switch (arg2) {
+	case PR_FUTEX_HASH_SET_SLOTS:
+		if (arg4 || arg3 > UINT_MAX)
+			return -EINVAL;
+		return futex_hash_allocate(arg3);
+
+	case PR_FUTEX_HASH_GET_SLOTS:
+		if (arg3 || arg4)
+			return -EINVAL;
+		fph = READ_ONCE(current->mm->futex_phash);
+		return fph ? fph->hash_mask + 1 : 0;
+
+	default:
+		return -EINVAL;
+	}
+}
+
+void futex_mm_init(struct mm_struct *mm)
+{
+	mm->futex_phash = NULL;
+}
+
+/* Called once the last user of @mm is gone, no futex can be queued. */
+void futex_mm_free(struct mm_struct *mm)
+{
+	kvfree(mm->futex_phash);
+	mm->futex_phash = NULL;
+}
+
 
 /**
  * futex_setup_timer - set up the sleeping hrtimer.
@@ -1138,11 +1249,8 @@ static int __init futex_init(void)
 					       futex_hashsize, futex_hashsize);
 	futex_hashsize = 1UL << futex_shift;
 
-	for (i = 0; i < futex_hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	for (i = 0; i < futex_hashsize; i++)
+		futex_hash_bucket_init(&futex_queues[i]);
 
 	return 0;
 }
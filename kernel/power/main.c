@@ -111,7 +111,11 @@ int pm_notifier_call_chain(unsigned long val)
 	return blocking_notifier_call_chain(&pm_chain_head, val, NULL);
 }
 
-/* If set, devices may be suspended and resumed asynchronously. */
+/*
+ * If set, devices may be suspended and resumed asynchronously. With 2, devices
+ * whose firmware-described dependencies are all represented by device links
+ * are handled asynchronously even if their drivers did not opt in.
+ */
 int pm_async_enabled = 1;
 
 static ssize_t pm_async_show(struct kobject *kobj, struct kobj_attribute *attr,
@@ -128,7 +132,7 @@ static ssize_t pm_async_store(struct kobject *kobj, struct kobj_attribute *attr,
 	if (kstrtoul(buf, 10, &val))
 		return -EINVAL;
 
-	if (val > 1)
+	if (val > 2)
 		return -EINVAL;
 
 	pm_async_enabled = val;
@@ -13,6 +13,7 @@
 #include <linux/delay.h>
 #include <linux/errno.h>
 #include <linux/init.h>
+#include <linux/interrupt.h>
 #include <linux/console.h>
 #include <linux/cpu.h>
 #include <linux/cpuidle.h>
@@ -117,6 +118,104 @@ static void s2idle_enter(void)
 	trace_suspend_resume(TPS("machine_suspend"), PM_SUSPEND_TO_IDLE, false);
 }
 
+/*
+ * Dark wake: drivers can claim a wakeup IRQ whose events they are able to
+ * service from the s2idle loop, with all devices still suspended, e.g. RTC or
+ * battery housekeeping. If the handler reports that no full resume is needed,
+ * the wakeup is cancelled and the system goes back to idle right away.
+ *
+ * The list is only modified under system_transition_mutex, which is held for
+ * the whole suspend transition, so s2idle_loop() can walk it without locking.
+ */
+struct s2idle_dark_wake {
+	struct list_head node;
+	unsigned int irq;
+	bool (*handler)(void *data);
+	void *data;
+};
+
+static LIST_HEAD(s2idle_dark_wake_list);
+
+/**
+ * s2idle_register_dark_wake - Service a wakeup IRQ without leaving s2idle.
+ * @irq: Wakeup IRQ to claim.
+ * @handler: Called with interrupts enabled from the s2idle loop when @irq was
+ *	     the wakeup source; devices are still suspended at that point.
+ *	     Returns true if the event was fully handled and the system can go
+ *	     back to sleep, false to resume as usual.
+ * @data: Argument passed to @handler.
+ */
+int s2idle_register_dark_wake(unsigned int irq, bool (*handler)(void *data),
+			      void *data)
+{
+	struct s2idle_dark_wake *dw;
+	unsigned int sleep_flags;
+
+	dw = kzalloc(sizeof(*dw), GFP_KERNEL);
+	if (!dw)
+		return -ENOMEM;
+
+	dw->irq = irq;
+	dw->handler = handler;
+	dw->data = data;
+
+	sleep_flags = lock_system_sleep();
+	list_add_tail(&dw->node, &s2idle_dark_wake_list);
+	unlock_system_sleep(sleep_flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(s2idle_register_dark_wake);
+
+/**
+ * s2idle_unregister_dark_wake - Undo s2idle_register_dark_wake().
+ * @irq: Wakeup IRQ passed to s2idle_register_dark_wake().
+ * @data: Handler argument passed to s2idle_register_dark_wake().
+ */
+void s2idle_unregister_dark_wake(unsigned int irq, void *data)
+{
+	struct s2idle_dark_wake *dw, *tmp;
+	unsigned int sleep_flags;
+
+	sleep_flags = lock_system_sleep();
+	list_for_each_entry_safe(dw, tmp, &s2idle_dark_wake_list, node) {
+		if (dw->irq == irq && dw->data == data) {
+			list_del(&dw->node);
+			kfree(dw);
+			break;
+		}
+	}
+	unlock_system_sleep(sleep_flags);
+}
+EXPORT_SYMBOL_GPL(s2idle_unregister_dark_wake);
+
+static bool s2idle_dark_wake(void)
+{
+	unsigned int irq = pm_wakeup_irq();
+	struct s2idle_dark_wake *dw;
+
+	if (!irq)
+		return false;
+
+	list_for_each_entry(dw, &s2idle_dark_wake_list, node) {
+		if (dw->irq != irq)
+			continue;
+
+		if (!dw->handler(dw->data))
+			return false;
+
+		pm_pr_dbg("dark wake from IRQ %u\n", irq);
+		trace_suspend_resume(TPS("dark_wake"), irq, true);
+
+		pm_system_cancel_wakeup();
+		pm_wakeup_clear(irq);
+		rearm_wake_irq(irq);
+		return true;
+	}
+
+	return false;
+}
+
 static void s2idle_loop(void)
 {
 	pm_pr_dbg("suspend-to-idle\n");
@@ -134,6 +233,8 @@ static void s2idle_loop(void)
 		if (s2idle_ops && s2idle_ops->wake) {
 			if (s2idle_ops->wake())
 				break;
+		} else if (!pm_wakeup_events_pending() && s2idle_dark_wake()) {
+			/* Serviced without resuming devices, go back to idle. */
 		} else if (pm_wakeup_pending()) {
 			break;
 		}
@@ -525,8 +525,12 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 			             LZO_HEADER, PAGE_SIZE)
 #define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
 
-/* Maximum number of threads for compression/decompression. */
-#define LZO_THREADS	3
+/*
+ * Maximum number of threads for compression/decompression. The number actually
+ * used is scaled with the online CPUs, leaving one for I/O and the CRC thread.
+ * Each thread carries roughly 2 * LZO_UNC_SIZE worth of buffers.
+ */
+#define LZO_THREADS	8
 
 /* Minimum/maximum number of pages for read buffering. */
 #define LZO_MIN_RD_PAGES	1024
@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -2263,6 +2264,28 @@ int vprintk_store(int facility, int level,
 	return ret;
 }
 
+/*
+ * With printk.threaded=1, printk() callers only store the record and a
+ * kthread prints it to the consoles, so a slow console doesn't stall them.
+ * Printing is done directly again when the system is going down and the
+ * kthread may never get to run.
+ */
+static bool printk_threaded;
+module_param_named(threaded, printk_threaded, bool, 0444);
+
+static struct task_struct *printk_kthread;
+static DECLARE_WAIT_QUEUE_HEAD(printk_kthread_wait);
+static atomic_t printk_kthread_pending = ATOMIC_INIT(0);
+
+static bool printk_use_kthread(void)
+{
+	if (!READ_ONCE(printk_kthread))
+		return false;
+
+	return !oops_in_progress && !panic_in_progress() &&
+	       system_state <= SYSTEM_RUNNING;
+}
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const struct dev_printk_info *dev_info,
 			    const char *fmt, va_list args)
@@ -2287,6 +2310,12 @@ asmlinkage int vprintk_emit(int facility, int level,
 
 	printed_len = vprintk_store(facility, level, dev_info, fmt, args);
 
+	/* The kthread is woken via irq_work, which is safe from any context. */
+	if (printk_use_kthread()) {
+		defer_console_output();
+		return printed_len;
+	}
+
 	/* If called from the scheduler, we can not call up(). */
 	if (!in_sched) {
 		/*
@@ -3748,6 +3777,45 @@ static bool pr_flush(int timeout_ms, bool reset_on_progress)
 	return __pr_flush(NULL, timeout_ms, reset_on_progress);
 }
 
+static int printk_kthread_func(void *unused)
+{
+	for (;;) {
+		wait_event_interruptible(printk_kthread_wait,
+					 atomic_read(&printk_kthread_pending));
+		atomic_set(&printk_kthread_pending, 0);
+
+		/*
+		 * console_unlock() prints every pending record to every
+		 * console, and may reschedule in between since console_lock()
+		 * was used to take the lock.
+		 */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	if (!printk_threaded)
+		return 0;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "pr/consoles");
+	if (IS_ERR(tsk)) {
+		pr_err("failed to start printing thread, printing directly\n");
+		return PTR_ERR(tsk);
+	}
+	WRITE_ONCE(printk_kthread, tsk);
+
+	/* Anything stored since the last direct flush is printed now. */
+	defer_console_output();
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 /*
  * Delayed printk version, for scheduler-internal messages:
  */
@@ -3761,9 +3829,13 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
-		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (printk_use_kthread()) {
+			atomic_set(&printk_kthread_pending, 1);
+			wake_up_interruptible(&printk_kthread_wait);
+		} else if (console_trylock()) {
+			/* If trylock fails, someone else is printing */
 			console_unlock();
+		}
 	}
 
 	if (pending & PRINTK_PENDING_WAKEUP)
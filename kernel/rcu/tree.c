@@ -2597,6 +2597,210 @@ static void check_cb_ovld(struct rcu_data *rdp)
 	raw_spin_unlock_rcu_node(rnp);
 }
 
+/*
+ * LAZY_FLUSH_JIFFIES decides the maximum amount of time that
+ * can elapse before lazy callbacks are flushed. Lazy callbacks
+ * could be flushed much earlier for a number of other reasons
+ * however, LAZY_FLUSH_JIFFIES will ensure no lazy callbacks are
+ * left unsubmitted to RCU after those many jiffies.
+ */
+#if defined(CONFIG_RCU_NOCB_CPU) || defined(CONFIG_RCU_LAZY)
+#define LAZY_FLUSH_JIFFIES (10 * HZ)
+static unsigned long jiffies_till_flush = LAZY_FLUSH_JIFFIES;
+#endif
+
+#ifdef CONFIG_RCU_LAZY
+// To be called only from test code.
+void rcu_lazy_set_jiffies_till_flush(unsigned long jif)
+{
+	jiffies_till_flush = jif;
+}
+EXPORT_SYMBOL(rcu_lazy_set_jiffies_till_flush);
+
+unsigned long rcu_lazy_get_jiffies_till_flush(void)
+{
+	return jiffies_till_flush;
+}
+EXPORT_SYMBOL(rcu_lazy_get_jiffies_till_flush);
+
+/*
+ * Lazy callbacks on CPUs that are not offloaded are held back on
+ * ->lazy_cblist, where they do not count as pending callbacks and
+ * therefore neither request a grace period nor keep the scheduling-clock
+ * tick alive.  They are moved over to ->cblist once they have waited
+ * jiffies_till_flush, once qhimark of them have piled up, under memory
+ * pressure, or as soon as a non-lazy callback is queued on that CPU and
+ * thus requests a grace period anyway.  Offloaded CPUs keep using the
+ * ->nocb_bypass list for the same purpose.
+ *
+ * The ->lazy_cblist is only ever accessed by its own CPU with interrupts
+ * disabled, or on behalf of that CPU once it is offline.
+ */
+static long rcu_lazy_n_cbs(struct rcu_data *rdp)
+{
+	return rcu_cblist_n_cbs(&rdp->lazy_cblist);
+}
+
+/*
+ * Move all of the lazy callbacks over to the new-callbacks segment of
+ * ->cblist.  The caller must hold off any concurrent access to ->cblist.
+ */
+static void rcu_lazy_flush(struct rcu_data *rdp, const char *reason)
+{
+	long len = rcu_lazy_n_cbs(rdp);
+
+	rcu_lockdep_assert_cblist_protected(rdp);
+	if (!len)
+		return;
+	rcu_segcblist_add_len(&rdp->cblist, len); /* Must precede insert. */
+	rcu_segcblist_insert_pend_cbs(&rdp->cblist, &rdp->lazy_cblist);
+	rcu_cblist_init(&rdp->lazy_cblist);
+	del_timer(&rdp->lazy_timer);
+	trace_rcu_lazy(rcu_state.name, rdp->cpu, len, reason);
+}
+
+/*
+ * Flush the lazy callbacks of the current CPU and request the grace
+ * period that they now need.  Interrupts must be disabled.
+ */
+static void rcu_lazy_flush_gp(struct rcu_data *rdp, const char *reason)
+{
+	if (rdp->cpu != smp_processor_id() || rcu_rdp_is_offloaded(rdp) ||
+	    !rcu_lazy_n_cbs(rdp))
+		return; // Flushed by rcutree_migrate_callbacks() or offloading.
+	rcu_lazy_flush(rdp, reason);
+	rcu_accelerate_cbs_unlocked(rdp->mynode, rdp);
+}
+
+static void rcu_lazy_timer_func(struct timer_list *t)
+{
+	unsigned long flags;
+	struct rcu_data *rdp = from_timer(rdp, t, lazy_timer);
+
+	local_irq_save(flags);
+	rcu_lazy_flush_gp(rdp, TPS("Timer"));
+	local_irq_restore(flags);
+}
+
+static void rcu_lazy_iw_handler(struct irq_work *iwp)
+{
+	struct rcu_data *rdp = container_of(iwp, struct rcu_data, lazy_iw);
+
+	lockdep_assert_irqs_disabled();
+	rcu_lazy_flush_gp(rdp, TPS("Shrink"));
+}
+
+/*
+ * Queue a lazy callback onto ->lazy_cblist of a CPU that is not offloaded,
+ * returning true if it was queued there.  Otherwise the caller must queue
+ * the callback onto ->cblist, and any lazy callbacks have already been
+ * flushed ahead of it so that they share its grace period.
+ */
+static bool rcu_lazy_enqueue(struct rcu_data *rdp, struct rcu_head *rhp,
+			     bool lazy)
+{
+	long len;
+
+	if (rcu_rdp_is_offloaded(rdp))
+		return false; // Offloaded CPUs use ->nocb_bypass instead.
+	len = rcu_lazy_n_cbs(rdp);
+	if (!lazy || rcu_scheduler_active == RCU_SCHEDULER_INACTIVE ||
+	    cpu_is_offline(smp_processor_id())) {
+		rcu_lazy_flush(rdp, TPS("Hurry"));
+		return false;
+	}
+	if (len >= qhimark) {
+		rcu_lazy_flush(rdp, TPS("Qlen"));
+		return false;
+	}
+	rcu_cblist_enqueue(&rdp->lazy_cblist, rhp);
+	if (!len)
+		mod_timer(&rdp->lazy_timer, jiffies + jiffies_till_flush);
+	trace_rcu_lazy(rcu_state.name, rdp->cpu, len + 1, TPS("Queued"));
+	return true;
+}
+
+static unsigned long
+rcu_lazy_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
+{
+	int cpu;
+	unsigned long count = 0;
+
+	for_each_possible_cpu(cpu)
+		count += rcu_lazy_n_cbs(per_cpu_ptr(&rcu_data, cpu));
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+static unsigned long
+rcu_lazy_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
+{
+	int cpu;
+	unsigned long count = 0;
+
+	for_each_possible_cpu(cpu) {
+		struct rcu_data *rdp = per_cpu_ptr(&rcu_data, cpu);
+		long _count = rcu_lazy_n_cbs(rdp);
+
+		if (!_count)
+			continue;
+		/* Disabling preemption holds off the CPU going offline. */
+		preempt_disable();
+		if (cpu_online(cpu))
+			irq_work_queue_on(&rdp->lazy_iw, cpu);
+		preempt_enable();
+		sc->nr_to_scan -= _count;
+		count += _count;
+		if (sc->nr_to_scan <= 0)
+			break;
+	}
+	return count ? count : SHRINK_STOP;
+}
+
+static struct shrinker rcu_lazy_shrinker = {
+	.count_objects = rcu_lazy_shrink_count,
+	.scan_objects = rcu_lazy_shrink_scan,
+	.batch = 0,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static void __init rcu_lazy_init_percpu_data(struct rcu_data *rdp)
+{
+	rcu_cblist_init(&rdp->lazy_cblist);
+	timer_setup(&rdp->lazy_timer, rcu_lazy_timer_func, TIMER_PINNED);
+	rdp->lazy_iw = IRQ_WORK_INIT_HARD(rcu_lazy_iw_handler);
+}
+
+static void __init rcu_lazy_init(void)
+{
+	if (register_shrinker(&rcu_lazy_shrinker, "rcu-lazy-softirq"))
+		pr_err("Failed to register rcu-lazy-softirq shrinker!\n");
+}
+#else /* #ifdef CONFIG_RCU_LAZY */
+static long rcu_lazy_n_cbs(struct rcu_data *rdp)
+{
+	return 0;
+}
+
+static void rcu_lazy_flush(struct rcu_data *rdp, const char *reason)
+{
+}
+
+static bool rcu_lazy_enqueue(struct rcu_data *rdp, struct rcu_head *rhp,
+			     bool lazy)
+{
+	return false;
+}
+
+static void __init rcu_lazy_init_percpu_data(struct rcu_data *rdp)
+{
+}
+
+static void __init rcu_lazy_init(void)
+{
+}
+#endif /* #else #ifdef CONFIG_RCU_LAZY */
+
 static void
 __call_rcu_common(struct rcu_head *head, rcu_callback_t func, bool lazy_in)
 {
@@ -2641,6 +2845,10 @@ __call_rcu_common(struct rcu_head *head, rcu_callback_t func, bool lazy_in)
 	}
 
 	check_cb_ovld(rdp);
+	if (rcu_lazy_enqueue(rdp, head, lazy)) {
+		local_irq_restore(flags);
+		return; // Enqueued onto ->lazy_cblist, so just leave.
+	}
 	if (rcu_nocb_try_bypass(rdp, head, &was_alldone, flags, lazy))
 		return; // Enqueued onto ->nocb_bypass, so just leave.
 	// If no-CBs CPU gets here, rcu_nocb_try_bypass() acquired ->nocb_lock.
@@ -3910,6 +4118,7 @@ static void rcu_barrier_entrain(struct rcu_data *rdp)
 	 */
 	was_alldone = rcu_rdp_is_offloaded(rdp) && !rcu_segcblist_pend_cbs(&rdp->cblist);
 	WARN_ON_ONCE(!rcu_nocb_flush_bypass(rdp, NULL, jiffies, false));
+	rcu_lazy_flush(rdp, TPS("Barrier"));
 	wake_nocb = was_alldone && rcu_segcblist_pend_cbs(&rdp->cblist);
 	if (rcu_segcblist_entrain(&rdp->cblist, &rdp->barrier_head)) {
 		atomic_inc(&rcu_state.barrier_cpu_count);
@@ -3996,7 +4205,7 @@ void rcu_barrier(void)
 		if (smp_load_acquire(&rdp->barrier_seq_snap) == gseq)
 			continue;
 		raw_spin_lock_irqsave(&rcu_state.barrier_lock, flags);
-		if (!rcu_segcblist_n_cbs(&rdp->cblist)) {
+		if (!rcu_segcblist_n_cbs(&rdp->cblist) && !rcu_lazy_n_cbs(rdp)) {
 			WRITE_ONCE(rdp->barrier_seq_snap, gseq);
 			raw_spin_unlock_irqrestore(&rcu_state.barrier_lock, flags);
 			rcu_barrier_trace(TPS("NQ"), cpu, rcu_state.barrier_sequence);
@@ -4242,6 +4451,7 @@ rcu_boot_init_percpu_data(int cpu)
 	rdp->last_sched_clock = jiffies;
 	rdp->cpu = cpu;
 	rcu_boot_init_nocb_percpu_data(rdp);
+	rcu_lazy_init_percpu_data(rdp);
 }
 
 /*
@@ -4482,11 +4692,12 @@ void rcutree_migrate_callbacks(int cpu)
 	bool needwake;
 
 	if (rcu_rdp_is_offloaded(rdp) ||
-	    rcu_segcblist_empty(&rdp->cblist))
+	    (rcu_segcblist_empty(&rdp->cblist) && !rcu_lazy_n_cbs(rdp)))
 		return;  /* No callbacks to migrate. */
 
 	raw_spin_lock_irqsave(&rcu_state.barrier_lock, flags);
 	WARN_ON_ONCE(rcu_rdp_cpu_online(rdp));
+	rcu_lazy_flush(rdp, TPS("Offline"));
 	rcu_barrier_entrain(rdp);
 	my_rdp = this_cpu_ptr(&rcu_data);
 	my_rnp = my_rdp->mynode;
@@ -4965,6 +5176,8 @@ void __init rcu_init(void)
 	else
 		qovld_calc = qovld;
 
+	rcu_lazy_init();
+
 	// Kick-start in case any polled grace periods started early.
 	(void)start_poll_synchronize_rcu_expedited();
 
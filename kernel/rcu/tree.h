@@ -205,6 +205,11 @@ struct rcu_data {
 	unsigned long	n_force_qs_snap;
 					/* did other CPU force QS recently? */
 	long		blimit;		/* Upper limit on a processed batch */
+#ifdef CONFIG_RCU_LAZY
+	struct rcu_cblist lazy_cblist;	/* Lazy CBs of non-offloaded CPU. */
+	struct timer_list lazy_timer;	/* Enforce finite laziness. */
+	struct irq_work lazy_iw;	/* Remote flush for memory pressure. */
+#endif
 
 	/* 3) dynticks interface. */
 	int dynticks_snap;		/* Per-GP tracking for dynticks. */
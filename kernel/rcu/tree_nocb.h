@@ -256,31 +256,6 @@ static bool wake_nocb_gp(struct rcu_data *rdp, bool force)
 	return __wake_nocb_gp(rdp_gp, rdp, force, flags);
 }
 
-/*
- * LAZY_FLUSH_JIFFIES decides the maximum amount of time that
- * can elapse before lazy callbacks are flushed. Lazy callbacks
- * could be flushed much earlier for a number of other reasons
- * however, LAZY_FLUSH_JIFFIES will ensure no lazy callbacks are
- * left unsubmitted to RCU after those many jiffies.
- */
-#define LAZY_FLUSH_JIFFIES (10 * HZ)
-static unsigned long jiffies_till_flush = LAZY_FLUSH_JIFFIES;
-
-#ifdef CONFIG_RCU_LAZY
-// To be called only from test code.
-void rcu_lazy_set_jiffies_till_flush(unsigned long jif)
-{
-	jiffies_till_flush = jif;
-}
-EXPORT_SYMBOL(rcu_lazy_set_jiffies_till_flush);
-
-unsigned long rcu_lazy_get_jiffies_till_flush(void)
-{
-	return jiffies_till_flush;
-}
-EXPORT_SYMBOL(rcu_lazy_get_jiffies_till_flush);
-#endif
-
 /*
  * Arrange to wake the GP kthread for this NOCB group at some future
  * time when it is safe to do so.
@@ -1254,6 +1229,13 @@ static long rcu_nocb_rdp_offload(void *arg)
 	 */
 	raw_spin_lock_irqsave(&rdp->nocb_lock, flags);
 
+	/*
+	 * Lazy callbacks queued while not offloaded must join ->cblist
+	 * before the nocb kthreads take over, as nothing flushes them past
+	 * this point.
+	 */
+	rcu_lazy_flush(rdp, TPS("Offload"));
+
 	/*
 	 * We didn't take the nocb lock while working on the
 	 * rdp->cblist with SEGCBLIST_LOCKING cleared (pure softirq/rcuc mode).
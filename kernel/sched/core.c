@@ -236,6 +236,25 @@ static inline int rb_sched_core_cmp(const void *key, const struct rb_node *node)
 	return 0;
 }
 
+/*
+ * Summarize the cookies queued on @rq for lockless readers in other CPUs of
+ * the cluster: the core_tree is sorted by cookie, so it holds a single cookie
+ * iff its first and last tasks have the same one.
+ */
+static void sched_core_update_cluster_cookie(struct rq *rq)
+{
+	unsigned long cookie = 0;
+
+	if (!RB_EMPTY_ROOT(&rq->core_tree)) {
+		unsigned long first = __node_2_sc(rb_first(&rq->core_tree))->core_cookie;
+		unsigned long last = __node_2_sc(rb_last(&rq->core_tree))->core_cookie;
+
+		cookie = first == last ? first : SCHED_CORE_COOKIE_MIXED;
+	}
+
+	WRITE_ONCE(rq->core_cluster_cookie, cookie);
+}
+
 void sched_core_enqueue(struct rq *rq, struct task_struct *p)
 {
 	rq->core->core_task_seq++;
@@ -244,6 +263,7 @@ void sched_core_enqueue(struct rq *rq, struct task_struct *p)
 		return;
 
 	rb_add(&p->core_node, &rq->core_tree, rb_sched_core_less);
+	sched_core_update_cluster_cookie(rq);
 }
 
 void sched_core_dequeue(struct rq *rq, struct task_struct *p, int flags)
@@ -253,6 +273,7 @@ void sched_core_dequeue(struct rq *rq, struct task_struct *p, int flags)
 	if (sched_core_enqueued(p)) {
 		rb_erase(&p->core_node, &rq->core_tree);
 		RB_CLEAR_NODE(&p->core_node);
+		sched_core_update_cluster_cookie(rq);
 	}
 
 	/*
@@ -265,6 +286,80 @@ void sched_core_dequeue(struct rq *rq, struct task_struct *p, int flags)
 		resched_curr(rq);
 }
 
+DEFINE_STATIC_KEY_FALSE(sched_core_cluster);
+
+/* Are tasks with a cookie other than @p's queued in the LLC cluster of @rq? */
+bool __sched_cluster_cookie_match(struct rq *rq, struct task_struct *p)
+{
+	struct sched_domain *sd;
+	bool match = true;
+	int cpu;
+
+	rcu_read_lock();
+	sd = rcu_dereference(per_cpu(sd_llc, cpu_of(rq)));
+	if (sd) {
+		for_each_cpu(cpu, sched_domain_span(sd)) {
+			unsigned long cookie = READ_ONCE(cpu_rq(cpu)->core_cluster_cookie);
+
+			if (cookie && cookie != p->core_cookie) {
+				match = false;
+				break;
+			}
+		}
+	}
+	rcu_read_unlock();
+
+	return match;
+}
+
+/*
+ * @cpu is in a cluster running another cookie. Find an allowed CPU in a
+ * cluster free of other cookies, preferably idle, or give up and keep @cpu.
+ */
+int sched_cluster_cookie_cpu(struct task_struct *p, int cpu)
+{
+	int i, fallback = -1;
+
+	for_each_cpu_wrap(i, p->cpus_ptr, cpu) {
+		if (!cpu_active(i) || !__sched_cluster_cookie_match(cpu_rq(i), p))
+			continue;
+
+		if (available_idle_cpu(i))
+			return i;
+
+		if (fallback < 0)
+			fallback = i;
+	}
+
+	return fallback < 0 ? cpu : fallback;
+}
+
+#ifdef CONFIG_PROC_SYSCTL
+static int sysctl_sched_core_cluster(struct ctl_table *table, int write,
+				     void *buffer, size_t *lenp, loff_t *ppos)
+{
+	struct ctl_table t;
+	int err;
+	int state = static_branch_unlikely(&sched_core_cluster);
+
+	if (write && !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	t = *table;
+	t.data = &state;
+	err = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
+	if (err < 0 || !write)
+		return err;
+
+	if (state)
+		static_branch_enable(&sched_core_cluster);
+	else
+		static_branch_disable(&sched_core_cluster);
+
+	return err;
+}
+#endif /* CONFIG_PROC_SYSCTL */
+
 static int sched_task_is_throttled(struct task_struct *p, int cpu)
 {
 	if (p->sched_class->task_is_throttled)
@@ -1305,6 +1400,11 @@ static void set_load_weight(struct task_struct *p, bool update_load)
 	}
 }
 
+static void set_latency_weight(struct task_struct *p)
+{
+	p->se.latency_weight = latency_prio_to_weight(p->latency_prio);
+}
+
 #ifdef CONFIG_UCLAMP_TASK
 /*
  * Serializes updates of utilization clamp values
@@ -4479,6 +4579,15 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 	init_dl_inactive_task_timer(&p->dl);
 	__dl_clear_params(p);
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+	p->scx.dsq			= NULL;
+	INIT_LIST_HEAD(&p->scx.dsq_node);
+	INIT_LIST_HEAD(&p->scx.runnable_node);
+	p->scx.slice			= SCX_SLICE_DFL;
+	p->scx.dsq_cpu			= -1;
+	p->scx.flags			= 0;
+#endif
+
 	INIT_LIST_HEAD(&p->rt.run_list);
 	p->rt.timeout		= 0;
 	p->rt.time_slice	= sched_rr_timeslice;
@@ -4673,6 +4782,17 @@ static struct ctl_table sched_core_sysctls[] = {
 		.extra2		= SYSCTL_FOUR,
 	},
 #endif /* CONFIG_NUMA_BALANCING */
+#if defined(CONFIG_SCHED_CORE) && defined(CONFIG_PROC_SYSCTL)
+	{
+		.procname	= "sched_core_cluster",
+		.data		= NULL, /* filled in by handler */
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= sysctl_sched_core_cluster,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
+#endif /* CONFIG_SCHED_CORE && CONFIG_PROC_SYSCTL */
 	{}
 };
 static int __init sched_core_sysctl_init(void)
@@ -4717,6 +4837,11 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		p->prio = p->normal_prio = p->static_prio;
 		set_load_weight(p, false);
 
+		if (LATENCY_TO_NICE(p->latency_prio) < 0) {
+			p->latency_prio = DEFAULT_LATENCY_PRIO;
+			set_latency_weight(p);
+		}
+
 		/*
 		 * We don't need the reset flag anymore after the fork. It has
 		 * fulfilled its duty:
@@ -4728,6 +4853,8 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		return -EAGAIN;
 	else if (rt_prio(p->prio))
 		p->sched_class = &rt_sched_class;
+	else if (task_should_scx(p))
+		p->sched_class = &ext_sched_class;
 	else
 		p->sched_class = &fair_sched_class;
 
@@ -4781,6 +4908,7 @@ void sched_cgroup_fork(struct task_struct *p, struct kernel_clone_args *kargs)
 void sched_post_fork(struct task_struct *p)
 {
 	uclamp_post_fork(p);
+	scx_post_fork(p);
 }
 
 unsigned long to_ratio(u64 period, u64 runtime)
@@ -5946,6 +6074,15 @@ static void put_prev_task_balance(struct rq *rq, struct task_struct *prev,
 		if (class->balance(rq, prev, rf))
 			break;
 	}
+
+	/*
+	 * Ext tasks on a shared dispatch queue are counted on their rq but
+	 * only reach its local queue through the ext balance pass. Run it if
+	 * the loop above stopped short of it.
+	 */
+	if (scx_enabled() && (sched_class_above(class, &ext_sched_class) ||
+			      prev->sched_class == &idle_sched_class))
+		scx_balance(rq, prev, rf);
 #endif
 
 	put_prev_task(rq, prev);
@@ -5966,7 +6103,8 @@ __pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 	 * higher scheduling class, because otherwise those lose the
 	 * opportunity to pull in more work from other CPUs.
 	 */
-	if (likely(!sched_class_above(prev->sched_class, &fair_sched_class) &&
+	if (likely(!scx_enabled() &&
+		   !sched_class_above(prev->sched_class, &fair_sched_class) &&
 		   rq->nr_running == rq->cfs.h_nr_running)) {
 
 		p = pick_next_task_fair(rq, prev, rf);
@@ -7000,12 +7138,63 @@ static void __setscheduler_prio(struct task_struct *p, int prio)
 		p->sched_class = &dl_sched_class;
 	else if (rt_prio(prio))
 		p->sched_class = &rt_sched_class;
+	else if (task_should_scx(p))
+		p->sched_class = &ext_sched_class;
 	else
 		p->sched_class = &fair_sched_class;
 
 	p->prio = prio;
 }
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+/*
+ * Move a task between CFS and the ext class after a BPF scheduler was loaded
+ * or unloaded. Boosted and RT/DL tasks pick the right class up when they
+ * drop back to a normal priority.
+ */
+void sched_ext_update_class(struct task_struct *p)
+{
+	const struct sched_class *prev_class, *next_class;
+	int queued, running;
+	struct rq_flags rf;
+	struct rq *rq;
+
+	rq = task_rq_lock(p, &rf);
+	prev_class = p->sched_class;
+	if (prev_class != &fair_sched_class && prev_class != &ext_sched_class)
+		goto out;
+
+	next_class = task_should_scx(p) ? &ext_sched_class : &fair_sched_class;
+	if (next_class == prev_class)
+		goto out;
+
+	/* Not woken up yet, nothing is attached to the old class */
+	if (READ_ONCE(p->__state) == TASK_NEW) {
+		p->sched_class = next_class;
+		goto out;
+	}
+
+	update_rq_clock(rq);
+	queued = task_on_rq_queued(p);
+	running = task_current(rq, p);
+	if (queued)
+		dequeue_task(rq, p, DEQUEUE_SAVE | DEQUEUE_MOVE | DEQUEUE_NOCLOCK);
+	if (running)
+		put_prev_task(rq, p);
+
+	p->sched_class = next_class;
+
+	if (queued)
+		enqueue_task(rq, p, ENQUEUE_RESTORE | ENQUEUE_MOVE | ENQUEUE_NOCLOCK);
+	if (running)
+		set_next_task(rq, p);
+
+	check_class_changed(rq, p, prev_class, p->prio);
+out:
+	task_rq_unlock(rq, p, &rf);
+}
+#endif
+
 #ifdef CONFIG_RT_MUTEXES
 
 static inline int __rt_effective_prio(struct task_struct *pi_task, int prio)
@@ -7390,7 +7579,8 @@ unsigned long effective_cpu_util(int cpu, unsigned long util_cfs,
 	 * Because the time spend on RT/DL tasks is visible as 'lost' time to
 	 * CFS tasks and we use the same metric to track the effective
 	 * utilization (PELT windows are synchronized) we can directly add them
-	 * to obtain the CPU's actual utilization.
+	 * to obtain the CPU's actual utilization. Ext tasks have no per-task
+	 * signal either, so their running time is added the same way.
 	 *
 	 * CFS and RT utilization can be boosted or capped, depending on
 	 * utilization clamp constraints requested by currently RUNNABLE
@@ -7398,7 +7588,7 @@ unsigned long effective_cpu_util(int cpu, unsigned long util_cfs,
 	 * When there are no CFS RUNNABLE tasks, clamps are released and
 	 * frequency will be gracefully reduced with the utilization decay.
 	 */
-	util = util_cfs + cpu_util_rt(rq);
+	util = util_cfs + cpu_util_rt(rq) + cpu_util_scx(rq);
 	if (type == FREQUENCY_UTIL)
 		util = uclamp_rq_util_with(rq, util, p);
 
@@ -7499,6 +7689,15 @@ static void __setscheduler_params(struct task_struct *p,
 	set_load_weight(p, true);
 }
 
+static void __setscheduler_latency(struct task_struct *p,
+				   const struct sched_attr *attr)
+{
+	if (attr->sched_flags & SCHED_FLAG_LATENCY_NICE) {
+		p->latency_prio = NICE_TO_LATENCY(attr->sched_latency_nice);
+		set_latency_weight(p);
+	}
+}
+
 /*
  * Check the target process has a UID that matches the current process's:
  */
@@ -7530,6 +7729,11 @@ static int user_check_sched_setscheduler(struct task_struct *p,
 			goto req_priv;
 	}
 
+	/* Asking for lower latency takes the same privilege as a lower nice */
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    attr->sched_latency_nice < LATENCY_TO_NICE(p->latency_prio))
+		goto req_priv;
+
 	if (rt_policy(policy)) {
 		unsigned long rlim_rtprio = task_rlimit(p, RLIMIT_RTPRIO);
 
@@ -7619,6 +7823,11 @@ static int __sched_setscheduler(struct task_struct *p,
 	    (rt_policy(policy) != (attr->sched_priority != 0)))
 		return -EINVAL;
 
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    (attr->sched_latency_nice < MIN_LATENCY_NICE ||
+	     attr->sched_latency_nice > MAX_LATENCY_NICE))
+		return -EINVAL;
+
 	if (user) {
 		retval = user_check_sched_setscheduler(p, attr, policy, reset_on_fork);
 		if (retval)
@@ -7673,6 +7882,9 @@ static int __sched_setscheduler(struct task_struct *p,
 			goto change;
 		if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP)
 			goto change;
+		if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+		    attr->sched_latency_nice != LATENCY_TO_NICE(p->latency_prio))
+			goto change;
 
 		p->sched_reset_on_fork = reset_on_fork;
 		retval = 0;
@@ -7762,6 +7974,7 @@ static int __sched_setscheduler(struct task_struct *p,
 		__setscheduler_prio(p, newprio);
 	}
 	__setscheduler_uclamp(p, attr);
+	__setscheduler_latency(p, attr);
 
 	if (queued) {
 		/*
@@ -7971,6 +8184,10 @@ static int sched_copy_attr(struct sched_attr __user *uattr, struct sched_attr *a
 	    size < SCHED_ATTR_SIZE_VER1)
 		return -EINVAL;
 
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    size < SCHED_ATTR_SIZE_VER2)
+		return -EINVAL;
+
 	/*
 	 * XXX: Do we want to be lenient like existing syscalls; or do we want
 	 * to be strict and return an error on out-of-bounds values?
@@ -8217,6 +8434,7 @@ SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
 	kattr.sched_util_min = p->uclamp_req[UCLAMP_MIN].value;
 	kattr.sched_util_max = p->uclamp_req[UCLAMP_MAX].value;
 #endif
+	kattr.sched_latency_nice = LATENCY_TO_NICE(p->latency_prio);
 
 	rcu_read_unlock();
 
@@ -9002,6 +9220,7 @@ SYSCALL_DEFINE1(sched_get_priority_max, int, policy)
 	case SCHED_NORMAL:
 	case SCHED_BATCH:
 	case SCHED_IDLE:
+	case SCHED_EXT:
 		ret = 0;
 		break;
 	}
@@ -9029,6 +9248,7 @@ SYSCALL_DEFINE1(sched_get_priority_min, int, policy)
 	case SCHED_NORMAL:
 	case SCHED_BATCH:
 	case SCHED_IDLE:
+	case SCHED_EXT:
 		ret = 0;
 	}
 	return ret;
@@ -9947,6 +10167,7 @@ void __init sched_init(void)
 		init_cfs_rq(&rq->cfs);
 		init_rt_rq(&rq->rt);
 		init_dl_rq(&rq->dl);
+		fair_server_init(rq);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 		INIT_LIST_HEAD(&rq->leaf_cfs_rq_list);
 		rq->tmp_alone_branch = &rq->leaf_cfs_rq_list;
@@ -10053,6 +10274,7 @@ void __init sched_init(void)
 	balance_push_set(smp_processor_id(), false);
 #endif
 	init_sched_fair_class();
+	init_sched_ext_class();
 
 	psi_init();
 
@@ -10322,11 +10544,24 @@ static inline void alloc_uclamp_sched_group(struct task_group *tg,
 #endif
 }
 
+static inline int alloc_lat_hist_sched_group(struct task_group *tg)
+{
+#ifdef CONFIG_SCHEDSTATS
+	tg->lat_hist = alloc_percpu(struct sched_lat_hist);
+	if (!tg->lat_hist)
+		return 0;
+#endif
+	return 1;
+}
+
 static void sched_free_group(struct task_group *tg)
 {
 	free_fair_sched_group(tg);
 	free_rt_sched_group(tg);
 	autogroup_free(tg);
+#ifdef CONFIG_SCHEDSTATS
+	free_percpu(tg->lat_hist);
+#endif
 	kmem_cache_free(task_group_cache, tg);
 }
 
@@ -10361,6 +10596,9 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!alloc_rt_sched_group(tg, parent))
 		goto err;
 
+	if (!alloc_lat_hist_sched_group(tg))
+		goto err;
+
 	alloc_uclamp_sched_group(tg, parent);
 
 	return tg;
@@ -10552,6 +10790,14 @@ static void cpu_cgroup_css_released(struct cgroup_subsys_state *css)
 {
 	struct task_group *tg = css_tg(css);
 
+#if defined(CONFIG_FAIR_GROUP_SCHED) && defined(CONFIG_PSI)
+	/*
+	 * Stopping the boost waits for its work and takes shares_mutex, so it
+	 * cannot be left to unregister_fair_sched_group() in RCU callback
+	 * context.
+	 */
+	sched_group_set_psi_boost(tg, 0, 0, 0);
+#endif
 	sched_release_group(tg);
 }
 
@@ -11144,6 +11390,21 @@ static int cpu_idle_write_s64(struct cgroup_subsys_state *css,
 {
 	return sched_group_set_idle(css_tg(css), idle);
 }
+
+static s64 cpu_latency_nice_read_s64(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return LATENCY_TO_NICE(css_tg(css)->latency_prio);
+}
+
+static int cpu_latency_nice_write_s64(struct cgroup_subsys_state *css,
+				      struct cftype *cft, s64 nice)
+{
+	if (nice < MIN_LATENCY_NICE || nice > MAX_LATENCY_NICE)
+		return -ERANGE;
+
+	return sched_group_set_latency(css_tg(css), NICE_TO_LATENCY(nice));
+}
 #endif
 
 static struct cftype cpu_legacy_files[] = {
@@ -11158,6 +11419,12 @@ static struct cftype cpu_legacy_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+	{
+		.name = "latency.nice",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -11235,6 +11502,39 @@ static int cpu_extra_stat_show(struct seq_file *sf,
 	return 0;
 }
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * Hierarchical: a group's histogram sums those of its own tasks and of
+ * the descendant groups. The root covers every task, which is exactly
+ * what the per-CPU histograms count.
+ */
+static int cpu_latency_hist_show(struct seq_file *sf, void *v)
+{
+	struct cgroup_subsys_state *css = seq_css(sf), *pos;
+	struct sched_lat_hist hist = { };
+	int cpu;
+
+	if (css_tg(css) == &root_task_group) {
+		for_each_possible_cpu(cpu)
+			sched_lat_hist_add(&hist, &cpu_rq(cpu)->rq_lat_hist);
+	} else {
+		rcu_read_lock();
+		css_for_each_descendant_pre(pos, css) {
+			struct task_group *tg = css_tg(pos);
+
+			for_each_possible_cpu(cpu)
+				sched_lat_hist_add(&hist,
+						   per_cpu_ptr(tg->lat_hist, cpu));
+		}
+		rcu_read_unlock();
+	}
+
+	sched_lat_hist_print(sf, &hist);
+
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static u64 cpu_weight_read_u64(struct cgroup_subsys_state *css,
 			       struct cftype *cft)
@@ -11330,6 +11630,52 @@ static int __maybe_unused cpu_period_quota_parse(char *buf,
 	return 0;
 }
 
+#if defined(CONFIG_FAIR_GROUP_SCHED) && defined(CONFIG_PSI)
+static int cpu_pressure_boost_show(struct seq_file *sf, void *v)
+{
+	unsigned int threshold, window_ms;
+	unsigned long shares;
+	u64 weight;
+
+	sched_group_get_psi_boost(css_tg(seq_css(sf)), &threshold, &shares,
+				  &window_ms);
+	weight = DIV_ROUND_CLOSEST_ULL(scale_load_down(shares) * CGROUP_WEIGHT_DFL,
+				       1024);
+
+	seq_printf(sf, "%u %llu %u\n", threshold, weight, window_ms);
+	return 0;
+}
+
+/*
+ * "THRESHOLD WEIGHT [WINDOW_MS]": run the group at cpu.weight WEIGHT while its
+ * CPU some pressure is above THRESHOLD percent of a window. "0" turns it off.
+ */
+static ssize_t cpu_pressure_boost_write(struct kernfs_open_file *of,
+					char *buf, size_t nbytes, loff_t off)
+{
+	unsigned int threshold, window_ms = 500;
+	u64 weight = 0;
+	int ret;
+
+	ret = sscanf(strstrip(buf), "%u %llu %u", &threshold, &weight, &window_ms);
+	if (ret < 1 || (threshold && ret < 2))
+		return -EINVAL;
+
+	if (threshold > 100 || window_ms < 100 || window_ms > 10000)
+		return -ERANGE;
+
+	if (threshold &&
+	    (weight < CGROUP_WEIGHT_MIN || weight > CGROUP_WEIGHT_MAX))
+		return -ERANGE;
+
+	weight = DIV_ROUND_CLOSEST_ULL(weight * 1024, CGROUP_WEIGHT_DFL);
+
+	ret = sched_group_set_psi_boost(css_tg(of_css(of)), threshold,
+					scale_load(weight), window_ms);
+	return ret ?: nbytes;
+}
+#endif
+
 #ifdef CONFIG_CFS_BANDWIDTH
 static int cpu_max_show(struct seq_file *sf, void *v)
 {
@@ -11375,6 +11721,20 @@ static struct cftype cpu_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+	{
+		.name = "latency.nice",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
+#ifdef CONFIG_PSI
+	{
+		.name = "pressure.boost",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_pressure_boost_show,
+		.write = cpu_pressure_boost_write,
+	},
+#endif
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -11403,6 +11763,12 @@ static struct cftype cpu_files[] = {
 		.seq_show = cpu_uclamp_max_show,
 		.write = cpu_uclamp_max_write,
 	},
+#endif
+#ifdef CONFIG_SCHEDSTATS
+	{
+		.name = "latency.hist",
+		.seq_show = cpu_latency_hist_show,
+	},
 #endif
 	{ }	/* terminate */
 };
@@ -11,6 +11,7 @@
 struct sugov_tunables {
 	struct gov_attr_set	attr_set;
 	unsigned int		rate_limit_us;
+	unsigned int		response_time_ms;
 };
 
 struct sugov_policy {
@@ -24,6 +25,8 @@ struct sugov_policy {
 	s64			freq_update_delay_ns;
 	unsigned int		next_freq;
 	unsigned int		cached_raw_freq;
+	/* util scale factor for the response_time_ms tunable */
+	unsigned long		response_time_mult;
 
 	/* The next fields are only needed if fast switch cannot be used: */
 	struct			irq_work irq_work;
@@ -114,6 +117,46 @@ static void sugov_deferred_update(struct sugov_policy *sg_policy)
 	}
 }
 
+/*
+ * Time in ms it takes the PELT util of an always running task to climb from 0
+ * to the 80% of @max where map_util_perf() asks for the highest frequency,
+ * with PELT decaying by y per ms, y^32 = 0.5. Util is capacity invariant, so
+ * on a CPU of capacity @max it converges towards @max.
+ */
+static unsigned int sugov_pelt_response_time_ms(unsigned long max)
+{
+	unsigned long util = 0, target = max * 4 / 5;
+	unsigned int ms;
+
+	for (ms = 0; util < target && ms < 1000; ms++)
+		util = (util * 1002 + max * 22) >> 10;
+
+	return max_t(unsigned int, ms, 1);
+}
+
+/*
+ * Scale util so that a ramp from idle reaches the highest frequency within
+ * response_time_ms rather than the PELT default.
+ */
+static void sugov_update_response_time(struct sugov_policy *sg_policy)
+{
+	struct cpufreq_policy *policy = sg_policy->policy;
+	unsigned int pelt_ms, ms = sg_policy->tunables->response_time_ms;
+
+	pelt_ms = sugov_pelt_response_time_ms(arch_scale_cpu_capacity(policy->cpu));
+	sg_policy->response_time_mult = (pelt_ms << SCHED_CAPACITY_SHIFT) / ms;
+}
+
+static inline unsigned long sugov_map_util(struct sugov_policy *sg_policy,
+					   unsigned long util)
+{
+	util = map_util_perf(util);
+	if (sg_policy->response_time_mult != SCHED_CAPACITY_SCALE)
+		util = (util * sg_policy->response_time_mult) >> SCHED_CAPACITY_SHIFT;
+
+	return util;
+}
+
 /**
  * get_next_freq - Compute a new frequency for a given cpufreq policy.
  * @sg_policy: schedutil policy object to compute the new frequency for.
@@ -130,7 +173,8 @@ static void sugov_deferred_update(struct sugov_policy *sg_policy)
  *
  * next_freq = C * curr_freq * util_raw / max
  *
- * Take C = 1.25 for the frequency tipping point at (util / max) = 0.8.
+ * Take C = 1.25 for the frequency tipping point at (util / max) = 0.8, scaled
+ * by the response_time_ms tunable.
  *
  * The lowest driver-supported frequency which is equal or greater than the raw
  * next_freq (as calculated above) is returned, subject to policy min/max and
@@ -143,7 +187,7 @@ static unsigned int get_next_freq(struct sugov_policy *sg_policy,
 	unsigned int freq = arch_scale_freq_invariant() ?
 				policy->cpuinfo.max_freq : policy->cur;
 
-	util = map_util_perf(util);
+	util = sugov_map_util(sg_policy, util);
 	freq = map_util_freq(util, freq, max);
 
 	if (freq == sg_policy->cached_raw_freq && !sg_policy->need_freq_update)
@@ -406,7 +450,8 @@ static void sugov_update_single_perf(struct update_util_data *hook, u64 time,
 		sg_cpu->util = prev_util;
 
 	cpufreq_driver_adjust_perf(sg_cpu->cpu, map_util_perf(sg_cpu->bw_dl),
-				   map_util_perf(sg_cpu->util), max_cap);
+				   sugov_map_util(sg_cpu->sg_policy, sg_cpu->util),
+				   max_cap);
 
 	sg_cpu->sg_policy->last_freq_update_time = time;
 }
@@ -533,8 +578,41 @@ rate_limit_us_store(struct gov_attr_set *attr_set, const char *buf, size_t count
 
 static struct governor_attr rate_limit_us = __ATTR_RW(rate_limit_us);
 
+static ssize_t response_time_ms_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->response_time_ms);
+}
+
+static ssize_t
+response_time_ms_store(struct gov_attr_set *attr_set, const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	struct sugov_policy *sg_policy;
+	unsigned int response_time_ms;
+
+	if (kstrtouint(buf, 10, &response_time_ms))
+		return -EINVAL;
+
+	if (!response_time_ms || response_time_ms > 1000)
+		return -EINVAL;
+
+	tunables->response_time_ms = response_time_ms;
+
+	list_for_each_entry(sg_policy, &attr_set->policy_list, tunables_hook) {
+		sugov_update_response_time(sg_policy);
+		sg_policy->limits_changed = true;
+	}
+
+	return count;
+}
+
+static struct governor_attr response_time_ms = __ATTR_RW(response_time_ms);
+
 static struct attribute *sugov_attrs[] = {
 	&rate_limit_us.attr,
+	&response_time_ms.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(sugov);
@@ -698,6 +776,8 @@ static int sugov_init(struct cpufreq_policy *policy)
 	}
 
 	tunables->rate_limit_us = cpufreq_policy_transition_delay_us(policy);
+	tunables->response_time_ms =
+		sugov_pelt_response_time_ms(arch_scale_cpu_capacity(policy->cpu));
 
 	policy->governor_data = sg_policy;
 	sg_policy->tunables = tunables;
@@ -764,6 +844,8 @@ static int sugov_start(struct cpufreq_policy *policy)
 	sg_policy->limits_changed		= false;
 	sg_policy->cached_raw_freq		= 0;
 
+	sugov_update_response_time(sg_policy);
+
 	sg_policy->need_freq_update = cpufreq_driver_test_flags(CPUFREQ_NEED_UPDATE_LIMITS);
 
 	for_each_cpu(cpu, policy->cpus) {
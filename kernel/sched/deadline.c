@@ -23,7 +23,17 @@
  */
 static unsigned int sysctl_sched_dl_period_max = 1 << 22; /* ~4 seconds */
 static unsigned int sysctl_sched_dl_period_min = 100;     /* 100 us */
+
+/*
+ * Default reservation of the per-CPU fair server: CFS tasks starved by RT
+ * get 50ms every second, late in the period and only if they did not get
+ * that much on their own.
+ */
+unsigned int sysctl_sched_fair_server_runtime = 50000;	/* 50 ms */
+unsigned int sysctl_sched_fair_server_period = 1000000;	/* 1 s */
 #ifdef CONFIG_SYSCTL
+static int sched_fair_server_handler(struct ctl_table *table, int write,
+				     void *buffer, size_t *lenp, loff_t *ppos);
 static struct ctl_table sched_dl_sysctls[] = {
 	{
 		.procname       = "sched_deadline_period_max_us",
@@ -41,6 +51,20 @@ static struct ctl_table sched_dl_sysctls[] = {
 		.proc_handler   = proc_douintvec_minmax,
 		.extra2         = (void *)&sysctl_sched_dl_period_max,
 	},
+	{
+		.procname       = "sched_fair_server_runtime_us",
+		.data           = &sysctl_sched_fair_server_runtime,
+		.maxlen         = sizeof(unsigned int),
+		.mode           = 0644,
+		.proc_handler   = sched_fair_server_handler,
+	},
+	{
+		.procname       = "sched_fair_server_period_us",
+		.data           = &sysctl_sched_fair_server_period,
+		.maxlen         = sizeof(unsigned int),
+		.mode           = 0644,
+		.proc_handler   = sched_fair_server_handler,
+	},
 	{}
 };
 
@@ -52,8 +76,14 @@ static int __init sched_dl_sysctl_init(void)
 late_initcall(sched_dl_sysctl_init);
 #endif
 
+static inline bool dl_server(struct sched_dl_entity *dl_se)
+{
+	return dl_se->dl_server;
+}
+
 static inline struct task_struct *dl_task_of(struct sched_dl_entity *dl_se)
 {
+	BUG_ON(dl_server(dl_se));
 	return container_of(dl_se, struct task_struct, dl);
 }
 
@@ -62,12 +92,17 @@ static inline struct rq *rq_of_dl_rq(struct dl_rq *dl_rq)
 	return container_of(dl_rq, struct rq, dl);
 }
 
-static inline struct dl_rq *dl_rq_of_se(struct sched_dl_entity *dl_se)
+static inline struct rq *rq_of_dl_se(struct sched_dl_entity *dl_se)
 {
-	struct task_struct *p = dl_task_of(dl_se);
-	struct rq *rq = task_rq(p);
+	if (dl_server(dl_se))
+		return dl_se->rq;
 
-	return &rq->dl;
+	return task_rq(dl_task_of(dl_se));
+}
+
+static inline struct dl_rq *dl_rq_of_se(struct sched_dl_entity *dl_se)
+{
+	return &rq_of_dl_se(dl_se)->dl;
 }
 
 static inline int on_dl_rq(struct sched_dl_entity *dl_se)
@@ -1047,11 +1082,10 @@ static inline u64 dl_next_period(struct sched_dl_entity *dl_se)
  * actually started or not (i.e., the replenishment instant is in
  * the future or in the past).
  */
-static int start_dl_timer(struct task_struct *p)
+static int start_dl_timer(struct sched_dl_entity *dl_se)
 {
-	struct sched_dl_entity *dl_se = &p->dl;
 	struct hrtimer *timer = &dl_se->dl_timer;
-	struct rq *rq = task_rq(p);
+	struct rq *rq = rq_of_dl_se(dl_se);
 	ktime_t now, act;
 	s64 delta;
 
@@ -1060,9 +1094,14 @@ static int start_dl_timer(struct task_struct *p)
 	/*
 	 * We want the timer to fire at the deadline, but considering
 	 * that it is actually coming from rq->clock and not from
-	 * hrtimer's time base reading.
+	 * hrtimer's time base reading. A deferred server instead waits
+	 * for the last instant it can still consume its runtime by the
+	 * deadline.
 	 */
-	act = ns_to_ktime(dl_next_period(dl_se));
+	if (dl_se->dl_defer_armed)
+		act = ns_to_ktime(dl_se->deadline - dl_se->runtime);
+	else
+		act = ns_to_ktime(dl_next_period(dl_se));
 	now = hrtimer_cb_get_time(timer);
 	delta = ktime_to_ns(now) - rq_clock(rq);
 	act = ktime_add_ns(act, delta);
@@ -1085,13 +1124,17 @@ static int start_dl_timer(struct task_struct *p)
 	 * and observe our state.
 	 */
 	if (!hrtimer_is_queued(timer)) {
-		get_task_struct(p);
+		if (!dl_server(dl_se))
+			get_task_struct(dl_task_of(dl_se));
 		hrtimer_start(timer, act, HRTIMER_MODE_ABS_HARD);
 	}
 
 	return 1;
 }
 
+static enum hrtimer_restart dl_server_timer(struct hrtimer *timer,
+					    struct sched_dl_entity *dl_se);
+
 /*
  * This is the bandwidth enforcement timer callback. If here, we know
  * a task is not on its dl_rq, since the fact that the timer was running
@@ -1110,10 +1153,14 @@ static enum hrtimer_restart dl_task_timer(struct hrtimer *timer)
 	struct sched_dl_entity *dl_se = container_of(timer,
 						     struct sched_dl_entity,
 						     dl_timer);
-	struct task_struct *p = dl_task_of(dl_se);
+	struct task_struct *p;
 	struct rq_flags rf;
 	struct rq *rq;
 
+	if (dl_server(dl_se))
+		return dl_server_timer(timer, dl_se);
+
+	p = dl_task_of(dl_se);
 	rq = task_rq_lock(p, &rf);
 
 	/*
@@ -1240,12 +1287,11 @@ void init_dl_task_timer(struct sched_dl_entity *dl_se)
  */
 static inline void dl_check_constrained_dl(struct sched_dl_entity *dl_se)
 {
-	struct task_struct *p = dl_task_of(dl_se);
 	struct rq *rq = rq_of_dl_rq(dl_rq_of_se(dl_se));
 
 	if (dl_time_before(dl_se->deadline, rq_clock(rq)) &&
 	    dl_time_before(rq_clock(rq), dl_next_period(dl_se))) {
-		if (unlikely(is_dl_boosted(dl_se) || !start_dl_timer(p)))
+		if (unlikely(is_dl_boosted(dl_se) || !start_dl_timer(dl_se)))
 			return;
 		dl_se->dl_throttled = 1;
 		if (dl_se->runtime > 0)
@@ -1300,6 +1346,30 @@ static u64 grub_reclaim(u64 delta, struct rq *rq, struct sched_dl_entity *dl_se)
 	return (delta * u_act) >> BW_SHIFT;
 }
 
+/*
+ * For tasks that participate in GRUB, we implement GRUB-PA: the
+ * spare reclaimed bandwidth is used to clock down frequency.
+ *
+ * For the others, we still need to scale reservation parameters
+ * according to current frequency and CPU maximum capacity.
+ */
+static u64 dl_scaled_delta_exec(struct rq *rq, struct sched_dl_entity *dl_se,
+				u64 delta_exec)
+{
+	unsigned long scale_freq, scale_cpu;
+	int cpu = cpu_of(rq);
+	u64 scaled_delta_exec;
+
+	if (unlikely(dl_se->flags & SCHED_FLAG_RECLAIM))
+		return grub_reclaim(delta_exec, rq, dl_se);
+
+	scale_freq = arch_scale_freq_capacity(cpu);
+	scale_cpu = arch_scale_cpu_capacity(cpu);
+	scaled_delta_exec = cap_scale(delta_exec, scale_freq);
+
+	return cap_scale(scaled_delta_exec, scale_cpu);
+}
+
 /*
  * Update the current task's runtime statistics (provided it is still
  * a -deadline task and has not been removed from the dl_rq).
@@ -1308,8 +1378,7 @@ static void update_curr_dl(struct rq *rq)
 {
 	struct task_struct *curr = rq->curr;
 	struct sched_dl_entity *dl_se = &curr->dl;
-	u64 delta_exec, scaled_delta_exec;
-	int cpu = cpu_of(rq);
+	u64 delta_exec;
 	u64 now;
 
 	if (!dl_task(curr) || !on_dl_rq(dl_se))
@@ -1341,26 +1410,7 @@ static void update_curr_dl(struct rq *rq)
 	if (dl_entity_is_special(dl_se))
 		return;
 
-	/*
-	 * For tasks that participate in GRUB, we implement GRUB-PA: the
-	 * spare reclaimed bandwidth is used to clock down frequency.
-	 *
-	 * For the others, we still need to scale reservation parameters
-	 * according to current frequency and CPU maximum capacity.
-	 */
-	if (unlikely(dl_se->flags & SCHED_FLAG_RECLAIM)) {
-		scaled_delta_exec = grub_reclaim(delta_exec,
-						 rq,
-						 &curr->dl);
-	} else {
-		unsigned long scale_freq = arch_scale_freq_capacity(cpu);
-		unsigned long scale_cpu = arch_scale_cpu_capacity(cpu);
-
-		scaled_delta_exec = cap_scale(delta_exec, scale_freq);
-		scaled_delta_exec = cap_scale(scaled_delta_exec, scale_cpu);
-	}
-
-	dl_se->runtime -= scaled_delta_exec;
+	dl_se->runtime -= dl_scaled_delta_exec(rq, dl_se, delta_exec);
 
 throttle:
 	if (dl_runtime_exceeded(dl_se) || dl_se->dl_yielded) {
@@ -1372,7 +1422,7 @@ static void update_curr_dl(struct rq *rq)
 			dl_se->dl_overrun = 1;
 
 		__dequeue_task_dl(rq, curr, 0);
-		if (unlikely(is_dl_boosted(dl_se) || !start_dl_timer(curr)))
+		if (unlikely(is_dl_boosted(dl_se) || !start_dl_timer(dl_se)))
 			enqueue_task_dl(rq, curr, ENQUEUE_REPLENISH);
 
 		if (!is_leftmost(curr, &rq->dl))
@@ -1505,28 +1555,32 @@ static inline void dec_dl_deadline(struct dl_rq *dl_rq, u64 deadline) {}
 static inline
 void inc_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 {
-	int prio = dl_task_of(dl_se)->prio;
 	u64 deadline = dl_se->deadline;
 
-	WARN_ON(!dl_prio(prio));
 	dl_rq->dl_nr_running++;
-	add_nr_running(rq_of_dl_rq(dl_rq), 1);
-
 	inc_dl_deadline(dl_rq, deadline);
+
+	/* A server's tasks are already accounted by their own class */
+	if (dl_server(dl_se))
+		return;
+
+	WARN_ON(!dl_prio(dl_task_of(dl_se)->prio));
+	add_nr_running(rq_of_dl_rq(dl_rq), 1);
 	inc_dl_migration(dl_se, dl_rq);
 }
 
 static inline
 void dec_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 {
-	int prio = dl_task_of(dl_se)->prio;
-
-	WARN_ON(!dl_prio(prio));
 	WARN_ON(!dl_rq->dl_nr_running);
 	dl_rq->dl_nr_running--;
-	sub_nr_running(rq_of_dl_rq(dl_rq), 1);
-
 	dec_dl_deadline(dl_rq, dl_se->deadline);
+
+	if (dl_server(dl_se))
+		return;
+
+	WARN_ON(!dl_prio(dl_task_of(dl_se)->prio));
+	sub_nr_running(rq_of_dl_rq(dl_rq), 1);
 	dec_dl_migration(dl_se, dl_rq);
 }
 
@@ -1781,6 +1835,230 @@ static void dequeue_task_dl(struct rq *rq, struct task_struct *p, int flags)
 		task_non_contending(p);
 }
 
+/*
+ * Deadline servers.
+ *
+ * A server is a plain CBS on the dl_rq that, when picked, hands the CPU
+ * to a task of the class it serves. It is only ever enqueued at its
+ * zero-laxity point -- deadline - runtime -- and all the time its tasks
+ * run before that, picked by their own class, is charged against it as
+ * well. So the server gets in the way of the classes above only when its
+ * tasks were starved for most of the period, and then only for what is
+ * left of their reservation.
+ *
+ * The server does not take part in GRUB or in the root domain's
+ * admission control, and is not pushed or pulled between CPUs.
+ */
+static void dl_server_enqueue(struct sched_dl_entity *dl_se)
+{
+	struct rq *rq = dl_se->rq;
+
+	if (on_dl_rq(dl_se) || !dl_se->server_has_tasks(dl_se))
+		return;
+
+	enqueue_dl_entity(dl_se, 0);
+	if (!dl_task(rq->curr) || dl_entity_preempt(dl_se, &rq->curr->dl))
+		resched_curr(rq);
+}
+
+static void dl_server_defer(struct sched_dl_entity *dl_se)
+{
+	dl_se->dl_defer_armed = 1;
+	if (start_dl_timer(dl_se))
+		return;
+
+	/* already at zero laxity */
+	dl_se->dl_defer_armed = 0;
+	dl_server_enqueue(dl_se);
+}
+
+static void dl_server_cancel_defer(struct sched_dl_entity *dl_se)
+{
+	if (!dl_se->dl_defer_armed)
+		return;
+
+	/* a callback already running finds nothing to do */
+	hrtimer_try_to_cancel(&dl_se->dl_timer);
+	dl_se->dl_defer_armed = 0;
+}
+
+static enum hrtimer_restart dl_server_timer(struct hrtimer *timer,
+					    struct sched_dl_entity *dl_se)
+{
+	struct rq *rq = dl_se->rq;
+	struct rq_flags rf;
+
+	rq_lock(rq, &rf);
+
+	/* Re-armed while we were waiting for the lock */
+	if (hrtimer_is_queued(timer))
+		goto unlock;
+
+	sched_clock_tick();
+	update_rq_clock(rq);
+
+	if (dl_se->dl_throttled) {
+		replenish_dl_entity(dl_se);
+		if (dl_se->dl_server_active)
+			dl_server_defer(dl_se);
+	} else if (dl_se->dl_defer_armed) {
+		dl_se->dl_defer_armed = 0;
+		if (dl_se->dl_server_active)
+			dl_server_enqueue(dl_se);
+	}
+
+unlock:
+	rq_unlock(rq, &rf);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Charge @delta_exec of the served tasks' runtime to @dl_se, whether they
+ * got it through the server or on their own.
+ */
+void dl_server_update(struct sched_dl_entity *dl_se, s64 delta_exec)
+{
+	struct rq *rq = dl_se->rq;
+
+	if (!dl_se->dl_server_active || dl_se->dl_throttled || delta_exec <= 0)
+		return;
+
+	dl_se->runtime -= dl_scaled_delta_exec(rq, dl_se, delta_exec);
+	if (!dl_runtime_exceeded(dl_se))
+		return;
+
+	/* Served for this period, wait for the next one */
+	dl_se->dl_throttled = 1;
+	dl_server_cancel_defer(dl_se);
+	if (on_dl_rq(dl_se)) {
+		dequeue_dl_entity(dl_se);
+		resched_curr(rq);
+	}
+
+	if (!start_dl_timer(dl_se)) {
+		replenish_dl_entity(dl_se);
+		dl_server_defer(dl_se);
+	}
+}
+
+void dl_server_start(struct sched_dl_entity *dl_se)
+{
+	struct rq *rq = dl_se->rq;
+
+	if (!dl_se->dl_runtime || dl_se->dl_server_active)
+		return;
+
+	dl_se->dl_server_active = 1;
+
+	/* The replenishment timer defers it again */
+	if (dl_se->dl_throttled)
+		return;
+
+	if (!dl_time_before(rq_clock(rq), dl_se->deadline))
+		replenish_dl_new_period(dl_se, rq);
+
+	dl_server_defer(dl_se);
+}
+
+void dl_server_stop(struct sched_dl_entity *dl_se)
+{
+	if (!dl_se->dl_server_active)
+		return;
+
+	dl_server_cancel_defer(dl_se);
+	dequeue_dl_entity(dl_se);
+	dl_se->dl_server_active = 0;
+}
+
+void dl_server_init(struct sched_dl_entity *dl_se, struct rq *rq,
+		    bool (*has_tasks)(struct sched_dl_entity *dl_se),
+		    struct task_struct *(*pick)(struct sched_dl_entity *dl_se))
+{
+	RB_CLEAR_NODE(&dl_se->rb_node);
+	init_dl_task_timer(dl_se);
+#ifdef CONFIG_RT_MUTEXES
+	dl_se->pi_se = dl_se;
+#endif
+	dl_se->dl_server = 1;
+	dl_se->rq = rq;
+	dl_se->server_has_tasks = has_tasks;
+	dl_se->server_pick = pick;
+}
+
+/*
+ * Change the reservation of @dl_se; a @runtime of 0 disables it. The
+ * caller holds the server's rq lock, unless the server was never started.
+ */
+void dl_server_apply_params(struct sched_dl_entity *dl_se, u64 runtime,
+			    u64 period)
+{
+	bool active = dl_se->dl_server_active;
+
+	dl_server_stop(dl_se);
+	if (dl_se->dl_throttled) {
+		hrtimer_try_to_cancel(&dl_se->dl_timer);
+		dl_se->dl_throttled = 0;
+	}
+
+	dl_se->dl_runtime = runtime;
+	dl_se->dl_deadline = period;
+	dl_se->dl_period = period;
+	dl_se->dl_bw = to_ratio(period, runtime);
+	dl_se->dl_density = dl_se->dl_bw;
+
+	/* Start over with a new period */
+	dl_se->runtime = 0;
+	dl_se->deadline = 0;
+
+	if (active)
+		dl_server_start(dl_se);
+}
+
+#ifdef CONFIG_SYSCTL
+static int sched_fair_server_handler(struct ctl_table *table, int write,
+				     void *buffer, size_t *lenp, loff_t *ppos)
+{
+	unsigned int old_runtime, old_period;
+	static DEFINE_MUTEX(mutex);
+	int cpu, ret;
+
+	mutex_lock(&mutex);
+	old_runtime = sysctl_sched_fair_server_runtime;
+	old_period = sysctl_sched_fair_server_period;
+
+	ret = proc_douintvec(table, write, buffer, lenp, ppos);
+	if (ret || !write)
+		goto unlock;
+
+	if (sysctl_sched_fair_server_runtime > sysctl_sched_fair_server_period ||
+	    sysctl_sched_fair_server_period < sysctl_sched_dl_period_min ||
+	    sysctl_sched_fair_server_period > sysctl_sched_dl_period_max) {
+		sysctl_sched_fair_server_runtime = old_runtime;
+		sysctl_sched_fair_server_period = old_period;
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+		struct rq_flags rf;
+
+		rq_lock_irqsave(rq, &rf);
+		update_rq_clock(rq);
+		dl_server_apply_params(&rq->fair_server,
+			(u64)sysctl_sched_fair_server_runtime * NSEC_PER_USEC,
+			(u64)sysctl_sched_fair_server_period * NSEC_PER_USEC);
+		rq_unlock_irqrestore(rq, &rf);
+	}
+
+unlock:
+	mutex_unlock(&mutex);
+
+	return ret;
+}
+#endif
+
 /*
  * Yield task semantic for -deadline tasks is:
  *
@@ -2023,6 +2301,18 @@ static struct task_struct *pick_task_dl(struct rq *rq)
 
 	dl_se = pick_next_dl_entity(dl_rq);
 	WARN_ON_ONCE(!dl_se);
+
+	/*
+	 * Core scheduling needs a pick without side effects, which a server
+	 * cannot give; there its tasks just compete in their own class.
+	 */
+	if (dl_server(dl_se)) {
+		struct rb_node *next = rb_next(&dl_se->rb_node);
+
+		if (!next)
+			return NULL;
+		dl_se = __node_2_dle(next);
+	}
 	p = dl_task_of(dl_se);
 
 	return p;
@@ -2030,11 +2320,29 @@ static struct task_struct *pick_task_dl(struct rq *rq)
 
 static struct task_struct *pick_next_task_dl(struct rq *rq)
 {
+	struct sched_dl_entity *dl_se;
 	struct task_struct *p;
 
-	p = pick_task_dl(rq);
-	if (p)
-		set_next_task_dl(rq, p, true);
+again:
+	if (!sched_dl_runnable(rq))
+		return NULL;
+
+	dl_se = pick_next_dl_entity(&rq->dl);
+	WARN_ON_ONCE(!dl_se);
+
+	if (dl_server(dl_se)) {
+		p = dl_se->server_pick(dl_se);
+		if (!p) {
+			/* e.g. all of them sit in throttled cfs_rqs */
+			dl_server_stop(dl_se);
+			goto again;
+		}
+
+		return p;
+	}
+
+	p = dl_task_of(dl_se);
+	set_next_task_dl(rq, p, true);
 
 	return p;
 }
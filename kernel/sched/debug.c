@@ -333,6 +333,26 @@ static const struct file_operations sched_debug_fops = {
 	.release	= seq_release,
 };
 
+#ifdef CONFIG_SCHEDSTATS
+/* One line per CPU, the bucket counts as described for struct sched_lat_hist */
+static int sched_lat_hist_show(struct seq_file *m, void *v)
+{
+	int cpu, i;
+
+	for_each_online_cpu(cpu) {
+		struct sched_lat_hist *hist = &cpu_rq(cpu)->rq_lat_hist;
+
+		seq_printf(m, "cpu%d", cpu);
+		for (i = 0; i < SCHED_LAT_HIST_NR; i++)
+			seq_printf(m, " %llu", READ_ONCE(hist->count[i]));
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sched_lat_hist);
+#endif
+
 static struct dentry *debugfs_sched;
 
 static __init int sched_init_debug(void)
@@ -376,6 +396,9 @@ static __init int sched_init_debug(void)
 #endif
 
 	debugfs_create_file("debug", 0444, debugfs_sched, NULL, &sched_debug_fops);
+#ifdef CONFIG_SCHEDSTATS
+	debugfs_create_file("latency_hist", 0444, debugfs_sched, NULL, &sched_lat_hist_fops);
+#endif
 
 	return 0;
 }
@@ -422,6 +445,7 @@ static void register_sd(struct sched_domain *sd, struct dentry *parent)
 	SDM(u32,   0644, busy_factor);
 	SDM(u32,   0644, imbalance_pct);
 	SDM(u32,   0644, cache_nice_tries);
+	SDM(u64,   0644, migration_cost);
 	SDM(str,   0444, name);
 
 #undef SDM
@@ -1089,6 +1113,7 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 #endif
 	P(policy);
 	P(prio);
+	__PS("latency_nice", LATENCY_TO_NICE(p->latency_prio));
 	if (task_has_dl_policy(p)) {
 		P(dl.runtime);
 		P(dl.deadline);
@@ -0,0 +1,1077 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * BPF extensible scheduling class (SCHED_EXT)
+ *
+ * The policy for SCHED_EXT tasks is implemented by a BPF program attached as
+ * a struct sched_ext_ops. The kernel keeps the tasks on dispatch queues
+ * (DSQs), which are plain FIFOs:
+ *
+ *  - each rq has a local DSQ, which is the only thing its CPU runs ext
+ *    tasks from;
+ *
+ *  - the global DSQ and the user DSQs created by the BPF scheduler are
+ *    shared by all CPUs. A CPU out of local tasks calls ops.dispatch() so
+ *    the BPF scheduler can pull tasks over with scx_bpf_consume(), and then
+ *    falls back to the global DSQ.
+ *
+ * ops.select_cpu() picks the wakeup CPU and ops.enqueue() the DSQ a runnable
+ * task goes to. Nothing the BPF program does can take the system down: an
+ * invalid decision, scx_bpf_error() or a task left runnable for longer than
+ * ops.timeout_ms without getting to run unloads the BPF scheduler and puts
+ * every SCHED_EXT task back into CFS, where they also live while no BPF
+ * scheduler is loaded.
+ *
+ * The class sits right below CFS: ext tasks only run when no CFS task is
+ * runnable on that CPU.
+ */
+#include <linux/bpf.h>
+#include <linux/bpf_verifier.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+
+#define SCX_WATCHDOG_MAX_TIMEOUT	(30 * HZ)
+
+enum scx_ops_state {
+	SCX_OPS_DISABLED,
+	SCX_OPS_PREPPING,	/* in ops.init() */
+	SCX_OPS_ENABLED,
+	SCX_OPS_DISABLING,
+};
+
+/*
+ * What a kfunc is allowed to do depends on the callback it is called from,
+ * which is tracked per CPU as ops are always called with preemption off.
+ */
+struct scx_dsp_ctx {
+	struct rq		*rq;
+	struct rq_flags		*rf;		/* set in ops.dispatch() */
+	struct task_struct	*p;		/* set in ops.enqueue() */
+	u64			enq_flags;
+	bool			dispatched;
+};
+
+DEFINE_STATIC_KEY_FALSE(__scx_ops_enabled);
+
+static DEFINE_MUTEX(scx_ops_enable_mutex);
+static atomic_t scx_ops_state = ATOMIC_INIT(SCX_OPS_DISABLED);
+static atomic_t scx_exit_kind = ATOMIC_INIT(SCX_EXIT_NONE);
+static char scx_exit_msg[128];
+
+static struct sched_ext_ops scx_ops;
+static void *scx_ops_kdata;
+static unsigned long scx_watchdog_timeout;
+
+static struct scx_dispatch_q scx_dsq_global = {
+	.lock	= __RAW_SPIN_LOCK_UNLOCKED(scx_dsq_global.lock),
+	.fifo	= LIST_HEAD_INIT(scx_dsq_global.fifo),
+	.id	= SCX_DSQ_GLOBAL,
+};
+
+/* user DSQs by id */
+static DEFINE_XARRAY(scx_dsq_xa);
+
+static DEFINE_PER_CPU(struct scx_dsp_ctx, scx_dsp_ctx);
+static DEFINE_PER_CPU(cpumask_var_t, scx_kick_cpus);
+static DEFINE_PER_CPU(struct irq_work, scx_kick_work);
+
+static void scx_ops_disable_workfn(struct work_struct *work);
+static DECLARE_WORK(scx_ops_disable_work, scx_ops_disable_workfn);
+
+static void scx_watchdog_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(scx_watchdog_work, scx_watchdog_workfn);
+
+static void scx_error_irq_workfn(struct irq_work *irq_work)
+{
+	schedule_work(&scx_ops_disable_work);
+}
+
+static DEFINE_IRQ_WORK(scx_error_irq_work, scx_error_irq_workfn);
+
+/* The BPF callbacks may only be called while this is true */
+static bool scx_ops_active(void)
+{
+	return atomic_read(&scx_ops_state) == SCX_OPS_ENABLED &&
+	       atomic_read(&scx_exit_kind) == SCX_EXIT_NONE;
+}
+
+/*
+ * Record why the BPF scheduler has to go and get it unloaded. Only the first
+ * error is kept. This is called with rq locks held, so the disable work is
+ * queued from an irq_work.
+ */
+static __printf(2, 3) void scx_ops_error_kind(enum scx_exit_kind kind,
+					      const char *fmt, ...)
+{
+	va_list args;
+
+	if (atomic_cmpxchg(&scx_exit_kind, SCX_EXIT_NONE, kind) != SCX_EXIT_NONE)
+		return;
+
+	va_start(args, fmt);
+	vscnprintf(scx_exit_msg, sizeof(scx_exit_msg), fmt, args);
+	va_end(args);
+
+	irq_work_queue(&scx_error_irq_work);
+}
+
+#define scx_ops_error(fmt, args...) \
+	scx_ops_error_kind(SCX_EXIT_ERROR, fmt, ##args)
+
+static void scx_kick_workfn(struct irq_work *irq_work)
+{
+	struct cpumask *kick = this_cpu_cpumask_var_ptr(scx_kick_cpus);
+	s32 cpu;
+
+	for_each_cpu(cpu, kick) {
+		cpumask_clear_cpu(cpu, kick);
+		resched_cpu(cpu);
+	}
+}
+
+/* Make @cpu go through the scheduler, can be called with rq locks held */
+static void scx_kick_cpu(s32 cpu)
+{
+	cpumask_set_cpu(cpu, this_cpu_cpumask_var_ptr(scx_kick_cpus));
+	irq_work_queue(this_cpu_ptr(&scx_kick_work));
+}
+
+static s32 scx_pick_idle_cpu(struct task_struct *p, s32 prev_cpu)
+{
+	s32 cpu;
+
+	if (prev_cpu >= 0 && cpumask_test_cpu(prev_cpu, p->cpus_ptr) &&
+	    available_idle_cpu(prev_cpu))
+		return prev_cpu;
+
+	for_each_cpu_and(cpu, p->cpus_ptr, cpu_active_mask) {
+		if (available_idle_cpu(cpu))
+			return cpu;
+	}
+
+	return -EBUSY;
+}
+
+/*
+ * A task is moved on and off DSQs only under its rq lock. Shared DSQs also
+ * take their own lock, which nests inside the rq lock.
+ */
+static void dispatch_enqueue(struct scx_dispatch_q *dsq, struct task_struct *p,
+			     u64 enq_flags)
+{
+	bool is_local = dsq->id == SCX_DSQ_LOCAL;
+
+	if (!is_local)
+		raw_spin_lock(&dsq->lock);
+
+	if (enq_flags & SCX_ENQ_HEAD)
+		list_add(&p->scx.dsq_node, &dsq->fifo);
+	else
+		list_add_tail(&p->scx.dsq_node, &dsq->fifo);
+	WRITE_ONCE(dsq->nr, dsq->nr + 1);
+	p->scx.dsq = dsq;
+
+	if (!is_local)
+		raw_spin_unlock(&dsq->lock);
+}
+
+static void dispatch_dequeue(struct task_struct *p)
+{
+	struct scx_dispatch_q *dsq = p->scx.dsq;
+	bool is_local;
+
+	if (!dsq)
+		return;
+
+	is_local = dsq->id == SCX_DSQ_LOCAL;
+	if (!is_local)
+		raw_spin_lock(&dsq->lock);
+
+	list_del_init(&p->scx.dsq_node);
+	WRITE_ONCE(dsq->nr, dsq->nr - 1);
+	p->scx.dsq = NULL;
+
+	if (!is_local)
+		raw_spin_unlock(&dsq->lock);
+}
+
+static struct scx_dispatch_q *find_user_dsq(u64 dsq_id)
+{
+	return xa_load(&scx_dsq_xa, dsq_id);
+}
+
+/* Queue @p of @rq on the DSQ the BPF scheduler asked for */
+static void dispatch_to(struct rq *rq, struct task_struct *p, u64 dsq_id,
+			u64 enq_flags)
+{
+	struct scx_dispatch_q *dsq;
+	s32 cpu = -1;
+
+	if ((dsq_id & SCX_DSQ_LOCAL_ON) == SCX_DSQ_LOCAL_ON) {
+		u64 target = dsq_id & SCX_DSQ_LOCAL_CPU_MASK;
+
+		if (target >= nr_cpu_ids || !cpumask_test_cpu(target, p->cpus_ptr)) {
+			scx_ops_error("invalid SCX_DSQ_LOCAL_ON cpu %llu for %s[%d]",
+				      target, p->comm, p->pid);
+			dsq_id = SCX_DSQ_GLOBAL;
+		} else if (target == cpu_of(rq)) {
+			dsq_id = SCX_DSQ_LOCAL;
+		} else if (!cpu_active(target)) {
+			/* going offline, a task pinned to it would be stranded */
+			dsq_id = SCX_DSQ_GLOBAL;
+		} else {
+			/* only @cpu may take it off the global DSQ */
+			cpu = target;
+			dsq_id = SCX_DSQ_GLOBAL;
+		}
+	}
+
+	if (dsq_id == SCX_DSQ_LOCAL) {
+		dispatch_enqueue(&rq->scx.local, p, enq_flags);
+		if ((enq_flags & SCX_ENQ_PREEMPT) && rq->curr != p &&
+		    rq->curr->sched_class == &ext_sched_class) {
+			rq->curr->scx.slice = 0;
+			resched_curr(rq);
+		}
+		return;
+	}
+
+	if (dsq_id == SCX_DSQ_GLOBAL) {
+		dsq = &scx_dsq_global;
+	} else {
+		dsq = find_user_dsq(dsq_id);
+		if (unlikely(!dsq)) {
+			scx_ops_error("non-existent DSQ 0x%llx for %s[%d]",
+				      dsq_id, p->comm, p->pid);
+			dsq = &scx_dsq_global;
+		}
+	}
+
+	p->scx.dsq_cpu = cpu;
+	dispatch_enqueue(dsq, p, enq_flags);
+
+	/* get a CPU to come and take it */
+	if (cpu < 0)
+		cpu = scx_pick_idle_cpu(p, cpu_of(rq));
+	if (cpu >= 0)
+		scx_kick_cpu(cpu);
+}
+
+static void do_enqueue_task(struct rq *rq, struct task_struct *p, u64 enq_flags)
+{
+	struct scx_dsp_ctx *ctx = this_cpu_ptr(&scx_dsp_ctx);
+
+	if (!p->scx.slice)
+		p->scx.slice = SCX_SLICE_DFL;
+	p->scx.dsq_cpu = -1;
+
+	/* going away, keep everything local until the tasks are moved to CFS */
+	if (!scx_ops_active()) {
+		dispatch_enqueue(&rq->scx.local, p, enq_flags);
+		return;
+	}
+
+	if (scx_ops.enqueue) {
+		ctx->rq = rq;
+		ctx->p = p;
+		ctx->enq_flags = enq_flags;
+		ctx->dispatched = false;
+		scx_ops.enqueue(p, enq_flags);
+		ctx->p = NULL;
+		if (ctx->dispatched)
+			return;
+	}
+
+	dispatch_to(rq, p, SCX_DSQ_GLOBAL, enq_flags);
+}
+
+/*
+ * Pull @p, seen on @dsq while @src_rq was its rq, over to @rq. Both rq locks
+ * are needed, so @rq's is dropped and everything is checked again once
+ * @src_rq's is held. Interrupts stay disabled throughout, which keeps @p from
+ * being freed.
+ */
+static bool consume_remote_task(struct rq *rq, struct rq_flags *rf,
+				struct scx_dispatch_q *dsq,
+				struct task_struct *p, struct rq *src_rq)
+{
+	s32 cpu = cpu_of(rq);
+	struct rq_flags srf;
+	bool moved = false;
+
+	rq_unpin_lock(rq, rf);
+	raw_spin_rq_unlock(rq);
+
+	rq_lock(src_rq, &srf);
+	if (task_rq(p) == src_rq && p->scx.dsq == dsq &&
+	    !task_on_cpu(src_rq, p) && !is_migration_disabled(p) &&
+	    cpumask_test_cpu(cpu, p->cpus_ptr)) {
+		update_rq_clock(src_rq);
+		deactivate_task(src_rq, p, 0);
+		set_task_cpu(p, cpu);
+		p->scx.flags |= SCX_TASK_CONSUMED;
+		moved = true;
+	}
+	rq_unlock(src_rq, &srf);
+
+	raw_spin_rq_lock(rq);
+	rq_repin_lock(rq, rf);
+
+	if (moved)
+		activate_task(rq, p, 0);
+
+	return moved;
+}
+
+/* Move the first task of @dsq that may run on @rq to @rq's local DSQ */
+static bool consume_dispatch_q(struct rq *rq, struct rq_flags *rf,
+			       struct scx_dispatch_q *dsq)
+{
+	s32 cpu = cpu_of(rq);
+	struct task_struct *p;
+
+	if (!READ_ONCE(dsq->nr))
+		return false;
+
+	raw_spin_lock(&dsq->lock);
+	list_for_each_entry(p, &dsq->fifo, scx.dsq_node) {
+		struct rq *src_rq = task_rq(p);
+
+		if (p->scx.dsq_cpu >= 0 && p->scx.dsq_cpu != cpu)
+			continue;
+
+		if (src_rq == rq) {
+			list_del_init(&p->scx.dsq_node);
+			WRITE_ONCE(dsq->nr, dsq->nr - 1);
+			p->scx.dsq = NULL;
+			raw_spin_unlock(&dsq->lock);
+			dispatch_enqueue(&rq->scx.local, p, 0);
+			return true;
+		}
+
+		if (!cpu_active(cpu) || is_migration_disabled(p) ||
+		    !cpumask_test_cpu(cpu, p->cpus_ptr))
+			continue;
+
+		raw_spin_unlock(&dsq->lock);
+
+		/* a wakeup may have filled the local DSQ while unlocked */
+		return consume_remote_task(rq, rf, dsq, p, src_rq) ||
+		       rq->scx.local.nr;
+	}
+	raw_spin_unlock(&dsq->lock);
+
+	return false;
+}
+
+static void update_curr_scx(struct rq *rq)
+{
+	struct task_struct *curr = rq->curr;
+	u64 delta_exec;
+	u64 now;
+
+	if (curr->sched_class != &ext_sched_class)
+		return;
+
+	now = rq_clock_task(rq);
+	delta_exec = now - curr->se.exec_start;
+	if (unlikely((s64)delta_exec <= 0))
+		return;
+
+	schedstat_set(curr->stats.exec_max,
+		      max(curr->stats.exec_max, delta_exec));
+
+	trace_sched_stat_runtime(curr, delta_exec, 0);
+
+	update_current_exec_runtime(curr, now, delta_exec);
+
+	curr->scx.slice -= min(curr->scx.slice, delta_exec);
+}
+
+static void enqueue_task_scx(struct rq *rq, struct task_struct *p, int flags)
+{
+	u64 enq_flags = 0;
+
+	p->scx.flags |= SCX_TASK_QUEUED;
+	p->scx.runnable_at = jiffies;
+	list_add_tail(&p->scx.runnable_node, &rq->scx.runnable_list);
+	rq->scx.nr_running++;
+	add_nr_running(rq, 1);
+
+	/* Kick cpufreq (see the comment in kernel/sched/sched.h). */
+	if (rq->scx.nr_running == 1)
+		cpufreq_update_util(rq, 0);
+
+	if (p->scx.flags & SCX_TASK_CONSUMED) {
+		p->scx.flags &= ~SCX_TASK_CONSUMED;
+		dispatch_enqueue(&rq->scx.local, p, 0);
+		return;
+	}
+
+	/* the running task rejoins a DSQ when it is switched out */
+	if (task_current(rq, p))
+		return;
+
+	if (flags & ENQUEUE_WAKEUP)
+		enq_flags |= SCX_ENQ_WAKEUP;
+
+	do_enqueue_task(rq, p, enq_flags);
+}
+
+static void dequeue_task_scx(struct rq *rq, struct task_struct *p, int flags)
+{
+	if (!(p->scx.flags & SCX_TASK_QUEUED))
+		return;
+
+	if (task_current(rq, p))
+		update_curr_scx(rq);
+
+	p->scx.flags &= ~SCX_TASK_QUEUED;
+	list_del_init(&p->scx.runnable_node);
+	rq->scx.nr_running--;
+	sub_nr_running(rq, 1);
+
+	dispatch_dequeue(p);
+}
+
+static void yield_task_scx(struct rq *rq)
+{
+	rq->curr->scx.slice = 0;
+}
+
+static void check_preempt_curr_scx(struct rq *rq, struct task_struct *p,
+				   int wake_flags)
+{
+	/* ext tasks only preempt each other through SCX_ENQ_PREEMPT */
+}
+
+static void set_next_task_scx(struct rq *rq, struct task_struct *p, bool first)
+{
+	dispatch_dequeue(p);
+	p->se.exec_start = rq_clock_task(rq);
+
+	/* decay the time the CPU spent outside the ext class */
+	if (rq->curr->sched_class != &ext_sched_class)
+		update_scx_rq_load_avg(rq_clock_pelt(rq), rq, 0);
+}
+
+static struct task_struct *pick_task_scx(struct rq *rq)
+{
+	return list_first_entry_or_null(&rq->scx.local.fifo,
+					struct task_struct, scx.dsq_node);
+}
+
+static struct task_struct *pick_next_task_scx(struct rq *rq)
+{
+	struct task_struct *p = pick_task_scx(rq);
+
+	if (p)
+		set_next_task_scx(rq, p, true);
+
+	return p;
+}
+
+static void put_prev_task_scx(struct rq *rq, struct task_struct *p)
+{
+	update_curr_scx(rq);
+	update_scx_rq_load_avg(rq_clock_pelt(rq), rq, 1);
+
+	/* dequeued, or about to move to another class */
+	if (!(p->scx.flags & SCX_TASK_QUEUED))
+		return;
+
+	p->scx.runnable_at = jiffies;
+	list_move_tail(&p->scx.runnable_node, &rq->scx.runnable_list);
+
+	/* preempted by a higher class, finish the slice first */
+	if (p->scx.slice)
+		dispatch_enqueue(&rq->scx.local, p, SCX_ENQ_HEAD);
+	else
+		do_enqueue_task(rq, p, 0);
+}
+
+static int balance_scx(struct rq *rq, struct task_struct *prev,
+		       struct rq_flags *rf)
+{
+	struct scx_dsp_ctx *ctx = this_cpu_ptr(&scx_dsp_ctx);
+	bool prev_queued = prev->sched_class == &ext_sched_class &&
+			   (prev->scx.flags & SCX_TASK_QUEUED);
+
+	if (rq->scx.local.nr)
+		return 1;
+
+	/* @prev goes back to the head of the local DSQ */
+	if (prev_queued && prev->scx.slice)
+		return 1;
+
+	if (scx_ops_active() && scx_ops.dispatch) {
+		ctx->rq = rq;
+		ctx->rf = rf;
+		scx_ops.dispatch(cpu_of(rq), prev_queued ? prev : NULL);
+		ctx->rf = NULL;
+		if (rq->scx.local.nr)
+			return 1;
+	}
+
+	if (consume_dispatch_q(rq, rf, &scx_dsq_global))
+		return 1;
+
+	/* nothing else to run here, let @prev have another slice */
+	if (prev->sched_class == &ext_sched_class &&
+	    (prev->scx.flags & SCX_TASK_QUEUED)) {
+		prev->scx.slice = SCX_SLICE_DFL;
+		return 1;
+	}
+
+	return 0;
+}
+
+void scx_balance(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
+{
+	/* a task above the ext class is runnable */
+	if (rq->nr_running != rq->scx.nr_running)
+		return;
+
+	balance_scx(rq, prev, rf);
+}
+
+static int select_task_rq_scx(struct task_struct *p, int prev_cpu,
+			      int wake_flags)
+{
+	s32 cpu;
+
+	if (!scx_ops_active() || !scx_ops.select_cpu) {
+		cpu = scx_pick_idle_cpu(p, prev_cpu);
+		return cpu >= 0 ? cpu : prev_cpu;
+	}
+
+	cpu = scx_ops.select_cpu(p, prev_cpu, wake_flags);
+	if (unlikely(cpu < 0 || cpu >= nr_cpu_ids ||
+		     !cpumask_test_cpu(cpu, p->cpus_ptr))) {
+		scx_ops_error("ops.select_cpu() picked invalid cpu %d for %s[%d]",
+			      cpu, p->comm, p->pid);
+		return prev_cpu;
+	}
+
+	return cpu;
+}
+
+static void task_tick_scx(struct rq *rq, struct task_struct *curr, int queued)
+{
+	update_curr_scx(rq);
+	update_scx_rq_load_avg(rq_clock_pelt(rq), rq, 1);
+
+	/* nothing else re-evaluates the frequency of an ext only CPU */
+	cpufreq_update_util(rq, 0);
+
+	if (!curr->scx.slice)
+		resched_curr(rq);
+}
+
+/*
+ * Tasks dispatched to this CPU's local DSQ from another CPU wait on the
+ * global DSQ for it, and no other CPU takes them. Let any CPU have them now
+ * that this one is going away.
+ */
+static void rq_offline_scx(struct rq *rq)
+{
+	s32 cpu = cpu_of(rq);
+	struct task_struct *p;
+	bool kick = false;
+
+	raw_spin_lock(&scx_dsq_global.lock);
+	list_for_each_entry(p, &scx_dsq_global.fifo, scx.dsq_node) {
+		if (p->scx.dsq_cpu == cpu) {
+			p->scx.dsq_cpu = -1;
+			kick = true;
+		}
+	}
+	raw_spin_unlock(&scx_dsq_global.lock);
+
+	if (kick) {
+		cpu = cpumask_any_but(cpu_active_mask, cpu);
+		if (cpu < nr_cpu_ids)
+			scx_kick_cpu(cpu);
+	}
+}
+
+static void switched_to_scx(struct rq *rq, struct task_struct *p)
+{
+	if (task_on_rq_queued(p) && rq->curr->sched_class == &idle_sched_class)
+		resched_curr(rq);
+}
+
+static void prio_changed_scx(struct rq *rq, struct task_struct *p, int oldprio)
+{
+}
+
+DEFINE_SCHED_CLASS(ext) = {
+	.enqueue_task		= enqueue_task_scx,
+	.dequeue_task		= dequeue_task_scx,
+	.yield_task		= yield_task_scx,
+
+	.check_preempt_curr	= check_preempt_curr_scx,
+
+	.pick_next_task		= pick_next_task_scx,
+	.put_prev_task		= put_prev_task_scx,
+	.set_next_task		= set_next_task_scx,
+
+	.balance		= balance_scx,
+	.pick_task		= pick_task_scx,
+	.select_task_rq		= select_task_rq_scx,
+	.set_cpus_allowed	= set_cpus_allowed_common,
+	.rq_offline		= rq_offline_scx,
+
+	.task_tick		= task_tick_scx,
+
+	.switched_to		= switched_to_scx,
+	.prio_changed		= prio_changed_scx,
+
+	.update_curr		= update_curr_scx,
+};
+
+void scx_post_fork(struct task_struct *p)
+{
+	/* sched_fork() may have raced with the BPF scheduler coming or going */
+	if (p->policy == SCHED_EXT)
+		sched_ext_update_class(p);
+}
+
+/*
+ * A runnable task that didn't get to run for the whole timeout means the BPF
+ * scheduler lost track of it, or CFS kept the CPUs it needs busy.
+ */
+static void scx_watchdog_workfn(struct work_struct *work)
+{
+	unsigned long timeout = scx_watchdog_timeout;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+		struct task_struct *p;
+		struct rq_flags rf;
+
+		rq_lock_irqsave(rq, &rf);
+		list_for_each_entry(p, &rq->scx.runnable_list, scx.runnable_node) {
+			if (task_current(rq, p))
+				continue;
+			if (time_after(jiffies, p->scx.runnable_at + timeout))
+				scx_ops_error_kind(SCX_EXIT_ERROR_STALL,
+						   "%s[%d] stalled for %u ms",
+						   p->comm, p->pid,
+						   jiffies_to_msecs(jiffies - p->scx.runnable_at));
+			break;
+		}
+		rq_unlock_irqrestore(rq, &rf);
+
+		cond_resched();
+	}
+
+	queue_delayed_work(system_unbound_wq, to_delayed_work(work),
+			   timeout / 2);
+}
+
+static void scx_free_dsqs(void)
+{
+	struct scx_dispatch_q *dsq;
+	unsigned long id;
+
+	xa_for_each(&scx_dsq_xa, id, dsq) {
+		xa_erase(&scx_dsq_xa, id);
+		WARN_ON_ONCE(dsq->nr);
+		kfree_rcu(dsq, rcu);
+	}
+}
+
+static int scx_ops_enable(struct sched_ext_ops *ops)
+{
+	struct task_struct *g, *p;
+	int ret = 0;
+
+	mutex_lock(&scx_ops_enable_mutex);
+
+	if (atomic_read(&scx_ops_state) != SCX_OPS_DISABLED) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	scx_ops = *ops;
+	scx_ops_kdata = ops;
+	scx_watchdog_timeout = ops->timeout_ms ?
+		msecs_to_jiffies(ops->timeout_ms) : SCX_WATCHDOG_MAX_TIMEOUT;
+	atomic_set(&scx_exit_kind, SCX_EXIT_NONE);
+	atomic_set(&scx_ops_state, SCX_OPS_PREPPING);
+
+	if (scx_ops.init) {
+		ret = scx_ops.init();
+		if (!ret && atomic_read(&scx_exit_kind) != SCX_EXIT_NONE)
+			ret = -EINVAL;
+		if (ret) {
+			scx_free_dsqs();
+			scx_ops_kdata = NULL;
+			atomic_set(&scx_ops_state, SCX_OPS_DISABLED);
+			goto out_unlock;
+		}
+	}
+
+	atomic_set(&scx_ops_state, SCX_OPS_ENABLED);
+	static_branch_enable(&__scx_ops_enabled);
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, p) {
+		if (p->policy == SCHED_EXT)
+			sched_ext_update_class(p);
+	}
+	read_unlock(&tasklist_lock);
+
+	queue_delayed_work(system_unbound_wq, &scx_watchdog_work,
+			   scx_watchdog_timeout / 2);
+
+	pr_info("sched_ext: BPF scheduler \"%s\" enabled\n", scx_ops.name);
+
+out_unlock:
+	mutex_unlock(&scx_ops_enable_mutex);
+	return ret;
+}
+
+/* Move everything back to CFS once scx_exit_kind says why */
+static void scx_ops_disable_workfn(struct work_struct *work)
+{
+	struct task_struct *g, *p;
+	int kind;
+
+	mutex_lock(&scx_ops_enable_mutex);
+
+	kind = atomic_read(&scx_exit_kind);
+	if (atomic_read(&scx_ops_state) != SCX_OPS_ENABLED ||
+	    kind == SCX_EXIT_NONE)
+		goto out_unlock;
+
+	atomic_set(&scx_ops_state, SCX_OPS_DISABLING);
+	cancel_delayed_work_sync(&scx_watchdog_work);
+
+	static_branch_disable(&__scx_ops_enabled);
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, p) {
+		if (p->sched_class == &ext_sched_class)
+			sched_ext_update_class(p);
+	}
+	read_unlock(&tasklist_lock);
+
+	/* callbacks run with preemption disabled, none is left after this */
+	synchronize_rcu();
+
+	if (kind == SCX_EXIT_UNREG)
+		pr_info("sched_ext: BPF scheduler \"%s\" disabled\n",
+			scx_ops.name);
+	else
+		pr_err("sched_ext: BPF scheduler \"%s\" disabled: %s\n",
+		       scx_ops.name, scx_exit_msg);
+
+	if (scx_ops.exit)
+		scx_ops.exit(kind);
+
+	WARN_ON_ONCE(scx_dsq_global.nr);
+	scx_free_dsqs();
+	scx_ops_kdata = NULL;
+	atomic_set(&scx_ops_state, SCX_OPS_DISABLED);
+
+out_unlock:
+	mutex_unlock(&scx_ops_enable_mutex);
+}
+
+static void scx_ops_unreg(void *kdata)
+{
+	mutex_lock(&scx_ops_enable_mutex);
+	if (scx_ops_kdata == kdata)
+		atomic_cmpxchg(&scx_exit_kind, SCX_EXIT_NONE, SCX_EXIT_UNREG);
+	mutex_unlock(&scx_ops_enable_mutex);
+
+	/* the BPF programs are freed once this returns */
+	scx_ops_disable_workfn(NULL);
+}
+
+void __init init_sched_ext_class(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		raw_spin_lock_init(&rq->scx.local.lock);
+		INIT_LIST_HEAD(&rq->scx.local.fifo);
+		rq->scx.local.id = SCX_DSQ_LOCAL;
+		INIT_LIST_HEAD(&rq->scx.runnable_list);
+
+		BUG_ON(!zalloc_cpumask_var_node(&per_cpu(scx_kick_cpus, cpu),
+						GFP_KERNEL, cpu_to_node(cpu)));
+		per_cpu(scx_kick_work, cpu) = IRQ_WORK_INIT_HARD(scx_kick_workfn);
+	}
+}
+
+__diag_push();
+__diag_ignore_all("-Wmissing-prototypes",
+		  "Global functions as their definitions will be in vmlinux BTF");
+
+/**
+ * scx_bpf_create_dsq - create a user DSQ
+ * @dsq_id: id of the new DSQ, SCX_DSQ_FLAG_BUILTIN must be clear
+ *
+ * Only allowed from ops.init(). The DSQ lives until the BPF scheduler is
+ * unloaded.
+ */
+__bpf_kfunc s32 scx_bpf_create_dsq(u64 dsq_id)
+{
+	struct scx_dispatch_q *dsq;
+	int ret;
+
+	if (atomic_read(&scx_ops_state) != SCX_OPS_PREPPING)
+		return -EINVAL;
+	if (dsq_id & SCX_DSQ_FLAG_BUILTIN)
+		return -EINVAL;
+
+	dsq = kzalloc(sizeof(*dsq), GFP_NOWAIT);
+	if (!dsq)
+		return -ENOMEM;
+
+	raw_spin_lock_init(&dsq->lock);
+	INIT_LIST_HEAD(&dsq->fifo);
+	dsq->id = dsq_id;
+
+	ret = xa_insert(&scx_dsq_xa, dsq_id, dsq, GFP_NOWAIT);
+	if (ret)
+		kfree(dsq);
+
+	return ret;
+}
+
+/**
+ * scx_bpf_dispatch - queue a task on a DSQ
+ * @p: the task passed to ops.enqueue()
+ * @dsq_id: SCX_DSQ_LOCAL, SCX_DSQ_LOCAL_ON | cpu, SCX_DSQ_GLOBAL or a user DSQ
+ * @slice: new time slice in nsecs, 0 keeps the current one
+ * @enq_flags: SCX_ENQ_*
+ *
+ * Only allowed once per ops.enqueue() call, for the task being enqueued.
+ */
+__bpf_kfunc void scx_bpf_dispatch(struct task_struct *p, u64 dsq_id, u64 slice,
+				  u64 enq_flags)
+{
+	struct scx_dsp_ctx *ctx = this_cpu_ptr(&scx_dsp_ctx);
+
+	if (!scx_ops_active())
+		return;
+
+	if (!p || ctx->p != p || ctx->dispatched) {
+		scx_ops_error("scx_bpf_dispatch() of pid %d outside its ops.enqueue()",
+			      p ? p->pid : -1);
+		return;
+	}
+
+	if (slice)
+		p->scx.slice = slice;
+
+	ctx->dispatched = true;
+	dispatch_to(ctx->rq, p, dsq_id,
+		    ctx->enq_flags | (enq_flags & (SCX_ENQ_HEAD | SCX_ENQ_PREEMPT)));
+}
+
+/**
+ * scx_bpf_consume - move a task from a shared DSQ to the local DSQ
+ * @dsq_id: SCX_DSQ_GLOBAL or a user DSQ
+ *
+ * Only allowed from ops.dispatch(). Takes the first task on @dsq that may
+ * run on the dispatching CPU. Returns true if the local DSQ has a task now.
+ */
+__bpf_kfunc bool scx_bpf_consume(u64 dsq_id)
+{
+	struct scx_dsp_ctx *ctx = this_cpu_ptr(&scx_dsp_ctx);
+	struct scx_dispatch_q *dsq;
+
+	if (!scx_ops_active())
+		return false;
+
+	if (!ctx->rf) {
+		scx_ops_error("scx_bpf_consume() outside ops.dispatch()");
+		return false;
+	}
+
+	if (dsq_id == SCX_DSQ_GLOBAL) {
+		dsq = &scx_dsq_global;
+	} else {
+		dsq = find_user_dsq(dsq_id);
+		if (!dsq) {
+			scx_ops_error("scx_bpf_consume() of non-existent DSQ 0x%llx",
+				      dsq_id);
+			return false;
+		}
+	}
+
+	return consume_dispatch_q(ctx->rq, ctx->rf, dsq);
+}
+
+/**
+ * scx_bpf_dsq_nr_queued - number of tasks on a DSQ
+ * @dsq_id: SCX_DSQ_LOCAL for the current CPU, SCX_DSQ_GLOBAL or a user DSQ
+ */
+__bpf_kfunc s32 scx_bpf_dsq_nr_queued(u64 dsq_id)
+{
+	struct scx_dispatch_q *dsq;
+
+	if (dsq_id == SCX_DSQ_LOCAL)
+		return READ_ONCE(cpu_rq(smp_processor_id())->scx.local.nr);
+	if (dsq_id == SCX_DSQ_GLOBAL)
+		return READ_ONCE(scx_dsq_global.nr);
+
+	dsq = find_user_dsq(dsq_id);
+	return dsq ? READ_ONCE(dsq->nr) : -ENOENT;
+}
+
+/**
+ * scx_bpf_pick_idle_cpu - find an idle CPU @p may run on
+ * @p: task to find a CPU for
+ *
+ * Prefers the CPU @p last ran on. Returns -EBUSY if none is idle.
+ */
+__bpf_kfunc s32 scx_bpf_pick_idle_cpu(struct task_struct *p)
+{
+	if (!p)
+		return -EINVAL;
+
+	return scx_pick_idle_cpu(p, task_cpu(p));
+}
+
+/**
+ * scx_bpf_kick_cpu - make a CPU go through the scheduler
+ * @cpu: the CPU to kick
+ *
+ * An idle @cpu wakes up and runs ops.dispatch().
+ */
+__bpf_kfunc void scx_bpf_kick_cpu(s32 cpu)
+{
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_possible(cpu)) {
+		scx_ops_error("scx_bpf_kick_cpu() of invalid cpu %d", cpu);
+		return;
+	}
+
+	preempt_disable();
+	scx_kick_cpu(cpu);
+	preempt_enable();
+}
+
+/**
+ * scx_bpf_error - unload the BPF scheduler
+ * @code: reported in the kernel log
+ */
+__bpf_kfunc void scx_bpf_error(u64 code)
+{
+	scx_ops_error_kind(SCX_EXIT_ERROR_BPF, "scx_bpf_error(%llu)", code);
+}
+
+__diag_pop();
+
+BTF_SET8_START(scx_kfunc_ids)
+BTF_ID_FLAGS(func, scx_bpf_create_dsq)
+BTF_ID_FLAGS(func, scx_bpf_dispatch)
+BTF_ID_FLAGS(func, scx_bpf_consume)
+BTF_ID_FLAGS(func, scx_bpf_dsq_nr_queued)
+BTF_ID_FLAGS(func, scx_bpf_pick_idle_cpu)
+BTF_ID_FLAGS(func, scx_bpf_kick_cpu)
+BTF_ID_FLAGS(func, scx_bpf_error)
+BTF_SET8_END(scx_kfunc_ids)
+
+static const struct btf_kfunc_id_set scx_kfunc_set = {
+	.owner	= THIS_MODULE,
+	.set	= &scx_kfunc_ids,
+};
+
+/* "extern" is to avoid sparse warning.  It is only used in bpf_struct_ops.c. */
+extern struct bpf_struct_ops bpf_sched_ext_ops;
+
+static bool bpf_scx_is_valid_access(int off, int size,
+				    enum bpf_access_type type,
+				    const struct bpf_prog *prog,
+				    struct bpf_insn_access_aux *info)
+{
+	return bpf_tracing_btf_ctx_access(off, size, type, prog, info);
+}
+
+static const struct bpf_func_proto *
+bpf_scx_get_func_proto(enum bpf_func_id func_id, const struct bpf_prog *prog)
+{
+	return bpf_base_func_proto(func_id);
+}
+
+static const struct bpf_verifier_ops bpf_scx_verifier_ops = {
+	.get_func_proto		= bpf_scx_get_func_proto,
+	.is_valid_access	= bpf_scx_is_valid_access,
+};
+
+static int bpf_scx_init_member(const struct btf_type *t,
+			       const struct btf_member *member,
+			       void *kdata, const void *udata)
+{
+	const struct sched_ext_ops *uops = udata;
+	struct sched_ext_ops *ops = kdata;
+	u32 moff;
+
+	moff = __btf_member_bit_offset(t, member) / 8;
+	switch (moff) {
+	case offsetof(struct sched_ext_ops, timeout_ms):
+		if (msecs_to_jiffies(uops->timeout_ms) > SCX_WATCHDOG_MAX_TIMEOUT)
+			return -E2BIG;
+		ops->timeout_ms = uops->timeout_ms;
+		return 1;
+	case offsetof(struct sched_ext_ops, name):
+		if (bpf_obj_name_cpy(ops->name, uops->name,
+				     sizeof(ops->name)) <= 0)
+			return -EINVAL;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int bpf_scx_reg(void *kdata)
+{
+	return scx_ops_enable(kdata);
+}
+
+static void bpf_scx_unreg(void *kdata)
+{
+	scx_ops_unreg(kdata);
+}
+
+static int bpf_scx_update(void *kdata, void *old_kdata)
+{
+	/* the tasks would have to be moved between the schedulers */
+	return -EOPNOTSUPP;
+}
+
+static int bpf_scx_validate(void *kdata)
+{
+	return 0;
+}
+
+static int bpf_scx_init(struct btf *btf)
+{
+	return 0;
+}
+
+struct bpf_struct_ops bpf_sched_ext_ops = {
+	.verifier_ops = &bpf_scx_verifier_ops,
+	.reg = bpf_scx_reg,
+	.unreg = bpf_scx_unreg,
+	.update = bpf_scx_update,
+	.init_member = bpf_scx_init_member,
+	.init = bpf_scx_init,
+	.validate = bpf_scx_validate,
+	.name = "sched_ext_ops",
+};
+
+static int __init scx_kfunc_init(void)
+{
+	return register_btf_kfunc_id_set(BPF_PROG_TYPE_STRUCT_OPS,
+					 &scx_kfunc_set);
+}
+late_initcall(scx_kfunc_init);
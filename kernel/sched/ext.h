@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _KERNEL_SCHED_EXT_H
+#define _KERNEL_SCHED_EXT_H
+
+#ifdef CONFIG_SCHED_CLASS_EXT
+
+DECLARE_STATIC_KEY_FALSE(__scx_ops_enabled);
+#define scx_enabled()		static_branch_unlikely(&__scx_ops_enabled)
+
+/* SCHED_EXT tasks leave CFS for the ext class while a BPF scheduler is loaded */
+static inline bool task_should_scx(struct task_struct *p)
+{
+	return scx_enabled() && p->policy == SCHED_EXT;
+}
+
+extern void init_sched_ext_class(void);
+extern void scx_post_fork(struct task_struct *p);
+extern void scx_balance(struct rq *rq, struct task_struct *prev,
+			struct rq_flags *rf);
+extern void sched_ext_update_class(struct task_struct *p);
+
+#else /* !CONFIG_SCHED_CLASS_EXT */
+
+#define scx_enabled()		false
+
+static inline bool task_should_scx(struct task_struct *p)
+{
+	return false;
+}
+
+static inline void init_sched_ext_class(void) { }
+static inline void scx_post_fork(struct task_struct *p) { }
+static inline void scx_balance(struct rq *rq, struct task_struct *prev,
+			       struct rq_flags *rf) { }
+
+#endif /* CONFIG_SCHED_CLASS_EXT */
+#endif /* _KERNEL_SCHED_EXT_H */
@@ -510,6 +510,11 @@ static int tg_is_idle(struct task_group *tg)
 	return tg->idle > 0;
 }
 
+static inline unsigned long tg_effective_shares(struct task_group *tg)
+{
+	return max(READ_ONCE(tg->shares), READ_ONCE(tg->boost_shares));
+}
+
 static int cfs_rq_is_idle(struct cfs_rq *cfs_rq)
 {
 	return cfs_rq->idle > 0;
@@ -767,6 +772,18 @@ static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		slice = __calc_delta(slice, se->load.weight, load);
 	}
 
+	/*
+	 * Latency sensitive tasks run in shorter slices, down to half at
+	 * latency nice -20, tolerant ones in up to about twice as long.
+	 */
+	if (init_se->latency_weight) {
+		int weight = init_se->latency_weight;
+
+		if (weight < 0)
+			weight /= 2;
+		slice = div_u64(slice * (1024 + weight), 1024);
+	}
+
 	if (sched_feat(BASE_SLICE)) {
 		if (se_is_idle(init_se) && !sched_idle_cfs_rq(cfs_rq))
 			min_gran = sysctl_sched_idle_min_granularity;
@@ -929,6 +946,7 @@ static void update_curr(struct cfs_rq *cfs_rq)
 		trace_sched_stat_runtime(curtask, delta_exec, curr->vruntime);
 		cgroup_account_cputime(curtask, delta_exec);
 		account_group_exec_runtime(curtask, delta_exec);
+		dl_server_update(&rq_of(cfs_rq)->fair_server, delta_exec);
 	}
 
 	account_cfs_rq_runtime(cfs_rq, delta_exec);
@@ -3492,7 +3510,7 @@ static long calc_group_shares(struct cfs_rq *cfs_rq)
 	long tg_weight, tg_shares, load, shares;
 	struct task_group *tg = cfs_rq->tg;
 
-	tg_shares = READ_ONCE(tg->shares);
+	tg_shares = tg_effective_shares(tg);
 
 	load = max(scale_load_down(cfs_rq->load.weight), cfs_rq->avg.load_avg);
 
@@ -3538,7 +3556,7 @@ static void update_cfs_group(struct sched_entity *se)
 		return;
 
 #ifndef CONFIG_SMP
-	shares = READ_ONCE(gcfs_rq->tg->shares);
+	shares = tg_effective_shares(gcfs_rq->tg);
 
 	if (likely(se->load.weight == shares))
 		return;
@@ -5558,6 +5576,7 @@ void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
 
 	/* At this point se is NULL and we are at root level*/
 	add_nr_running(rq, task_delta);
+	dl_server_start(&rq->fair_server);
 
 unthrottle_throttle:
 	assert_list_leaf_cfs_rq(rq);
@@ -6300,6 +6319,40 @@ static int sched_idle_cpu(int cpu)
 }
 #endif
 
+#if defined(CONFIG_SMP) && defined(CONFIG_FAIR_GROUP_SCHED)
+/* One PELT period */
+#define LAZY_TG_UPDATE_NS	(1024 * 1024)
+
+/*
+ * An enqueue or dequeue updates the load of every ancestor group entity,
+ * which adds up with deep hierarchies and frequent switching. Skip an
+ * intermediate level whose entity was updated within the last PELT period:
+ * the tick and update_blocked_averages() will catch up with it. Always update
+ * the root level, which feeds schedutil, levels with a pending propagation
+ * and groups going from or to a single runnable task.
+ */
+static inline bool cfs_rq_lazy_update(struct cfs_rq *cfs_rq,
+				      struct sched_entity *se)
+{
+	struct cfs_rq *gcfs_rq = group_cfs_rq(se);
+
+	if (!sched_feat(LAZY_TG_UPDATE) || cfs_rq == &rq_of(cfs_rq)->cfs)
+		return false;
+
+	if (!gcfs_rq || gcfs_rq->h_nr_running <= 1 || gcfs_rq->propagate)
+		return false;
+
+	return cfs_rq_clock_pelt(cfs_rq) - se->avg.last_update_time <
+	       LAZY_TG_UPDATE_NS;
+}
+#else
+static inline bool cfs_rq_lazy_update(struct cfs_rq *cfs_rq,
+				      struct sched_entity *se)
+{
+	return false;
+}
+#endif
+
 /*
  * The enqueue_task method is called before nr_running is
  * increased. Here we update the fair scheduling stats and
@@ -6312,6 +6365,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	struct sched_entity *se = &p->se;
 	int idle_h_nr_running = task_has_idle_policy(p);
 	int task_new = !(flags & ENQUEUE_WAKEUP);
+	bool lazy;
 
 	/*
 	 * The code below (indirectly) updates schedutil which looks at
@@ -6350,10 +6404,13 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
+		lazy = cfs_rq_lazy_update(cfs_rq, se);
 
-		update_load_avg(cfs_rq, se, UPDATE_TG);
+		if (!lazy)
+			update_load_avg(cfs_rq, se, UPDATE_TG);
 		se_update_runnable(se);
-		update_cfs_group(se);
+		if (!lazy)
+			update_cfs_group(se);
 
 		cfs_rq->h_nr_running++;
 		cfs_rq->idle_h_nr_running += idle_h_nr_running;
@@ -6368,6 +6425,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 	/* At this point se is NULL and we are at root level*/
 	add_nr_running(rq, 1);
+	dl_server_start(&rq->fair_server);
 
 	/*
 	 * Since new tasks are assigned an initial util_avg equal to
@@ -6406,6 +6464,7 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	int task_sleep = flags & DEQUEUE_SLEEP;
 	int idle_h_nr_running = task_has_idle_policy(p);
 	bool was_sched_idle = sched_idle_rq(rq);
+	bool lazy;
 
 	util_est_dequeue(&rq->cfs, p);
 
@@ -6440,10 +6499,13 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
+		lazy = cfs_rq_lazy_update(cfs_rq, se);
 
-		update_load_avg(cfs_rq, se, UPDATE_TG);
+		if (!lazy)
+			update_load_avg(cfs_rq, se, UPDATE_TG);
 		se_update_runnable(se);
-		update_cfs_group(se);
+		if (!lazy)
+			update_cfs_group(se);
 
 		cfs_rq->h_nr_running--;
 		cfs_rq->idle_h_nr_running -= idle_h_nr_running;
@@ -6459,6 +6521,8 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 	/* At this point se is NULL and we are at root level*/
 	sub_nr_running(rq, 1);
+	if (!rq->cfs.h_nr_running)
+		dl_server_stop(&rq->fair_server);
 
 	/* balance early to pull high priority tasks */
 	if (unlikely(!was_sched_idle && sched_idle_rq(rq)))
@@ -7098,6 +7162,51 @@ select_idle_capacity(struct task_struct *p, struct sched_domain *sd, int target)
 	return best_cpu;
 }
 
+/*
+ * The groups of the asym_capacity domain are clusters of CPUs with the same
+ * capacity. Look for an idle CPU that fits @p in the cluster of @target
+ * first, then in the other clusters whose capacity may fit @p, so that a
+ * task outgrowing a little cluster goes straight to the big ones. Return -1
+ * if none was found and let select_idle_capacity() find the best partial fit.
+ */
+static int select_idle_capacity_cluster(struct task_struct *p,
+					struct sched_domain *sd, int target,
+					unsigned long task_util,
+					unsigned long util_min,
+					unsigned long util_max)
+{
+	struct sched_group *sg = sd->groups;
+	unsigned long util;
+	struct cpumask *cpus;
+	int cpu;
+
+	/* Without a child domain the groups are single CPUs */
+	if (!sd->child)
+		return -1;
+
+	cpus = this_cpu_cpumask_var_ptr(select_rq_mask);
+	util = uclamp_task_util(p, util_min, util_max);
+
+	do {
+		cpu = cpumask_first(sched_group_span(sg));
+		if (!fits_capacity(util, capacity_orig_of(cpu)))
+			goto next;
+
+		cpumask_and(cpus, sched_group_span(sg), p->cpus_ptr);
+		for_each_cpu_wrap(cpu, cpus, target) {
+			if (!available_idle_cpu(cpu) && !sched_idle_cpu(cpu))
+				continue;
+
+			if (util_fits_cpu(task_util, util_min, util_max, cpu) > 0)
+				return cpu;
+		}
+next:
+		sg = sg->next;
+	} while (sg != sd->groups);
+
+	return -1;
+}
+
 static inline bool asym_fits_cpu(unsigned long util,
 				 unsigned long util_min,
 				 unsigned long util_max,
@@ -7194,6 +7303,13 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 		 * capacity path.
 		 */
 		if (sd) {
+			if (sched_feat(SIS_ASYM_CLUSTER)) {
+				i = select_idle_capacity_cluster(p, sd, target,
+						task_util, util_min, util_max);
+				if ((unsigned)i < nr_cpumask_bits)
+					return i;
+			}
+
 			i = select_idle_capacity(p, sd, target);
 			return ((unsigned)i < nr_cpumask_bits) ? i : target;
 		}
@@ -7727,6 +7843,9 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 		/* Fast path */
 		new_cpu = select_idle_sibling(p, prev_cpu, new_cpu);
 	}
+
+	if (unlikely(!sched_cluster_cookie_match(cpu_rq(new_cpu), p)))
+		new_cpu = sched_cluster_cookie_cpu(p, new_cpu);
 	rcu_read_unlock();
 
 	return new_cpu;
@@ -7810,6 +7929,25 @@ static unsigned long wakeup_gran(struct sched_entity *se)
 	return calc_delta_fair(gran, se);
 }
 
+/*
+ * How much of the vruntime lead of 'curr' to ignore for 'se', in nsecs. A
+ * latency sensitive 'se' preempts earlier and a tolerant one later; against
+ * a latency sensitive 'curr' only the difference between the two counts.
+ */
+static s64 wakeup_latency_gran(struct sched_entity *curr,
+			       struct sched_entity *se)
+{
+	int weight = READ_ONCE(se->latency_weight);
+	int curr_weight = READ_ONCE(curr->latency_weight);
+
+	if (weight < 0 || curr_weight < 0)
+		weight -= curr_weight;
+	if (!weight)
+		return 0;
+
+	return div_s64((s64)weight * sysctl_sched_latency, 1024);
+}
+
 /*
  * Should 'se' preempt 'curr'.
  *
@@ -7829,6 +7967,7 @@ wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
 {
 	s64 gran, vdiff = curr->vruntime - se->vruntime;
 
+	vdiff -= wakeup_latency_gran(curr, se);
 	if (vdiff <= 0)
 		return -1;
 
@@ -8149,6 +8288,31 @@ static struct task_struct *__pick_next_task_fair(struct rq *rq)
 	return pick_next_task_fair(rq, NULL, NULL);
 }
 
+static bool fair_server_has_tasks(struct sched_dl_entity *dl_se)
+{
+	return !!dl_se->rq->cfs.h_nr_running;
+}
+
+static struct task_struct *fair_server_pick(struct sched_dl_entity *dl_se)
+{
+	return pick_next_task_fair(dl_se->rq, NULL, NULL);
+}
+
+/*
+ * The fair server keeps a runaway RT task from starving CFS for good,
+ * without the blunt global RT throttling: it only steps in when CFS got
+ * less than its reservation by the zero-laxity point of the period.
+ */
+void fair_server_init(struct rq *rq)
+{
+	struct sched_dl_entity *dl_se = &rq->fair_server;
+
+	dl_server_init(dl_se, rq, fair_server_has_tasks, fair_server_pick);
+	dl_server_apply_params(dl_se,
+		(u64)sysctl_sched_fair_server_runtime * NSEC_PER_USEC,
+		(u64)sysctl_sched_fair_server_period * NSEC_PER_USEC);
+}
+
 /*
  * Account for a descheduled task:
  */
@@ -8458,7 +8622,8 @@ static int task_hot(struct task_struct *p, struct lb_env *env)
 
 	delta = rq_clock_task(env->src_rq) - p->se.exec_start;
 
-	return delta < (s64)sysctl_sched_migration_cost;
+	return delta < (s64)max_t(u64, sysctl_sched_migration_cost,
+				  env->sd->migration_cost);
 }
 
 #ifdef CONFIG_NUMA_BALANCING
@@ -8545,6 +8710,10 @@ int can_migrate_task(struct task_struct *p, struct lb_env *env)
 	if (kthread_is_per_cpu(p))
 		return 0;
 
+	/* Keep tagged tasks out of clusters running another cookie */
+	if (!sched_cluster_cookie_match(env->dst_rq, p))
+		return 0;
+
 	if (!cpumask_test_cpu(env->dst_cpu, p->cpus_ptr)) {
 		int cpu;
 
@@ -8866,6 +9035,9 @@ static inline bool others_have_blocked(struct rq *rq)
 	if (READ_ONCE(rq->avg_dl.util_avg))
 		return true;
 
+	if (cpu_util_scx(rq))
+		return true;
+
 	if (thermal_load_avg(rq))
 		return true;
 
@@ -8911,6 +9083,7 @@ static bool __update_blocked_others(struct rq *rq, bool *done)
 
 	decayed = update_rt_rq_load_avg(now, rq, curr_class == &rt_sched_class) |
 		  update_dl_rq_load_avg(now, rq, curr_class == &dl_sched_class) |
+		  update_scx_rq_load_avg(now, rq, curr_class == &ext_sched_class) |
 		  update_thermal_load_avg(rq_clock_thermal(rq), rq, thermal_pressure) |
 		  update_irq_load_avg(rq, 0);
 
@@ -12390,6 +12563,7 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 		goto err;
 
 	tg->shares = NICE_0_LOAD;
+	tg->latency_prio = DEFAULT_LATENCY_PRIO;
 
 	init_cfs_bandwidth(tg_cfs_bandwidth(tg));
 
@@ -12490,15 +12664,34 @@ void init_tg_cfs_entry(struct task_group *tg, struct cfs_rq *cfs_rq,
 	se->my_q = cfs_rq;
 	/* guarantee group entities always have weight */
 	update_load_set(&se->load, NICE_0_LOAD);
+	se->latency_weight = latency_prio_to_weight(tg->latency_prio);
 	se->parent = parent;
 }
 
 static DEFINE_MUTEX(shares_mutex);
 
-static int __sched_group_set_shares(struct task_group *tg, unsigned long shares)
+/* Propagate a change of the effective shares of @tg up the hierarchy */
+static void tg_propagate_shares(struct task_group *tg)
 {
 	int i;
 
+	for_each_possible_cpu(i) {
+		struct rq *rq = cpu_rq(i);
+		struct sched_entity *se = tg->se[i];
+		struct rq_flags rf;
+
+		rq_lock_irqsave(rq, &rf);
+		update_rq_clock(rq);
+		for_each_sched_entity(se) {
+			update_load_avg(cfs_rq_of(se), se, UPDATE_TG);
+			update_cfs_group(se);
+		}
+		rq_unlock_irqrestore(rq, &rf);
+	}
+}
+
+static int __sched_group_set_shares(struct task_group *tg, unsigned long shares)
+{
 	lockdep_assert_held(&shares_mutex);
 
 	/*
@@ -12513,20 +12706,7 @@ static int __sched_group_set_shares(struct task_group *tg, unsigned long shares)
 		return 0;
 
 	tg->shares = shares;
-	for_each_possible_cpu(i) {
-		struct rq *rq = cpu_rq(i);
-		struct sched_entity *se = tg->se[i];
-		struct rq_flags rf;
-
-		/* Propagate contribution to hierarchy */
-		rq_lock_irqsave(rq, &rf);
-		update_rq_clock(rq);
-		for_each_sched_entity(se) {
-			update_load_avg(cfs_rq_of(se), se, UPDATE_TG);
-			update_cfs_group(se);
-		}
-		rq_unlock_irqrestore(rq, &rf);
-	}
+	tg_propagate_shares(tg);
 
 	return 0;
 }
@@ -12618,6 +12798,167 @@ int sched_group_set_idle(struct task_group *tg, long idle)
 	return 0;
 }
 
+int sched_group_set_latency(struct task_group *tg, int prio)
+{
+	int i;
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	mutex_lock(&shares_mutex);
+
+	if (tg->latency_prio == prio) {
+		mutex_unlock(&shares_mutex);
+		return 0;
+	}
+
+	tg->latency_prio = prio;
+
+	/* Only read at wakeup and slice time, no need for the rq locks */
+	for_each_possible_cpu(i)
+		WRITE_ONCE(tg->se[i]->latency_weight,
+			   latency_prio_to_weight(prio));
+
+	mutex_unlock(&shares_mutex);
+	return 0;
+}
+
+#ifdef CONFIG_PSI
+/*
+ * CPU pressure boost: sample the CPU some pressure of the group every window
+ * and, while it is above the threshold, run the group with boost_shares
+ * instead of its configured weight. Once the pressure drops the boost halves
+ * towards the configured weight every window.
+ */
+struct tg_psi_boost {
+	struct task_group	*tg;
+	struct delayed_work	dwork;
+	u64			last_total;
+	u64			last_time;
+	unsigned int		threshold;	/* percent of the window */
+	unsigned int		window_ms;
+	unsigned long		shares;		/* boosted shares */
+};
+
+static void tg_psi_boost_work(struct work_struct *work)
+{
+	struct tg_psi_boost *pb = container_of(to_delayed_work(work),
+					       struct tg_psi_boost, dwork);
+	struct task_group *tg = pb->tg;
+	u64 now, total, stall, period;
+	unsigned long base, boost;
+
+	total = psi_cpu_some_total(cgroup_psi(tg->css.cgroup));
+	now = sched_clock();
+
+	stall = total - pb->last_total;
+	period = max_t(u64, now - pb->last_time, 1);
+	pb->last_total = total;
+	pb->last_time = now;
+
+	mutex_lock(&shares_mutex);
+
+	base = tg->shares;
+	boost = tg->boost_shares;
+
+	if (!tg_is_idle(tg) && stall * 100 >= period * pb->threshold)
+		boost = pb->shares;
+	else if (boost > base)
+		boost -= (boost - base) / 2;
+
+	/* Close enough to the configured weight, stop boosting */
+	if (boost <= base + (base >> 4))
+		boost = 0;
+
+	if (boost != tg->boost_shares) {
+		WRITE_ONCE(tg->boost_shares, boost);
+		tg_propagate_shares(tg);
+	}
+
+	mutex_unlock(&shares_mutex);
+
+	schedule_delayed_work(&pb->dwork, msecs_to_jiffies(pb->window_ms));
+}
+
+static void tg_psi_boost_stop(struct task_group *tg)
+{
+	struct tg_psi_boost *pb = tg->psi_boost;
+
+	if (!pb)
+		return;
+
+	cancel_delayed_work_sync(&pb->dwork);
+	tg->psi_boost = NULL;
+	kfree(pb);
+
+	mutex_lock(&shares_mutex);
+	if (tg->boost_shares) {
+		WRITE_ONCE(tg->boost_shares, 0);
+		tg_propagate_shares(tg);
+	}
+	mutex_unlock(&shares_mutex);
+}
+
+static DEFINE_MUTEX(psi_boost_mutex);
+
+/*
+ * Boost @tg to @shares while its CPU some pressure exceeds @threshold percent
+ * of a @window_ms window. A @threshold of 0 turns the boost off.
+ */
+int sched_group_set_psi_boost(struct task_group *tg, unsigned int threshold,
+			      unsigned long shares, unsigned int window_ms)
+{
+	struct tg_psi_boost *pb;
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	if (static_branch_likely(&psi_disabled))
+		return -EOPNOTSUPP;
+
+	mutex_lock(&psi_boost_mutex);
+
+	tg_psi_boost_stop(tg);
+	if (!threshold) {
+		mutex_unlock(&psi_boost_mutex);
+		return 0;
+	}
+
+	pb = kzalloc(sizeof(*pb), GFP_KERNEL);
+	if (!pb) {
+		mutex_unlock(&psi_boost_mutex);
+		return -ENOMEM;
+	}
+
+	pb->tg = tg;
+	pb->threshold = threshold;
+	pb->window_ms = window_ms;
+	pb->shares = clamp(shares, scale_load(MIN_SHARES), scale_load(MAX_SHARES));
+	pb->last_total = psi_cpu_some_total(cgroup_psi(tg->css.cgroup));
+	pb->last_time = sched_clock();
+	INIT_DELAYED_WORK(&pb->dwork, tg_psi_boost_work);
+
+	tg->psi_boost = pb;
+	schedule_delayed_work(&pb->dwork, msecs_to_jiffies(window_ms));
+
+	mutex_unlock(&psi_boost_mutex);
+	return 0;
+}
+
+void sched_group_get_psi_boost(struct task_group *tg, unsigned int *threshold,
+			       unsigned long *shares, unsigned int *window_ms)
+{
+	struct tg_psi_boost *pb;
+
+	mutex_lock(&psi_boost_mutex);
+	pb = tg->psi_boost;
+	*threshold = pb ? pb->threshold : 0;
+	*shares = pb ? pb->shares : 0;
+	*window_ms = pb ? pb->window_ms : 0;
+	mutex_unlock(&psi_boost_mutex);
+}
+#endif /* CONFIG_PSI */
+
 #else /* CONFIG_FAIR_GROUP_SCHED */
 
 void free_fair_sched_group(struct task_group *tg) { }
@@ -63,6 +63,13 @@ SCHED_FEAT(TTWU_QUEUE, true)
 SCHED_FEAT(SIS_PROP, false)
 SCHED_FEAT(SIS_UTIL, true)
 
+/*
+ * On asymmetric CPU capacity systems, look for an idle CPU one cluster at a
+ * time, skipping clusters too small for the task, before scanning the whole
+ * asym_capacity domain.
+ */
+SCHED_FEAT(SIS_ASYM_CLUSTER, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
@@ -97,6 +104,12 @@ SCHED_FEAT(WA_BIAS, true)
 SCHED_FEAT(UTIL_EST, true)
 SCHED_FEAT(UTIL_EST_FASTUP, true)
 
+/*
+ * Leave the load of intermediate group entities to the tick and blocked load
+ * updates when they were updated recently, see cfs_rq_lazy_update().
+ */
+SCHED_FEAT(LAZY_TG_UPDATE, true)
+
 SCHED_FEAT(LATENCY_WARN, false)
 
 SCHED_FEAT(ALT_PERIOD, true)
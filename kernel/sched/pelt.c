@@ -384,6 +384,29 @@ int update_dl_rq_load_avg(u64 now, struct rq *rq, int running)
 	return 0;
 }
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+/*
+ * scx:
+ *
+ *   Same binary signal as rt_rq and dl_rq, for the time spent running ext
+ *   tasks, whose entities are not tracked by PELT.
+ */
+
+int update_scx_rq_load_avg(u64 now, struct rq *rq, int running)
+{
+	if (___update_load_sum(now, &rq->avg_scx,
+				running,
+				running,
+				running)) {
+
+		___update_load_avg(&rq->avg_scx, 1);
+		return 1;
+	}
+
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_SCHED_THERMAL_PRESSURE
 /*
  * thermal:
@@ -37,6 +37,16 @@ update_irq_load_avg(struct rq *rq, u64 running)
 }
 #endif
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+int update_scx_rq_load_avg(u64 now, struct rq *rq, int running);
+#else
+static inline int
+update_scx_rq_load_avg(u64 now, struct rq *rq, int running)
+{
+	return 0;
+}
+#endif
+
 #define PELT_MIN_DIVIDER	(LOAD_AVG_MAX - 1024)
 
 static inline u32 get_pelt_divider(struct sched_avg *avg)
@@ -136,6 +146,9 @@ static inline void update_idle_rq_clock_pelt(struct rq *rq)
 	u32 util_sum = rq->cfs.avg.util_sum;
 	util_sum += rq->avg_rt.util_sum;
 	util_sum += rq->avg_dl.util_sum;
+#ifdef CONFIG_SCHED_CLASS_EXT
+	util_sum += rq->avg_scx.util_sum;
+#endif
 
 	/*
 	 * Reflecting stolen time makes sense only if the idle
@@ -1231,6 +1231,22 @@ void psi_cgroup_restart(struct psi_group *group)
 }
 #endif /* CONFIG_CGROUPS */
 
+/*
+ * Cumulative CPU some stall time of @group in ns, as psi_show() would report
+ * it now. For in-kernel consumers sampling pressure at their own period.
+ */
+u64 psi_cpu_some_total(struct psi_group *group)
+{
+	u64 total;
+
+	mutex_lock(&group->avgs_lock);
+	collect_percpu_times(group, PSI_AVGS, NULL);
+	total = group->total[PSI_AVGS][PSI_CPU_SOME];
+	mutex_unlock(&group->avgs_lock);
+
+	return total;
+}
+
 int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 {
 	bool only_full = false;
@@ -118,6 +118,8 @@ extern void call_trace_sched_update_nr_running(struct rq *rq, int count);
 
 extern unsigned int sysctl_sched_rt_period;
 extern int sysctl_sched_rt_runtime;
+extern unsigned int sysctl_sched_fair_server_runtime;
+extern unsigned int sysctl_sched_fair_server_period;
 extern int sched_rr_timeslice;
 
 /*
@@ -182,9 +184,15 @@ static inline int idle_policy(int policy)
 {
 	return policy == SCHED_IDLE;
 }
+static inline int ext_policy(int policy)
+{
+	return IS_ENABLED(CONFIG_SCHED_CLASS_EXT) && policy == SCHED_EXT;
+}
 static inline int fair_policy(int policy)
 {
-	return policy == SCHED_NORMAL || policy == SCHED_BATCH;
+	/* SCHED_EXT tasks run in CFS while no BPF scheduler is loaded */
+	return policy == SCHED_NORMAL || policy == SCHED_BATCH ||
+	       ext_policy(policy);
 }
 
 static inline int rt_policy(int policy)
@@ -202,6 +210,15 @@ static inline bool valid_policy(int policy)
 		rt_policy(policy) || dl_policy(policy);
 }
 
+/*
+ * Latency nice scaled to [-1024, 973], the share of sysctl_sched_latency an
+ * entity may jump ahead (negative) or fall behind (positive) at wakeup.
+ */
+static inline int latency_prio_to_weight(int prio)
+{
+	return LATENCY_TO_NICE(prio) * 1024 / (LATENCY_NICE_WIDTH / 2);
+}
+
 static inline int task_has_idle_policy(struct task_struct *p)
 {
 	return idle_policy(p->policy);
@@ -332,6 +349,17 @@ extern bool dl_param_changed(struct task_struct *p, const struct sched_attr *att
 extern int  dl_cpuset_cpumask_can_shrink(const struct cpumask *cur, const struct cpumask *trial);
 extern int  dl_cpu_busy(int cpu, struct task_struct *p);
 
+/*
+ * Log2 histogram of the time tasks wait on a runqueue before they get to
+ * run: bucket 0 counts waits below 1us, bucket i those in
+ * [2^(i-1), 2^i) us and the last one everything longer.
+ */
+#define SCHED_LAT_HIST_NR	24
+
+struct sched_lat_hist {
+	u64			count[SCHED_LAT_HIST_NR];
+};
+
 #ifdef CONFIG_CGROUP_SCHED
 
 struct cfs_rq;
@@ -379,6 +407,15 @@ struct task_group {
 	/* A positive value indicates that this is a SCHED_IDLE group. */
 	int			idle;
 
+	/* latency nice of the group entities, as a latency_prio */
+	int			latency_prio;
+
+	/* shares raised above @shares while CPU pressure is high, or 0 */
+	unsigned long		boost_shares;
+#ifdef CONFIG_PSI
+	struct tg_psi_boost	*psi_boost;
+#endif
+
 #ifdef	CONFIG_SMP
 	/*
 	 * load_avg can be heavily contended at clock tick time, so put
@@ -409,6 +446,11 @@ struct task_group {
 
 	struct cfs_bandwidth	cfs_bandwidth;
 
+#ifdef CONFIG_SCHEDSTATS
+	/* runqueue wait of this group's own tasks, NULL for the root */
+	struct sched_lat_hist __percpu *lat_hist;
+#endif
+
 #ifdef CONFIG_UCLAMP_TASK_GROUP
 	/* The two decimal precision [%] value requested from user-space */
 	unsigned int		uclamp_pct[UCLAMP_CNT];
@@ -488,6 +530,15 @@ extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
 
 extern int sched_group_set_idle(struct task_group *tg, long idle);
 
+extern int sched_group_set_latency(struct task_group *tg, int prio);
+
+#ifdef CONFIG_PSI
+extern int sched_group_set_psi_boost(struct task_group *tg, unsigned int threshold,
+				     unsigned long shares, unsigned int window_ms);
+extern void sched_group_get_psi_boost(struct task_group *tg, unsigned int *threshold,
+				      unsigned long *shares, unsigned int *window_ms);
+#endif
+
 #ifdef CONFIG_SMP
 extern void set_task_rq_fair(struct sched_entity *se,
 			     struct cfs_rq *prev, struct cfs_rq *next);
@@ -760,6 +811,25 @@ struct dl_rq {
 	u64			bw_ratio;
 };
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+/* A FIFO of ext tasks, the local one of each rq is protected by the rq lock */
+struct scx_dispatch_q {
+	raw_spinlock_t		lock;
+	struct list_head	fifo;
+	u32			nr;
+	u64			id;
+	struct rcu_head		rcu;
+};
+
+/* BPF extensible class' related fields in a runqueue */
+struct scx_rq {
+	struct scx_dispatch_q	local;
+	/* every queued ext task of this rq, least recently run first */
+	struct list_head	runnable_list;
+	unsigned int		nr_running;
+};
+#endif /* CONFIG_SCHED_CLASS_EXT */
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 /* An entity is a task if it doesn't "own" a runqueue */
 #define entity_is_task(se)	(!se->my_q)
@@ -993,6 +1063,11 @@ struct rq {
 	struct cfs_rq		cfs;
 	struct rt_rq		rt;
 	struct dl_rq		dl;
+#ifdef CONFIG_SCHED_CLASS_EXT
+	struct scx_rq		scx;
+#endif
+	/* deadline reservation for CFS tasks starved by RT */
+	struct sched_dl_entity	fair_server;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this CPU: */
@@ -1065,6 +1140,9 @@ struct rq {
 
 	struct sched_avg	avg_rt;
 	struct sched_avg	avg_dl;
+#ifdef CONFIG_SCHED_CLASS_EXT
+	struct sched_avg	avg_scx;
+#endif
 #ifdef CONFIG_HAVE_SCHED_AVG_IRQ
 	struct sched_avg	avg_irq;
 #endif
@@ -1111,6 +1189,7 @@ struct rq {
 	/* latency stats */
 	struct sched_info	rq_sched_info;
 	unsigned long long	rq_cpu_time;
+	struct sched_lat_hist	rq_lat_hist;
 	/* could above be rq->cfs_rq.exec_clock + rq->rt_rq.rt_runtime ? */
 
 	/* sys_sched_yield() stats */
@@ -1143,6 +1222,8 @@ struct rq {
 	unsigned int		core_enabled;
 	unsigned int		core_sched_seq;
 	struct rb_root		core_tree;
+	/* cookie of the tasks in core_tree, 0 if empty or MIXED */
+	unsigned long		core_cluster_cookie;
 
 	/* shared state -- careful with sched_core_cpu_deactivate() */
 	unsigned int		core_task_seq;
@@ -1246,6 +1327,27 @@ static inline raw_spinlock_t *__rq_lockp(struct rq *rq)
 bool cfs_prio_less(const struct task_struct *a, const struct task_struct *b,
 			bool fi);
 
+/*
+ * With kernel.sched_core_cluster set, tasks with a cookie not only keep SMT
+ * siblings but their whole LLC cluster to themselves: a CPU only matches if no
+ * task with another cookie is queued in its cluster. Untagged tasks are not
+ * restricted and do not restrict others.
+ */
+#define SCHED_CORE_COOKIE_MIXED	(~0UL)
+
+DECLARE_STATIC_KEY_FALSE(sched_core_cluster);
+
+extern bool __sched_cluster_cookie_match(struct rq *rq, struct task_struct *p);
+extern int sched_cluster_cookie_cpu(struct task_struct *p, int cpu);
+
+static inline bool sched_cluster_cookie_match(struct rq *rq, struct task_struct *p)
+{
+	if (!static_branch_unlikely(&sched_core_cluster) || !p->core_cookie)
+		return true;
+
+	return __sched_cluster_cookie_match(rq, p);
+}
+
 /*
  * Helpers to check if the CPU's core cookie matches with the task's cookie
  * when core scheduling is enabled.
@@ -1258,7 +1360,8 @@ static inline bool sched_cpu_cookie_match(struct rq *rq, struct task_struct *p)
 	if (!sched_core_enabled(rq))
 		return true;
 
-	return rq->core->core_cookie == p->core_cookie;
+	return rq->core->core_cookie == p->core_cookie &&
+	       sched_cluster_cookie_match(rq, p);
 }
 
 static inline bool sched_core_cookie_match(struct rq *rq, struct task_struct *p)
@@ -1270,6 +1373,9 @@ static inline bool sched_core_cookie_match(struct rq *rq, struct task_struct *p)
 	if (!sched_core_enabled(rq))
 		return true;
 
+	if (!sched_cluster_cookie_match(rq, p))
+		return false;
+
 	for_each_cpu(cpu, cpu_smt_mask(cpu_of(rq))) {
 		if (!available_idle_cpu(cpu)) {
 			idle_core = false;
@@ -1350,6 +1456,16 @@ static inline bool sched_group_cookie_match(struct rq *rq,
 {
 	return true;
 }
+
+static inline bool sched_cluster_cookie_match(struct rq *rq, struct task_struct *p)
+{
+	return true;
+}
+
+static inline int sched_cluster_cookie_cpu(struct task_struct *p, int cpu)
+{
+	return cpu;
+}
 #endif /* CONFIG_SCHED_CORE */
 
 static inline void lockdep_assert_rq_held(struct rq *rq)
@@ -2295,6 +2411,7 @@ extern const struct sched_class stop_sched_class;
 extern const struct sched_class dl_sched_class;
 extern const struct sched_class rt_sched_class;
 extern const struct sched_class fair_sched_class;
+extern const struct sched_class ext_sched_class;
 extern const struct sched_class idle_sched_class;
 
 static inline bool sched_stop_runnable(struct rq *rq)
@@ -2404,6 +2521,24 @@ extern void init_dl_bandwidth(struct dl_bandwidth *dl_b, u64 period, u64 runtime
 extern void init_dl_task_timer(struct sched_dl_entity *dl_se);
 extern void init_dl_inactive_task_timer(struct sched_dl_entity *dl_se);
 
+/*
+ * Deadline servers: a -deadline entity that, instead of a task, runs the
+ * tasks of a lower class out of its own runtime. The server is deferred:
+ * time its tasks get anyway is charged against it through
+ * dl_server_update(), and only if some runtime is left at the
+ * zero-laxity point of the period does it start competing with, and
+ * preempting, the classes above.
+ */
+extern void dl_server_update(struct sched_dl_entity *dl_se, s64 delta_exec);
+extern void dl_server_start(struct sched_dl_entity *dl_se);
+extern void dl_server_stop(struct sched_dl_entity *dl_se);
+extern void dl_server_init(struct sched_dl_entity *dl_se, struct rq *rq,
+			   bool (*has_tasks)(struct sched_dl_entity *dl_se),
+			   struct task_struct *(*pick)(struct sched_dl_entity *dl_se));
+extern void dl_server_apply_params(struct sched_dl_entity *dl_se,
+				   u64 runtime, u64 period);
+extern void fair_server_init(struct rq *rq);
+
 #define BW_SHIFT		20
 #define BW_UNIT			(1 << BW_SHIFT)
 #define RATIO_SHIFT		8
@@ -3020,6 +3155,15 @@ static inline unsigned long cpu_util_rt(struct rq *rq)
 {
 	return READ_ONCE(rq->avg_rt.util_avg);
 }
+
+static inline unsigned long cpu_util_scx(struct rq *rq)
+{
+#ifdef CONFIG_SCHED_CLASS_EXT
+	return READ_ONCE(rq->avg_scx.util_avg);
+#else
+	return 0;
+#endif
+}
 #endif
 
 #ifdef CONFIG_UCLAMP_TASK
@@ -3509,4 +3653,6 @@ static inline void task_tick_mm_cid(struct rq *rq, struct task_struct *curr) { }
 static inline void init_sched_mm_cid(struct task_struct *t) { }
 #endif
 
+#include "ext.h"
+
 #endif /* _KERNEL_SCHED_SCHED_H */
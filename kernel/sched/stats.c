@@ -107,6 +107,28 @@ void __update_stats_enqueue_sleeper(struct rq *rq, struct task_struct *p,
 	}
 }
 
+void sched_lat_hist_add(struct sched_lat_hist *sum,
+			const struct sched_lat_hist *hist)
+{
+	int i;
+
+	for (i = 0; i < SCHED_LAT_HIST_NR; i++)
+		sum->count[i] += READ_ONCE(hist->count[i]);
+}
+
+/*
+ * One "<upper bound in us> <count>" line per bucket, the last one being
+ * unbounded.
+ */
+void sched_lat_hist_print(struct seq_file *m, const struct sched_lat_hist *hist)
+{
+	int i;
+
+	for (i = 0; i < SCHED_LAT_HIST_NR - 1; i++)
+		seq_printf(m, "%llu %llu\n", 1ULL << i, hist->count[i]);
+	seq_printf(m, "inf %llu\n", hist->count[i]);
+}
+
 /*
  * Current schedstat API version.
  *
@@ -34,6 +34,38 @@ rq_sched_info_dequeue(struct rq *rq, unsigned long long delta)
 	if (rq)
 		rq->rq_sched_info.run_delay += delta;
 }
+
+static inline unsigned int sched_lat_hist_bucket(unsigned long long delta)
+{
+	delta = div_u64(delta, NSEC_PER_USEC);
+	if (!delta)
+		return 0;
+
+	return min_t(unsigned int, ilog2(delta) + 1, SCHED_LAT_HIST_NR - 1);
+}
+
+/*
+ * Expects runqueue lock to be held for atomicity of update
+ */
+static inline void
+rq_sched_lat_hist_account(struct rq *rq, struct task_struct *t,
+			  unsigned long long delta)
+{
+	unsigned int bucket = sched_lat_hist_bucket(delta);
+#ifdef CONFIG_CGROUP_SCHED
+	/* same as task_group(), which is only defined further down */
+	struct task_group *tg = t->sched_task_group;
+
+	if (tg->lat_hist)
+		per_cpu_ptr(tg->lat_hist, cpu_of(rq))->count[bucket]++;
+#endif
+	rq->rq_lat_hist.count[bucket]++;
+}
+
+extern void sched_lat_hist_add(struct sched_lat_hist *sum,
+			       const struct sched_lat_hist *hist);
+extern void sched_lat_hist_print(struct seq_file *m,
+				 const struct sched_lat_hist *hist);
 #define   schedstat_enabled()		static_branch_unlikely(&sched_schedstats)
 #define __schedstat_inc(var)		do { var++; } while (0)
 #define   schedstat_inc(var)		do { if (schedstat_enabled()) { var++; } } while (0)
@@ -72,6 +104,8 @@ check_schedstat_required(void)
 static inline void rq_sched_info_arrive  (struct rq *rq, unsigned long long delta) { }
 static inline void rq_sched_info_dequeue(struct rq *rq, unsigned long long delta) { }
 static inline void rq_sched_info_depart  (struct rq *rq, unsigned long long delta) { }
+static inline void rq_sched_lat_hist_account(struct rq *rq, struct task_struct *t,
+					     unsigned long long delta) { }
 # define   schedstat_enabled()		0
 # define __schedstat_inc(var)		do { } while (0)
 # define   schedstat_inc(var)		do { } while (0)
@@ -236,6 +270,7 @@ static void sched_info_arrive(struct rq *rq, struct task_struct *t)
 	t->sched_info.pcount++;
 
 	rq_sched_info_arrive(rq, delta);
+	rq_sched_lat_hist_account(rq, t, delta);
 }
 
 /*
@@ -1538,6 +1538,27 @@ static struct cpumask		***sched_domains_numa_masks;
 	 SD_NUMA		|	\
 	 SD_ASYM_PACKING)
 
+/*
+ * A task leaving its last level cache needs about the time to refill it from
+ * memory before it runs as fast again. Estimate that from the LLC size, with a
+ * conservative per-CPU refill rate.
+ */
+#define SD_LLC_REFILL_BYTES_PER_NS	16
+#define SD_MIGRATION_COST_MAX		(5 * NSEC_PER_MSEC)
+
+static u64 sd_llc_hot_time(int cpu)
+{
+	struct cpu_cacheinfo *ci = get_cpu_cacheinfo(cpu);
+	struct cacheinfo *llc;
+
+	if (!ci || !ci->info_list || !ci->num_leaves)
+		return 0;
+
+	llc = &ci->info_list[ci->num_leaves - 1];
+	return min_t(u64, llc->size / SD_LLC_REFILL_BYTES_PER_NS,
+		     SD_MIGRATION_COST_MAX);
+}
+
 static struct sched_domain *
 sd_init(struct sched_domain_topology_level *tl,
 	const struct cpumask *cpu_map,
@@ -1570,6 +1591,7 @@ sd_init(struct sched_domain_topology_level *tl,
 		.imbalance_pct		= 117,
 
 		.cache_nice_tries	= 0,
+		.migration_cost		= 0,
 
 		.flags			= 1*SD_BALANCE_NEWIDLE
 					| 1*SD_BALANCE_EXEC
@@ -1635,6 +1657,14 @@ sd_init(struct sched_domain_topology_level *tl,
 		sd->cache_nice_tries = 1;
 	}
 
+	/*
+	 * Migrating between the children of the first level above the LLC,
+	 * e.g. between the L2 clusters of Apple SoCs, loses the cache.
+	 */
+	if (child && (child->flags & SD_SHARE_PKG_RESOURCES) &&
+	    !(sd->flags & SD_SHARE_PKG_RESOURCES))
+		sd->migration_cost = sd_llc_hot_time(cpu);
+
 	/*
 	 * For all levels sharing cache; connect a sched_domain_shared
 	 * instance.
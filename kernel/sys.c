@@ -2728,6 +2728,11 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			return -EINVAL;
 		error = arch_prctl_mem_model_set(me, arg2);
 		break;
+	case PR_FUTEX_HASH:
+		if (arg5)
+			return -EINVAL;
+		error = futex_hash_prctl(arg2, arg3, arg4);
+		break;
 	default:
 		error = -EINVAL;
 		break;
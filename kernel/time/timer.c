@@ -41,6 +41,7 @@
 #include <linux/sched/sysctl.h>
 #include <linux/sched/nohz.h>
 #include <linux/sched/debug.h>
+#include <linux/sched/topology.h>
 #include <linux/slab.h>
 #include <linux/compat.h>
 #include <linux/random.h>
@@ -1910,6 +1911,77 @@ static u64 cmp_next_hrtimer_event(u64 basem, u64 expires)
 	return DIV_ROUND_UP_ULL(nextevt, TICK_NSEC) * TICK_NSEC;
 }
 
+#ifdef CONFIG_SMP
+static bool timer_base_has_global(struct timer_base *base)
+{
+	struct timer_list *timer;
+	int i;
+
+	for_each_set_bit(i, base->pending_map, WHEEL_SIZE) {
+		hlist_for_each_entry(timer, base->vectors + i, entry) {
+			if (!(timer->flags & TIMER_PINNED))
+				return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * A CPU on its way into idle hands its non-pinned timers over to a busy
+ * CPU it shares a cache with, usually one of its cluster, so that it is
+ * not woken up just to expire them.  The busy CPU has its tick running
+ * anyway, so the timers expire just as accurately there.  Pinned timers
+ * stay, as do deferrable ones which do not wake idle CPUs to begin with.
+ *
+ * Called with interrupts disabled.
+ */
+static void timer_base_handoff_global(struct timer_base *base)
+{
+	struct timer_base *new_base, *first, *second;
+	struct timer_list *timer;
+	struct hlist_node *tmp;
+	bool global;
+	int target, i;
+
+	if (!static_branch_likely(&timers_migration_enabled) ||
+	    !READ_ONCE(base->timers_pending))
+		return;
+
+	raw_spin_lock(&base->lock);
+	global = timer_base_has_global(base);
+	raw_spin_unlock(&base->lock);
+	if (!global)
+		return;
+
+	target = get_nohz_timer_target();
+	if (target == base->cpu || !cpus_share_cache(target, base->cpu))
+		return;
+	new_base = per_cpu_ptr(&timer_bases[BASE_STD], target);
+
+	/* Two CPUs might hand timers over to each other at the same time. */
+	first = new_base < base ? new_base : base;
+	second = new_base < base ? base : new_base;
+	raw_spin_lock(&first->lock);
+	raw_spin_lock_nested(&second->lock, SINGLE_DEPTH_NESTING);
+
+	forward_timer_base(new_base);
+	for_each_set_bit(i, base->pending_map, WHEEL_SIZE) {
+		hlist_for_each_entry_safe(timer, tmp, base->vectors + i, entry) {
+			if (timer->flags & TIMER_PINNED)
+				continue;
+			detach_if_pending(timer, base, false);
+			timer->flags = (timer->flags & ~TIMER_BASEMASK) | target;
+			internal_add_timer(new_base, timer);
+		}
+	}
+
+	raw_spin_unlock(&second->lock);
+	raw_spin_unlock(&first->lock);
+}
+#else
+static inline void timer_base_handoff_global(struct timer_base *base) { }
+#endif
+
 /**
  * get_next_timer_interrupt - return the time (clock mono) of the next timer
  * @basej:	base time jiffies
@@ -1931,6 +2003,8 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 	if (cpu_is_offline(smp_processor_id()))
 		return expires;
 
+	timer_base_handoff_global(base);
+
 	raw_spin_lock(&base->lock);
 	if (base->next_expiry_recalc)
 		base->next_expiry = __next_timer_interrupt(base);
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Throughput of memcpy(), copy_to_user() and copy_from_user() for a range
+ * of sizes, to compare the copy routines of an architecture on a given CPU.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mman.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/sizes.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define BENCH_MAX_SIZE	SZ_1M
+#define BENCH_BYTES	SZ_256M	/* copied per size and routine */
+
+static const size_t bench_sizes[] = {
+	64, 256, SZ_1K, SZ_4K, SZ_16K, SZ_64K, SZ_256K, SZ_1M,
+};
+
+enum bench_op {
+	BENCH_MEMCPY,
+	BENCH_TO_USER,
+	BENCH_FROM_USER,
+};
+
+static const char * const bench_names[] = {
+	[BENCH_MEMCPY]		= "memcpy",
+	[BENCH_TO_USER]		= "copy_to_user",
+	[BENCH_FROM_USER]	= "copy_from_user",
+};
+
+static int bench_one(enum bench_op op, void *dst, void *src,
+		     void __user *ubuf, size_t size)
+{
+	unsigned long i, loops = BENCH_BYTES / size;
+	u64 start, ns;
+
+	start = ktime_get_ns();
+	for (i = 0; i < loops; i++) {
+		switch (op) {
+		case BENCH_MEMCPY:
+			memcpy(dst, src, size);
+			break;
+		case BENCH_TO_USER:
+			if (copy_to_user(ubuf, src, size))
+				return -EFAULT;
+			break;
+		case BENCH_FROM_USER:
+			if (copy_from_user(dst, ubuf, size))
+				return -EFAULT;
+			break;
+		}
+		/* keep memcpy() from being optimised out */
+		barrier_data(dst);
+		cond_resched();
+	}
+	ns = ktime_get_ns() - start ?: 1;
+
+	pr_info("%-14s %8zu bytes: %6llu MB/s\n", bench_names[op], size,
+		div64_u64((u64)loops * size * NSEC_PER_SEC, ns * SZ_1M));
+	return 0;
+}
+
+static int __init test_memcpy_bench_init(void)
+{
+	unsigned long user_addr;
+	void *src, *dst;
+	int op, i, ret = 0;
+
+	src = vmalloc(BENCH_MAX_SIZE);
+	dst = vmalloc(BENCH_MAX_SIZE);
+	if (!src || !dst) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+	memset(src, 0x5a, BENCH_MAX_SIZE);
+	memset(dst, 0, BENCH_MAX_SIZE);
+
+	user_addr = vm_mmap(NULL, 0, BENCH_MAX_SIZE, PROT_READ | PROT_WRITE,
+			    MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, 0);
+	if (user_addr >= (unsigned long)(TASK_SIZE)) {
+		pr_warn("Failed to allocate user memory\n");
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (op = 0; op < ARRAY_SIZE(bench_names) && !ret; op++)
+		for (i = 0; i < ARRAY_SIZE(bench_sizes) && !ret; i++)
+			ret = bench_one(op, dst, src,
+					(void __user *)user_addr,
+					bench_sizes[i]);
+
+	vm_munmap(user_addr, BENCH_MAX_SIZE);
+out_free:
+	vfree(dst);
+	vfree(src);
+	return ret;
+}
+module_init(test_memcpy_bench_init);
+
+static void __exit test_memcpy_bench_exit(void)
+{
+}
+module_exit(test_memcpy_bench_exit);
+
+MODULE_DESCRIPTION("memcpy and user copy throughput benchmark");
+MODULE_LICENSE("GPL");
@@ -167,25 +167,40 @@ int __frontswap_store(struct page *page)
 	int type = swp_type(entry);
 	struct swap_info_struct *sis = swap_info[type];
 	pgoff_t offset = swp_offset(entry);
+	struct folio *folio = page_folio(page);
+	long i, nr = 1;
 
 	VM_BUG_ON(!frontswap_ops);
 	VM_BUG_ON(!PageLocked(page));
 	VM_BUG_ON(sis == NULL);
 
+	/* A large folio occupies consecutive swap slots from its head's */
+	if (folio_test_large(folio)) {
+		if (!frontswap_ops->store_folio)
+			return -1;
+		nr = folio_nr_pages(folio);
+	}
+
 	/*
 	 * If a dup, we must remove the old page first; we can't leave the
 	 * old page no matter if the store of the new page succeeds or fails,
 	 * and we can't rely on the new page replacing the old page as we may
 	 * not store to the same implementation that contains the old page.
 	 */
-	if (__frontswap_test(sis, offset)) {
-		__frontswap_clear(sis, offset);
-		frontswap_ops->invalidate_page(type, offset);
+	for (i = 0; i < nr; i++) {
+		if (__frontswap_test(sis, offset + i)) {
+			__frontswap_clear(sis, offset + i);
+			frontswap_ops->invalidate_page(type, offset + i);
+		}
 	}
 
-	ret = frontswap_ops->store(type, offset, page);
+	if (nr > 1)
+		ret = frontswap_ops->store_folio(type, offset, folio);
+	else
+		ret = frontswap_ops->store(type, offset, page);
 	if (ret == 0) {
-		__frontswap_set(sis, offset);
+		for (i = 0; i < nr; i++)
+			__frontswap_set(sis, offset + i);
 		inc_frontswap_succ_stores();
 	} else {
 		inc_frontswap_failed_stores();
@@ -65,6 +65,15 @@ unsigned long transparent_hugepage_flags __read_mostly =
 	(1<<TRANSPARENT_HUGEPAGE_DEFRAG_KHUGEPAGED_FLAG)|
 	(1<<TRANSPARENT_HUGEPAGE_USE_ZERO_PAGE_FLAG);
 
+/*
+ * Per-order policy for anonymous folios smaller than a PMD. An order set in
+ * neither mask is "never"; orders in huge_anon_orders_inherit follow the
+ * top-level "enabled" setting.
+ */
+static unsigned long huge_anon_orders_always __read_mostly;
+static unsigned long huge_anon_orders_madvise __read_mostly;
+static unsigned long huge_anon_orders_inherit __read_mostly;
+
 static struct shrinker deferred_split_shrinker;
 
 static atomic_t huge_zero_refcount;
@@ -151,6 +160,33 @@ bool hugepage_vma_check(struct vm_area_struct *vma, unsigned long vm_flags,
 	return true;
 }
 
+/**
+ * thp_vma_anon_orders - orders usable for an anonymous fault in a VMA
+ * @vma: the faulting VMA
+ *
+ * Return: a bitmask of the folio orders below HPAGE_PMD_ORDER that the
+ * per-size sysfs policy allows for anonymous memory in @vma.
+ */
+unsigned long thp_vma_anon_orders(struct vm_area_struct *vma)
+{
+	unsigned long orders = READ_ONCE(huge_anon_orders_always);
+
+	if (vma->vm_flags & VM_HUGEPAGE)
+		orders |= READ_ONCE(huge_anon_orders_madvise);
+	if (hugepage_flags_always() ||
+	    ((vma->vm_flags & VM_HUGEPAGE) && hugepage_flags_enabled()))
+		orders |= READ_ONCE(huge_anon_orders_inherit);
+
+	if (!orders)
+		return 0;
+
+	if ((vma->vm_flags & VM_NOHUGEPAGE) ||
+	    test_bit(MMF_DISABLE_THP, &vma->vm_mm->flags))
+		return 0;
+
+	return orders;
+}
+
 static bool get_huge_zero_page(void)
 {
 	struct page *zero_page;
@@ -406,8 +442,127 @@ static const struct attribute_group hugepage_attr_group = {
 	.attrs = hugepage_attr,
 };
 
+struct thpsize {
+	struct kobject kobj;
+	struct list_head node;
+	int order;
+};
+
+#define to_thpsize(kobj) container_of(kobj, struct thpsize, kobj)
+
+static LIST_HEAD(thpsize_list);
+static DEFINE_SPINLOCK(huge_anon_orders_lock);
+
+static ssize_t anon_enabled_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	int order = to_thpsize(kobj)->order;
+	const char *output;
+
+	if (test_bit(order, &huge_anon_orders_always))
+		output = "[always] inherit madvise never";
+	else if (test_bit(order, &huge_anon_orders_inherit))
+		output = "always [inherit] madvise never";
+	else if (test_bit(order, &huge_anon_orders_madvise))
+		output = "always inherit [madvise] never";
+	else
+		output = "always inherit madvise [never]";
+
+	return sysfs_emit(buf, "%s\n", output);
+}
+
+static ssize_t anon_enabled_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	int order = to_thpsize(kobj)->order;
+	unsigned long *set = NULL;
+
+	if (sysfs_streq(buf, "always"))
+		set = &huge_anon_orders_always;
+	else if (sysfs_streq(buf, "inherit"))
+		set = &huge_anon_orders_inherit;
+	else if (sysfs_streq(buf, "madvise"))
+		set = &huge_anon_orders_madvise;
+	else if (!sysfs_streq(buf, "never"))
+		return -EINVAL;
+
+	spin_lock(&huge_anon_orders_lock);
+	clear_bit(order, &huge_anon_orders_always);
+	clear_bit(order, &huge_anon_orders_inherit);
+	clear_bit(order, &huge_anon_orders_madvise);
+	if (set)
+		set_bit(order, set);
+	spin_unlock(&huge_anon_orders_lock);
+
+	return count;
+}
+
+static struct kobj_attribute anon_enabled_attr =
+	__ATTR(enabled, 0644, anon_enabled_show, anon_enabled_store);
+
+static struct attribute *thpsize_attrs[] = {
+	&anon_enabled_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group thpsize_attr_group = {
+	.attrs = thpsize_attrs,
+};
+
+static void thpsize_release(struct kobject *kobj)
+{
+	kfree(to_thpsize(kobj));
+}
+
+static const struct kobj_type thpsize_ktype = {
+	.release = &thpsize_release,
+	.sysfs_ops = &kobj_sysfs_ops,
+};
+
+static struct thpsize *thpsize_create(int order, struct kobject *parent)
+{
+	unsigned long size = (PAGE_SIZE << order) >> 10;
+	struct thpsize *thpsize;
+	int ret;
+
+	thpsize = kzalloc(sizeof(*thpsize), GFP_KERNEL);
+	if (!thpsize)
+		return ERR_PTR(-ENOMEM);
+
+	thpsize->order = order;
+
+	ret = kobject_init_and_add(&thpsize->kobj, &thpsize_ktype, parent,
+				   "hugepages-%lukB", size);
+	if (ret) {
+		kobject_put(&thpsize->kobj);
+		return ERR_PTR(ret);
+	}
+
+	ret = sysfs_create_group(&thpsize->kobj, &thpsize_attr_group);
+	if (ret) {
+		kobject_put(&thpsize->kobj);
+		return ERR_PTR(ret);
+	}
+
+	return thpsize;
+}
+
+static void thpsize_remove_all(void)
+{
+	struct thpsize *thpsize, *tmp;
+
+	list_for_each_entry_safe(thpsize, tmp, &thpsize_list, node) {
+		list_del(&thpsize->node);
+		sysfs_remove_group(&thpsize->kobj, &thpsize_attr_group);
+		kobject_put(&thpsize->kobj);
+	}
+}
+
 static int __init hugepage_init_sysfs(struct kobject **hugepage_kobj)
 {
+	struct thpsize *thpsize;
+	int order;
 	int err;
 
 	*hugepage_kobj = kobject_create_and_add("transparent_hugepage", mm_kobj);
@@ -428,8 +583,22 @@ static int __init hugepage_init_sysfs(struct kobject **hugepage_kobj)
 		goto remove_hp_group;
 	}
 
+	/* Multi-size anonymous folios, from 4 pages up to below a PMD */
+	for (order = HPAGE_PMD_ORDER - 1; order > 1; order--) {
+		thpsize = thpsize_create(order, *hugepage_kobj);
+		if (IS_ERR(thpsize)) {
+			pr_err("failed to create thpsize for order %d\n", order);
+			err = PTR_ERR(thpsize);
+			goto remove_all;
+		}
+		list_add(&thpsize->node, &thpsize_list);
+	}
+
 	return 0;
 
+remove_all:
+	thpsize_remove_all();
+	sysfs_remove_group(*hugepage_kobj, &khugepaged_attr_group);
 remove_hp_group:
 	sysfs_remove_group(*hugepage_kobj, &hugepage_attr_group);
 delete_obj:
@@ -439,6 +608,7 @@ static int __init hugepage_init_sysfs(struct kobject **hugepage_kobj)
 
 static void __init hugepage_exit_sysfs(struct kobject *hugepage_kobj)
 {
+	thpsize_remove_all();
 	sysfs_remove_group(hugepage_kobj, &khugepaged_attr_group);
 	sysfs_remove_group(hugepage_kobj, &hugepage_attr_group);
 	kobject_put(hugepage_kobj);
@@ -782,11 +952,13 @@ vm_fault_t do_huge_pmd_anonymous_page(struct vm_fault *vmf)
 	gfp_t gfp;
 	struct folio *folio;
 	unsigned long haddr = vmf->address & HPAGE_PMD_MASK;
+	vm_fault_t ret;
 
 	if (!transhuge_vma_suitable(vma, haddr))
 		return VM_FAULT_FALLBACK;
-	if (unlikely(anon_vma_prepare(vma)))
-		return VM_FAULT_OOM;
+	ret = vmf_anon_prepare(vmf);
+	if (ret)
+		return ret;
 	khugepaged_enter_vma(vma, vma->vm_flags);
 
 	if (!(vmf->flags & FAULT_FLAG_WRITE) &&
@@ -794,7 +966,6 @@ vm_fault_t do_huge_pmd_anonymous_page(struct vm_fault *vmf)
 			transparent_hugepage_use_zero_page()) {
 		pgtable_t pgtable;
 		struct page *zero_page;
-		vm_fault_t ret;
 		pgtable = pte_alloc_one(vma->vm_mm);
 		if (unlikely(!pgtable))
 			return VM_FAULT_OOM;
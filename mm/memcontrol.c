@@ -63,7 +63,9 @@
 #include <linux/resume_user_mode.h>
 #include <linux/psi.h>
 #include <linux/seq_buf.h>
+#include <linux/random.h>
 #include <linux/sched/isolation.h>
+#include <linux/parser.h>
 #include "internal.h"
 #include <net/sock.h>
 #include <net/ip.h>
@@ -2209,10 +2211,17 @@ void unlock_page_memcg(struct page *page)
 	folio_memcg_unlock(page_folio(page));
 }
 
+/*
+ * Number of memcgs whose pre-charged pages are cached per CPU. Several
+ * containers sharing a CPU would otherwise keep draining each other's stock.
+ */
+#define NR_MEMCG_STOCK 7
+
 struct memcg_stock_pcp {
 	local_lock_t stock_lock;
-	struct mem_cgroup *cached; /* this never be root cgroup */
-	unsigned int nr_pages;
+	/* these never hold the root cgroup */
+	struct mem_cgroup *cached[NR_MEMCG_STOCK];
+	unsigned int nr_pages[NR_MEMCG_STOCK];
 
 #ifdef CONFIG_MEMCG_KMEM
 	struct obj_cgroup *cached_objcg;
@@ -2257,8 +2266,8 @@ static void memcg_account_kmem(struct mem_cgroup *memcg, int nr_pages)
  * @memcg: memcg to consume from.
  * @nr_pages: how many pages to charge.
  *
- * The charges will only happen if @memcg matches the current cpu's memcg
- * stock, and at least @nr_pages are available in that stock.  Failure to
+ * The charges will only happen if @memcg is one of the current cpu's memcg
+ * stocks, and at least @nr_pages are available in that stock.  Failure to
  * service an allocation will refill the stock.
  *
  * returns true if successful, false otherwise.
@@ -2268,6 +2277,7 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	struct memcg_stock_pcp *stock;
 	unsigned long flags;
 	bool ret = false;
+	int i;
 
 	if (nr_pages > MEMCG_CHARGE_BATCH)
 		return ret;
@@ -2275,9 +2285,15 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	local_lock_irqsave(&memcg_stock.stock_lock, flags);
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (memcg == stock->cached && stock->nr_pages >= nr_pages) {
-		stock->nr_pages -= nr_pages;
-		ret = true;
+	for (i = 0; i < NR_MEMCG_STOCK; i++) {
+		if (memcg != stock->cached[i])
+			continue;
+
+		if (stock->nr_pages[i] >= nr_pages) {
+			stock->nr_pages[i] -= nr_pages;
+			ret = true;
+		}
+		break;
 	}
 
 	local_unlock_irqrestore(&memcg_stock.stock_lock, flags);
@@ -2286,24 +2302,32 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 }
 
 /*
- * Returns stocks cached in percpu and reset cached information.
+ * Returns the stock cached in slot @i and resets its cached information.
  */
-static void drain_stock(struct memcg_stock_pcp *stock)
+static void drain_stock(struct memcg_stock_pcp *stock, int i)
 {
-	struct mem_cgroup *old = stock->cached;
+	struct mem_cgroup *old = stock->cached[i];
 
 	if (!old)
 		return;
 
-	if (stock->nr_pages) {
-		page_counter_uncharge(&old->memory, stock->nr_pages);
+	if (stock->nr_pages[i]) {
+		page_counter_uncharge(&old->memory, stock->nr_pages[i]);
 		if (do_memsw_account())
-			page_counter_uncharge(&old->memsw, stock->nr_pages);
-		stock->nr_pages = 0;
+			page_counter_uncharge(&old->memsw, stock->nr_pages[i]);
+		stock->nr_pages[i] = 0;
 	}
 
 	css_put(&old->css);
-	stock->cached = NULL;
+	WRITE_ONCE(stock->cached[i], NULL);
+}
+
+static void drain_stock_fully(struct memcg_stock_pcp *stock)
+{
+	int i;
+
+	for (i = 0; i < NR_MEMCG_STOCK; i++)
+		drain_stock(stock, i);
 }
 
 static void drain_local_stock(struct work_struct *dummy)
@@ -2321,7 +2345,7 @@ static void drain_local_stock(struct work_struct *dummy)
 
 	stock = this_cpu_ptr(&memcg_stock);
 	old = drain_obj_stock(stock);
-	drain_stock(stock);
+	drain_stock_fully(stock);
 	clear_bit(FLUSHING_CACHED_CHARGE, &stock->flags);
 
 	local_unlock_irqrestore(&memcg_stock.stock_lock, flags);
@@ -2336,17 +2360,30 @@ static void drain_local_stock(struct work_struct *dummy)
 static void __refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 {
 	struct memcg_stock_pcp *stock;
+	int i, empty = -1;
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (stock->cached != memcg) { /* reset if necessary */
-		drain_stock(stock);
+	for (i = 0; i < NR_MEMCG_STOCK; i++) {
+		if (stock->cached[i] == memcg)
+			break;
+		if (empty < 0 && !stock->cached[i])
+			empty = i;
+	}
+
+	if (i == NR_MEMCG_STOCK) {
+		/* not cached yet: take a free slot or evict a random one */
+		if (empty < 0) {
+			empty = get_random_u32_below(NR_MEMCG_STOCK);
+			drain_stock(stock, empty);
+		}
+		i = empty;
 		css_get(&memcg->css);
-		stock->cached = memcg;
+		WRITE_ONCE(stock->cached[i], memcg);
 	}
-	stock->nr_pages += nr_pages;
+	stock->nr_pages[i] += nr_pages;
 
-	if (stock->nr_pages > MEMCG_CHARGE_BATCH)
-		drain_stock(stock);
+	if (stock->nr_pages[i] > MEMCG_CHARGE_BATCH)
+		drain_stock(stock, i);
 }
 
 static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
@@ -2381,13 +2418,18 @@ static void drain_all_stock(struct mem_cgroup *root_memcg)
 		struct memcg_stock_pcp *stock = &per_cpu(memcg_stock, cpu);
 		struct mem_cgroup *memcg;
 		bool flush = false;
+		int i;
 
 		rcu_read_lock();
-		memcg = stock->cached;
-		if (memcg && stock->nr_pages &&
-		    mem_cgroup_is_descendant(memcg, root_memcg))
-			flush = true;
-		else if (obj_stock_flush_required(stock, root_memcg))
+		for (i = 0; i < NR_MEMCG_STOCK; i++) {
+			memcg = READ_ONCE(stock->cached[i]);
+			if (memcg && READ_ONCE(stock->nr_pages[i]) &&
+			    mem_cgroup_is_descendant(memcg, root_memcg)) {
+				flush = true;
+				break;
+			}
+		}
+		if (!flush && obj_stock_flush_required(stock, root_memcg))
 			flush = true;
 		rcu_read_unlock();
 
@@ -2408,7 +2450,7 @@ static int memcg_hotplug_cpu_dead(unsigned int cpu)
 	struct memcg_stock_pcp *stock;
 
 	stock = &per_cpu(memcg_stock, cpu);
-	drain_stock(stock);
+	drain_stock_fully(stock);
 
 	return 0;
 }
@@ -2431,7 +2473,7 @@ static unsigned long reclaim_high(struct mem_cgroup *memcg,
 		psi_memstall_enter(&pflags);
 		nr_reclaimed += try_to_free_mem_cgroup_pages(memcg, nr_pages,
 							gfp_mask,
-							MEMCG_RECLAIM_MAY_SWAP);
+							MEMCG_RECLAIM_MAY_SWAP, 0);
 		psi_memstall_leave(&pflags);
 	} while ((memcg = parent_mem_cgroup(memcg)) &&
 		 !mem_cgroup_is_root(memcg));
@@ -2722,7 +2764,7 @@ static int try_charge_memcg(struct mem_cgroup *memcg, gfp_t gfp_mask,
 
 	psi_memstall_enter(&pflags);
 	nr_reclaimed = try_to_free_mem_cgroup_pages(mem_over_limit, nr_pages,
-						    gfp_mask, reclaim_options);
+						    gfp_mask, reclaim_options, 0);
 	psi_memstall_leave(&pflags);
 
 	if (mem_cgroup_margin(mem_over_limit) >= nr_pages)
@@ -3543,7 +3585,7 @@ static int mem_cgroup_resize_max(struct mem_cgroup *memcg,
 		}
 
 		if (!try_to_free_mem_cgroup_pages(memcg, 1, GFP_KERNEL,
-					memsw ? 0 : MEMCG_RECLAIM_MAY_SWAP)) {
+					memsw ? 0 : MEMCG_RECLAIM_MAY_SWAP, 0)) {
 			ret = -EBUSY;
 			break;
 		}
@@ -3657,7 +3699,7 @@ static int mem_cgroup_force_empty(struct mem_cgroup *memcg)
 			return -EINTR;
 
 		if (!try_to_free_mem_cgroup_pages(memcg, 1, GFP_KERNEL,
-						  MEMCG_RECLAIM_MAY_SWAP))
+						  MEMCG_RECLAIM_MAY_SWAP, 0))
 			nr_retries--;
 	}
 
@@ -6540,7 +6582,7 @@ static ssize_t memory_high_write(struct kernfs_open_file *of,
 		}
 
 		reclaimed = try_to_free_mem_cgroup_pages(memcg, nr_pages - high,
-					GFP_KERNEL, MEMCG_RECLAIM_MAY_SWAP);
+					GFP_KERNEL, MEMCG_RECLAIM_MAY_SWAP, 0);
 
 		if (!reclaimed && !nr_retries--)
 			break;
@@ -6589,7 +6631,7 @@ static ssize_t memory_max_write(struct kernfs_open_file *of,
 
 		if (nr_reclaims) {
 			if (!try_to_free_mem_cgroup_pages(memcg, nr_pages - max,
-					GFP_KERNEL, MEMCG_RECLAIM_MAY_SWAP))
+					GFP_KERNEL, MEMCG_RECLAIM_MAY_SWAP, 0))
 				nr_reclaims--;
 			continue;
 		}
@@ -6712,19 +6754,54 @@ static ssize_t memory_oom_group_write(struct kernfs_open_file *of,
 	return nbytes;
 }
 
+enum {
+	MEMORY_RECLAIM_AGE = 0,
+	MEMORY_RECLAIM_NULL,
+};
+
+static const match_table_t memory_reclaim_tokens = {
+	{ MEMORY_RECLAIM_AGE, "age=%u"},
+	{ MEMORY_RECLAIM_NULL, NULL },
+};
+
 static ssize_t memory_reclaim(struct kernfs_open_file *of, char *buf,
 			      size_t nbytes, loff_t off)
 {
 	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
 	unsigned int nr_retries = MAX_RECLAIM_RETRIES;
 	unsigned long nr_to_reclaim, nr_reclaimed = 0;
+	unsigned long min_age = 0;
 	unsigned int reclaim_options;
-	int err;
+	char *old_buf, *start;
+	substring_t args[MAX_OPT_ARGS];
+	unsigned int age_ms;
 
 	buf = strstrip(buf);
-	err = page_counter_memparse(buf, "", &nr_to_reclaim);
-	if (err)
-		return err;
+
+	old_buf = buf;
+	nr_to_reclaim = memparse(buf, &buf) / PAGE_SIZE;
+	if (buf == old_buf)
+		return -EINVAL;
+
+	buf = strstrip(buf);
+
+	while ((start = strsep(&buf, " ")) != NULL) {
+		if (!strlen(start))
+			continue;
+		switch (match_token(start, memory_reclaim_tokens, args)) {
+		case MEMORY_RECLAIM_AGE:
+			if (match_uint(&args[0], &age_ms) || !age_ms)
+				return -EINVAL;
+			min_age = msecs_to_jiffies(age_ms);
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	/* only the multi-gen LRU tracks the age of what it reclaims */
+	if (min_age && !lru_gen_enabled())
+		return -EOPNOTSUPP;
 
 	reclaim_options	= MEMCG_RECLAIM_MAY_SWAP | MEMCG_RECLAIM_PROACTIVE;
 	while (nr_reclaimed < nr_to_reclaim) {
@@ -6743,10 +6820,12 @@ static ssize_t memory_reclaim(struct kernfs_open_file *of, char *buf,
 
 		reclaimed = try_to_free_mem_cgroup_pages(memcg,
 						nr_to_reclaim - nr_reclaimed,
-						GFP_KERNEL, reclaim_options);
+						GFP_KERNEL, reclaim_options,
+						min_age);
 
+		/* with an age, running out of old enough pages is success */
 		if (!reclaimed && !nr_retries--)
-			return -EAGAIN;
+			return min_age ? nbytes : -EAGAIN;
 
 		nr_reclaimed += reclaimed;
 	}
@@ -6754,6 +6833,97 @@ static ssize_t memory_reclaim(struct kernfs_open_file *of, char *buf,
 	return nbytes;
 }
 
+#ifdef CONFIG_LRU_GEN
+static int memory_wsr_page_age_show(struct seq_file *m, void *v)
+{
+	return lru_gen_wsr_show(m, mem_cgroup_from_seq(m));
+}
+
+static int memory_wsr_intervals_show(struct seq_file *m, void *v)
+{
+	struct lru_gen_wsr *wsr = &mem_cgroup_from_seq(m)->wsr;
+	unsigned int i;
+
+	mutex_lock(&wsr->lock);
+	for (i = 0; i < wsr->nr_intervals; i++)
+		seq_printf(m, "%s%u", i ? "," : "",
+			   jiffies_to_msecs(wsr->intervals[i]));
+	mutex_unlock(&wsr->lock);
+	seq_putc(m, '\n');
+
+	return 0;
+}
+
+/* a comma separated list of ascending bin bounds in milliseconds */
+static ssize_t memory_wsr_intervals_write(struct kernfs_open_file *of,
+					  char *buf, size_t nbytes, loff_t off)
+{
+	struct lru_gen_wsr *wsr = &mem_cgroup_from_css(of_css(of))->wsr;
+	unsigned long intervals[MAX_NR_WSR_BINS];
+	unsigned int nr = 0;
+	char *cur;
+
+	buf = strstrip(buf);
+	if (!*buf)
+		buf = NULL;
+
+	while ((cur = strsep(&buf, ","))) {
+		unsigned int msecs;
+
+		if (nr == MAX_NR_WSR_BINS)
+			return -E2BIG;
+		if (kstrtouint(strstrip(cur), 0, &msecs) || !msecs)
+			return -EINVAL;
+
+		intervals[nr] = msecs_to_jiffies(msecs);
+		if (nr && intervals[nr] <= intervals[nr - 1])
+			return -EINVAL;
+		nr++;
+	}
+
+	mutex_lock(&wsr->lock);
+	memcpy(wsr->intervals, intervals, nr * sizeof(*intervals));
+	wsr->nr_intervals = nr;
+	mutex_unlock(&wsr->lock);
+
+	return nbytes;
+}
+
+static u64 memory_wsr_refresh_read(struct cgroup_subsys_state *css,
+				   struct cftype *cft)
+{
+	return jiffies_to_msecs(READ_ONCE(mem_cgroup_from_css(css)->wsr.refresh_interval));
+}
+
+static int memory_wsr_refresh_write(struct cgroup_subsys_state *css,
+				    struct cftype *cft, u64 val)
+{
+	if (val > UINT_MAX)
+		return -EINVAL;
+
+	WRITE_ONCE(mem_cgroup_from_css(css)->wsr.refresh_interval,
+		   msecs_to_jiffies(val));
+	return 0;
+}
+
+static u64 memory_wsr_threshold_read(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return jiffies_to_msecs(READ_ONCE(mem_cgroup_from_css(css)->wsr.report_threshold));
+}
+
+static int memory_wsr_threshold_write(struct cgroup_subsys_state *css,
+				      struct cftype *cft, u64 val)
+{
+	if (val > UINT_MAX)
+		return -EINVAL;
+
+	WRITE_ONCE(mem_cgroup_from_css(css)->wsr.report_threshold,
+		   msecs_to_jiffies(val));
+	return 0;
+}
+#endif /* CONFIG_LRU_GEN */
+
 static struct cftype memory_files[] = {
 	{
 		.name = "current",
@@ -6822,6 +6992,28 @@ static struct cftype memory_files[] = {
 		.flags = CFTYPE_NS_DELEGATABLE,
 		.write = memory_reclaim,
 	},
+#ifdef CONFIG_LRU_GEN
+	{
+		.name = "workingset.page_age",
+		.file_offset = offsetof(struct mem_cgroup, wsr.page_age_file),
+		.seq_show = memory_wsr_page_age_show,
+	},
+	{
+		.name = "workingset.page_age_intervals",
+		.seq_show = memory_wsr_intervals_show,
+		.write = memory_wsr_intervals_write,
+	},
+	{
+		.name = "workingset.refresh_interval",
+		.read_u64 = memory_wsr_refresh_read,
+		.write_u64 = memory_wsr_refresh_write,
+	},
+	{
+		.name = "workingset.report_threshold",
+		.read_u64 = memory_wsr_threshold_read,
+		.write_u64 = memory_wsr_threshold_write,
+	},
+#endif
 	{ }	/* terminate */
 };
 
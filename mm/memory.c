@@ -3030,6 +3030,41 @@ static inline void wp_page_reuse(struct vm_fault *vmf)
 	count_vm_event(PGREUSE);
 }
 
+/*
+ * Only ->fault handlers of page cache backed mappings (those that also
+ * provide ->map_pages) are known to cope without mmap_lock. Anything else is
+ * retried under mmap_lock.
+ */
+static vm_fault_t vmf_can_call_fault(const struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+
+	if (vma->vm_ops->map_pages || !(vmf->flags & FAULT_FLAG_VMA_LOCK))
+		return 0;
+	vma_end_read(vma);
+	return VM_FAULT_RETRY;
+}
+
+/*
+ * Make sure the VMA has an anon_vma before an anonymous folio is mapped into
+ * it. Setting one up looks at the neighbouring VMAs, which the per-VMA lock
+ * does not cover, so that has to be retried under mmap_lock.
+ */
+vm_fault_t vmf_anon_prepare(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+
+	if (likely(vma->anon_vma))
+		return 0;
+	if (vmf->flags & FAULT_FLAG_VMA_LOCK) {
+		vma_end_read(vma);
+		return VM_FAULT_RETRY;
+	}
+	if (__anon_vma_prepare(vma))
+		return VM_FAULT_OOM;
+	return 0;
+}
+
 /*
  * Handle the case of a page which we actually need to copy to a new page,
  * either due to COW or unsharing.
@@ -3057,14 +3092,21 @@ static vm_fault_t wp_page_copy(struct vm_fault *vmf)
 	pte_t entry;
 	int page_copied = 0;
 	struct mmu_notifier_range range;
+	vm_fault_t fault;
 	int ret;
 
 	delayacct_wpcopy_start();
 
 	if (vmf->page)
 		old_folio = page_folio(vmf->page);
-	if (unlikely(anon_vma_prepare(vma)))
-		goto oom;
+	fault = vmf_anon_prepare(vmf);
+	if (unlikely(fault)) {
+		if (old_folio)
+			folio_put(old_folio);
+
+		delayacct_wpcopy_end();
+		return fault;
+	}
 
 	if (is_zero_pfn(pte_pfn(vmf->orig_pte))) {
 		new_folio = vma_alloc_zeroed_movable_folio(vma, vmf->address);
@@ -3255,6 +3297,10 @@ static vm_fault_t wp_pfn_shared(struct vm_fault *vmf)
 		vm_fault_t ret;
 
 		pte_unmap_unlock(vmf->pte, vmf->ptl);
+		ret = vmf_can_call_fault(vmf);
+		if (ret)
+			return ret;
+
 		vmf->flags |= FAULT_FLAG_MKWRITE;
 		ret = vma->vm_ops->pfn_mkwrite(vmf);
 		if (ret & (VM_FAULT_ERROR | VM_FAULT_NOPAGE))
@@ -3277,6 +3323,12 @@ static vm_fault_t wp_page_shared(struct vm_fault *vmf)
 		vm_fault_t tmp;
 
 		pte_unmap_unlock(vmf->pte, vmf->ptl);
+		tmp = vmf_can_call_fault(vmf);
+		if (tmp) {
+			put_page(vmf->page);
+			return tmp;
+		}
+
 		tmp = do_page_mkwrite(vmf);
 		if (unlikely(!tmp || (tmp &
 				      (VM_FAULT_ERROR | VM_FAULT_NOPAGE)))) {
@@ -3580,7 +3632,7 @@ static vm_fault_t remove_device_exclusive_entry(struct vm_fault *vmf)
 	if (!folio_try_get(folio))
 		return 0;
 
-	if (!folio_lock_or_retry(folio, vma->vm_mm, vmf->flags)) {
+	if (!folio_lock_or_retry(folio, vmf)) {
 		folio_put(folio);
 		return VM_FAULT_RETRY;
 	}
@@ -3686,6 +3738,167 @@ static vm_fault_t handle_pte_marker(struct vm_fault *vmf)
 	return VM_FAULT_SIGBUS;
 }
 
+/* The swap PTE @delta slots on from @orig, carrying the same swap PTE bits */
+static pte_t swap_pte_advance(pte_t orig, long delta)
+{
+	swp_entry_t entry = pte_to_swp_entry(orig);
+	pte_t pte;
+
+	pte = swp_entry_to_pte(swp_entry(swp_type(entry),
+					 swp_offset(entry) + delta));
+	if (pte_swp_soft_dirty(orig))
+		pte = pte_swp_mksoft_dirty(pte);
+	if (pte_swp_exclusive(orig))
+		pte = pte_swp_mkexclusive(pte);
+	if (pte_swp_uffd_wp(orig))
+		pte = pte_swp_mkuffd_wp(pte);
+
+	return pte;
+}
+
+/*
+ * Check that the @nr PTEs from @ptep, which map @addr onwards and cover the
+ * faulting address, hold the consecutive swap entries around vmf->orig_pte.
+ */
+static bool swap_pte_range_same(struct vm_fault *vmf, pte_t *ptep,
+				unsigned long addr, int nr)
+{
+	long idx = (vmf->address - addr) >> PAGE_SHIFT;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		if (!pte_same(ptep_get(ptep + i),
+			      swap_pte_advance(vmf->orig_pte, i - idx)))
+			return false;
+	}
+
+	return true;
+}
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+static bool swap_range_swapin_ok(struct vm_fault *vmf,
+				 struct swap_info_struct *si, pte_t *ptep,
+				 unsigned long addr, int nr)
+{
+	pgoff_t offset = swp_offset(pte_to_swp_entry(vmf->orig_pte));
+	long idx = (vmf->address - addr) >> PAGE_SHIFT;
+	int i;
+
+	if (offset < idx || offset - idx + nr > si->max)
+		return false;
+
+	if (!swap_pte_range_same(vmf, ptep, addr, nr))
+		return false;
+
+	/* Exactly one reference to each slot, and none in the swap cache */
+	for (i = 0; i < nr; i++) {
+		if (READ_ONCE(si->swap_map[offset - idx + i]) != 1)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Pages swapped out together from one large folio occupy consecutive swap
+ * slots. When every PTE of a naturally aligned range still maps such a run
+ * and nothing else references the slots, read the run back into a single
+ * folio instead of one fault per page.
+ */
+static struct folio *alloc_swapin_large_folio(struct vm_fault *vmf,
+					      struct swap_info_struct *si)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	unsigned long orders, addr, size;
+	struct folio *folio;
+	pte_t *pte;
+	gfp_t gfp;
+	int order;
+
+	/* See alloc_anon_large_folio(); swap files on a filesystem read by page */
+	if (userfaultfd_armed(vma) || (vma->vm_flags & VM_MTE) ||
+	    data_race(si->flags & SWP_FS_OPS))
+		return NULL;
+
+	orders = thp_vma_anon_orders(vma);
+	if (!orders)
+		return NULL;
+
+	pte = pte_offset_map(vmf->pmd, vmf->address & PMD_MASK);
+	for (order = HPAGE_PMD_ORDER - 1; order > 1; order--) {
+		if (!(orders & BIT(order)))
+			continue;
+		size = PAGE_SIZE << order;
+		addr = ALIGN_DOWN(vmf->address, size);
+		if (addr < vma->vm_start || addr + size > vma->vm_end)
+			continue;
+		if (swap_range_swapin_ok(vmf, si, pte + pte_index(addr), addr,
+					 1 << order))
+			break;
+	}
+	pte_unmap(pte);
+
+	/* Every smaller allowed order lies inside the range checked above */
+	gfp = vma_thp_gfp_mask(vma);
+	for (; order > 1; order--) {
+		if (!(orders & BIT(order)))
+			continue;
+		addr = ALIGN_DOWN(vmf->address, PAGE_SIZE << order);
+		folio = vma_alloc_folio(gfp, order, vma, addr, true);
+		if (folio)
+			return folio;
+	}
+
+	return NULL;
+}
+#else
+static inline struct folio *alloc_swapin_large_folio(struct vm_fault *vmf,
+						     struct swap_info_struct *si)
+{
+	return NULL;
+}
+#endif
+
+/*
+ * Map a large folio freshly read by do_swap_page(), which bypassed the swap
+ * cache and so is certainly exclusive, over the swap PTEs from @ptep.
+ */
+static void map_swapin_large_folio(struct vm_fault *vmf, struct folio *folio,
+				   swp_entry_t entry, unsigned long addr,
+				   pte_t *ptep)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	long i, nr = folio_nr_pages(folio);
+	struct page *page;
+	pte_t pte;
+
+	for (i = 0; i < nr; i++)
+		swap_free(swp_entry(swp_type(entry), swp_offset(entry) + i));
+
+	add_mm_counter(vma->vm_mm, MM_ANONPAGES, nr);
+	add_mm_counter(vma->vm_mm, MM_SWAPENTS, -nr);
+	/* Each PTE holds its own reference, as for a PTE-mapped THP */
+	folio_ref_add(folio, nr - 1);
+
+	for (i = 0; i < nr; i++, addr += PAGE_SIZE) {
+		page = folio_page(folio, i);
+		pte = mk_pte(page, vma->vm_page_prot);
+		if (vmf->flags & FAULT_FLAG_WRITE)
+			pte = maybe_mkwrite(pte_mkdirty(pte), vma);
+		if (pte_swp_soft_dirty(vmf->orig_pte))
+			pte = pte_mksoft_dirty(pte);
+
+		/* The first call sets up the folio's anon mapping at its head */
+		page_add_anon_rmap(page, vma, addr, RMAP_EXCLUSIVE);
+		set_pte_at(vma->vm_mm, addr, ptep + i, pte);
+
+		/* No need to invalidate - it was non-present before */
+		update_mmu_cache(vma, addr, ptep + i);
+	}
+
+	vmf->flags &= ~FAULT_FLAG_WRITE;
+}
+
 /*
  * We enter with non-exclusive mmap_lock (to exclude vma changes,
  * but allow concurrent faults), and pte mapped but not yet locked.
@@ -3701,21 +3914,20 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 	struct page *page;
 	struct swap_info_struct *si = NULL;
 	rmap_t rmap_flags = RMAP_NONE;
+	unsigned long address = vmf->address;
 	bool exclusive = false;
 	swp_entry_t entry;
+	int nr_pages = 1;
+	pte_t *ptep;
 	pte_t pte;
 	int locked;
 	vm_fault_t ret = 0;
 	void *shadow = NULL;
+	int i;
 
 	if (!pte_unmap_same(vmf))
 		goto out;
 
-	if (vmf->flags & FAULT_FLAG_VMA_LOCK) {
-		ret = VM_FAULT_RETRY;
-		goto out;
-	}
-
 	entry = pte_to_swp_entry(vmf->orig_pte);
 	if (unlikely(non_swap_entry(entry))) {
 		if (is_migration_entry(entry)) {
@@ -3725,6 +3937,16 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 			vmf->page = pfn_swap_entry_to_page(entry);
 			ret = remove_device_exclusive_entry(vmf);
 		} else if (is_device_private_entry(entry)) {
+			if (vmf->flags & FAULT_FLAG_VMA_LOCK) {
+				/*
+				 * migrate_to_ram is not yet ready to operate
+				 * under VMA lock.
+				 */
+				vma_end_read(vma);
+				ret = VM_FAULT_RETRY;
+				goto out;
+			}
+
 			vmf->page = pfn_swap_entry_to_page(entry);
 			vmf->pte = pte_offset_map_lock(vma->vm_mm, vmf->pmd,
 					vmf->address, &vmf->ptl);
@@ -3766,20 +3988,33 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 		if (data_race(si->flags & SWP_SYNCHRONOUS_IO) &&
 		    __swap_count(entry) == 1) {
 			/* skip swapcache */
-			folio = vma_alloc_folio(GFP_HIGHUSER_MOVABLE, 0,
-						vma, vmf->address, false);
+			folio = alloc_swapin_large_folio(vmf, si);
+			if (!folio)
+				folio = vma_alloc_folio(GFP_HIGHUSER_MOVABLE, 0,
+							vma, vmf->address, false);
 			page = &folio->page;
 			if (folio) {
 				__folio_set_locked(folio);
 				__folio_set_swapbacked(folio);
 
+				nr_pages = folio_nr_pages(folio);
+				if (nr_pages > 1) {
+					address = ALIGN_DOWN(vmf->address,
+							     nr_pages * PAGE_SIZE);
+					entry = swp_entry(swp_type(entry),
+							  swp_offset(entry) -
+							  ((vmf->address - address) >> PAGE_SHIFT));
+				}
+
 				if (mem_cgroup_swapin_charge_folio(folio,
 							vma->vm_mm, GFP_KERNEL,
 							entry)) {
 					ret = VM_FAULT_OOM;
 					goto out_page;
 				}
-				mem_cgroup_swapin_uncharge_swap(entry);
+				for (i = 0; i < nr_pages; i++)
+					mem_cgroup_swapin_uncharge_swap(swp_entry(swp_type(entry),
+										  swp_offset(entry) + i));
 
 				shadow = get_shadow_from_swap_cache(entry);
 				if (shadow)
@@ -3788,9 +4023,12 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 				folio_add_lru(folio);
 
 				/* To provide entry to swap_readpage() */
-				folio_set_swap_entry(folio, entry);
+				for (i = 0; i < nr_pages; i++)
+					set_page_private(folio_page(folio, i),
+							 entry.val + i);
 				swap_readpage(page, true, NULL);
-				folio->private = NULL;
+				for (i = 0; i < nr_pages; i++)
+					set_page_private(folio_page(folio, i), 0);
 			}
 		} else {
 			page = swapin_readahead(entry, GFP_HIGHUSER_MOVABLE,
@@ -3825,7 +4063,7 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 		goto out_release;
 	}
 
-	locked = folio_lock_or_retry(folio, vma->vm_mm, vmf->flags);
+	locked = folio_lock_or_retry(folio, vmf);
 
 	if (!locked) {
 		ret |= VM_FAULT_RETRY;
@@ -3880,6 +4118,10 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 	if (unlikely(!pte_same(*vmf->pte, vmf->orig_pte)))
 		goto out_nomap;
 
+	ptep = vmf->pte - ((vmf->address - address) >> PAGE_SHIFT);
+	if (nr_pages > 1 && !swap_pte_range_same(vmf, ptep, address, nr_pages))
+		goto out_nomap;
+
 	if (unlikely(!folio_test_uptodate(folio))) {
 		ret = VM_FAULT_SIGBUS;
 		goto out_nomap;
@@ -3939,6 +4181,12 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 	 */
 	arch_swap_restore(entry, folio);
 
+	if (nr_pages > 1) {
+		map_swapin_large_folio(vmf, folio, entry, address, ptep);
+		folio_unlock(folio);
+		goto unlock;
+	}
+
 	/*
 	 * Remove the swap entry and conditionally try to free up the swapcache.
 	 * We're already holding a reference on the page but haven't mapped it
@@ -4030,6 +4278,123 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 	return ret;
 }
 
+static bool pte_range_none(pte_t *pte, int nr_pages)
+{
+	int i;
+
+	for (i = 0; i < nr_pages; i++) {
+		if (!pte_none(ptep_get(pte + i)))
+			return false;
+	}
+
+	return true;
+}
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+/*
+ * Try the largest order the per-size policy allows whose naturally aligned
+ * range fits the VMA and is entirely unpopulated, falling back to smaller
+ * orders if the allocation or the memcg charge fails.
+ */
+static struct folio *alloc_anon_large_folio(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	unsigned long orders, addr, size;
+	struct folio *folio;
+	pte_t *pte;
+	gfp_t gfp;
+	int order;
+
+	/*
+	 * userfaultfd resolves missing faults one page at a time, and MTE
+	 * tags are only zeroed by the order-0 allocation path.
+	 */
+	if (userfaultfd_armed(vma) || (vma->vm_flags & VM_MTE))
+		return NULL;
+
+	orders = thp_vma_anon_orders(vma);
+	if (!orders)
+		return NULL;
+
+	pte = pte_offset_map(vmf->pmd, vmf->address & PMD_MASK);
+	for (order = HPAGE_PMD_ORDER - 1; order > 1; order--) {
+		if (!(orders & BIT(order)))
+			continue;
+		size = PAGE_SIZE << order;
+		addr = ALIGN_DOWN(vmf->address, size);
+		if (addr < vma->vm_start || addr + size > vma->vm_end)
+			continue;
+		if (pte_range_none(pte + pte_index(addr), 1 << order))
+			break;
+	}
+	pte_unmap(pte);
+
+	/* Every smaller allowed order fits inside the range checked above */
+	gfp = vma_thp_gfp_mask(vma);
+	for (; order > 1; order--) {
+		if (!(orders & BIT(order)))
+			continue;
+		size = PAGE_SIZE << order;
+		addr = ALIGN_DOWN(vmf->address, size);
+		folio = vma_alloc_folio(gfp, order, vma, addr, true);
+		if (!folio)
+			continue;
+		if (mem_cgroup_charge(folio, vma->vm_mm, gfp)) {
+			folio_put(folio);
+			continue;
+		}
+		clear_huge_page(&folio->page, vmf->address, 1 << order);
+		return folio;
+	}
+
+	return NULL;
+}
+#else
+static inline struct folio *alloc_anon_large_folio(struct vm_fault *vmf)
+{
+	return NULL;
+}
+#endif
+
+static struct folio *alloc_anon_folio(struct vm_fault *vmf)
+{
+	struct folio *folio;
+
+	folio = alloc_anon_large_folio(vmf);
+	if (folio)
+		return folio;
+
+	folio = vma_alloc_zeroed_movable_folio(vmf->vma, vmf->address);
+	if (!folio)
+		return NULL;
+
+	if (mem_cgroup_charge(folio, vmf->vma->vm_mm, GFP_KERNEL)) {
+		folio_put(folio);
+		return NULL;
+	}
+
+	return folio;
+}
+
+static void set_anon_folio_ptes(struct vm_area_struct *vma,
+				struct folio *folio, unsigned long addr,
+				pte_t *pte)
+{
+	long i, nr = folio_nr_pages(folio);
+	pte_t entry;
+
+	for (i = 0; i < nr; i++, addr += PAGE_SIZE) {
+		entry = mk_pte(folio_page(folio, i), vma->vm_page_prot);
+		entry = pte_sw_mkyoung(entry);
+		if (vma->vm_flags & VM_WRITE)
+			entry = pte_mkwrite(pte_mkdirty(entry));
+		set_pte_at(vma->vm_mm, addr, pte + i, entry);
+
+		/* No need to invalidate - it was non-present before */
+		update_mmu_cache(vma, addr, pte + i);
+	}
+}
+
 /*
  * We enter with non-exclusive mmap_lock (to exclude vma changes,
  * but allow concurrent faults), and pte mapped but not yet locked.
@@ -4039,8 +4404,10 @@ static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
 {
 	bool uffd_wp = vmf_orig_pte_uffd_wp(vmf);
 	struct vm_area_struct *vma = vmf->vma;
+	unsigned long addr;
 	struct folio *folio;
 	vm_fault_t ret = 0;
+	int nr_pages;
 	pte_t entry;
 
 	/* File mapping without ->vm_ops ? */
@@ -4087,16 +4454,17 @@ static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
 	}
 
 	/* Allocate our own private page. */
-	if (unlikely(anon_vma_prepare(vma)))
-		goto oom;
-	folio = vma_alloc_zeroed_movable_folio(vma, vmf->address);
+	ret = vmf_anon_prepare(vmf);
+	if (ret)
+		return ret;
+	folio = alloc_anon_folio(vmf);
 	if (!folio)
 		goto oom;
-
-	if (mem_cgroup_charge(folio, vma->vm_mm, GFP_KERNEL))
-		goto oom_free_page;
 	folio_throttle_swaprate(folio, GFP_KERNEL);
 
+	nr_pages = folio_nr_pages(folio);
+	addr = ALIGN_DOWN(vmf->address, nr_pages * PAGE_SIZE);
+
 	/*
 	 * The memory barrier inside __folio_mark_uptodate makes sure that
 	 * preceding stores to the page contents become visible before
@@ -4109,11 +4477,13 @@ static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
 	if (vma->vm_flags & VM_WRITE)
 		entry = pte_mkwrite(pte_mkdirty(entry));
 
-	vmf->pte = pte_offset_map_lock(vma->vm_mm, vmf->pmd, vmf->address,
-			&vmf->ptl);
-	if (vmf_pte_changed(vmf)) {
+	vmf->pte = pte_offset_map_lock(vma->vm_mm, vmf->pmd, addr, &vmf->ptl);
+	if (nr_pages == 1 && vmf_pte_changed(vmf)) {
 		update_mmu_tlb(vma, vmf->address, vmf->pte);
 		goto release;
+	} else if (nr_pages > 1 && !pte_range_none(vmf->pte, nr_pages)) {
+		/* Raced with another fault in the range, retry it */
+		goto release;
 	}
 
 	ret = check_stable_address_space(vma->vm_mm);
@@ -4127,9 +4497,15 @@ static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
 		return handle_userfault(vmf, VM_UFFD_MISSING);
 	}
 
-	inc_mm_counter(vma->vm_mm, MM_ANONPAGES);
-	folio_add_new_anon_rmap(folio, vma, vmf->address);
+	/* Each PTE holds its own reference, as for a PTE-mapped THP */
+	folio_ref_add(folio, nr_pages - 1);
+	add_mm_counter(vma->vm_mm, MM_ANONPAGES, nr_pages);
+	folio_add_new_anon_rmap(folio, vma, addr);
 	folio_add_lru_vma(folio, vma);
+	if (nr_pages > 1) {
+		set_anon_folio_ptes(vma, folio, addr, vmf->pte);
+		goto unlock;
+	}
 setpte:
 	if (uffd_wp)
 		entry = pte_mkuffd_wp(entry);
@@ -4143,8 +4519,6 @@ static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
 release:
 	folio_put(folio);
 	goto unlock;
-oom_free_page:
-	folio_put(folio);
 oom:
 	return VM_FAULT_OOM;
 }
@@ -4534,6 +4908,10 @@ static vm_fault_t do_read_fault(struct vm_fault *vmf)
 			return ret;
 	}
 
+	ret = vmf_can_call_fault(vmf);
+	if (ret)
+		return ret;
+
 	ret = __do_fault(vmf);
 	if (unlikely(ret & (VM_FAULT_ERROR | VM_FAULT_NOPAGE | VM_FAULT_RETRY)))
 		return ret;
@@ -4550,8 +4928,11 @@ static vm_fault_t do_cow_fault(struct vm_fault *vmf)
 	struct vm_area_struct *vma = vmf->vma;
 	vm_fault_t ret;
 
-	if (unlikely(anon_vma_prepare(vma)))
-		return VM_FAULT_OOM;
+	ret = vmf_can_call_fault(vmf);
+	if (!ret)
+		ret = vmf_anon_prepare(vmf);
+	if (ret)
+		return ret;
 
 	vmf->cow_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, vmf->address);
 	if (!vmf->cow_page)
@@ -4589,6 +4970,10 @@ static vm_fault_t do_shared_fault(struct vm_fault *vmf)
 	struct vm_area_struct *vma = vmf->vma;
 	vm_fault_t ret, tmp;
 
+	ret = vmf_can_call_fault(vmf);
+	if (ret)
+		return ret;
+
 	ret = __do_fault(vmf);
 	if (unlikely(ret & (VM_FAULT_ERROR | VM_FAULT_NOPAGE | VM_FAULT_RETRY)))
 		return ret;
@@ -4812,10 +5197,16 @@ static vm_fault_t do_numa_page(struct vm_fault *vmf)
 
 static inline vm_fault_t create_huge_pmd(struct vm_fault *vmf)
 {
+	vm_fault_t ret;
+
 	if (vma_is_anonymous(vmf->vma))
 		return do_huge_pmd_anonymous_page(vmf);
-	if (vmf->vma->vm_ops->huge_fault)
+	if (vmf->vma->vm_ops->huge_fault) {
+		ret = vmf_can_call_fault(vmf);
+		if (ret)
+			return ret;
 		return vmf->vma->vm_ops->huge_fault(vmf, PE_SIZE_PMD);
+	}
 	return VM_FAULT_FALLBACK;
 }
 
@@ -4834,6 +5225,9 @@ static inline vm_fault_t wp_huge_pmd(struct vm_fault *vmf)
 
 	if (vmf->vma->vm_flags & (VM_SHARED | VM_MAYSHARE)) {
 		if (vmf->vma->vm_ops->huge_fault) {
+			ret = vmf_can_call_fault(vmf);
+			if (ret)
+				return ret;
 			ret = vmf->vma->vm_ops->huge_fault(vmf, PE_SIZE_PMD);
 			if (!(ret & VM_FAULT_FALLBACK))
 				return ret;
@@ -4853,8 +5247,13 @@ static vm_fault_t create_huge_pud(struct vm_fault *vmf)
 	/* No support for anonymous transparent PUD pages yet */
 	if (vma_is_anonymous(vmf->vma))
 		return VM_FAULT_FALLBACK;
-	if (vmf->vma->vm_ops->huge_fault)
+	if (vmf->vma->vm_ops->huge_fault) {
+		vm_fault_t ret = vmf_can_call_fault(vmf);
+
+		if (ret)
+			return ret;
 		return vmf->vma->vm_ops->huge_fault(vmf, PE_SIZE_PUD);
+	}
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 	return VM_FAULT_FALLBACK;
 }
@@ -4870,6 +5269,9 @@ static vm_fault_t wp_huge_pud(struct vm_fault *vmf, pud_t orig_pud)
 		goto split;
 	if (vmf->vma->vm_flags & (VM_SHARED | VM_MAYSHARE)) {
 		if (vmf->vma->vm_ops->huge_fault) {
+			ret = vmf_can_call_fault(vmf);
+			if (ret)
+				return ret;
 			ret = vmf->vma->vm_ops->huge_fault(vmf, PE_SIZE_PUD);
 			if (!(ret & VM_FAULT_FALLBACK))
 				return ret;
@@ -5406,22 +5808,13 @@ struct vm_area_struct *lock_vma_under_rcu(struct mm_struct *mm,
 	if (!vma)
 		goto inval;
 
-	/* Only anonymous vmas are supported for now */
-	if (!vma_is_anonymous(vma))
+	/* hugetlb faults still rely on mmap_lock */
+	if (is_vm_hugetlb_page(vma))
 		goto inval;
 
 	if (!vma_start_read(vma))
 		goto inval;
 
-	/*
-	 * find_mergeable_anon_vma uses adjacent vmas which are not locked.
-	 * This check must happen after vma_start_read(); otherwise, a
-	 * concurrent mremap() with MREMAP_DONTUNMAP could dissociate the VMA
-	 * from its anon_vma.
-	 */
-	if (unlikely(!vma->anon_vma))
-		goto inval_end_read;
-
 	/*
 	 * Due to the possibility of userfault handler dropping mmap_lock, avoid
 	 * it for now and fall back to page fault handling under mmap_lock.
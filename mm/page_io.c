@@ -493,6 +493,60 @@ static void swap_readpage_bdev_async(struct page *page,
 	submit_bio(bio);
 }
 
+/*
+ * zswap stores and writes back one page at a time, so the slots of a large
+ * folio may be split between frontswap and the device.
+ */
+static bool swap_folio_in_frontswap(struct folio *folio,
+				    struct swap_info_struct *sis)
+{
+	unsigned long *map = frontswap_map_get(sis);
+	pgoff_t offset = swp_offset(folio_swap_entry(folio));
+	pgoff_t end = offset + folio_nr_pages(folio);
+
+	if (!frontswap_enabled() || !map)
+		return false;
+
+	return find_next_bit(map, end, offset) < end;
+}
+
+/*
+ * Fill a large folio page by page: from frontswap where it holds the page
+ * and from the device otherwise.
+ */
+static void swap_readpage_split(struct folio *folio,
+				struct swap_info_struct *sis)
+{
+	long i, nr = folio_nr_pages(folio);
+	struct bio_vec bv;
+	struct bio bio;
+	int err = 0;
+
+	get_task_struct(current);
+	for (i = 0; i < nr && !err; i++) {
+		struct page *page = folio_page(folio, i);
+
+		if (frontswap_load(page) == 0)
+			continue;
+
+		bio_init(&bio, sis->bdev, &bv, 1, REQ_OP_READ);
+		bio.bi_iter.bi_sector = swap_page_sector(page);
+		bio_add_page(&bio, page, PAGE_SIZE, 0);
+		count_vm_event(PSWPIN);
+		err = submit_bio_wait(&bio);
+		if (err)
+			pr_alert_ratelimited("Read-error on swap-device (%u:%u:%llu)\n",
+					     MAJOR(bio_dev(&bio)),
+					     MINOR(bio_dev(&bio)),
+					     (unsigned long long)bio.bi_iter.bi_sector);
+	}
+	put_task_struct(current);
+
+	if (!err)
+		folio_mark_uptodate(folio);
+	folio_unlock(folio);
+}
+
 void swap_readpage(struct page *page, bool synchronous, struct swap_iocb **plug)
 {
 	struct swap_info_struct *sis = page_swap_info(page);
@@ -515,7 +569,10 @@ void swap_readpage(struct page *page, bool synchronous, struct swap_iocb **plug)
 	}
 	delayacct_swapin_start();
 
-	if (frontswap_load(page) == 0) {
+	if (PageTransCompound(page) &&
+	    swap_folio_in_frontswap(page_folio(page), sis)) {
+		swap_readpage_split(page_folio(page), sis);
+	} else if (frontswap_load(page) == 0) {
 		SetPageUptodate(page);
 		unlock_page(page);
 	} else if (data_race(sis->flags & SWP_FS_OPS)) {
@@ -519,6 +519,7 @@ void page_cache_ra_order(struct readahead_control *ractl,
 		while ((1 << new_order) > ra->size)
 			new_order--;
 	}
+	ra->order = new_order;
 
 	filemap_invalidate_lock_shared(mapping);
 	while (index <= limit) {
@@ -536,8 +537,15 @@ void page_cache_ra_order(struct readahead_control *ractl,
 				order = 0;
 		}
 		err = ra_alloc_folio(ractl, index, mark, order, gfp);
-		if (err)
+		if (err) {
+			/*
+			 * Large folios are hard to come by right now: ramp
+			 * up again from a lower order next time.
+			 */
+			if (err == -ENOMEM)
+				ra->order = order / 2;
 			break;
+		}
 		index += 1UL << order;
 	}
 
@@ -562,8 +570,9 @@ void page_cache_ra_order(struct readahead_control *ractl,
 
 /*
  * A minimal readahead algorithm for trivial sequential/random reads.
+ * Returns true if the readahead window in @ractl->ra was updated.
  */
-static void ondemand_readahead(struct readahead_control *ractl,
+static bool __ondemand_readahead(struct readahead_control *ractl,
 		struct folio *folio, unsigned long req_size)
 {
 	struct backing_dev_info *bdi = inode_to_bdi(ractl->mapping->host);
@@ -573,6 +582,7 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	pgoff_t index = readahead_index(ractl);
 	pgoff_t expected, prev_index;
 	unsigned int order = folio ? folio_order(folio) : 0;
+	unsigned int new_order;
 
 	/*
 	 * If the request exceeds the readahead window, allow the read to
@@ -615,7 +625,7 @@ static void ondemand_readahead(struct readahead_control *ractl,
 		rcu_read_unlock();
 
 		if (!start || start - index > max_pages)
-			return;
+			return false;
 
 		ra->start = start;
 		ra->size = start - index;	/* old async_size */
@@ -653,7 +663,7 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	 * Read as is, and do not pollute the readahead state.
 	 */
 	do_page_cache_ra(ractl, req_size, 0);
-	return;
+	return false;
 
 initial_readahead:
 	ra->start = index;
@@ -678,8 +688,46 @@ static void ondemand_readahead(struct readahead_control *ractl,
 		}
 	}
 
+	/*
+	 * A marker hit tells us which order the previous window was read
+	 * with. A synchronous miss does not, so pick up from the order the
+	 * stream last used instead of falling back to small folios.
+	 */
+	new_order = folio ? order : min_t(unsigned int, ra->order,
+					   MAX_PAGECACHE_ORDER);
+
 	ractl->_index = ra->start;
-	page_cache_ra_order(ractl, ra, order);
+	page_cache_ra_order(ractl, ra, new_order);
+	return true;
+}
+
+/*
+ * The file_ra_state of a struct file is shared by all of its readers and
+ * updated without locking. Make each readahead decision on a private copy
+ * so that it starts from, and leaves behind, a consistent window even when
+ * parallel readers race on the same file; the last one to finish wins.
+ */
+static void ondemand_readahead(struct readahead_control *ractl,
+		struct folio *folio, unsigned long req_size)
+{
+	struct file_ra_state *ra = ractl->ra;
+	struct file_ra_state snap = {
+		.start		= READ_ONCE(ra->start),
+		.size		= READ_ONCE(ra->size),
+		.async_size	= READ_ONCE(ra->async_size),
+		.ra_pages	= READ_ONCE(ra->ra_pages),
+		.order		= READ_ONCE(ra->order),
+		.prev_pos	= READ_ONCE(ra->prev_pos),
+	};
+
+	ractl->ra = &snap;
+	if (__ondemand_readahead(ractl, folio, req_size)) {
+		WRITE_ONCE(ra->start, snap.start);
+		WRITE_ONCE(ra->size, snap.size);
+		WRITE_ONCE(ra->async_size, snap.async_size);
+		WRITE_ONCE(ra->order, snap.order);
+	}
+	ractl->ra = ra;
 }
 
 void page_cache_sync_ra(struct readahead_control *ractl,
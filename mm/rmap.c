@@ -1277,21 +1277,30 @@ void page_add_anon_rmap(struct page *page, struct vm_area_struct *vma,
  * This means the inc-and-test can be bypassed.
  * The folio does not have to be locked.
  *
- * If the folio is large, it is accounted as a THP.  As the folio
- * is new, it's assumed to be mapped exclusively by a single process.
+ * If the folio is PMD-mappable, it is accounted as a THP.  A smaller large
+ * folio is accounted as mapped by one PTE per page, and @address must be
+ * the address of its first page.  As the folio is new, it's assumed to be
+ * mapped exclusively by a single process.
  */
 void folio_add_new_anon_rmap(struct folio *folio, struct vm_area_struct *vma,
 		unsigned long address)
 {
-	int nr;
+	int nr, i;
 
 	VM_BUG_ON_VMA(address < vma->vm_start || address >= vma->vm_end, vma);
 	__folio_set_swapbacked(folio);
 
-	if (likely(!folio_test_pmd_mappable(folio))) {
+	if (likely(!folio_test_large(folio))) {
 		/* increment count (starts at -1) */
 		atomic_set(&folio->_mapcount, 0);
 		nr = 1;
+	} else if (!folio_test_pmd_mappable(folio)) {
+		nr = folio_nr_pages(folio);
+		for (i = 0; i < nr; i++) {
+			/* increment count (starts at -1) */
+			atomic_set(&folio_page(folio, i)->_mapcount, 0);
+		}
+		atomic_set(&folio->_nr_pages_mapped, nr);
 	} else {
 		/* increment count (starts at -1) */
 		atomic_set(&folio->_entire_mapcount, 0);
@@ -1302,6 +1311,11 @@ void folio_add_new_anon_rmap(struct folio *folio, struct vm_area_struct *vma,
 
 	__lruvec_stat_mod_folio(folio, NR_ANON_MAPPED, nr);
 	__page_set_anon_rmap(folio, &folio->page, vma, address, 1);
+
+	/* Each PTE-mapped page carries its own exclusive marker */
+	if (folio_test_large(folio) && !folio_test_pmd_mappable(folio))
+		for (i = 1; i < nr; i++)
+			SetPageAnonExclusive(folio_page(folio, i));
 }
 
 /**
@@ -1425,11 +1439,11 @@ void page_remove_rmap(struct page *page, struct vm_area_struct *vma,
 		__lruvec_stat_mod_folio(folio, idx, -nr);
 
 		/*
-		 * Queue anon THP for deferred split if at least one
+		 * Queue anon large folio for deferred split if at least one
 		 * page of the folio is unmapped and at least one page
 		 * is still mapped.
 		 */
-		if (folio_test_pmd_mappable(folio) && folio_test_anon(folio))
+		if (folio_test_large(folio) && folio_test_anon(folio))
 			if (!compound || nr < nr_pmdmapped)
 				deferred_split_folio(folio);
 	}
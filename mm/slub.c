@@ -2763,6 +2763,47 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 	unfreeze_partials_cpu(s, c);
 }
 
+/*
+ * Optional per-cpu array of objects in front of the per-cpu slab, set up by
+ * kmem_cache_setup_percpu_array(). The objects in it went through the free
+ * hooks and are free as far as the rest of the kernel is concerned, but the
+ * slabs still count them as allocated. The array is refilled and flushed in
+ * batches through the bulk alloc and free paths.
+ */
+struct slub_percpu_array {
+	local_lock_t lock;	/* Protects the fields below */
+	unsigned int count;	/* Capacity of objects[] */
+	unsigned int used;	/* Number of cached objects */
+	void *objects[];
+};
+
+/* Objects moved between the array and the slabs per bulk operation */
+#define PCA_BATCH	32
+
+static void *__alloc_from_pca(struct kmem_cache *s, gfp_t gfp);
+static bool __free_to_pca(struct kmem_cache *s, void *head, int cnt);
+static void flush_pca(struct kmem_cache *s, unsigned int nr);
+static void flush_pca_cpu(struct kmem_cache *s, int cpu);
+
+static __always_inline void *alloc_from_pca(struct kmem_cache *s, gfp_t gfp,
+					    int node)
+{
+	if (!s->cpu_array || node != NUMA_NO_NODE)
+		return NULL;
+
+	return __alloc_from_pca(s, gfp);
+}
+
+static __always_inline bool free_to_pca(struct kmem_cache *s,
+					struct slab *slab, void *head, int cnt)
+{
+	if (!s->cpu_array || is_kfence_address(head) ||
+	    unlikely(slab_test_pfmemalloc(slab)))
+		return false;
+
+	return __free_to_pca(s, head, cnt);
+}
+
 struct slub_flush_work {
 	struct work_struct work;
 	struct kmem_cache *s;
@@ -2785,6 +2826,9 @@ static void flush_cpu_slab(struct work_struct *w)
 	s = sfw->s;
 	c = this_cpu_ptr(s->cpu_slab);
 
+	if (s->cpu_array)
+		flush_pca(s, UINT_MAX);
+
 	if (c->slab)
 		flush_slab(s, c);
 
@@ -2795,6 +2839,9 @@ static bool has_cpu_slab(int cpu, struct kmem_cache *s)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
+	if (s->cpu_array && per_cpu_ptr(s->cpu_array, cpu)->used)
+		return true;
+
 	return c->slab || slub_percpu_partial(c);
 }
 
@@ -2847,13 +2894,25 @@ static int slub_cpu_dead(unsigned int cpu)
 	struct kmem_cache *s;
 
 	mutex_lock(&slab_mutex);
-	list_for_each_entry(s, &slab_caches, list)
+	list_for_each_entry(s, &slab_caches, list) {
+		if (s->cpu_array)
+			flush_pca_cpu(s, cpu);
 		__flush_cpu_slab(s, cpu);
+	}
 	mutex_unlock(&slab_mutex);
 	return 0;
 }
 
 #else /* CONFIG_SLUB_TINY */
+static inline void *alloc_from_pca(struct kmem_cache *s, gfp_t gfp, int node)
+{
+	return NULL;
+}
+static inline bool free_to_pca(struct kmem_cache *s, struct slab *slab,
+			       void *head, int cnt)
+{
+	return false;
+}
 static inline void flush_all_cpus_locked(struct kmem_cache *s) { }
 static inline void flush_all(struct kmem_cache *s) { }
 static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu) { }
@@ -3438,7 +3497,9 @@ static __fastpath_inline void *slab_alloc_node(struct kmem_cache *s, struct list
 	if (unlikely(object))
 		goto out;
 
-	object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
+	object = alloc_from_pca(s, gfpflags, node);
+	if (!object)
+		object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
 
 	maybe_wipe_obj_freeptr(s, object);
 	init = slab_want_init_on_alloc(gfpflags, s);
@@ -3783,8 +3844,13 @@ static __fastpath_inline void slab_free(struct kmem_cache *s, struct slab *slab,
 	 * With KASAN enabled slab_free_freelist_hook modifies the freelist
 	 * to remove objects, whose reuse must be delayed.
 	 */
-	if (slab_free_freelist_hook(s, &head, &tail, &cnt))
-		do_slab_free(s, slab, head, tail, cnt, addr);
+	if (!slab_free_freelist_hook(s, &head, &tail, &cnt))
+		return;
+
+	if (free_to_pca(s, slab, head, cnt))
+		return;
+
+	do_slab_free(s, slab, head, tail, cnt, addr);
 }
 
 #ifdef CONFIG_KASAN_GENERIC
@@ -4036,6 +4102,198 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 }
 EXPORT_SYMBOL(kmem_cache_alloc_bulk);
 
+#ifndef CONFIG_SLUB_TINY
+/*
+ * Return objects whose free hooks already ran to their slabs, without running
+ * the hooks again.
+ */
+static void __kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
+{
+	while (size) {
+		struct detached_freelist df;
+
+		size = build_detached_freelist(s, size, p, &df);
+		if (!df.slab)
+			continue;
+
+		do_slab_free(df.s, df.slab, df.freelist, df.tail, df.cnt,
+			     _RET_IP_);
+	}
+}
+
+/*
+ * Move up to @nr of the oldest objects out of the local array back to their
+ * slabs. The array lock is dropped around each batch so that the slab work
+ * does not run with interrupts disabled for long.
+ */
+static void flush_pca(struct kmem_cache *s, unsigned int nr)
+{
+	struct slub_percpu_array *pca;
+	void *objects[PCA_BATCH];
+	unsigned long flags;
+	unsigned int batch;
+
+	while (nr) {
+		local_lock_irqsave(&s->cpu_array->lock, flags);
+		pca = this_cpu_ptr(s->cpu_array);
+		batch = min3(nr, pca->used, (unsigned int)PCA_BATCH);
+		if (!batch) {
+			local_unlock_irqrestore(&s->cpu_array->lock, flags);
+			break;
+		}
+		memcpy(objects, pca->objects, batch * sizeof(void *));
+		pca->used -= batch;
+		memmove(pca->objects, pca->objects + batch,
+			pca->used * sizeof(void *));
+		local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+		__kmem_cache_free_bulk(s, batch, objects);
+		stat(s, PCA_FLUSH);
+		nr -= batch;
+	}
+}
+
+/* The cpu is gone, so nothing else can touch its array */
+static void flush_pca_cpu(struct kmem_cache *s, int cpu)
+{
+	struct slub_percpu_array *pca = per_cpu_ptr(s->cpu_array, cpu);
+
+	__kmem_cache_free_bulk(s, pca->used, pca->objects);
+	pca->used = 0;
+}
+
+static void refill_pca(struct kmem_cache *s, gfp_t gfp)
+{
+	struct slub_percpu_array *pca;
+	void *objects[PCA_BATCH];
+	unsigned long flags;
+	unsigned int batch, room;
+	int nr;
+
+	pca = raw_cpu_ptr(s->cpu_array);
+	batch = min_t(unsigned int, max(pca->count / 2, 1U), PCA_BATCH);
+
+	nr = __kmem_cache_alloc_bulk(s, gfp, batch, objects, NULL);
+	if (!nr)
+		return;
+
+	/* We may have migrated or been refilled by an interrupt meanwhile */
+	local_lock_irqsave(&s->cpu_array->lock, flags);
+	pca = this_cpu_ptr(s->cpu_array);
+	room = min_t(unsigned int, nr, pca->count - pca->used);
+	memcpy(pca->objects + pca->used, objects, room * sizeof(void *));
+	pca->used += room;
+	local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+	stat(s, PCA_REFILL);
+	if (room < nr)
+		__kmem_cache_free_bulk(s, nr - room, objects + room);
+}
+
+static void *__alloc_from_pca(struct kmem_cache *s, gfp_t gfp)
+{
+	struct slub_percpu_array *pca;
+	unsigned long flags;
+	void *object = NULL;
+	bool refilled = false;
+
+retry:
+	local_lock_irqsave(&s->cpu_array->lock, flags);
+	pca = this_cpu_ptr(s->cpu_array);
+	if (pca->used)
+		object = pca->objects[--pca->used];
+	local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+	if (object) {
+		stat(s, ALLOC_PCA);
+		return object;
+	}
+
+	/* Leave the memory reserves to the regular slow path */
+	if (refilled || gfp_pfmemalloc_allowed(gfp))
+		return NULL;
+
+	refill_pca(s, gfp);
+	refilled = true;
+	goto retry;
+}
+
+static bool __free_to_pca(struct kmem_cache *s, void *head, int cnt)
+{
+	struct slub_percpu_array *pca;
+	unsigned long flags;
+	void *object;
+
+	if (unlikely(cnt > raw_cpu_ptr(s->cpu_array)->count))
+		return false;
+
+	local_lock_irqsave(&s->cpu_array->lock, flags);
+	pca = this_cpu_ptr(s->cpu_array);
+	while (pca->count - pca->used < cnt) {
+		local_unlock_irqrestore(&s->cpu_array->lock, flags);
+		flush_pca(s, max_t(unsigned int, pca->count / 2, cnt));
+		local_lock_irqsave(&s->cpu_array->lock, flags);
+		pca = this_cpu_ptr(s->cpu_array);
+	}
+
+	for (object = head; cnt--; object = get_freepointer(s, object))
+		pca->objects[pca->used++] = object;
+	local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+	stat(s, FREE_PCA);
+	return true;
+}
+
+/**
+ * kmem_cache_setup_percpu_array - cache freed objects in a per-cpu array
+ * @s: the cache
+ * @count: number of objects each cpu may hold
+ *
+ * Put a per-cpu array of up to @count objects in front of the regular
+ * allocation paths of @s. Allocations without a node preference are served
+ * from it and frees land in it, with the array refilled from and flushed to
+ * the slabs in batches. This suits caches that see bursts of alloc/free
+ * pairs on the same cpu, such as packet buffers or request structures.
+ *
+ * Caches with debugging enabled are left alone.
+ *
+ * Return: 0 on success, -EINVAL or -ENOMEM on failure.
+ */
+int kmem_cache_setup_percpu_array(struct kmem_cache *s, unsigned int count)
+{
+	struct slub_percpu_array __percpu *cpu_array;
+	int cpu;
+
+	if (!count || s->cpu_array)
+		return -EINVAL;
+
+	if (kmem_cache_debug(s))
+		return 0;
+
+	cpu_array = __alloc_percpu(struct_size(cpu_array, objects, count),
+				   sizeof(void *));
+	if (!cpu_array)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct slub_percpu_array *pca = per_cpu_ptr(cpu_array, cpu);
+
+		local_lock_init(&pca->lock);
+		pca->count = count;
+		pca->used = 0;
+	}
+
+	s->cpu_array = cpu_array;
+	return 0;
+}
+#else /* CONFIG_SLUB_TINY */
+int kmem_cache_setup_percpu_array(struct kmem_cache *s, unsigned int count)
+{
+	return count ? 0 : -EINVAL;
+}
+#endif /* CONFIG_SLUB_TINY */
+EXPORT_SYMBOL(kmem_cache_setup_percpu_array);
+
 
 /*
  * Object placement in a slab is made very easy because we always start at
@@ -4279,6 +4537,7 @@ void __kmem_cache_release(struct kmem_cache *s)
 {
 	cache_random_seq_destroy(s);
 #ifndef CONFIG_SLUB_TINY
+	free_percpu(s->cpu_array);
 	free_percpu(s->cpu_slab);
 #endif
 	free_kmem_cache_nodes(s);
@@ -5911,6 +6170,10 @@ STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
 STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
 STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(ALLOC_PCA, alloc_cpu_array);
+STAT_ATTR(FREE_PCA, free_cpu_array);
+STAT_ATTR(PCA_REFILL, cpu_array_refill);
+STAT_ATTR(PCA_FLUSH, cpu_array_flush);
 #endif	/* CONFIG_SLUB_STATS */
 
 #ifdef CONFIG_KFENCE
@@ -5998,6 +6261,10 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_free_attr.attr,
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
+	&alloc_cpu_array_attr.attr,
+	&free_cpu_array_attr.attr,
+	&cpu_array_refill_attr.attr,
+	&cpu_array_flush_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
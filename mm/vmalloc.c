@@ -33,6 +33,7 @@
 #include <linux/compiler.h>
 #include <linux/memcontrol.h>
 #include <linux/llist.h>
+#include <linux/list_sort.h>
 #include <linux/uio.h>
 #include <linux/bitops.h>
 #include <linux/rbtree_augmented.h>
@@ -736,9 +737,16 @@ LIST_HEAD(vmap_area_list);
 static struct rb_root vmap_area_root = RB_ROOT;
 static bool vmap_initialized __read_mostly;
 
-static struct rb_root purge_vmap_area_root = RB_ROOT;
-static LIST_HEAD(purge_vmap_area_list);
-static DEFINE_SPINLOCK(purge_vmap_area_lock);
+/*
+ * Lazily freed areas are parked on per-CPU lists, so that vfree() does not
+ * serialize on a global lock. __purge_vmap_area_lazy() collects, sorts and
+ * coalesces them before handing them back to the free tree.
+ */
+struct vmap_purge_list {
+	spinlock_t lock;
+	struct list_head list;
+};
+static DEFINE_PER_CPU(struct vmap_purge_list, vmap_purge_lists);
 
 /*
  * This kmem_cache is used for vmap_area objects. Instead of
@@ -1201,13 +1209,6 @@ __merge_or_add_vmap_area(struct vmap_area *va,
 	return va;
 }
 
-static __always_inline struct vmap_area *
-merge_or_add_vmap_area(struct vmap_area *va,
-	struct rb_root *root, struct list_head *head)
-{
-	return __merge_or_add_vmap_area(va, root, head, false);
-}
-
 static __always_inline struct vmap_area *
 merge_or_add_vmap_area_augment(struct vmap_area *va,
 	struct rb_root *root, struct list_head *head)
@@ -1719,6 +1720,53 @@ static DEFINE_MUTEX(vmap_purge_lock);
 /* for per-CPU blocks */
 static void purge_fragmented_blocks_allcpus(void);
 
+static int va_start_cmp(void *priv, const struct list_head *a,
+			const struct list_head *b)
+{
+	const struct vmap_area *va_a = list_entry(a, struct vmap_area, list);
+	const struct vmap_area *va_b = list_entry(b, struct vmap_area, list);
+
+	return va_a->va_start > va_b->va_start;
+}
+
+/*
+ * Gather the per-CPU lazy lists into @head, sorted by address and with
+ * adjacent areas merged, so the free tree sees as few insertions as possible.
+ */
+static void collect_purge_lists(struct list_head *head)
+{
+	struct vmap_area *va, *n_va;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct vmap_purge_list *pl = per_cpu_ptr(&vmap_purge_lists, cpu);
+
+		if (list_empty(&pl->list))
+			continue;
+
+		spin_lock(&pl->lock);
+		list_splice_init(&pl->list, head);
+		spin_unlock(&pl->lock);
+	}
+
+	if (list_empty(head))
+		return;
+
+	list_sort(NULL, head, va_start_cmp);
+
+	va = list_first_entry(head, struct vmap_area, list);
+	while (!list_is_last(&va->list, head)) {
+		n_va = list_next_entry(va, list);
+		if (va->va_end == n_va->va_start) {
+			va->va_end = n_va->va_end;
+			list_del(&n_va->list);
+			kmem_cache_free(vmap_area_cachep, n_va);
+		} else {
+			va = n_va;
+		}
+	}
+}
+
 /*
  * Purges all lazily-freed vmap areas.
  */
@@ -1726,16 +1774,12 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 {
 	unsigned long resched_threshold;
 	unsigned int num_purged_areas = 0;
-	struct list_head local_purge_list;
+	LIST_HEAD(local_purge_list);
 	struct vmap_area *va, *n_va;
 
 	lockdep_assert_held(&vmap_purge_lock);
 
-	spin_lock(&purge_vmap_area_lock);
-	purge_vmap_area_root = RB_ROOT;
-	list_replace_init(&purge_vmap_area_list, &local_purge_list);
-	spin_unlock(&purge_vmap_area_lock);
-
+	collect_purge_lists(&local_purge_list);
 	if (unlikely(list_empty(&local_purge_list)))
 		goto out;
 
@@ -1818,6 +1862,7 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 {
 	unsigned long nr_lazy_max = lazy_max_pages();
 	unsigned long va_start = va->va_start;
+	struct vmap_purge_list *pl;
 	unsigned long nr_lazy;
 
 	if (WARN_ON_ONCE(!list_empty(&va->list)))
@@ -1827,12 +1872,12 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 				PAGE_SHIFT, &vmap_lazy_nr);
 
 	/*
-	 * Merge or place it to the purge tree/list.
+	 * Park it on this CPU's purge list.
 	 */
-	spin_lock(&purge_vmap_area_lock);
-	merge_or_add_vmap_area(va,
-		&purge_vmap_area_root, &purge_vmap_area_list);
-	spin_unlock(&purge_vmap_area_lock);
+	pl = raw_cpu_ptr(&vmap_purge_lists);
+	spin_lock(&pl->lock);
+	list_add_tail(&va->list, &pl->list);
+	spin_unlock(&pl->lock);
 
 	trace_free_vmap_area_noflush(va_start, nr_lazy, nr_lazy_max);
 
@@ -4287,14 +4332,19 @@ static void show_numa_info(struct seq_file *m, struct vm_struct *v)
 static void show_purge_info(struct seq_file *m)
 {
 	struct vmap_area *va;
+	int cpu;
 
-	spin_lock(&purge_vmap_area_lock);
-	list_for_each_entry(va, &purge_vmap_area_list, list) {
-		seq_printf(m, "0x%pK-0x%pK %7ld unpurged vm_area\n",
-			(void *)va->va_start, (void *)va->va_end,
-			va->va_end - va->va_start);
+	for_each_possible_cpu(cpu) {
+		struct vmap_purge_list *pl = per_cpu_ptr(&vmap_purge_lists, cpu);
+
+		spin_lock(&pl->lock);
+		list_for_each_entry(va, &pl->list, list) {
+			seq_printf(m, "0x%pK-0x%pK %7ld unpurged vm_area\n",
+				(void *)va->va_start, (void *)va->va_end,
+				va->va_end - va->va_start);
+		}
+		spin_unlock(&pl->lock);
 	}
-	spin_unlock(&purge_vmap_area_lock);
 }
 
 static int s_show(struct seq_file *m, void *p)
@@ -4391,9 +4441,13 @@ void __init vmalloc_init(void)
 	vmap_area_cachep = KMEM_CACHE(vmap_area, SLAB_PANIC);
 
 	for_each_possible_cpu(i) {
+		struct vmap_purge_list *pl;
 		struct vmap_block_queue *vbq;
 		struct vfree_deferred *p;
 
+		pl = &per_cpu(vmap_purge_lists, i);
+		spin_lock_init(&pl->lock);
+		INIT_LIST_HEAD(&pl->list);
 		vbq = &per_cpu(vmap_block_queue, i);
 		spin_lock_init(&vbq->lock);
 		INIT_LIST_HEAD(&vbq->free);
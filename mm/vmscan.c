@@ -149,6 +149,9 @@ struct scan_control {
 	/* This context's GFP mask */
 	gfp_t gfp_mask;
 
+	/* Proactive reclaim: only evict MGLRU generations this old (jiffies) */
+	unsigned long min_age;
+
 	/* Incremented by the number of inactive pages that were scanned */
 	unsigned long nr_scanned;
 
@@ -1895,8 +1898,12 @@ static unsigned int shrink_folio_list(struct list_head *folio_list,
 					 * Split folios without a PMD map right
 					 * away. Chances are some or all of the
 					 * tail pages can be freed without IO.
+					 * Smaller folios are swapped out whole
+					 * unless they are partially mapped.
 					 */
 					if (!folio_entire_mapcount(folio) &&
+					    (folio_test_pmd_mappable(folio) ||
+					     data_race(!list_empty(&folio->_deferred_list))) &&
 					    split_folio_to_list(folio,
 								folio_list))
 						goto activate_locked;
@@ -4455,6 +4462,30 @@ static void inc_max_seq(struct lruvec *lruvec, bool can_swap, bool force_scan)
 	spin_unlock_irq(&lruvec->lru_lock);
 }
 
+#ifdef CONFIG_MEMCG
+/* tell the working set reporting readers of this memcg and its ancestors */
+static void lru_gen_wsr_notify(struct lruvec *lruvec)
+{
+	struct mem_cgroup *memcg;
+
+	for (memcg = lruvec_memcg(lruvec); memcg; memcg = parent_mem_cgroup(memcg)) {
+		struct lru_gen_wsr *wsr = &memcg->wsr;
+		unsigned long threshold = READ_ONCE(wsr->report_threshold);
+
+		if (!threshold ||
+		    time_is_after_jiffies(READ_ONCE(wsr->last_report) + threshold))
+			continue;
+
+		WRITE_ONCE(wsr->last_report, jiffies);
+		cgroup_file_notify(&wsr->page_age_file);
+	}
+}
+#else
+static void lru_gen_wsr_notify(struct lruvec *lruvec)
+{
+}
+#endif
+
 static bool try_to_inc_max_seq(struct lruvec *lruvec, unsigned long max_seq,
 			       struct scan_control *sc, bool can_swap, bool force_scan)
 {
@@ -4499,8 +4530,10 @@ static bool try_to_inc_max_seq(struct lruvec *lruvec, unsigned long max_seq,
 			walk_mm(lruvec, mm, walk);
 	} while (mm);
 done:
-	if (success)
+	if (success) {
 		inc_max_seq(lruvec, can_swap, force_scan);
+		lru_gen_wsr_notify(lruvec);
+	}
 
 	return success;
 }
@@ -5069,6 +5102,22 @@ static int get_type_to_scan(struct lruvec *lruvec, int swappiness, int *tier_idx
 	return type;
 }
 
+/* whether the oldest generation of this type is as old as sc->min_age */
+static bool lru_gen_is_old_enough(struct lruvec *lruvec, struct scan_control *sc,
+				  int type)
+{
+	int gen;
+	unsigned long birth;
+
+	if (!sc->min_age)
+		return true;
+
+	gen = lru_gen_from_seq(READ_ONCE(lruvec->lrugen.min_seq[type]));
+	birth = READ_ONCE(lruvec->lrugen.timestamps[gen]);
+
+	return !time_is_after_jiffies(birth + sc->min_age);
+}
+
 static int isolate_folios(struct lruvec *lruvec, struct scan_control *sc, int swappiness,
 			  int *type_scanned, struct list_head *list)
 {
@@ -5098,7 +5147,9 @@ static int isolate_folios(struct lruvec *lruvec, struct scan_control *sc, int sw
 		if (tier < 0)
 			tier = get_tier_idx(lruvec, type);
 
-		scanned = scan_folios(lruvec, sc, type, tier, list);
+		scanned = 0;
+		if (lru_gen_is_old_enough(lruvec, sc, type))
+			scanned = scan_folios(lruvec, sc, type, tier, list);
 		if (scanned)
 			break;
 
@@ -6160,6 +6211,7 @@ void lru_gen_init_memcg(struct mem_cgroup *memcg)
 {
 	INIT_LIST_HEAD(&memcg->mm_list.fifo);
 	spin_lock_init(&memcg->mm_list.lock);
+	mutex_init(&memcg->wsr.lock);
 }
 
 void lru_gen_exit_memcg(struct mem_cgroup *memcg)
@@ -6184,6 +6236,138 @@ void lru_gen_exit_memcg(struct mem_cgroup *memcg)
 	}
 }
 
+/******************************************************************************
+ *                          working set reporting
+ ******************************************************************************/
+
+/* age the lruvecs of this subtree whose youngest generation is this old */
+static void lru_gen_wsr_refresh(struct mem_cgroup *root, unsigned long interval)
+{
+	unsigned int flags;
+	struct blk_plug plug;
+	struct mem_cgroup *memcg;
+	struct scan_control sc = {
+		.may_writepage = true,
+		.may_unmap = true,
+		.may_swap = true,
+		.reclaim_idx = MAX_NR_ZONES - 1,
+		.gfp_mask = GFP_KERNEL,
+	};
+
+	set_task_reclaim_state(current, &sc.reclaim_state);
+	flags = memalloc_noreclaim_save();
+	blk_start_plug(&plug);
+
+	memcg = mem_cgroup_iter(root, NULL, NULL);
+	do {
+		int nid;
+
+		for_each_node_state(nid, N_MEMORY) {
+			struct lruvec *lruvec = get_lruvec(memcg, nid);
+			bool can_swap = get_swappiness(lruvec, &sc);
+			struct lru_gen_folio *lrugen = &lruvec->lrugen;
+			DEFINE_MAX_SEQ(lruvec);
+			DEFINE_MIN_SEQ(lruvec);
+			int gen = lru_gen_from_seq(max_seq);
+
+			if (time_is_after_jiffies(READ_ONCE(lrugen->timestamps[gen]) + interval))
+				continue;
+
+			/* the same limit as run_aging() without force_scan */
+			if (min_seq[!can_swap] + MAX_NR_GENS - 1 <= max_seq)
+				continue;
+
+			try_to_inc_max_seq(lruvec, max_seq, &sc, can_swap, false);
+		}
+
+		cond_resched();
+	} while ((memcg = mem_cgroup_iter(root, memcg, NULL)));
+
+	clear_mm_walk();
+	blk_finish_plug(&plug);
+	memalloc_noreclaim_restore(flags);
+	set_task_reclaim_state(current, NULL);
+}
+
+static void lru_gen_wsr_account(struct lruvec *lruvec, const unsigned long *intervals,
+				unsigned int nr_bins,
+				unsigned long (*nr_pages)[ANON_AND_FILE])
+{
+	int type, zone;
+	struct lru_gen_folio *lrugen = &lruvec->lrugen;
+	DEFINE_MAX_SEQ(lruvec);
+	DEFINE_MIN_SEQ(lruvec);
+
+	for (type = 0; type < ANON_AND_FILE; type++) {
+		unsigned long seq;
+
+		for (seq = min_seq[type]; seq <= max_seq; seq++) {
+			int gen = lru_gen_from_seq(seq);
+			unsigned long age = jiffies - READ_ONCE(lrugen->timestamps[gen]);
+			unsigned long size = 0;
+			unsigned int bin;
+
+			for (zone = 0; zone < MAX_NR_ZONES; zone++)
+				size += max(READ_ONCE(lrugen->nr_pages[gen][type][zone]), 0L);
+
+			for (bin = 0; bin < nr_bins; bin++) {
+				if (age < intervals[bin])
+					break;
+			}
+
+			nr_pages[bin][type] += size;
+		}
+	}
+}
+
+/*
+ * Show the pages of this memcg subtree in a histogram by the age of their
+ * generations, one "<ms> anon=<pages> file=<pages>" line per bin, its upper
+ * bound first. The last bin, shown as -1, has everything older.
+ */
+int lru_gen_wsr_show(struct seq_file *m, struct mem_cgroup *root)
+{
+	struct lru_gen_wsr *wsr = &root->wsr;
+	unsigned long intervals[MAX_NR_WSR_BINS];
+	unsigned long nr_pages[MAX_NR_WSR_BINS + 1][ANON_AND_FILE] = {};
+	unsigned long refresh_interval;
+	struct mem_cgroup *memcg;
+	unsigned int nr_bins, bin;
+
+	if (!lru_gen_enabled())
+		return -EOPNOTSUPP;
+
+	mutex_lock(&wsr->lock);
+	nr_bins = wsr->nr_intervals;
+	memcpy(intervals, wsr->intervals, sizeof(intervals));
+	mutex_unlock(&wsr->lock);
+
+	refresh_interval = READ_ONCE(wsr->refresh_interval);
+	if (refresh_interval)
+		lru_gen_wsr_refresh(root, refresh_interval);
+
+	memcg = mem_cgroup_iter(root, NULL, NULL);
+	do {
+		int nid;
+
+		for_each_node_state(nid, N_MEMORY)
+			lru_gen_wsr_account(get_lruvec(memcg, nid), intervals,
+					    nr_bins, nr_pages);
+
+		cond_resched();
+	} while ((memcg = mem_cgroup_iter(root, memcg, NULL)));
+
+	for (bin = 0; bin < nr_bins; bin++)
+		seq_printf(m, "%u anon=%lu file=%lu\n",
+			   jiffies_to_msecs(intervals[bin]),
+			   nr_pages[bin][LRU_GEN_ANON], nr_pages[bin][LRU_GEN_FILE]);
+
+	seq_printf(m, "-1 anon=%lu file=%lu\n",
+		   nr_pages[nr_bins][LRU_GEN_ANON], nr_pages[nr_bins][LRU_GEN_FILE]);
+
+	return 0;
+}
+
 #endif /* CONFIG_MEMCG */
 
 static int __init init_lru_gen(void)
@@ -7070,7 +7254,8 @@ unsigned long mem_cgroup_shrink_node(struct mem_cgroup *memcg,
 unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 					   unsigned long nr_pages,
 					   gfp_t gfp_mask,
-					   unsigned int reclaim_options)
+					   unsigned int reclaim_options,
+					   unsigned long min_age)
 {
 	unsigned long nr_reclaimed;
 	unsigned int noreclaim_flag;
@@ -7085,6 +7270,7 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 		.may_unmap = 1,
 		.may_swap = !!(reclaim_options & MEMCG_RECLAIM_MAY_SWAP),
 		.proactive = !!(reclaim_options & MEMCG_RECLAIM_PROACTIVE),
+		.min_age = min_age,
 	};
 	/*
 	 * Traverse the ZONELIST_FALLBACK zonelist of the current node to put
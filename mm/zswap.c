@@ -141,12 +141,23 @@ module_param_named(non_same_filled_pages_enabled, zswap_non_same_filled_pages_en
 * data structures
 **********************************/
 
+/* The most pages compressed under one hold of a compression context */
+#define ZSWAP_MAX_BATCH 8
+
 struct crypto_acomp_ctx {
 	struct crypto_acomp *acomp;
 	struct acomp_req *req;
 	struct crypto_wait wait;
 	u8 *dstmem;
 	struct mutex *mutex;
+	/*
+	 * Requests that can be in flight at once: just req for a synchronous
+	 * compressor, plus the batch_* slots for an asynchronous one.
+	 */
+	unsigned int nr_batch;
+	struct acomp_req *batch_req[ZSWAP_MAX_BATCH - 1];
+	struct crypto_wait batch_wait[ZSWAP_MAX_BATCH - 1];
+	u8 *batch_dstmem[ZSWAP_MAX_BATCH - 1];
 };
 
 struct zswap_pool {
@@ -241,6 +252,7 @@ static bool zswap_has_pool;
 static int zswap_writeback_entry(struct zpool *pool, unsigned long handle);
 static int zswap_pool_get(struct zswap_pool *pool);
 static void zswap_pool_put(struct zswap_pool *pool);
+static void zswap_frontswap_invalidate_page(unsigned type, pgoff_t offset);
 
 static const struct zpool_ops zswap_zpool_ops = {
 	.evict = zswap_writeback_entry
@@ -459,6 +471,8 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
 	struct crypto_acomp *acomp;
 	struct acomp_req *req;
+	unsigned int i;
+	u8 *dst;
 
 	acomp = crypto_alloc_acomp_node(pool->tfm_name, 0, 0, cpu_to_node(cpu));
 	if (IS_ERR(acomp)) {
@@ -488,6 +502,35 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 
 	acomp_ctx->mutex = per_cpu(zswap_mutex, cpu);
 	acomp_ctx->dstmem = per_cpu(zswap_dstmem, cpu);
+	acomp_ctx->nr_batch = 1;
+
+	/*
+	 * An asynchronous compressor can work on several pages at once, give
+	 * it private slots. Running short of memory here only limits the
+	 * batch.
+	 */
+	if (!(crypto_acomp_tfm(acomp)->__crt_alg->cra_flags & CRYPTO_ALG_ASYNC))
+		return 0;
+
+	for (i = 0; i < ZSWAP_MAX_BATCH - 1; i++) {
+		dst = kmalloc_node(PAGE_SIZE * 2, GFP_KERNEL, cpu_to_node(cpu));
+		if (!dst)
+			break;
+
+		req = acomp_request_alloc(acomp);
+		if (!req) {
+			kfree(dst);
+			break;
+		}
+
+		crypto_init_wait(&acomp_ctx->batch_wait[i]);
+		acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   crypto_req_done,
+					   &acomp_ctx->batch_wait[i]);
+		acomp_ctx->batch_req[i] = req;
+		acomp_ctx->batch_dstmem[i] = dst;
+		acomp_ctx->nr_batch++;
+	}
 
 	return 0;
 }
@@ -496,8 +539,14 @@ static int zswap_cpu_comp_dead(unsigned int cpu, struct hlist_node *node)
 {
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
+	unsigned int i;
 
 	if (!IS_ERR_OR_NULL(acomp_ctx)) {
+		for (i = 0; i + 1 < acomp_ctx->nr_batch; i++) {
+			acomp_request_free(acomp_ctx->batch_req[i]);
+			kfree(acomp_ctx->batch_dstmem[i]);
+		}
+		acomp_ctx->nr_batch = 0;
 		if (!IS_ERR_OR_NULL(acomp_ctx->req))
 			acomp_request_free(acomp_ctx->req);
 		if (!IS_ERR_OR_NULL(acomp_ctx->acomp))
@@ -1145,29 +1194,166 @@ static void zswap_fill_page(void *ptr, unsigned long value)
 /*********************************
 * frontswap hooks
 **********************************/
-/* attempts to compress and store an single page */
-static int zswap_frontswap_store(unsigned type, pgoff_t offset,
-				struct page *page)
+/*
+ * Pages are compressed in batches of up to ZSWAP_MAX_BATCH under a single
+ * hold of the per-CPU compression context, and inserted into the tree under
+ * a single hold of its lock. Asynchronous compressors get a request and
+ * destination buffer per batch slot so the whole batch is in flight at once.
+ */
+static struct acomp_req *zswap_batch_slot(struct crypto_acomp_ctx *acomp_ctx,
+					  unsigned int i,
+					  struct crypto_wait **wait, u8 **dst)
+{
+	if (!i) {
+		*wait = &acomp_ctx->wait;
+		*dst = acomp_ctx->dstmem;
+		return acomp_ctx->req;
+	}
+
+	*wait = &acomp_ctx->batch_wait[i - 1];
+	*dst = acomp_ctx->batch_dstmem[i - 1];
+	return acomp_ctx->batch_req[i - 1];
+}
+
+/* copy a compressed page into the zpool and fill in its entry */
+static int zswap_store_compressed(struct zswap_entry *entry, swp_entry_t swpentry,
+				  const u8 *dst, unsigned int dlen)
+{
+	struct zswap_header zhdr = { .swpentry = swpentry };
+	unsigned long handle;
+	unsigned int hlen;
+	char *buf;
+	gfp_t gfp;
+	int ret;
+
+	hlen = zpool_evictable(entry->pool->zpool) ? sizeof(zhdr) : 0;
+	gfp = __GFP_NORETRY | __GFP_NOWARN | __GFP_KSWAPD_RECLAIM;
+	if (zpool_malloc_support_movable(entry->pool->zpool))
+		gfp |= __GFP_HIGHMEM | __GFP_MOVABLE;
+	ret = zpool_malloc(entry->pool->zpool, hlen + dlen, gfp, &handle);
+	if (ret == -ENOSPC) {
+		zswap_reject_compress_poor++;
+		return ret;
+	}
+	if (ret) {
+		zswap_reject_alloc_fail++;
+		return ret;
+	}
+	buf = zpool_map_handle(entry->pool->zpool, handle, ZPOOL_MM_WO);
+	memcpy(buf, &zhdr, hlen);
+	memcpy(buf + hlen, dst, dlen);
+	zpool_unmap_handle(entry->pool->zpool, handle);
+
+	entry->handle = handle;
+	entry->length = dlen;
+
+	return 0;
+}
+
+/*
+ * Compress @nr pages into @entries. Same-filled pages are detected first and
+ * need no compression. On failure, any zpool allocation already made for the
+ * batch is freed, and the entries are left for the caller to release.
+ */
+static int zswap_compress_batch(struct zswap_pool *pool, unsigned int type,
+				pgoff_t offset, struct page **pages,
+				struct zswap_entry **entries, unsigned int nr)
+{
+	struct scatterlist input[ZSWAP_MAX_BATCH], output[ZSWAP_MAX_BATCH];
+	struct crypto_acomp_ctx *acomp_ctx;
+	int errs[ZSWAP_MAX_BATCH];
+	unsigned int i, j, k, end;
+	unsigned long value;
+	int ret = 0;
+	u8 *src;
+
+	for (i = 0; i < nr; i++) {
+		entries[i]->offset = offset + i;
+		entries[i]->length = 0;
+		entries[i]->pool = pool;
+
+		if (zswap_same_filled_pages_enabled) {
+			src = kmap_atomic(pages[i]);
+			if (zswap_is_page_same_filled(src, &value)) {
+				entries[i]->pool = NULL;
+				entries[i]->value = value;
+			}
+			kunmap_atomic(src);
+		}
+
+		if (entries[i]->pool && !zswap_non_same_filled_pages_enabled)
+			return -EINVAL;
+	}
+
+	acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
+	mutex_lock(acomp_ctx->mutex);
+
+	for (i = 0; i < nr && !ret; i = end) {
+		struct crypto_wait *wait;
+		struct acomp_req *req;
+		u8 *dst;
+
+		/* submit one request per slot... */
+		for (j = i, k = 0; j < nr && k < acomp_ctx->nr_batch; j++) {
+			if (!entries[j]->pool)
+				continue;
+
+			req = zswap_batch_slot(acomp_ctx, k, &wait, &dst);
+			sg_init_table(&input[k], 1);
+			sg_set_page(&input[k], pages[j], PAGE_SIZE, 0);
+			/* dstmem is of size (PAGE_SIZE * 2). Reflect same in sg_list */
+			sg_init_one(&output[k], dst, PAGE_SIZE * 2);
+			acomp_request_set_params(req, &input[k], &output[k],
+						 PAGE_SIZE, PAGE_SIZE);
+			errs[k++] = crypto_acomp_compress(req);
+		}
+		end = j;
+
+		/* ...then wait for each of them in order and store the result */
+		for (j = i, k = 0; j < end; j++) {
+			if (!entries[j]->pool)
+				continue;
+
+			req = zswap_batch_slot(acomp_ctx, k, &wait, &dst);
+			if (crypto_wait_req(errs[k++], wait) && !ret)
+				ret = -EINVAL;
+			if (!ret)
+				ret = zswap_store_compressed(entries[j],
+							     swp_entry(type, offset + j),
+							     dst, req->dlen);
+			if (ret)
+				entries[j]->pool = NULL;
+		}
+	}
+
+	mutex_unlock(acomp_ctx->mutex);
+
+	if (ret) {
+		for (i = 0; i < nr; i++) {
+			if (entries[i]->pool && entries[i]->length)
+				zpool_free(pool->zpool, entries[i]->handle);
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * attempts to compress and store @nr consecutive pages starting at @page,
+ * which are the swap slots @offset onwards; either all of them are stored
+ * or none are
+ */
+static int zswap_store_pages(unsigned type, pgoff_t offset, struct page *page,
+			     unsigned int nr)
 {
 	struct zswap_tree *tree = zswap_trees[type];
+	struct zswap_entry *entries[ZSWAP_MAX_BATCH];
+	struct page *pages[ZSWAP_MAX_BATCH];
 	struct zswap_entry *entry, *dupentry;
-	struct scatterlist input, output;
-	struct crypto_acomp_ctx *acomp_ctx;
 	struct obj_cgroup *objcg = NULL;
 	struct zswap_pool *pool;
+	unsigned int done, i, n;
 	int ret;
-	unsigned int hlen, dlen = PAGE_SIZE;
-	unsigned long handle, value;
-	char *buf;
-	u8 *src, *dst;
-	struct zswap_header zhdr = { .swpentry = swp_entry(type, offset) };
-	gfp_t gfp;
-
-	/* THP isn't supported */
-	if (PageTransHuge(page)) {
-		ret = -EINVAL;
-		goto reject;
-	}
 
 	if (!zswap_enabled || !tree) {
 		ret = -ENODEV;
@@ -1200,129 +1386,83 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 			zswap_pool_reached_full = false;
 	}
 
-	/* allocate entry */
-	entry = zswap_entry_cache_alloc(GFP_KERNEL);
-	if (!entry) {
-		zswap_reject_kmemcache_fail++;
-		ret = -ENOMEM;
+	pool = zswap_pool_current_get();
+	if (!pool) {
+		ret = -EINVAL;
 		goto reject;
 	}
 
-	if (zswap_same_filled_pages_enabled) {
-		src = kmap_atomic(page);
-		if (zswap_is_page_same_filled(src, &value)) {
-			kunmap_atomic(src);
-			entry->offset = offset;
-			entry->length = 0;
-			entry->value = value;
-			atomic_inc(&zswap_same_filled_pages);
-			goto insert_entry;
+	for (done = 0; done < nr; done += n) {
+		n = min_t(unsigned int, nr - done, ZSWAP_MAX_BATCH);
+
+		/* allocate entries */
+		for (i = 0; i < n; i++) {
+			entries[i] = zswap_entry_cache_alloc(GFP_KERNEL);
+			if (!entries[i]) {
+				zswap_reject_kmemcache_fail++;
+				ret = -ENOMEM;
+				goto freeentries;
+			}
+			pages[i] = nth_page(page, done + i);
 		}
-		kunmap_atomic(src);
-	}
-
-	if (!zswap_non_same_filled_pages_enabled) {
-		ret = -EINVAL;
-		goto freepage;
-	}
-
-	/* if entry is successfully added, it keeps the reference */
-	entry->pool = zswap_pool_current_get();
-	if (!entry->pool) {
-		ret = -EINVAL;
-		goto freepage;
-	}
-
-	/* compress */
-	acomp_ctx = raw_cpu_ptr(entry->pool->acomp_ctx);
-
-	mutex_lock(acomp_ctx->mutex);
-
-	dst = acomp_ctx->dstmem;
-	sg_init_table(&input, 1);
-	sg_set_page(&input, page, PAGE_SIZE, 0);
-
-	/* zswap_dstmem is of size (PAGE_SIZE * 2). Reflect same in sg_list */
-	sg_init_one(&output, dst, PAGE_SIZE * 2);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, PAGE_SIZE, dlen);
-	/*
-	 * it maybe looks a little bit silly that we send an asynchronous request,
-	 * then wait for its completion synchronously. This makes the process look
-	 * synchronous in fact.
-	 * Theoretically, acomp supports users send multiple acomp requests in one
-	 * acomp instance, then get those requests done simultaneously. but in this
-	 * case, frontswap actually does store and load page by page, there is no
-	 * existing method to send the second page before the first page is done
-	 * in one thread doing frontswap.
-	 * but in different threads running on different cpu, we have different
-	 * acomp instance, so multiple threads can do (de)compression in parallel.
-	 */
-	ret = crypto_wait_req(crypto_acomp_compress(acomp_ctx->req), &acomp_ctx->wait);
-	dlen = acomp_ctx->req->dlen;
 
-	if (ret) {
-		ret = -EINVAL;
-		goto put_dstmem;
-	}
-
-	/* store */
-	hlen = zpool_evictable(entry->pool->zpool) ? sizeof(zhdr) : 0;
-	gfp = __GFP_NORETRY | __GFP_NOWARN | __GFP_KSWAPD_RECLAIM;
-	if (zpool_malloc_support_movable(entry->pool->zpool))
-		gfp |= __GFP_HIGHMEM | __GFP_MOVABLE;
-	ret = zpool_malloc(entry->pool->zpool, hlen + dlen, gfp, &handle);
-	if (ret == -ENOSPC) {
-		zswap_reject_compress_poor++;
-		goto put_dstmem;
-	}
-	if (ret) {
-		zswap_reject_alloc_fail++;
-		goto put_dstmem;
-	}
-	buf = zpool_map_handle(entry->pool->zpool, handle, ZPOOL_MM_WO);
-	memcpy(buf, &zhdr, hlen);
-	memcpy(buf + hlen, dst, dlen);
-	zpool_unmap_handle(entry->pool->zpool, handle);
-	mutex_unlock(acomp_ctx->mutex);
-
-	/* populate entry */
-	entry->offset = offset;
-	entry->handle = handle;
-	entry->length = dlen;
-
-insert_entry:
-	entry->objcg = objcg;
-	if (objcg) {
-		obj_cgroup_charge_zswap(objcg, entry->length);
-		/* Account before objcg ref is moved to tree */
-		count_objcg_event(objcg, ZSWPOUT);
-	}
+		ret = zswap_compress_batch(pool, type, offset + done, pages,
+					   entries, n);
+		if (ret)
+			goto freeentries;
+
+		/* the pool reference now moves to each compressed entry */
+		for (i = 0; i < n; i++) {
+			entry = entries[i];
+			if (entry->pool)
+				WARN_ON(!zswap_pool_get(pool));
+
+			if (!entry->length)
+				atomic_inc(&zswap_same_filled_pages);
+
+			entry->objcg = objcg;
+			if (objcg) {
+				obj_cgroup_get(objcg);
+				obj_cgroup_charge_zswap(objcg, entry->length);
+				/* Account before objcg ref is moved to tree */
+				count_objcg_event(objcg, ZSWPOUT);
+			}
+		}
 
-	/* map */
-	spin_lock(&tree->lock);
-	do {
-		ret = zswap_rb_insert(&tree->rbroot, entry, &dupentry);
-		if (ret == -EEXIST) {
-			zswap_duplicate_entry++;
-			/* remove from rbtree */
-			zswap_rb_erase(&tree->rbroot, dupentry);
-			zswap_entry_put(tree, dupentry);
+		/* map */
+		spin_lock(&tree->lock);
+		for (i = 0; i < n; i++) {
+			do {
+				ret = zswap_rb_insert(&tree->rbroot, entries[i],
+						      &dupentry);
+				if (ret == -EEXIST) {
+					zswap_duplicate_entry++;
+					/* remove from rbtree */
+					zswap_rb_erase(&tree->rbroot, dupentry);
+					zswap_entry_put(tree, dupentry);
+				}
+			} while (ret == -EEXIST);
 		}
-	} while (ret == -EEXIST);
-	spin_unlock(&tree->lock);
+		spin_unlock(&tree->lock);
 
-	/* update stats */
-	atomic_inc(&zswap_stored_pages);
-	zswap_update_total_size();
-	count_vm_event(ZSWPOUT);
+		/* update stats */
+		atomic_add(n, &zswap_stored_pages);
+		zswap_update_total_size();
+		count_vm_events(ZSWPOUT, n);
+	}
 
+	zswap_pool_put(pool);
+	if (objcg)
+		obj_cgroup_put(objcg);
 	return 0;
 
-put_dstmem:
-	mutex_unlock(acomp_ctx->mutex);
-	zswap_pool_put(entry->pool);
-freepage:
-	zswap_entry_cache_free(entry);
+freeentries:
+	while (i--)
+		zswap_entry_cache_free(entries[i]);
+	zswap_pool_put(pool);
+	/* drop whatever the earlier batches of this folio stored */
+	for (i = 0; i < done; i++)
+		zswap_frontswap_invalidate_page(type, offset + i);
 reject:
 	if (objcg)
 		obj_cgroup_put(objcg);
@@ -1336,6 +1476,25 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	goto reject;
 }
 
+/* attempts to compress and store an single page */
+static int zswap_frontswap_store(unsigned type, pgoff_t offset,
+				struct page *page)
+{
+	/* THP goes through zswap_frontswap_store_folio() */
+	if (PageTransHuge(page))
+		return -EINVAL;
+
+	return zswap_store_pages(type, offset, page, 1);
+}
+
+/* attempts to compress and store every page of a large folio */
+static int zswap_frontswap_store_folio(unsigned type, pgoff_t offset,
+				       struct folio *folio)
+{
+	return zswap_store_pages(type, offset, &folio->page,
+				 folio_nr_pages(folio));
+}
+
 /*
  * returns 0 if the page was successfully decompressed
  * return -1 on entry not found or error
@@ -1476,6 +1635,7 @@ static void zswap_frontswap_init(unsigned type)
 
 static const struct frontswap_ops zswap_frontswap_ops = {
 	.store = zswap_frontswap_store,
+	.store_folio = zswap_frontswap_store_folio,
 	.load = zswap_frontswap_load,
 	.invalidate_page = zswap_frontswap_invalidate_page,
 	.invalidate_area = zswap_frontswap_invalidate_area,
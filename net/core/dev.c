@@ -150,6 +150,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/prandom.h>
 #include <linux/once_lite.h>
+#include <net/page_pool.h>
 
 #include "dev.h"
 #include "net-sysfs.h"
@@ -4662,7 +4663,7 @@ u32 bpf_prog_run_generic_xdp(struct sk_buff *skb, struct xdp_buff *xdp,
 {
 	void *orig_data, *orig_data_end, *hard_start;
 	struct netdev_rx_queue *rxqueue;
-	bool orig_bcast, orig_host;
+	bool orig_bcast, orig_host, frags;
 	u32 mac_len, frame_sz;
 	__be16 orig_eth_type;
 	struct ethhdr *eth;
@@ -4684,6 +4685,17 @@ u32 bpf_prog_run_generic_xdp(struct sk_buff *skb, struct xdp_buff *xdp,
 	xdp_prepare_buff(xdp, hard_start, skb_headroom(skb) - mac_len,
 			 skb_headlen(skb) + mac_len, true);
 
+	/* Only page_pool backed skbs, see netif_skb_cow_for_xdp(), hand
+	 * their frags to the program. The shared info is the skb's own.
+	 */
+	frags = skb_is_nonlinear(skb) && skb->pp_recycle &&
+		xdp_prog->aux->xdp_has_frags;
+	if (frags) {
+		skb_shinfo(skb)->xdp_frags_size = skb->data_len;
+		xdp_buff_set_frags_flag(xdp);
+		xdp_buff_set_frags_skb(xdp);
+	}
+
 	orig_data_end = xdp->data_end;
 	orig_data = xdp->data;
 	eth = (struct ethhdr *)xdp->data;
@@ -4712,6 +4724,15 @@ u32 bpf_prog_run_generic_xdp(struct sk_buff *skb, struct xdp_buff *xdp,
 		skb->len += off; /* positive on grow, negative on shrink */
 	}
 
+	/* frags may have been dropped by bpf_xdp_adjust_tail() */
+	if (frags) {
+		u32 data_len = xdp_buff_has_frags(xdp) ?
+			       skb_shinfo(skb)->xdp_frags_size : 0;
+
+		skb->len -= skb->data_len - data_len;
+		skb->data_len = data_len;
+	}
+
 	/* check if XDP changed eth hdr such SKB needs update */
 	eth = (struct ethhdr *)xdp->data;
 	if ((orig_eth_type != eth->h_proto) ||
@@ -4745,11 +4766,131 @@ u32 bpf_prog_run_generic_xdp(struct sk_buff *skb, struct xdp_buff *xdp,
 	return act;
 }
 
-static u32 netif_receive_generic_xdp(struct sk_buff *skb,
+#if IS_ENABLED(CONFIG_PAGE_POOL)
+/* Generic XDP copies packets for frags aware programs into these */
+static DEFINE_PER_CPU(struct page_pool *, system_page_pool);
+
+#define SYSTEM_PERCPU_PAGE_POOL_SIZE	((1 << 20) / PAGE_SIZE)
+
+static int net_page_pool_create(int cpu)
+{
+	struct page_pool_params params = {
+		.pool_size	= SYSTEM_PERCPU_PAGE_POOL_SIZE,
+		.nid		= cpu_to_mem(cpu),
+	};
+	struct page_pool *pool;
+
+	pool = page_pool_create(&params);
+	if (IS_ERR(pool))
+		return PTR_ERR(pool);
+
+	per_cpu(system_page_pool, cpu) = pool;
+	return 0;
+}
+
+/* Copy the packet, MAC header included, into a head page with
+ * XDP_PACKET_HEADROOM and as many order-0 frags as the rest needs. Unlike
+ * a linearize this never needs a high order allocation, and the pages
+ * recycle through the pool of this CPU. Callers run with BH disabled,
+ * which serializes the allocation side of the pool.
+ */
+static int netif_skb_cow_for_xdp(struct sk_buff **pskb,
+				 struct bpf_prog *xdp_prog)
+{
+	u32 max_head_size = SKB_WITH_OVERHEAD(PAGE_SIZE - XDP_PACKET_HEADROOM);
+	struct page_pool *pool = this_cpu_read(system_page_pool);
+	struct sk_buff *skb = *pskb, *nskb;
+	u32 size, len, off;
+	struct page *page;
+	int i, head_off;
+
+	if (!pool || !xdp_prog->aux->xdp_has_frags ||
+	    skb->len > max_head_size + MAX_SKB_FRAGS * PAGE_SIZE)
+		return -EINVAL;
+
+	page = page_pool_dev_alloc_pages(pool);
+	if (!page)
+		return -ENOMEM;
+
+	nskb = napi_build_skb(page_address(page), PAGE_SIZE);
+	if (!nskb) {
+		page_pool_put_full_page(pool, page, true);
+		return -ENOMEM;
+	}
+
+	skb_reserve(nskb, XDP_PACKET_HEADROOM);
+	skb_copy_header(nskb, skb);
+	skb_mark_for_recycle(nskb);
+
+	size = min_t(u32, skb->len, max_head_size);
+	if (skb_copy_bits(skb, 0, nskb->data, size))
+		goto err_free;
+	skb_put(nskb, size);
+
+	head_off = skb_headroom(nskb) - skb_headroom(skb);
+	skb_headers_offset_update(nskb, head_off);
+
+	off = size;
+	len = skb->len - off;
+	for (i = 0; len; i++) {
+		page = page_pool_dev_alloc_pages(pool);
+		if (!page)
+			goto err_free;
+
+		size = min_t(u32, len, PAGE_SIZE);
+		skb_add_rx_frag(nskb, i, page, 0, size, PAGE_SIZE);
+		if (skb_copy_bits(skb, off, page_address(page), size))
+			goto err_free;
+
+		len -= size;
+		off += size;
+	}
+
+	consume_skb(skb);
+	*pskb = nskb;
+
+	return 0;
+
+err_free:
+	consume_skb(nskb);
+	return -ENOMEM;
+}
+#else
+static int netif_skb_cow_for_xdp(struct sk_buff **pskb,
+				 struct bpf_prog *xdp_prog)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
+static int netif_skb_check_for_xdp(struct sk_buff **pskb,
+				   struct bpf_prog *xdp_prog)
+{
+	struct sk_buff *skb = *pskb;
+	int hroom, troom;
+
+	if (!netif_skb_cow_for_xdp(pskb, xdp_prog))
+		return 0;
+
+	/* In case we have to go down the path and also linearize,
+	 * then lets do the pskb_expand_head() work just once here.
+	 */
+	hroom = XDP_PACKET_HEADROOM - skb_headroom(skb);
+	troom = skb->tail + skb->data_len - skb->end;
+	if (pskb_expand_head(skb,
+			     hroom > 0 ? ALIGN(hroom, NET_SKB_PAD) : 0,
+			     troom > 0 ? troom + 128 : 0, GFP_ATOMIC))
+		return -ENOMEM;
+
+	return skb_linearize(skb);
+}
+
+static u32 netif_receive_generic_xdp(struct sk_buff **pskb,
 				     struct xdp_buff *xdp,
 				     struct bpf_prog *xdp_prog)
 {
-	u32 act = XDP_DROP;
+	struct sk_buff *skb = *pskb;
+	u32 mac_len, act = XDP_DROP;
 
 	/* Reinjected packets coming from act_mirred or similar should
 	 * not get XDP generic processing.
@@ -4757,26 +4898,23 @@ static u32 netif_receive_generic_xdp(struct sk_buff *skb,
 	if (skb_is_redirected(skb))
 		return XDP_PASS;
 
-	/* XDP packets must be linear and must have sufficient headroom
-	 * of XDP_PACKET_HEADROOM bytes. This is the guarantee that also
-	 * native XDP provides, thus we need to do it here as well.
+	/* XDP packets must have sufficient headroom of XDP_PACKET_HEADROOM
+	 * bytes and be linear, unless the program handles frags. This is the
+	 * guarantee that also native XDP provides, thus we need to do it
+	 * here as well.
 	 */
+	mac_len = skb->data - skb_mac_header(skb);
+	__skb_push(skb, mac_len);
+
 	if (skb_cloned(skb) || skb_is_nonlinear(skb) ||
 	    skb_headroom(skb) < XDP_PACKET_HEADROOM) {
-		int hroom = XDP_PACKET_HEADROOM - skb_headroom(skb);
-		int troom = skb->tail + skb->data_len - skb->end;
-
-		/* In case we have to go down the path and also linearize,
-		 * then lets do the pskb_expand_head() work just once here.
-		 */
-		if (pskb_expand_head(skb,
-				     hroom > 0 ? ALIGN(hroom, NET_SKB_PAD) : 0,
-				     troom > 0 ? troom + 128 : 0, GFP_ATOMIC))
-			goto do_drop;
-		if (skb_linearize(skb))
+		if (netif_skb_check_for_xdp(pskb, xdp_prog))
 			goto do_drop;
 	}
 
+	__skb_pull(*pskb, mac_len);
+	skb = *pskb;
+
 	act = bpf_prog_run_generic_xdp(skb, xdp, xdp_prog);
 	switch (act) {
 	case XDP_REDIRECT:
@@ -4829,14 +4967,17 @@ void generic_xdp_tx(struct sk_buff *skb, struct bpf_prog *xdp_prog)
 
 static DEFINE_STATIC_KEY_FALSE(generic_xdp_needed_key);
 
-int do_xdp_generic(struct bpf_prog *xdp_prog, struct sk_buff *skb)
+int do_xdp_generic(struct bpf_prog *xdp_prog, struct sk_buff **pskb)
 {
+	struct sk_buff *skb = *pskb;
+
 	if (xdp_prog) {
 		struct xdp_buff xdp;
 		u32 act;
 		int err;
 
-		act = netif_receive_generic_xdp(skb, &xdp, xdp_prog);
+		act = netif_receive_generic_xdp(pskb, &xdp, xdp_prog);
+		skb = *pskb;
 		if (act != XDP_PASS) {
 			switch (act) {
 			case XDP_REDIRECT:
@@ -5243,7 +5384,8 @@ static int __netif_receive_skb_core(struct sk_buff **pskb, bool pfmemalloc,
 		int ret2;
 
 		migrate_disable();
-		ret2 = do_xdp_generic(rcu_dereference(skb->dev->xdp_prog), skb);
+		ret2 = do_xdp_generic(rcu_dereference(skb->dev->xdp_prog),
+				      &skb);
 		migrate_enable();
 
 		if (ret2 != XDP_PASS) {
@@ -5979,15 +6121,20 @@ bool napi_complete_done(struct napi_struct *n, int work_done)
 
 	if (work_done) {
 		if (n->gro_bitmask)
-			timeout = READ_ONCE(n->dev->gro_flush_timeout);
-		n->defer_hard_irqs_count = READ_ONCE(n->dev->napi_defer_hard_irqs);
+			timeout = napi_get_gro_flush_timeout(n);
+		n->defer_hard_irqs_count = napi_get_defer_hard_irqs(n);
 	}
 	if (n->defer_hard_irqs_count > 0) {
 		n->defer_hard_irqs_count--;
-		timeout = READ_ONCE(n->dev->gro_flush_timeout);
+		timeout = napi_get_gro_flush_timeout(n);
 		if (timeout)
 			ret = false;
 	}
+	/* The suspend timer is already armed, keep IRQs masked until then */
+	if (test_bit(NAPI_STATE_IRQ_SUSPENDED, &n->state)) {
+		timeout = 0;
+		ret = false;
+	}
 	if (n->gro_bitmask) {
 		/* When the NAPI instance uses a timeout and keeps postponing
 		 * it, we need to bound somehow the time packets are kept in
@@ -6047,6 +6194,17 @@ static struct napi_struct *napi_by_id(unsigned int napi_id)
 	return NULL;
 }
 
+/* Caller holds rcu_read_lock() or otherwise keeps the NAPI from going away */
+struct napi_struct *netdev_napi_by_id(struct net *net, unsigned int napi_id)
+{
+	struct napi_struct *napi = napi_by_id(napi_id);
+
+	if (!napi || !net_eq(dev_net(napi->dev), net))
+		return NULL;
+
+	return napi;
+}
+
 #if defined(CONFIG_NET_RX_BUSY_POLL)
 
 static void __busy_poll_stop(struct napi_struct *napi, bool skip_schedule)
@@ -6090,9 +6248,13 @@ static void busy_poll_stop(struct napi_struct *napi, void *have_poll_lock, bool
 	local_bh_disable();
 
 	if (prefer_busy_poll) {
-		napi->defer_hard_irqs_count = READ_ONCE(napi->dev->napi_defer_hard_irqs);
-		timeout = READ_ONCE(napi->dev->gro_flush_timeout);
-		if (napi->defer_hard_irqs_count && timeout) {
+		napi->defer_hard_irqs_count = napi_get_defer_hard_irqs(napi);
+		timeout = napi_get_irq_suspend_timeout(napi);
+		if (timeout)
+			set_bit(NAPI_STATE_IRQ_SUSPENDED, &napi->state);
+		else if (napi->defer_hard_irqs_count)
+			timeout = napi_get_gro_flush_timeout(napi);
+		if (timeout) {
 			hrtimer_start(&napi->timer, ns_to_ktime(timeout), HRTIMER_MODE_REL_PINNED);
 			skip_schedule = true;
 		}
@@ -6190,6 +6352,51 @@ void napi_busy_loop(unsigned int napi_id,
 }
 EXPORT_SYMBOL(napi_busy_loop);
 
+/**
+ * napi_suspend_irqs - keep device IRQs masked while user space busy-polls
+ * @napi_id: NAPI the application just found events on
+ *
+ * With an irq_suspend_timeout set, the NAPI is left to busy polling with
+ * its IRQs masked for up to that long; polling again extends the
+ * suspension, napi_resume_irqs() or the timer expiring end it.
+ */
+void napi_suspend_irqs(unsigned int napi_id)
+{
+	struct napi_struct *napi;
+	unsigned long timeout;
+
+	rcu_read_lock();
+	napi = napi_by_id(napi_id);
+	if (napi) {
+		timeout = napi_get_irq_suspend_timeout(napi);
+		if (timeout) {
+			set_bit(NAPI_STATE_IRQ_SUSPENDED, &napi->state);
+			hrtimer_start(&napi->timer, ns_to_ktime(timeout),
+				      HRTIMER_MODE_REL_PINNED);
+		}
+	}
+	rcu_read_unlock();
+}
+
+/**
+ * napi_resume_irqs - go back to interrupt driven processing
+ * @napi_id: NAPI a busy poll found no events on
+ */
+void napi_resume_irqs(unsigned int napi_id)
+{
+	struct napi_struct *napi;
+
+	rcu_read_lock();
+	napi = napi_by_id(napi_id);
+	if (napi && test_and_clear_bit(NAPI_STATE_IRQ_SUSPENDED, &napi->state)) {
+		/* one more poll re-enables the device IRQs */
+		local_bh_disable();
+		napi_schedule(napi);
+		local_bh_enable();
+	}
+	rcu_read_unlock();
+}
+
 #endif /* CONFIG_NET_RX_BUSY_POLL */
 
 static void napi_hash_add(struct napi_struct *napi)
@@ -6229,6 +6436,7 @@ static enum hrtimer_restart napi_watchdog(struct hrtimer *timer)
 	struct napi_struct *napi;
 
 	napi = container_of(timer, struct napi_struct, timer);
+	clear_bit(NAPI_STATE_IRQ_SUSPENDED, &napi->state);
 
 	/* Note : we use a relaxed variant of napi_schedule_prep() not setting
 	 * NAPI_STATE_MISSED, since we do not react to a device IRQ.
@@ -6317,6 +6525,8 @@ void netif_napi_add_weight(struct net_device *dev, struct napi_struct *napi,
 				weight);
 	napi->weight = weight;
 	napi->dev = dev;
+	napi_set_defer_hard_irqs(napi, READ_ONCE(dev->napi_defer_hard_irqs));
+	napi_set_gro_flush_timeout(napi, READ_ONCE(dev->gro_flush_timeout));
 #ifdef CONFIG_NETPOLL
 	napi->poll_owner = -1;
 #endif
@@ -6335,6 +6545,26 @@ void netif_napi_add_weight(struct net_device *dev, struct napi_struct *napi,
 }
 EXPORT_SYMBOL(netif_napi_add_weight);
 
+/* Set for the device and all of its NAPIs, under rtnl */
+void netdev_set_defer_hard_irqs(struct net_device *netdev, u32 defer)
+{
+	struct napi_struct *napi;
+
+	WRITE_ONCE(netdev->napi_defer_hard_irqs, defer);
+	list_for_each_entry(napi, &netdev->napi_list, dev_list)
+		napi_set_defer_hard_irqs(napi, defer);
+}
+
+void netdev_set_gro_flush_timeout(struct net_device *netdev,
+				  unsigned long timeout)
+{
+	struct napi_struct *napi;
+
+	WRITE_ONCE(netdev->gro_flush_timeout, timeout);
+	list_for_each_entry(napi, &netdev->napi_list, dev_list)
+		napi_set_gro_flush_timeout(napi, timeout);
+}
+
 void napi_disable(struct napi_struct *n)
 {
 	unsigned long val, new;
@@ -6350,7 +6580,8 @@ void napi_disable(struct napi_struct *n)
 		}
 
 		new = val | NAPIF_STATE_SCHED | NAPIF_STATE_NPSVC;
-		new &= ~(NAPIF_STATE_THREADED | NAPIF_STATE_PREFER_BUSY_POLL);
+		new &= ~(NAPIF_STATE_THREADED | NAPIF_STATE_PREFER_BUSY_POLL |
+			 NAPIF_STATE_IRQ_SUSPENDED);
 	} while (!try_cmpxchg(&n->state, &val, new));
 
 	hrtimer_cancel(&n->timer);
@@ -11387,6 +11618,11 @@ static int __init net_dev_init(void)
 		init_gro_hash(&sd->backlog);
 		sd->backlog.poll = process_backlog;
 		sd->backlog.weight = weight_p;
+
+#if IS_ENABLED(CONFIG_PAGE_POOL)
+		if (net_page_pool_create(i))
+			goto out;
+#endif
 	}
 
 	dev_boot_phase = 0;
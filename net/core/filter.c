@@ -4080,8 +4080,11 @@ static int bpf_xdp_frags_shrink_tail(struct xdp_buff *xdp, int offset)
 		if (skb_frag_size(frag) == shrink) {
 			struct page *page = skb_frag_page(frag);
 
-			__xdp_return(page_address(page), &xdp->rxq->mem,
-				     false, NULL);
+			if (xdp_buff_is_frags_skb(xdp))
+				__skb_frag_unref(frag, true);
+			else
+				__xdp_return(page_address(page), &xdp->rxq->mem,
+					     false, NULL);
 			n_frags_free++;
 		} else {
 			skb_frag_size_sub(frag, shrink);
@@ -4391,6 +4394,10 @@ static int xdp_do_generic_redirect_map(struct net_device *dev,
 			goto err;
 		break;
 	case BPF_MAP_TYPE_XSKMAP:
+		/* the generic rxq carries no NAPI id, take it from the skb so
+		 * copy mode sockets can busy poll as well
+		 */
+		sk_mark_napi_id_once(&((struct xdp_sock *)fwd)->sk, skb);
 		err = xsk_generic_rcv(fwd, xdp);
 		if (err)
 			goto err;
@@ -3,9 +3,11 @@
 #include <linux/netdevice.h>
 #include <linux/notifier.h>
 #include <linux/rtnetlink.h>
+#include <net/busy_poll.h>
 #include <net/net_namespace.h>
 #include <net/sock.h>
 
+#include "dev.h"
 #include "netdev-genl-gen.h"
 
 static int
@@ -133,6 +135,177 @@ int netdev_nl_dev_get_dumpit(struct sk_buff *skb, struct netlink_callback *cb)
 	return skb->len;
 }
 
+static int
+netdev_nl_napi_fill(struct napi_struct *napi, struct sk_buff *rsp,
+		    u32 portid, u32 seq, int flags, u32 cmd)
+{
+	void *hdr;
+
+	hdr = genlmsg_put(rsp, portid, seq, &netdev_nl_family, flags, cmd);
+	if (!hdr)
+		return -EMSGSIZE;
+
+	if (nla_put_u32(rsp, NETDEV_A_NAPI_ID, napi->napi_id) ||
+	    nla_put_u32(rsp, NETDEV_A_NAPI_IFINDEX, napi->dev->ifindex) ||
+	    nla_put_u32(rsp, NETDEV_A_NAPI_DEFER_HARD_IRQS,
+			napi_get_defer_hard_irqs(napi)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT,
+			 napi_get_gro_flush_timeout(napi)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT,
+			 napi_get_irq_suspend_timeout(napi)))
+		goto err_cancel;
+
+	if (napi->thread &&
+	    nla_put_u32(rsp, NETDEV_A_NAPI_PID, task_pid_nr(napi->thread)))
+		goto err_cancel;
+
+	genlmsg_end(rsp, hdr);
+
+	return 0;
+
+err_cancel:
+	genlmsg_cancel(rsp, hdr);
+	return -EMSGSIZE;
+}
+
+int netdev_nl_napi_get_doit(struct sk_buff *skb, struct genl_info *info)
+{
+	struct napi_struct *napi;
+	struct sk_buff *rsp;
+	u32 napi_id;
+	int err;
+
+	if (GENL_REQ_ATTR_CHECK(info, NETDEV_A_NAPI_ID))
+		return -EINVAL;
+
+	napi_id = nla_get_u32(info->attrs[NETDEV_A_NAPI_ID]);
+
+	rsp = genlmsg_new(GENLMSG_DEFAULT_SIZE, GFP_KERNEL);
+	if (!rsp)
+		return -ENOMEM;
+
+	rtnl_lock();
+	rcu_read_lock();
+
+	napi = netdev_napi_by_id(genl_info_net(info), napi_id);
+	if (napi)
+		err = netdev_nl_napi_fill(napi, rsp, info->snd_portid,
+					  info->snd_seq, 0, info->genlhdr->cmd);
+	else
+		err = -ENOENT;
+
+	rcu_read_unlock();
+	rtnl_unlock();
+
+	if (err)
+		goto err_free_msg;
+
+	return genlmsg_reply(rsp, info);
+
+err_free_msg:
+	nlmsg_free(rsp);
+	return err;
+}
+
+static int
+netdev_nl_napi_dump_one(struct net_device *netdev, struct sk_buff *rsp,
+			struct netlink_callback *cb, long *idx)
+{
+	struct napi_struct *napi;
+	int err;
+
+	list_for_each_entry(napi, &netdev->napi_list, dev_list) {
+		/* not hashed, so not addressable by id either */
+		if (napi->napi_id < MIN_NAPI_ID)
+			continue;
+		if (*idx >= cb->args[0]) {
+			err = netdev_nl_napi_fill(napi, rsp,
+						  NETLINK_CB(cb->skb).portid,
+						  cb->nlh->nlmsg_seq, NLM_F_MULTI,
+						  NETDEV_CMD_NAPI_GET);
+			if (err)
+				return err;
+		}
+		(*idx)++;
+	}
+
+	return 0;
+}
+
+int netdev_nl_napi_get_dumpit(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct genl_dumpit_info *info = genl_dumpit_info(cb);
+	struct net *net = sock_net(skb->sk);
+	struct net_device *netdev;
+	u32 ifindex = 0;
+	long idx = 0;
+	int err = 0;
+
+	if (info->attrs[NETDEV_A_NAPI_IFINDEX])
+		ifindex = nla_get_u32(info->attrs[NETDEV_A_NAPI_IFINDEX]);
+
+	rtnl_lock();
+
+	if (ifindex) {
+		netdev = __dev_get_by_index(net, ifindex);
+		if (netdev)
+			err = netdev_nl_napi_dump_one(netdev, skb, cb, &idx);
+		else
+			err = -ENODEV;
+	} else {
+		for_each_netdev(net, netdev) {
+			err = netdev_nl_napi_dump_one(netdev, skb, cb, &idx);
+			if (err)
+				break;
+		}
+	}
+
+	rtnl_unlock();
+
+	if (err != -EMSGSIZE)
+		return err;
+
+	cb->args[0] = idx;
+
+	return skb->len;
+}
+
+int netdev_nl_napi_set_doit(struct sk_buff *skb, struct genl_info *info)
+{
+	struct napi_struct *napi;
+	u32 napi_id;
+	int err = 0;
+
+	if (GENL_REQ_ATTR_CHECK(info, NETDEV_A_NAPI_ID))
+		return -EINVAL;
+
+	napi_id = nla_get_u32(info->attrs[NETDEV_A_NAPI_ID]);
+
+	rtnl_lock();
+	rcu_read_lock();
+
+	napi = netdev_napi_by_id(genl_info_net(info), napi_id);
+	if (napi) {
+		if (info->attrs[NETDEV_A_NAPI_DEFER_HARD_IRQS])
+			napi_set_defer_hard_irqs(napi,
+				nla_get_u32(info->attrs[NETDEV_A_NAPI_DEFER_HARD_IRQS]));
+		if (info->attrs[NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT])
+			napi_set_gro_flush_timeout(napi,
+				nla_get_uint(info->attrs[NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT]));
+		if (info->attrs[NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT])
+			napi_set_irq_suspend_timeout(napi,
+				nla_get_uint(info->attrs[NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT]));
+	} else {
+		NL_SET_BAD_ATTR(info->extack, info->attrs[NETDEV_A_NAPI_ID]);
+		err = -ENOENT;
+	}
+
+	rcu_read_unlock();
+	rtnl_unlock();
+
+	return err;
+}
+
 static int netdev_genl_netdevice_event(struct notifier_block *nb,
 				       unsigned long event, void *ptr)
 {
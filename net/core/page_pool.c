@@ -23,6 +23,8 @@
 
 #include <trace/events/page_pool.h>
 
+#include "page_pool_priv.h"
+
 #define DEFER_TIME (msecs_to_jiffies(1000))
 #define DEFER_WARN_INTERVAL (60 * HZ)
 
@@ -161,6 +163,7 @@ static int page_pool_init(struct page_pool *pool,
 			  const struct page_pool_params *params)
 {
 	unsigned int ring_qsize = 1024; /* Default */
+	int cpu, err;
 
 	memcpy(&pool->p, params, sizeof(pool->p));
 
@@ -210,8 +213,20 @@ static int page_pool_init(struct page_pool *pool,
 		return -ENOMEM;
 #endif
 
+	err = -ENOMEM;
+	pool->pcpu_cache = alloc_percpu(struct pp_pcpu_cache);
+	if (!pool->pcpu_cache)
+		goto err_free_stats;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(pool->pcpu_cache, cpu)->lock);
+
 	if (ptr_ring_init(&pool->ring, ring_qsize, GFP_KERNEL) < 0)
-		return -ENOMEM;
+		goto err_free_pcpu;
+
+	err = page_pool_list(pool);
+	if (err)
+		goto err_free_ring;
 
 	atomic_set(&pool->pages_state_release_cnt, 0);
 
@@ -222,6 +237,16 @@ static int page_pool_init(struct page_pool *pool,
 		get_device(pool->p.dev);
 
 	return 0;
+
+err_free_ring:
+	ptr_ring_cleanup(&pool->ring, NULL);
+err_free_pcpu:
+	free_percpu(pool->pcpu_cache);
+err_free_stats:
+#ifdef CONFIG_PAGE_POOL_STATS
+	free_percpu(pool->recycle_stats);
+#endif
+	return err;
 }
 
 struct page_pool *page_pool_create(const struct page_pool_params *params)
@@ -246,6 +271,28 @@ EXPORT_SYMBOL(page_pool_create);
 
 static void page_pool_return_page(struct page_pool *pool, struct page *page);
 
+/* Frees that ran on the consuming CPU itself but outside of its NAPI
+ * context sit in the local cache, take them over before giving up.
+ */
+static struct page *page_pool_refill_from_pcpu(struct page_pool *pool)
+{
+	struct pp_pcpu_cache *pc;
+	struct page *page = NULL;
+
+	pc = per_cpu_ptr(pool->pcpu_cache, raw_smp_processor_id());
+	spin_lock_bh(&pc->lock);
+	while (pc->count && pool->alloc.count < PP_ALLOC_CACHE_REFILL)
+		pool->alloc.cache[pool->alloc.count++] = pc->cache[--pc->count];
+	spin_unlock_bh(&pc->lock);
+
+	if (pool->alloc.count) {
+		page = pool->alloc.cache[--pool->alloc.count];
+		alloc_stat_inc(pool, refill);
+	}
+
+	return page;
+}
+
 noinline
 static struct page *page_pool_refill_alloc_cache(struct page_pool *pool)
 {
@@ -255,8 +302,10 @@ static struct page *page_pool_refill_alloc_cache(struct page_pool *pool)
 
 	/* Quicker fallback, avoid locks when ring is empty */
 	if (__ptr_ring_empty(r)) {
-		alloc_stat_inc(pool, empty);
-		return NULL;
+		page = page_pool_refill_from_pcpu(pool);
+		if (!page)
+			alloc_stat_inc(pool, empty);
+		return page;
 	}
 
 	/* Softirq guarantee CPU and thus NUMA node is stable. This,
@@ -328,6 +377,25 @@ static void page_pool_dma_sync_for_device(struct page_pool *pool,
 					 pool->p.dma_dir);
 }
 
+#define PP_DMA_ATTRS		(DMA_ATTR_SKIP_CPU_SYNC | DMA_ATTR_WEAK_ORDERING)
+
+/* Pages mapped and unmapped with a single IOTLB sync, see the bulk paths */
+#define PP_DMA_BATCH		16
+
+static bool page_pool_dma_mapped(struct page_pool *pool, struct page *page,
+				 dma_addr_t dma)
+{
+	if (dma_mapping_error(pool->p.dev, dma))
+		return false;
+
+	page_pool_set_dma_addr(page, dma);
+
+	if (pool->p.flags & PP_FLAG_DMA_SYNC_DEV)
+		page_pool_dma_sync_for_device(pool, page, pool->p.max_len);
+
+	return true;
+}
+
 static bool page_pool_dma_map(struct page_pool *pool, struct page *page)
 {
 	dma_addr_t dma;
@@ -339,17 +407,9 @@ static bool page_pool_dma_map(struct page_pool *pool, struct page *page)
 	 */
 	dma = dma_map_page_attrs(pool->p.dev, page, 0,
 				 (PAGE_SIZE << pool->p.order),
-				 pool->p.dma_dir, DMA_ATTR_SKIP_CPU_SYNC |
-						  DMA_ATTR_WEAK_ORDERING);
-	if (dma_mapping_error(pool->p.dev, dma))
-		return false;
+				 pool->p.dma_dir, PP_DMA_ATTRS);
 
-	page_pool_set_dma_addr(page, dma);
-
-	if (pool->p.flags & PP_FLAG_DMA_SYNC_DEV)
-		page_pool_dma_sync_for_device(pool, page, pool->p.max_len);
-
-	return true;
+	return page_pool_dma_mapped(pool, page, dma);
 }
 
 static void page_pool_set_pp_info(struct page_pool *pool,
@@ -400,8 +460,9 @@ static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
 	const int bulk = PP_ALLOC_CACHE_REFILL;
 	unsigned int pp_flags = pool->p.flags;
 	unsigned int pp_order = pool->p.order;
+	dma_addr_t dma[PP_DMA_BATCH];
 	struct page *page;
-	int i, nr_pages;
+	int i, j, n, nr_pages;
 
 	/* Don't support bulk alloc for high-order pages */
 	if (unlikely(pp_order))
@@ -420,22 +481,33 @@ static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
 		return NULL;
 
 	/* Pages have been filled into alloc.cache array, but count is zero and
-	 * page element have not been (possibly) DMA mapped.
+	 * page element have not been (possibly) DMA mapped.  They are mapped
+	 * PP_DMA_BATCH at a time, so that an IOMMU only syncs once per chunk.
+	 * alloc.count never overtakes i + j, so compacting the array in place
+	 * does not clobber pages that are still to be looked at.
 	 */
-	for (i = 0; i < nr_pages; i++) {
-		page = pool->alloc.cache[i];
-		if ((pp_flags & PP_FLAG_DMA_MAP) &&
-		    unlikely(!page_pool_dma_map(pool, page))) {
-			put_page(page);
-			continue;
+	for (i = 0; i < nr_pages; i += n) {
+		n = min(nr_pages - i, PP_DMA_BATCH);
+		if (pp_flags & PP_FLAG_DMA_MAP)
+			dma_map_page_batch(pool->p.dev, &pool->alloc.cache[i],
+					   dma, n, PAGE_SIZE, pool->p.dma_dir,
+					   PP_DMA_ATTRS);
+
+		for (j = 0; j < n; j++) {
+			page = pool->alloc.cache[i + j];
+			if ((pp_flags & PP_FLAG_DMA_MAP) &&
+			    !page_pool_dma_mapped(pool, page, dma[j])) {
+				put_page(page);
+				continue;
+			}
+
+			page_pool_set_pp_info(pool, page);
+			pool->alloc.cache[pool->alloc.count++] = page;
+			/* Track how many pages are held 'in-flight' */
+			pool->pages_state_hold_cnt++;
+			trace_page_pool_state_hold(pool, page,
+						   pool->pages_state_hold_cnt);
 		}
-
-		page_pool_set_pp_info(pool, page);
-		pool->alloc.cache[pool->alloc.count++] = page;
-		/* Track how many pages are held 'in-flight' */
-		pool->pages_state_hold_cnt++;
-		trace_page_pool_state_hold(pool, page,
-					   pool->pages_state_hold_cnt);
 	}
 
 	/* Return last page */
@@ -487,30 +559,12 @@ static s32 page_pool_inflight(struct page_pool *pool)
 	return inflight;
 }
 
-/* Disconnects a page (from a page_pool).  API users can have a need
- * to disconnect a page (from a page_pool), to allow it to be used as
- * a regular page (that will eventually be returned to the normal
- * page-allocator via put_page).
- */
-void page_pool_release_page(struct page_pool *pool, struct page *page)
+/* Everything page_pool_release_page() does after the DMA unmap */
+static void __page_pool_release_page(struct page_pool *pool,
+				     struct page *page)
 {
-	dma_addr_t dma;
 	int count;
 
-	if (!(pool->p.flags & PP_FLAG_DMA_MAP))
-		/* Always account for inflight pages, even if we didn't
-		 * map them
-		 */
-		goto skip_dma_unmap;
-
-	dma = page_pool_get_dma_addr(page);
-
-	/* When page is unmapped, it cannot be returned to our pool */
-	dma_unmap_page_attrs(pool->p.dev, dma,
-			     PAGE_SIZE << pool->p.order, pool->p.dma_dir,
-			     DMA_ATTR_SKIP_CPU_SYNC | DMA_ATTR_WEAK_ORDERING);
-	page_pool_set_dma_addr(page, 0);
-skip_dma_unmap:
 	page_pool_clear_pp_info(page);
 
 	/* This may be the last page returned, releasing the pool, so
@@ -519,6 +573,24 @@ void page_pool_release_page(struct page_pool *pool, struct page *page)
 	count = atomic_inc_return_relaxed(&pool->pages_state_release_cnt);
 	trace_page_pool_state_release(pool, page, count);
 }
+
+/* Disconnects a page (from a page_pool).  API users can have a need
+ * to disconnect a page (from a page_pool), to allow it to be used as
+ * a regular page (that will eventually be returned to the normal
+ * page-allocator via put_page).
+ */
+void page_pool_release_page(struct page_pool *pool, struct page *page)
+{
+	/* Always account for inflight pages, even if we didn't map them */
+	if (pool->p.flags & PP_FLAG_DMA_MAP) {
+		/* When page is unmapped, it cannot be returned to our pool */
+		dma_unmap_page_attrs(pool->p.dev, page_pool_get_dma_addr(page),
+				     PAGE_SIZE << pool->p.order,
+				     pool->p.dma_dir, PP_DMA_ATTRS);
+		page_pool_set_dma_addr(page, 0);
+	}
+	__page_pool_release_page(pool, page);
+}
 EXPORT_SYMBOL(page_pool_release_page);
 
 /* Return a page to the page allocator, cleaning up our state */
@@ -533,21 +605,68 @@ static void page_pool_return_page(struct page_pool *pool, struct page *page)
 	 */
 }
 
-static bool page_pool_recycle_in_ring(struct page_pool *pool, struct page *page)
+/* Like page_pool_return_page() on each page, with the unmaps batched */
+static void page_pool_return_pages(struct page_pool *pool, void **pages,
+				   int count)
 {
-	int ret;
-	/* BH protection not needed if current is softirq */
-	if (in_softirq())
-		ret = ptr_ring_produce(&pool->ring, page);
-	else
-		ret = ptr_ring_produce_bh(&pool->ring, page);
+	struct dma_unmap_batch batch;
+	int i;
 
-	if (!ret) {
-		recycle_stat_inc(pool, ring);
-		return true;
+	if (pool->p.flags & PP_FLAG_DMA_MAP) {
+		dma_unmap_batch_init(&batch);
+		for (i = 0; i < count; i++) {
+			dma_unmap_batch_add(&batch, pool->p.dev,
+					    page_pool_get_dma_addr(pages[i]),
+					    PAGE_SIZE << pool->p.order,
+					    pool->p.dma_dir, PP_DMA_ATTRS);
+			page_pool_set_dma_addr(pages[i], 0);
+		}
+		/* the pages must not be freed while the device can see them */
+		dma_unmap_batch_flush(&batch);
 	}
 
-	return false;
+	for (i = 0; i < count; i++) {
+		__page_pool_release_page(pool, pages[i]);
+		put_page(pages[i]);
+	}
+}
+
+/* Move a full per-CPU batch to the ring under a single producer lock */
+static void page_pool_flush_pcpu(struct page_pool *pool,
+				 struct pp_pcpu_cache *pc)
+{
+	bool in_softirq;
+	u32 i;
+
+	in_softirq = page_pool_producer_lock(pool);
+	for (i = 0; i < pc->count; i++) {
+		if (__ptr_ring_produce(&pool->ring, pc->cache[i])) {
+			/* ring full */
+			recycle_stat_inc(pool, ring_full);
+			break;
+		}
+	}
+	recycle_stat_add(pool, ring, i);
+	page_pool_producer_unlock(pool, in_softirq);
+
+	for (; i < pc->count; i++)
+		page_pool_return_page(pool, pc->cache[i]);
+	pc->count = 0;
+}
+
+static void page_pool_recycle_in_pcpu(struct page_pool *pool,
+				      struct page *page)
+{
+	struct pp_pcpu_cache *pc;
+
+	local_bh_disable();
+	pc = this_cpu_ptr(pool->pcpu_cache);
+	spin_lock(&pc->lock);
+	pc->cache[pc->count++] = page;
+	if (pc->count == PP_PCPU_CACHE_SIZE)
+		page_pool_flush_pcpu(pool, pc);
+	spin_unlock(&pc->lock);
+	local_bh_enable();
 }
 
 /* Only allow direct recycling in special circumstances, into the
@@ -627,11 +746,8 @@ void page_pool_put_defragged_page(struct page_pool *pool, struct page *page,
 				  unsigned int dma_sync_size, bool allow_direct)
 {
 	page = __page_pool_put_page(pool, page, dma_sync_size, allow_direct);
-	if (page && !page_pool_recycle_in_ring(pool, page)) {
-		/* Cache full, fallback to free pages */
-		recycle_stat_inc(pool, ring_full);
-		page_pool_return_page(pool, page);
-	}
+	if (page)
+		page_pool_recycle_in_pcpu(pool, page);
 }
 EXPORT_SYMBOL(page_pool_put_defragged_page);
 
@@ -677,8 +793,7 @@ void page_pool_put_page_bulk(struct page_pool *pool, void **data,
 	/* ptr_ring cache full, free remaining pages outside producer lock
 	 * since put_page() with refcnt == 1 can be an expensive operation
 	 */
-	for (; i < bulk_len; i++)
-		page_pool_return_page(pool, data[i]);
+	page_pool_return_pages(pool, &data[i], bulk_len - i);
 }
 EXPORT_SYMBOL(page_pool_put_page_bulk);
 
@@ -776,6 +891,20 @@ static void page_pool_empty_ring(struct page_pool *pool)
 	}
 }
 
+static void page_pool_empty_pcpu_caches(struct page_pool *pool)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct pp_pcpu_cache *pc = per_cpu_ptr(pool->pcpu_cache, cpu);
+
+		spin_lock_bh(&pc->lock);
+		while (pc->count)
+			page_pool_return_page(pool, pc->cache[--pc->count]);
+		spin_unlock_bh(&pc->lock);
+	}
+}
+
 static void page_pool_free(struct page_pool *pool)
 {
 	if (pool->disconnect)
@@ -786,6 +915,7 @@ static void page_pool_free(struct page_pool *pool)
 	if (pool->p.flags & PP_FLAG_DMA_MAP)
 		put_device(pool->p.dev);
 
+	free_percpu(pool->pcpu_cache);
 #ifdef CONFIG_PAGE_POOL_STATS
 	free_percpu(pool->recycle_stats);
 #endif
@@ -817,6 +947,7 @@ static void page_pool_scrub(struct page_pool *pool)
 	/* No more consumers should exist, but producers could still
 	 * be in-flight.
 	 */
+	page_pool_empty_pcpu_caches(pool);
 	page_pool_empty_ring(pool);
 }
 
@@ -886,6 +1017,7 @@ void page_pool_destroy(struct page_pool *pool)
 	if (!page_pool_put(pool))
 		return;
 
+	page_pool_unlist(pool);
 	page_pool_unlink_napi(pool);
 	page_pool_free_frag(pool);
 
@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/netdevice.h>
+#include <linux/xarray.h>
+#include <net/net_namespace.h>
+#include <net/page_pool.h>
+#include <net/sock.h>
+
+#include "page_pool_priv.h"
+#include "netdev-genl-gen.h"
+
+/* Pools feeding a netdev, by id. Entries are removed by page_pool_destroy(),
+ * while the netdev is still around, and readers hold the xa_lock so that
+ * the pool cannot be freed under them.
+ */
+static DEFINE_XARRAY_FLAGS(page_pools, XA_FLAGS_ALLOC1 | XA_FLAGS_LOCK_BH);
+static u32 id_alloc_next;
+
+int page_pool_list(struct page_pool *pool)
+{
+	struct net_device *netdev = pool->p.netdev;
+	int err;
+
+	if (!netdev && pool->p.napi)
+		netdev = pool->p.napi->dev;
+	if (!netdev)
+		return 0;
+
+	pool->user.netdev = netdev;
+	err = xa_alloc_cyclic_bh(&page_pools, &pool->user.id, pool,
+				 xa_limit_32b, &id_alloc_next, GFP_KERNEL);
+	if (err < 0) {
+		pool->user.netdev = NULL;
+		return err;
+	}
+
+	return 0;
+}
+
+void page_pool_unlist(struct page_pool *pool)
+{
+	if (pool->user.id)
+		xa_erase_bh(&page_pools, pool->user.id);
+}
+
+#ifdef CONFIG_PAGE_POOL_STATS
+static int
+page_pool_nl_stats_fill(struct sk_buff *rsp, struct page_pool *pool,
+			u32 portid, u32 seq, int flags)
+{
+	struct page_pool_stats stats = {};
+	struct nlattr *nest;
+	void *hdr;
+
+	page_pool_get_stats(pool, &stats);
+
+	hdr = genlmsg_put(rsp, portid, seq, &netdev_nl_family, flags,
+			  NETDEV_CMD_PAGE_POOL_STATS_GET);
+	if (!hdr)
+		return -EMSGSIZE;
+
+	nest = nla_nest_start(rsp, NETDEV_A_PAGE_POOL_STATS_INFO);
+	if (!nest)
+		goto err_cancel;
+
+	if (nla_put_uint(rsp, NETDEV_A_PAGE_POOL_ID, pool->user.id) ||
+	    nla_put_u32(rsp, NETDEV_A_PAGE_POOL_IFINDEX,
+			pool->user.netdev->ifindex))
+		goto err_cancel;
+
+	nla_nest_end(rsp, nest);
+
+	if (nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_FAST,
+			 stats.alloc_stats.fast) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_SLOW,
+			 stats.alloc_stats.slow) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_SLOW_HIGH_ORDER,
+			 stats.alloc_stats.slow_high_order) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_EMPTY,
+			 stats.alloc_stats.empty) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_REFILL,
+			 stats.alloc_stats.refill) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_WAIVE,
+			 stats.alloc_stats.waive) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_CACHED,
+			 stats.recycle_stats.cached) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_CACHE_FULL,
+			 stats.recycle_stats.cache_full) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING,
+			 stats.recycle_stats.ring) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING_FULL,
+			 stats.recycle_stats.ring_full) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RELEASED_REFCNT,
+			 stats.recycle_stats.released_refcnt))
+		goto err_cancel;
+
+	genlmsg_end(rsp, hdr);
+
+	return 0;
+
+err_cancel:
+	genlmsg_cancel(rsp, hdr);
+	return -EMSGSIZE;
+}
+
+int netdev_nl_page_pool_stats_get_doit(struct sk_buff *skb,
+				       struct genl_info *info)
+{
+	struct nlattr *tb[ARRAY_SIZE(netdev_page_pool_info_nl_policy)];
+	struct page_pool *pool;
+	struct nlattr *nest;
+	struct sk_buff *rsp;
+	u32 id;
+	int err;
+
+	if (GENL_REQ_ATTR_CHECK(info, NETDEV_A_PAGE_POOL_STATS_INFO))
+		return -EINVAL;
+
+	nest = info->attrs[NETDEV_A_PAGE_POOL_STATS_INFO];
+	err = nla_parse_nested(tb, ARRAY_SIZE(tb) - 1, nest,
+			       netdev_page_pool_info_nl_policy,
+			       info->extack);
+	if (err)
+		return err;
+
+	if (NL_REQ_ATTR_CHECK(info->extack, nest, tb, NETDEV_A_PAGE_POOL_ID))
+		return -EINVAL;
+	if (tb[NETDEV_A_PAGE_POOL_IFINDEX]) {
+		NL_SET_ERR_MSG_ATTR(info->extack,
+				    tb[NETDEV_A_PAGE_POOL_IFINDEX],
+				    "selecting by ifindex not supported");
+		return -EINVAL;
+	}
+
+	id = nla_get_uint(tb[NETDEV_A_PAGE_POOL_ID]);
+
+	rsp = genlmsg_new(GENLMSG_DEFAULT_SIZE, GFP_KERNEL);
+	if (!rsp)
+		return -ENOMEM;
+
+	xa_lock_bh(&page_pools);
+	pool = xa_load(&page_pools, id);
+	if (pool && net_eq(dev_net(pool->user.netdev), genl_info_net(info)))
+		err = page_pool_nl_stats_fill(rsp, pool, info->snd_portid,
+					      info->snd_seq, 0);
+	else
+		err = -ENOENT;
+	xa_unlock_bh(&page_pools);
+
+	if (err)
+		goto err_free_msg;
+
+	return genlmsg_reply(rsp, info);
+
+err_free_msg:
+	nlmsg_free(rsp);
+	return err;
+}
+
+int netdev_nl_page_pool_stats_get_dumpit(struct sk_buff *skb,
+					 struct netlink_callback *cb)
+{
+	struct net *net = sock_net(skb->sk);
+	struct page_pool *pool;
+	unsigned long id;
+	int err = 0;
+
+	xa_lock_bh(&page_pools);
+	xa_for_each_start(&page_pools, id, pool, cb->args[0]) {
+		if (!net_eq(dev_net(pool->user.netdev), net))
+			continue;
+
+		err = page_pool_nl_stats_fill(skb, pool,
+					      NETLINK_CB(cb->skb).portid,
+					      cb->nlh->nlmsg_seq, NLM_F_MULTI);
+		if (err)
+			break;
+	}
+	xa_unlock_bh(&page_pools);
+
+	if (err != -EMSGSIZE)
+		return err;
+
+	cb->args[0] = id;
+
+	return skb->len;
+}
+#endif /* CONFIG_PAGE_POOL_STATS */
@@ -4769,6 +4769,8 @@ void __init skb_init(void)
 					      offsetof(struct sk_buff, cb),
 					      sizeof_field(struct sk_buff, cb),
 					      NULL);
+	/* rx and tx churn through skbs in bursts on the same cpu */
+	kmem_cache_setup_percpu_array(skbuff_cache, 64);
 	skbuff_fclone_cache = kmem_cache_create("skbuff_fclone_cache",
 						sizeof(struct sk_buff_fclones),
 						0,
@@ -4786,6 +4788,7 @@ void __init skb_init(void)
 						0,
 						SKB_SMALL_HEAD_HEADROOM,
 						NULL);
+	kmem_cache_setup_percpu_array(skb_small_head_cache, 64);
 #endif
 	skb_extensions_init();
 }
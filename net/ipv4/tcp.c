@@ -1925,6 +1925,33 @@ static bool can_map_frag(const skb_frag_t *frag)
 	return skb_frag_size(frag) == PAGE_SIZE && !skb_frag_off(frag);
 }
 
+/* Returns how many frags, starting at @frag, make up one mappable page, or 0.
+ * Besides a single page sized frag, this accepts a run of frags on the same
+ * page each starting where the previous one ended, covering the whole page.
+ * That is what header split NICs packing consecutive payloads into one
+ * page_pool page produce, e.g. MSS sized segments on 16K page kernels.
+ */
+static int tcp_zc_frags_per_page(const skb_frag_t *frag, int remaining_in_skb)
+{
+	struct page *page = skb_frag_page(frag);
+	u32 off = 0;
+	int nr = 0;
+
+	if (likely(can_map_frag(frag)))
+		return 1;
+
+	while (remaining_in_skb > 0 && skb_frag_page(frag) == page &&
+	       skb_frag_off(frag) == off) {
+		off += skb_frag_size(frag);
+		remaining_in_skb -= skb_frag_size(frag);
+		nr++;
+		if (off >= PAGE_SIZE)
+			return off == PAGE_SIZE ? nr : 0;
+		++frag;
+	}
+	return 0;
+}
+
 static int find_next_mappable_frag(const skb_frag_t *frag,
 				   int remaining_in_skb)
 {
@@ -1933,7 +1960,8 @@ static int find_next_mappable_frag(const skb_frag_t *frag,
 	if (likely(can_map_frag(frag)))
 		return 0;
 
-	while (offset < remaining_in_skb && !can_map_frag(frag)) {
+	while (offset < remaining_in_skb &&
+	       !tcp_zc_frags_per_page(frag, remaining_in_skb - offset)) {
 		offset += skb_frag_size(frag);
 		++frag;
 	}
@@ -2149,6 +2177,75 @@ static int tcp_zerocopy_vm_insert_batch(struct vm_area_struct *vma,
 		err);
 }
 
+/* TCP_RECEIVE_ZEROCOPY_FLAG_ASSEMBLE: copy payload that cannot be mapped as
+ * is into fresh pages and map those instead. This still costs a copy, but
+ * keeps bulk receivers on the mmap() path when frags are smaller than a page.
+ * Only data up to the already committed *seq is released from the queue,
+ * so a failed insert loses nothing.
+ */
+static int tcp_zerocopy_assemble(struct sock *sk, struct vm_area_struct *vma,
+				 struct tcp_zerocopy_receive *zc,
+				 unsigned long *address, u32 *length, u32 *seq,
+				 struct scm_timestamping_internal *tss)
+{
+	while (*length + PAGE_SIZE <= zc->length) {
+		struct sk_buff *skb;
+		struct page *page;
+		u32 copied = 0;
+		u32 offset;
+		int err;
+
+		skb = tcp_recv_skb(sk, *seq, &offset);
+		if (!skb)
+			return 0;
+
+		page = alloc_page(GFP_KERNEL_ACCOUNT);
+		if (!page)
+			return -ENOMEM;
+
+		while (skb && copied < PAGE_SIZE) {
+			u32 chunk = min_t(u32, skb->len - offset,
+					  PAGE_SIZE - copied);
+
+			if (TCP_SKB_CB(skb)->has_rxtstamp) {
+				tcp_update_recv_tstamps(skb, tss);
+				zc->msg_flags |= TCP_CMSG_TS;
+			}
+			if (skb_copy_bits(skb, offset,
+					  page_address(page) + copied, chunk))
+				break;
+			copied += chunk;
+			offset = 0;
+			skb = skb_peek_next(skb, &sk->sk_receive_queue);
+		}
+
+		if (copied < PAGE_SIZE) {
+			__free_page(page);
+			return 0;
+		}
+
+		if (zc->flags & TCP_RECEIVE_ZEROCOPY_FLAG_TLB_CLEAN_HINT)
+			zap_page_range_single(vma, *address, PAGE_SIZE, NULL);
+		err = vm_insert_page(vma, *address, page);
+		if (err == -EBUSY) {
+			/*
+			 * Still mapped from an earlier receive, zap it and try
+			 * again like tcp_zerocopy_vm_insert_batch_error() does.
+			 */
+			zap_page_range_single(vma, *address, PAGE_SIZE, NULL);
+			err = vm_insert_page(vma, *address, page);
+		}
+		put_page(page);
+		if (err)
+			return err;
+
+		*address += PAGE_SIZE;
+		*length += PAGE_SIZE;
+		*seq += PAGE_SIZE;
+	}
+	return 0;
+}
+
 #define TCP_VALID_ZC_MSG_FLAGS   (TCP_CMSG_TS)
 static void tcp_zc_finalize_rx_tstamp(struct sock *sk,
 				      struct tcp_zerocopy_receive *zc,
@@ -2239,7 +2336,7 @@ static int tcp_zerocopy_receive(struct sock *sk,
 	}
 	ret = 0;
 	while (length + PAGE_SIZE <= zc->length) {
-		int mappable_offset;
+		int mappable_offset, nr_frags;
 		struct page *page;
 
 		if (zc->recv_skip_hint < PAGE_SIZE) {
@@ -2270,12 +2367,13 @@ static int tcp_zerocopy_receive(struct sock *sk,
 			zc->recv_skip_hint = mappable_offset;
 			break;
 		}
+		nr_frags = tcp_zc_frags_per_page(frags, zc->recv_skip_hint);
 		page = skb_frag_page(frags);
 		prefetchw(page);
 		pages[pages_to_map++] = page;
 		length += PAGE_SIZE;
 		zc->recv_skip_hint -= PAGE_SIZE;
-		frags++;
+		frags += nr_frags;
 		if (pages_to_map == TCP_ZEROCOPY_PAGE_BATCH_SIZE ||
 		    zc->recv_skip_hint < PAGE_SIZE) {
 			/* Either full batch, or we're about to go to next skb
@@ -2296,6 +2394,14 @@ static int tcp_zerocopy_receive(struct sock *sk,
 						   &address, &length, &seq,
 						   zc, total_bytes_to_map);
 	}
+	if (!ret && (zc->flags & TCP_RECEIVE_ZEROCOPY_FLAG_ASSEMBLE) &&
+	    length + PAGE_SIZE <= zc->length) {
+		ret = tcp_zerocopy_assemble(sk, vma, zc, &address, &length,
+					    &seq, tss);
+		/* straggler data now starts at seq, in whichever skb that is */
+		skb = tcp_recv_skb(sk, seq, &offset);
+		zc->recv_skip_hint = skb ? skb->len - offset : 0;
+	}
 out:
 	mmap_read_unlock(current->mm);
 	/* Try to copy straggler data. */
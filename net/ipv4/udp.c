@@ -1932,7 +1932,7 @@ int udp_recvmsg(struct sock *sk, struct msghdr *msg, size_t len, int flags,
 						      (struct sockaddr *)sin);
 	}
 
-	if (udp_sk(sk)->gro_enabled)
+	if (udp_sk(sk)->gro_enabled || udp_sk(sk)->gro_list)
 		udp_cmsg_recv(msg, sk, skb);
 
 	if (inet->cmsg_flags)
@@ -2774,7 +2774,23 @@ int udp_lib_setsockopt(struct sock *sk, int level, int optname,
 		if (valbool)
 			udp_tunnel_encap_enable(sk->sk_socket);
 		up->gro_enabled = valbool;
-		up->accept_udp_l4 = valbool;
+		up->accept_udp_l4 = valbool || up->gro_list;
+		release_sock(sk);
+		break;
+
+	case UDP_GRO_LIST:
+		lock_sock(sk);
+
+		/*
+		 * datagram lists arrive as fraglist GSO packets, which also
+		 * carry SKB_GSO_UDP_L4 and are only kept whole if both are
+		 * accepted, see udp_unexpected_gso()
+		 */
+		if (valbool)
+			udp_tunnel_encap_enable(sk->sk_socket);
+		up->gro_list = valbool;
+		up->accept_udp_fraglist = valbool;
+		up->accept_udp_l4 = valbool || up->gro_enabled;
 		release_sock(sk);
 		break;
 
@@ -2866,6 +2882,10 @@ int udp_lib_getsockopt(struct sock *sk, int level, int optname,
 		val = up->gro_enabled;
 		break;
 
+	case UDP_GRO_LIST:
+		val = up->gro_list;
+		break;
+
 	/* The following two cannot be changed on UDP sockets, the return is
 	 * always 0 (which corresponds to the full checksum coverage of UDP). */
 	case UDPLITE_SEND_CSCOV:
@@ -461,8 +461,9 @@ static int skb_gro_receive_list(struct sk_buff *p, struct sk_buff *skb)
 
 
 #define UDP_GRO_CNT_MAX 64
-static struct sk_buff *udp_gro_receive_segment(struct list_head *head,
-					       struct sk_buff *skb)
+static struct sk_buff *__udp_gro_receive_segment(struct list_head *head,
+						 struct sk_buff *skb,
+						 bool any_len)
 {
 	struct udphdr *uh = udp_gro_udphdr(skb);
 	struct sk_buff *pp = NULL;
@@ -508,8 +509,10 @@ static struct sk_buff *udp_gro_receive_segment(struct list_head *head,
 		 * leading to excessive truesize values.
 		 * On len mismatch merge the first packet shorter than gso_size,
 		 * otherwise complete the GRO packet.
+		 * Datagram lists keep every datagram in its own skb, so sizes
+		 * don't have to match at all.
 		 */
-		if (ulen > ntohs(uh2->len)) {
+		if (!any_len && ulen > ntohs(uh2->len)) {
 			pp = p;
 		} else {
 			if (NAPI_GRO_CB(skb)->is_flist) {
@@ -531,7 +534,7 @@ static struct sk_buff *udp_gro_receive_segment(struct list_head *head,
 			}
 		}
 
-		if (ret || ulen != ntohs(uh2->len) ||
+		if (ret || (!any_len && ulen != ntohs(uh2->len)) ||
 		    NAPI_GRO_CB(p)->count >= UDP_GRO_CNT_MAX)
 			pp = p;
 
@@ -542,6 +545,18 @@ static struct sk_buff *udp_gro_receive_segment(struct list_head *head,
 	return NULL;
 }
 
+static struct sk_buff *udp_gro_receive_segment(struct list_head *head,
+					       struct sk_buff *skb)
+{
+	return __udp_gro_receive_segment(head, skb, false);
+}
+
+static struct sk_buff *udp_gro_receive_list(struct list_head *head,
+					    struct sk_buff *skb)
+{
+	return __udp_gro_receive_segment(head, skb, true);
+}
+
 struct sk_buff *udp_gro_receive(struct list_head *head, struct sk_buff *skb,
 				struct udphdr *uh, struct sock *sk)
 {
@@ -556,6 +571,15 @@ struct sk_buff *udp_gro_receive(struct list_head *head, struct sk_buff *skb,
 	 */
 	NAPI_GRO_CB(skb)->is_flist = 0;
 	if (!sk || !udp_sk(sk)->gro_receive) {
+		/* Sockets asking for datagram lists get them whatever the
+		 * device features and sizes, a flow is still kept apart
+		 * from others by the address and port matching.
+		 */
+		if (sk && udp_sk(sk)->gro_list) {
+			NAPI_GRO_CB(skb)->is_flist = 1;
+			return call_gro_receive(udp_gro_receive_list, head, skb);
+		}
+
 		if (skb->dev->features & NETIF_F_GRO_FRAGLIST)
 			NAPI_GRO_CB(skb)->is_flist = sk ? !udp_sk(sk)->gro_enabled : 1;
 
@@ -437,7 +437,7 @@ int udpv6_recvmsg(struct sock *sk, struct msghdr *msg, size_t len,
 						      (struct sockaddr *)sin6);
 	}
 
-	if (udp_sk(sk)->gro_enabled)
+	if (udp_sk(sk)->gro_enabled || udp_sk(sk)->gro_list)
 		udp_cmsg_recv(msg, sk, skb);
 
 	if (np->rxopt.all)
@@ -49,6 +49,7 @@
 #include <net/netfilter/nf_conntrack_synproxy.h>
 #include <net/netfilter/nf_nat.h>
 #include <net/netfilter/nf_nat_helper.h>
+#include <net/netns/generic.h>
 #include <net/netns/hash.h>
 #include <net/ip.h>
 
@@ -1602,6 +1603,106 @@ static void conntrack_gc_work_init(struct conntrack_gc_work *gc_work)
 	gc_work->exiting = false;
 }
 
+/* Conntracks are charged to cnet->count in batches of NF_CT_COUNT_BATCH
+ * which each CPU then hands out from its own credit, so allocation and
+ * freeing only touch the shared counter once per batch.  cnet->count is
+ * the number of conntracks plus the unused credit of all CPUs, which
+ * nf_conntrack_count() subtracts again.  Close to nf_conntrack_max we
+ * charge one at a time, so idle credit can cost at most
+ * NF_CT_COUNT_CREDIT_MAX entries per CPU before early drop kicks in.
+ */
+#define NF_CT_COUNT_BATCH	32
+#define NF_CT_COUNT_CREDIT_MAX	(2 * NF_CT_COUNT_BATCH)
+
+struct nf_ct_count_net {
+	int __percpu	*credit;
+};
+
+static unsigned int nf_ct_count_net_id __read_mostly;
+
+static int __percpu *nf_ct_count_credit(const struct net *net)
+{
+	const struct nf_ct_count_net *cn = net_generic(net, nf_ct_count_net_id);
+
+	return cn->credit;
+}
+
+/* Returns the shared count if it had to be charged, 0 if the new conntrack
+ * was covered by this CPU's credit.
+ */
+static unsigned int nf_ct_count_inc(struct net *net,
+				    struct nf_conntrack_net *cnet)
+{
+	int __percpu *credit = nf_ct_count_credit(net);
+	unsigned int ct_count;
+
+	preempt_disable();
+	if (likely(this_cpu_dec_return(*credit) >= 0)) {
+		preempt_enable();
+		return 0;
+	}
+	this_cpu_inc(*credit);
+
+	ct_count = atomic_add_return(NF_CT_COUNT_BATCH, &cnet->count);
+	if (nf_conntrack_max && ct_count > nf_conntrack_max) {
+		atomic_sub(NF_CT_COUNT_BATCH - 1, &cnet->count);
+		ct_count -= NF_CT_COUNT_BATCH - 1;
+	} else {
+		this_cpu_add(*credit, NF_CT_COUNT_BATCH - 1);
+	}
+	preempt_enable();
+
+	return ct_count;
+}
+
+static void nf_ct_count_dec(struct net *net, struct nf_conntrack_net *cnet)
+{
+	int __percpu *credit = nf_ct_count_credit(net);
+
+	preempt_disable();
+	if (unlikely(this_cpu_inc_return(*credit) > NF_CT_COUNT_CREDIT_MAX)) {
+		this_cpu_sub(*credit, NF_CT_COUNT_BATCH);
+		atomic_sub(NF_CT_COUNT_BATCH, &cnet->count);
+	}
+	preempt_enable();
+}
+
+u32 nf_conntrack_count(const struct net *net)
+{
+	const struct nf_conntrack_net *cnet = nf_ct_pernet(net);
+	int __percpu *credit = nf_ct_count_credit(net);
+	int count = atomic_read(&cnet->count);
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		count -= READ_ONCE(*per_cpu_ptr(credit, cpu));
+
+	return max(count, 0);
+}
+EXPORT_SYMBOL_GPL(nf_conntrack_count);
+
+static int __net_init nf_ct_count_net_init(struct net *net)
+{
+	struct nf_ct_count_net *cn = net_generic(net, nf_ct_count_net_id);
+
+	cn->credit = alloc_percpu(int);
+	return cn->credit ? 0 : -ENOMEM;
+}
+
+static void __net_exit nf_ct_count_net_exit(struct net *net)
+{
+	struct nf_ct_count_net *cn = net_generic(net, nf_ct_count_net_id);
+
+	free_percpu(cn->credit);
+}
+
+static struct pernet_operations nf_ct_count_net_ops = {
+	.init	= nf_ct_count_net_init,
+	.exit	= nf_ct_count_net_exit,
+	.id	= &nf_ct_count_net_id,
+	.size	= sizeof(struct nf_ct_count_net),
+};
+
 static struct nf_conn *
 __nf_conntrack_alloc(struct net *net,
 		     const struct nf_conntrack_zone *zone,
@@ -1614,7 +1715,7 @@ __nf_conntrack_alloc(struct net *net,
 	struct nf_conn *ct;
 
 	/* We don't want any race condition at early drop stage */
-	ct_count = atomic_inc_return(&cnet->count);
+	ct_count = nf_ct_count_inc(net, cnet);
 
 	if (nf_conntrack_max && unlikely(ct_count > nf_conntrack_max)) {
 		if (!early_drop(net, hash)) {
@@ -1653,7 +1754,7 @@ __nf_conntrack_alloc(struct net *net,
 	refcount_set(&ct->ct_general.use, 0);
 	return ct;
 out:
-	atomic_dec(&cnet->count);
+	nf_ct_count_dec(net, cnet);
 	return ERR_PTR(-ENOMEM);
 }
 
@@ -1691,8 +1792,9 @@ void nf_conntrack_free(struct nf_conn *ct)
 	kmem_cache_free(nf_conntrack_cachep, ct);
 	cnet = nf_ct_pernet(net);
 
-	smp_mb__before_atomic();
-	atomic_dec(&cnet->count);
+	/* order the free before the count drop netns exit waits for */
+	smp_mb();
+	nf_ct_count_dec(net, cnet);
 }
 EXPORT_SYMBOL_GPL(nf_conntrack_free);
 
@@ -2513,6 +2615,7 @@ void nf_conntrack_cleanup_end(void)
 	nf_conntrack_proto_fini();
 	nf_conntrack_helper_fini();
 	nf_conntrack_expect_fini();
+	unregister_pernet_subsys(&nf_ct_count_net_ops);
 
 	kmem_cache_destroy(nf_conntrack_cachep);
 }
@@ -2548,7 +2651,7 @@ void nf_conntrack_cleanup_net_list(struct list_head *net_exit_list)
 
 		iter_data.net = net;
 		nf_ct_iterate_cleanup_net(kill_all, &iter_data);
-		if (atomic_read(&cnet->count) != 0)
+		if (nf_conntrack_count(net) != 0)
 			busy = 1;
 	}
 	if (busy) {
@@ -2714,6 +2817,10 @@ int nf_conntrack_init_start(void)
 	if (!nf_conntrack_cachep)
 		goto err_cachep;
 
+	ret = register_pernet_subsys(&nf_ct_count_net_ops);
+	if (ret < 0)
+		goto err_count;
+
 	ret = nf_conntrack_expect_init();
 	if (ret < 0)
 		goto err_expect;
@@ -2743,6 +2850,8 @@ int nf_conntrack_init_start(void)
 err_helper:
 	nf_conntrack_expect_fini();
 err_expect:
+	unregister_pernet_subsys(&nf_ct_count_net_ops);
+err_count:
 	kmem_cache_destroy(nf_conntrack_cachep);
 err_cachep:
 	kvfree(nf_conntrack_hash);
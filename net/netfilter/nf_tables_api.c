@@ -23,6 +23,8 @@
 #include <net/net_namespace.h>
 #include <net/sock.h>
 
+#include "nft_set_pipapo_neon.h"
+
 #define NFT_MODULE_AUTOLOAD_LIMIT (MODULE_NAME_LEN - sizeof("nft-expr-255-"))
 
 unsigned int nf_tables_net_id __read_mostly;
@@ -4112,6 +4114,9 @@ static const struct nft_set_type *nft_set_types[] = {
 	&nft_set_rbtree_type,
 #if defined(CONFIG_X86_64) && !defined(CONFIG_UML)
 	&nft_set_pipapo_avx2_type,
+#endif
+#if defined(CONFIG_ARM64) && defined(CONFIG_KERNEL_MODE_NEON)
+	&nft_set_pipapo_neon_type,
 #endif
 	&nft_set_pipapo_type,
 };
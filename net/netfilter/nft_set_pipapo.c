@@ -340,10 +340,11 @@
 #include <linux/bitops.h>
 
 #include "nft_set_pipapo_avx2.h"
+#include "nft_set_pipapo_neon.h"
 #include "nft_set_pipapo.h"
 
 /* Current working bitmap index, toggled between field matches */
-static DEFINE_PER_CPU(bool, nft_pipapo_scratch_index);
+DEFINE_PER_CPU(bool, nft_pipapo_scratch_index);
 
 /**
  * pipapo_refill() - For each set bit, set bits from selected mapping table item
@@ -2323,3 +2324,28 @@ const struct nft_set_type nft_set_pipapo_avx2_type = {
 	},
 };
 #endif
+
+#if defined(CONFIG_ARM64) && defined(CONFIG_KERNEL_MODE_NEON)
+const struct nft_set_type nft_set_pipapo_neon_type = {
+	.features	= NFT_SET_INTERVAL | NFT_SET_MAP | NFT_SET_OBJECT |
+			  NFT_SET_TIMEOUT,
+	.ops		= {
+		.lookup		= nft_pipapo_neon_lookup,
+		.insert		= nft_pipapo_insert,
+		.activate	= nft_pipapo_activate,
+		.deactivate	= nft_pipapo_deactivate,
+		.flush		= nft_pipapo_flush,
+		.remove		= nft_pipapo_remove,
+		.walk		= nft_pipapo_walk,
+		.get		= nft_pipapo_get,
+		.privsize	= nft_pipapo_privsize,
+		.estimate	= nft_pipapo_neon_estimate,
+		.init		= nft_pipapo_init,
+		.destroy	= nft_pipapo_destroy,
+		.gc_init	= nft_pipapo_gc_init,
+		.commit		= nft_pipapo_commit,
+		.abort		= nft_pipapo_abort,
+		.elemsize	= offsetof(struct nft_pipapo_elem, ext),
+	},
+};
+#endif
@@ -176,6 +176,8 @@ struct nft_pipapo_elem {
 	struct nft_set_ext ext;
 };
 
+DECLARE_PER_CPU(bool, nft_pipapo_scratch_index);
+
 int pipapo_refill(unsigned long *map, int len, int rules, unsigned long *dst,
 		  union nft_pipapo_map_bucket *mt, bool match_only);
 
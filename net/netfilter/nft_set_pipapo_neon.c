@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* PIPAPO: PIle PAcket POlicies: NEON packet lookup routines for arm64
+ *
+ * The matching step itself lives in nft_set_pipapo_neon_inner.c, which is
+ * the only part built with FP/SIMD code generation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+#include <net/netfilter/nf_tables_core.h>
+#include <uapi/linux/netfilter/nf_tables.h>
+#include <linux/bitmap.h>
+#include <linux/bitops.h>
+
+#include <asm/cpufeature.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+#include "nft_set_pipapo_neon.h"
+#include "nft_set_pipapo.h"
+
+/**
+ * nft_pipapo_neon_estimate() - Set size, space and lookup complexity
+ * @desc:	Set description, element count and field description used
+ * @features:	Flags: NFT_SET_INTERVAL needs to be there
+ * @est:	Storage for estimation data
+ *
+ * Return: true if set is compatible and NEON available, false otherwise.
+ */
+bool nft_pipapo_neon_estimate(const struct nft_set_desc *desc, u32 features,
+			      struct nft_set_estimate *est)
+{
+	if (!(features & NFT_SET_INTERVAL) ||
+	    desc->field_count < NFT_PIPAPO_MIN_FIELDS)
+		return false;
+
+	if (!system_supports_fpsimd())
+		return false;
+
+	est->size = pipapo_estimate_size(desc);
+	if (!est->size)
+		return false;
+
+	est->lookup = NFT_SET_CLASS_O_LOG_N;
+
+	est->space = NFT_SET_CLASS_O_N;
+
+	return true;
+}
+
+/**
+ * nft_pipapo_neon_lookup() - Lookup function for NEON implementation
+ * @net:	Network namespace
+ * @set:	nftables API set representation
+ * @key:	nftables API element representation containing key data
+ * @ext:	nftables API extension pointer, filled with matching reference
+ *
+ * For more details, see DOC: Theory of Operation in nft_set_pipapo.c.
+ *
+ * Same steps as nft_pipapo_lookup(), sharing its scratch maps and their
+ * index, so that falling back to it where SIMD can't be used is always safe.
+ * Only the bucket matching is vectorised, see nft_pipapo_neon_and_field().
+ *
+ * Return: true on match, false otherwise.
+ */
+bool nft_pipapo_neon_lookup(const struct net *net, const struct nft_set *set,
+			    const u32 *key, const struct nft_set_ext **ext)
+{
+	struct nft_pipapo *priv = nft_set_priv(set);
+	unsigned long *res_map, *fill_map;
+	u8 genmask = nft_genmask_cur(net);
+	const u8 *rp = (const u8 *)key;
+	struct nft_pipapo_match *m;
+	struct nft_pipapo_field *f;
+	bool map_index, ret = false;
+	int i;
+
+	BUILD_BUG_ON(NFT_PIPAPO_MAX_BYTES * BITS_PER_BYTE /
+		     NFT_PIPAPO_GROUP_BITS_LARGE_SET > NFT_PIPAPO_NEON_MAX_GROUPS);
+
+	if (unlikely(!may_use_simd()))
+		return nft_pipapo_lookup(net, set, key, ext);
+
+	local_bh_disable();
+	kernel_neon_begin();
+
+	map_index = raw_cpu_read(nft_pipapo_scratch_index);
+
+	m = rcu_dereference(priv->match);
+
+	if (unlikely(!m || !*raw_cpu_ptr(m->scratch)))
+		goto out;
+
+	res_map  = *raw_cpu_ptr(m->scratch) + (map_index ? m->bsize_max : 0);
+	fill_map = *raw_cpu_ptr(m->scratch) + (map_index ? 0 : m->bsize_max);
+
+	/* Starting map doesn't need to be set for this implementation */
+
+	nft_pipapo_for_each_field(f, i, m) {
+		bool last = i == m->field_count - 1;
+		int b;
+
+		NFT_PIPAPO_GROUP_BITS_ARE_8_OR_4;
+		if (!nft_pipapo_neon_and_field(res_map,
+					       NFT_PIPAPO_LT_ALIGN(f->lt),
+					       f->bsize, f->groups, f->bb, rp,
+					       !i))
+			goto out_index;
+
+		rp += f->groups / NFT_PIPAPO_GROUPS_PER_BYTE(f);
+
+next_match:
+		b = pipapo_refill(res_map, f->bsize, f->rules, fill_map, f->mt,
+				  last);
+		if (b < 0)
+			goto out_index;
+
+		if (last) {
+			*ext = &f->mt[b].e->ext;
+			if (unlikely(nft_set_elem_expired(*ext) ||
+				     !nft_set_elem_active(*ext, genmask)))
+				goto next_match;
+
+			ret = true;
+			goto out_index;
+		}
+
+		map_index = !map_index;
+		swap(res_map, fill_map);
+
+		rp += NFT_PIPAPO_GROUPS_PADDING(f);
+	}
+
+out_index:
+	raw_cpu_write(nft_pipapo_scratch_index, map_index);
+out:
+	kernel_neon_end();
+	local_bh_enable();
+	return ret;
+}
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef _NFT_SET_PIPAPO_NEON_H
+#define _NFT_SET_PIPAPO_NEON_H
+
+#if defined(CONFIG_ARM64) && defined(CONFIG_KERNEL_MODE_NEON)
+#include <linux/types.h>
+
+struct net;
+struct nft_set;
+struct nft_set_ext;
+struct nft_set_desc;
+struct nft_set_estimate;
+struct nft_set_type;
+
+/* Largest field (NFT_PIPAPO_MAX_BYTES) split in 4-bit groups */
+#define NFT_PIPAPO_NEON_MAX_GROUPS	32
+
+extern const struct nft_set_type nft_set_pipapo_neon_type;
+
+bool nft_pipapo_neon_lookup(const struct net *net, const struct nft_set *set,
+			    const u32 *key, const struct nft_set_ext **ext);
+bool nft_pipapo_neon_estimate(const struct nft_set_desc *desc, u32 features,
+			      struct nft_set_estimate *est);
+
+/* nft_set_pipapo_neon_inner.c, only valid between kernel_neon_begin/end() */
+bool nft_pipapo_neon_and_field(unsigned long *dst, const unsigned long *lt,
+			       size_t bsize, int groups, int bb,
+			       const u8 *data, bool first);
+#endif /* defined(CONFIG_ARM64) && defined(CONFIG_KERNEL_MODE_NEON) */
+
+#endif /* _NFT_SET_PIPAPO_NEON_H */
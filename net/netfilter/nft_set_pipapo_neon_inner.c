@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* PIPAPO: PIle PAcket POlicies: NEON bucket matching for arm64
+ *
+ * This file is built with FP/SIMD code generation enabled, keep anything that
+ * may run outside of kernel_neon_begin() and kernel_neon_end() out of it.
+ */
+
+#include <asm/neon-intrinsics.h>
+
+#include "nft_set_pipapo_neon.h"
+
+/**
+ * nft_pipapo_neon_and_field() - AND the buckets selected by packet data
+ * @dst:	Result bitmap, also the starting bitmap unless @first is set
+ * @lt:		Lookup table of the field
+ * @bsize:	Bucket size, in longs
+ * @groups:	Number of bit groups in the field
+ * @bb:		Bits per group, 4 or 8
+ * @data:	Packet data for this field
+ * @first:	First field: @dst has no starting content, don't load it
+ *
+ * This is pipapo_and_field_buckets_4bit() and _8bit() turned inside out: for
+ * each 128-bit chunk of the result, the buckets of all groups are ANDed in
+ * a register, and the chunk is stored once, instead of once per group.
+ *
+ * Return: true if any bit is left set in @dst.
+ */
+bool nft_pipapo_neon_and_field(unsigned long *dst, const unsigned long *lt,
+			       size_t bsize, int groups, int bb,
+			       const u8 *data, bool first)
+{
+	const u64 *bucket[NFT_PIPAPO_NEON_MAX_GROUPS];
+	uint64x2_t any = vdupq_n_u64(0);
+	size_t nbuckets = 1UL << bb, i;
+	u64 *res = (u64 *)dst;
+	u64 tail = 0;
+	int g;
+
+	for (g = 0; g < groups; g++) {
+		unsigned int v;
+
+		if (bb == 8)
+			v = data[g];
+		else
+			v = g % 2 ? data[g / 2] & 0x0f : data[g / 2] >> 4;
+
+		bucket[g] = (const u64 *)lt + (g * nbuckets + v) * bsize;
+	}
+
+	for (i = 0; i + 2 <= bsize; i += 2) {
+		uint64x2_t acc = vld1q_u64(bucket[0] + i);
+
+		if (!first)
+			acc = vandq_u64(acc, vld1q_u64(res + i));
+		for (g = 1; g < groups; g++)
+			acc = vandq_u64(acc, vld1q_u64(bucket[g] + i));
+
+		vst1q_u64(res + i, acc);
+		any = vorrq_u64(any, acc);
+	}
+
+	if (i < bsize) {
+		tail = first ? ~0ULL : res[i];
+		for (g = 0; g < groups; g++)
+			tail &= bucket[g][i];
+		res[i] = tail;
+	}
+
+	return tail || vgetq_lane_u64(any, 0) || vgetq_lane_u64(any, 1);
+}
@@ -80,11 +80,14 @@ struct fq_flow {
 
 /* Second cache line, used in fq_dequeue() */
 	int		credit;
-	/* 32bit hole on 64bit arches */
+	u32		wheel_slot;	/* q->wheel[] slot, or FQ_WHEEL_NONE */
 
 	struct fq_flow *next;		/* next pointer in RR lists */
 
-	struct rb_node  rate_node;	/* anchor in q->delayed tree */
+	union {
+		struct rb_node	  rate_node;	/* anchor in q->delayed tree */
+		struct hlist_node wheel_node;	/* anchor in q->wheel[] */
+	};
 	u64		time_next_packet;
 } ____cacheline_aligned_in_smp;
 
@@ -93,12 +96,28 @@ struct fq_flow_head {
 	struct fq_flow *last;
 };
 
+/*
+ * Throttled flows due within FQ_WHEEL_HORIZON of wheel_base sit unsorted in
+ * a timer wheel slot of 2^FQ_WHEEL_SHIFT ns, which makes throttling a flow
+ * O(1) regardless of their number. Flows paced further out, e.g. low rate
+ * flows sending TSO bursts, wait in the q->delayed rbtree until the wheel
+ * comes close enough.
+ */
+#define FQ_WHEEL_SHIFT		16	/* 65.5 usec per slot */
+#define FQ_WHEEL_SLOTS		1024
+#define FQ_WHEEL_HORIZON	((u64)FQ_WHEEL_SLOTS << FQ_WHEEL_SHIFT)
+#define FQ_WHEEL_NONE		~0U
+
 struct fq_sched_data {
 	struct fq_flow_head new_flows;
 
 	struct fq_flow_head old_flows;
 
-	struct rb_root	delayed;	/* for rate limited flows */
+	struct rb_root	delayed;	/* rate limited flows beyond the wheel */
+	struct hlist_head *wheel;	/* FQ_WHEEL_SLOTS rate limited flow lists */
+	u64		wheel_base;	/* start time of slot wheel_cur */
+	u32		wheel_cur;
+	unsigned long	wheel_map[BITS_TO_LONGS(FQ_WHEEL_SLOTS)];
 	u64		time_next_delayed_flow;
 	u64		ktime_cache;	/* copy of last ktime_get_ns() */
 	unsigned long	unthrottle_latency_ns;
@@ -171,15 +190,45 @@ static void fq_flow_add_tail(struct fq_flow_head *head, struct fq_flow *flow)
 
 static void fq_flow_unset_throttled(struct fq_sched_data *q, struct fq_flow *f)
 {
-	rb_erase(&f->rate_node, &q->delayed);
+	u32 slot = f->wheel_slot;
+
+	if (slot != FQ_WHEEL_NONE) {
+		hlist_del(&f->wheel_node);
+		if (hlist_empty(&q->wheel[slot]))
+			__clear_bit(slot, q->wheel_map);
+	} else {
+		rb_erase(&f->rate_node, &q->delayed);
+	}
 	q->throttled_flows--;
 	fq_flow_add_tail(&q->old_flows, f);
 }
 
+static void fq_wheel_insert(struct fq_sched_data *q, struct fq_flow *f)
+{
+	u64 delta = 0;
+	u32 slot;
+
+	/* already late flows go to the current slot */
+	if (f->time_next_packet > q->wheel_base)
+		delta = f->time_next_packet - q->wheel_base;
+	slot = (q->wheel_cur + (u32)(delta >> FQ_WHEEL_SHIFT)) &
+	       (FQ_WHEEL_SLOTS - 1);
+
+	hlist_add_head(&f->wheel_node, &q->wheel[slot]);
+	__set_bit(slot, q->wheel_map);
+	f->wheel_slot = slot;
+}
+
 static void fq_flow_set_throttled(struct fq_sched_data *q, struct fq_flow *f)
 {
 	struct rb_node **p = &q->delayed.rb_node, *parent = NULL;
 
+	if (f->time_next_packet < q->wheel_base + FQ_WHEEL_HORIZON) {
+		fq_wheel_insert(q, f);
+		goto out;
+	}
+
+	f->wheel_slot = FQ_WHEEL_NONE;
 	while (*p) {
 		struct fq_flow *aux;
 
@@ -192,6 +241,7 @@ static void fq_flow_set_throttled(struct fq_sched_data *q, struct fq_flow *f)
 	}
 	rb_link_node(&f->rate_node, parent, p);
 	rb_insert_color(&f->rate_node, &q->delayed);
+out:
 	q->throttled_flows++;
 	q->stat_throttled++;
 
@@ -496,10 +546,49 @@ static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	return NET_XMIT_SUCCESS;
 }
 
+/* Unthrottle the flows of @slot that are due at @now, all of them if ~0ULL */
+static void fq_wheel_run_slot(struct fq_sched_data *q, u32 slot, u64 now)
+{
+	struct hlist_node *tmp;
+	struct fq_flow *f;
+
+	hlist_for_each_entry_safe(f, tmp, &q->wheel[slot], wheel_node) {
+		if (f->time_next_packet <= now)
+			fq_flow_unset_throttled(q, f);
+	}
+}
+
+/* Earliest time_next_packet of all throttled flows, or ~0ULL */
+static u64 fq_wheel_next(const struct fq_sched_data *q)
+{
+	u64 next = ~0ULL;
+	struct fq_flow *f;
+	struct rb_node *p;
+	u32 slot;
+
+	slot = find_next_bit(q->wheel_map, FQ_WHEEL_SLOTS, q->wheel_cur);
+	if (slot >= FQ_WHEEL_SLOTS)
+		slot = find_first_bit(q->wheel_map, FQ_WHEEL_SLOTS);
+	if (slot < FQ_WHEEL_SLOTS) {
+		/* slots are in time order from wheel_cur on */
+		hlist_for_each_entry(f, &q->wheel[slot], wheel_node)
+			next = min(next, f->time_next_packet);
+		return next;
+	}
+
+	p = rb_first(&q->delayed);
+	if (p) {
+		f = rb_entry(p, struct fq_flow, rate_node);
+		next = f->time_next_packet;
+	}
+	return next;
+}
+
 static void fq_check_throttled(struct fq_sched_data *q, u64 now)
 {
 	unsigned long sample;
 	struct rb_node *p;
+	u64 behind;
 
 	if (q->time_next_delayed_flow > now)
 		return;
@@ -511,16 +600,45 @@ static void fq_check_throttled(struct fq_sched_data *q, u64 now)
 	q->unthrottle_latency_ns -= q->unthrottle_latency_ns >> 3;
 	q->unthrottle_latency_ns += sample >> 3;
 
-	q->time_next_delayed_flow = ~0ULL;
+	/* Every flow in a slot the wheel moves past is due */
+	behind = (now - q->wheel_base) >> FQ_WHEEL_SHIFT;
+	if (behind >= FQ_WHEEL_SLOTS) {
+		u32 slot;
+
+		for_each_set_bit(slot, q->wheel_map, FQ_WHEEL_SLOTS)
+			fq_wheel_run_slot(q, slot, ~0ULL);
+	} else {
+		u32 i;
+
+		for (i = 0; i < behind; i++) {
+			u32 slot = (q->wheel_cur + i) & (FQ_WHEEL_SLOTS - 1);
+
+			if (test_bit(slot, q->wheel_map))
+				fq_wheel_run_slot(q, slot, ~0ULL);
+		}
+	}
+	q->wheel_cur = (q->wheel_cur + (u32)behind) & (FQ_WHEEL_SLOTS - 1);
+	q->wheel_base += behind << FQ_WHEEL_SHIFT;
+
+	/* The slot @now falls in is only partly due */
+	if (test_bit(q->wheel_cur, q->wheel_map))
+		fq_wheel_run_slot(q, q->wheel_cur, now);
+
+	/* Pull flows that came within the wheel horizon out of the rbtree */
 	while ((p = rb_first(&q->delayed)) != NULL) {
 		struct fq_flow *f = rb_entry(p, struct fq_flow, rate_node);
 
 		if (f->time_next_packet > now) {
-			q->time_next_delayed_flow = f->time_next_packet;
-			break;
+			if (f->time_next_packet >= q->wheel_base + FQ_WHEEL_HORIZON)
+				break;
+			rb_erase(p, &q->delayed);
+			fq_wheel_insert(q, f);
+			continue;
 		}
 		fq_flow_unset_throttled(q, f);
 	}
+
+	q->time_next_delayed_flow = fq_wheel_next(q);
 }
 
 static struct sk_buff *fq_dequeue(struct Qdisc *sch)
@@ -672,6 +790,12 @@ static void fq_reset(struct Qdisc *sch)
 
 	fq_flow_purge(&q->internal);
 
+	if (q->wheel) {
+		for (idx = 0; idx < FQ_WHEEL_SLOTS; idx++)
+			INIT_HLIST_HEAD(&q->wheel[idx]);
+		bitmap_zero(q->wheel_map, FQ_WHEEL_SLOTS);
+	}
+
 	if (!q->fq_root)
 		return;
 
@@ -921,6 +1045,7 @@ static void fq_destroy(struct Qdisc *sch)
 
 	fq_reset(sch);
 	fq_free(q->fq_root);
+	fq_free(q->wheel);
 	qdisc_watchdog_cancel(&q->watchdog);
 }
 
@@ -956,6 +1081,13 @@ static int fq_init(struct Qdisc *sch, struct nlattr *opt,
 
 	qdisc_watchdog_init_clockid(&q->watchdog, sch, CLOCK_MONOTONIC);
 
+	q->wheel = kvzalloc_node(sizeof(*q->wheel) * FQ_WHEEL_SLOTS, GFP_KERNEL,
+				 netdev_queue_numa_node_read(sch->dev_queue));
+	if (!q->wheel)
+		return -ENOMEM;
+	q->wheel_base = ktime_get_ns() & ~((1ULL << FQ_WHEEL_SHIFT) - 1);
+	q->wheel_cur = 0;
+
 	if (opt)
 		err = fq_change(sch, opt, extack);
 	else
@@ -753,7 +753,8 @@ choose_victim(struct svc_serv *serv, struct svc_pool *pool, unsigned int *state)
 
 /* create new threads */
 static int
-svc_start_kthreads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
+svc_start_kthreads(struct svc_serv *serv, struct svc_pool *pool, int nrservs,
+		   bool dynamic)
 {
 	struct svc_rqst	*rqstp;
 	struct task_struct *task;
@@ -781,6 +782,13 @@ svc_start_kthreads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 		if (serv->sv_nrpools > 1)
 			svc_pool_map_set_cpumask(task, chosen_pool->sp_id);
 
+		if (dynamic) {
+			set_bit(RQ_DYNAMIC, &rqstp->rq_flags);
+			spin_lock_bh(&serv->sv_lock);
+			serv->sv_nrdynamic++;
+			spin_unlock_bh(&serv->sv_lock);
+		}
+
 		svc_sock_update_bufs(serv);
 		wake_up_process(task);
 	} while (nrservs > 0);
@@ -830,13 +838,58 @@ svc_set_num_threads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 	}
 
 	if (nrservs > 0)
-		return svc_start_kthreads(serv, pool, nrservs);
+		return svc_start_kthreads(serv, pool, nrservs, false);
 	if (nrservs < 0)
 		return svc_stop_kthreads(serv, pool, nrservs);
 	return 0;
 }
 EXPORT_SYMBOL_GPL(svc_set_num_threads);
 
+/**
+ * svc_start_dynamic_thread - Add an on-demand thread to a pool
+ * @serv: RPC service
+ * @pool: pool that ran out of idle threads
+ *
+ * The new thread is marked RQ_DYNAMIC, so that it may go away again
+ * through svc_thread_try_retire() once the pool is idle.  The same
+ * mutual exclusion as for svc_set_num_threads() is required.
+ *
+ * Returns zero on success or a negative errno.
+ */
+int svc_start_dynamic_thread(struct svc_serv *serv, struct svc_pool *pool)
+{
+	return svc_start_kthreads(serv, pool, 1, true);
+}
+EXPORT_SYMBOL_GPL(svc_start_dynamic_thread);
+
+/**
+ * svc_thread_try_retire - Let an idle on-demand thread exit
+ * @rqstp: thread that timed out waiting for work
+ *
+ * Returns true if the thread has been taken off its pool and has to
+ * exit through svc_exit_thread().  Returns false for threads started by
+ * svc_set_num_threads() and for threads already chosen to be stopped,
+ * which have to wait for kthread_stop().
+ */
+bool svc_thread_try_retire(struct svc_rqst *rqstp)
+{
+	struct svc_pool *pool = rqstp->rq_pool;
+	bool ret = false;
+
+	if (!test_bit(RQ_DYNAMIC, &rqstp->rq_flags))
+		return false;
+
+	spin_lock_bh(&pool->sp_lock);
+	if (!test_and_set_bit(RQ_VICTIM, &rqstp->rq_flags)) {
+		list_del_rcu(&rqstp->rq_all);
+		ret = true;
+	}
+	spin_unlock_bh(&pool->sp_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(svc_thread_try_retire);
+
 /**
  * svc_rqst_replace_page - Replace one page in rq_pages[]
  * @rqstp: svc_rqst with pages to replace
@@ -921,6 +974,8 @@ svc_exit_thread(struct svc_rqst *rqstp)
 
 	spin_lock_bh(&serv->sv_lock);
 	serv->sv_nrthreads -= 1;
+	if (test_bit(RQ_DYNAMIC, &rqstp->rq_flags))
+		serv->sv_nrdynamic -= 1;
 	spin_unlock_bh(&serv->sv_lock);
 	svc_sock_update_bufs(serv);
 
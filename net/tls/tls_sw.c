@@ -48,6 +48,9 @@
 
 #include "tls.h"
 
+/* padded TLS 1.3 records tolerated before TLS_RX_EXPECT_NO_PAD gives up */
+#define TLS_RX_NO_PAD_VIOL_MAX	8
+
 struct tls_decrypt_arg {
 	struct_group(inargs,
 	bool zc;
@@ -1434,6 +1437,31 @@ tls_alloc_clrtxt_skb(struct sock *sk, struct sk_buff *skb,
 	return clr_skb;
 }
 
+/* Synchronous decryption runs one record at a time under the reader lock, so
+ * the request memory is kept for the next record instead of being allocated
+ * for each one. Async requests own theirs until tls_decrypt_done().
+ */
+static void *tls_decrypt_mem_get(struct sock *sk, struct tls_sw_context_rx *ctx,
+				 size_t size, bool async)
+{
+	if (async)
+		return kmalloc(size, sk->sk_allocation);
+
+	if (ctx->decrypt_mem_size < size) {
+		size = kmalloc_size_roundup(size);
+		kfree(ctx->decrypt_mem);
+		ctx->decrypt_mem = kmalloc(size, sk->sk_allocation);
+		ctx->decrypt_mem_size = ctx->decrypt_mem ? size : 0;
+	}
+	return ctx->decrypt_mem;
+}
+
+static void tls_decrypt_mem_put(struct tls_sw_context_rx *ctx, void *mem)
+{
+	if (mem != ctx->decrypt_mem)
+		kfree(mem);
+}
+
 /* Decrypt handlers
  *
  * tls_decrypt_sw() and tls_decrypt_device() are decrypt handlers.
@@ -1507,8 +1535,9 @@ static int tls_decrypt_sg(struct sock *sk, struct iov_iter *out_iov,
 	 */
 	aead_size = sizeof(*aead_req) + crypto_aead_reqsize(ctx->aead_recv);
 	aead_size = ALIGN(aead_size, __alignof__(*dctx));
-	mem = kmalloc(aead_size + struct_size(dctx, sg, n_sgin + n_sgout),
-		      sk->sk_allocation);
+	mem = tls_decrypt_mem_get(sk, ctx, aead_size +
+				  struct_size(dctx, sg, n_sgin + n_sgout),
+				  darg->async);
 	if (!mem) {
 		err = -ENOMEM;
 		goto exit_free_skb;
@@ -1613,7 +1642,7 @@ static int tls_decrypt_sg(struct sock *sk, struct iov_iter *out_iov,
 	for (; pages > 0; pages--)
 		put_page(sg_page(&sgout[pages]));
 exit_free:
-	kfree(mem);
+	tls_decrypt_mem_put(ctx, mem);
 exit_free_skb:
 	consume_skb(clear_skb);
 	return err;
@@ -1640,8 +1669,14 @@ tls_decrypt_sw(struct sock *sk, struct tls_context *tls_ctx,
 	if (unlikely(darg->zc && prot->version == TLS_1_3_VERSION &&
 		     darg->tail != TLS_RECORD_TYPE_DATA)) {
 		darg->zc = false;
-		if (!darg->tail)
+		if (!darg->tail) {
 			TLS_INC_STATS(sock_net(sk), LINUX_MIB_TLSRXNOPADVIOL);
+			/* A peer that keeps padding makes every record be
+			 * decrypted twice, stop trying zero-copy for it.
+			 */
+			if (++ctx->no_pad_viol >= TLS_RX_NO_PAD_VIOL_MAX)
+				ctx->zc_capable = 0;
+		}
 		TLS_INC_STATS(sock_net(sk), LINUX_MIB_TLSDECRYPTRETRY);
 		return tls_decrypt_sw(sk, tls_ctx, msg, darg);
 	}
@@ -2391,6 +2426,8 @@ void tls_sw_release_resources_rx(struct sock *sk)
 	if (ctx->aead_recv) {
 		__skb_queue_purge(&ctx->rx_list);
 		crypto_free_aead(ctx->aead_recv);
+		kfree(ctx->decrypt_mem);
+		ctx->decrypt_mem = NULL;
 		tls_strp_stop(&ctx->strp);
 		/* If tls_sw_strparser_arm() was not called (cleanup paths)
 		 * we still want to tls_strp_stop(), but sk->sk_data_ready was
@@ -2497,6 +2534,7 @@ void tls_update_rx_zc_capable(struct tls_context *tls_ctx)
 
 	rx_ctx->zc_capable = tls_ctx->rx_no_pad ||
 		tls_ctx->prot_info.version != TLS_1_3_VERSION;
+	rx_ctx->no_pad_viol = 0;
 }
 
 int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
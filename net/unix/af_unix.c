@@ -569,6 +569,7 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	skb_queue_purge(&sk->sk_error_queue);
 
 	DEBUG_NET_WARN_ON_ONCE(refcount_read(&sk->sk_wmem_alloc));
 	DEBUG_NET_WARN_ON_ONCE(!sk_unhashed(sk));
@@ -2104,6 +2105,79 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
  */
 #define UNIX_SKB_FRAGS_SZ (PAGE_SIZE << get_order(32768))
 
+/* Writes up to this size are appended to the skb at the tail of the peer's
+ * receive queue when they can be, rather than getting an skb each.
+ */
+#define UNIX_SKB_COALESCE_MAX	2048
+
+/* Returns the number of bytes queued, 0 if the write has to go into an skb
+ * of its own, which leaves @msg untouched, or an error.
+ */
+static int unix_stream_coalesce(struct sock *sk, struct msghdr *msg,
+				struct sock *other, struct scm_cookie *scm,
+				int size)
+{
+	struct page_frag *pfrag = sk_page_frag(sk);
+	struct unix_sock *ou = unix_sk(other);
+	struct sk_buff *skb;
+	size_t copied;
+	int err = 0;
+
+	if (scm->fp ||
+	    sk_wmem_alloc_get(sk) + size > READ_ONCE(sk->sk_sndbuf))
+		return 0;
+
+	if (!skb_page_frag_refill(size, pfrag, sk->sk_allocation))
+		return 0;
+
+	copied = copy_from_iter(page_address(pfrag->page) + pfrag->offset,
+				size, &msg->msg_iter);
+	if (copied != size) {
+		iov_iter_revert(&msg->msg_iter, copied);
+		return -EFAULT;
+	}
+
+	/* a reader holding iolock is about to drain the queue anyway */
+	if (!mutex_trylock(&ou->iolock))
+		goto revert;
+
+	unix_state_lock(other);
+
+	if (sock_flag(other, SOCK_DEAD) ||
+	    (other->sk_shutdown & RCV_SHUTDOWN)) {
+		err = -EPIPE;
+		goto unlock;
+	}
+
+	skb = skb_peek_tail(&other->sk_receive_queue);
+	if (!skb || skb->len + size > UNIX_SKB_FRAGS_SZ ||
+#if IS_ENABLED(CONFIG_AF_UNIX_OOB)
+	    skb == ou->oob_skb ||
+#endif
+	    UNIXCB(skb).fp || skb_zcopy(skb) || !unix_skb_scm_eq(skb, scm) ||
+	    skb_append_pagefrags(skb, pfrag->page, pfrag->offset, size))
+		goto unlock;
+
+	skb->len += size;
+	skb->data_len += size;
+	skb->truesize += size;
+	refcount_add(size, &sk->sk_wmem_alloc);
+	pfrag->offset += size;
+	err = size;
+
+unlock:
+	unix_state_unlock(other);
+	mutex_unlock(&ou->iolock);
+
+	if (err > 0) {
+		other->sk_data_ready(other);
+		return err;
+	}
+revert:
+	iov_iter_revert(&msg->msg_iter, size);
+	return err;
+}
+
 #if IS_ENABLED(CONFIG_AF_UNIX_OOB)
 static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other,
 		     struct scm_cookie *scm, bool fds_sent)
@@ -2162,6 +2236,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 {
 	struct sock *sk = sock->sk;
 	struct sock *other = NULL;
+	struct ubuf_info *uarg = NULL;
 	int err, size;
 	struct sk_buff *skb;
 	int sent = 0;
@@ -2197,12 +2272,63 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	/* The peer's queue references the pinned user pages until it has
+	 * read them, completions are reported on the error queue.
+	 */
+	if (msg->msg_flags & MSG_ZEROCOPY && len && sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = msg_zerocopy_realloc(sk, len, NULL);
+		if (!uarg) {
+			err = -ENOBUFS;
+			goto out_err;
+		}
+	}
+
 	while (sent < len) {
 		size = len - sent;
 
+		if (!uarg && size <= UNIX_SKB_COALESCE_MAX) {
+			err = unix_stream_coalesce(sk, msg, other, &scm, size);
+			if (err == -EPIPE)
+				goto pipe_err;
+			if (err < 0)
+				goto out_err;
+			if (err) {
+				sent += err;
+				continue;
+			}
+		}
+
 		/* Keep two messages in the pipe so it schedules better */
 		size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
 
+		if (uarg) {
+			skb = sock_alloc_send_pskb(sk, 0, 0,
+						   msg->msg_flags & MSG_DONTWAIT,
+						   &err, 0);
+			if (!skb)
+				goto out_err;
+
+			err = unix_scm_to_skb(&scm, skb, !fds_sent);
+			if (err < 0) {
+				kfree_skb(skb);
+				goto out_err;
+			}
+			fds_sent = true;
+
+			/* fills at most MAX_SKB_FRAGS, size is what made it */
+			err = __zerocopy_sg_from_iter(NULL, NULL, skb,
+						      &msg->msg_iter, size);
+			if (err == -EFAULT || !skb->len) {
+				iov_iter_revert(&msg->msg_iter, skb->len);
+				kfree_skb(skb);
+				err = -EFAULT;
+				goto out_err;
+			}
+			skb_zcopy_set(skb, uarg, NULL);
+			size = skb->len;
+			goto queue;
+		}
+
 		/* allow fallback to order-0 allocations */
 		size = min_t(int, size, SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
 
@@ -2232,7 +2358,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			kfree_skb(skb);
 			goto out_err;
 		}
-
+queue:
 		unix_state_lock(other);
 
 		if (sock_flag(other, SOCK_DEAD) ||
@@ -2256,6 +2382,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	}
 #endif
 
+	net_zcopy_put(uarg);
 	scm_destroy(&scm);
 
 	return sent;
@@ -2268,6 +2395,10 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		send_sig(SIGPIPE, current, 0);
 	err = -EPIPE;
 out_err:
+	if (sent)
+		net_zcopy_put(uarg);
+	else
+		net_zcopy_put_abort(uarg, true);
 	scm_destroy(&scm);
 	return sent ? : err;
 }
@@ -2952,7 +3083,13 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 #ifdef CONFIG_BPF_SYSCALL
 	struct sock *sk = sock->sk;
 	const struct proto *prot = READ_ONCE(sk->sk_prot);
+#endif
 
+	if (flags & MSG_ERRQUEUE)
+		return sock_recv_errqueue(sock->sk, msg, size, SOL_SOCKET,
+					  SO_ZEROCOPY);
+
+#ifdef CONFIG_BPF_SYSCALL
 	if (prot != &unix_stream_proto)
 		return prot->recvmsg(sk, msg, size, flags, NULL);
 #endif
@@ -2963,6 +3100,10 @@ static int unix_stream_splice_actor(struct sk_buff *skb,
 				    int skip, int chunk,
 				    struct unix_stream_read_state *state)
 {
+	/* pages lent by a MSG_ZEROCOPY sender must not end up in the pipe */
+	if (skb_orphan_frags_rx(skb, GFP_KERNEL))
+		return -ENOMEM;
+
 	return skb_splice_bits(skb, state->socket->sk,
 			       UNIXCB(skb).consumed + skip,
 			       state->pipe, chunk, state->splice_flags);
@@ -3164,7 +3305,8 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	shutdown = READ_ONCE(sk->sk_shutdown);
 
 	/* exceptional events? */
-	if (READ_ONCE(sk->sk_err))
+	if (READ_ONCE(sk->sk_err) ||
+	    !skb_queue_empty_lockless(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
@@ -135,14 +135,18 @@ int xsk_reg_pool_at_qid(struct net_device *dev, struct xsk_buff_pool *pool,
 	return 0;
 }
 
-static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
+/* Worst case number of Rx descriptors a copy mode packet is split into */
+#define XSK_RX_MAX_DESC		(MAX_SKB_FRAGS + 1)
+
+static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
+			u32 flags)
 {
 	struct xdp_buff_xsk *xskb = container_of(xdp, struct xdp_buff_xsk, xdp);
 	u64 addr;
 	int err;
 
 	addr = xp_get_handle(xskb);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, flags);
 	if (err) {
 		xs->rx_queue_full++;
 		return err;
@@ -170,16 +174,92 @@ static void xsk_copy_xdp(struct xdp_buff *to, struct xdp_buff *from, u32 len)
 	memcpy(to_buf, from_buf, len + metalen);
 }
 
+/* Split a frame that does not fit a single chunk, linear part and frags
+ * alike, over as many Rx descriptors as needed. All buffers and ring
+ * entries are taken up front so either the whole packet is posted, with
+ * XDP_PKT_CONTD on all but the last descriptor, or none of it.
+ */
+static int __xsk_rcv_sg(struct xdp_sock *xs, struct xdp_buff *xdp, u32 total)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+	u32 frame_size = xsk_pool_get_rx_frame_size(xs->pool);
+	struct xdp_buff *bufs[XSK_RX_MAX_DESC];
+	u32 from_len, nr_desc, i, frag = 0;
+	void *from;
+
+	nr_desc = DIV_ROUND_UP(total, frame_size);
+	if (nr_desc > XSK_RX_MAX_DESC) {
+		xs->rx_dropped++;
+		return -ENOSPC;
+	}
+
+	if (xskq_prod_nb_free(xs->rx, nr_desc) < nr_desc) {
+		xs->rx_queue_full++;
+		return -ENOBUFS;
+	}
+
+	for (i = 0; i < nr_desc; i++) {
+		bufs[i] = xsk_buff_alloc(xs->pool);
+		if (!bufs[i]) {
+			while (i--)
+				xsk_buff_free(bufs[i]);
+			xs->rx_dropped++;
+			return -ENOMEM;
+		}
+	}
+
+	from = xdp->data;
+	from_len = xdp->data_end - xdp->data;
+
+	for (i = 0; i < nr_desc; i++) {
+		u32 len = min(total, frame_size), copied = 0;
+		void *to = bufs[i]->data;
+
+		if (!i && !xdp_data_meta_unsupported(xdp)) {
+			u32 metalen = xdp->data - xdp->data_meta;
+
+			memcpy(to - metalen, xdp->data_meta, metalen);
+		}
+
+		while (copied < len) {
+			u32 chunk;
+
+			if (!from_len) {
+				from = skb_frag_address(&sinfo->frags[frag]);
+				from_len = skb_frag_size(&sinfo->frags[frag]);
+				frag++;
+			}
+
+			chunk = min(len - copied, from_len);
+			memcpy(to + copied, from, chunk);
+			copied += chunk;
+			from += chunk;
+			from_len -= chunk;
+		}
+
+		total -= len;
+		/* cannot fail, the ring space was checked above */
+		__xsk_rcv_zc(xs, bufs[i], len, total ? XDP_PKT_CONTD : 0);
+	}
+
+	return 0;
+}
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 {
 	struct xdp_buff *xsk_xdp;
+	u32 len, total;
 	int err;
-	u32 len;
 
 	len = xdp->data_end - xdp->data;
-	if (len > xsk_pool_get_rx_frame_size(xs->pool)) {
-		xs->rx_dropped++;
-		return -ENOSPC;
+	total = xdp_get_buff_len(xdp);
+	if (total > xsk_pool_get_rx_frame_size(xs->pool) ||
+	    unlikely(total != len)) {
+		if (!xs->sg) {
+			xs->rx_dropped++;
+			return -ENOSPC;
+		}
+		return __xsk_rcv_sg(xs, xdp, total);
 	}
 
 	xsk_xdp = xsk_buff_alloc(xs->pool);
@@ -189,7 +269,7 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 	}
 
 	xsk_copy_xdp(xsk_xdp, xdp, len);
-	err = __xsk_rcv_zc(xs, xsk_xdp, len);
+	err = __xsk_rcv_zc(xs, xsk_xdp, len, 0);
 	if (err) {
 		xsk_buff_free(xsk_xdp);
 		return err;
@@ -259,7 +339,7 @@ static int xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 
 	if (xdp->rxq->mem.type == MEM_TYPE_XSK_BUFF_POOL) {
 		len = xdp->data_end - xdp->data;
-		return __xsk_rcv_zc(xs, xdp, len);
+		return __xsk_rcv_zc(xs, xdp, len, 0);
 	}
 
 	err = __xsk_rcv(xs, xdp);
@@ -897,7 +977,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_USE_SG))
 		return -EINVAL;
 
 	bound_dev_if = READ_ONCE(sk->sk_bound_dev_if);
@@ -1029,6 +1109,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	xs->dev = dev;
 	xs->zc = xs->umem->zc;
+	xs->sg = !!(flags & XDP_USE_SG);
 	xs->queue_id = qid;
 	xp_add_xsk(xs->pool, xs);
 
@@ -957,6 +957,17 @@ int snd_pcm_attach_substream(struct snd_pcm *pcm, int stream,
 	}
 	memset(runtime->status, 0, size);
 
+	if (size >= SNDRV_PCM_TSTAMP_RING_OFFSET +
+		    sizeof(struct snd_pcm_tstamp_ring) +
+		    sizeof(struct snd_pcm_tstamp_entry)) {
+		runtime->tstamp_ring = (void *)runtime->status +
+			SNDRV_PCM_TSTAMP_RING_OFFSET;
+		runtime->tstamp_ring->nr_entries =
+			(size - SNDRV_PCM_TSTAMP_RING_OFFSET -
+			 sizeof(struct snd_pcm_tstamp_ring)) /
+			sizeof(struct snd_pcm_tstamp_entry);
+	}
+
 	size = PAGE_ALIGN(sizeof(struct snd_pcm_mmap_control));
 	runtime->control = alloc_pages_exact(size, GFP_KERNEL);
 	if (runtime->control == NULL) {
@@ -280,6 +280,26 @@ static void update_audio_tstamp(struct snd_pcm_substream *substream,
 	runtime->driver_tstamp = driver_tstamp;
 }
 
+static void snd_pcm_record_tstamp(struct snd_pcm_runtime *runtime,
+				  snd_pcm_uframes_t hw_ptr,
+				  const struct timespec64 *tstamp)
+{
+	struct snd_pcm_tstamp_ring *ring = runtime->tstamp_ring;
+	struct snd_pcm_tstamp_entry *entry;
+	u32 head;
+
+	if (!ring)
+		return;
+
+	head = ring->head;
+	entry = &ring->entries[head % ring->nr_entries];
+	entry->hw_ptr = hw_ptr;
+	entry->tstamp_sec = tstamp->tv_sec;
+	entry->tstamp_nsec = tstamp->tv_nsec;
+	/* publish the entry before advancing head */
+	smp_store_release(&ring->head, head + 1);
+}
+
 static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 				  unsigned int in_interrupt)
 {
@@ -478,8 +498,11 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 			runtime->hw_ptr_interrupt -= runtime->boundary;
 	}
 	runtime->hw_ptr_base = hw_base;
-	runtime->status->hw_ptr = new_hw_ptr;
+	/* may be read locklessly by user-space through the status mmap */
+	WRITE_ONCE(runtime->status->hw_ptr, new_hw_ptr);
 	runtime->hw_ptr_jiffies = curr_jiffies;
+	if (in_interrupt && runtime->tstamp_mode == SNDRV_PCM_TSTAMP_ENABLE)
+		snd_pcm_record_tstamp(runtime, new_hw_ptr, &curr_tstamp);
 	if (crossed_boundary) {
 		snd_BUG_ON(crossed_boundary != 1);
 		runtime->hw_ptr_wrap += runtime->boundary;
@@ -3647,8 +3647,14 @@ static __poll_t snd_pcm_poll(struct file *file, poll_table *wait)
 /*
  * Only on coherent architectures, we can mmap the status and the control records
  * for effcient data transfer.  On others, we have to use HWSYNC ioctl...
+ *
+ * arm64 data caches behave as PIPT, so the kernel and user mappings of the
+ * records never alias, regardless of the base page size.  The records are
+ * page aligned allocations and the mmap size is checked against PAGE_ALIGN(),
+ * so 16K and 64K page kernels work the same way as 4K ones.
  */
-#if defined(CONFIG_X86) || defined(CONFIG_PPC) || defined(CONFIG_ALPHA)
+#if defined(CONFIG_X86) || defined(CONFIG_PPC) || defined(CONFIG_ALPHA) || \
+	defined(CONFIG_ARM64)
 /*
  * mmap status record
  */
@@ -100,6 +100,7 @@ static struct snd_soc_dai_link macaudio_fe_links[] = {
 		.stream_name = "Secondary",
 		.dynamic = 1,
 		.dpcm_playback = 1,
+		.dpcm_capture = 1,
 		.dpcm_merged_rate = 1,
 		.dpcm_merged_chan = 1,
 		.dpcm_merged_format = 1,
@@ -665,12 +666,13 @@ static int macaudio_add_backend_dai_route(struct snd_soc_card *card, struct snd_
 		r->source = "Headphone Playback";
 	r->sink = dai->stream[SNDRV_PCM_STREAM_PLAYBACK].widget->name;
 
-	/* If headphone jack, add capture path */
-	if (!is_speakers) {
-		r = &routes[nroutes++];
-		r->source = dai->stream[SNDRV_PCM_STREAM_CAPTURE].widget->name;
-		r->sink = "Headset Capture";
-	}
+	/*
+	 * Add the capture path: the headset mic for the jack, the amps'
+	 * current/voltage sense data for speakers.
+	 */
+	r = &routes[nroutes++];
+	r->source = dai->stream[SNDRV_PCM_STREAM_CAPTURE].widget->name;
+	r->sink = is_speakers ? "Speaker Sense Capture" : "Headset Capture";
 
 	ret = snd_soc_dapm_add_routes(&card->dapm, routes, nroutes);
 	if (ret)
@@ -915,6 +917,7 @@ static const struct snd_soc_dapm_widget macaudio_snd_widgets[] = {
 	SND_SOC_DAPM_AIF_OUT("Headphone Playback", NULL, 0, SND_SOC_NOPM, 0, 0),
 
 	SND_SOC_DAPM_AIF_IN("Headset Capture", NULL, 0, SND_SOC_NOPM, 0, 0),
+	SND_SOC_DAPM_AIF_IN("Speaker Sense Capture", NULL, 0, SND_SOC_NOPM, 0, 0),
 };
 
 static const struct snd_kcontrol_new macaudio_controls[] = {
@@ -938,6 +941,7 @@ static const struct snd_soc_dapm_route macaudio_dapm_routes[] = {
 
 	/* Capture paths */
 	{ "PCM0 RX", NULL, "Headset Capture" },
+	{ "PCM1 RX", NULL, "Speaker Sense Capture" },
 };
 
 static const struct of_device_id macaudio_snd_device_id[]  = {
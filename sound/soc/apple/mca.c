@@ -141,6 +141,13 @@ struct mca_cluster {
 
 	unsigned int bclk_ratio;
 
+	/*
+	 * Nominal clock rate requested by hw_params and the trim applied to
+	 * it, in ppm relative to MCA_PITCH_UNITY. See mca_pitch_put().
+	 */
+	unsigned long nominal_rate;
+	unsigned int pitch;
+
 	/* Masks etc. picked up via the set_tdm_slot method */
 	int tdm_slots;
 	int tdm_slot_width;
@@ -164,6 +171,14 @@ struct mca_data {
 	struct mca_cluster clusters[];
 };
 
+#define MCA_PITCH_UNITY		1000000
+#define MCA_PITCH_MAX_PPM	1000
+
+static bool low_latency;
+module_param(low_latency, bool, 0644);
+MODULE_PARM_DESC(low_latency,
+		 "Allow sub-millisecond periods and keep the DMA FIFO shallow");
+
 static void mca_modify(struct mca_cluster *cl, int regoffset, u32 mask, u32 val)
 {
 	__iomem void *ptr = cl->base + regoffset;
@@ -557,6 +572,12 @@ static int mca_fe_get_port(struct snd_pcm_substream *substream)
 	return mca_dai_to_cluster(asoc_rtd_to_cpu(be, 0))->no;
 }
 
+static unsigned long mca_pitched_rate(struct mca_cluster *cl)
+{
+	return div_u64((u64)cl->nominal_rate * READ_ONCE(cl->pitch),
+		       MCA_PITCH_UNITY);
+}
+
 static int mca_fe_hw_params(struct snd_pcm_substream *substream,
 			    struct snd_pcm_hw_params *params,
 			    struct snd_soc_dai *dai)
@@ -663,7 +684,8 @@ static int mca_fe_hw_params(struct snd_pcm_substream *substream,
 		writel_relaxed(FIELD_PREP(MCLK_CONF_DIV, 0x1),
 			       cl->base + REG_MCLK_CONF);
 
-		ret = clk_set_rate(cl->clk_parent, bclk_ratio * samp_rate);
+		cl->nominal_rate = bclk_ratio * samp_rate;
+		ret = clk_set_rate(cl->clk_parent, mca_pitched_rate(cl));
 		if (ret) {
 			dev_err(mca->dev, "cluster %d: unable to set clock parent: %d\n",
 				cl->no, ret);
@@ -805,11 +827,22 @@ static int mca_set_runtime_hwparams(struct snd_soc_component *component,
 
 	memset(&hw, 0, sizeof(hw));
 
+	/*
+	 * ADMAC reports residue at burst granularity, so the pointer is
+	 * exact and clients that poll the mmapped status on their own
+	 * schedule can turn off period interrupts altogether.
+	 */
 	hw.info = SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_MMAP_VALID |
-		  SNDRV_PCM_INFO_INTERLEAVED;
+		  SNDRV_PCM_INFO_INTERLEAVED | SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
 	hw.periods_min = 2;
 	hw.periods_max = UINT_MAX;
-	hw.period_bytes_min = 256;
+	/*
+	 * In low-latency mode allow periods down to 16 frames of stereo
+	 * 16-bit audio, i.e. a third of a millisecond at 48 kHz. The DMA
+	 * controller interrupts once per period, so this is only a matter
+	 * of IRQ rate.
+	 */
+	hw.period_bytes_min = low_latency ? 64 : 256;
 	hw.period_bytes_max = dma_get_max_seg_size(dma_dev);
 	hw.buffer_bytes_max = SIZE_MAX;
 	hw.fifo_size = 16;
@@ -866,6 +899,12 @@ static int mca_hw_params(struct snd_soc_component *component,
 		slave_config.src_port_window_size =
 			min_t(u32, params_channels(params), 4);
 
+	/* Trigger DMA on every couple of frames rather than the default */
+	if (low_latency) {
+		slave_config.dst_maxburst = 2 * params_channels(params);
+		slave_config.src_maxburst = 2 * params_channels(params);
+	}
+
 	return dmaengine_slave_config(chan, &slave_config);
 }
 
@@ -987,8 +1026,95 @@ static int mca_pcm_new(struct snd_soc_component *component,
 	return 0;
 }
 
+/*
+ * "PCMn Pitch 1000000" controls, following the convention of the UAC2 gadget:
+ * the value is the ratio between the actual and nominal clock rate in ppm.
+ * Clock recovery for network audio can slave the cluster clock to a remote
+ * clock this way instead of resampling. Trims go to the NCO while it runs.
+ */
+static int mca_pitch_info(struct snd_kcontrol *kcontrol,
+			  struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = 1;
+	uinfo->value.integer.min = MCA_PITCH_UNITY - MCA_PITCH_MAX_PPM;
+	uinfo->value.integer.max = MCA_PITCH_UNITY + MCA_PITCH_MAX_PPM;
+	uinfo->value.integer.step = 1;
+	return 0;
+}
+
+static int mca_pitch_get(struct snd_kcontrol *kcontrol,
+			 struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component = snd_kcontrol_chip(kcontrol);
+	struct mca_data *mca = snd_soc_component_get_drvdata(component);
+	struct mca_cluster *cl = &mca->clusters[kcontrol->private_value];
+
+	ucontrol->value.integer.value[0] = READ_ONCE(cl->pitch);
+	return 0;
+}
+
+static int mca_pitch_put(struct snd_kcontrol *kcontrol,
+			 struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component = snd_kcontrol_chip(kcontrol);
+	struct mca_data *mca = snd_soc_component_get_drvdata(component);
+	struct mca_cluster *cl = &mca->clusters[kcontrol->private_value];
+	long val = ucontrol->value.integer.value[0];
+	int ret;
+
+	if (val < MCA_PITCH_UNITY - MCA_PITCH_MAX_PPM ||
+	    val > MCA_PITCH_UNITY + MCA_PITCH_MAX_PPM)
+		return -EINVAL;
+
+	if (val == READ_ONCE(cl->pitch))
+		return 0;
+
+	WRITE_ONCE(cl->pitch, val);
+
+	if (!cl->nominal_rate)
+		return 1;
+
+	ret = clk_set_rate(cl->clk_parent, mca_pitched_rate(cl));
+	if (ret) {
+		dev_err(mca->dev, "cluster %d: unable to trim clock: %d\n",
+			cl->no, ret);
+		return ret;
+	}
+
+	return 1;
+}
+
+static int mca_component_probe(struct snd_soc_component *component)
+{
+	struct mca_data *mca = snd_soc_component_get_drvdata(component);
+	struct snd_kcontrol_new *controls;
+	int i;
+
+	controls = devm_kcalloc(mca->dev, mca->nclusters, sizeof(*controls),
+				GFP_KERNEL);
+	if (!controls)
+		return -ENOMEM;
+
+	for (i = 0; i < mca->nclusters; i++) {
+		controls[i].iface = SNDRV_CTL_ELEM_IFACE_MIXER;
+		controls[i].name = devm_kasprintf(mca->dev, GFP_KERNEL,
+						  "PCM%d Pitch 1000000", i);
+		if (!controls[i].name)
+			return -ENOMEM;
+		controls[i].info = mca_pitch_info;
+		controls[i].get = mca_pitch_get;
+		controls[i].put = mca_pitch_put;
+		controls[i].private_value = i;
+	}
+
+	return snd_soc_add_component_controls(component, controls,
+					      mca->nclusters);
+}
+
 static const struct snd_soc_component_driver mca_component = {
 	.name = "apple-mca",
+	.probe = mca_component_probe,
 	.open = mca_pcm_open,
 	.close = mca_close,
 	.hw_params = mca_hw_params,
@@ -1089,6 +1215,7 @@ static int apple_mca_probe(struct platform_device *pdev)
 		cl->no = i;
 		cl->base = base + CLUSTER_STRIDE * i;
 		cl->port_driver = -1;
+		cl->pitch = MCA_PITCH_UNITY;
 		cl->clk_parent = of_clk_get(pdev->dev.of_node, i);
 		if (IS_ERR(cl->clk_parent)) {
 			dev_err(&pdev->dev, "unable to obtain clock %d: %ld\n",
@@ -344,6 +344,8 @@ struct tcp_diag_md5sig {
 /* setsockopt(fd, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, ...) */
 
 #define TCP_RECEIVE_ZEROCOPY_FLAG_TLB_CLEAN_HINT 0x1
+/* copy payload that cannot be mapped as is into pages and map those */
+#define TCP_RECEIVE_ZEROCOPY_FLAG_ASSEMBLE 0x2
 struct tcp_zerocopy_receive {
 	__u64 address;		/* in: address of mapping */
 	__u32 length;		/* in/out: number of bytes to map/mapped */
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * dma.c
+ *
+ * dma: Benchmark DMA API map/unmap cost through kernel/dma/map_benchmark.c
+ *
+ * The device to measure must be bound to the "dma_map_benchmark" driver
+ * first, e.g. for a platform device behind an IOMMU:
+ *
+ *   echo dma_map_benchmark > /sys/bus/platform/devices/<dev>/driver_override
+ *   echo <dev> > /sys/bus/platform/drivers/dma_map_benchmark/bind
+ */
+#include <subcmd/parse-options.h>
+#include "bench.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/ioctl.h>
+#include <linux/kernel.h>
+#include <linux/time64.h>
+#include <linux/types.h>
+#include <linux/map_benchmark.h>
+
+#define DMA_MAP_BENCHMARK_PATH	"/sys/kernel/debug/dma_map_benchmark"
+#define DMA_BENCH_MAX_ENTRIES	32
+
+static const char	*threads_str	= "1,2,4,8";
+static const char	*granules_str	= "1,16,256";
+static const char	*mode_str	= "single";
+static const char	*dir_str	= "bidir";
+static unsigned int	seconds		= 2;
+static unsigned int	dma_bits	= 32;
+static unsigned int	trans_ns;
+static int		node		= -1;
+
+static const struct option options[] = {
+	OPT_STRING('t', "threads", &threads_str, "1,2,4,8",
+		   "Comma separated list of thread counts"),
+	OPT_STRING('g', "granule", &granules_str, "1,16,256",
+		   "Comma separated list of mapping sizes, in pages"),
+	OPT_STRING('m', "mode", &mode_str, "single",
+		   "Mapping call: single (dma_map_single) or sg (dma_map_sg)"),
+	OPT_STRING('d', "dir", &dir_str, "bidir",
+		   "DMA direction: bidir, to or from"),
+	OPT_UINTEGER('s', "seconds", &seconds,
+		     "Duration of each run in seconds"),
+	OPT_UINTEGER('b', "dma-bits", &dma_bits,
+		     "DMA addressing capability of the device"),
+	OPT_UINTEGER('x', "trans-ns", &trans_ns,
+		     "Simulated transfer time between map and unmap, in ns"),
+	OPT_INTEGER('n', "node", &node,
+		    "NUMA node to run the kernel threads on (-1: any)"),
+	OPT_END()
+};
+
+static const char * const bench_dma_usage[] = {
+	"perf bench dma map <options>",
+	NULL
+};
+
+static int parse_list(const char *str, unsigned int *vals, const char *what)
+{
+	char *buf, *tok, *saveptr = NULL, *end;
+	int nr = 0;
+
+	buf = strdup(str);
+	if (!buf)
+		return -ENOMEM;
+
+	for (tok = strtok_r(buf, ",", &saveptr); tok;
+	     tok = strtok_r(NULL, ",", &saveptr)) {
+		unsigned long val = strtoul(tok, &end, 0);
+
+		if (*end || !val || nr == DMA_BENCH_MAX_ENTRIES) {
+			fprintf(stderr, "Invalid %s list: %s\n", what, str);
+			free(buf);
+			return -EINVAL;
+		}
+		vals[nr++] = val;
+	}
+
+	free(buf);
+	if (!nr) {
+		fprintf(stderr, "Empty %s list\n", what);
+		return -EINVAL;
+	}
+	return nr;
+}
+
+static int parse_mode(void)
+{
+	if (!strcmp(mode_str, "single"))
+		return DMA_MAP_SINGLE_MODE;
+	if (!strcmp(mode_str, "sg"))
+		return DMA_MAP_SG_MODE;
+
+	fprintf(stderr, "Unknown mode: %s\n", mode_str);
+	return -EINVAL;
+}
+
+static int parse_dir(void)
+{
+	if (!strcmp(dir_str, "bidir"))
+		return DMA_MAP_BIDIRECTIONAL;
+	if (!strcmp(dir_str, "to"))
+		return DMA_MAP_TO_DEVICE;
+	if (!strcmp(dir_str, "from"))
+		return DMA_MAP_FROM_DEVICE;
+
+	fprintf(stderr, "Unknown direction: %s\n", dir_str);
+	return -EINVAL;
+}
+
+static void print_result(const struct map_benchmark *map, bool first)
+{
+	/* the kernel reports latencies in units of 100ns */
+	double mops = (double)map->loops / map->seconds / 1e6;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		if (first)
+			printf("# %8s %8s %14s %10s %14s %10s %10s\n",
+			       "pages", "threads", "map ns/op", "stddev",
+			       "unmap ns/op", "stddev", "Mops/s");
+		printf("  %8u %8u %14llu %10llu %14llu %10llu %10.3f\n",
+		       map->granule, map->threads,
+		       (unsigned long long)map->avg_map_100ns * 100,
+		       (unsigned long long)map->map_stddev * 100,
+		       (unsigned long long)map->avg_unmap_100ns * 100,
+		       (unsigned long long)map->unmap_stddev * 100, mops);
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%u %u %llu %llu %.3f\n", map->granule, map->threads,
+		       (unsigned long long)map->avg_map_100ns * 100,
+		       (unsigned long long)map->avg_unmap_100ns * 100, mops);
+		break;
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+	}
+}
+
+int bench_dma_map(int argc, const char **argv)
+{
+	unsigned int threads[DMA_BENCH_MAX_ENTRIES];
+	unsigned int granules[DMA_BENCH_MAX_ENTRIES];
+	int nr_threads, nr_granules, mode, dir, fd;
+	bool first = true;
+	int i, j, ret = 0;
+
+	argc = parse_options(argc, argv, options, bench_dma_usage, 0);
+	if (argc)
+		usage_with_options(bench_dma_usage, options);
+
+	nr_threads = parse_list(threads_str, threads, "threads");
+	nr_granules = parse_list(granules_str, granules, "granule");
+	mode = parse_mode();
+	dir = parse_dir();
+	if (nr_threads < 0 || nr_granules < 0 || mode < 0 || dir < 0)
+		return 1;
+
+	fd = open(DMA_MAP_BENCHMARK_PATH, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot open %s: %s\n"
+			"Bind a device to the dma_map_benchmark driver first.\n",
+			DMA_MAP_BENCHMARK_PATH, strerror(errno));
+		return 1;
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Running DMA %s map/unmap, dir %s, %u second(s) per run\n",
+		       mode_str, dir_str, seconds);
+
+	for (i = 0; i < nr_granules; i++) {
+		for (j = 0; j < nr_threads; j++) {
+			struct map_benchmark map = {
+				.threads	= threads[j],
+				.seconds	= seconds,
+				.node		= node,
+				.dma_bits	= dma_bits,
+				.dma_dir	= dir,
+				.dma_trans_ns	= trans_ns,
+				.granule	= granules[i],
+				.map_mode	= mode,
+			};
+
+			if (ioctl(fd, DMA_MAP_BENCHMARK, &map)) {
+				fprintf(stderr, "DMA_MAP_BENCHMARK failed (%u pages, %u threads): %s\n",
+					granules[i], threads[j], strerror(errno));
+				ret = 1;
+				goto out;
+			}
+
+			print_result(&map, first);
+			first = false;
+		}
+	}
+
+out:
+	close(fd);
+	return ret;
+}
@@ -16,6 +16,7 @@
  *  numa  ... NUMA scheduling and MM performance
  *  futex ... Futex performance
  *  epoll ... Event poll performance
+ *  dma   ... DMA API map/unmap performance
  */
 #include <subcmd/parse-options.h>
 #include "builtin.h"
@@ -104,6 +105,11 @@ static struct bench breakpoint_benchmarks[] = {
 	{ NULL,	NULL, NULL },
 };
 
+static struct bench dma_benchmarks[] = {
+	{ "map",	"Benchmark DMA API map/unmap via dma_map_benchmark",	bench_dma_map	},
+	{ NULL,		NULL,						NULL			}
+};
+
 struct collection {
 	const char	*name;
 	const char	*summary;
@@ -123,6 +129,7 @@ static struct collection collections[] = {
 #endif
 	{ "internals",	"Perf-internals benchmarks",			internals_benchmarks	},
 	{ "breakpoint",	"Breakpoint benchmarks",			breakpoint_benchmarks	},
+	{ "dma",	"DMA mapping benchmarks",			dma_benchmarks		},
 	{ "all",	"All benchmarks",				NULL			},
 	{ NULL,		NULL,						NULL			}
 };
@@ -27,6 +27,7 @@ include/linux/const.h
 include/vdso/const.h
 include/linux/hash.h
 include/linux/list-sort.h
+include/linux/map_benchmark.h
 include/uapi/linux/hw_breakpoint.h
 arch/x86/include/asm/disabled-features.h
 arch/x86/include/asm/required-features.h
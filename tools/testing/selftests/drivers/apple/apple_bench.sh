@@ -0,0 +1,69 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Runs the apple-bench micro-benchmarks and prints their latency histograms.
+#
+# The SMC read benchmark uses the key given in APPLE_BENCH_SMC_KEY ("#KEY" by
+# default, which every SMC firmware exposes). The DART benchmark runs against
+# each platform device named in APPLE_BENCH_DART_DEVS, e.g.
+#
+#   APPLE_BENCH_DART_DEVS="22c000000.dcp 393cc0000.nvme" ./apple_bench.sh
+#
+# APPLE_BENCH_ITERATIONS overrides the number of samples per run.
+
+DRIVER="apple-bench"
+DIR=/sys/kernel/debug/apple-bench
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+SMC_KEY=${APPLE_BENCH_SMC_KEY:-"#KEY"}
+ITERATIONS=${APPLE_BENCH_ITERATIONS:-10000}
+
+exitcode=0
+
+check_test_requirements()
+{
+	if [ "$(id -u)" -ne 0 ]; then
+		echo "$0: Must be run as root"
+		exit $ksft_skip
+	fi
+
+	if [ ! -d $DIR ]; then
+		modprobe -q $DRIVER
+	fi
+	if [ ! -d $DIR ]; then
+		echo "$0: $DIR not found (CONFIG_APPLE_SOC_BENCHMARK?)"
+		exit $ksft_skip
+	fi
+}
+
+run_bench()
+{
+	local name=$1
+	local target=$2
+
+	echo "=== $name: $target"
+	if ! printf '%s' "$target" > $DIR/$name; then
+		echo "$name: $target: FAIL"
+		exitcode=1
+		return
+	fi
+	cat $DIR/result
+}
+
+check_test_requirements
+
+echo $ITERATIONS > $DIR/iterations
+
+if [ -d /sys/bus/platform/drivers/macsmc-rtkit ]; then
+	run_bench smc "$SMC_KEY"
+else
+	echo "smc: no SMC bound, skipping"
+fi
+
+for dev in $APPLE_BENCH_DART_DEVS; do
+	run_bench dart "$dev"
+done
+
+exit $exitcode